@@ -370,13 +370,19 @@ XLogDumpDisplayRecord(XLogDumpConfig *config, XLogRecPtr ReadRecPtr, XLogRecord
 
 			memcpy(&bkpb, blk, sizeof(BkpBlock));
 			blk += sizeof(BkpBlock);
-			blk += BLCKSZ - bkpb.hole_length;
+			blk += bkpb.length;
 
-			printf("\tbackup bkp #%u; rel %u/%u/%u; fork: %s; block: %u; hole: offset: %u, length: %u\n",
+			printf("\tbackup bkp #%u; rel %u/%u/%u; fork: %s; block: %u; hole: offset: %u, length: %u",
 				   bkpnum,
 				   bkpb.node.spcNode, bkpb.node.dbNode, bkpb.node.relNode,
 				   forkNames[bkpb.fork],
 				   bkpb.block, bkpb.hole_offset, bkpb.hole_length);
+			if (bkpb.flags & BKPBLOCK_IS_COMPRESSED)
+				printf("; compressed: %u bytes, saved: %u bytes\n",
+					   bkpb.length,
+					   (BLCKSZ - bkpb.hole_length) - bkpb.length);
+			else
+				printf("\n");
 		}
 	}
 }
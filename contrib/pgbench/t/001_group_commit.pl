@@ -0,0 +1,36 @@
+use strict;
+use warnings;
+use TestLib;
+use Test::More tests => 3;
+
+# Run many small transactions concurrently, so that committing backends
+# queue up behind each other in XLogFlush and get their WAL flushed as a
+# group.  Followers sleep until a flush leader wakes them, so a lost wakeup
+# would show up as a hang here.
+my $tempdir = TestLib::tempdir;
+start_test_server $tempdir;
+
+psql 'postgres', 'CREATE TABLE group_commit (id int)';
+
+my $script = "$tempdir/group_commit.sql";
+open my $fh, '>', $script or die "could not open file $script";
+print $fh "INSERT INTO group_commit VALUES (1);\n";
+close $fh;
+
+command_like(
+	[   'pgbench', '--no-vacuum', '--client=8', '--transactions=200',
+		'--file',  $script,       'postgres' ],
+	qr{processed: 1600/1600},
+	'concurrent commits');
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'postgres', '-c',
+		'SELECT count(*) FROM group_commit' ],
+	qr/^1600$/,
+	'all commits are visible');
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'postgres', '-c',
+		'SELECT sum(flushes) > 0 FROM pg_stat_wal_flush_batches' ],
+	qr/^t$/,
+	'group flushes are counted');
@@ -34,6 +34,9 @@
  * commands at the same nesting depth on the remote as we're executing at
  * ourselves, so that rolling back a subtransaction will kill the right
  * queries and not the wrong ones.
+ *
+ * The "state" of an entry is shared by all the scans and modify operations
+ * using the connection; see PgFdwConnState.
  */
 typedef struct ConnCacheKey
 {
@@ -49,6 +52,7 @@ typedef struct ConnCacheEntry
 								 * one level of subxact open, etc */
 	bool		have_prep_stmt; /* have we prepared any stmts in this xact? */
 	bool		have_error;		/* have any subxacts aborted in this xact? */
+	PgFdwConnState state;		/* extra per-connection state */
 } ConnCacheEntry;
 
 /*
@@ -86,6 +90,10 @@ static void pgfdw_subxact_callback(SubXactEvent event,
  * statements.	Since those don't go away automatically at transaction end
  * (not even on error), we need this flag to cue manual cleanup.
  *
+ * If state is not NULL, *state receives the connection's PgFdwConnState,
+ * and the caller must complete any asynchronous request in progress before
+ * using the connection.  Otherwise we complete it here.
+ *
  * XXX Note that caching connections theoretically requires a mechanism to
  * detect change of FDW objects to invalidate already established connections.
  * We could manage that by watching for invalidation events on the relevant
@@ -95,7 +103,7 @@ static void pgfdw_subxact_callback(SubXactEvent event,
  */
 PGconn *
 GetConnection(ForeignServer *server, UserMapping *user,
-			  bool will_prep_stmt)
+			  bool will_prep_stmt, PgFdwConnState **state)
 {
 	bool		found;
 	ConnCacheEntry *entry;
@@ -142,6 +150,7 @@ GetConnection(ForeignServer *server, UserMapping *user,
 		entry->xact_depth = 0;
 		entry->have_prep_stmt = false;
 		entry->have_error = false;
+		entry->state.pending_scan = NULL;
 	}
 
 	/*
@@ -160,11 +169,23 @@ GetConnection(ForeignServer *server, UserMapping *user,
 		entry->xact_depth = 0;	/* just to be sure */
 		entry->have_prep_stmt = false;
 		entry->have_error = false;
+		entry->state.pending_scan = NULL;
 		entry->conn = connect_pg_server(server, user);
 		elog(DEBUG3, "new postgres_fdw connection %p for server \"%s\"",
 			 entry->conn, server->servername);
 	}
 
+	/*
+	 * If a scan has a request in flight on the connection, collect its
+	 * result before anything else is sent.  Callers that get the state back
+	 * do this themselves when they actually use the connection, so we need
+	 * only worry about them if we're about to start a subtransaction.
+	 */
+	if (entry->state.pending_scan &&
+		(state == NULL ||
+		 entry->xact_depth < GetCurrentTransactionNestLevel()))
+		process_pending_request(entry->state.pending_scan);
+
 	/*
 	 * Start a new transaction or subtransaction if needed.
 	 */
@@ -173,6 +194,9 @@ GetConnection(ForeignServer *server, UserMapping *user,
 	/* Remember if caller will prepare statements */
 	entry->have_prep_stmt |= will_prep_stmt;
 
+	if (state)
+		*state = &entry->state;
+
 	return entry->conn;
 }
 
@@ -622,6 +646,12 @@ pgfdw_xact_callback(XactEvent event, void *arg)
 		/* Reset state to show we're out of a transaction */
 		entry->xact_depth = 0;
 
+		/*
+		 * Any scan that had a request in flight is gone by now; the commands
+		 * above have discarded the request's result.
+		 */
+		entry->state.pending_scan = NULL;
+
 		/*
 		 * If the connection isn't in a good idle state, discard it to
 		 * recover. Next GetConnection will open a new connection.
@@ -707,6 +737,14 @@ pgfdw_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
 				pgfdw_report_error(WARNING, res, entry->conn, true, sql);
 			else
 				PQclear(res);
+
+			/*
+			 * A scan with a request in flight must belong to the aborted
+			 * subtransaction, since any use of the connection at this level
+			 * would have completed the request first.  The rollback has
+			 * discarded its result.
+			 */
+			entry->state.pending_scan = NULL;
 		}
 
 		/* OK, we're outta that level of subtransaction */
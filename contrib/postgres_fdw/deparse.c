@@ -11,6 +11,12 @@
  * One saving grace is that we only need deparse logic for node types that
  * we consider safe to send.
  *
+ * Besides scans of a single foreign table, we can construct queries that
+ * perform a join of several foreign tables on the same server, and queries
+ * that perform grouping and aggregation over either.  In a join query every
+ * base relation is given the alias "rN", N being its rangetable index, and
+ * column references are qualified with that alias.
+ *
  * We assume that the remote session's search_path is exactly "pg_catalog",
  * and thus we need schema-qualify all and only names outside pg_catalog.
  *
@@ -38,6 +44,7 @@
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/transam.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_operator.h"
@@ -114,7 +121,7 @@ static void deparseReturningList(StringInfo buf, PlannerInfo *root,
 					 List *returningList,
 					 List **retrieved_attrs);
 static void deparseColumnRef(StringInfo buf, int varno, int varattno,
-				 PlannerInfo *root);
+				 PlannerInfo *root, bool qualify_col);
 static void deparseRelation(StringInfo buf, Relation rel);
 static void deparseStringLiteral(StringInfo buf, const char *val);
 static void deparseExpr(Expr *expr, deparse_expr_cxt *context);
@@ -132,6 +139,11 @@ static void deparseRelabelType(RelabelType *node, deparse_expr_cxt *context);
 static void deparseBoolExpr(BoolExpr *node, deparse_expr_cxt *context);
 static void deparseNullTest(NullTest *node, deparse_expr_cxt *context);
 static void deparseArrayExpr(ArrayExpr *node, deparse_expr_cxt *context);
+static void deparseAggref(Aggref *node, deparse_expr_cxt *context);
+static void deparseExprList(List *tlist, deparse_expr_cxt *context);
+static void deparseFromExprForRel(RelOptInfo *foreignrel,
+					  deparse_expr_cxt *context);
+static void appendConditions(List *exprs, deparse_expr_cxt *context);
 static void printRemoteParam(int paramindex, Oid paramtype, int32 paramtypmod,
 				 deparse_expr_cxt *context);
 static void printRemotePlaceholder(Oid paramtype, int32 paramtypmod,
@@ -169,6 +181,9 @@ classifyConditions(PlannerInfo *root,
 
 /*
  * Returns true if given expr is safe to evaluate on the foreign server.
+ *
+ * baserel may be a foreign table or a join of foreign tables; Vars of any
+ * of its members count as belonging to the foreign relation.
  */
 bool
 is_foreign_expr(PlannerInfo *root,
@@ -189,9 +204,13 @@ is_foreign_expr(PlannerInfo *root,
 	if (!foreign_expr_walker((Node *) expr, &glob_cxt, &loc_cxt))
 		return false;
 
-	/* Expressions examined here should be boolean, ie noncollatable */
-	Assert(loc_cxt.collation == InvalidOid);
-	Assert(loc_cxt.state == FDW_COLLATE_NONE);
+	/*
+	 * Conditions are boolean, ie noncollatable, but grouping expressions and
+	 * aggregates need not be.  Their collation must derive from a foreign
+	 * Var, too.
+	 */
+	if (loc_cxt.state == FDW_COLLATE_UNSAFE)
+		return false;
 
 	/*
 	 * An expression which includes any mutable functions can't be sent over
@@ -244,13 +263,13 @@ foreign_expr_walker(Node *node,
 				Var		   *var = (Var *) node;
 
 				/*
-				 * If the Var is from the foreign table, we consider its
+				 * If the Var is from the foreign relation, we consider its
 				 * collation (if any) safe to use.	If it is from another
 				 * table, we treat its collation the same way as we would a
 				 * Param's collation, ie it's not safe for it to have a
 				 * non-default collation.
 				 */
-				if (var->varno == glob_cxt->foreignrel->relid &&
+				if (bms_is_member(var->varno, glob_cxt->foreignrel->relids) &&
 					var->varlevelsup == 0)
 				{
 					/* Var belongs to foreign table */
@@ -540,6 +559,61 @@ foreign_expr_walker(Node *node,
 					state = FDW_COLLATE_UNSAFE;
 			}
 			break;
+		case T_Aggref:
+			{
+				Aggref	   *agg = (Aggref *) node;
+				ListCell   *lc;
+
+				/* As for functions, only built-in aggregates can be sent */
+				if (!is_builtin(agg->aggfnoid))
+					return false;
+
+				/*
+				 * We don't try to send ordered-set aggregates, nor aggregates
+				 * with ORDER BY, FILTER or VARIADIC, which older remote
+				 * servers might not understand anyway.
+				 */
+				if (agg->aggkind != AGGKIND_NORMAL ||
+					agg->aggorder != NIL ||
+					agg->aggfilter != NULL ||
+					agg->aggvariadic ||
+					agg->agglevelsup != 0)
+					return false;
+
+				/*
+				 * Recurse to input arguments, which are TargetEntries.
+				 */
+				foreach(lc, agg->args)
+				{
+					TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+					Assert(IsA(tle, TargetEntry));
+					if (!foreign_expr_walker((Node *) tle->expr,
+											 glob_cxt, &inner_cxt))
+						return false;
+				}
+
+				/*
+				 * If aggregate's input collation is not derived from a
+				 * foreign Var, it can't be sent to remote.
+				 */
+				if (agg->inputcollid == InvalidOid)
+					 /* OK, inputs are all noncollatable */ ;
+				else if (inner_cxt.state != FDW_COLLATE_SAFE ||
+						 agg->inputcollid != inner_cxt.collation)
+					return false;
+
+				/* Result-collation handling is same as for functions */
+				collation = agg->aggcollid;
+				if (collation == InvalidOid)
+					state = FDW_COLLATE_NONE;
+				else if (inner_cxt.state == FDW_COLLATE_SAFE &&
+						 collation == inner_cxt.collation)
+					state = FDW_COLLATE_SAFE;
+				else
+					state = FDW_COLLATE_UNSAFE;
+			}
+			break;
 		case T_List:
 			{
 				List	   *l = (List *) node;
@@ -739,7 +813,7 @@ deparseTargetList(StringInfo buf,
 				appendStringInfoString(buf, ", ");
 			first = false;
 
-			deparseColumnRef(buf, rtindex, i, root);
+			deparseColumnRef(buf, rtindex, i, root, false);
 
 			*retrieved_attrs = lappend_int(*retrieved_attrs, i);
 		}
@@ -825,6 +899,232 @@ appendWhereClause(StringInfo buf,
 	reset_transmission_modes(nestlevel);
 }
 
+/*
+ * Construct a SELECT statement that performs the join represented by joinrel
+ * on the remote server, and append it to "buf".  The statement retrieves the
+ * expressions in tlist (a list of TargetEntry), in order.
+ *
+ * Base relations are aliased "rN" in the FROM clause, N being the relation's
+ * rangetable index.  Conditions that can't be part of any ON clause go into
+ * the WHERE clause.
+ *
+ * If params_list is not NULL, it receives a list of Params and
+ * other-relation Vars used in the statement, as for appendWhereClause.
+ */
+void
+deparseSelectSqlForJoin(StringInfo buf,
+						PlannerInfo *root,
+						RelOptInfo *joinrel,
+						List *tlist,
+						List **params_list)
+{
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) joinrel->fdw_private;
+	deparse_expr_cxt context;
+	int			nestlevel;
+
+	Assert(joinrel->reloptkind == RELOPT_JOINREL);
+
+	/* Set up context struct for recursion */
+	context.root = root;
+	context.foreignrel = joinrel;
+	context.buf = buf;
+	context.params_list = params_list;
+
+	/* Make sure any constants in the exprs are printed portably */
+	nestlevel = set_transmission_modes();
+
+	appendStringInfoString(buf, "SELECT ");
+	deparseExprList(tlist, &context);
+
+	appendStringInfoString(buf, " FROM ");
+	deparseFromExprForRel(joinrel, &context);
+
+	if (fpinfo->remote_conds)
+	{
+		appendStringInfoString(buf, " WHERE ");
+		appendConditions(fpinfo->remote_conds, &context);
+	}
+
+	reset_transmission_modes(nestlevel);
+}
+
+/*
+ * Construct a SELECT statement that computes the grouping expressions and
+ * aggregates in tlist over inputrel, which is either a foreign table or a
+ * join of foreign tables, and append it to "buf".
+ *
+ * The first numGroupCols entries of tlist are the grouping expressions; they
+ * are referenced by position in the GROUP BY clause.  having is an implicitly
+ * ANDed list of conditions to put in the HAVING clause.
+ *
+ * params_list is handled as for deparseSelectSqlForJoin.
+ */
+void
+deparseSelectSqlForGrouping(StringInfo buf,
+							PlannerInfo *root,
+							RelOptInfo *inputrel,
+							List *tlist,
+							int numGroupCols,
+							List *having,
+							List **params_list)
+{
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) inputrel->fdw_private;
+	deparse_expr_cxt context;
+	int			nestlevel;
+	int			i;
+
+	/* Set up context struct for recursion */
+	context.root = root;
+	context.foreignrel = inputrel;
+	context.buf = buf;
+	context.params_list = params_list;
+
+	/* Make sure any constants in the exprs are printed portably */
+	nestlevel = set_transmission_modes();
+
+	appendStringInfoString(buf, "SELECT ");
+	deparseExprList(tlist, &context);
+
+	appendStringInfoString(buf, " FROM ");
+	deparseFromExprForRel(inputrel, &context);
+
+	if (fpinfo->remote_conds)
+	{
+		appendStringInfoString(buf, " WHERE ");
+		appendConditions(fpinfo->remote_conds, &context);
+	}
+
+	for (i = 1; i <= numGroupCols; i++)
+		appendStringInfo(buf, "%s%d", (i == 1) ? " GROUP BY " : ", ", i);
+
+	if (having)
+	{
+		appendStringInfoString(buf, " HAVING ");
+		appendConditions(having, &context);
+	}
+
+	reset_transmission_modes(nestlevel);
+}
+
+/*
+ * Emit the expressions of a list of TargetEntry, separated by commas.
+ */
+static void
+deparseExprList(List *tlist, deparse_expr_cxt *context)
+{
+	bool		first = true;
+	ListCell   *lc;
+
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		Assert(IsA(tle, TargetEntry));
+
+		if (!first)
+			appendStringInfoString(context->buf, ", ");
+		first = false;
+
+		deparseExpr(tle->expr, context);
+	}
+
+	/* Don't generate bad syntax if the list is empty */
+	if (first)
+		appendStringInfoString(context->buf, "NULL");
+}
+
+/*
+ * Emit the FROM clause item for foreignrel, which is either a foreign table
+ * or a join of foreign tables.  A join is printed as a parenthesized JOIN
+ * expression with its join clauses in the ON clause; the conditions kept in
+ * the remote_conds of its members are the caller's business.
+ */
+static void
+deparseFromExprForRel(RelOptInfo *foreignrel, deparse_expr_cxt *context)
+{
+	StringInfo	buf = context->buf;
+
+	if (foreignrel->reloptkind == RELOPT_JOINREL)
+	{
+		PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) foreignrel->fdw_private;
+		const char *jointype = NULL;	/* keep compiler quiet */
+
+		switch (fpinfo->jointype)
+		{
+			case JOIN_INNER:
+				jointype = "INNER";
+				break;
+			case JOIN_LEFT:
+				jointype = "LEFT";
+				break;
+			case JOIN_RIGHT:
+				jointype = "RIGHT";
+				break;
+			case JOIN_FULL:
+				jointype = "FULL";
+				break;
+			default:
+				elog(ERROR, "unsupported join type %d", (int) fpinfo->jointype);
+		}
+
+		appendStringInfoChar(buf, '(');
+		deparseFromExprForRel(fpinfo->outerrel, context);
+		appendStringInfo(buf, " %s JOIN ", jointype);
+		deparseFromExprForRel(fpinfo->innerrel, context);
+
+		appendStringInfoString(buf, " ON (");
+		if (fpinfo->joinclauses)
+			appendConditions(fpinfo->joinclauses, context);
+		else
+			appendStringInfoString(buf, "TRUE");
+		appendStringInfoString(buf, "))");
+	}
+	else
+	{
+		RangeTblEntry *rte = planner_rt_fetch(foreignrel->relid, context->root);
+		Relation	rel;
+
+		/*
+		 * Core code already has some lock on each rel being planned, so we
+		 * can use NoLock here.
+		 */
+		rel = heap_open(rte->relid, NoLock);
+		deparseRelation(buf, rel);
+		heap_close(rel, NoLock);
+
+		/* Alias the table if it's part of a join */
+		if (context->foreignrel->reloptkind == RELOPT_JOINREL)
+			appendStringInfo(buf, " r%d", foreignrel->relid);
+	}
+}
+
+/*
+ * Emit a list of conditions, which may be RestrictInfos or bare expressions,
+ * connected with "AND" and each parenthesized.
+ */
+static void
+appendConditions(List *exprs, deparse_expr_cxt *context)
+{
+	bool		first = true;
+	ListCell   *lc;
+
+	foreach(lc, exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (IsA(expr, RestrictInfo))
+			expr = ((RestrictInfo *) expr)->clause;
+
+		if (!first)
+			appendStringInfoString(context->buf, " AND ");
+		first = false;
+
+		appendStringInfoChar(context->buf, '(');
+		deparseExpr(expr, context);
+		appendStringInfoChar(context->buf, ')');
+	}
+}
+
 /*
  * deparse remote INSERT statement
  *
@@ -858,7 +1158,7 @@ deparseInsertSql(StringInfo buf, PlannerInfo *root,
 				appendStringInfoString(buf, ", ");
 			first = false;
 
-			deparseColumnRef(buf, rtindex, attnum, root);
+			deparseColumnRef(buf, rtindex, attnum, root, false);
 		}
 
 		appendStringInfoString(buf, ") VALUES (");
@@ -885,6 +1185,50 @@ deparseInsertSql(StringInfo buf, PlannerInfo *root,
 						 returningList, retrieved_attrs);
 }
 
+/*
+ * Build a remote INSERT statement that inserts num_rows rows at once, from
+ * the single-row statement made by deparseInsertSql.
+ *
+ * orig_query must have no RETURNING clause, so that it ends with the VALUES
+ * list of its num_params parameters; the parameters of later rows are
+ * numbered consecutively after those of the first.
+ */
+void
+rebuildInsertSql(StringInfo buf, const char *orig_query,
+				 int num_params, int num_rows)
+{
+	StringInfoData values;
+	int			prefix_len;
+	int			i;
+	int			j;
+
+	/* Construct the VALUES list of the single-row statement */
+	initStringInfo(&values);
+	appendStringInfoChar(&values, '(');
+	for (j = 1; j <= num_params; j++)
+		appendStringInfo(&values, "%s$%d", (j > 1) ? ", " : "", j);
+	appendStringInfoChar(&values, ')');
+
+	prefix_len = strlen(orig_query) - values.len;
+	if (num_params <= 0 || prefix_len <= 0 ||
+		strcmp(orig_query + prefix_len, values.data) != 0)
+		elog(ERROR, "unexpected remote INSERT statement: \"%s\"", orig_query);
+
+	appendBinaryStringInfo(buf, orig_query, prefix_len);
+	for (i = 0; i < num_rows; i++)
+	{
+		if (i > 0)
+			appendStringInfoString(buf, ", ");
+		appendStringInfoChar(buf, '(');
+		for (j = 1; j <= num_params; j++)
+			appendStringInfo(buf, "%s$%d", (j > 1) ? ", " : "",
+							 i * num_params + j);
+		appendStringInfoChar(buf, ')');
+	}
+
+	pfree(values.data);
+}
+
 /*
  * deparse remote UPDATE statement
  *
@@ -916,7 +1260,7 @@ deparseUpdateSql(StringInfo buf, PlannerInfo *root,
 			appendStringInfoString(buf, ", ");
 		first = false;
 
-		deparseColumnRef(buf, rtindex, attnum, root);
+		deparseColumnRef(buf, rtindex, attnum, root, false);
 		appendStringInfo(buf, " = $%d", pindex);
 		pindex++;
 	}
@@ -1074,9 +1418,12 @@ deparseAnalyzeSql(StringInfo buf, Relation rel, List **retrieved_attrs)
 /*
  * Construct name to use for given column, and emit it into buf.
  * If it has a column_name FDW option, use that instead of attribute name.
+ * If qualify_col is true, qualify the column name with the alias of its
+ * relation in a join query.
  */
 static void
-deparseColumnRef(StringInfo buf, int varno, int varattno, PlannerInfo *root)
+deparseColumnRef(StringInfo buf, int varno, int varattno, PlannerInfo *root,
+				 bool qualify_col)
 {
 	RangeTblEntry *rte;
 	char	   *colname = NULL;
@@ -1112,6 +1459,8 @@ deparseColumnRef(StringInfo buf, int varno, int varattno, PlannerInfo *root)
 	if (colname == NULL)
 		colname = get_relid_attribute_name(rte->relid, varattno);
 
+	if (qualify_col)
+		appendStringInfo(buf, "r%d.", varno);
 	appendStringInfoString(buf, quote_identifier(colname));
 }
 
@@ -1239,6 +1588,9 @@ deparseExpr(Expr *node, deparse_expr_cxt *context)
 		case T_ArrayExpr:
 			deparseArrayExpr((ArrayExpr *) node, context);
 			break;
+		case T_Aggref:
+			deparseAggref((Aggref *) node, context);
+			break;
 		default:
 			elog(ERROR, "unsupported expression type for deparse: %d",
 				 (int) nodeTag(node));
@@ -1249,7 +1601,8 @@ deparseExpr(Expr *node, deparse_expr_cxt *context)
 /*
  * Deparse given Var node into context->buf.
  *
- * If the Var belongs to the foreign relation, just print its remote name.
+ * If the Var belongs to the foreign relation, just print its remote name,
+ * qualified with its relation's alias if the foreign relation is a join.
  * Otherwise, it's effectively a Param (and will in fact be a Param at
  * run time).  Handle it the same way we handle plain Params --- see
  * deparseParam for comments.
@@ -1259,11 +1612,12 @@ deparseVar(Var *node, deparse_expr_cxt *context)
 {
 	StringInfo	buf = context->buf;
 
-	if (node->varno == context->foreignrel->relid &&
+	if (bms_is_member(node->varno, context->foreignrel->relids) &&
 		node->varlevelsup == 0)
 	{
 		/* Var belongs to foreign table */
-		deparseColumnRef(buf, node->varno, node->varattno, context->root);
+		deparseColumnRef(buf, node->varno, node->varattno, context->root,
+						 context->foreignrel->reloptkind == RELOPT_JOINREL);
 	}
 	else
 	{
@@ -1797,6 +2151,61 @@ deparseArrayExpr(ArrayExpr *node, deparse_expr_cxt *context)
 						 format_type_with_typemod(node->array_typeid, -1));
 }
 
+/*
+ * Deparse an Aggref node.  Only plain aggregates get here, see
+ * foreign_expr_walker.
+ */
+static void
+deparseAggref(Aggref *node, deparse_expr_cxt *context)
+{
+	StringInfo	buf = context->buf;
+	HeapTuple	proctup;
+	Form_pg_proc procform;
+	bool		first;
+	ListCell   *arg;
+
+	proctup = SearchSysCache1(PROCOID, ObjectIdGetDatum(node->aggfnoid));
+	if (!HeapTupleIsValid(proctup))
+		elog(ERROR, "cache lookup failed for function %u", node->aggfnoid);
+	procform = (Form_pg_proc) GETSTRUCT(proctup);
+
+	/* Print schema name only if it's not pg_catalog */
+	if (procform->pronamespace != PG_CATALOG_NAMESPACE)
+	{
+		const char *schemaname;
+
+		schemaname = get_namespace_name(procform->pronamespace);
+		appendStringInfo(buf, "%s.", quote_identifier(schemaname));
+	}
+
+	appendStringInfo(buf, "%s(%s", quote_identifier(NameStr(procform->proname)),
+					 node->aggdistinct != NIL ? "DISTINCT " : "");
+
+	if (node->aggstar)
+		appendStringInfoChar(buf, '*');
+	else
+	{
+		first = true;
+		foreach(arg, node->args)
+		{
+			TargetEntry *tle = (TargetEntry *) lfirst(arg);
+
+			/* Skip any ORDER BY/DISTINCT columns that aren't arguments */
+			if (tle->resjunk)
+				continue;
+
+			if (!first)
+				appendStringInfoString(buf, ", ");
+			first = false;
+
+			deparseExpr(tle->expr, context);
+		}
+	}
+	appendStringInfoChar(buf, ')');
+
+	ReleaseSysCache(proctup);
+}
+
 /*
  * Print the representation of a parameter to be sent to the remote side.
  *
@@ -30,6 +30,7 @@
 #include "optimizer/planmain.h"
 #include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #include "optimizer/var.h"
 #include "parser/parsetree.h"
 #include "utils/builtins.h"
@@ -46,39 +47,14 @@ PG_MODULE_MAGIC;
 /* Default CPU cost to process 1 row (above and beyond cpu_tuple_cost). */
 #define DEFAULT_FDW_TUPLE_COST		0.01
 
-/*
- * FDW-specific planner information kept in RelOptInfo.fdw_private for a
- * foreign table.  This information is collected by postgresGetForeignRelSize.
- */
-typedef struct PgFdwRelationInfo
-{
-	/* baserestrictinfo clauses, broken down into safe and unsafe subsets. */
-	List	   *remote_conds;
-	List	   *local_conds;
+/* Default number of rows to retrieve per FETCH from a remote cursor. */
+#define DEFAULT_FETCH_SIZE			100
 
-	/* Bitmap of attr numbers we need to fetch from the remote server. */
-	Bitmapset  *attrs_used;
+/* Default number of rows to send per remote INSERT (1 means no batching). */
+#define DEFAULT_BATCH_SIZE			1
 
-	/* Cost and selectivity of local_conds. */
-	QualCost	local_conds_cost;
-	Selectivity local_conds_sel;
-
-	/* Estimated size and cost for a scan with baserestrictinfo quals. */
-	double		rows;
-	int			width;
-	Cost		startup_cost;
-	Cost		total_cost;
-
-	/* Options extracted from catalogs. */
-	bool		use_remote_estimate;
-	Cost		fdw_startup_cost;
-	Cost		fdw_tuple_cost;
-
-	/* Cached catalog information. */
-	ForeignTable *table;
-	ForeignServer *server;
-	UserMapping *user;			/* only set in use_remote_estimate mode */
-} PgFdwRelationInfo;
+/* Most parameters the remote server will accept in a single statement. */
+#define MAX_REMOTE_PARAMS			65535
 
 /*
  * Indexes of FDW-private information stored in fdw_private lists.
@@ -88,6 +64,8 @@ typedef struct PgFdwRelationInfo
  *
  * 1) SELECT statement text to be sent to the remote server
  * 2) Integer list of attribute numbers retrieved by the SELECT
+ * 3) String describing the relations scanned, for EXPLAIN; only present
+ *	  when the scan performs a join or an aggregation
  *
  * These items are indexed with the enum FdwScanPrivateIndex, so an item
  * can be fetched with list_nth().	For example, to get the SELECT statement:
@@ -98,7 +76,9 @@ enum FdwScanPrivateIndex
 	/* SQL statement to execute remotely (as a String node) */
 	FdwScanPrivateSelectSql,
 	/* Integer list of attribute numbers retrieved by the SELECT */
-	FdwScanPrivateRetrievedAttrs
+	FdwScanPrivateRetrievedAttrs,
+	/* Description of the join or aggregation (as a String node) */
+	FdwScanPrivateRelations
 };
 
 /*
@@ -110,6 +90,7 @@ enum FdwScanPrivateIndex
  *	  (NIL for a DELETE)
  * 3) Boolean flag showing if the remote query has a RETURNING clause
  * 4) Integer list of attribute numbers retrieved by RETURNING, if any
+ * 5) Number of rows to send per remote INSERT statement
  */
 enum FdwModifyPrivateIndex
 {
@@ -120,7 +101,9 @@ enum FdwModifyPrivateIndex
 	/* has-returning flag (as an integer Value node) */
 	FdwModifyPrivateHasReturning,
 	/* Integer list of attribute numbers retrieved by RETURNING */
-	FdwModifyPrivateRetrievedAttrs
+	FdwModifyPrivateRetrievedAttrs,
+	/* INSERT batch size (as an integer Value node) */
+	FdwModifyPrivateBatchSize
 };
 
 /*
@@ -128,7 +111,8 @@ enum FdwModifyPrivateIndex
  */
 typedef struct PgFdwScanState
 {
-	Relation	rel;			/* relcache entry for the foreign table */
+	Relation	rel;			/* relcache entry for the foreign table, or
+								 * NULL for a join or aggregation */
 	AttInMetadata *attinmeta;	/* attribute datatype conversion metadata */
 
 	/* extracted fdw_private data */
@@ -137,8 +121,10 @@ typedef struct PgFdwScanState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	unsigned int cursor_number; /* quasi-unique ID for my cursor */
 	bool		cursor_exists;	/* have we created the cursor? */
+	int			fetch_size;		/* number of rows per FETCH */
 	int			numParams;		/* number of parameters passed to query */
 	FmgrInfo   *param_flinfo;	/* output conversion functions for them */
 	List	   *param_exprs;	/* executable expressions for param values */
@@ -168,6 +154,7 @@ typedef struct PgFdwModifyState
 
 	/* for remote query execution */
 	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* extra per-connection state */
 	char	   *p_name;			/* name of prepared statement, if created */
 
 	/* extracted fdw_private data */
@@ -181,6 +168,13 @@ typedef struct PgFdwModifyState
 	int			p_nums;			/* number of parameters to transmit */
 	FmgrInfo   *p_flinfo;		/* output conversion functions for them */
 
+	/* for batching INSERTs */
+	int			batch_size;		/* number of rows per remote INSERT */
+	int			num_batched;	/* number of rows currently buffered */
+	const char **batch_values;	/* their parameters, p_nums per row */
+	char	   *batch_p_name;	/* prepared statement for a full batch */
+	MemoryContext batch_cxt;	/* context holding buffered parameters */
+
 	/* working memory context */
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 } PgFdwModifyState;
@@ -214,7 +208,7 @@ typedef struct PgFdwAnalyzeState
  */
 typedef struct ConversionLocation
 {
-	Relation	rel;			/* foreign table's relcache entry */
+	Relation	rel;			/* foreign table's relcache entry, or NULL */
 	AttrNumber	cur_attno;		/* attribute number being processed, or 0 */
 } ConversionLocation;
 
@@ -286,6 +280,17 @@ static void postgresExplainForeignModify(ModifyTableState *mtstate,
 static bool postgresAnalyzeForeignTable(Relation relation,
 							AcquireSampleRowsFunc *func,
 							BlockNumber *totalpages);
+static void postgresGetForeignJoinPaths(PlannerInfo *root,
+							RelOptInfo *joinrel,
+							RelOptInfo *outerrel,
+							RelOptInfo *innerrel,
+							JoinType jointype,
+							SpecialJoinInfo *sjinfo,
+							List *restrictlist);
+static ForeignScan *postgresGetForeignGroupingPlan(PlannerInfo *root,
+							   RelOptInfo *inputrel,
+							   List *tlist,
+							   double dNumGroups);
 
 /*
  * Helper functions
@@ -295,19 +300,34 @@ static void estimate_path_cost_size(PlannerInfo *root,
 						List *join_conds,
 						double *p_rows, int *p_width,
 						Cost *p_startup_cost, Cost *p_total_cost);
+static void estimate_remote_query_cost(PgFdwRelationInfo *fpinfo,
+						   const char *sql,
+						   double *p_rows, int *p_width,
+						   Cost *p_startup_cost, Cost *p_total_cost);
 static void get_remote_estimate(const char *sql,
 					PGconn *conn,
 					double *rows,
 					int *width,
 					Cost *startup_cost,
 					Cost *total_cost);
+static bool foreign_join_ok(PlannerInfo *root, RelOptInfo *joinrel,
+				JoinType jointype, RelOptInfo *outerrel,
+				RelOptInfo *innerrel, List *restrictlist);
+static List *build_tlist_from_vars(List *vars);
+static bool foreign_grouping_ok(PlannerInfo *root, RelOptInfo *inputrel,
+					List *tlist, List **scan_tlist, int *numGroupCols,
+					List **having);
 static bool ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 						  EquivalenceClass *ec, EquivalenceMember *em,
 						  void *arg);
+static int get_integer_option(ForeignServer *server, ForeignTable *table,
+				   const char *optname, int defval);
 static void create_cursor(ForeignScanState *node);
+static void begin_async_fetch(ForeignScanState *node);
 static void fetch_more_data(ForeignScanState *node);
 static void close_cursor(PGconn *conn, unsigned int cursor_number);
 static void prepare_foreign_modify(PgFdwModifyState *fmstate);
+static void flush_batched_inserts(PgFdwModifyState *fmstate);
 static const char **convert_prep_stmt_params(PgFdwModifyState *fmstate,
 						 ItemPointer tupleid,
 						 TupleTableSlot *slot);
@@ -363,6 +383,10 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	/* Support functions for ANALYZE */
 	routine->AnalyzeForeignTable = postgresAnalyzeForeignTable;
 
+	/* Functions for performing joins and aggregation remotely */
+	routine->GetForeignJoinPaths = postgresGetForeignJoinPaths;
+	routine->GetForeignGroupingPlan = postgresGetForeignGroupingPlan;
+
 	PG_RETURN_POINTER(routine);
 }
 
@@ -379,6 +403,8 @@ postgresGetForeignRelSize(PlannerInfo *root,
 						  Oid foreigntableid)
 {
 	PgFdwRelationInfo *fpinfo;
+	RangeTblEntry *rte = planner_rt_fetch(baserel->relid, root);
+	const char *relname;
 	ListCell   *lc;
 
 	/*
@@ -388,6 +414,9 @@ postgresGetForeignRelSize(PlannerInfo *root,
 	fpinfo = (PgFdwRelationInfo *) palloc0(sizeof(PgFdwRelationInfo));
 	baserel->fdw_private = (void *) fpinfo;
 
+	/* A foreign table can always be part of a remote join. */
+	fpinfo->pushdown_safe = true;
+
 	/* Look up foreign-table catalog info. */
 	fpinfo->table = GetForeignTable(foreigntableid);
 	fpinfo->server = GetForeignServer(fpinfo->table->serverid);
@@ -430,7 +459,6 @@ postgresGetForeignRelSize(PlannerInfo *root,
 	 */
 	if (fpinfo->use_remote_estimate)
 	{
-		RangeTblEntry *rte = planner_rt_fetch(baserel->relid, root);
 		Oid			userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
 
 		fpinfo->user = GetUserMapping(userid, fpinfo->server->serverid);
@@ -438,6 +466,20 @@ postgresGetForeignRelSize(PlannerInfo *root,
 	else
 		fpinfo->user = NULL;
 
+	/*
+	 * Set the name of the relation as EXPLAIN shows it for a remote join or
+	 * aggregation: the schema-qualified table name, followed by the alias if
+	 * there is one.
+	 */
+	fpinfo->relation_name = makeStringInfo();
+	relname = get_rel_name(foreigntableid);
+	appendStringInfo(fpinfo->relation_name, "%s.%s",
+					 quote_identifier(get_namespace_name(get_rel_namespace(foreigntableid))),
+					 quote_identifier(relname));
+	if (strcmp(relname, rte->eref->aliasname) != 0)
+		appendStringInfo(fpinfo->relation_name, " %s",
+						 quote_identifier(rte->eref->aliasname));
+
 	/*
 	 * Identify which baserestrictinfo clauses can be sent to the remote
 	 * server and which can't.
@@ -748,6 +790,46 @@ postgresGetForeignPlan(PlannerInfo *root,
 	StringInfoData sql;
 	ListCell   *lc;
 
+	/*
+	 * If we're planning a join performed remotely, the scan_clauses are
+	 * empty; all the conditions have been put in the remote query already.
+	 */
+	if (baserel->reloptkind == RELOPT_JOINREL)
+	{
+		ForeignScan *node;
+		List	   *fdw_scan_tlist;
+		int			i;
+
+		Assert(scan_relid == 0);
+
+		/*
+		 * The remote query retrieves the Vars the join has to emit, in the
+		 * order of the join's targetlist.  fdw_scan_tlist describes them.
+		 */
+		fdw_scan_tlist = build_tlist_from_vars(baserel->reltargetlist);
+
+		initStringInfo(&sql);
+		deparseSelectSqlForJoin(&sql, root, baserel, fdw_scan_tlist,
+								&params_list);
+
+		retrieved_attrs = NIL;
+		for (i = 1; i <= list_length(fdw_scan_tlist); i++)
+			retrieved_attrs = lappend_int(retrieved_attrs, i);
+
+		fdw_private = list_make3(makeString(sql.data),
+								 retrieved_attrs,
+								 makeString(fpinfo->relation_name->data));
+
+		node = make_foreignscan(tlist,
+								NIL,
+								scan_relid,
+								params_list,
+								fdw_private);
+		node->fdw_scan_tlist = fdw_scan_tlist;
+
+		return node;
+	}
+
 	/*
 	 * Separate the scan_clauses into those that can be executed remotely and
 	 * those that can't.  baserestrictinfo clauses that were previously
@@ -866,6 +948,416 @@ postgresGetForeignPlan(PlannerInfo *root,
 							fdw_private);
 }
 
+/*
+ * postgresGetForeignJoinPaths
+ *		Add a path performing the join of two relations on the remote server,
+ *		if both are on our server and the join can be shipped.
+ *
+ * We only consider this in use_remote_estimate mode: without EXPLAIN on the
+ * remote side we have no reasonable way to estimate the join's size and
+ * cost, and a badly estimated remote join could be much worse than a local
+ * one.
+ */
+static void
+postgresGetForeignJoinPaths(PlannerInfo *root,
+							RelOptInfo *joinrel,
+							RelOptInfo *outerrel,
+							RelOptInfo *innerrel,
+							JoinType jointype,
+							SpecialJoinInfo *sjinfo,
+							List *restrictlist)
+{
+	PgFdwRelationInfo *fpinfo;
+	ForeignPath *joinpath;
+	StringInfoData sql;
+	double		rows;
+	int			width;
+	Cost		startup_cost;
+	Cost		total_cost;
+
+	/*
+	 * Skip if this join combination has been considered already.  We build
+	 * just one remote path per join relation, from the first pair of input
+	 * relations we see; the remote planner will choose its own join order
+	 * anyway.
+	 */
+	if (joinrel->fdw_private)
+		return;
+
+	/*
+	 * Create the private state for the join relation.  Even if the join turns
+	 * out not to be shippable, it tells us not to look at this join relation
+	 * again.
+	 */
+	fpinfo = (PgFdwRelationInfo *) palloc0(sizeof(PgFdwRelationInfo));
+	fpinfo->pushdown_safe = false;
+	joinrel->fdw_private = fpinfo;
+
+	if (!foreign_join_ok(root, joinrel, jointype, outerrel, innerrel,
+						 restrictlist))
+		return;
+
+	/* Estimate the cost of the join by running EXPLAIN on the remote side */
+	initStringInfo(&sql);
+	appendStringInfoString(&sql, "EXPLAIN ");
+	deparseSelectSqlForJoin(&sql, root, joinrel,
+							build_tlist_from_vars(joinrel->reltargetlist),
+							NULL);
+	estimate_remote_query_cost(fpinfo, sql.data, &rows, &width,
+							   &startup_cost, &total_cost);
+
+	fpinfo->rows = rows;
+	fpinfo->width = width;
+	fpinfo->startup_cost = startup_cost;
+	fpinfo->total_cost = total_cost;
+
+	joinpath = create_foreignscan_path(root,
+									   joinrel,
+									   rows,
+									   startup_cost,
+									   total_cost,
+									   NIL,		/* no pathkeys */
+									   NULL,	/* no required_outer */
+									   NIL);	/* no fdw_private */
+	add_path(joinrel, (Path *) joinpath);
+}
+
+/*
+ * Check whether the join of outerrel and innerrel can be performed on the
+ * remote server, and if so fill in the join's PgFdwRelationInfo.
+ */
+static bool
+foreign_join_ok(PlannerInfo *root, RelOptInfo *joinrel, JoinType jointype,
+				RelOptInfo *outerrel, RelOptInfo *innerrel,
+				List *restrictlist)
+{
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) joinrel->fdw_private;
+	PgFdwRelationInfo *fpinfo_o = (PgFdwRelationInfo *) outerrel->fdw_private;
+	PgFdwRelationInfo *fpinfo_i = (PgFdwRelationInfo *) innerrel->fdw_private;
+	List	   *joinclauses = NIL;
+	List	   *otherclauses = NIL;
+	ListCell   *lc;
+
+	/* We support only the join types that can be written as SQL */
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_RIGHT && jointype != JOIN_FULL)
+		return false;
+
+	/* Both inputs must be scans or joins that we can ship */
+	if (!fpinfo_o || !fpinfo_o->pushdown_safe ||
+		!fpinfo_i || !fpinfo_i->pushdown_safe)
+		return false;
+
+	/* ... costed by the remote server, see postgresGetForeignJoinPaths */
+	if (!fpinfo_o->use_remote_estimate || !fpinfo_i->use_remote_estimate)
+		return false;
+
+	/*
+	 * ... and accessed as the same remote user, since the remote query runs
+	 * on a single connection.
+	 */
+	if (fpinfo_o->user->userid != fpinfo_i->user->userid)
+		return false;
+
+	/*
+	 * Conditions that must be evaluated locally would have to be applied
+	 * before the join, so they prevent pushing it down.
+	 */
+	if (fpinfo_o->local_conds || fpinfo_i->local_conds)
+		return false;
+
+	/* We can't supply the outer-relation Vars of a lateral reference */
+	if (!bms_is_empty(joinrel->lateral_relids))
+		return false;
+
+	/*
+	 * The remote query can only return plain columns of the tables; there's
+	 * no way to fetch a system column or a whole-row value of a joined table
+	 * with our simple deparser, nor to compute a placeholder.
+	 */
+	foreach(lc, joinrel->reltargetlist)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varattno <= 0)
+			return false;
+	}
+
+	/*
+	 * Every condition of the join must be shippable.  Separate the conditions
+	 * that belong in the ON clause from those that were pushed down from
+	 * above an outer join and so must be applied to its result.
+	 * Pseudoconstant quals are excluded, since they're expected to be
+	 * evaluated by a gating Result node that we wouldn't produce.
+	 */
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (rinfo->pseudoconstant ||
+			!is_foreign_expr(root, joinrel, rinfo->clause))
+			return false;
+
+		if (jointype == JOIN_INNER || !rinfo->is_pushed_down)
+			joinclauses = lappend(joinclauses, rinfo);
+		else
+			otherclauses = lappend(otherclauses, rinfo);
+	}
+
+	/*
+	 * Place the conditions already applied to the inputs.  Those on the
+	 * nullable side of an outer join go into the ON clause, others into the
+	 * WHERE clause.  For a full join, neither placement would be right.
+	 */
+	switch (jointype)
+	{
+		case JOIN_INNER:
+			fpinfo->remote_conds = list_concat(list_copy(fpinfo_o->remote_conds),
+											   fpinfo_i->remote_conds);
+			break;
+		case JOIN_LEFT:
+			joinclauses = list_concat(joinclauses,
+									  list_copy(fpinfo_i->remote_conds));
+			fpinfo->remote_conds = list_copy(fpinfo_o->remote_conds);
+			break;
+		case JOIN_RIGHT:
+			joinclauses = list_concat(joinclauses,
+									  list_copy(fpinfo_o->remote_conds));
+			fpinfo->remote_conds = list_copy(fpinfo_i->remote_conds);
+			break;
+		case JOIN_FULL:
+			if (fpinfo_o->remote_conds || fpinfo_i->remote_conds)
+				return false;
+			break;
+		default:
+			/* keep compiler quiet */
+			break;
+	}
+	fpinfo->remote_conds = list_concat(fpinfo->remote_conds, otherclauses);
+	fpinfo->local_conds = NIL;
+
+	fpinfo->outerrel = outerrel;
+	fpinfo->innerrel = innerrel;
+	fpinfo->jointype = jointype;
+	fpinfo->joinclauses = joinclauses;
+
+	/* The join is done with the settings of its inputs */
+	fpinfo->use_remote_estimate = true;
+	fpinfo->fdw_startup_cost = fpinfo_o->fdw_startup_cost;
+	fpinfo->fdw_tuple_cost = fpinfo_o->fdw_tuple_cost;
+	fpinfo->table = NULL;
+	fpinfo->server = fpinfo_o->server;
+	fpinfo->user = fpinfo_o->user;
+
+	/* Describe the join for EXPLAIN, eg "(ft1 a) LEFT JOIN (ft2 b)" */
+	fpinfo->relation_name = makeStringInfo();
+	appendStringInfo(fpinfo->relation_name, "(%s) %s JOIN (%s)",
+					 fpinfo_o->relation_name->data,
+					 jointype == JOIN_INNER ? "INNER" :
+					 jointype == JOIN_LEFT ? "LEFT" :
+					 jointype == JOIN_RIGHT ? "RIGHT" : "FULL",
+					 fpinfo_i->relation_name->data);
+
+	fpinfo->pushdown_safe = true;
+	return true;
+}
+
+/*
+ * Build a targetlist, numbered from 1, holding the given list of Vars.
+ */
+static List *
+build_tlist_from_vars(List *vars)
+{
+	List	   *tlist = NIL;
+	ListCell   *lc;
+
+	foreach(lc, vars)
+	{
+		Expr	   *var = (Expr *) lfirst(lc);
+
+		tlist = lappend(tlist, makeTargetEntry(copyObject(var),
+											   list_length(tlist) + 1,
+											   NULL,
+											   false));
+	}
+
+	return tlist;
+}
+
+/*
+ * postgresGetForeignGroupingPlan
+ *		Create a ForeignScan plan node that performs the query's grouping and
+ *		aggregation on the remote server, if that's possible.
+ *
+ * inputrel is the foreign table or remote join the query's rows come from.
+ * The plan we return must compute tlist, evaluating HAVING on the way.  As
+ * for joins, we only do this in use_remote_estimate mode; the planner picks
+ * our plan if it's cheaper than aggregating locally.
+ */
+static ForeignScan *
+postgresGetForeignGroupingPlan(PlannerInfo *root,
+							   RelOptInfo *inputrel,
+							   List *tlist,
+							   double dNumGroups)
+{
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) inputrel->fdw_private;
+	ForeignScan *node;
+	List	   *fdw_scan_tlist;
+	List	   *having;
+	List	   *params_list = NIL;
+	List	   *retrieved_attrs = NIL;
+	List	   *fdw_private;
+	int			numGroupCols;
+	StringInfoData sql;
+	StringInfoData relations;
+	double		rows;
+	int			width;
+	Cost		startup_cost;
+	Cost		total_cost;
+	int			i;
+
+	/* The input must be something we could push down, costed remotely */
+	if (!fpinfo || !fpinfo->pushdown_safe || !fpinfo->use_remote_estimate)
+		return NULL;
+
+	/* Conditions evaluated locally would have to precede the grouping */
+	if (fpinfo->local_conds)
+		return NULL;
+
+	if (!foreign_grouping_ok(root, inputrel, tlist, &fdw_scan_tlist,
+							 &numGroupCols, &having))
+		return NULL;
+
+	/* Estimate the cost of the remote query */
+	initStringInfo(&sql);
+	appendStringInfoString(&sql, "EXPLAIN ");
+	deparseSelectSqlForGrouping(&sql, root, inputrel, fdw_scan_tlist,
+								numGroupCols, having, NULL);
+	estimate_remote_query_cost(fpinfo, sql.data, &rows, &width,
+							   &startup_cost, &total_cost);
+
+	/* Now build the query to execute */
+	resetStringInfo(&sql);
+	deparseSelectSqlForGrouping(&sql, root, inputrel, fdw_scan_tlist,
+								numGroupCols, having, &params_list);
+
+	for (i = 1; i <= list_length(fdw_scan_tlist); i++)
+		retrieved_attrs = lappend_int(retrieved_attrs, i);
+
+	initStringInfo(&relations);
+	appendStringInfo(&relations, "Aggregate on (%s)",
+					 fpinfo->relation_name->data);
+
+	fdw_private = list_make3(makeString(sql.data),
+							 retrieved_attrs,
+							 makeString(relations.data));
+
+	/*
+	 * The ForeignScan computes the final tlist from the grouping expressions
+	 * and aggregates it retrieves; HAVING has been applied remotely.
+	 */
+	node = make_foreignscan(tlist, NIL, 0, params_list, fdw_private);
+	node->fdw_scan_tlist = fdw_scan_tlist;
+	node->fs_server = inputrel->serverid;
+	node->fs_relids = inputrel->relids;
+
+	node->scan.plan.startup_cost = startup_cost;
+	node->scan.plan.total_cost = total_cost;
+	node->scan.plan.plan_rows = rows;
+	node->scan.plan.plan_width = width;
+
+	return node;
+}
+
+/*
+ * Check whether the grouping and aggregation of the query can be performed
+ * on the remote server, on top of inputrel.
+ *
+ * If so, *scan_tlist receives the targetlist of the remote query: the
+ * grouping expressions, *numGroupCols of them, followed by the aggregates
+ * that tlist needs.  *having receives the HAVING conditions.
+ */
+static bool
+foreign_grouping_ok(PlannerInfo *root, RelOptInfo *inputrel, List *tlist,
+					List **scan_tlist, int *numGroupCols, List **having)
+{
+	Query	   *parse = root->parse;
+	List	   *grouping_tlist = NIL;
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	/*
+	 * The grouping expressions come first, so that GROUP BY can refer to them
+	 * by position.
+	 */
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+		Expr	   *expr = (Expr *) get_sortgroupclause_expr(sgc, tlist);
+
+		if (!is_foreign_expr(root, inputrel, expr))
+			return false;
+
+		grouping_tlist = lappend(grouping_tlist,
+								 makeTargetEntry(copyObject(expr),
+												 list_length(grouping_tlist) + 1,
+												 NULL,
+												 false));
+	}
+	result = list_copy(grouping_tlist);
+
+	/*
+	 * Each output column must be computable locally from what the remote
+	 * query returns: it has to be a grouping expression, or an expression
+	 * over aggregates and grouping columns.  The aggregates must be shippable.
+	 */
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+		List	   *exprs;
+		ListCell   *lc2;
+
+		if (tlist_member((Node *) tle->expr, grouping_tlist))
+			continue;
+
+		exprs = pull_var_clause((Node *) tle->expr,
+								PVC_INCLUDE_AGGREGATES,
+								PVC_INCLUDE_PLACEHOLDERS);
+		foreach(lc2, exprs)
+		{
+			Expr	   *expr = (Expr *) lfirst(lc2);
+
+			if (IsA(expr, Aggref))
+			{
+				if (!is_foreign_expr(root, inputrel, expr))
+					return false;
+
+				if (!tlist_member((Node *) expr, result))
+					result = lappend(result,
+									 makeTargetEntry(copyObject(expr),
+													 list_length(result) + 1,
+													 NULL,
+													 false));
+			}
+			else if (!tlist_member((Node *) expr, grouping_tlist))
+				return false;
+		}
+	}
+
+	/* HAVING must be evaluated remotely as a whole */
+	foreach(lc, (List *) parse->havingQual)
+	{
+		if (!is_foreign_expr(root, inputrel, (Expr *) lfirst(lc)))
+			return false;
+	}
+
+	*scan_tlist = result;
+	*numGroupCols = list_length(grouping_tlist);
+	*having = (List *) parse->havingQual;
+
+	return true;
+}
+
 /*
  * postgresBeginForeignScan
  *		Initiate an executor scan of a foreign PostgreSQL table.
@@ -876,6 +1368,7 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
 	EState	   *estate = node->ss.ps.state;
 	PgFdwScanState *fsstate;
+	Index		rtindex;
 	RangeTblEntry *rte;
 	Oid			userid;
 	ForeignTable *table;
@@ -899,27 +1392,45 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 
 	/*
 	 * Identify which user to do the remote access as.	This should match what
-	 * ExecCheckRTEPerms() does.
+	 * ExecCheckRTEPerms() does.  For a join or aggregation, the planner made
+	 * sure that all the relations involved use the same user mapping, so we
+	 * can look at any of them; use the lowest-numbered one.
 	 */
-	rte = rt_fetch(fsplan->scan.scanrelid, estate->es_range_table);
+	if (fsplan->scan.scanrelid > 0)
+		rtindex = fsplan->scan.scanrelid;
+	else
+		rtindex = bms_first_member(bms_copy(fsplan->fs_relids));
+	rte = rt_fetch(rtindex, estate->es_range_table);
 	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
 
-	/* Get info about foreign table. */
+	/* Get info about foreign table, if any, and server. */
 	fsstate->rel = node->ss.ss_currentRelation;
-	table = GetForeignTable(RelationGetRelid(fsstate->rel));
-	server = GetForeignServer(table->serverid);
+	if (fsstate->rel)
+	{
+		table = GetForeignTable(RelationGetRelid(fsstate->rel));
+		server = GetForeignServer(table->serverid);
+	}
+	else
+	{
+		table = NULL;
+		server = GetForeignServer(fsplan->fs_server);
+	}
 	user = GetUserMapping(userid, server->serverid);
 
 	/*
 	 * Get connection to the foreign server.  Connection manager will
 	 * establish new connection if necessary.
 	 */
-	fsstate->conn = GetConnection(server, user, false);
+	fsstate->conn = GetConnection(server, user, false, &fsstate->conn_state);
 
 	/* Assign a unique ID for my cursor */
 	fsstate->cursor_number = GetCursorNumber(fsstate->conn);
 	fsstate->cursor_exists = false;
 
+	/* A per-table fetch_size overrides the per-server setting. */
+	fsstate->fetch_size = get_integer_option(server, table, "fetch_size",
+											 DEFAULT_FETCH_SIZE);
+
 	/* Get private info created by planner functions. */
 	fsstate->query = strVal(list_nth(fsplan->fdw_private,
 									 FdwScanPrivateSelectSql));
@@ -938,8 +1449,14 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 											  ALLOCSET_SMALL_INITSIZE,
 											  ALLOCSET_SMALL_MAXSIZE);
 
-	/* Get info we'll need for input data conversion. */
-	fsstate->attinmeta = TupleDescGetAttInMetadata(RelationGetDescr(fsstate->rel));
+	/*
+	 * Get info we'll need for input data conversion.  For a join or
+	 * aggregation the result rows have the scan tuple's descriptor.
+	 */
+	if (fsstate->rel)
+		fsstate->attinmeta = TupleDescGetAttInMetadata(RelationGetDescr(fsstate->rel));
+	else
+		fsstate->attinmeta = TupleDescGetAttInMetadata(node->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
 
 	/* Prepare for output conversion of parameters used in remote query. */
 	numParams = list_length(fsplan->fdw_exprs);
@@ -977,6 +1494,19 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 		fsstate->param_values = (const char **) palloc0(numParams * sizeof(char *));
 	else
 		fsstate->param_values = NULL;
+
+	/*
+	 * If the query needs no parameters, we can open the cursor and ask for
+	 * the first batch of rows right away, without waiting for the answer.
+	 * The executor initializes all the children of an Append (or of a join)
+	 * before fetching from any of them, so when several foreign scans go to
+	 * different servers, the remote servers all start working concurrently
+	 * instead of one after the other.  Only one query can be in flight on a
+	 * connection, though; if another scan got there first, we'll create the
+	 * cursor at the first Iterate call as usual.
+	 */
+	if (numParams == 0 && fsstate->conn_state->pending_scan == NULL)
+		begin_async_fetch(node);
 }
 
 /*
@@ -1060,6 +1590,13 @@ postgresReScanForeignScan(ForeignScanState *node)
 		return;
 	}
 
+	/*
+	 * Any asynchronous request on the connection, including our own initial
+	 * fetch, must be completed before we can send another command.
+	 */
+	if (fsstate->conn_state->pending_scan)
+		process_pending_request(fsstate->conn_state->pending_scan);
+
 	/*
 	 * We don't use a PG_TRY block here, so be careful not to throw error
 	 * without releasing the PGresult.
@@ -1092,7 +1629,12 @@ postgresEndForeignScan(ForeignScanState *node)
 
 	/* Close the cursor if open, to prevent accumulation of cursors */
 	if (fsstate->cursor_exists)
+	{
+		/* Our initial fetch might still be in flight; collect it first */
+		if (fsstate->conn_state->pending_scan)
+			process_pending_request(fsstate->conn_state->pending_scan);
 		close_cursor(fsstate->conn, fsstate->cursor_number);
+	}
 
 	/* Release remote connection */
 	ReleaseConnection(fsstate->conn);
@@ -1162,6 +1704,8 @@ postgresPlanForeignModify(PlannerInfo *root,
 	List	   *targetAttrs = NIL;
 	List	   *returningList = NIL;
 	List	   *retrieved_attrs = NIL;
+	int			batch_size = 1;
+	List	   *result;
 
 	initStringInfo(&sql);
 
@@ -1236,16 +1780,39 @@ postgresPlanForeignModify(PlannerInfo *root,
 			break;
 	}
 
+	/*
+	 * An INSERT without RETURNING can buffer its rows and send them to the
+	 * remote server several at a time, as a single multi-row INSERT, if the
+	 * batch_size option asks for that.  We can't do it if there are local
+	 * AFTER triggers, since they'd run before the rows are sent.  Also keep
+	 * the batch within the number of parameters a remote statement can have.
+	 */
+	if (operation == CMD_INSERT && retrieved_attrs == NIL &&
+		targetAttrs != NIL &&
+		!(rel->trigdesc &&
+		  (rel->trigdesc->trig_insert_after_row ||
+		   rel->trigdesc->trig_insert_after_statement)))
+	{
+		ForeignTable *table = GetForeignTable(RelationGetRelid(rel));
+		ForeignServer *server = GetForeignServer(table->serverid);
+
+		batch_size = get_integer_option(server, table, "batch_size",
+										DEFAULT_BATCH_SIZE);
+		batch_size = Min(batch_size,
+						 MAX_REMOTE_PARAMS / list_length(targetAttrs));
+	}
+
 	heap_close(rel, NoLock);
 
 	/*
 	 * Build the fdw_private list that will be available to the executor.
 	 * Items in the list must match enum FdwModifyPrivateIndex, above.
 	 */
-	return list_make4(makeString(sql.data),
-					  targetAttrs,
-					  makeInteger((retrieved_attrs != NIL)),
-					  retrieved_attrs);
+	result = list_make4(makeString(sql.data),
+						targetAttrs,
+						makeInteger((retrieved_attrs != NIL)),
+						retrieved_attrs);
+	return lappend(result, makeInteger(batch_size));
 }
 
 /*
@@ -1297,7 +1864,7 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 	user = GetUserMapping(userid, server->serverid);
 
 	/* Open connection; report that we'll create a prepared statement. */
-	fmstate->conn = GetConnection(server, user, true);
+	fmstate->conn = GetConnection(server, user, true, &fmstate->conn_state);
 	fmstate->p_name = NULL;		/* prepared statement not made yet */
 
 	/* Deconstruct fdw_private data. */
@@ -1309,6 +1876,8 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 											 FdwModifyPrivateHasReturning));
 	fmstate->retrieved_attrs = (List *) list_nth(fdw_private,
 											 FdwModifyPrivateRetrievedAttrs);
+	fmstate->batch_size = intVal(list_nth(fdw_private,
+										  FdwModifyPrivateBatchSize));
 
 	/* Create context for per-tuple temp workspace. */
 	fmstate->temp_cxt = AllocSetContextCreate(estate->es_query_cxt,
@@ -1360,6 +1929,20 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 
 	Assert(fmstate->p_nums <= n_params);
 
+	/* Set up buffer for the parameters of batched INSERTs, if any. */
+	if (fmstate->batch_size > 1)
+	{
+		fmstate->num_batched = 0;
+		fmstate->batch_values = (const char **)
+			palloc0(sizeof(char *) * fmstate->batch_size * fmstate->p_nums);
+		fmstate->batch_p_name = NULL;
+		fmstate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
+												   "postgres_fdw batch data",
+												   ALLOCSET_DEFAULT_MINSIZE,
+												   ALLOCSET_DEFAULT_INITSIZE,
+												   ALLOCSET_DEFAULT_MAXSIZE);
+	}
+
 	resultRelInfo->ri_FdwState = fmstate;
 }
 
@@ -1378,6 +1961,34 @@ postgresExecForeignInsert(EState *estate,
 	PGresult   *res;
 	int			n_rows;
 
+	/*
+	 * When batching, just add the row's parameters to the buffer, and send
+	 * the rows once there are enough of them.  We have to assume that the
+	 * remote server will insert the row.
+	 */
+	if (fmstate->batch_size > 1)
+	{
+		const char **batch_values;
+		MemoryContext oldcontext;
+		int			i;
+
+		p_values = convert_prep_stmt_params(fmstate, NULL, slot);
+
+		batch_values = fmstate->batch_values +
+			fmstate->num_batched * fmstate->p_nums;
+		oldcontext = MemoryContextSwitchTo(fmstate->batch_cxt);
+		for (i = 0; i < fmstate->p_nums; i++)
+			batch_values[i] = p_values[i] ? pstrdup(p_values[i]) : NULL;
+		MemoryContextSwitchTo(oldcontext);
+
+		MemoryContextReset(fmstate->temp_cxt);
+
+		if (++fmstate->num_batched == fmstate->batch_size)
+			flush_batched_inserts(fmstate);
+
+		return slot;
+	}
+
 	/* Set up the prepared statement on the remote server, if we didn't yet */
 	if (!fmstate->p_name)
 		prepare_foreign_modify(fmstate);
@@ -1385,6 +1996,10 @@ postgresExecForeignInsert(EState *estate,
 	/* Convert parameters needed by prepared statement to text form */
 	p_values = convert_prep_stmt_params(fmstate, NULL, slot);
 
+	/* Collect any scan's asynchronous fetch on the connection first */
+	if (fmstate->conn_state->pending_scan)
+		process_pending_request(fmstate->conn_state->pending_scan);
+
 	/*
 	 * Execute the prepared statement, and check for success.
 	 *
@@ -1455,6 +2070,10 @@ postgresExecForeignUpdate(EState *estate,
 										(ItemPointer) DatumGetPointer(datum),
 										slot);
 
+	/* Collect any scan's asynchronous fetch on the connection first */
+	if (fmstate->conn_state->pending_scan)
+		process_pending_request(fmstate->conn_state->pending_scan);
+
 	/*
 	 * Execute the prepared statement, and check for success.
 	 *
@@ -1525,6 +2144,10 @@ postgresExecForeignDelete(EState *estate,
 										(ItemPointer) DatumGetPointer(datum),
 										NULL);
 
+	/* Collect any scan's asynchronous fetch on the connection first */
+	if (fmstate->conn_state->pending_scan)
+		process_pending_request(fmstate->conn_state->pending_scan);
+
 	/*
 	 * Execute the prepared statement, and check for success.
 	 *
@@ -1575,6 +2198,13 @@ postgresEndForeignModify(EState *estate,
 	if (fmstate == NULL)
 		return;
 
+	/* Send any rows still waiting in the INSERT batch */
+	if (fmstate->batch_size > 1)
+		flush_batched_inserts(fmstate);
+
+	if (fmstate->conn_state->pending_scan)
+		process_pending_request(fmstate->conn_state->pending_scan);
+
 	/* If we created a prepared statement, destroy it */
 	if (fmstate->p_name)
 	{
@@ -1594,6 +2224,21 @@ postgresEndForeignModify(EState *estate,
 		fmstate->p_name = NULL;
 	}
 
+	/* Likewise for the statement used for batched INSERTs */
+	if (fmstate->batch_p_name)
+	{
+		char		sql[64];
+		PGresult   *res;
+
+		snprintf(sql, sizeof(sql), "DEALLOCATE %s", fmstate->batch_p_name);
+
+		res = PQexec(fmstate->conn, sql);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pgfdw_report_error(ERROR, res, fmstate->conn, true, sql);
+		PQclear(res);
+		fmstate->batch_p_name = NULL;
+	}
+
 	/* Release remote connection */
 	ReleaseConnection(fmstate->conn);
 	fmstate->conn = NULL;
@@ -1654,9 +2299,19 @@ postgresExplainForeignScan(ForeignScanState *node, ExplainState *es)
 	List	   *fdw_private;
 	char	   *sql;
 
+	fdw_private = ((ForeignScan *) node->ss.ps.plan)->fdw_private;
+
+	/* For a join or aggregation, show what's being done remotely */
+	if (list_length(fdw_private) > FdwScanPrivateRelations)
+	{
+		char	   *relations;
+
+		relations = strVal(list_nth(fdw_private, FdwScanPrivateRelations));
+		ExplainPropertyText("Relations", relations, es);
+	}
+
 	if (es->verbose)
 	{
-		fdw_private = ((ForeignScan *) node->ss.ps.plan)->fdw_private;
 		sql = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
 		ExplainPropertyText("Remote SQL", sql, es);
 	}
@@ -1678,7 +2333,12 @@ postgresExplainForeignModify(ModifyTableState *mtstate,
 		char	   *sql = strVal(list_nth(fdw_private,
 										  FdwModifyPrivateUpdateSql));
 
+		int			batch_size = intVal(list_nth(fdw_private,
+												 FdwModifyPrivateBatchSize));
+
 		ExplainPropertyText("Remote SQL", sql, es);
+		if (batch_size > 1)
+			ExplainPropertyInteger("Batch Size", batch_size, es);
 	}
 }
 
@@ -1747,7 +2407,7 @@ estimate_path_cost_size(PlannerInfo *root,
 							  (fpinfo->remote_conds == NIL), NULL);
 
 		/* Get the remote estimate */
-		conn = GetConnection(fpinfo->server, fpinfo->user, false);
+		conn = GetConnection(fpinfo->server, fpinfo->user, false, NULL);
 		get_remote_estimate(sql.data, conn, &rows, &width,
 							&startup_cost, &total_cost);
 		ReleaseConnection(conn);
@@ -1824,6 +2484,37 @@ estimate_path_cost_size(PlannerInfo *root,
 	*p_total_cost = total_cost;
 }
 
+/*
+ * Estimate the size and cost of a remote join or aggregation, whose query
+ * is given as an EXPLAIN command in "sql".  As in estimate_path_cost_size,
+ * we add the costs of starting up the query and transferring its rows.
+ */
+static void
+estimate_remote_query_cost(PgFdwRelationInfo *fpinfo, const char *sql,
+						   double *p_rows, int *p_width,
+						   Cost *p_startup_cost, Cost *p_total_cost)
+{
+	PGconn	   *conn;
+	double		rows;
+	int			width;
+	Cost		startup_cost;
+	Cost		total_cost;
+
+	conn = GetConnection(fpinfo->server, fpinfo->user, false, NULL);
+	get_remote_estimate(sql, conn, &rows, &width,
+						&startup_cost, &total_cost);
+	ReleaseConnection(conn);
+
+	startup_cost += fpinfo->fdw_startup_cost;
+	total_cost += fpinfo->fdw_startup_cost;
+	total_cost += (fpinfo->fdw_tuple_cost + cpu_tuple_cost) * rows;
+
+	*p_rows = rows;
+	*p_width = width;
+	*p_startup_cost = startup_cost;
+	*p_total_cost = total_cost;
+}
+
 /*
  * Estimate costs of executing a SQL statement remotely.
  * The given "sql" must be an EXPLAIN command.
@@ -1906,6 +2597,40 @@ ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * Get the value of an integer-valued option such as fetch_size.  A per-table
+ * setting overrides the per-server one; table may be NULL for a scan that
+ * isn't of a single foreign table.  The validator has already checked that
+ * the values are sane.
+ */
+static int
+get_integer_option(ForeignServer *server, ForeignTable *table,
+				   const char *optname, int defval)
+{
+	int			result = defval;
+	ListCell   *lc;
+
+	foreach(lc, server->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, optname) == 0)
+			result = (int) strtol(defGetString(def), NULL, 10);
+	}
+	if (table)
+	{
+		foreach(lc, table->options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, optname) == 0)
+				result = (int) strtol(defGetString(def), NULL, 10);
+		}
+	}
+
+	return result;
+}
+
 /*
  * Create cursor for node's query with current parameter values.
  */
@@ -1920,6 +2645,10 @@ create_cursor(ForeignScanState *node)
 	StringInfoData buf;
 	PGresult   *res;
 
+	/* Another scan's asynchronous fetch must be collected first */
+	if (fsstate->conn_state->pending_scan)
+		process_pending_request(fsstate->conn_state->pending_scan);
+
 	/*
 	 * Construct array of query parameter values in text format.  We do the
 	 * conversions in the short-lived per-tuple context, so as not to cause a
@@ -1996,8 +2725,64 @@ create_cursor(ForeignScanState *node)
 	pfree(buf.data);
 }
 
+/*
+ * Send the commands that create the node's cursor and fetch its first batch
+ * of rows, without waiting for the result.  The node becomes the connection's
+ * pending scan; fetch_more_data collects the result.  This is used only for
+ * queries without parameters.
+ */
+static void
+begin_async_fetch(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PGconn	   *conn = fsstate->conn;
+	StringInfoData buf;
+
+	Assert(fsstate->numParams == 0);
+	Assert(fsstate->conn_state->pending_scan == NULL);
+
+	initStringInfo(&buf);
+	appendStringInfo(&buf, "DECLARE c%u CURSOR FOR\n%s; FETCH %d FROM c%u",
+					 fsstate->cursor_number, fsstate->query,
+					 fsstate->fetch_size, fsstate->cursor_number);
+
+	if (!PQsendQuery(conn, buf.data))
+		pgfdw_report_error(ERROR, NULL, conn, false, fsstate->query);
+
+	fsstate->conn_state->pending_scan = node;
+
+	/* The cursor will exist by the time anybody looks at the result */
+	fsstate->cursor_exists = true;
+	fsstate->tuples = NULL;
+	fsstate->num_tuples = 0;
+	fsstate->next_tuple = 0;
+	fsstate->fetch_ct_2 = 0;
+	fsstate->eof_reached = false;
+
+	pfree(buf.data);
+}
+
+/*
+ * Complete the asynchronous fetch in flight for the given scan node, storing
+ * the rows in its state.  Other users of the connection call this before
+ * sending commands of their own.
+ */
+void
+process_pending_request(ForeignScanState *node)
+{
+	PgFdwScanState *fsstate PG_USED_FOR_ASSERTS_ONLY =
+	(PgFdwScanState *) node->fdw_state;
+
+	Assert(fsstate->conn_state->pending_scan == node);
+
+	fetch_more_data(node);
+}
+
 /*
  * Fetch some more rows from the node's cursor.
+ *
+ * If the node has an asynchronous fetch in flight, this collects its result
+ * instead of sending a new FETCH.
  */
 static void
 fetch_more_data(ForeignScanState *node)
@@ -2019,17 +2804,46 @@ fetch_more_data(ForeignScanState *node)
 	{
 		PGconn	   *conn = fsstate->conn;
 		char		sql[64];
-		int			fetch_size;
 		int			numrows;
 		int			i;
 
-		/* The fetch size is arbitrary, but shouldn't be enormous. */
-		fetch_size = 100;
+		if (fsstate->conn_state->pending_scan == node)
+		{
+			PGresult   *extra;
 
-		snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
-				 fetch_size, fsstate->cursor_number);
+			/*
+			 * Collect the results of the DECLARE and the FETCH sent by
+			 * begin_async_fetch.  The request is over whatever happens, so
+			 * forget about it first.  If the DECLARE failed, the server
+			 * skipped the FETCH, but we still have to drain the results
+			 * before the connection can be used again.
+			 */
+			fsstate->conn_state->pending_scan = NULL;
 
-		res = PQexec(conn, sql);
+			res = PQgetResult(conn);
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			{
+				while ((extra = PQgetResult(conn)) != NULL)
+					PQclear(extra);
+				pgfdw_report_error(ERROR, res, conn, false, fsstate->query);
+			}
+			PQclear(res);
+
+			res = PQgetResult(conn);
+			while ((extra = PQgetResult(conn)) != NULL)
+				PQclear(extra);
+		}
+		else
+		{
+			/* Another scan's fetch must be collected before we send ours. */
+			if (fsstate->conn_state->pending_scan)
+				process_pending_request(fsstate->conn_state->pending_scan);
+
+			snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
+					 fsstate->fetch_size, fsstate->cursor_number);
+
+			res = PQexec(conn, sql);
+		}
 		/* On error, report the original query, not the FETCH. */
 		if (PQresultStatus(res) != PGRES_TUPLES_OK)
 			pgfdw_report_error(ERROR, res, conn, false, fsstate->query);
@@ -2055,7 +2869,7 @@ fetch_more_data(ForeignScanState *node)
 			fsstate->fetch_ct_2++;
 
 		/* Must be EOF if we didn't get as many tuples as we asked for. */
-		fsstate->eof_reached = (numrows < fetch_size);
+		fsstate->eof_reached = (numrows < fsstate->fetch_size);
 
 		PQclear(res);
 		res = NULL;
@@ -2153,6 +2967,10 @@ prepare_foreign_modify(PgFdwModifyState *fmstate)
 	char	   *p_name;
 	PGresult   *res;
 
+	/* Collect any scan's asynchronous fetch on the connection first */
+	if (fmstate->conn_state->pending_scan)
+		process_pending_request(fmstate->conn_state->pending_scan);
+
 	/* Construct name we'll use for the prepared statement. */
 	snprintf(prep_name, sizeof(prep_name), "pgsql_fdw_prep_%u",
 			 GetPrepStmtNumber(fmstate->conn));
@@ -2182,6 +3000,85 @@ prepare_foreign_modify(PgFdwModifyState *fmstate)
 	fmstate->p_name = p_name;
 }
 
+/*
+ * flush_batched_inserts
+ *		Send the INSERT batch buffered in fmstate to the remote server
+ *
+ * A full batch uses a prepared multi-row INSERT, set up on first use; the
+ * final, partial batch is sent as a one-off statement.
+ */
+static void
+flush_batched_inserts(PgFdwModifyState *fmstate)
+{
+	int			nrows = fmstate->num_batched;
+	StringInfoData sql;
+	PGresult   *res;
+
+	if (nrows == 0)
+		return;
+
+	/* Collect any scan's asynchronous fetch on the connection first */
+	if (fmstate->conn_state->pending_scan)
+		process_pending_request(fmstate->conn_state->pending_scan);
+
+	/*
+	 * We intentionally do not specify parameter types, as in
+	 * prepare_foreign_modify.
+	 *
+	 * We don't use a PG_TRY block here, so be careful not to throw error
+	 * without releasing the PGresult.
+	 */
+	if (nrows == fmstate->batch_size)
+	{
+		if (!fmstate->batch_p_name)
+		{
+			char		prep_name[NAMEDATALEN];
+
+			snprintf(prep_name, sizeof(prep_name), "pgsql_fdw_prep_%u",
+					 GetPrepStmtNumber(fmstate->conn));
+
+			initStringInfo(&sql);
+			rebuildInsertSql(&sql, fmstate->query, fmstate->p_nums, nrows);
+			res = PQprepare(fmstate->conn, prep_name, sql.data, 0, NULL);
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+				pgfdw_report_error(ERROR, res, fmstate->conn, true, sql.data);
+			PQclear(res);
+			pfree(sql.data);
+
+			fmstate->batch_p_name = pstrdup(prep_name);
+		}
+
+		res = PQexecPrepared(fmstate->conn,
+							 fmstate->batch_p_name,
+							 nrows * fmstate->p_nums,
+							 fmstate->batch_values,
+							 NULL,
+							 NULL,
+							 0);
+	}
+	else
+	{
+		initStringInfo(&sql);
+		rebuildInsertSql(&sql, fmstate->query, fmstate->p_nums, nrows);
+		res = PQexecParams(fmstate->conn,
+						   sql.data,
+						   nrows * fmstate->p_nums,
+						   NULL,
+						   fmstate->batch_values,
+						   NULL,
+						   NULL,
+						   0);
+		pfree(sql.data);
+	}
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pgfdw_report_error(ERROR, res, fmstate->conn, true, fmstate->query);
+	PQclear(res);
+
+	/* The buffer is empty again */
+	fmstate->num_batched = 0;
+	MemoryContextReset(fmstate->batch_cxt);
+}
+
 /*
  * convert_prep_stmt_params
  *		Create array of text strings representing parameter values
@@ -2312,7 +3209,7 @@ postgresAnalyzeForeignTable(Relation relation,
 	table = GetForeignTable(RelationGetRelid(relation));
 	server = GetForeignServer(table->serverid);
 	user = GetUserMapping(relation->rd_rel->relowner, server->serverid);
-	conn = GetConnection(server, user, false);
+	conn = GetConnection(server, user, false, NULL);
 
 	/*
 	 * Construct command to get page count for relation.
@@ -2375,6 +3272,7 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 	UserMapping *user;
 	PGconn	   *conn;
 	unsigned int cursor_number;
+	int			fetch_size;
 	StringInfoData sql;
 	PGresult   *volatile res = NULL;
 
@@ -2404,7 +3302,11 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 	table = GetForeignTable(RelationGetRelid(relation));
 	server = GetForeignServer(table->serverid);
 	user = GetUserMapping(relation->rd_rel->relowner, server->serverid);
-	conn = GetConnection(server, user, false);
+	conn = GetConnection(server, user, false, NULL);
+
+	/* Use the table's fetch_size, if any, for the sampling cursor too. */
+	fetch_size = get_integer_option(server, table, "fetch_size",
+									DEFAULT_FETCH_SIZE);
 
 	/*
 	 * Construct cursor that retrieves whole rows from remote.
@@ -2427,7 +3329,6 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 		for (;;)
 		{
 			char		fetch_sql[64];
-			int			fetch_size;
 			int			numrows;
 			int			i;
 
@@ -2440,9 +3341,6 @@ postgresAcquireSampleRowsFunc(Relation relation, int elevel,
 			 * then just adjust rowstoskip and samplerows appropriately.
 			 */
 
-			/* The fetch size is arbitrary, but shouldn't be enormous. */
-			fetch_size = 100;
-
 			/* Fetch some rows */
 			snprintf(fetch_sql, sizeof(fetch_sql), "FETCH %d FROM c%u",
 					 fetch_size, cursor_number);
@@ -2581,7 +3479,7 @@ make_tuple_from_result_row(PGresult *res,
 						   MemoryContext temp_context)
 {
 	HeapTuple	tuple;
-	TupleDesc	tupdesc = RelationGetDescr(rel);
+	TupleDesc	tupdesc;
 	Datum	   *values;
 	bool	   *nulls;
 	ItemPointer ctid = NULL;
@@ -2593,6 +3491,15 @@ make_tuple_from_result_row(PGresult *res,
 
 	Assert(row < PQntuples(res));
 
+	/*
+	 * For a join or aggregation there's no relation; the tuple descriptor is
+	 * that of the scan's target list.
+	 */
+	if (rel)
+		tupdesc = RelationGetDescr(rel);
+	else
+		tupdesc = attinmeta->tupdesc;
+
 	/*
 	 * Do the following work in a temp context that we reset after each tuple.
 	 * This cleans up not only the data we have direct access to, but any
@@ -2693,8 +3600,18 @@ static void
 conversion_error_callback(void *arg)
 {
 	ConversionLocation *errpos = (ConversionLocation *) arg;
-	TupleDesc	tupdesc = RelationGetDescr(errpos->rel);
+	TupleDesc	tupdesc;
+
+	/* For a join or aggregation, we can only report the column position */
+	if (errpos->rel == NULL)
+	{
+		if (errpos->cur_attno > 0)
+			errcontext("processing expression at position %d in select list",
+					   errpos->cur_attno);
+		return;
+	}
 
+	tupdesc = RelationGetDescr(errpos->rel);
 	if (errpos->cur_attno > 0 && errpos->cur_attno <= tupdesc->natts)
 		errcontext("column \"%s\" of foreign table \"%s\"",
 				   NameStr(tupdesc->attrs[errpos->cur_attno - 1]->attname),
@@ -15,18 +15,91 @@
 
 #include "foreign/foreign.h"
 #include "lib/stringinfo.h"
+#include "nodes/execnodes.h"
 #include "nodes/relation.h"
 #include "utils/rel.h"
 
 #include "libpq-fe.h"
 
+/*
+ * FDW-specific planner information kept in RelOptInfo.fdw_private for a
+ * foreign table or a join of foreign tables.  For a foreign table this
+ * information is collected by postgresGetForeignRelSize, for a join by
+ * postgresGetForeignJoinPaths.
+ */
+typedef struct PgFdwRelationInfo
+{
+	/*
+	 * True means the relation can be pushed down to the remote server, as
+	 * part of a join or an aggregation.  Always true for a foreign table.
+	 */
+	bool		pushdown_safe;
+
+	/*
+	 * Restriction clauses, broken down into safe and unsafe subsets.  For a
+	 * join, remote_conds holds the conditions to put in the WHERE clause of
+	 * the remote query, and local_conds is always empty.
+	 */
+	List	   *remote_conds;
+	List	   *local_conds;
+
+	/* Bitmap of attr numbers we need to fetch from the remote server. */
+	Bitmapset  *attrs_used;
+
+	/* Cost and selectivity of local_conds. */
+	QualCost	local_conds_cost;
+	Selectivity local_conds_sel;
+
+	/* Estimated size and cost for a scan with baserestrictinfo quals. */
+	double		rows;
+	int			width;
+	Cost		startup_cost;
+	Cost		total_cost;
+
+	/* Options extracted from catalogs. */
+	bool		use_remote_estimate;
+	Cost		fdw_startup_cost;
+	Cost		fdw_tuple_cost;
+
+	/* Cached catalog information. */
+	ForeignTable *table;		/* NULL for a join */
+	ForeignServer *server;
+	UserMapping *user;			/* only set in use_remote_estimate mode */
+
+	/* Name of the relation as shown by EXPLAIN */
+	StringInfo	relation_name;
+
+	/* Join information; only set for a join */
+	RelOptInfo *outerrel;
+	RelOptInfo *innerrel;
+	JoinType	jointype;
+	List	   *joinclauses;	/* conditions for the ON clause */
+} PgFdwRelationInfo;
+
+/*
+ * Extra control information relating to a connection, shared by everything
+ * using it.
+ *
+ * A foreign scan may send the commands that open its cursor and fetch the
+ * first rows without waiting for the result, so that scans of several
+ * servers proceed concurrently.  While such a request is in flight, nothing
+ * else can be sent on the connection; anyone wanting to use it must first
+ * call process_pending_request on pending_scan.
+ */
+typedef struct PgFdwConnState
+{
+	ForeignScanState *pending_scan; /* scan with a request in flight, or
+									 * NULL */
+} PgFdwConnState;
+
 /* in postgres_fdw.c */
 extern int	set_transmission_modes(void);
 extern void reset_transmission_modes(int nestlevel);
+extern void process_pending_request(ForeignScanState *node);
 
 /* in connection.c */
 extern PGconn *GetConnection(ForeignServer *server, UserMapping *user,
-			  bool will_prep_stmt);
+			  bool will_prep_stmt, PgFdwConnState **state);
 extern void ReleaseConnection(PGconn *conn);
 extern unsigned int GetCursorNumber(PGconn *conn);
 extern unsigned int GetPrepStmtNumber(PGconn *conn);
@@ -52,6 +125,18 @@ extern void deparseSelectSql(StringInfo buf,
 				 RelOptInfo *baserel,
 				 Bitmapset *attrs_used,
 				 List **retrieved_attrs);
+extern void deparseSelectSqlForJoin(StringInfo buf,
+						PlannerInfo *root,
+						RelOptInfo *joinrel,
+						List *tlist,
+						List **params_list);
+extern void deparseSelectSqlForGrouping(StringInfo buf,
+							PlannerInfo *root,
+							RelOptInfo *inputrel,
+							List *tlist,
+							int numGroupCols,
+							List *having,
+							List **params_list);
 extern void appendWhereClause(StringInfo buf,
 				  PlannerInfo *root,
 				  RelOptInfo *baserel,
@@ -66,6 +151,8 @@ extern void deparseUpdateSql(StringInfo buf, PlannerInfo *root,
 				 Index rtindex, Relation rel,
 				 List *targetAttrs, List *returningList,
 				 List **retrieved_attrs);
+extern void rebuildInsertSql(StringInfo buf, const char *orig_query,
+				 int num_params, int num_rows);
 extern void deparseDeleteSql(StringInfo buf, PlannerInfo *root,
 				 Index rtindex, Relation rel,
 				 List *returningList,
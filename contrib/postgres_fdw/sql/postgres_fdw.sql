@@ -91,6 +91,8 @@ ALTER SERVER testserver1 OPTIONS (
 	updatable 'true',
 	fdw_startup_cost '123.456',
 	fdw_tuple_cost '0.123',
+	fetch_size '100',
+	batch_size '1',
 	service 'value',
 	connect_timeout 'value',
 	dbname 'value',
@@ -190,16 +192,33 @@ EXPLAIN (VERBOSE, COSTS false) SELECT * FROM ft1 t1 WHERE c1 = ANY(ARRAY[c2, 1,
 EXPLAIN (VERBOSE, COSTS false) SELECT * FROM ft1 t1 WHERE c1 = (ARRAY[c1,c2,3])[1]; -- ArrayRef
 EXPLAIN (VERBOSE, COSTS false) SELECT * FROM ft1 t1 WHERE c6 = E'foo''s\\bar';  -- check special chars
 EXPLAIN (VERBOSE, COSTS false) SELECT * FROM ft1 t1 WHERE c8 = 'foo';  -- can't be sent to remote
--- parameterized remote path
+-- parameterized remote path (ft1 is not in remote-estimate mode, so the
+-- join itself is not pushed down)
 EXPLAIN (VERBOSE, COSTS false)
-  SELECT * FROM ft2 a, ft2 b WHERE a.c1 = 47 AND b.c1 = a.c2;
-SELECT * FROM ft2 a, ft2 b WHERE a.c1 = 47 AND b.c1 = a.c2;
+  SELECT * FROM ft1 a, ft2 b WHERE a.c1 = 47 AND b.c1 = a.c2;
+SELECT * FROM ft1 a, ft2 b WHERE a.c1 = 47 AND b.c1 = a.c2;
 -- check both safe and unsafe join conditions
 EXPLAIN (VERBOSE, COSTS false)
   SELECT * FROM ft2 a, ft2 b
   WHERE a.c2 = 6 AND b.c1 = a.c1 AND a.c8 = 'foo' AND b.c7 = upper(a.c7);
 SELECT * FROM ft2 a, ft2 b
 WHERE a.c2 = 6 AND b.c1 = a.c1 AND a.c8 = 'foo' AND b.c7 = upper(a.c7);
+-- joins and aggregates of tables in remote-estimate mode are done remotely
+EXPLAIN (VERBOSE, COSTS false)
+  SELECT * FROM ft2 a, ft2 b WHERE a.c1 = 47 AND b.c1 = a.c2;
+SELECT * FROM ft2 a, ft2 b WHERE a.c1 = 47 AND b.c1 = a.c2;
+EXPLAIN (VERBOSE, COSTS false)
+  SELECT a.c1, b.c3 FROM ft2 a JOIN ft2 b ON (a.c1 = b.c1) WHERE a.c1 < 4 ORDER BY a.c1;
+SELECT a.c1, b.c3 FROM ft2 a JOIN ft2 b ON (a.c1 = b.c1) WHERE a.c1 < 4 ORDER BY a.c1;
+EXPLAIN (VERBOSE, COSTS false)
+  SELECT a.c1, b.c1 FROM ft2 a LEFT JOIN ft2 b ON (a.c1 = b.c2 AND b.c1 > 990) WHERE a.c1 < 3 ORDER BY a.c1, b.c1;
+SELECT a.c1, b.c1 FROM ft2 a LEFT JOIN ft2 b ON (a.c1 = b.c2 AND b.c1 > 990) WHERE a.c1 < 3 ORDER BY a.c1, b.c1;
+EXPLAIN (VERBOSE, COSTS false)
+  SELECT c2, count(*), sum(c1) FROM ft2 GROUP BY c2 HAVING sum(c1) > 50000 ORDER BY c2;
+SELECT c2, count(*), sum(c1) FROM ft2 GROUP BY c2 HAVING sum(c1) > 50000 ORDER BY c2;
+EXPLAIN (VERBOSE, COSTS false)
+  SELECT count(*), sum(b.c1) FROM ft2 a JOIN ft2 b ON (a.c1 = b.c2) WHERE a.c1 < 4;
+SELECT count(*), sum(b.c1) FROM ft2 a JOIN ft2 b ON (a.c1 = b.c2) WHERE a.c1 < 4;
 -- bug before 9.3.5 due to sloppy handling of remote-estimate parameters
 SELECT * FROM ft1 WHERE c1 = ANY (ARRAY(SELECT c1 FROM ft2 WHERE c1 < 5));
 SELECT * FROM ft2 WHERE c1 = ANY (ARRAY(SELECT c1 FROM ft1 WHERE c1 < 5));
@@ -609,3 +628,22 @@ UPDATE rem1 SET f2 = 'testo';
 
 -- Test returning a system attribute
 INSERT INTO rem1(f2) VALUES ('test') RETURNING ctid;
+
+-- ===================================================================
+-- test fetch_size and batch_size
+-- ===================================================================
+create table loc2 (f1 int, f2 text);
+create foreign table rem2 (f1 int, f2 text)
+  server loopback options(table_name 'loc2', batch_size '3');
+explain (verbose, costs off)
+insert into rem2 values (1, 'x'), (2, 'y');
+-- ten rows are sent in three full batches and a partial one
+insert into rem2 select i, 'row' from generate_series(1, 10) i;
+select count(*), sum(f1) from loc2;
+alter foreign table rem2 options (add fetch_size '0');
+alter foreign table rem2 options (add fetch_size '3');
+-- two scans sharing a connection, each needing several fetches
+select f1, count(*) from (select * from rem2 union all select * from rem2) s
+  group by f1 order by f1;
+drop foreign table rem2;
+drop table loc2;
@@ -0,0 +1,35 @@
+# A transaction that is running when the slot is created has to finish
+# before the slot becomes consistent, but transactions that start later
+# don't.  pg_replication_slots shows what the creation is waiting for.
+setup
+{
+    DROP TABLE IF EXISTS do_write;
+    CREATE TABLE do_write(id serial primary key);
+}
+
+teardown
+{
+    DROP TABLE do_write;
+    SELECT 'stop' FROM pg_drop_replication_slot('isolation_slot');
+}
+
+session "s1"
+setup { SET synchronous_commit=on; }
+step "s1b" { BEGIN; }
+step "s1w" { INSERT INTO do_write DEFAULT VALUES; }
+step "s1c" { COMMIT; }
+
+session "s2"
+setup { SET synchronous_commit=on; }
+step "s2init" {SELECT 'init' FROM pg_create_logical_replication_slot('isolation_slot', 'test_decoding');}
+step "s2start" {SELECT data FROM pg_logical_slot_get_changes('isolation_slot', NULL, NULL, 'include-xids', 'false');}
+
+session "s3"
+setup { SET synchronous_commit=on; }
+step "s3b" { BEGIN; }
+step "s3w" { INSERT INTO do_write DEFAULT VALUES; }
+step "s3c" { COMMIT; }
+step "s3progress" { SELECT slot_name, snapshot_state, snapshot_pending_xacts FROM pg_replication_slots; }
+
+
+permutation "s1b" "s1w" "s2init" "s3progress" "s3b" "s3w" "s1c" "s3progress" "s3c" "s2start" "s3progress"
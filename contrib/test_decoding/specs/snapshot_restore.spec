@@ -0,0 +1,34 @@
+# A new slot doesn't have to wait for the transactions running while it is
+# created if another slot of the database serialized a snapshot where it
+# can restart decoding from: the new slot starts from there instead.
+setup
+{
+    DROP TABLE IF EXISTS do_write;
+    CREATE TABLE do_write(id serial primary key);
+}
+
+teardown
+{
+    DROP TABLE do_write;
+    SELECT 'stop' FROM pg_drop_replication_slot('donor_slot'), pg_drop_replication_slot('isolation_slot');
+}
+
+session "s1"
+setup { SET synchronous_commit=on; }
+step "s1b" { BEGIN; }
+step "s1w" { INSERT INTO do_write DEFAULT VALUES; }
+step "s1c" { COMMIT; }
+
+session "s2"
+setup { SET synchronous_commit=on; }
+step "s2donor" {SELECT 'init' FROM pg_create_logical_replication_slot('donor_slot', 'test_decoding');}
+step "s2checkpoint" { CHECKPOINT; }
+step "s2advance" {SELECT count(*) FROM pg_logical_slot_get_changes('donor_slot', NULL, NULL);}
+step "s2init" {SELECT 'init' FROM pg_create_logical_replication_slot('isolation_slot', 'test_decoding');}
+step "s2start" {SELECT data FROM pg_logical_slot_get_changes('isolation_slot', NULL, NULL, 'include-xids', 'false');}
+
+session "s3"
+step "s3restart" { SELECT n.restart_lsn = d.restart_lsn AS same_restart_lsn FROM pg_replication_slots n, pg_replication_slots d WHERE n.slot_name = 'isolation_slot' AND d.slot_name = 'donor_slot'; }
+
+
+permutation "s2donor" "s2checkpoint" "s2advance" "s1b" "s1w" "s2init" "s3restart" "s1c" "s2start"
@@ -0,0 +1,31 @@
+-- predictability
+SET synchronous_commit = on;
+
+CREATE TABLE stream_test(data int);
+
+SELECT 'init' FROM pg_create_logical_replication_slot('regression_slot', 'test_decoding');
+
+-- large transactions get streamed in blocks before they end
+BEGIN;
+INSERT INTO stream_test SELECT generate_series(1, 5000);
+ROLLBACK;
+
+INSERT INTO stream_test SELECT generate_series(1, 5000);
+
+BEGIN;
+INSERT INTO stream_test VALUES (0);
+SAVEPOINT s1;
+INSERT INTO stream_test SELECT generate_series(1, 5000);
+ROLLBACK TO SAVEPOINT s1;
+COMMIT;
+
+SELECT data, count(*) FROM pg_logical_slot_peek_changes('regression_slot', NULL, NULL,
+    'include-xids', '0', 'stream-changes', '1')
+GROUP BY data ORDER BY data;
+
+-- without streaming the same changes are decoded at commit
+SELECT count(*) FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL,
+    'include-xids', '0');
+
+SELECT 'init' FROM pg_drop_replication_slot('regression_slot');
+DROP TABLE stream_test;
@@ -972,6 +972,114 @@ heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 	}
 }
 
+/*
+ * heap_deform_tuples
+ *		Given an array of tuples, extract the leading columns of each into
+ *		per-column arrays
+ *
+ *		This is a column-major variant of heap_deform_tuple, meant for callers
+ *		that evaluate expressions over a batch of tuples at once.  Only the
+ *		first natts attributes are extracted, and for each attribute number
+ *		attnum (0-based) the values of tuple i are stored into
+ *		values[attnum][i] and isnull[attnum][i].  If values[attnum] is NULL,
+ *		the column is skipped over without being stored; isnull[attnum] must
+ *		then be NULL as well.
+ *
+ *		As with heap_deform_tuple, pass-by-reference values point into the
+ *		tuples, so the tuples must stay valid while the results are in use.
+ */
+void
+heap_deform_tuples(HeapTuple tuples, int ntuples, TupleDesc tupleDesc,
+				   int natts, Datum **values, bool **isnull)
+{
+	Form_pg_attribute *att = tupleDesc->attrs;
+	int			i;
+
+	Assert(natts <= tupleDesc->natts);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		HeapTuple	tuple = &tuples[i];
+		HeapTupleHeader tup = tuple->t_data;
+		bool		hasnulls = HeapTupleHasNulls(tuple);
+		int			tupnatts;
+		int			attnum;
+		char	   *tp;			/* ptr to tuple data */
+		long		off;		/* offset in tuple data */
+		bits8	   *bp = tup->t_bits;	/* ptr to null bitmap in tuple */
+		bool		slow = false;	/* can we use/set attcacheoff? */
+
+		tupnatts = Min(HeapTupleHeaderGetNatts(tup), natts);
+
+		tp = (char *) tup + tup->t_hoff;
+
+		off = 0;
+
+		for (attnum = 0; attnum < tupnatts; attnum++)
+		{
+			Form_pg_attribute thisatt = att[attnum];
+
+			if (hasnulls && att_isnull(attnum, bp))
+			{
+				if (values[attnum] != NULL)
+				{
+					values[attnum][i] = (Datum) 0;
+					isnull[attnum][i] = true;
+				}
+				slow = true;	/* can't use attcacheoff anymore */
+				continue;
+			}
+
+			if (!slow && thisatt->attcacheoff >= 0)
+				off = thisatt->attcacheoff;
+			else if (thisatt->attlen == -1)
+			{
+				/* see heap_deform_tuple for the reasoning here */
+				if (!slow &&
+					off == att_align_nominal(off, thisatt->attalign))
+					thisatt->attcacheoff = off;
+				else
+				{
+					off = att_align_pointer(off, thisatt->attalign, -1,
+											tp + off);
+					slow = true;
+				}
+			}
+			else
+			{
+				/* not varlena, so safe to use att_align_nominal */
+				off = att_align_nominal(off, thisatt->attalign);
+
+				if (!slow)
+					thisatt->attcacheoff = off;
+			}
+
+			if (values[attnum] != NULL)
+			{
+				values[attnum][i] = fetchatt(thisatt, tp + off);
+				isnull[attnum][i] = false;
+			}
+
+			off = att_addlength_pointer(off, thisatt->attlen, tp + off);
+
+			if (thisatt->attlen <= 0)
+				slow = true;	/* can't use attcacheoff anymore */
+		}
+
+		/*
+		 * If tuple doesn't have all the requested atts, read the rest as null
+		 */
+		for (; attnum < natts; attnum++)
+		{
+			if (values[attnum] != NULL)
+			{
+				values[attnum][i] = (Datum) 0;
+				isnull[attnum][i] = true;
+			}
+		}
+	}
+}
+
 /*
  *		heap_deformtuple
  *
@@ -15,6 +15,7 @@
 
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/gist_private.h"
 #include "access/hash.h"
 #include "access/htup_details.h"
@@ -131,6 +132,14 @@ static relopt_int intRelOpts[] =
 		},
 		SPGIST_DEFAULT_FILLFACTOR, SPGIST_MIN_FILLFACTOR, 100
 	},
+	{
+		{
+			"pages_per_range",
+			"Number of pages that each page range covers in a BRIN index",
+			RELOPT_KIND_BRIN
+		},
+		BRIN_DEFAULT_PAGES_PER_RANGE, 1, 131072
+	},
 	{
 		{
 			"autovacuum_vacuum_threshold",
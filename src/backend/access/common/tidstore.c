@@ -0,0 +1,446 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *	  Compact store of dead tuple TIDs, for VACUUM
+ *
+ * Lazy VACUUM used to remember the TIDs of dead tuples in a sorted array of
+ * ItemPointers, at 6 bytes per tuple, and to binary-search it for every
+ * index tuple.  A TidStore instead keeps, for each heap block, the set of
+ * dead offsets on that block, encoded as a bitmap or as a list of offsets,
+ * whichever is smaller; one or two offsets are stored inline, without a
+ * separate entry.  With many dead tuples per block, that takes a small
+ * fraction of the space of the array, and with only one or two it takes
+ * about the same.
+ *
+ * The blocks that have dead tuples are kept in a block array, sorted by
+ * block number.  To find a block without searching the whole array, the
+ * directory has one slot per group of TIDSTORE_GROUP_BLOCKS consecutive
+ * blocks, covering the whole relation, holding the position in the array of
+ * the group's first block.  A membership test is thus a lookup in the
+ * directory, a binary search over at most TIDSTORE_GROUP_BLOCKS elements,
+ * and a bit test (or a scan over a handful of offsets).  Unlike a table with
+ * a slot for every block of the group, the block array costs nothing for
+ * blocks without dead tuples, so tables where dead tuples are scattered
+ * thinly over many blocks don't waste space.
+ *
+ * Everything is allocated from a single area given by the caller, with
+ * offsets instead of pointers, so that the store can be placed in dynamic
+ * shared memory and probed by several processes.  Blocks must be added in
+ * increasing block number order, which is the order VACUUM scans the heap
+ * in; that lets us allocate space sequentially and never move anything.
+ * The block entries are allocated from the start of the arena upwards, and
+ * the block array from its end downwards, until they meet.
+ *
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/common/tidstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tidstore.h"
+#include "storage/shmem.h"
+
+
+/* Number of blocks covered by one directory slot */
+#define TIDSTORE_GROUP_BITS		8
+#define TIDSTORE_GROUP_BLOCKS	(1 << TIDSTORE_GROUP_BITS)
+
+/*
+ * A block entry is a uint16 header followed by either a bitmap of offsets
+ * (bit N-1 of the bitmap is set if offset N is dead), or an ascending list
+ * of OffsetNumbers.  The low bits of the header give the length of the
+ * bitmap in bytes, or the number of offsets in the list.
+ */
+#define TIDSTORE_IS_BITMAP		0x8000
+#define TIDSTORE_LEN_MASK		0x7FFF
+
+#define TIDSTORE_BITMAP_BYTES(maxoff)	(((maxoff) + 7) / 8)
+
+/* The most space a block entry can take, including its alignment padding */
+#define TIDSTORE_MAX_ENTRY_SIZE \
+	(sizeof(uint16) + \
+	 TYPEALIGN(sizeof(uint16), TIDSTORE_BITMAP_BYTES(MaxHeapTuplesPerPage)))
+
+/*
+ * An element of the block array.  entry is the arena offset + 1 of the
+ * block's entry; or, if TIDSTORE_INLINE is set, the block's offsets
+ * themselves: the first in the low 16 bits, and the second, or zero if
+ * there is only one, in the next 15 bits.
+ */
+typedef struct TidStoreBlock
+{
+	BlockNumber blkno;
+	uint32		entry;
+} TidStoreBlock;
+
+#define TIDSTORE_INLINE			0x80000000
+#define TIDSTORE_MAX_INLINE		2
+
+/* Space needed to be sure the next block can be added */
+#define TIDSTORE_BLOCK_RESERVE \
+	(sizeof(TidStoreBlock) + TIDSTORE_MAX_ENTRY_SIZE)
+
+/*
+ * Offsets into the arena are stored plus one, so that zero means "none",
+ * and must not collide with TIDSTORE_INLINE.  That limits the arena to 2GB.
+ */
+#define TIDSTORE_MAX_ARENA		((Size) 0x7FFFFFFC)
+
+struct TidStore
+{
+	Size		arena_size;		/* space available in the arena */
+	Size		arena_used;		/* space used by block entries */
+	BlockNumber nblocks;		/* blocks >= this can't be stored */
+	BlockNumber last_block;		/* last block added, if any */
+	uint32		nstored;		/* number of elements in the block array */
+	uint32		ngroups;		/* number of directory slots */
+	uint32		nfilled;		/* number of directory slots set so far */
+	int64		num_tids;		/* number of TIDs stored */
+
+	/*
+	 * Position in the block array of the first block of each group.  Only
+	 * the first nfilled slots are valid; the blocks of group g are those from
+	 * directory[g] up to directory[g + 1], or up to nstored for the last
+	 * filled group.
+	 */
+	uint32		directory[FLEXIBLE_ARRAY_MEMBER];
+
+	/* the arena follows, at a MAXALIGN'd position */
+};
+
+#define TidStoreNumGroups(nblocks) \
+	(((nblocks) + TIDSTORE_GROUP_BLOCKS - 1) >> TIDSTORE_GROUP_BITS)
+#define TidStoreHeaderSize(ngroups) \
+	MAXALIGN(offsetof(TidStore, directory) + (ngroups) * sizeof(uint32))
+#define TidStoreArena(ts) \
+	((char *) (ts) + TidStoreHeaderSize((ts)->ngroups))
+
+/* The i'th element of the block array, counting from the end of the arena */
+#define TidStoreBlockAt(ts, arena, i) \
+	((TidStoreBlock *) ((arena) + (ts)->arena_size) - 1 - (i))
+
+/* Space left between the block entries and the block array */
+#define TidStoreFreeSpace(ts) \
+	((ts)->arena_size - (ts)->arena_used - \
+	 (ts)->nstored * sizeof(TidStoreBlock))
+
+
+/*
+ * TidStoreMinSize - smallest size that can hold the dead tuples of one block
+ */
+Size
+TidStoreMinSize(BlockNumber nblocks)
+{
+	return TidStoreHeaderSize(TidStoreNumGroups(nblocks)) +
+		TIDSTORE_BLOCK_RESERVE;
+}
+
+/*
+ * TidStoreMaxSize - size that can hold any dead tuples of nblocks blocks
+ *
+ * Useful to avoid allocating more space than a small table can ever need.
+ * For a large table, this is instead the most space the store can make use
+ * of, since the arena can't be larger than TIDSTORE_MAX_ARENA.
+ */
+Size
+TidStoreMaxSize(BlockNumber nblocks)
+{
+	Size		header_size = TidStoreHeaderSize(TidStoreNumGroups(nblocks));
+	Size		arena_size;
+
+	arena_size = add_size(mul_size(nblocks, TIDSTORE_BLOCK_RESERVE),
+						  TIDSTORE_BLOCK_RESERVE);
+	arena_size = Min(arena_size, TIDSTORE_MAX_ARENA);
+	return add_size(header_size, arena_size);
+}
+
+/*
+ * TidStoreCreate - initialize an empty store in the given space
+ *
+ * space must be MAXALIGN'd and size at least TidStoreMinSize(nblocks).
+ * Space beyond what the arena can address is left unused.
+ */
+TidStore *
+TidStoreCreate(void *space, Size size, BlockNumber nblocks)
+{
+	TidStore   *ts = (TidStore *) space;
+	uint32		ngroups = TidStoreNumGroups(nblocks);
+	Size		arena_size;
+
+	Assert(space == (void *) MAXALIGN(space));
+	if (size < TidStoreMinSize(nblocks))
+		elog(ERROR, "insufficient space for dead tuple store");
+
+	/* the block array at the end of the arena must be aligned */
+	arena_size = Min(size - TidStoreHeaderSize(ngroups), TIDSTORE_MAX_ARENA);
+	ts->arena_size = arena_size - arena_size % sizeof(uint32);
+	ts->nblocks = nblocks;
+	ts->ngroups = ngroups;
+	TidStoreReset(ts);
+
+	return ts;
+}
+
+/*
+ * TidStoreReset - forget all the TIDs in the store
+ */
+void
+TidStoreReset(TidStore *ts)
+{
+	ts->arena_used = 0;
+	ts->last_block = InvalidBlockNumber;
+	ts->nstored = 0;
+	ts->nfilled = 0;
+	ts->num_tids = 0;
+}
+
+/*
+ * TidStoreIsFull - is there too little space left to be sure we can add
+ * another block?
+ */
+bool
+TidStoreIsFull(const TidStore *ts)
+{
+	return TidStoreFreeSpace(ts) < TIDSTORE_BLOCK_RESERVE;
+}
+
+/*
+ * Allocate space for a block entry from the arena.  Returns the offset + 1
+ * of the space.  Room for the block's element in the block array is kept
+ * free.
+ */
+static uint32
+tidstore_alloc(TidStore *ts, Size size)
+{
+	Size		off = TYPEALIGN(sizeof(uint16), ts->arena_used);
+
+	if (off + size + (ts->nstored + 1) * sizeof(TidStoreBlock) >
+		ts->arena_size)
+		elog(ERROR, "out of space in dead tuple store");
+	ts->arena_used = off + size;
+
+	return (uint32) (off + 1);
+}
+
+/*
+ * TidStoreAddBlock - add the dead tuples of a heap block
+ *
+ * offsets must be in ascending order, and blkno higher than any block added
+ * before.  The caller must make sure the store isn't full first.
+ */
+void
+TidStoreAddBlock(TidStore *ts, BlockNumber blkno,
+				 const OffsetNumber *offsets, int noffsets)
+{
+	char	   *arena = TidStoreArena(ts);
+	uint32		group = blkno >> TIDSTORE_GROUP_BITS;
+	TidStoreBlock *block;
+	OffsetNumber maxoff;
+	int			bitmap_bytes;
+	uint32		entry;
+	uint16	   *hdr;
+	int			i;
+
+	Assert(noffsets > 0);
+	Assert(blkno < ts->nblocks);
+	Assert(ts->last_block == InvalidBlockNumber || blkno > ts->last_block);
+
+	/* Use an inline list, a bitmap or a list, whichever is smallest */
+	maxoff = offsets[noffsets - 1];
+	Assert(maxoff <= MaxHeapTuplesPerPage);
+	bitmap_bytes = TIDSTORE_BITMAP_BYTES(maxoff);
+	if (noffsets <= TIDSTORE_MAX_INLINE)
+	{
+		entry = TIDSTORE_INLINE | offsets[0];
+		if (noffsets > 1)
+			entry |= (uint32) offsets[1] << 16;
+	}
+	else if (bitmap_bytes <= noffsets * sizeof(OffsetNumber))
+	{
+		uint8	   *bitmap;
+
+		entry = tidstore_alloc(ts, sizeof(uint16) + bitmap_bytes);
+		hdr = (uint16 *) (arena + entry - 1);
+		*hdr = TIDSTORE_IS_BITMAP | bitmap_bytes;
+		bitmap = (uint8 *) (hdr + 1);
+		memset(bitmap, 0, bitmap_bytes);
+		for (i = 0; i < noffsets; i++)
+		{
+			int			bit = offsets[i] - 1;
+
+			bitmap[bit / 8] |= 1 << (bit % 8);
+		}
+	}
+	else
+	{
+		entry = tidstore_alloc(ts, sizeof(uint16) +
+							   noffsets * sizeof(OffsetNumber));
+		hdr = (uint16 *) (arena + entry - 1);
+		*hdr = noffsets;
+		memcpy(hdr + 1, offsets, noffsets * sizeof(OffsetNumber));
+	}
+
+	if (TidStoreFreeSpace(ts) < sizeof(TidStoreBlock))
+		elog(ERROR, "out of space in dead tuple store");
+
+	/* The groups up to this one, if not seen yet, start at this block */
+	while (ts->nfilled <= group)
+		ts->directory[ts->nfilled++] = ts->nstored;
+
+	block = TidStoreBlockAt(ts, arena, ts->nstored);
+	block->blkno = blkno;
+	block->entry = entry;
+	ts->nstored++;
+	ts->last_block = blkno;
+	ts->num_tids += noffsets;
+}
+
+/*
+ * TidStoreNumTids - number of TIDs in the store
+ */
+int64
+TidStoreNumTids(const TidStore *ts)
+{
+	return ts->num_tids;
+}
+
+/*
+ * Is the offset in the set described by a block array element?
+ */
+static bool
+tidstore_entry_member(const char *arena, uint32 entry, OffsetNumber off)
+{
+	const uint16 *hdr;
+	int			len;
+
+	if (entry & TIDSTORE_INLINE)
+		return (entry & 0xFFFF) == off || ((entry >> 16) & 0x7FFF) == off;
+
+	hdr = (const uint16 *) (arena + entry - 1);
+	len = *hdr & TIDSTORE_LEN_MASK;
+	if (*hdr & TIDSTORE_IS_BITMAP)
+	{
+		const uint8 *bitmap = (const uint8 *) (hdr + 1);
+		int			bit = off - 1;
+
+		return bit >= 0 && bit / 8 < len &&
+			(bitmap[bit / 8] & (1 << (bit % 8))) != 0;
+	}
+	else
+	{
+		const OffsetNumber *offsets = (const OffsetNumber *) (hdr + 1);
+		int			i;
+
+		for (i = 0; i < len && offsets[i] <= off; i++)
+		{
+			if (offsets[i] == off)
+				return true;
+		}
+		return false;
+	}
+}
+
+/*
+ * TidStoreIsMember - is the TID in the store?
+ */
+bool
+TidStoreIsMember(const TidStore *ts, ItemPointer tid)
+{
+	const char *arena = TidStoreArena(ts);
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	uint32		group = blkno >> TIDSTORE_GROUP_BITS;
+	uint32		lo;
+	uint32		hi;
+
+	if (group >= ts->nfilled)
+		return false;
+	lo = ts->directory[group];
+	hi = (group + 1 < ts->nfilled) ? ts->directory[group + 1] : ts->nstored;
+
+	/* binary search the group's blocks */
+	while (lo < hi)
+	{
+		uint32		mid = lo + (hi - lo) / 2;
+		const TidStoreBlock *block = TidStoreBlockAt(ts, arena, mid);
+
+		if (block->blkno < blkno)
+			lo = mid + 1;
+		else if (block->blkno > blkno)
+			hi = mid;
+		else
+			return tidstore_entry_member(arena, block->entry, off);
+	}
+
+	return false;
+}
+
+/*
+ * TidStoreBeginIterate - prepare to iterate over the blocks in the store
+ */
+void
+TidStoreBeginIterate(TidStoreIter *iter)
+{
+	iter->next = 0;
+}
+
+/*
+ * TidStoreIterateNext - return the next block of the store, in block order
+ *
+ * Sets *blkno and fills offsets, which must have room for
+ * MaxHeapTuplesPerPage entries, with the block's dead offsets in ascending
+ * order.  Returns the number of offsets, or 0 when there are no more blocks.
+ */
+int
+TidStoreIterateNext(const TidStore *ts, TidStoreIter *iter,
+					BlockNumber *blkno, OffsetNumber *offsets)
+{
+	const char *arena = TidStoreArena(ts);
+	const TidStoreBlock *block;
+	const uint16 *hdr;
+	int			len;
+	int			n;
+
+	if (iter->next >= ts->nstored)
+		return 0;
+
+	block = TidStoreBlockAt(ts, arena, iter->next);
+	iter->next++;
+	*blkno = block->blkno;
+
+	if (block->entry & TIDSTORE_INLINE)
+	{
+		n = 0;
+		offsets[n++] = (OffsetNumber) (block->entry & 0xFFFF);
+		if ((block->entry >> 16) & 0x7FFF)
+			offsets[n++] = (OffsetNumber) ((block->entry >> 16) & 0x7FFF);
+		return n;
+	}
+
+	hdr = (const uint16 *) (arena + block->entry - 1);
+	len = *hdr & TIDSTORE_LEN_MASK;
+	if (*hdr & TIDSTORE_IS_BITMAP)
+	{
+		const uint8 *bitmap = (const uint8 *) (hdr + 1);
+		int			bit;
+
+		n = 0;
+		for (bit = 0; bit < len * 8; bit++)
+		{
+			if (bitmap[bit / 8] & (1 << (bit % 8)))
+				offsets[n++] = (OffsetNumber) (bit + 1);
+		}
+	}
+	else
+	{
+		n = len;
+		memcpy(offsets, hdr + 1, n * sizeof(OffsetNumber));
+	}
+	return n;
+}
@@ -22,9 +22,11 @@
 #include "access/relscan.h"
 #include "catalog/index.h"
 #include "commands/vacuum.h"
+#include "miscadmin.h"
 #include "optimizer/cost.h"
 #include "optimizer/plancat.h"
 #include "storage/bufmgr.h"
+#include "storage/smgr.h"
 #include "utils/rel.h"
 
 
@@ -125,6 +127,16 @@ hashbuildempty(PG_FUNCTION_ARGS)
 
 	_hash_metapinit(index, 0, INIT_FORKNUM);
 
+	/*
+	 * The init fork was built in shared buffers, and WAL-logged.  But since
+	 * an unlogged relation's init fork is copied over its main fork at the
+	 * end of recovery, bypassing shared buffers, it must reach disk before
+	 * the next checkpoint; so write it out and fsync it now.
+	 */
+	FlushRelationBuffers(index);
+	RelationOpenSmgr(index);
+	smgrimmedsync(index->rd_smgr, INIT_FORKNUM);
+
 	PG_RETURN_VOID();
 }
 
@@ -393,6 +405,9 @@ hashbeginscan(PG_FUNCTION_ARGS)
 	so->hashso_bucket_valid = false;
 	so->hashso_bucket_blkno = 0;
 	so->hashso_curbuf = InvalidBuffer;
+	so->hashso_bucket_buf = InvalidBuffer;
+	so->hashso_old_bucket_blkno = 0;
+	so->hashso_old_bucket_buf = InvalidBuffer;
 	/* set position invalid (this will cause _hash_first call) */
 	ItemPointerSetInvalid(&(so->hashso_curpos));
 	ItemPointerSetInvalid(&(so->hashso_heappos));
@@ -418,15 +433,7 @@ hashrescan(PG_FUNCTION_ARGS)
 	HashScanOpaque so = (HashScanOpaque) scan->opaque;
 	Relation	rel = scan->indexRelation;
 
-	/* release any pin we still hold */
-	if (BufferIsValid(so->hashso_curbuf))
-		_hash_dropbuf(rel, so->hashso_curbuf);
-	so->hashso_curbuf = InvalidBuffer;
-
-	/* release lock on bucket, too */
-	if (so->hashso_bucket_blkno)
-		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
-	so->hashso_bucket_blkno = 0;
+	_hash_dropscanbuf(rel, so);
 
 	/* set position invalid (this will cause _hash_first call) */
 	ItemPointerSetInvalid(&(so->hashso_curpos));
@@ -457,15 +464,7 @@ hashendscan(PG_FUNCTION_ARGS)
 	/* don't need scan registered anymore */
 	_hash_dropscan(scan);
 
-	/* release any pin we still hold */
-	if (BufferIsValid(so->hashso_curbuf))
-		_hash_dropbuf(rel, so->hashso_curbuf);
-	so->hashso_curbuf = InvalidBuffer;
-
-	/* release lock on bucket, too */
-	if (so->hashso_bucket_blkno)
-		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
-	so->hashso_bucket_blkno = 0;
+	_hash_dropscanbuf(rel, so);
 
 	pfree(so);
 	scan->opaque = NULL;
@@ -544,8 +543,9 @@ loop_top:
 	while (cur_bucket <= cur_maxbucket)
 	{
 		BlockNumber bucket_blkno;
-		BlockNumber blkno;
-		bool		bucket_dirty = false;
+		Buffer		buf;
+		HashPageOpaque bucket_opaque;
+		bool		split_cleanup;
 
 		/* Get address of bucket's start page */
 		bucket_blkno = BUCKET_TO_BLKNO(&local_metapage, cur_bucket);
@@ -557,68 +557,48 @@ loop_top:
 		if (_hash_has_active_scan(rel, cur_bucket))
 			elog(ERROR, "hash index has active scan during VACUUM");
 
-		/* Scan each page in bucket */
-		blkno = bucket_blkno;
-		while (BlockNumberIsValid(blkno))
-		{
-			Buffer		buf;
-			Page		page;
-			HashPageOpaque opaque;
-			OffsetNumber offno;
-			OffsetNumber maxoffno;
-			OffsetNumber deletable[MaxOffsetNumber];
-			int			ndeletable = 0;
-
-			vacuum_delay_point();
-
-			buf = _hash_getbuf_with_strategy(rel, blkno, HASH_WRITE,
-										   LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
-											 info->strategy);
-			page = BufferGetPage(buf);
-			opaque = (HashPageOpaque) PageGetSpecialPointer(page);
-			Assert(opaque->hasho_bucket == cur_bucket);
-
-			/* Scan each tuple in page */
-			maxoffno = PageGetMaxOffsetNumber(page);
-			for (offno = FirstOffsetNumber;
-				 offno <= maxoffno;
-				 offno = OffsetNumberNext(offno))
-			{
-				IndexTuple	itup;
-				ItemPointer htup;
-
-				itup = (IndexTuple) PageGetItem(page,
-												PageGetItemId(page, offno));
-				htup = &(itup->t_tid);
-				if (callback(htup, callback_state))
-				{
-					/* mark the item for deletion */
-					deletable[ndeletable++] = offno;
-					tuples_removed += 1;
-				}
-				else
-					num_index_tuples += 1;
-			}
+		buf = _hash_getbuf_with_strategy(rel, bucket_blkno, HASH_READ,
+										 LH_BUCKET_PAGE, info->strategy);
+		bucket_opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
 
-			/*
-			 * Apply deletions and write page if needed, advance to next page.
-			 */
-			blkno = opaque->hasho_nextblkno;
+		/*
+		 * If this bucket is the new half of an interrupted split, finish the
+		 * split first; otherwise we couldn't tell which of the tuples still
+		 * to be copied here are dead.
+		 */
+		if (H_BUCKET_BEING_POPULATED(bucket_opaque))
+		{
+			_hash_relbuf(rel, buf);
+			_hash_droplock(rel, bucket_blkno, HASH_EXCLUSIVE);
+			(void) _hash_finish_split(rel, cur_bucket, true);
+			_hash_getlock(rel, bucket_blkno, HASH_EXCLUSIVE);
+			buf = _hash_getbuf_with_strategy(rel, bucket_blkno, HASH_READ,
+											 LH_BUCKET_PAGE, info->strategy);
+			bucket_opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buf));
+		}
 
-			if (ndeletable > 0)
-			{
-				PageIndexMultiDelete(page, deletable, ndeletable);
-				_hash_wrtbuf(rel, buf);
-				bucket_dirty = true;
-			}
-			else
-				_hash_relbuf(rel, buf);
+		/*
+		 * If the bucket was split, and the tuples that were moved are still
+		 * in it, remove them too.  Our copy of the metapage must be at least
+		 * as new as the split to tell which tuples those are.
+		 */
+		split_cleanup = H_NEEDS_SPLIT_CLEANUP(bucket_opaque);
+		if (split_cleanup &&
+			bucket_opaque->hasho_prevblkno > local_metapage.hashm_maxbucket)
+		{
+			metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
+			memcpy(&local_metapage, HashPageGetMeta(BufferGetPage(metabuf)),
+				   sizeof(local_metapage));
+			_hash_relbuf(rel, metabuf);
 		}
+		_hash_relbuf(rel, buf);
 
-		/* If we deleted anything, try to compact free space */
-		if (bucket_dirty)
-			_hash_squeezebucket(rel, cur_bucket, bucket_blkno,
-								info->strategy);
+		hashbucketcleanup(rel, cur_bucket, bucket_blkno, info->strategy,
+						  local_metapage.hashm_maxbucket,
+						  local_metapage.hashm_highmask,
+						  local_metapage.hashm_lowmask,
+						  &tuples_removed, &num_index_tuples,
+						  split_cleanup, callback, callback_state);
 
 		/* Release bucket lock */
 		_hash_droplock(rel, bucket_blkno, HASH_EXCLUSIVE);
@@ -641,6 +621,7 @@ loop_top:
 	}
 
 	/* Okay, we're really done.  Update tuple count in metapage. */
+	START_CRIT_SECTION();
 
 	if (orig_maxbucket == metap->hashm_maxbucket &&
 		orig_ntuples == metap->hashm_ntuples)
@@ -666,7 +647,37 @@ loop_top:
 		num_index_tuples = metap->hashm_ntuples;
 	}
 
-	_hash_wrtbuf(rel, metabuf);
+	MarkBufferDirty(metabuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+		xl_hash_update_meta_page xlrec;
+
+		xlrec.node = rel->rd_node;
+		xlrec.ntuples = metap->hashm_ntuples;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashUpdateMetaPage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = metabuf;
+		rdata[1].buffer_std = false;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_UPDATE_META_PAGE, rdata);
+
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, metabuf);
 
 	/* return statistics */
 	if (stats == NULL)
@@ -705,8 +716,195 @@ hashvacuumcleanup(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Helper function to perform deletion of index entries from a bucket.
+ *
+ * This function expects that the caller has acquired an exclusive lock on
+ * the bucket (the heavyweight one).  It removes the tuples that the
+ * callback reports as dead, if a callback is given, and if split_cleanup
+ * is true, also the tuples that were moved to another bucket by a split;
+ * which bucket a tuple belongs in is decided using maxbucket, highmask and
+ * lowmask, which must be at least as new as the last split of the bucket.
+ * Then it clears the bucket's "needs split cleanup" flag, and compacts the
+ * bucket if anything was removed.
+ *
+ * If tuples_removed and num_index_tuples are given, the dead tuples and the
+ * tuples that stay in the bucket are added to them, respectively.  Tuples
+ * removed because they were moved aren't counted in either.
+ *
+ * This is used by VACUUM, and by _hash_expandtable to clean up the old
+ * bucket after a split.
+ */
 void
-hash_redo(XLogRecPtr lsn, XLogRecord *record)
+hashbucketcleanup(Relation rel, Bucket cur_bucket, BlockNumber bucket_blkno,
+				  BufferAccessStrategy bstrategy,
+				  uint32 maxbucket, uint32 highmask, uint32 lowmask,
+				  double *tuples_removed, double *num_index_tuples,
+				  bool split_cleanup,
+				  IndexBulkDeleteCallback callback, void *callback_state)
 {
-	elog(PANIC, "hash_redo: unimplemented");
+	BlockNumber blkno;
+	bool		bucket_dirty = false;
+
+	/* Scan each page in bucket */
+	blkno = bucket_blkno;
+	while (BlockNumberIsValid(blkno))
+	{
+		Buffer		buf;
+		Page		page;
+		HashPageOpaque opaque;
+		OffsetNumber offno;
+		OffsetNumber maxoffno;
+		OffsetNumber deletable[MaxOffsetNumber];
+		int			ndeletable = 0;
+
+		vacuum_delay_point();
+
+		buf = _hash_getbuf_with_strategy(rel, blkno, HASH_WRITE,
+										 LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
+										 bstrategy);
+		page = BufferGetPage(buf);
+		opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+		Assert(opaque->hasho_bucket == cur_bucket);
+
+		/* Scan each tuple in page */
+		maxoffno = PageGetMaxOffsetNumber(page);
+		for (offno = FirstOffsetNumber;
+			 offno <= maxoffno;
+			 offno = OffsetNumberNext(offno))
+		{
+			IndexTuple	itup;
+			ItemPointer htup;
+			Bucket		bucket;
+
+			itup = (IndexTuple) PageGetItem(page,
+											PageGetItemId(page, offno));
+			htup = &(itup->t_tid);
+			if (callback && callback(htup, callback_state))
+			{
+				/* mark the item for deletion */
+				deletable[ndeletable++] = offno;
+				if (tuples_removed)
+					*tuples_removed += 1;
+				continue;
+			}
+
+			if (split_cleanup)
+			{
+				bucket = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
+											  maxbucket, highmask, lowmask);
+				if (bucket != cur_bucket)
+				{
+					/*
+					 * The tuple was moved to another bucket by a split; we
+					 * can remove our copy.
+					 */
+					deletable[ndeletable++] = offno;
+					continue;
+				}
+			}
+
+			if (num_index_tuples)
+				*num_index_tuples += 1;
+		}
+
+		/*
+		 * Apply deletions, advance to next page and write page if needed.
+		 */
+		blkno = opaque->hasho_nextblkno;
+
+		if (ndeletable > 0)
+		{
+			/* No ereport(ERROR) until changes are logged */
+			START_CRIT_SECTION();
+
+			PageIndexMultiDelete(page, deletable, ndeletable);
+			bucket_dirty = true;
+			MarkBufferDirty(buf);
+
+			/* XLOG stuff */
+			if (RelationNeedsWAL(rel))
+			{
+				XLogRecPtr	recptr;
+				XLogRecData rdata[2];
+				xl_hash_delete xlrec;
+
+				xlrec.node = rel->rd_node;
+				xlrec.bucket_blkno = bucket_blkno;
+				xlrec.blkno = BufferGetBlockNumber(buf);
+
+				rdata[0].data = (char *) &xlrec;
+				rdata[0].len = SizeOfHashDelete;
+				rdata[0].buffer = InvalidBuffer;
+				rdata[0].next = &(rdata[1]);
+
+				/* the deleted offsets are omitted if the page is backed up */
+				rdata[1].data = (char *) deletable;
+				rdata[1].len = ndeletable * sizeof(OffsetNumber);
+				rdata[1].buffer = buf;
+				rdata[1].buffer_std = true;
+				rdata[1].next = NULL;
+
+				recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_DELETE, rdata);
+
+				PageSetLSN(page, recptr);
+			}
+
+			END_CRIT_SECTION();
+		}
+
+		_hash_relbuf(rel, buf);
+	}
+
+	/* Clear the split-cleanup flag, now that the moved tuples are gone */
+	if (split_cleanup)
+	{
+		Buffer		bucket_buf;
+		Page		page;
+		HashPageOpaque bucket_opaque;
+
+		bucket_buf = _hash_getbuf_with_strategy(rel, bucket_blkno, HASH_WRITE,
+												LH_BUCKET_PAGE, bstrategy);
+		page = BufferGetPage(bucket_buf);
+		bucket_opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+		START_CRIT_SECTION();
+
+		bucket_opaque->hasho_flag &= ~LH_BUCKET_NEEDS_SPLIT_CLEANUP;
+		MarkBufferDirty(bucket_buf);
+
+		/* XLOG stuff */
+		if (RelationNeedsWAL(rel))
+		{
+			XLogRecPtr	recptr;
+			XLogRecData rdata[2];
+			xl_hash_split_cleanup xlrec;
+
+			xlrec.node = rel->rd_node;
+			xlrec.bucket_blkno = bucket_blkno;
+
+			rdata[0].data = (char *) &xlrec;
+			rdata[0].len = SizeOfHashSplitCleanup;
+			rdata[0].buffer = InvalidBuffer;
+			rdata[0].next = &(rdata[1]);
+
+			rdata[1].data = NULL;
+			rdata[1].len = 0;
+			rdata[1].buffer = bucket_buf;
+			rdata[1].buffer_std = true;
+			rdata[1].next = NULL;
+
+			recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_CLEANUP, rdata);
+
+			PageSetLSN(page, recptr);
+		}
+
+		END_CRIT_SECTION();
+
+		_hash_relbuf(rel, bucket_buf);
+	}
+
+	/* If we deleted anything, try to compact free space */
+	if (bucket_dirty)
+		_hash_squeezebucket(rel, cur_bucket, bucket_blkno, bstrategy);
 }
@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 
@@ -32,14 +33,14 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 	Buffer		metabuf;
 	HashMetaPage metap;
 	BlockNumber blkno;
-	BlockNumber oldblkno = InvalidBlockNumber;
-	bool		retry = false;
+	Page		metapage;
 	Page		page;
 	HashPageOpaque pageopaque;
 	Size		itemsz;
 	bool		do_expand;
 	uint32		hashkey;
 	Bucket		bucket;
+	OffsetNumber itup_off;
 
 	/*
 	 * Get the hash key for the item (it's stored in the index tuple itself).
@@ -51,9 +52,14 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 	itemsz = MAXALIGN(itemsz);	/* be safe, PageAddItem will do this but we
 								 * need to be consistent */
 
-	/* Read the metapage */
-	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
-	metap = HashPageGetMeta(BufferGetPage(metabuf));
+restart_insert:
+
+	/*
+	 * Pin the metapage.  We don't need to lock it until we update the tuple
+	 * count, or add an overflow page.
+	 */
+	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_NOLOCK, LH_META_PAGE);
+	metapage = BufferGetPage(metabuf);
 
 	/*
 	 * Check whether the item can fit on a hash page at all. (Eventually, we
@@ -62,59 +68,37 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 	 *
 	 * XXX this is useless code if we are only storing hash keys.
 	 */
-	if (itemsz > HashMaxItemSize((Page) metap))
+	if (itemsz > HashMaxItemSize(metapage))
 		ereport(ERROR,
 				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 				 errmsg("index row size %zu exceeds hash maximum %zu",
-						itemsz, HashMaxItemSize((Page) metap)),
+						itemsz, HashMaxItemSize(metapage)),
 			errhint("Values larger than a buffer page cannot be indexed.")));
 
+	/* Lock the target bucket, and write-lock its primary page */
+	buf = _hash_getbucketbuf_from_hashkey(rel, hashkey, HASH_WRITE, NULL);
+	page = BufferGetPage(buf);
+	pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	bucket = pageopaque->hasho_bucket;
+	blkno = BufferGetBlockNumber(buf);
+
 	/*
-	 * Loop until we get a lock on the correct target bucket.
+	 * If this bucket is the new half of a split that was interrupted, finish
+	 * the split before inserting anything into it.  Scans read the old
+	 * bucket for as long as the split isn't finished, so a tuple added here
+	 * would go unnoticed.  Then start over, since the bucket might have been
+	 * split again meanwhile.
 	 */
-	for (;;)
+	if (H_BUCKET_BEING_POPULATED(pageopaque))
 	{
-		/*
-		 * Compute the target bucket number, and convert to block number.
-		 */
-		bucket = _hash_hashkey2bucket(hashkey,
-									  metap->hashm_maxbucket,
-									  metap->hashm_highmask,
-									  metap->hashm_lowmask);
-
-		blkno = BUCKET_TO_BLKNO(metap, bucket);
+		_hash_relbuf(rel, buf);
+		_hash_droplock(rel, blkno, HASH_SHARE);
+		_hash_dropbuf(rel, metabuf);
 
-		/* Release metapage lock, but keep pin. */
-		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
-
-		/*
-		 * If the previous iteration of this loop locked what is still the
-		 * correct target bucket, we are done.	Otherwise, drop any old lock
-		 * and lock what now appears to be the correct bucket.
-		 */
-		if (retry)
-		{
-			if (oldblkno == blkno)
-				break;
-			_hash_droplock(rel, oldblkno, HASH_SHARE);
-		}
-		_hash_getlock(rel, blkno, HASH_SHARE);
-
-		/*
-		 * Reacquire metapage lock and check that no bucket split has taken
-		 * place while we were awaiting the bucket lock.
-		 */
-		_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_READ);
-		oldblkno = blkno;
-		retry = true;
+		(void) _hash_finish_split(rel, bucket, true);
+		goto restart_insert;
 	}
 
-	/* Fetch the primary bucket page for the bucket */
-	buf = _hash_getbuf(rel, blkno, HASH_WRITE, LH_BUCKET_PAGE);
-	page = BufferGetPage(buf);
-	pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
-	Assert(pageopaque->hasho_bucket == bucket);
-
 	/* Do the insertion */
 	while (PageGetFreeSpace(page) < itemsz)
 	{
@@ -137,13 +121,9 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 		{
 			/*
 			 * we're at the end of the bucket chain and we haven't found a
-			 * page with enough room.  allocate a new overflow page.
+			 * page with enough room.  allocate a new overflow page.  The
+			 * tail page stays locked, so nobody else can chain to it first.
 			 */
-
-			/* release our write lock without modifying buffer */
-			_hash_chgbufaccess(rel, buf, HASH_READ, HASH_NOLOCK);
-
-			/* chain to a new overflow page */
 			buf = _hash_addovflpage(rel, metabuf, buf);
 			page = BufferGetPage(buf);
 
@@ -151,33 +131,74 @@ _hash_doinsert(Relation rel, IndexTuple itup)
 			Assert(PageGetFreeSpace(page) >= itemsz);
 		}
 		pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
-		Assert(pageopaque->hasho_flag == LH_OVERFLOW_PAGE);
+		Assert((pageopaque->hasho_flag & LH_PAGE_TYPE) == LH_OVERFLOW_PAGE);
 		Assert(pageopaque->hasho_bucket == bucket);
 	}
 
-	/* found page with enough space, so add the item here */
-	(void) _hash_pgaddtup(rel, buf, itemsz, itup);
-
-	/* write and release the modified page */
-	_hash_wrtbuf(rel, buf);
-
-	/* We can drop the bucket lock now */
-	_hash_droplock(rel, blkno, HASH_SHARE);
-
 	/*
-	 * Write-lock the metapage so we can increment the tuple count. After
-	 * incrementing it, check to see if it's time for a split.
+	 * Write-lock the metapage so we can increment the tuple count.  We add
+	 * the item and bump the count in a single WAL record.
 	 */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
+	metap = HashPageGetMeta(metapage);
+
+	/* Do the update.  No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	/* found page with enough space, so add the item here */
+	itup_off = _hash_pgaddtup(rel, buf, itemsz, itup);
+	MarkBufferDirty(buf);
 
 	metap->hashm_ntuples += 1;
+	MarkBufferDirty(metabuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+		xl_hash_insert xlrec;
+
+		xlrec.node = rel->rd_node;
+		xlrec.blkno = BufferGetBlockNumber(buf);
+		xlrec.offnum = itup_off;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashInsert;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = (char *) itup;
+		rdata[1].len = IndexTupleDSize(*itup);
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		/* the tuple count is bumped during replay */
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = metabuf;
+		rdata[2].buffer_std = false;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_INSERT, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetLSN(metapage, recptr);
+	}
+
+	END_CRIT_SECTION();
 
 	/* Make sure this stays in sync with _hash_expandtable() */
 	do_expand = metap->hashm_ntuples >
 		(double) metap->hashm_ffactor * (metap->hashm_maxbucket + 1);
 
-	/* Write out the metapage and drop lock, but keep pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* drop lock on metapage, but keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	/* release the modified page, and the bucket lock */
+	_hash_relbuf(rel, buf);
+	_hash_droplock(rel, blkno, HASH_SHARE);
 
 	/* Attempt to split if a split is needed */
 	if (do_expand)
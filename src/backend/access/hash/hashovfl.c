@@ -18,10 +18,11 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/heapam_xlog.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 
-static Buffer _hash_getovflpage(Relation rel, Buffer metabuf);
 static uint32 _hash_firstfreebit(uint32 map);
 
 
@@ -80,22 +81,22 @@ blkno_to_bitno(HashMetaPage metap, BlockNumber ovflblkno)
  *
  *	Add an overflow page to the bucket whose last page is pointed to by 'buf'.
  *
- *	On entry, the caller must hold a pin but no lock on 'buf'.	The pin is
- *	dropped before exiting (we assume the caller is not interested in 'buf'
- *	anymore).  The returned overflow page will be pinned and write-locked;
- *	it is guaranteed to be empty.
+ *	On entry, the caller must hold a pin and write lock on 'buf', which must
+ *	be the last page of the bucket chain.  The buffer is released before
+ *	exiting (we assume the caller is not interested in 'buf' anymore).  The
+ *	returned overflow page will be pinned and write-locked; it is guaranteed
+ *	to be empty.
  *
  *	The caller must hold a pin, but no lock, on the metapage buffer.
  *	That buffer is returned in the same state.
  *
  *	The caller must hold at least share lock on the bucket, to ensure that
- *	no one else tries to compact the bucket meanwhile.	This guarantees that
- *	'buf' won't stop being part of the bucket while it's unlocked.
+ *	no one else tries to compact the bucket meanwhile.
  *
- * NB: since this could be executed concurrently by multiple processes,
- * one should not assume that the returned overflow page will be the
- * immediate successor of the originally passed 'buf'.	Additional overflow
- * pages might have been added to the bucket chain in between.
+ * The whole operation, that is finding a free page in the bitmaps (or
+ * extending the index), initializing it and linking it to the tail page,
+ * is done while holding the tail page and metapage locks, and is WAL-logged
+ * as one record.
  */
 Buffer
 _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf)
@@ -105,84 +106,37 @@ _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf)
 	Page		ovflpage;
 	HashPageOpaque pageopaque;
 	HashPageOpaque ovflopaque;
-
-	/* allocate and lock an empty overflow page */
-	ovflbuf = _hash_getovflpage(rel, metabuf);
-
-	/*
-	 * Write-lock the tail page.  It is okay to hold two buffer locks here
-	 * since there cannot be anyone else contending for access to ovflbuf.
-	 */
-	_hash_chgbufaccess(rel, buf, HASH_NOLOCK, HASH_WRITE);
-
-	/* probably redundant... */
-	_hash_checkpage(rel, buf, LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
-
-	/* loop to find current tail page, in case someone else inserted too */
-	for (;;)
-	{
-		BlockNumber nextblkno;
-
-		page = BufferGetPage(buf);
-		pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
-		nextblkno = pageopaque->hasho_nextblkno;
-
-		if (!BlockNumberIsValid(nextblkno))
-			break;
-
-		/* we assume we do not need to write the unmodified page */
-		_hash_relbuf(rel, buf);
-
-		buf = _hash_getbuf(rel, nextblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
-	}
-
-	/* now that we have correct backlink, initialize new overflow page */
-	ovflpage = BufferGetPage(ovflbuf);
-	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
-	ovflopaque->hasho_prevblkno = BufferGetBlockNumber(buf);
-	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
-	ovflopaque->hasho_bucket = pageopaque->hasho_bucket;
-	ovflopaque->hasho_flag = LH_OVERFLOW_PAGE;
-	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
-
-	MarkBufferDirty(ovflbuf);
-
-	/* logically chain overflow page to previous page */
-	pageopaque->hasho_nextblkno = BufferGetBlockNumber(ovflbuf);
-	_hash_wrtbuf(rel, buf);
-
-	return ovflbuf;
-}
-
-/*
- *	_hash_getovflpage()
- *
- *	Find an available overflow page and return it.	The returned buffer
- *	is pinned and write-locked, and has had _hash_pageinit() applied,
- *	but it is caller's responsibility to fill the special space.
- *
- * The caller must hold a pin, but no lock, on the metapage buffer.
- * That buffer is left in the same state at exit.
- */
-static Buffer
-_hash_getovflpage(Relation rel, Buffer metabuf)
-{
 	HashMetaPage metap;
-	Buffer		mapbuf = 0;
-	Buffer		newbuf;
+	Buffer		mapbuf = InvalidBuffer;
+	Buffer		newmapbuf = InvalidBuffer;
 	BlockNumber blkno;
+	BlockNumber mapblkno = InvalidBlockNumber;
+	BlockNumber newmapblkno = InvalidBlockNumber;
 	uint32		orig_firstfree;
 	uint32		splitnum;
 	uint32	   *freep = NULL;
 	uint32		max_ovflpg;
 	uint32		bit;
+	uint32		mapbit = 0;
 	uint32		first_page;
 	uint32		last_bit;
 	uint32		last_page;
 	uint32		i,
 				j;
+	bool		found = false;
 
-	/* Get exclusive lock on the meta page */
+	/* probably redundant... */
+	_hash_checkpage(rel, buf, LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
+
+	page = BufferGetPage(buf);
+	pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	Assert(!BlockNumberIsValid(pageopaque->hasho_nextblkno));
+
+	/*
+	 * Get exclusive lock on the meta page.  We keep it until we're done, so
+	 * that nobody else can grab the overflow page we find.  It's okay to lock
+	 * bitmap pages while holding it; see README for the lock ordering rules.
+	 */
 	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
 
 	_hash_checkpage(rel, metabuf, LH_META_PAGE);
@@ -196,22 +150,18 @@ _hash_getovflpage(Relation rel, Buffer metabuf)
 	j = bit / BITS_PER_MAP;
 	bit &= ~(BITS_PER_MAP - 1);
 
+	/* want to end search with the last existing overflow page */
+	splitnum = metap->hashm_ovflpoint;
+	max_ovflpg = metap->hashm_spares[splitnum] - 1;
+	last_page = max_ovflpg >> BMPG_SHIFT(metap);
+	last_bit = max_ovflpg & BMPG_MASK(metap);
+
 	/* outer loop iterates once per bitmap page */
-	for (;;)
+	for (; i <= last_page; i++)
 	{
-		BlockNumber mapblkno;
 		Page		mappage;
 		uint32		last_inpage;
 
-		/* want to end search with the last existing overflow page */
-		splitnum = metap->hashm_ovflpoint;
-		max_ovflpg = metap->hashm_spares[splitnum] - 1;
-		last_page = max_ovflpg >> BMPG_SHIFT(metap);
-		last_bit = max_ovflpg & BMPG_MASK(metap);
-
-		if (i > last_page)
-			break;
-
 		Assert(i < metap->hashm_nmaps);
 		mapblkno = metap->hashm_mapp[i];
 
@@ -220,9 +170,6 @@ _hash_getovflpage(Relation rel, Buffer metabuf)
 		else
 			last_inpage = BMPGSZ_BIT(metap) - 1;
 
-		/* Release exclusive lock on metapage while reading bitmap page */
-		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
-
 		mapbuf = _hash_getbuf(rel, mapblkno, HASH_WRITE, LH_BITMAP_PAGE);
 		mappage = BufferGetPage(mapbuf);
 		freep = HashPageGetBitmap(mappage);
@@ -230,107 +177,197 @@ _hash_getovflpage(Relation rel, Buffer metabuf)
 		for (; bit <= last_inpage; j++, bit += BITS_PER_MAP)
 		{
 			if (freep[j] != ALL_SET)
-				goto found;
+			{
+				found = true;
+				break;
+			}
 		}
+		if (found)
+			break;
 
 		/* No free space here, try to advance to next map page */
 		_hash_relbuf(rel, mapbuf);
-		i++;
+		mapbuf = InvalidBuffer;
 		j = 0;					/* scan from start of next map page */
 		bit = 0;
-
-		/* Reacquire exclusive lock on the meta page */
-		_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
 	}
 
-	/*
-	 * No free pages --- have to extend the relation to add an overflow page.
-	 * First, check to see if we have to add a new bitmap page too.
-	 */
-	if (last_bit == (uint32) (BMPGSZ_BIT(metap) - 1))
+	if (found)
 	{
-		/*
-		 * We create the new bitmap page with all pages marked "in use".
-		 * Actually two pages in the new bitmap's range will exist
-		 * immediately: the bitmap page itself, and the following page which
-		 * is the one we return to the caller.	Both of these are correctly
-		 * marked "in use".  Subsequent pages do not exist yet, but it is
-		 * convenient to pre-mark them as "in use" too.
-		 */
-		bit = metap->hashm_spares[splitnum];
-		_hash_initbitmap(rel, metap, bitno_to_blkno(metap, bit), MAIN_FORKNUM);
-		metap->hashm_spares[splitnum]++;
+		/* convert bit to bit number within page */
+		bit += _hash_firstfreebit(freep[j]);
+		mapbit = bit;
+
+		/* convert bit to absolute bit number */
+		bit += (i << BMPG_SHIFT(metap));
+
+		/* Calculate address of the recycled overflow page */
+		blkno = bitno_to_blkno(metap, bit);
+
+		/* Fetch and init the recycled page */
+		ovflbuf = _hash_getinitbuf(rel, blkno);
 	}
 	else
 	{
 		/*
-		 * Nothing to do here; since the page will be past the last used page,
-		 * we know its bitmap bit was preinitialized to "in use".
+		 * No free pages --- have to extend the relation to add an overflow
+		 * page.  First, check to see if we have to add a new bitmap page
+		 * too.
+		 */
+		mapblkno = InvalidBlockNumber;
+		bit = metap->hashm_spares[splitnum];
+		if (last_bit == (uint32) (BMPGSZ_BIT(metap) - 1))
+		{
+			/*
+			 * We create the new bitmap page with all pages marked "in use".
+			 * Actually two pages in the new bitmap's range will exist
+			 * immediately: the bitmap page itself, and the following page
+			 * which is the one we return to the caller.  Both of these are
+			 * correctly marked "in use".  Subsequent pages do not exist yet,
+			 * but it is convenient to pre-mark them as "in use" too.
+			 */
+			if (metap->hashm_nmaps >= HASH_MAX_BITMAPS)
+				ereport(ERROR,
+						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+						 errmsg("out of overflow pages in hash index \"%s\"",
+								RelationGetRelationName(rel))));
+
+			newmapblkno = bitno_to_blkno(metap, bit);
+			newmapbuf = _hash_getnewbuf(rel, newmapblkno, MAIN_FORKNUM);
+			bit++;
+		}
+		else
+		{
+			/*
+			 * Nothing to do here; since the page will be past the last used
+			 * page, we know its bitmap bit was preinitialized to "in use".
+			 */
+		}
+
+		/*
+		 * Calculate address of the new overflow page, and fetch it with
+		 * _hash_getnewbuf to ensure smgr's idea of the relation length stays
+		 * in sync with ours.  XXX It's annoying to do this with metapage
+		 * write lock held; would be better to use a lock that doesn't block
+		 * incoming searches.
 		 */
+		blkno = bitno_to_blkno(metap, bit);
+		ovflbuf = _hash_getnewbuf(rel, blkno, MAIN_FORKNUM);
 	}
 
-	/* Calculate address of the new overflow page */
-	bit = metap->hashm_spares[splitnum];
-	blkno = bitno_to_blkno(metap, bit);
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
 
-	/*
-	 * Fetch the page with _hash_getnewbuf to ensure smgr's idea of the
-	 * relation length stays in sync with ours.  XXX It's annoying to do this
-	 * with metapage write lock held; would be better to use a lock that
-	 * doesn't block incoming searches.
-	 */
-	newbuf = _hash_getnewbuf(rel, blkno, MAIN_FORKNUM);
+	if (BufferIsValid(mapbuf))
+	{
+		/* mark page "in use" in the bitmap */
+		SETBIT(freep, mapbit);
+		MarkBufferDirty(mapbuf);
+	}
 
-	metap->hashm_spares[splitnum]++;
+	if (BufferIsValid(newmapbuf))
+	{
+		/* add the new bitmap page to the metapage's list of bitmaps */
+		_hash_initbitmapbuffer(newmapbuf, metap->hashm_bmsize, false);
+		MarkBufferDirty(newmapbuf);
+
+		metap->hashm_mapp[metap->hashm_nmaps] = newmapblkno;
+		metap->hashm_nmaps++;
+		metap->hashm_spares[splitnum]++;
+	}
+
+	if (!found)
+		metap->hashm_spares[splitnum]++;
 
 	/*
-	 * Adjust hashm_firstfree to avoid redundant searches.	But don't risk
-	 * changing it if someone moved it while we were searching bitmap pages.
+	 * Adjust hashm_firstfree to avoid redundant searches.  Since we've held
+	 * the metapage lock all along, nobody can have moved it meanwhile.
 	 */
-	if (metap->hashm_firstfree == orig_firstfree)
-		metap->hashm_firstfree = bit + 1;
+	Assert(metap->hashm_firstfree == orig_firstfree);
+	metap->hashm_firstfree = bit + 1;
+	MarkBufferDirty(metabuf);
 
-	/* Write updated metapage and release lock, but not pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* initialize new overflow page, and chain it to the previous page */
+	ovflpage = BufferGetPage(ovflbuf);
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = BufferGetBlockNumber(buf);
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = pageopaque->hasho_bucket;
+	ovflopaque->hasho_flag = LH_OVERFLOW_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+	MarkBufferDirty(ovflbuf);
 
-	return newbuf;
+	pageopaque->hasho_nextblkno = BufferGetBlockNumber(ovflbuf);
+	MarkBufferDirty(buf);
 
-found:
-	/* convert bit to bit number within page */
-	bit += _hash_firstfreebit(freep[j]);
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[4];
+		xl_hash_add_ovfl_page xlrec;
+
+		xlrec.node = rel->rd_node;
+		xlrec.ovflblkno = BufferGetBlockNumber(ovflbuf);
+		xlrec.tailblkno = BufferGetBlockNumber(buf);
+		xlrec.bucket = pageopaque->hasho_bucket;
+		xlrec.mapblkno = BufferIsValid(mapbuf) ? mapblkno : InvalidBlockNumber;
+		xlrec.mapbit = mapbit;
+		xlrec.newmapblkno = newmapblkno;
+		xlrec.bmsize = metap->hashm_bmsize;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashAddOvflPage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = buf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		/* the metapage contents are not in the page's "standard" area */
+		rdata[2].data = (char *) metap;
+		rdata[2].len = sizeof(HashMetaPageData);
+		rdata[2].buffer = metabuf;
+		rdata[2].buffer_std = false;
+		rdata[2].next = NULL;
+
+		if (BufferIsValid(mapbuf))
+		{
+			rdata[2].next = &(rdata[3]);
+			rdata[3].data = NULL;
+			rdata[3].len = 0;
+			rdata[3].buffer = mapbuf;
+			rdata[3].buffer_std = false;
+			rdata[3].next = NULL;
+		}
 
-	/* mark page "in use" in the bitmap */
-	SETBIT(freep, bit);
-	_hash_wrtbuf(rel, mapbuf);
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_ADD_OVFL_PAGE, rdata);
 
-	/* Reacquire exclusive lock on the meta page */
-	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
+		PageSetLSN(ovflpage, recptr);
+		PageSetLSN(page, recptr);
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+		if (BufferIsValid(mapbuf))
+			PageSetLSN(BufferGetPage(mapbuf), recptr);
+		if (BufferIsValid(newmapbuf))
+			PageSetLSN(BufferGetPage(newmapbuf), recptr);
+	}
 
-	/* convert bit to absolute bit number */
-	bit += (i << BMPG_SHIFT(metap));
+	END_CRIT_SECTION();
 
-	/* Calculate address of the recycled overflow page */
-	blkno = bitno_to_blkno(metap, bit);
+	if (BufferIsValid(mapbuf))
+		_hash_relbuf(rel, mapbuf);
+	if (BufferIsValid(newmapbuf))
+		_hash_relbuf(rel, newmapbuf);
 
-	/*
-	 * Adjust hashm_firstfree to avoid redundant searches.	But don't risk
-	 * changing it if someone moved it while we were searching bitmap pages.
-	 */
-	if (metap->hashm_firstfree == orig_firstfree)
-	{
-		metap->hashm_firstfree = bit + 1;
+	/* release metapage lock, but not pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
 
-		/* Write updated metapage and release lock, but not pin */
-		_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
-	}
-	else
-	{
-		/* We didn't change the metapage, so no need to write */
-		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
-	}
+	_hash_relbuf(rel, buf);
 
-	/* Fetch, init, and return the recycled page */
-	return _hash_getinitbuf(rel, blkno);
+	return ovflbuf;
 }
 
 /*
@@ -362,6 +399,7 @@ _hash_firstfreebit(uint32 map)
  *
  *	Remove this overflow page from its bucket's chain, and mark the page as
  *	free.  On entry, ovflbuf is write-locked; it is released before exiting.
+ *	The page must not contain any tuples anymore.
  *
  *	Since this function is invoked in VACUUM, we provide an access strategy
  *	parameter that controls fetches of the bucket pages.
@@ -371,26 +409,33 @@ _hash_firstfreebit(uint32 map)
  *
  *	NB: caller must not hold lock on metapage, nor on either page that's
  *	adjacent in the bucket chain.  The caller had better hold exclusive lock
- *	on the bucket, too.
+ *	on the bucket, too; that's what makes it safe to lock the neighbouring
+ *	pages while holding the lock on the doomed page.  'bucket_blkno' is the
+ *	bucket's primary page, which WAL replay locks for cleanup.
  */
 BlockNumber
-_hash_freeovflpage(Relation rel, Buffer ovflbuf,
+_hash_freeovflpage(Relation rel, BlockNumber bucket_blkno, Buffer ovflbuf,
 				   BufferAccessStrategy bstrategy)
 {
 	HashMetaPage metap;
 	Buffer		metabuf;
 	Buffer		mapbuf;
+	Buffer		prevbuf;
+	Buffer		nextbuf = InvalidBuffer;
 	BlockNumber ovflblkno;
 	BlockNumber prevblkno;
 	BlockNumber blkno;
 	BlockNumber nextblkno;
 	HashPageOpaque ovflopaque;
+	HashPageOpaque prevopaque;
+	HashPageOpaque nextopaque = NULL;
 	Page		ovflpage;
 	Page		mappage;
 	uint32	   *freep;
 	uint32		ovflbitno;
 	int32		bitmappage,
 				bitmapbit;
+	bool		update_firstfree = false;
 	Bucket bucket PG_USED_FOR_ASSERTS_ONLY;
 
 	/* Get information from the doomed page */
@@ -401,54 +446,37 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 	nextblkno = ovflopaque->hasho_nextblkno;
 	prevblkno = ovflopaque->hasho_prevblkno;
 	bucket = ovflopaque->hasho_bucket;
+	Assert(PageGetMaxOffsetNumber(ovflpage) == 0);
 
 	/*
-	 * Zero the page for debugging's sake; then write and release it. (Note:
-	 * if we failed to zero the page here, we'd have problems with the Assert
-	 * in _hash_pageinit() when the page is reused.)
+	 * Lock the bucket chain members behind and ahead of the overflow page
+	 * being deleted, so that we can fix up the doubly-linked chain.  No
+	 * concurrency issues since we hold exclusive lock on the entire bucket.
 	 */
-	MemSet(ovflpage, 0, BufferGetPageSize(ovflbuf));
-	_hash_wrtbuf(rel, ovflbuf);
+	Assert(BlockNumberIsValid(prevblkno));
+	prevbuf = _hash_getbuf_with_strategy(rel,
+										 prevblkno,
+										 HASH_WRITE,
+										 LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
+										 bstrategy);
+	prevopaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(prevbuf));
+	Assert(prevopaque->hasho_bucket == bucket);
 
-	/*
-	 * Fix up the bucket chain.  this is a doubly-linked list, so we must fix
-	 * up the bucket chain members behind and ahead of the overflow page being
-	 * deleted.  No concurrency issues since we hold exclusive lock on the
-	 * entire bucket.
-	 */
-	if (BlockNumberIsValid(prevblkno))
-	{
-		Buffer		prevbuf = _hash_getbuf_with_strategy(rel,
-														 prevblkno,
-														 HASH_WRITE,
-										   LH_BUCKET_PAGE | LH_OVERFLOW_PAGE,
-														 bstrategy);
-		Page		prevpage = BufferGetPage(prevbuf);
-		HashPageOpaque prevopaque = (HashPageOpaque) PageGetSpecialPointer(prevpage);
-
-		Assert(prevopaque->hasho_bucket == bucket);
-		prevopaque->hasho_nextblkno = nextblkno;
-		_hash_wrtbuf(rel, prevbuf);
-	}
 	if (BlockNumberIsValid(nextblkno))
 	{
-		Buffer		nextbuf = _hash_getbuf_with_strategy(rel,
-														 nextblkno,
-														 HASH_WRITE,
-														 LH_OVERFLOW_PAGE,
-														 bstrategy);
-		Page		nextpage = BufferGetPage(nextbuf);
-		HashPageOpaque nextopaque = (HashPageOpaque) PageGetSpecialPointer(nextpage);
-
+		nextbuf = _hash_getbuf_with_strategy(rel,
+											 nextblkno,
+											 HASH_WRITE,
+											 LH_OVERFLOW_PAGE,
+											 bstrategy);
+		nextopaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(nextbuf));
 		Assert(nextopaque->hasho_bucket == bucket);
-		nextopaque->hasho_prevblkno = prevblkno;
-		_hash_wrtbuf(rel, nextbuf);
 	}
 
 	/* Note: bstrategy is intentionally not used for metapage and bitmap */
 
 	/* Read the metapage so we can determine which bitmap page to use */
-	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
+	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_WRITE, LH_META_PAGE);
 	metap = HashPageGetMeta(BufferGetPage(metabuf));
 
 	/* Identify which bit to set */
@@ -461,32 +489,130 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
 		elog(ERROR, "invalid overflow bit number %u", ovflbitno);
 	blkno = metap->hashm_mapp[bitmappage];
 
-	/* Release metapage lock while we access the bitmap page */
-	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
-
-	/* Clear the bitmap bit to indicate that this overflow page is free */
 	mapbuf = _hash_getbuf(rel, blkno, HASH_WRITE, LH_BITMAP_PAGE);
 	mappage = BufferGetPage(mapbuf);
 	freep = HashPageGetBitmap(mappage);
 	Assert(ISSET(freep, bitmapbit));
-	CLRBIT(freep, bitmapbit);
-	_hash_wrtbuf(rel, mapbuf);
 
-	/* Get write-lock on metapage to update firstfree */
-	_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_WRITE);
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	/*
+	 * Reinitialize the freed page.  (Note: if we failed to do that here,
+	 * stale tuples or links could confuse someone looking at the page before
+	 * it's reused.)
+	 */
+	_hash_pageinit(ovflpage, BufferGetPageSize(ovflbuf));
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = InvalidBlockNumber;
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = -1;
+	ovflopaque->hasho_flag = LH_UNUSED_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+	MarkBufferDirty(ovflbuf);
+
+	prevopaque->hasho_nextblkno = nextblkno;
+	MarkBufferDirty(prevbuf);
+
+	if (BufferIsValid(nextbuf))
+	{
+		nextopaque->hasho_prevblkno = prevblkno;
+		MarkBufferDirty(nextbuf);
+	}
+
+	/* Clear the bitmap bit to indicate that this overflow page is free */
+	CLRBIT(freep, bitmapbit);
+	MarkBufferDirty(mapbuf);
 
 	/* if this is now the first free page, update hashm_firstfree */
 	if (ovflbitno < metap->hashm_firstfree)
 	{
 		metap->hashm_firstfree = ovflbitno;
-		_hash_wrtbuf(rel, metabuf);
+		update_firstfree = true;
+		MarkBufferDirty(metabuf);
 	}
-	else
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
 	{
-		/* no need to change metapage */
-		_hash_relbuf(rel, metabuf);
+		XLogRecPtr	recptr;
+		XLogRecData rdata[5];
+		xl_hash_free_ovfl_page xlrec;
+		int			nextrdata;
+
+		xlrec.node = rel->rd_node;
+		xlrec.bucket_blkno = bucket_blkno;
+		xlrec.ovflblkno = ovflblkno;
+		xlrec.prevblkno = prevblkno;
+		xlrec.nextblkno = nextblkno;
+		xlrec.mapblkno = blkno;
+		xlrec.mapbit = bitmapbit;
+		xlrec.update_firstfree = update_firstfree;
+		xlrec.firstfree = metap->hashm_firstfree;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashFreeOvflPage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		/*
+		 * Everything else can be reconstructed from the main record, so the
+		 * other entries just register the buffers for full-page images.
+		 */
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = prevbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+		nextrdata = 2;
+
+		if (BufferIsValid(nextbuf))
+		{
+			rdata[nextrdata].data = NULL;
+			rdata[nextrdata].len = 0;
+			rdata[nextrdata].buffer = nextbuf;
+			rdata[nextrdata].buffer_std = true;
+			rdata[nextrdata].next = &(rdata[nextrdata + 1]);
+			nextrdata++;
+		}
+
+		rdata[nextrdata].data = NULL;
+		rdata[nextrdata].len = 0;
+		rdata[nextrdata].buffer = mapbuf;
+		rdata[nextrdata].buffer_std = false;
+		rdata[nextrdata].next = NULL;
+
+		if (update_firstfree)
+		{
+			rdata[nextrdata].next = &(rdata[nextrdata + 1]);
+			nextrdata++;
+			rdata[nextrdata].data = NULL;
+			rdata[nextrdata].len = 0;
+			rdata[nextrdata].buffer = metabuf;
+			rdata[nextrdata].buffer_std = false;
+			rdata[nextrdata].next = NULL;
+		}
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_FREE_OVFL_PAGE, rdata);
+
+		PageSetLSN(ovflpage, recptr);
+		PageSetLSN(BufferGetPage(prevbuf), recptr);
+		if (BufferIsValid(nextbuf))
+			PageSetLSN(BufferGetPage(nextbuf), recptr);
+		PageSetLSN(mappage, recptr);
+		if (update_firstfree)
+			PageSetLSN(BufferGetPage(metabuf), recptr);
 	}
 
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, mapbuf);
+	_hash_relbuf(rel, metabuf);
+	if (BufferIsValid(nextbuf))
+		_hash_relbuf(rel, nextbuf);
+	_hash_relbuf(rel, prevbuf);
+	_hash_relbuf(rel, ovflbuf);
+
 	return nextblkno;
 }
 
@@ -500,15 +626,16 @@ _hash_freeovflpage(Relation rel, Buffer ovflbuf,
  * 'blkno' is the block number of the new bitmap page.
  *
  * All bits in the new bitmap page are set to "1", indicating "in use".
+ *
+ * This is used only while building a new index; the bitmap pages added later
+ * are set up by _hash_addovflpage.  The page is WAL-logged as a full-page
+ * image if needed.
  */
 void
 _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
 				 ForkNumber forkNum)
 {
 	Buffer		buf;
-	Page		pg;
-	HashPageOpaque op;
-	uint32	   *freep;
 
 	/*
 	 * It is okay to write-lock the new bitmap page while holding metapage
@@ -521,8 +648,55 @@ _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
 	 * that it's not worth worrying about.
 	 */
 	buf = _hash_getnewbuf(rel, blkno, forkNum);
+
+	/* add the new bitmap page to the metapage's list of bitmaps */
+	/* metapage already has a write lock */
+	if (metap->hashm_nmaps >= HASH_MAX_BITMAPS)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("out of overflow pages in hash index \"%s\"",
+						RelationGetRelationName(rel))));
+
+	START_CRIT_SECTION();
+
+	_hash_initbitmapbuffer(buf, BMPGSZ_BYTE(metap), false);
+	MarkBufferDirty(buf);
+
+	/* the bitmap is not in the page's "standard" area, so log it all */
+	if (RelationNeedsWAL(rel) || forkNum == INIT_FORKNUM)
+		log_newpage_buffer(buf, false);
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, buf);
+
+	metap->hashm_mapp[metap->hashm_nmaps] = blkno;
+
+	metap->hashm_nmaps++;
+}
+
+/*
+ *	_hash_initbitmapbuffer()
+ *
+ *	 Initialize the page in 'buf' as a bitmap page with all of its 'bmsize'
+ *	 bytes of bits set to "1".  If 'initpage' is true, the page header is
+ *	 initialized too; otherwise it's assumed to be set up already.
+ *
+ * This is shared with WAL replay, so it must not fail; the caller is
+ * responsible for marking the buffer dirty.
+ */
+void
+_hash_initbitmapbuffer(Buffer buf, uint16 bmsize, bool initpage)
+{
+	Page		pg;
+	HashPageOpaque op;
+	uint32	   *freep;
+
 	pg = BufferGetPage(buf);
 
+	if (initpage)
+		_hash_pageinit(pg, BufferGetPageSize(buf));
+
 	/* initialize the page's special space */
 	op = (HashPageOpaque) PageGetSpecialPointer(pg);
 	op->hasho_prevblkno = InvalidBlockNumber;
@@ -533,24 +707,85 @@ _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
 
 	/* set all of the bits to 1 */
 	freep = HashPageGetBitmap(pg);
-	MemSet(freep, 0xFF, BMPGSZ_BYTE(metap));
+	MemSet(freep, 0xFF, bmsize);
+}
 
-	/* write out the new bitmap page (releasing write lock and pin) */
-	_hash_wrtbuf(rel, buf);
 
-	/* add the new bitmap page to the metapage's list of bitmaps */
-	/* metapage already has a write lock */
-	if (metap->hashm_nmaps >= HASH_MAX_BITMAPS)
-		ereport(ERROR,
-				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
-				 errmsg("out of overflow pages in hash index \"%s\"",
-						RelationGetRelationName(rel))));
+/*
+ * Log and apply the moving of ntups tuples onto the "write" page and the
+ * removal of ndeletable tuples from the "read" page, for
+ * _hash_squeezebucket.  The tuples are known to fit.
+ */
+static void
+_hash_squeeze_movetuples(Relation rel, BlockNumber bucket_blkno,
+						 Buffer wbuf, Buffer rbuf,
+						 IndexTuple *itups, Size *itupsizes, int ntups,
+						 char *tupdata, Size tupdatalen,
+						 OffsetNumber *deletable, int ndeletable)
+{
+	OffsetNumber itup_offsets[MaxIndexTuplesPerPage];
+	int			i;
 
-	metap->hashm_mapp[metap->hashm_nmaps] = blkno;
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
 
-	metap->hashm_nmaps++;
-}
+	/*
+	 * Insert on the "write" page, being careful to preserve hashkey
+	 * ordering.  (If we insert many tuples into the same "write" page it
+	 * would be worth qsort'ing instead of doing repeated _hash_pgaddtup.)
+	 */
+	for (i = 0; i < ntups; i++)
+		itup_offsets[i] = _hash_pgaddtup(rel, wbuf, itupsizes[i], itups[i]);
+	MarkBufferDirty(wbuf);
 
+	PageIndexMultiDelete(BufferGetPage(rbuf), deletable, ndeletable);
+	MarkBufferDirty(rbuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[4];
+		xl_hash_move_page_contents xlrec;
+
+		xlrec.node = rel->rd_node;
+		xlrec.bucket_blkno = bucket_blkno;
+		xlrec.wblkno = BufferGetBlockNumber(wbuf);
+		xlrec.rblkno = BufferGetBlockNumber(rbuf);
+		xlrec.ntups = ntups;
+		xlrec.ndeleted = ndeletable;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashMovePageContents;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = (char *) itup_offsets;
+		rdata[1].len = ntups * sizeof(OffsetNumber);
+		rdata[1].buffer = wbuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		rdata[2].data = tupdata;
+		rdata[2].len = tupdatalen;
+		rdata[2].buffer = wbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = &(rdata[3]);
+
+		rdata[3].data = (char *) deletable;
+		rdata[3].len = ndeletable * sizeof(OffsetNumber);
+		rdata[3].buffer = rbuf;
+		rdata[3].buffer_std = true;
+		rdata[3].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_MOVE_PAGE_CONTENTS, rdata);
+
+		PageSetLSN(BufferGetPage(wbuf), recptr);
+		PageSetLSN(BufferGetPage(rbuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+}
 
 /*
  *	_hash_squeezebucket(rel, bucket)
@@ -570,6 +805,11 @@ _hash_initbitmap(Relation rel, HashMetaPage metap, BlockNumber blkno,
  *	required that to be true on entry as well, but it's a lot easier for
  *	callers to leave empty overflow pages and let this guy clean it up.
  *
+ *	Tuples are moved in batches: each time the write page fills up, or the
+ *	read page is exhausted, the tuples moved so far are added to the write
+ *	page and removed from the read page, and that is WAL-logged as one
+ *	record.  Emptied read pages are then freed with _hash_freeovflpage.
+ *
  *	Caller must hold exclusive lock on the target bucket.  This allows
  *	us to safely lock multiple pages in the bucket.
  *
@@ -590,7 +830,7 @@ _hash_squeezebucket(Relation rel,
 	Page		rpage;
 	HashPageOpaque wopaque;
 	HashPageOpaque ropaque;
-	bool		wbuf_dirty;
+	char	   *tupdata;
 
 	/*
 	 * start squeezing into the base bucket page.
@@ -636,16 +876,21 @@ _hash_squeezebucket(Relation rel,
 		Assert(ropaque->hasho_bucket == bucket);
 	} while (BlockNumberIsValid(ropaque->hasho_nextblkno));
 
+	/* space to collect copies of the tuples to move to the write page */
+	tupdata = palloc(BLCKSZ);
+
 	/*
 	 * squeeze the tuples.
 	 */
-	wbuf_dirty = false;
 	for (;;)
 	{
 		OffsetNumber roffnum;
 		OffsetNumber maxroffnum;
 		OffsetNumber deletable[MaxOffsetNumber];
+		IndexTuple	itups[MaxIndexTuplesPerPage];
+		Size		itupsizes[MaxIndexTuplesPerPage];
 		int			ndeletable = 0;
+		Size		tupdatalen = 0;
 
 		/* Scan each tuple in "read" page */
 		maxroffnum = PageGetMaxOffsetNumber(rpage);
@@ -663,31 +908,34 @@ _hash_squeezebucket(Relation rel,
 
 			/*
 			 * Walk up the bucket chain, looking for a page big enough for
-			 * this item.  Exit if we reach the read page.
+			 * this item and all the others we have collected for the current
+			 * write page.  Exit if we reach the read page.
 			 */
-			while (PageGetFreeSpace(wpage) < itemsz)
+			while (PageGetFreeSpace(wpage) <
+				   tupdatalen + itemsz + ndeletable * sizeof(ItemIdData))
 			{
-				Assert(!PageIsEmpty(wpage));
+				bool		retain_read_page = false;
+
+				/* Move what we've got onto the current write page */
+				if (ndeletable > 0)
+				{
+					_hash_squeeze_movetuples(rel, bucket_blkno, wbuf, rbuf,
+											 itups, itupsizes, ndeletable,
+											 tupdata, tupdatalen,
+											 deletable, ndeletable);
+					retain_read_page = true;
+				}
 
 				wblkno = wopaque->hasho_nextblkno;
 				Assert(BlockNumberIsValid(wblkno));
 
-				if (wbuf_dirty)
-					_hash_wrtbuf(rel, wbuf);
-				else
-					_hash_relbuf(rel, wbuf);
+				_hash_relbuf(rel, wbuf);
 
 				/* nothing more to do if we reached the read page */
 				if (rblkno == wblkno)
 				{
-					if (ndeletable > 0)
-					{
-						/* Delete tuples we already moved off read page */
-						PageIndexMultiDelete(rpage, deletable, ndeletable);
-						_hash_wrtbuf(rel, rbuf);
-					}
-					else
-						_hash_relbuf(rel, rbuf);
+					_hash_relbuf(rel, rbuf);
+					pfree(tupdata);
 					return;
 				}
 
@@ -699,27 +947,41 @@ _hash_squeezebucket(Relation rel,
 				wpage = BufferGetPage(wbuf);
 				wopaque = (HashPageOpaque) PageGetSpecialPointer(wpage);
 				Assert(wopaque->hasho_bucket == bucket);
-				wbuf_dirty = false;
-			}
 
-			/*
-			 * we have found room so insert on the "write" page, being careful
-			 * to preserve hashkey ordering.  (If we insert many tuples into
-			 * the same "write" page it would be worth qsort'ing instead of
-			 * doing repeated _hash_pgaddtup.)
-			 */
-			(void) _hash_pgaddtup(rel, wbuf, itemsz, itup);
-			wbuf_dirty = true;
+				/*
+				 * If we moved some tuples off the read page, the remaining
+				 * ones have been renumbered; rescan it from the start.
+				 */
+				if (retain_read_page)
+				{
+					ndeletable = 0;
+					tupdatalen = 0;
+					maxroffnum = PageGetMaxOffsetNumber(rpage);
+					roffnum = FirstOffsetNumber;
+					itup = (IndexTuple) PageGetItem(rpage,
+											PageGetItemId(rpage, roffnum));
+				}
+			}
 
-			/* remember tuple for deletion from "read" page */
+			/* remember tuple for moving to the "write" page */
+			memcpy(tupdata + tupdatalen, itup, IndexTupleDSize(*itup));
+			itups[ndeletable] = (IndexTuple) (tupdata + tupdatalen);
+			itupsizes[ndeletable] = itemsz;
+			tupdatalen += itemsz;
 			deletable[ndeletable++] = roffnum;
 		}
 
+		/* Move whatever is left on the read page */
+		if (ndeletable > 0)
+			_hash_squeeze_movetuples(rel, bucket_blkno, wbuf, rbuf,
+									 itups, itupsizes, ndeletable,
+									 tupdata, tupdatalen,
+									 deletable, ndeletable);
+
 		/*
 		 * If we reach here, there are no live tuples on the "read" page ---
 		 * it was empty when we got to it, or we moved them all.  So we can
-		 * just free the page without bothering with deleting tuples
-		 * individually.  Then advance to the previous "read" page.
+		 * just free the page.  Then advance to the previous "read" page.
 		 *
 		 * Tricky point here: if our read and write pages are adjacent in the
 		 * bucket chain, our write lock on wbuf will conflict with
@@ -734,18 +996,16 @@ _hash_squeezebucket(Relation rel,
 		if (rblkno == wblkno)
 		{
 			/* yes, so release wbuf lock first */
-			if (wbuf_dirty)
-				_hash_wrtbuf(rel, wbuf);
-			else
-				_hash_relbuf(rel, wbuf);
+			_hash_relbuf(rel, wbuf);
 			/* free this overflow page (releases rbuf) */
-			_hash_freeovflpage(rel, rbuf, bstrategy);
+			_hash_freeovflpage(rel, bucket_blkno, rbuf, bstrategy);
 			/* done */
+			pfree(tupdata);
 			return;
 		}
 
 		/* free this overflow page, then get the previous one */
-		_hash_freeovflpage(rel, rbuf, bstrategy);
+		_hash_freeovflpage(rel, bucket_blkno, rbuf, bstrategy);
 
 		rbuf = _hash_getbuf_with_strategy(rel,
 										  rblkno,
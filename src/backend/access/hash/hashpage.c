@@ -29,9 +29,12 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/heapam_xlog.h"
 #include "miscadmin.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 
 
 static bool _hash_alloc_buckets(Relation rel, BlockNumber firstblock,
@@ -41,7 +44,8 @@ static void _hash_splitbucket(Relation rel, Buffer metabuf,
 				  BlockNumber start_oblkno,
 				  BlockNumber start_nblkno,
 				  uint32 maxbucket,
-				  uint32 highmask, uint32 lowmask);
+				  uint32 highmask, uint32 lowmask,
+				  HTAB *htab);
 
 
 /*
@@ -262,25 +266,6 @@ _hash_dropbuf(Relation rel, Buffer buf)
 	ReleaseBuffer(buf);
 }
 
-/*
- *	_hash_wrtbuf() -- write a hash page to disk.
- *
- *		This routine releases the lock held on the buffer and our refcount
- *		for it.  It is an error to call _hash_wrtbuf() without a write lock
- *		and a pin on the buffer.
- *
- * NOTE: this routine should go away when/if hash indexes are WAL-ified.
- * The correct sequence of operations is to mark the buffer dirty, then
- * write the WAL record, then release the lock and pin; so marking dirty
- * can't be combined with releasing.
- */
-void
-_hash_wrtbuf(Relation rel, Buffer buf)
-{
-	MarkBufferDirty(buf);
-	UnlockReleaseBuffer(buf);
-}
-
 /*
  * _hash_chgbufaccess() -- Change the lock type on a buffer, without
  *			dropping our pin on it.
@@ -308,6 +293,140 @@ _hash_chgbufaccess(Relation rel,
 }
 
 
+/*
+ *	_hash_getcachedmetap() -- Returns cached metapage data.
+ *
+ *	To avoid reading and locking the metapage for every search and insertion,
+ *	we keep a copy of its contents in the index's relcache entry
+ *	(rd_amcache).  The copy may be stale; callers that map a hash key to a
+ *	bucket with it must check that the bucket hasn't been split since the
+ *	copy was taken, and call us again with force_refresh = true if it has.
+ *	See _hash_getbucketbuf_from_hashkey.
+ *
+ *	The result points into the relcache entry, so it must not be modified.
+ */
+HashMetaPage
+_hash_getcachedmetap(Relation rel, bool force_refresh)
+{
+	if (force_refresh || rel->rd_amcache == NULL)
+	{
+		Buffer		metabuf;
+		char	   *cache = NULL;
+
+		metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
+
+		if (rel->rd_amcache == NULL)
+			cache = MemoryContextAlloc(rel->rd_indexcxt,
+									   sizeof(HashMetaPageData));
+		else
+			cache = rel->rd_amcache;
+
+		memcpy(cache, HashPageGetMeta(BufferGetPage(metabuf)),
+			   sizeof(HashMetaPageData));
+		rel->rd_amcache = cache;
+
+		_hash_relbuf(rel, metabuf);
+	}
+
+	return (HashMetaPage) rel->rd_amcache;
+}
+
+/*
+ *	_hash_getbucketbuf_from_hashkey() -- Get the primary bucket page for
+ *				the bucket a hash key maps to.
+ *
+ *	On return, we hold a share lock on the bucket (the heavyweight one,
+ *	see README), and the bucket's primary page is pinned and locked in the
+ *	'access' mode.  If cachedmetap is not NULL, *cachedmetap is set to the
+ *	cached metapage data that was used; it's valid at least as far as the
+ *	returned bucket is concerned.
+ *
+ *	The bucket is computed from the cached metapage, which might be stale.
+ *	But once we hold the bucket lock, the bucket cannot be split, and the
+ *	primary page records the value hashm_maxbucket had when it was last
+ *	split: if our copy of the metapage is at least that new, the key still
+ *	maps to this bucket.  Otherwise we refresh the cache and try again.
+ */
+Buffer
+_hash_getbucketbuf_from_hashkey(Relation rel, uint32 hashkey, int access,
+								HashMetaPage *cachedmetap)
+{
+	HashMetaPage metap;
+	Buffer		buf;
+	Bucket		bucket;
+	BlockNumber blkno;
+	Page		page;
+	HashPageOpaque opaque;
+
+	metap = _hash_getcachedmetap(rel, false);
+
+	/*
+	 * Loop until we get a lock on the correct target bucket.
+	 */
+	for (;;)
+	{
+		/*
+		 * Compute the target bucket number, and convert to block number.
+		 */
+		bucket = _hash_hashkey2bucket(hashkey,
+									  metap->hashm_maxbucket,
+									  metap->hashm_highmask,
+									  metap->hashm_lowmask);
+
+		blkno = BUCKET_TO_BLKNO(metap, bucket);
+
+		/* Lock the bucket, and fetch its primary page */
+		_hash_getlock(rel, blkno, HASH_SHARE);
+
+		buf = _hash_getbuf(rel, blkno, access, LH_BUCKET_PAGE);
+		page = BufferGetPage(buf);
+		opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+		Assert(opaque->hasho_bucket == bucket);
+
+		/* If the bucket hasn't been split since our copy was taken, done */
+		if (opaque->hasho_prevblkno <= metap->hashm_maxbucket)
+			break;
+
+		/* Drop the lock and try again with a fresh copy of the metapage */
+		_hash_relbuf(rel, buf);
+		_hash_droplock(rel, blkno, HASH_SHARE);
+		metap = _hash_getcachedmetap(rel, true);
+	}
+
+	if (cachedmetap)
+		*cachedmetap = metap;
+
+	return buf;
+}
+
+/*
+ *	_hash_dropscanbuf() -- release the buffers and bucket locks of a scan.
+ */
+void
+_hash_dropscanbuf(Relation rel, HashScanOpaque so)
+{
+	/* release any pin we still hold */
+	if (BufferIsValid(so->hashso_curbuf))
+		_hash_dropbuf(rel, so->hashso_curbuf);
+	so->hashso_curbuf = InvalidBuffer;
+
+	/* release pin and lock on the bucket(s), too */
+	if (BufferIsValid(so->hashso_bucket_buf))
+		_hash_dropbuf(rel, so->hashso_bucket_buf);
+	so->hashso_bucket_buf = InvalidBuffer;
+	if (so->hashso_bucket_blkno)
+		_hash_droplock(rel, so->hashso_bucket_blkno, HASH_SHARE);
+	so->hashso_bucket_blkno = 0;
+
+	if (BufferIsValid(so->hashso_old_bucket_buf))
+		_hash_dropbuf(rel, so->hashso_old_bucket_buf);
+	so->hashso_old_bucket_buf = InvalidBuffer;
+	if (so->hashso_old_bucket_blkno)
+		_hash_droplock(rel, so->hashso_old_bucket_blkno, HASH_SHARE);
+	so->hashso_old_bucket_blkno = 0;
+}
+
+
 /*
  *	_hash_metapinit() -- Initialize the metadata page of a hash index,
  *				the initial buckets, and the initial bitmap page.
@@ -319,6 +438,9 @@ _hash_chgbufaccess(Relation rel,
  * We are fairly cavalier about locking here, since we know that no one else
  * could be accessing this index.  In particular the rule about not holding
  * multiple buffer locks is ignored.
+ *
+ * Each page is WAL-logged as a full-page image, if the index needs WAL or
+ * we are building the init fork of an unlogged index.
  */
 uint32
 _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
@@ -335,6 +457,7 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 	uint32		num_buckets;
 	uint32		log2_num_buckets;
 	uint32		i;
+	bool		use_wal;
 
 	/* safety check */
 	if (RelationGetNumberOfBlocksInFork(rel, forkNum) != 0)
@@ -374,6 +497,8 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 	Assert(num_buckets == (((uint32) 1) << log2_num_buckets));
 	Assert(log2_num_buckets < HASH_MAX_SPLITPOINTS);
 
+	use_wal = RelationNeedsWAL(rel) || forkNum == INIT_FORKNUM;
+
 	/*
 	 * We initialize the metapage, the first N bucket pages, and the first
 	 * bitmap page in sequence, using _hash_getnewbuf to cause smgrextend()
@@ -450,13 +575,23 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 
 		buf = _hash_getnewbuf(rel, BUCKET_TO_BLKNO(metap, i), forkNum);
 		pg = BufferGetPage(buf);
+
+		START_CRIT_SECTION();
+
 		pageopaque = (HashPageOpaque) PageGetSpecialPointer(pg);
-		pageopaque->hasho_prevblkno = InvalidBlockNumber;
+		pageopaque->hasho_prevblkno = metap->hashm_maxbucket;
 		pageopaque->hasho_nextblkno = InvalidBlockNumber;
 		pageopaque->hasho_bucket = i;
 		pageopaque->hasho_flag = LH_BUCKET_PAGE;
 		pageopaque->hasho_page_id = HASHO_PAGE_ID;
-		_hash_wrtbuf(rel, buf);
+		MarkBufferDirty(buf);
+
+		if (use_wal)
+			log_newpage_buffer(buf, true);
+
+		END_CRIT_SECTION();
+
+		_hash_relbuf(rel, buf);
 	}
 
 	/* Now reacquire buffer lock on metapage */
@@ -467,19 +602,30 @@ _hash_metapinit(Relation rel, double num_tuples, ForkNumber forkNum)
 	 */
 	_hash_initbitmap(rel, metap, num_buckets + 1, forkNum);
 
-	/* all done */
-	_hash_wrtbuf(rel, metabuf);
+	/* all done; the metadata is not in the page's "standard" area */
+	START_CRIT_SECTION();
+
+	MarkBufferDirty(metabuf);
+
+	if (use_wal)
+		log_newpage_buffer(metabuf, false);
+
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, metabuf);
 
 	return num_buckets;
 }
 
 /*
  *	_hash_pageinit() -- Initialize a new hash index page.
+ *
+ * The page need not be new: freed overflow pages are reinitialized when
+ * they are reused.
  */
 void
 _hash_pageinit(Page page, Size size)
 {
-	Assert(PageIsNew(page));
 	PageInit(page, size, sizeof(HashPageOpaqueData));
 }
 
@@ -492,6 +638,29 @@ _hash_pageinit(Page page, Size size)
  *
  * The caller must hold a pin, but no lock, on the metapage buffer.
  * The buffer is returned in the same state.
+ *
+ * A split goes through these steps (see README for the details):
+ *
+ * 1. With exclusive locks on both buckets, and the metapage lock, update
+ * the metapage, mark the old bucket as being split and initialize the new
+ * bucket's primary page, marked as being populated.  Then downgrade the
+ * lock on the old bucket to a share lock, letting readers and inserters
+ * back in; only the new bucket stays locked.
+ *
+ * 2. Copy the tuples that belong in the new bucket from the old one
+ * (_hash_splitbucket).  The old bucket is not modified.
+ *
+ * 3. Clear the split flags, marking the old bucket as needing cleanup, and
+ * release the lock on the new bucket.
+ *
+ * 4. If we can get an exclusive lock on the old bucket without waiting,
+ * remove the tuples that were copied, and compact it.  Otherwise, that is
+ * left for VACUUM or for the next split of this bucket.
+ *
+ * If we fail or crash in step 2, the new bucket is left marked as being
+ * populated.  Scans of it read the old bucket instead, and the split is
+ * finished by the next insertion into the new bucket, the next attempt to
+ * split the old bucket, or VACUUM.
  */
 void
 _hash_expandtable(Relation rel, Buffer metabuf)
@@ -502,6 +671,12 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	uint32		spare_ndx;
 	BlockNumber start_oblkno;
 	BlockNumber start_nblkno;
+	Buffer		obuf;
+	Buffer		nbuf;
+	Page		opage;
+	Page		npage;
+	HashPageOpaque oopaque;
+	HashPageOpaque nopaque;
 	uint32		maxbucket;
 	uint32		highmask;
 	uint32		lowmask;
@@ -562,6 +737,58 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 	if (!_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
 		goto fail;
 
+	/*
+	 * Fetch the old bucket's primary page.  Locking it while holding the
+	 * metapage lock is okay, since our exclusive lock on the bucket means
+	 * nobody else can hold a lock on any of its pages.
+	 */
+	obuf = _hash_getbuf(rel, start_oblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+
+	/*
+	 * We can't start a new split of the bucket until any previous split
+	 * involving it is complete, and its tuples that were copied elsewhere
+	 * have been removed.  Try to get that done instead; the next insertion
+	 * will retry the split.
+	 */
+	if (H_BUCKET_BEING_POPULATED(oopaque) || H_BUCKET_BEING_SPLIT(oopaque) ||
+		H_NEEDS_SPLIT_CLEANUP(oopaque))
+	{
+		maxbucket = metap->hashm_maxbucket;
+		highmask = metap->hashm_highmask;
+		lowmask = metap->hashm_lowmask;
+
+		/* We didn't write the metapage, so just drop lock */
+		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+		if (H_BUCKET_BEING_POPULATED(oopaque))
+		{
+			/* this bucket is the new half of an unfinished split */
+			_hash_relbuf(rel, obuf);
+			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+			(void) _hash_finish_split(rel, old_bucket, false);
+		}
+		else if (H_BUCKET_BEING_SPLIT(oopaque))
+		{
+			/* the new bucket is recorded in hasho_prevblkno */
+			Bucket		nbucket = oopaque->hasho_prevblkno;
+
+			_hash_relbuf(rel, obuf);
+			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+			(void) _hash_finish_split(rel, nbucket, false);
+		}
+		else
+		{
+			_hash_relbuf(rel, obuf);
+			hashbucketcleanup(rel, old_bucket, start_oblkno, NULL,
+							  maxbucket, highmask, lowmask,
+							  NULL, NULL, true, NULL, NULL);
+			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+		}
+		return;
+	}
+
 	/*
 	 * Likewise lock the new bucket (should never fail).
 	 *
@@ -596,14 +823,20 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 		if (!_hash_alloc_buckets(rel, start_nblkno, new_bucket))
 		{
 			/* can't split due to BlockNumber overflow */
+			_hash_relbuf(rel, obuf);
 			_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
 			_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
 			goto fail;
 		}
 	}
 
+	/* Get the new bucket's primary page */
+	nbuf = _hash_getnewbuf(rel, start_nblkno, MAIN_FORKNUM);
+	npage = BufferGetPage(nbuf);
+
 	/*
-	 * Okay to proceed with split.	Update the metapage bucket mapping info.
+	 * Okay to proceed with split.	Update the metapage bucket mapping info,
+	 * and set up the primary pages of both buckets.
 	 *
 	 * Since we are scribbling on the metapage data right in the shared
 	 * buffer, any failure in this next little bit leaves us with a big
@@ -634,32 +867,113 @@ _hash_expandtable(Relation rel, Buffer metabuf)
 		metap->hashm_ovflpoint = spare_ndx;
 	}
 
-	/* Done mucking with metapage */
+	MarkBufferDirty(metabuf);
+
+	/*
+	 * Mark the old bucket as being split, and record the new maxbucket in it
+	 * so that backends using a stale cached metapage notice the split.
+	 */
+	oopaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+	oopaque->hasho_prevblkno = new_bucket;
+	MarkBufferDirty(obuf);
+
+	/* initialize the new bucket's primary page */
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+	nopaque->hasho_prevblkno = new_bucket;
+	nopaque->hasho_nextblkno = InvalidBlockNumber;
+	nopaque->hasho_bucket = new_bucket;
+	nopaque->hasho_flag = LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED;
+	nopaque->hasho_page_id = HASHO_PAGE_ID;
+	MarkBufferDirty(nbuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+		xl_hash_split_allocate_page xlrec;
+
+		xlrec.node = rel->rd_node;
+		xlrec.new_bucket = new_bucket;
+		xlrec.old_blkno = start_oblkno;
+		xlrec.new_blkno = start_nblkno;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashSplitAllocatePage;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		/* the new page is reinitialized from scratch during replay */
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = obuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		rdata[2].data = (char *) metap;
+		rdata[2].len = sizeof(HashMetaPageData);
+		rdata[2].buffer = metabuf;
+		rdata[2].buffer_std = false;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_ALLOCATE_PAGE, rdata);
+
+		PageSetLSN(BufferGetPage(metabuf), recptr);
+		PageSetLSN(opage, recptr);
+		PageSetLSN(npage, recptr);
+	}
+
 	END_CRIT_SECTION();
 
 	/*
 	 * Copy bucket mapping info now; this saves re-accessing the meta page
 	 * inside _hash_splitbucket's inner loop.  Note that once we drop the
-	 * split lock, other splits could begin, so these values might be out of
-	 * date before _hash_splitbucket finishes.	That's okay, since all it
+	 * metapage lock, other splits could begin, so these values might be out
+	 * of date before _hash_splitbucket finishes.  That's okay, since all it
 	 * needs is to tell which of these two buckets to map hashkeys into.
 	 */
 	maxbucket = metap->hashm_maxbucket;
 	highmask = metap->hashm_highmask;
 	lowmask = metap->hashm_lowmask;
 
-	/* Write out the metapage and drop lock, but keep pin */
-	_hash_chgbufaccess(rel, metabuf, HASH_WRITE, HASH_NOLOCK);
+	/* Drop the metapage lock (it's already marked dirty), but keep pin */
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
+	_hash_relbuf(rel, obuf);
+	_hash_relbuf(rel, nbuf);
+
+	/*
+	 * Let readers and inserters back into the old bucket.  Acquire the share
+	 * lock before releasing the exclusive one, so that no other split can
+	 * sneak in.
+	 */
+	_hash_getlock(rel, start_oblkno, HASH_SHARE);
+	_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
 
-	/* Relocate records to the new bucket */
+	/* Copy records to the new bucket */
 	_hash_splitbucket(rel, metabuf, old_bucket, new_bucket,
 					  start_oblkno, start_nblkno,
-					  maxbucket, highmask, lowmask);
+					  maxbucket, highmask, lowmask, NULL);
 
-	/* Release bucket locks, allowing others to access them */
-	_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+	/* Release the new bucket, allowing others to access it */
 	_hash_droplock(rel, start_nblkno, HASH_EXCLUSIVE);
 
+	/*
+	 * Finally, remove the copied tuples from the old bucket, if we can get an
+	 * exclusive lock on it right away.
+	 */
+	if (!_hash_has_active_scan(rel, old_bucket) &&
+		_hash_try_getlock(rel, start_oblkno, HASH_EXCLUSIVE))
+	{
+		_hash_droplock(rel, start_oblkno, HASH_SHARE);
+		hashbucketcleanup(rel, old_bucket, start_oblkno, NULL,
+						  maxbucket, highmask, lowmask,
+						  NULL, NULL, true, NULL, NULL);
+		_hash_droplock(rel, start_oblkno, HASH_EXCLUSIVE);
+	}
+	else
+		_hash_droplock(rel, start_oblkno, HASH_SHARE);
+
 	return;
 
 	/* Here if decide not to split or fail to acquire old bucket lock */
@@ -678,18 +992,20 @@ fail:
  * EOF to the end of the splitpoint; this keeps smgr's idea of the EOF in
  * sync with ours, so that we don't get complaints from smgr.
  *
- * We do this by writing a page of zeroes at the end of the splitpoint range.
- * We expect that the filesystem will ensure that the intervening pages read
- * as zeroes too.  On many filesystems this "hole" will not be allocated
- * immediately, which means that the index file may end up more fragmented
- * than if we forced it all to be allocated now; but since we don't scan
- * hash indexes sequentially anyway, that probably doesn't matter.
+ * We do this by writing a page at the end of the splitpoint range,
+ * initialized as an unused page.  We expect that the filesystem will ensure
+ * that the intervening pages read as zeroes.  On many filesystems this
+ * "hole" will not be allocated immediately, which means that the index file
+ * may end up more fragmented than if we forced it all to be allocated now;
+ * but since we don't scan hash indexes sequentially anyway, that probably
+ * doesn't matter.  The page is WAL-logged, so that replay extends the
+ * index the same way.
  *
  * XXX It's annoying that this code is executed with the metapage lock held.
- * We need to interlock against _hash_getovflpage() adding a new overflow page
- * concurrently, but it'd likely be better to use LockRelationForExtension
- * for the purpose.  OTOH, adding a splitpoint is a very infrequent operation,
- * so it may not be worth worrying about.
+ * We need to interlock against _hash_addovflpage() adding a new overflow
+ * page concurrently, but it'd likely be better to use
+ * LockRelationForExtension for the purpose.  OTOH, adding a splitpoint is a
+ * very infrequent operation, so it may not be worth worrying about.
  *
  * Returns TRUE if successful, or FALSE if allocation failed due to
  * BlockNumber overflow.
@@ -699,6 +1015,8 @@ _hash_alloc_buckets(Relation rel, BlockNumber firstblock, uint32 nblocks)
 {
 	BlockNumber lastblock;
 	char		zerobuf[BLCKSZ];
+	Page		page;
+	HashPageOpaque ovflopaque;
 
 	lastblock = firstblock + nblocks - 1;
 
@@ -709,9 +1027,26 @@ _hash_alloc_buckets(Relation rel, BlockNumber firstblock, uint32 nblocks)
 	if (lastblock < firstblock || lastblock == InvalidBlockNumber)
 		return false;
 
-	MemSet(zerobuf, 0, sizeof(zerobuf));
+	page = (Page) zerobuf;
+
+	/*
+	 * Initialize the page.  Just zeroing the page won't work; see
+	 * _hash_freeovflpage for similar usage.
+	 */
+	_hash_pageinit(page, BLCKSZ);
+
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	ovflopaque->hasho_prevblkno = InvalidBlockNumber;
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = -1;
+	ovflopaque->hasho_flag = LH_UNUSED_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+
+	if (RelationNeedsWAL(rel))
+		log_newpage(&rel->rd_node, MAIN_FORKNUM, lastblock, zerobuf, true);
 
 	RelationOpenSmgr(rel);
+	PageSetChecksumInplace(page, lastblock);
 	smgrextend(rel->rd_smgr, MAIN_FORKNUM, lastblock, zerobuf, false);
 
 	return true;
@@ -719,19 +1054,32 @@ _hash_alloc_buckets(Relation rel, BlockNumber firstblock, uint32 nblocks)
 
 
 /*
- * _hash_splitbucket -- split 'obucket' into 'obucket' and 'nbucket'
+ * _hash_splitbucket -- copy tuples from 'obucket' to 'nbucket'
  *
  * We are splitting a bucket that consists of a base bucket page and zero
- * or more overflow (bucket chain) pages.  We must relocate tuples that
- * belong in the new bucket, and compress out any free space in the old
- * bucket.
+ * or more overflow (bucket chain) pages.  We must copy the tuples that
+ * belong in the new bucket to it.  The tuples are not removed from the old
+ * bucket yet; that's left for _hash_expandtable (or VACUUM), since it
+ * needs an exclusive lock on the old bucket.
+ *
+ * The tuples are collected in local memory until they fill a page of the
+ * new bucket, and then added to the page and WAL-logged in one go, as a
+ * full-page image.  After the last page is done, we clear the split flags
+ * on both buckets and mark the old bucket as needing cleanup.
+ *
+ * If 'htab' is not NULL, it contains the TIDs of the tuples that are in the
+ * new bucket already, because we're finishing an interrupted split; those
+ * are skipped.  The new tuples are appended to the end of the new bucket's
+ * chain.
  *
- * The caller must hold exclusive locks on both buckets to ensure that
- * no one else is trying to access them (see README).
+ * The caller must hold an exclusive lock on the new bucket, and at least a
+ * share lock on the old bucket.  Since nobody else can access the new
+ * bucket, it's okay to lock its pages while holding locks on pages of the
+ * old bucket.
  *
  * The caller must hold a pin, but no lock, on the metapage buffer.
  * The buffer is returned in the same state.  (The metapage is only
- * touched if it becomes necessary to add or remove overflow pages.)
+ * touched if it becomes necessary to add overflow pages.)
  */
 static void
 _hash_splitbucket(Relation rel,
@@ -742,7 +1090,8 @@ _hash_splitbucket(Relation rel,
 				  BlockNumber start_nblkno,
 				  uint32 maxbucket,
 				  uint32 highmask,
-				  uint32 lowmask)
+				  uint32 lowmask,
+				  HTAB *htab)
 {
 	BlockNumber oblkno;
 	BlockNumber nblkno;
@@ -752,41 +1101,43 @@ _hash_splitbucket(Relation rel,
 	Page		npage;
 	HashPageOpaque oopaque;
 	HashPageOpaque nopaque;
+	IndexTuple	itups[MaxIndexTuplesPerPage];
+	Size		all_tups_size = 0;
+	int			nitups = 0;
+	int			i;
 
-	/*
-	 * It should be okay to simultaneously write-lock pages from each bucket,
-	 * since no one else can be trying to acquire buffer lock on pages of
-	 * either bucket.
-	 */
-	oblkno = start_oblkno;
-	obuf = _hash_getbuf(rel, oblkno, HASH_WRITE, LH_BUCKET_PAGE);
-	opage = BufferGetPage(obuf);
-	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
-
+	/* Find the end of the new bucket's chain */
 	nblkno = start_nblkno;
-	nbuf = _hash_getnewbuf(rel, nblkno, MAIN_FORKNUM);
+	nbuf = _hash_getbuf(rel, nblkno, HASH_WRITE, LH_BUCKET_PAGE);
 	npage = BufferGetPage(nbuf);
-
-	/* initialize the new bucket's primary page */
 	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
-	nopaque->hasho_prevblkno = InvalidBlockNumber;
-	nopaque->hasho_nextblkno = InvalidBlockNumber;
-	nopaque->hasho_bucket = nbucket;
-	nopaque->hasho_flag = LH_BUCKET_PAGE;
-	nopaque->hasho_page_id = HASHO_PAGE_ID;
+	Assert(H_BUCKET_BEING_POPULATED(nopaque));
+	while (BlockNumberIsValid(nopaque->hasho_nextblkno))
+	{
+		nblkno = nopaque->hasho_nextblkno;
+		_hash_relbuf(rel, nbuf);
+		nbuf = _hash_getbuf(rel, nblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
+		npage = BufferGetPage(nbuf);
+		nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+	}
 
 	/*
-	 * Partition the tuples in the old bucket between the old bucket and the
-	 * new bucket, advancing along the old bucket's overflow bucket chain and
-	 * adding overflow pages to the new bucket as needed.  Outer loop iterates
-	 * once per page in old bucket.
+	 * Collect the tuples in the old bucket that belong in the new bucket,
+	 * advancing along the old bucket's overflow bucket chain and adding
+	 * overflow pages to the new bucket as needed.  Outer loop iterates once
+	 * per page in old bucket.
 	 */
-	for (;;)
+	oblkno = start_oblkno;
+	while (BlockNumberIsValid(oblkno))
 	{
 		OffsetNumber ooffnum;
 		OffsetNumber omaxoffnum;
-		OffsetNumber deletable[MaxOffsetNumber];
-		int			ndeletable = 0;
+
+		obuf = _hash_getbuf(rel, oblkno, HASH_READ,
+							LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
+		opage = BufferGetPage(obuf);
+		oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+		Assert(oopaque->hasho_bucket == obucket);
 
 		/* Scan each tuple in old page */
 		omaxoffnum = PageGetMaxOffsetNumber(opage);
@@ -798,89 +1149,295 @@ _hash_splitbucket(Relation rel,
 			Size		itemsz;
 			Bucket		bucket;
 
+			itup = (IndexTuple) PageGetItem(opage,
+											PageGetItemId(opage, ooffnum));
+
 			/*
 			 * Fetch the item's hash key (conveniently stored in the item) and
 			 * determine which bucket it now belongs in.
 			 */
-			itup = (IndexTuple) PageGetItem(opage,
-											PageGetItemId(opage, ooffnum));
 			bucket = _hash_hashkey2bucket(_hash_get_indextuple_hashkey(itup),
 										  maxbucket, highmask, lowmask);
+			if (bucket != nbucket)
+			{
+				/* the tuple stays where it is */
+				Assert(bucket == obucket);
+				continue;
+			}
 
-			if (bucket == nbucket)
+			/* skip it if an earlier attempt already copied it */
+			if (htab)
 			{
-				/*
-				 * insert the tuple into the new bucket.  if it doesn't fit on
-				 * the current page in the new bucket, we must allocate a new
-				 * overflow page and place the tuple on that page instead.
-				 */
-				itemsz = IndexTupleDSize(*itup);
-				itemsz = MAXALIGN(itemsz);
-
-				if (PageGetFreeSpace(npage) < itemsz)
-				{
-					/* write out nbuf and drop lock, but keep pin */
-					_hash_chgbufaccess(rel, nbuf, HASH_WRITE, HASH_NOLOCK);
-					/* chain to a new overflow page */
-					nbuf = _hash_addovflpage(rel, metabuf, nbuf);
-					npage = BufferGetPage(nbuf);
-					/* we don't need nblkno or nopaque within the loop */
-				}
-
-				/*
-				 * Insert tuple on new page, using _hash_pgaddtup to ensure
-				 * correct ordering by hashkey.  This is a tad inefficient
-				 * since we may have to shuffle itempointers repeatedly.
-				 * Possible future improvement: accumulate all the items for
-				 * the new page and qsort them before insertion.
-				 */
-				(void) _hash_pgaddtup(rel, nbuf, itemsz, itup);
-
-				/*
-				 * Mark tuple for deletion from old page.
-				 */
-				deletable[ndeletable++] = ooffnum;
+				bool		found;
+
+				(void) hash_search(htab, &itup->t_tid, HASH_FIND, &found);
+				if (found)
+					continue;
 			}
-			else
+
+			itemsz = IndexTupleDSize(*itup);
+			itemsz = MAXALIGN(itemsz);
+
+			/*
+			 * If the tuple doesn't fit on the current page of the new bucket
+			 * along with the ones collected so far, write those out and
+			 * chain to a new overflow page.
+			 */
+			if (PageGetFreeSpace(npage) <
+				all_tups_size + itemsz + nitups * sizeof(ItemIdData))
 			{
-				/*
-				 * the tuple stays on this page, so nothing to do.
-				 */
-				Assert(bucket == obucket);
+				START_CRIT_SECTION();
+
+				for (i = 0; i < nitups; i++)
+					(void) _hash_pgaddtup(rel, nbuf,
+										  MAXALIGN(IndexTupleDSize(*itups[i])),
+										  itups[i]);
+				MarkBufferDirty(nbuf);
+
+				if (RelationNeedsWAL(rel))
+					log_newpage_buffer(nbuf, true);
+
+				END_CRIT_SECTION();
+
+				for (i = 0; i < nitups; i++)
+					pfree(itups[i]);
+				nitups = 0;
+				all_tups_size = 0;
+
+				/* chain to a new overflow page */
+				nbuf = _hash_addovflpage(rel, metabuf, nbuf);
+				npage = BufferGetPage(nbuf);
 			}
+
+			itups[nitups++] = CopyIndexTuple(itup);
+			all_tups_size += itemsz;
 		}
 
 		oblkno = oopaque->hasho_nextblkno;
+		_hash_relbuf(rel, obuf);
 
-		/*
-		 * Done scanning this old page.  If we moved any tuples, delete them
-		 * from the old page.
-		 */
-		if (ndeletable > 0)
+		/* check for interrupts while we're not holding any buffer lock */
+		if (BlockNumberIsValid(oblkno))
 		{
-			PageIndexMultiDelete(opage, deletable, ndeletable);
-			_hash_wrtbuf(rel, obuf);
+			_hash_chgbufaccess(rel, nbuf, HASH_READ, HASH_NOLOCK);
+			CHECK_FOR_INTERRUPTS();
+			_hash_chgbufaccess(rel, nbuf, HASH_NOLOCK, HASH_WRITE);
 		}
-		else
-			_hash_relbuf(rel, obuf);
+	}
 
-		/* Exit loop if no more overflow pages in old bucket */
-		if (!BlockNumberIsValid(oblkno))
-			break;
+	/*
+	 * We're at the end of the old bucket chain, so we're done partitioning
+	 * the tuples.  Write out the last page of the new bucket, even if there
+	 * is nothing to add (so that its image in the WAL is up to date).
+	 */
+	START_CRIT_SECTION();
 
-		/* Else, advance to next old page */
-		obuf = _hash_getbuf(rel, oblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
-		opage = BufferGetPage(obuf);
-		oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+	for (i = 0; i < nitups; i++)
+		(void) _hash_pgaddtup(rel, nbuf,
+							  MAXALIGN(IndexTupleDSize(*itups[i])),
+							  itups[i]);
+	MarkBufferDirty(nbuf);
+
+	if (RelationNeedsWAL(rel))
+		log_newpage_buffer(nbuf, true);
+
+	END_CRIT_SECTION();
+
+	for (i = 0; i < nitups; i++)
+		pfree(itups[i]);
+
+	_hash_relbuf(rel, nbuf);
+
+	/*
+	 * Now clear the split flags.  The primary pages of the buckets are locked
+	 * in bucket order, new bucket first; nobody else locks pages of the new
+	 * bucket while we hold our bucket lock on it, so there is no deadlock
+	 * risk.
+	 */
+	nbuf = _hash_getbuf(rel, start_nblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	npage = BufferGetPage(nbuf);
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+
+	obuf = _hash_getbuf(rel, start_oblkno, HASH_WRITE, LH_BUCKET_PAGE);
+	opage = BufferGetPage(obuf);
+	oopaque = (HashPageOpaque) PageGetSpecialPointer(opage);
+
+	START_CRIT_SECTION();
+
+	oopaque->hasho_flag &= ~LH_BUCKET_BEING_SPLIT;
+	oopaque->hasho_flag |= LH_BUCKET_NEEDS_SPLIT_CLEANUP;
+	MarkBufferDirty(obuf);
+
+	nopaque->hasho_flag &= ~LH_BUCKET_BEING_POPULATED;
+	MarkBufferDirty(nbuf);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		XLogRecPtr	recptr;
+		XLogRecData rdata[3];
+		xl_hash_split_complete xlrec;
+
+		xlrec.node = rel->rd_node;
+		xlrec.old_blkno = start_oblkno;
+		xlrec.new_blkno = start_nblkno;
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfHashSplitComplete;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = obuf;
+		rdata[1].buffer_std = true;
+		rdata[1].next = &(rdata[2]);
+
+		rdata[2].data = NULL;
+		rdata[2].len = 0;
+		rdata[2].buffer = nbuf;
+		rdata[2].buffer_std = true;
+		rdata[2].next = NULL;
+
+		recptr = XLogInsert(RM_HASH_ID, XLOG_HASH_SPLIT_COMPLETE, rdata);
+
+		PageSetLSN(opage, recptr);
+		PageSetLSN(npage, recptr);
 	}
 
+	END_CRIT_SECTION();
+
+	_hash_relbuf(rel, obuf);
+	_hash_relbuf(rel, nbuf);
+}
+
+/*
+ * _hash_finish_split -- finish an interrupted split into bucket 'nbucket'
+ *
+ * This is used when the primary page of 'nbucket' (or of the bucket it is
+ * being split from) is found with the split flags set, while nobody holds
+ * the bucket locks needed to do the split: the backend doing the split must
+ * have errored out or crashed.  We copy the tuples that are still missing
+ * from the new bucket, and mark the split complete.  Removing the copied
+ * tuples from the old bucket is left for later, as usual.
+ *
+ * If 'wait' is false, we give up rather than wait for the bucket locks.
+ * Returns true if the split is known to be complete when we return.
+ *
+ * The caller must hold no locks on the index.
+ */
+bool
+_hash_finish_split(Relation rel, Bucket nbucket, bool wait)
+{
+	Buffer		metabuf;
+	HashMetaPage metap;
+	Bucket		obucket;
+	BlockNumber oblkno;
+	BlockNumber nblkno;
+	uint32		maxbucket;
+	uint32		highmask;
+	uint32		lowmask;
+	Buffer		nbuf;
+	Page		npage;
+	HashPageOpaque nopaque;
+	HASHCTL		hash_ctl;
+	HTAB	   *tidhtab;
+	BlockNumber blkno;
+
+	obucket = _hash_get_oldbucket(nbucket);
+
+	/* Read the metapage to locate the buckets; keep the pin */
+	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
+	metap = HashPageGetMeta(BufferGetPage(metabuf));
+	Assert(nbucket <= metap->hashm_maxbucket);
+	oblkno = BUCKET_TO_BLKNO(metap, obucket);
+	nblkno = BUCKET_TO_BLKNO(metap, nbucket);
+	maxbucket = metap->hashm_maxbucket;
+	highmask = metap->hashm_highmask;
+	lowmask = metap->hashm_lowmask;
+	_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
+
 	/*
-	 * We're at the end of the old bucket chain, so we're done partitioning
-	 * the tuples.	Before quitting, call _hash_squeezebucket to ensure the
-	 * tuples remaining in the old bucket (including the overflow pages) are
-	 * packed as tightly as possible.  The new bucket is already tight.
+	 * Lock the new bucket exclusively, and then the old one in share mode;
+	 * see README for the lock ordering rules.  Scans of our own backend that
+	 * are redirected to the old bucket don't stop us, since we don't modify
+	 * the old bucket.
 	 */
-	_hash_wrtbuf(rel, nbuf);
+	if (wait)
+		_hash_getlock(rel, nblkno, HASH_EXCLUSIVE);
+	else if (!_hash_try_getlock(rel, nblkno, HASH_EXCLUSIVE))
+	{
+		_hash_dropbuf(rel, metabuf);
+		return false;
+	}
+
+	/* Check whether someone else has finished it meanwhile */
+	nbuf = _hash_getbuf(rel, nblkno, HASH_READ, LH_BUCKET_PAGE);
+	nopaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(nbuf));
+	if (!H_BUCKET_BEING_POPULATED(nopaque))
+	{
+		_hash_relbuf(rel, nbuf);
+		_hash_droplock(rel, nblkno, HASH_EXCLUSIVE);
+		_hash_dropbuf(rel, metabuf);
+		return true;
+	}
+	_hash_relbuf(rel, nbuf);
 
-	_hash_squeezebucket(rel, obucket, start_oblkno, NULL);
+	if (wait)
+		_hash_getlock(rel, oblkno, HASH_SHARE);
+	else if (!_hash_try_getlock(rel, oblkno, HASH_SHARE))
+	{
+		_hash_droplock(rel, nblkno, HASH_EXCLUSIVE);
+		_hash_dropbuf(rel, metabuf);
+		return false;
+	}
+
+	/* Remember the TIDs of the tuples that were copied already */
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(ItemPointerData);
+	hash_ctl.entrysize = sizeof(ItemPointerData);
+	hash_ctl.hash = tag_hash;
+	hash_ctl.hcxt = CurrentMemoryContext;
+	tidhtab = hash_create("bucket ctids",
+						  256,	/* arbitrary initial size */
+						  &hash_ctl,
+						  HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+
+	blkno = nblkno;
+	while (BlockNumberIsValid(blkno))
+	{
+		OffsetNumber offnum;
+		OffsetNumber maxoffnum;
+
+		nbuf = _hash_getbuf(rel, blkno, HASH_READ,
+							LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
+		npage = BufferGetPage(nbuf);
+		nopaque = (HashPageOpaque) PageGetSpecialPointer(npage);
+
+		maxoffnum = PageGetMaxOffsetNumber(npage);
+		for (offnum = FirstOffsetNumber;
+			 offnum <= maxoffnum;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			IndexTuple	itup;
+
+			itup = (IndexTuple) PageGetItem(npage,
+											PageGetItemId(npage, offnum));
+			(void) hash_search(tidhtab, &itup->t_tid, HASH_ENTER, NULL);
+		}
+
+		blkno = nopaque->hasho_nextblkno;
+		_hash_relbuf(rel, nbuf);
+	}
+
+	_hash_splitbucket(rel, metabuf, obucket, nbucket, oblkno, nblkno,
+					  maxbucket, highmask, lowmask, tidhtab);
+
+	hash_destroy(tidhtab);
+
+	_hash_droplock(rel, oblkno, HASH_SHARE);
+	_hash_droplock(rel, nblkno, HASH_EXCLUSIVE);
+	_hash_dropbuf(rel, metabuf);
+
+	return true;
 }
@@ -146,6 +146,11 @@ _hash_has_active_scan(Relation rel, Bucket bucket)
 			if (so->hashso_bucket_valid &&
 				so->hashso_bucket == bucket)
 				return true;
+
+			/* a scan of an unfinished split's new bucket reads the old one */
+			if (so->hashso_old_bucket_blkno != 0 &&
+				so->hashso_old_bucket == bucket)
+				return true;
 		}
 	}
 
@@ -92,13 +92,16 @@ _hash_readprev(Relation rel,
 			   Buffer *bufp, Page *pagep, HashPageOpaque *opaquep)
 {
 	BlockNumber blkno;
+	bool		haveprev;
 
+	/* a bucket's primary page uses hasho_prevblkno for something else */
+	haveprev = ((*opaquep)->hasho_flag & LH_BUCKET_PAGE) == 0;
 	blkno = (*opaquep)->hasho_prevblkno;
 	_hash_relbuf(rel, *bufp);
 	*bufp = InvalidBuffer;
 	/* check for interrupts while we're not holding any buffer lock */
 	CHECK_FOR_INTERRUPTS();
-	if (BlockNumberIsValid(blkno))
+	if (haveprev && BlockNumberIsValid(blkno))
 	{
 		*bufp = _hash_getbuf(rel, blkno, HASH_READ,
 							 LH_BUCKET_PAGE | LH_OVERFLOW_PAGE);
@@ -125,10 +128,7 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 	uint32		hashkey;
 	Bucket		bucket;
 	BlockNumber blkno;
-	BlockNumber oldblkno = InvalidBuffer;
-	bool		retry = false;
 	Buffer		buf;
-	Buffer		metabuf;
 	Page		page;
 	HashPageOpaque opaque;
 	HashMetaPage metap;
@@ -186,63 +186,52 @@ _hash_first(IndexScanDesc scan, ScanDirection dir)
 
 	so->hashso_sk_hash = hashkey;
 
-	/* Read the metapage */
-	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_READ, LH_META_PAGE);
-	metap = HashPageGetMeta(BufferGetPage(metabuf));
+	/* Lock the target bucket, and read-lock its primary page */
+	buf = _hash_getbucketbuf_from_hashkey(rel, hashkey, HASH_READ, &metap);
+	page = BufferGetPage(buf);
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	bucket = opaque->hasho_bucket;
+	blkno = BufferGetBlockNumber(buf);
 
 	/*
-	 * Loop until we get a lock on the correct target bucket.
+	 * Update scan opaque state to show we have lock on the bucket.  We also
+	 * keep a pin on its primary page for as long as the scan is in the
+	 * bucket; see README.
 	 */
-	for (;;)
-	{
-		/*
-		 * Compute the target bucket number, and convert to block number.
-		 */
-		bucket = _hash_hashkey2bucket(hashkey,
-									  metap->hashm_maxbucket,
-									  metap->hashm_highmask,
-									  metap->hashm_lowmask);
-
-		blkno = BUCKET_TO_BLKNO(metap, bucket);
-
-		/* Release metapage lock, but keep pin. */
-		_hash_chgbufaccess(rel, metabuf, HASH_READ, HASH_NOLOCK);
-
-		/*
-		 * If the previous iteration of this loop locked what is still the
-		 * correct target bucket, we are done.	Otherwise, drop any old lock
-		 * and lock what now appears to be the correct bucket.
-		 */
-		if (retry)
-		{
-			if (oldblkno == blkno)
-				break;
-			_hash_droplock(rel, oldblkno, HASH_SHARE);
-		}
-		_hash_getlock(rel, blkno, HASH_SHARE);
-
-		/*
-		 * Reacquire metapage lock and check that no bucket split has taken
-		 * place while we were awaiting the bucket lock.
-		 */
-		_hash_chgbufaccess(rel, metabuf, HASH_NOLOCK, HASH_READ);
-		oldblkno = blkno;
-		retry = true;
-	}
-
-	/* done with the metapage */
-	_hash_dropbuf(rel, metabuf);
-
-	/* Update scan opaque state to show we have lock on the bucket */
 	so->hashso_bucket = bucket;
 	so->hashso_bucket_valid = true;
 	so->hashso_bucket_blkno = blkno;
+	IncrBufferRefCount(buf);
+	so->hashso_bucket_buf = buf;
 
-	/* Fetch the primary bucket page for the bucket */
-	buf = _hash_getbuf(rel, blkno, HASH_READ, LH_BUCKET_PAGE);
-	page = BufferGetPage(buf);
-	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
-	Assert(opaque->hasho_bucket == bucket);
+	/*
+	 * If the bucket is the new half of a split that was interrupted, not all
+	 * of its tuples have been copied to it yet, but they are all still in
+	 * the old bucket; so scan that instead.  Nobody can finish the split
+	 * while we hold our lock on the new bucket.
+	 */
+	if (H_BUCKET_BEING_POPULATED(opaque))
+	{
+		Bucket		old_bucket;
+		BlockNumber old_blkno;
+
+		_hash_relbuf(rel, buf);
+
+		old_bucket = _hash_get_oldbucket(bucket);
+		old_blkno = BUCKET_TO_BLKNO(metap, old_bucket);
+
+		_hash_getlock(rel, old_blkno, HASH_SHARE);
+		so->hashso_old_bucket = old_bucket;
+		so->hashso_old_bucket_blkno = old_blkno;
+
+		buf = _hash_getbuf(rel, old_blkno, HASH_READ, LH_BUCKET_PAGE);
+		IncrBufferRefCount(buf);
+		so->hashso_old_bucket_buf = buf;
+
+		page = BufferGetPage(buf);
+		opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+		Assert(opaque->hasho_bucket == old_bucket);
+	}
 
 	/* If a backwards scan is requested, move to the end of the chain */
 	if (ScanDirectionIsBackward(dir))
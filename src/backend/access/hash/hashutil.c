@@ -146,6 +146,19 @@ _hash_log2(uint32 num)
 	return i;
 }
 
+/*
+ * _hash_get_oldbucket -- returns the bucket that new_bucket was split from
+ *
+ * That's new_bucket with its most significant bit cleared.
+ */
+Bucket
+_hash_get_oldbucket(Bucket new_bucket)
+{
+	Assert(new_bucket > 0);
+
+	return new_bucket & ~(1 << (_hash_log2(new_bucket + 1) - 1));
+}
+
 /*
  * _hash_checkpage -- sanity checks on the format of all hash pages
  *
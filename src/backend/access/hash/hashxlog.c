@@ -0,0 +1,503 @@
+/*-------------------------------------------------------------------------
+ *
+ * hashxlog.c
+ *	  WAL replay logic for hash indexes.
+ *
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/hash/hashxlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/xlogutils.h"
+
+
+/*
+ * Get a cleanup lock on the primary page of a bucket, before removing or
+ * moving tuples anywhere in the bucket.  Scans in hot standby keep a pin on
+ * the primary page of the bucket they're in, so this makes us wait for them
+ * to finish with the bucket; see README.
+ *
+ * Returns InvalidBuffer if the page doesn't exist anymore.
+ */
+static Buffer
+hash_xlog_lock_bucket(RelFileNode node, BlockNumber bucket_blkno)
+{
+	Buffer		buffer;
+
+	buffer = XLogReadBufferExtended(node, MAIN_FORKNUM, bucket_blkno,
+									RBM_NORMAL);
+	if (BufferIsValid(buffer))
+		LockBufferForCleanup(buffer);
+	return buffer;
+}
+
+/*
+ * Restore backup block 'block_index', or read the page with the given block
+ * number if there's no backup block.  If the page is returned, it's locked
+ * exclusively (or for cleanup, if get_cleanup_lock), and needs replaying.
+ * Otherwise InvalidBuffer is returned.
+ */
+static Buffer
+hash_xlog_read_page(XLogRecPtr lsn, XLogRecord *record, int block_index,
+					RelFileNode node, BlockNumber blkno, bool get_cleanup_lock)
+{
+	Buffer		buffer;
+
+	if (record->xl_info & XLR_BKP_BLOCK(block_index))
+	{
+		(void) RestoreBackupBlock(lsn, record, block_index,
+								  get_cleanup_lock, false);
+		return InvalidBuffer;
+	}
+
+	if (get_cleanup_lock)
+	{
+		buffer = XLogReadBufferExtended(node, MAIN_FORKNUM, blkno, RBM_NORMAL);
+		if (BufferIsValid(buffer))
+			LockBufferForCleanup(buffer);
+	}
+	else
+		buffer = XLogReadBuffer(node, blkno, false);
+
+	if (!BufferIsValid(buffer))
+		return InvalidBuffer;
+
+	if (lsn <= PageGetLSN(BufferGetPage(buffer)))
+	{
+		UnlockReleaseBuffer(buffer);
+		return InvalidBuffer;
+	}
+
+	return buffer;
+}
+
+/* Finish replaying a change to a page returned by hash_xlog_read_page */
+static void
+hash_xlog_finish_page(XLogRecPtr lsn, Buffer buffer)
+{
+	PageSetLSN(BufferGetPage(buffer), lsn);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+/* Reinitialize a page from scratch */
+static Buffer
+hash_xlog_init_page(RelFileNode node, BlockNumber blkno)
+{
+	Buffer		buffer;
+
+	buffer = XLogReadBuffer(node, blkno, true);
+	Assert(BufferIsValid(buffer));
+	_hash_pageinit(BufferGetPage(buffer), BufferGetPageSize(buffer));
+	return buffer;
+}
+
+static void
+hash_xlog_insert(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_insert *xlrec = (xl_hash_insert *) XLogRecGetData(record);
+	Buffer		buffer;
+
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, xlrec->blkno,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		char	   *datapos = (char *) xlrec + SizeOfHashInsert;
+		Size		datalen = record->xl_len - SizeOfHashInsert;
+
+		if (PageAddItem(BufferGetPage(buffer), (Item) datapos, datalen,
+						xlrec->offnum, false, false) == InvalidOffsetNumber)
+			elog(PANIC, "hash_xlog_insert: failed to add item");
+
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	buffer = hash_xlog_read_page(lsn, record, 1, xlrec->node, HASH_METAPAGE,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(buffer));
+
+		metap->hashm_ntuples += 1;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+}
+
+static void
+hash_xlog_add_ovfl_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+	HashPageOpaque opaque;
+
+	/* the new overflow page, and new bitmap page, are rebuilt from scratch */
+	buffer = hash_xlog_init_page(xlrec->node, xlrec->ovflblkno);
+	page = BufferGetPage(buffer);
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = xlrec->tailblkno;
+	opaque->hasho_nextblkno = InvalidBlockNumber;
+	opaque->hasho_bucket = xlrec->bucket;
+	opaque->hasho_flag = LH_OVERFLOW_PAGE;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_finish_page(lsn, buffer);
+
+	if (BlockNumberIsValid(xlrec->newmapblkno))
+	{
+		buffer = XLogReadBuffer(xlrec->node, xlrec->newmapblkno, true);
+		Assert(BufferIsValid(buffer));
+		_hash_initbitmapbuffer(buffer, xlrec->bmsize, true);
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	/* link the tail page to it */
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, xlrec->tailblkno,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+		opaque->hasho_nextblkno = xlrec->ovflblkno;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	/* the metapage contents are included in full */
+	buffer = hash_xlog_read_page(lsn, record, 1, xlrec->node, HASH_METAPAGE,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		memcpy(HashPageGetMeta(BufferGetPage(buffer)),
+			   (char *) xlrec + SizeOfHashAddOvflPage,
+			   sizeof(HashMetaPageData));
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	/* mark the recycled page as in use */
+	if (BlockNumberIsValid(xlrec->mapblkno))
+	{
+		buffer = hash_xlog_read_page(lsn, record, 2, xlrec->node,
+									 xlrec->mapblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			uint32	   *freep = HashPageGetBitmap(BufferGetPage(buffer));
+
+			SETBIT(freep, xlrec->mapbit);
+			hash_xlog_finish_page(lsn, buffer);
+		}
+	}
+}
+
+static void
+hash_xlog_split_allocate_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_allocate_page *xlrec = (xl_hash_split_allocate_page *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+	HashPageOpaque opaque;
+
+	/* mark the old bucket as being split */
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, xlrec->old_blkno,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+		opaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+		opaque->hasho_prevblkno = xlrec->new_bucket;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	/* initialize the new bucket's primary page */
+	buffer = hash_xlog_init_page(xlrec->node, xlrec->new_blkno);
+	page = BufferGetPage(buffer);
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = xlrec->new_bucket;
+	opaque->hasho_nextblkno = InvalidBlockNumber;
+	opaque->hasho_bucket = xlrec->new_bucket;
+	opaque->hasho_flag = LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_finish_page(lsn, buffer);
+
+	/* the metapage contents are included in full */
+	buffer = hash_xlog_read_page(lsn, record, 1, xlrec->node, HASH_METAPAGE,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		memcpy(HashPageGetMeta(BufferGetPage(buffer)),
+			   (char *) xlrec + SizeOfHashSplitAllocatePage,
+			   sizeof(HashMetaPageData));
+		hash_xlog_finish_page(lsn, buffer);
+	}
+}
+
+static void
+hash_xlog_split_complete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_complete *xlrec = (xl_hash_split_complete *) XLogRecGetData(record);
+	Buffer		buffer;
+	HashPageOpaque opaque;
+
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, xlrec->old_blkno,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+		opaque->hasho_flag &= ~LH_BUCKET_BEING_SPLIT;
+		opaque->hasho_flag |= LH_BUCKET_NEEDS_SPLIT_CLEANUP;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	/*
+	 * Scans of the new bucket that were redirected to the old bucket must be
+	 * done before the new bucket stops being marked as populated.
+	 */
+	buffer = hash_xlog_read_page(lsn, record, 1, xlrec->node, xlrec->new_blkno,
+								 true);
+	if (BufferIsValid(buffer))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+		opaque->hasho_flag &= ~LH_BUCKET_BEING_POPULATED;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+}
+
+static void
+hash_xlog_split_cleanup(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_cleanup *xlrec = (xl_hash_split_cleanup *) XLogRecGetData(record);
+	Buffer		buffer;
+
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node,
+								 xlrec->bucket_blkno, false);
+	if (BufferIsValid(buffer))
+	{
+		HashPageOpaque opaque;
+
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+		opaque->hasho_flag &= ~LH_BUCKET_NEEDS_SPLIT_CLEANUP;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+}
+
+static void
+hash_xlog_delete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_delete *xlrec = (xl_hash_delete *) XLogRecGetData(record);
+	Buffer		bucketbuf = InvalidBuffer;
+	Buffer		buffer;
+	bool		is_primary = (xlrec->blkno == xlrec->bucket_blkno);
+
+	if (!is_primary)
+		bucketbuf = hash_xlog_lock_bucket(xlrec->node, xlrec->bucket_blkno);
+
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, xlrec->blkno,
+								 is_primary);
+	if (BufferIsValid(buffer))
+	{
+		OffsetNumber *unused;
+		OffsetNumber *unend;
+
+		unused = (OffsetNumber *) ((char *) xlrec + SizeOfHashDelete);
+		unend = (OffsetNumber *) ((char *) xlrec + record->xl_len);
+
+		if ((unend - unused) > 0)
+			PageIndexMultiDelete(BufferGetPage(buffer), unused, unend - unused);
+
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	if (BufferIsValid(bucketbuf))
+		UnlockReleaseBuffer(bucketbuf);
+}
+
+static void
+hash_xlog_move_page_contents(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_move_page_contents *xlrec = (xl_hash_move_page_contents *) XLogRecGetData(record);
+	Buffer		bucketbuf = InvalidBuffer;
+	Buffer		buffer;
+	bool		is_primary = (xlrec->wblkno == xlrec->bucket_blkno);
+	char	   *ptr;
+
+	if (!is_primary)
+		bucketbuf = hash_xlog_lock_bucket(xlrec->node, xlrec->bucket_blkno);
+
+	ptr = (char *) xlrec + SizeOfHashMovePageContents;
+
+	/* add the tuples to the "write" page, at their original offsets */
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, xlrec->wblkno,
+								 is_primary);
+	if (!(record->xl_info & XLR_BKP_BLOCK(0)))
+	{
+		OffsetNumber *offsets = (OffsetNumber *) ptr;
+		int			i;
+
+		ptr += xlrec->ntups * sizeof(OffsetNumber);
+		for (i = 0; i < xlrec->ntups; i++)
+		{
+			IndexTuple	itup = (IndexTuple) ptr;
+			Size		itemsz;
+
+			itemsz = IndexTupleDSize(*itup);
+			itemsz = MAXALIGN(itemsz);
+
+			if (BufferIsValid(buffer) &&
+				PageAddItem(BufferGetPage(buffer), (Item) itup, itemsz,
+							offsets[i], false, false) == InvalidOffsetNumber)
+				elog(PANIC, "hash_xlog_move_page_contents: failed to add item");
+
+			ptr += itemsz;
+		}
+	}
+	if (BufferIsValid(buffer))
+		hash_xlog_finish_page(lsn, buffer);
+
+	/* and remove them from the "read" page */
+	buffer = hash_xlog_read_page(lsn, record, 1, xlrec->node, xlrec->rblkno,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		PageIndexMultiDelete(BufferGetPage(buffer), (OffsetNumber *) ptr,
+							 xlrec->ndeleted);
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	if (BufferIsValid(bucketbuf))
+		UnlockReleaseBuffer(bucketbuf);
+}
+
+static void
+hash_xlog_free_ovfl_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_free_ovfl_page *xlrec = (xl_hash_free_ovfl_page *) XLogRecGetData(record);
+	Buffer		bucketbuf = InvalidBuffer;
+	Buffer		buffer;
+	Page		page;
+	HashPageOpaque opaque;
+	bool		is_primary = (xlrec->prevblkno == xlrec->bucket_blkno);
+	int			block_index = 0;
+
+	if (!is_primary)
+		bucketbuf = hash_xlog_lock_bucket(xlrec->node, xlrec->bucket_blkno);
+
+	/* unlink the page from the bucket chain */
+	buffer = hash_xlog_read_page(lsn, record, block_index++, xlrec->node,
+								 xlrec->prevblkno, is_primary);
+	if (BufferIsValid(buffer))
+	{
+		opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+		opaque->hasho_nextblkno = xlrec->nextblkno;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	if (BlockNumberIsValid(xlrec->nextblkno))
+	{
+		buffer = hash_xlog_read_page(lsn, record, block_index++, xlrec->node,
+									 xlrec->nextblkno, false);
+		if (BufferIsValid(buffer))
+		{
+			opaque = (HashPageOpaque) PageGetSpecialPointer(BufferGetPage(buffer));
+			opaque->hasho_prevblkno = xlrec->prevblkno;
+			hash_xlog_finish_page(lsn, buffer);
+		}
+	}
+
+	/* reinitialize the freed page as unused */
+	buffer = hash_xlog_init_page(xlrec->node, xlrec->ovflblkno);
+	page = BufferGetPage(buffer);
+	opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+	opaque->hasho_prevblkno = InvalidBlockNumber;
+	opaque->hasho_nextblkno = InvalidBlockNumber;
+	opaque->hasho_bucket = -1;
+	opaque->hasho_flag = LH_UNUSED_PAGE;
+	opaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_finish_page(lsn, buffer);
+
+	if (BufferIsValid(bucketbuf))
+		UnlockReleaseBuffer(bucketbuf);
+
+	/* mark it free in the bitmap */
+	buffer = hash_xlog_read_page(lsn, record, block_index++, xlrec->node,
+								 xlrec->mapblkno, false);
+	if (BufferIsValid(buffer))
+	{
+		uint32	   *freep = HashPageGetBitmap(BufferGetPage(buffer));
+
+		CLRBIT(freep, xlrec->mapbit);
+		hash_xlog_finish_page(lsn, buffer);
+	}
+
+	if (xlrec->update_firstfree)
+	{
+		buffer = hash_xlog_read_page(lsn, record, block_index++, xlrec->node,
+									 HASH_METAPAGE, false);
+		if (BufferIsValid(buffer))
+		{
+			HashMetaPage metap = HashPageGetMeta(BufferGetPage(buffer));
+
+			metap->hashm_firstfree = xlrec->firstfree;
+			hash_xlog_finish_page(lsn, buffer);
+		}
+	}
+}
+
+static void
+hash_xlog_update_meta_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_update_meta_page *xlrec = (xl_hash_update_meta_page *) XLogRecGetData(record);
+	Buffer		buffer;
+
+	buffer = hash_xlog_read_page(lsn, record, 0, xlrec->node, HASH_METAPAGE,
+								 false);
+	if (BufferIsValid(buffer))
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(buffer));
+
+		metap->hashm_ntuples = xlrec->ntuples;
+		hash_xlog_finish_page(lsn, buffer);
+	}
+}
+
+void
+hash_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_HASH_INSERT:
+			hash_xlog_insert(lsn, record);
+			break;
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			hash_xlog_add_ovfl_page(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_ALLOCATE_PAGE:
+			hash_xlog_split_allocate_page(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_COMPLETE:
+			hash_xlog_split_complete(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_CLEANUP:
+			hash_xlog_split_cleanup(lsn, record);
+			break;
+		case XLOG_HASH_DELETE:
+			hash_xlog_delete(lsn, record);
+			break;
+		case XLOG_HASH_MOVE_PAGE_CONTENTS:
+			hash_xlog_move_page_contents(lsn, record);
+			break;
+		case XLOG_HASH_FREE_OVFL_PAGE:
+			hash_xlog_free_ovfl_page(lsn, record);
+			break;
+		case XLOG_HASH_UPDATE_META_PAGE:
+			hash_xlog_update_meta_page(lsn, record);
+			break;
+		default:
+			elog(PANIC, "hash_redo: unknown op code %u", info);
+	}
+}
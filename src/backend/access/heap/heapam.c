@@ -80,7 +80,9 @@ static HeapScanDesc heap_beginscan_internal(Relation relation,
 						Snapshot snapshot,
 						int nkeys, ScanKey key,
 						bool allow_strat, bool allow_sync,
-						bool is_bitmapscan, bool temp_snap);
+						bool is_bitmapscan, bool temp_snap,
+						ParallelHeapScanDesc parallel_scan);
+static BlockNumber heap_parallelscan_nextpage(HeapScanDesc scan);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 					TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
@@ -219,8 +221,14 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 	 * might go into pages we already scanned.	To guarantee consistent
 	 * results for a non-MVCC snapshot, the caller must hold some higher-level
 	 * lock that ensures the interesting tuple(s) won't change.)
+	 *
+	 * For a parallel scan, all participants must agree on the number of
+	 * blocks, so use the value fixed when the shared state was set up.
 	 */
-	scan->rs_nblocks = RelationGetNumberOfBlocks(scan->rs_rd);
+	if (scan->rs_parallel != NULL)
+		scan->rs_nblocks = scan->rs_parallel->phs_nblocks;
+	else
+		scan->rs_nblocks = RelationGetNumberOfBlocks(scan->rs_rd);
 
 	/*
 	 * If the table is large relative to NBuffers, use a bulk-read access
@@ -229,7 +237,9 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 	 * same so that there are only two behaviors to tune rather than four.
 	 * (However, some callers need to be able to disable one or both of these
 	 * behaviors, independently of the size of the table; also there is a GUC
-	 * variable that can disable synchronized scanning.)
+	 * variable that can disable synchronized scanning.)  A parallel scan
+	 * never uses syncscan, since the shared block counter already decides
+	 * where each participant reads.
 	 *
 	 * During a rescan, don't make a new strategy object if we don't have to.
 	 */
@@ -237,7 +247,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 		scan->rs_nblocks > NBuffers / 4)
 	{
 		allow_strat = scan->rs_allow_strat;
-		allow_sync = scan->rs_allow_sync;
+		allow_sync = scan->rs_allow_sync && scan->rs_parallel == NULL;
 	}
 	else
 		allow_strat = allow_sync = false;
@@ -274,6 +284,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 		scan->rs_startblock = 0;
 	}
 
+	scan->rs_numblocks = InvalidBlockNumber;
 	scan->rs_inited = false;
 	scan->rs_ctup.t_data = NULL;
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
@@ -283,6 +294,10 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 	/* we don't have a marked position... */
 	ItemPointerSetInvalid(&(scan->rs_mctid));
 
+	/* ... nor a claimed range of blocks of a parallel scan */
+	scan->rs_pchunk_next = 0;
+	scan->rs_pchunk_end = 0;
+
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
 	/*
@@ -466,13 +481,26 @@ heapgettup(HeapScanDesc scan,
 			/*
 			 * return null immediately if relation is empty
 			 */
-			if (scan->rs_nblocks == 0)
+			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
 			{
 				Assert(!BufferIsValid(scan->rs_cbuf));
 				tuple->t_data = NULL;
 				return;
 			}
-			page = scan->rs_startblock; /* first page */
+			if (scan->rs_parallel != NULL)
+			{
+				page = heap_parallelscan_nextpage(scan);
+
+				/* other participants may already have claimed every block */
+				if (page == InvalidBlockNumber)
+				{
+					Assert(!BufferIsValid(scan->rs_cbuf));
+					tuple->t_data = NULL;
+					return;
+				}
+			}
+			else
+				page = scan->rs_startblock;		/* first page */
 			heapgetpage(scan, page);
 			lineoff = FirstOffsetNumber;		/* first offnum */
 			scan->rs_inited = true;
@@ -500,7 +528,7 @@ heapgettup(HeapScanDesc scan,
 			/*
 			 * return null immediately if relation is empty
 			 */
-			if (scan->rs_nblocks == 0)
+			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
 			{
 				Assert(!BufferIsValid(scan->rs_cbuf));
 				tuple->t_data = NULL;
@@ -644,6 +672,11 @@ heapgettup(HeapScanDesc scan,
 				page = scan->rs_nblocks;
 			page--;
 		}
+		else if (scan->rs_parallel != NULL)
+		{
+			page = heap_parallelscan_nextpage(scan);
+			finished = (page == InvalidBlockNumber);
+		}
 		else
 		{
 			page++;
@@ -665,6 +698,10 @@ heapgettup(HeapScanDesc scan,
 			 */
 			if (scan->rs_syncscan)
 				ss_report_location(scan->rs_rd, page);
+
+			/* also stop once the caller-imposed block limit is reached */
+			if (!finished && scan->rs_numblocks != InvalidBlockNumber)
+				finished = (--scan->rs_numblocks == 0);
 		}
 
 		/*
@@ -741,13 +778,26 @@ heapgettup_pagemode(HeapScanDesc scan,
 			/*
 			 * return null immediately if relation is empty
 			 */
-			if (scan->rs_nblocks == 0)
+			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
 			{
 				Assert(!BufferIsValid(scan->rs_cbuf));
 				tuple->t_data = NULL;
 				return;
 			}
-			page = scan->rs_startblock; /* first page */
+			if (scan->rs_parallel != NULL)
+			{
+				page = heap_parallelscan_nextpage(scan);
+
+				/* other participants may already have claimed every block */
+				if (page == InvalidBlockNumber)
+				{
+					Assert(!BufferIsValid(scan->rs_cbuf));
+					tuple->t_data = NULL;
+					return;
+				}
+			}
+			else
+				page = scan->rs_startblock;		/* first page */
 			heapgetpage(scan, page);
 			lineindex = 0;
 			scan->rs_inited = true;
@@ -772,7 +822,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 			/*
 			 * return null immediately if relation is empty
 			 */
-			if (scan->rs_nblocks == 0)
+			if (scan->rs_nblocks == 0 || scan->rs_numblocks == 0)
 			{
 				Assert(!BufferIsValid(scan->rs_cbuf));
 				tuple->t_data = NULL;
@@ -905,6 +955,11 @@ heapgettup_pagemode(HeapScanDesc scan,
 				page = scan->rs_nblocks;
 			page--;
 		}
+		else if (scan->rs_parallel != NULL)
+		{
+			page = heap_parallelscan_nextpage(scan);
+			finished = (page == InvalidBlockNumber);
+		}
 		else
 		{
 			page++;
@@ -926,6 +981,10 @@ heapgettup_pagemode(HeapScanDesc scan,
 			 */
 			if (scan->rs_syncscan)
 				ss_report_location(scan->rs_rd, page);
+
+			/* also stop once the caller-imposed block limit is reached */
+			if (!finished && scan->rs_numblocks != InvalidBlockNumber)
+				finished = (--scan->rs_numblocks == 0);
 		}
 
 		/*
@@ -1285,6 +1344,9 @@ heap_openrv_extended(const RangeVar *relation, LOCKMODE lockmode,
  * HeapScanDesc for a bitmap heap scan.  Although that scan technology is
  * really quite unlike a standard seqscan, there is just enough commonality
  * to make it worth using the same data structure.
+ *
+ * heap_beginscan_parallel sets up one participant of a parallel heap scan;
+ * see heap_parallelscan_initialize.
  * ----------------
  */
 HeapScanDesc
@@ -1292,7 +1354,8 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 			   int nkeys, ScanKey key)
 {
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   true, true, false, false);
+								   true, true, false, false,
+								   NULL);
 }
 
 HeapScanDesc
@@ -1302,7 +1365,8 @@ heap_beginscan_catalog(Relation relation, int nkeys, ScanKey key)
 	Snapshot	snapshot = RegisterSnapshot(GetCatalogSnapshot(relid));
 
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   true, true, false, true);
+								   true, true, false, true,
+								   NULL);
 }
 
 HeapScanDesc
@@ -1311,7 +1375,8 @@ heap_beginscan_strat(Relation relation, Snapshot snapshot,
 					 bool allow_strat, bool allow_sync)
 {
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   allow_strat, allow_sync, false, false);
+								   allow_strat, allow_sync, false, false,
+								   NULL);
 }
 
 HeapScanDesc
@@ -1319,14 +1384,16 @@ heap_beginscan_bm(Relation relation, Snapshot snapshot,
 				  int nkeys, ScanKey key)
 {
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   false, false, true, false);
+								   false, false, true, false,
+								   NULL);
 }
 
 static HeapScanDesc
 heap_beginscan_internal(Relation relation, Snapshot snapshot,
 						int nkeys, ScanKey key,
 						bool allow_strat, bool allow_sync,
-						bool is_bitmapscan, bool temp_snap)
+						bool is_bitmapscan, bool temp_snap,
+						ParallelHeapScanDesc parallel_scan)
 {
 	HeapScanDesc scan;
 
@@ -1352,6 +1419,7 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
 	scan->rs_allow_strat = allow_strat;
 	scan->rs_allow_sync = allow_sync;
 	scan->rs_temp_snap = temp_snap;
+	scan->rs_parallel = parallel_scan;
 
 	/*
 	 * we can use page-at-a-time mode if it's an MVCC-safe snapshot
@@ -1389,8 +1457,46 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
 	return scan;
 }
 
+HeapScanDesc
+heap_beginscan_parallel(Relation relation, ParallelHeapScanDesc parallel_scan,
+						Snapshot snapshot, int nkeys, ScanKey key)
+{
+	Assert(RelationGetRelid(relation) == parallel_scan->phs_relid);
+
+	return heap_beginscan_internal(relation, snapshot, nkeys, key,
+								   true, false, false, false,
+								   parallel_scan);
+}
+
+/* ----------------
+ *		heap_setscanlimits - restrict range of a heapscan
+ *
+ * startBlk is the page to start at
+ * numBlks is number of pages to scan (InvalidBlockNumber means "all")
+ *
+ * This must be called before the first tuple is fetched, and only for a
+ * forward, non-synchronized, non-parallel scan.  A rescan drops the limits.
+ * ----------------
+ */
+void
+heap_setscanlimits(HeapScanDesc scan, BlockNumber startBlk, BlockNumber numBlks)
+{
+	Assert(!scan->rs_inited);	/* else too late to change */
+	Assert(!scan->rs_syncscan); /* else rs_startblock is significant */
+	Assert(scan->rs_parallel == NULL);
+
+	/* Check startBlk is valid (but allow case of zero blocks...) */
+	Assert(startBlk == 0 || startBlk < scan->rs_nblocks);
+
+	scan->rs_startblock = startBlk;
+	scan->rs_numblocks = numBlks;
+}
+
 /* ----------------
  *		heap_rescan		- restart a relation scan
+ *
+ * For a parallel scan, this only resets the backend-local state; the caller
+ * must re-initialize the shared state before any participant rescans.
  * ----------------
  */
 void
@@ -1409,6 +1515,79 @@ heap_rescan(HeapScanDesc scan,
 	initscan(scan, key, true);
 }
 
+/* ----------------
+ *		heap_parallelscan_estimate - estimate storage for ParallelHeapScanDesc
+ *
+ *		The snapshot is not part of the shared state; every participant must
+ *		supply an equivalent snapshot of its own to heap_beginscan_parallel.
+ * ----------------
+ */
+Size
+heap_parallelscan_estimate(void)
+{
+	return sizeof(ParallelHeapScanDescData);
+}
+
+/* ----------------
+ *		heap_parallelscan_initialize - initialize ParallelHeapScanDesc
+ *
+ *		The target must point to at least heap_parallelscan_estimate() bytes
+ *		of memory that is visible to all participants, typically in a
+ *		dynamic shared memory segment.  Blocks are handed out chunksize at
+ *		a time; larger chunks mean less contention on the shared counter,
+ *		smaller ones a more even distribution of work near the end of the
+ *		scan.
+ * ----------------
+ */
+void
+heap_parallelscan_initialize(ParallelHeapScanDesc target, Relation relation,
+							 BlockNumber chunksize)
+{
+	Assert(chunksize > 0);
+
+	target->phs_relid = RelationGetRelid(relation);
+	target->phs_nblocks = RelationGetNumberOfBlocks(relation);
+	target->phs_chunksize = chunksize;
+	SpinLockInit(&target->phs_mutex);
+	target->phs_cblock = 0;
+}
+
+/* ----------------
+ *		heap_parallelscan_nextpage - get the next block of a parallel scan
+ *
+ *		Returns the next block this participant should scan, claiming a new
+ *		range of blocks from the shared counter when the previously claimed
+ *		one is used up, or InvalidBlockNumber once every block of the
+ *		relation has been handed out.
+ * ----------------
+ */
+static BlockNumber
+heap_parallelscan_nextpage(HeapScanDesc scan)
+{
+	if (scan->rs_pchunk_next >= scan->rs_pchunk_end)
+	{
+		/* use volatile pointer to prevent code rearrangement */
+		volatile ParallelHeapScanDescData *pscan = scan->rs_parallel;
+		BlockNumber nclaimed;
+
+		SpinLockAcquire(&pscan->phs_mutex);
+		nclaimed = Min(pscan->phs_chunksize,
+					   pscan->phs_nblocks - pscan->phs_cblock);
+		scan->rs_pchunk_next = pscan->phs_cblock;
+		pscan->phs_cblock += nclaimed;
+		SpinLockRelease(&pscan->phs_mutex);
+
+		if (nclaimed == 0)
+		{
+			scan->rs_pchunk_end = scan->rs_pchunk_next;
+			return InvalidBlockNumber;
+		}
+		scan->rs_pchunk_end = scan->rs_pchunk_next + nclaimed;
+	}
+
+	return scan->rs_pchunk_next++;
+}
+
 /* ----------------
  *		heap_endscan	- end relation scan
  *
@@ -1475,6 +1654,10 @@ heap_getnext(HeapScanDesc scan, ScanDirection direction)
 
 	HEAPDEBUG_1;				/* heap_getnext( info ) */
 
+	/* blocks of a parallel scan are only ever handed out in forward order */
+	if (scan->rs_parallel != NULL && ScanDirectionIsBackward(direction))
+		elog(ERROR, "backward scan is not supported in a parallel heap scan");
+
 	if (scan->rs_pageatatime)
 		heapgettup_pagemode(scan, direction,
 							scan->rs_nkeys, scan->rs_key);
@@ -1498,6 +1681,66 @@ heap_getnext(HeapScanDesc scan, ScanDirection direction)
 	return &(scan->rs_ctup);
 }
 
+/*
+ *	heap_getnextbatch	- fetch the visible tuples of the next page at once
+ *
+ * This is a forward-only variant of heap_getnext for callers that want to
+ * process tuples a page at a time.  All remaining visible tuples on the next
+ * page of the scan are stored into tuples[], which must have room for
+ * MaxHeapTuplesPerPage entries, and their count is returned; zero means the
+ * scan is finished.  Like the tuple returned by heap_getnext, the tuples
+ * point into scan->rs_cbuf, which stays pinned until the next call.
+ *
+ * The scan must be in page-at-a-time mode and have no scan keys.  It is not
+ * supported to mix calls to this and heap_getnext on the same scan.
+ */
+int
+heap_getnextbatch(HeapScanDesc scan, HeapTuple tuples)
+{
+	Page		dp;
+	int			ntuples = 0;
+
+	Assert(scan->rs_pageatatime);
+	Assert(scan->rs_nkeys == 0);
+
+	/*
+	 * Let heapgettup_pagemode advance to the first visible tuple on the next
+	 * page; it takes care of page reads, syncscan reporting and parallel
+	 * block assignment.
+	 */
+	heapgettup_pagemode(scan, ForwardScanDirection, 0, NULL);
+
+	if (scan->rs_ctup.t_data == NULL)
+		return 0;
+
+	tuples[ntuples++] = scan->rs_ctup;
+
+	/* Now collect the rest of the page's visible tuples */
+	dp = (Page) BufferGetPage(scan->rs_cbuf);
+	while (scan->rs_cindex + 1 < scan->rs_ntuples)
+	{
+		HeapTuple	tuple = &tuples[ntuples++];
+		OffsetNumber lineoff;
+		ItemId		lpp;
+
+		lineoff = scan->rs_vistuples[++scan->rs_cindex];
+		lpp = PageGetItemId(dp, lineoff);
+		Assert(ItemIdIsNormal(lpp));
+
+		tuple->t_data = (HeapTupleHeader) PageGetItem(dp, lpp);
+		tuple->t_len = ItemIdGetLength(lpp);
+		tuple->t_tableOid = RelationGetRelid(scan->rs_rd);
+		ItemPointerSet(&(tuple->t_self), scan->rs_cblock, lineoff);
+	}
+
+	/* keep rs_ctup in sync with rs_cindex */
+	scan->rs_ctup = tuples[ntuples - 1];
+
+	pgstat_count_heap_getnext_n(scan->rs_rd, ntuples);
+
+	return ntuples;
+}
+
 /*
  *	heap_fetch		- retrieve tuple with given tid
  *
@@ -2014,6 +2257,20 @@ FreeBulkInsertState(BulkInsertState bistate)
 	pfree(bistate);
 }
 
+/*
+ * ReleaseBulkInsertStatePin - release a buffer currently held in bistate
+ *
+ * Needed before reusing the state for a different relation, since the
+ * pinned buffer belongs to the relation the state was last used with.
+ */
+void
+ReleaseBulkInsertStatePin(BulkInsertState bistate)
+{
+	if (bistate->current_buf != InvalidBuffer)
+		ReleaseBuffer(bistate->current_buf);
+	bistate->current_buf = InvalidBuffer;
+}
+
 
 /*
  *	heap_insert		- insert tuple into a heap
@@ -8437,6 +8694,125 @@ heap2_redo(XLogRecPtr lsn, XLogRecord *record)
 	}
 }
 
+/*
+ * Report the heap blocks that replaying a heap record will read, for recovery
+ * prefetching.  Pages the record initializes from scratch are not read, so
+ * they are left out.
+ */
+int
+heap_blockrefs(XLogRecord *record, XLogBlockRef *refs)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	xl_heaptid *target = (xl_heaptid *) XLogRecGetData(record);
+	int			nrefs = 0;
+
+	switch (info & XLOG_HEAP_OPMASK)
+	{
+		case XLOG_HEAP_INSERT:
+			if (info & XLOG_HEAP_INIT_PAGE)
+				break;
+			/* FALL THRU */
+		case XLOG_HEAP_DELETE:
+		case XLOG_HEAP_LOCK:
+		case XLOG_HEAP_INPLACE:
+			refs[nrefs].rnode = target->node;
+			refs[nrefs].forknum = MAIN_FORKNUM;
+			refs[nrefs].blkno = ItemPointerGetBlockNumber(&target->tid);
+			nrefs++;
+			break;
+		case XLOG_HEAP_UPDATE:
+		case XLOG_HEAP_HOT_UPDATE:
+			{
+				xl_heap_update *xlrec = (xl_heap_update *) target;
+				BlockNumber oldblk = ItemPointerGetBlockNumber(&xlrec->target.tid);
+				BlockNumber newblk = ItemPointerGetBlockNumber(&xlrec->newtid);
+
+				refs[nrefs].rnode = xlrec->target.node;
+				refs[nrefs].forknum = MAIN_FORKNUM;
+				refs[nrefs].blkno = oldblk;
+				nrefs++;
+				if (newblk != oldblk && !(info & XLOG_HEAP_INIT_PAGE))
+				{
+					refs[nrefs].rnode = xlrec->target.node;
+					refs[nrefs].forknum = MAIN_FORKNUM;
+					refs[nrefs].blkno = newblk;
+					nrefs++;
+				}
+			}
+			break;
+		default:
+			/* XLOG_HEAP_NEWPAGE overwrites the whole page */
+			break;
+	}
+
+	return nrefs;
+}
+
+/*
+ * Likewise for heap2 records.
+ */
+int
+heap2_blockrefs(XLogRecord *record, XLogBlockRef *refs)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	char	   *data = XLogRecGetData(record);
+	int			nrefs = 0;
+
+	switch (info & XLOG_HEAP_OPMASK)
+	{
+		case XLOG_HEAP2_CLEAN:
+			{
+				xl_heap_clean *xlrec = (xl_heap_clean *) data;
+
+				refs[nrefs].rnode = xlrec->node;
+				refs[nrefs].blkno = xlrec->block;
+			}
+			break;
+		case XLOG_HEAP2_FREEZE_PAGE:
+			{
+				xl_heap_freeze_page *xlrec = (xl_heap_freeze_page *) data;
+
+				refs[nrefs].rnode = xlrec->node;
+				refs[nrefs].blkno = xlrec->block;
+			}
+			break;
+		case XLOG_HEAP2_VISIBLE:
+			{
+				xl_heap_visible *xlrec = (xl_heap_visible *) data;
+
+				refs[nrefs].rnode = xlrec->node;
+				refs[nrefs].blkno = xlrec->block;
+			}
+			break;
+		case XLOG_HEAP2_MULTI_INSERT:
+			{
+				xl_heap_multi_insert *xlrec = (xl_heap_multi_insert *) data;
+
+				if (info & XLOG_HEAP_INIT_PAGE)
+					return 0;
+				refs[nrefs].rnode = xlrec->node;
+				refs[nrefs].blkno = xlrec->blkno;
+			}
+			break;
+		case XLOG_HEAP2_LOCK_UPDATED:
+			{
+				xl_heap_lock_updated *xlrec = (xl_heap_lock_updated *) data;
+
+				refs[nrefs].rnode = xlrec->target.node;
+				refs[nrefs].blkno = ItemPointerGetBlockNumber(&xlrec->target.tid);
+			}
+			break;
+		default:
+			/* the rest don't touch heap pages */
+			return 0;
+	}
+
+	refs[nrefs].forknum = MAIN_FORKNUM;
+	nrefs++;
+
+	return nrefs;
+}
+
 /*
  *	heap_sync		- sync a heap, for use when no WAL has been written
  *
@@ -88,6 +88,7 @@ btbuild(PG_FUNCTION_ARGS)
 	IndexBuildResult *result;
 	double		reltuples;
 	BTBuildState buildstate;
+	ParallelHeapScanDesc pscan;
 
 	buildstate.isUnique = indexInfo->ii_Unique;
 	buildstate.haveDead = false;
@@ -109,18 +110,35 @@ btbuild(PG_FUNCTION_ARGS)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
-	buildstate.spool = _bt_spoolinit(heap, index, indexInfo->ii_Unique, false);
-
 	/*
-	 * If building a unique index, put dead tuples in a second spool to keep
-	 * them out of the uniqueness check.
+	 * If the table is big enough, have background workers help us scan and
+	 * sort it.  We scan whichever blocks the workers don't get to first.
 	 */
-	if (indexInfo->ii_Unique)
-		buildstate.spool2 = _bt_spoolinit(heap, index, false, true);
+	buildstate.spool = _bt_parallel_spoolinit(heap, index, indexInfo,
+											  &pscan);
+	if (buildstate.spool != NULL)
+	{
+		reltuples = IndexBuildHeapParallelScan(heap, index, indexInfo,
+											   pscan,
+											   btbuildCallback,
+											   (void *) &buildstate);
+	}
+	else
+	{
+		buildstate.spool = _bt_spoolinit(heap, index, indexInfo->ii_Unique,
+										 false);
 
-	/* do the heap scan */
-	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
-								   btbuildCallback, (void *) &buildstate);
+		/*
+		 * If building a unique index, put dead tuples in a second spool to
+		 * keep them out of the uniqueness check.
+		 */
+		if (indexInfo->ii_Unique)
+			buildstate.spool2 = _bt_spoolinit(heap, index, false, true);
+
+		/* do the heap scan */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   btbuildCallback, (void *) &buildstate);
+	}
 
 	/* okay, all heap tuples are indexed */
 	if (buildstate.spool2 && !buildstate.haveDead)
@@ -136,6 +154,8 @@ btbuild(PG_FUNCTION_ARGS)
 	 * levels.
 	 */
 	_bt_leafbuild(buildstate.spool, buildstate.spool2);
+	_bt_parallel_spoolresults(buildstate.spool, indexInfo,
+							  &reltuples, &buildstate.indtuples);
 	_bt_spooldestroy(buildstate.spool);
 	if (buildstate.spool2)
 		_bt_spooldestroy(buildstate.spool2);
@@ -181,14 +201,19 @@ btbuildCallback(Relation index,
 	 * insert the index tuple into the appropriate spool file for subsequent
 	 * processing
 	 */
-	if (tupleIsAlive || buildstate->spool2 == NULL)
+	if (tupleIsAlive || !buildstate->isUnique)
 		_bt_spool(itup, buildstate->spool);
-	else
+	else if (buildstate->spool2 != NULL)
 	{
 		/* dead tuples are put into spool2 */
 		buildstate->haveDead = true;
 		_bt_spool(itup, buildstate->spool2);
 	}
+	else
+	{
+		/* a parallel build marks them instead */
+		_bt_spooldead(itup, buildstate->spool);
+	}
 
 	buildstate->indtuples += 1;
 
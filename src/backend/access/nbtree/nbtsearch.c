@@ -29,6 +29,7 @@ static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
+static void _bt_prefetch(IndexScanDesc scan, ScanDirection dir);
 static Buffer _bt_walk_left(Relation rel, Buffer buf);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
 
@@ -1013,6 +1014,7 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	LockBuffer(so->currPos.buf, BUFFER_LOCK_UNLOCK);
 
 	/* OK, itemIndex says what to return */
+	_bt_prefetch(scan, dir);
 	currItem = &so->currPos.items[so->currPos.itemIndex];
 	scan->xs_ctup.t_self = currItem->heapTid;
 	if (scan->xs_want_itup)
@@ -1073,6 +1075,7 @@ _bt_next(IndexScanDesc scan, ScanDirection dir)
 	}
 
 	/* OK, itemIndex says what to return */
+	_bt_prefetch(scan, dir);
 	currItem = &so->currPos.items[so->currPos.itemIndex];
 	scan->xs_ctup.t_self = currItem->heapTid;
 	if (scan->xs_want_itup)
@@ -1156,6 +1159,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
+		so->currPos.prefetchIndex = 0;
 	}
 	else
 	{
@@ -1187,11 +1191,83 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = itemIndex;
 		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
 		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.prefetchIndex = MaxIndexTuplesPerPage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
 }
 
+/*
+ *	_bt_prefetch() -- Issue prefetches for heap blocks we will need soon.
+ *
+ * A plain index scan visits the heap in index order, so each heap fetch is
+ * likely a random read that we would otherwise wait for synchronously.  Since
+ * we already know the TIDs of all the remaining matches on the current index
+ * page, ask the kernel to start reading the heap blocks of the next
+ * target_prefetch_pages of them.  so->currPos.prefetchIndex remembers how far
+ * we have got, so that each item is considered only once; consecutive items
+ * pointing into the same heap block are only prefetched once, too.
+ *
+ * We don't bother in index-only scans, which mostly don't visit the heap at
+ * all, nor when the scan has no heap relation (e.g. bitmap scans).
+ */
+static void
+_bt_prefetch(IndexScanDesc scan, ScanDirection dir)
+{
+#ifdef USE_PREFETCH
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BlockNumber prevblkno;
+	BlockNumber blkno;
+
+	if (target_prefetch_pages <= 0 ||
+		scan->heapRelation == NULL ||
+		scan->xs_want_itup)
+		return;
+
+	/*
+	 * If the scan has changed direction, as in a FETCH BACKWARD from a
+	 * scrollable cursor, what we have prefetched lies behind us now.  Start
+	 * over from the current item.
+	 */
+	if (ScanDirectionIsForward(dir) ?
+		so->currPos.prefetchIndex < so->currPos.itemIndex :
+		so->currPos.prefetchIndex > so->currPos.itemIndex)
+		so->currPos.prefetchIndex = so->currPos.itemIndex;
+
+	prevblkno = ItemPointerGetBlockNumber(
+					  &so->currPos.items[so->currPos.prefetchIndex].heapTid);
+
+	if (ScanDirectionIsForward(dir))
+	{
+		while (so->currPos.prefetchIndex < so->currPos.lastItem &&
+			   so->currPos.prefetchIndex - so->currPos.itemIndex <
+			   target_prefetch_pages)
+		{
+			so->currPos.prefetchIndex++;
+			blkno = ItemPointerGetBlockNumber(
+					  &so->currPos.items[so->currPos.prefetchIndex].heapTid);
+			if (blkno != prevblkno)
+				PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, blkno);
+			prevblkno = blkno;
+		}
+	}
+	else
+	{
+		while (so->currPos.prefetchIndex > so->currPos.firstItem &&
+			   so->currPos.itemIndex - so->currPos.prefetchIndex <
+			   target_prefetch_pages)
+		{
+			so->currPos.prefetchIndex--;
+			blkno = ItemPointerGetBlockNumber(
+					  &so->currPos.items[so->currPos.prefetchIndex].heapTid);
+			if (blkno != prevblkno)
+				PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, blkno);
+			prevblkno = blkno;
+		}
+	}
+#endif   /* USE_PREFETCH */
+}
+
 /* Save an index item into so->currPos.items[itemIndex] */
 static void
 _bt_saveitem(BTScanOpaque so, int itemIndex,
@@ -1639,6 +1715,7 @@ _bt_endpoint(IndexScanDesc scan, ScanDirection dir)
 	LockBuffer(so->currPos.buf, BUFFER_LOCK_UNLOCK);
 
 	/* OK, itemIndex says what to return */
+	_bt_prefetch(scan, dir);
 	currItem = &so->currPos.items[so->currPos.itemIndex];
 	scan->xs_ctup.t_self = currItem->heapTid;
 	if (scan->xs_want_itup)
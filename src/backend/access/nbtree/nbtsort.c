@@ -55,6 +55,28 @@
  * This code isn't concerned about the FSM at all. The caller is responsible
  * for initializing that.
  *
+ * Parallel builds: when the table is big enough, _bt_parallel_spoolinit
+ * launches background workers, and the workers and the leader all take part
+ * in one parallel heap scan, which hands out chunks of heap blocks to
+ * whichever participant asks next.  Each participant sorts the index tuples
+ * of its blocks with its share of maintenance_work_mem.  The workers then
+ * stream their sorted output to the leader through shm_mq queues in a
+ * dynamic shared memory segment, and _bt_load_parallel merges those with
+ * the leader's own sort output as it loads the leaf pages, so the
+ * page-building code is the same as for a serial build.  Workers have no
+ * relcache entry for the index, which is not committed yet; the leader
+ * passes them everything they need to form and sort index tuples (attribute
+ * numbers and descriptors, comparison procs, collations, sort flags, and the
+ * leading column's opclass for abbreviated keys) in the shared segment.
+ *
+ * No participant sees all the tuples, so a unique index is checked for
+ * duplicates during the merge instead of by tuplesort.  The tuples of dead
+ * heap tuples, which a serial build keeps in a separate spool so that they
+ * don't take part in the check, carry BTREE_DEAD_TUPLE in t_info instead.
+ * Expression and partial indexes are never built in parallel, since workers
+ * can't evaluate their expressions without the index definition, and
+ * neither are indexes on tables that our own transaction has changed.
+ *
  * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -67,14 +89,128 @@
 #include "postgres.h"
 
 #include "access/heapam_xlog.h"
+#include "access/htup_details.h"
 #include "access/nbtree.h"
+#include "access/xact.h"
+#include "catalog/catalog.h"
+#include "catalog/index.h"
+#include "commands/dbcommands.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/proc.h"
+#include "storage/procsignal.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/resowner.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
 #include "utils/tuplesort.h"
 
 
+/* Magic number and TOC keys of a parallel btree build's shared segment */
+#define PARALLEL_BTREE_MAGIC			0x62747262
+#define PARALLEL_KEY_BTREE_SHARED		0
+#define PARALLEL_KEY_HEAP_SCAN			1
+#define PARALLEL_KEY_TUPLE_QUEUE		2	/* plus worker number */
+
+/* Size of each worker's tuple queue */
+#define PARALLEL_TUPLE_QUEUE_SIZE		((Size) 1024 * 1024)
+
+/*
+ * Marks the index tuples of dead heap tuples in a parallel build of a unique
+ * index, until the merge has left them out of the uniqueness check
+ */
+#define BTREE_DEAD_TUPLE				INDEX_AM_RESERVED_BIT
+
+/* Number of heap blocks a participant claims from the shared scan at once */
+#define PARALLEL_BTREE_SCAN_CHUNK		64
+
+/*
+ * Minimum number of heap blocks to scan per participant (workers and the
+ * leader) of a parallel build.  Below this, starting up a worker costs more
+ * than it saves.
+ */
+#define BTREE_PARALLEL_MIN_BLOCKS		1024
+
+/*
+ * State shared between the leader and the workers of a parallel build.  It
+ * lives in a dynamic shared memory segment, followed by the parallel heap
+ * scan that hands out heap blocks to the participants, and one tuple queue
+ * per worker.
+ */
+typedef struct BTShared
+{
+	/*
+	 * Immutable state, set up by the leader before launching the workers.
+	 */
+	NameData	dbname;
+	NameData	username;
+	Oid			heaprelid;
+	Oid			heaprelfilenode;
+	TransactionId leaderxid;	/* top-level XID of the leader */
+	int			workmem;		/* sort memory of each worker, in kB */
+	bool		isunique;		/* mark dead tuples for a uniqueness check? */
+	int			nkeys;
+	AttrNumber	attnums[INDEX_MAX_KEYS];
+	Oid			sortprocs[INDEX_MAX_KEYS];
+	Oid			collations[INDEX_MAX_KEYS];
+	int			skflags[INDEX_MAX_KEYS];
+	char		indexatts[INDEX_MAX_KEYS][ATTRIBUTE_FIXED_PART_SIZE];
+	Oid			leadopfamily;	/* for abbreviated keys on the first column */
+	Oid			leadopcintype;
+
+	/* Mutable state, protected by mutex */
+	slock_t		mutex;
+	int			nclaimed;		/* worker numbers handed out so far */
+	int			nfinished;		/* workers that sent all their tuples */
+	double		reltuples;		/* sum of workers' heap tuple counts */
+	double		indtuples;		/* sum of workers' index tuple counts */
+	bool		brokenhotchain;	/* did any worker see a broken HOT chain? */
+} BTShared;
+
+/*
+ * Leader's state for a parallel build.  The struct and the worker handles
+ * are allocated in TopTransactionContext, so that they survive until the
+ * on_dsm_detach callback runs during abort.
+ */
+typedef struct BTParallelBuild
+{
+	dsm_segment *seg;
+	BTShared   *btshared;
+	int			nworkers;		/* number of workers launched */
+	shm_mq	  **mqs;			/* tuple queue of each worker */
+	shm_mq_handle **queues;		/* our handle for each tuple queue */
+	BackgroundWorkerHandle *handles[FLEXIBLE_ARRAY_MEMBER];
+} BTParallelBuild;
+
+/* Working state of a parallel build worker's heap scan */
+typedef struct BTWorkerBuildState
+{
+	Tuplesortstate *sortstate;
+	TupleDesc	tupdesc;
+	bool		isunique;
+	double		indtuples;
+} BTWorkerBuildState;
+
+/* Leader's state for merging the sorted runs of all participants */
+typedef struct BTMergeState
+{
+	int			nkeys;
+	ScanKey		indexScanKey;
+	TupleDesc	tupdesc;
+	IndexTuple *itups;			/* current tuple of each source */
+} BTMergeState;
+
+
 /*
  * Status record for spooling/sorting phase.  (Note we may have two of
  * these due to the special requirements for uniqueness-checking with
@@ -86,6 +222,7 @@ struct BTSpool
 	Relation	heap;
 	Relation	index;
 	bool		isunique;
+	struct BTParallelBuild *parallel;	/* NULL unless a parallel build */
 };
 
 /*
@@ -136,6 +273,19 @@ static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
+static BTPageState *_bt_load_parallel(BTWriteState *wstate, BTSpool *btspool);
+static void _bt_report_duplicate(BTWriteState *wstate, IndexTuple itup);
+static int	_bt_itupcompare(int keysz, ScanKey indexScanKey, TupleDesc tupdes,
+				IndexTuple itup, IndexTuple itup2);
+static int	_bt_merge_compare(Datum a, Datum b, void *arg);
+static bool _bt_parallel_receive(BTParallelBuild *btparallel, int worker,
+					 IndexTuple *itup);
+static int	_bt_parallel_plan(Relation heap, IndexInfo *indexInfo);
+static void _bt_parallel_wait_for_workers(BTParallelBuild *btparallel);
+static void _bt_parallel_cleanup(dsm_segment *seg, Datum arg);
+static void _bt_parallel_build_callback(Relation index, HeapTuple htup,
+							Datum *values, bool *isnull,
+							bool tupleIsAlive, void *state);
 
 
 /*
@@ -178,6 +328,9 @@ void
 _bt_spooldestroy(BTSpool *btspool)
 {
 	tuplesort_end(btspool->sortstate);
+	/* this also terminates any workers still around */
+	if (btspool->parallel)
+		dsm_detach(btspool->parallel->seg);
 	pfree(btspool);
 }
 
@@ -190,6 +343,19 @@ _bt_spool(IndexTuple itup, BTSpool *btspool)
 	tuplesort_putindextuple(btspool->sortstate, itup);
 }
 
+/*
+ * spool the index entry of a dead heap tuple, in a parallel build of a
+ * unique index.  It will be left out of the uniqueness check.
+ */
+void
+_bt_spooldead(IndexTuple itup, BTSpool *btspool)
+{
+	Assert(btspool->parallel != NULL);
+
+	itup->t_info |= BTREE_DEAD_TUPLE;
+	tuplesort_putindextuple(btspool->sortstate, itup);
+}
+
 /*
  * given a spool loaded by successive calls to _bt_spool,
  * create an entire btree.
@@ -681,11 +847,16 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 				should_free2,
 				load1;
 	TupleDesc	tupdes = RelationGetDescr(wstate->index);
-	int			i,
-				keysz = RelationGetNumberOfAttributes(wstate->index);
+	int			keysz = RelationGetNumberOfAttributes(wstate->index);
 	ScanKey		indexScanKey = NULL;
 
-	if (merge)
+	if (btspool->parallel)
+	{
+		/* merge the sorted runs of the workers with our own */
+		Assert(!merge);
+		state = _bt_load_parallel(wstate, btspool);
+	}
+	else if (merge)
 	{
 		/*
 		 * Another BTSpool for dead tuples exists. Now we have to merge
@@ -709,53 +880,9 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			}
 			else if (itup != NULL)
 			{
-				for (i = 1; i <= keysz; i++)
-				{
-					ScanKey		entry;
-					Datum		attrDatum1,
-								attrDatum2;
-					bool		isNull1,
-								isNull2;
-					int32		compare;
-
-					entry = indexScanKey + i - 1;
-					attrDatum1 = index_getattr(itup, i, tupdes, &isNull1);
-					attrDatum2 = index_getattr(itup2, i, tupdes, &isNull2);
-					if (isNull1)
-					{
-						if (isNull2)
-							compare = 0;		/* NULL "=" NULL */
-						else if (entry->sk_flags & SK_BT_NULLS_FIRST)
-							compare = -1;		/* NULL "<" NOT_NULL */
-						else
-							compare = 1;		/* NULL ">" NOT_NULL */
-					}
-					else if (isNull2)
-					{
-						if (entry->sk_flags & SK_BT_NULLS_FIRST)
-							compare = 1;		/* NOT_NULL ">" NULL */
-						else
-							compare = -1;		/* NOT_NULL "<" NULL */
-					}
-					else
-					{
-						compare =
-							DatumGetInt32(FunctionCall2Coll(&entry->sk_func,
-														 entry->sk_collation,
-															attrDatum1,
-															attrDatum2));
-
-						if (entry->sk_flags & SK_BT_DESC)
-							compare = -compare;
-					}
-					if (compare > 0)
-					{
-						load1 = false;
-						break;
-					}
-					else if (compare < 0)
-						break;
-				}
+				if (_bt_itupcompare(keysz, indexScanKey, tupdes,
+									itup, itup2) > 0)
+					load1 = false;
 			}
 			else
 				load1 = false;
@@ -823,3 +950,732 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		smgrimmedsync(wstate->index->rd_smgr, MAIN_FORKNUM);
 	}
 }
+
+/*
+ * Compare two index tuples on their key columns, in index order.
+ */
+static int
+_bt_itupcompare(int keysz, ScanKey indexScanKey, TupleDesc tupdes,
+				IndexTuple itup, IndexTuple itup2)
+{
+	int			i;
+
+	for (i = 1; i <= keysz; i++)
+	{
+		ScanKey		entry;
+		Datum		attrDatum1,
+					attrDatum2;
+		bool		isNull1,
+					isNull2;
+		int32		compare;
+
+		entry = indexScanKey + i - 1;
+		attrDatum1 = index_getattr(itup, i, tupdes, &isNull1);
+		attrDatum2 = index_getattr(itup2, i, tupdes, &isNull2);
+		if (isNull1)
+		{
+			if (isNull2)
+				compare = 0;	/* NULL "=" NULL */
+			else if (entry->sk_flags & SK_BT_NULLS_FIRST)
+				compare = -1;	/* NULL "<" NOT_NULL */
+			else
+				compare = 1;	/* NULL ">" NOT_NULL */
+		}
+		else if (isNull2)
+		{
+			if (entry->sk_flags & SK_BT_NULLS_FIRST)
+				compare = 1;	/* NOT_NULL ">" NULL */
+			else
+				compare = -1;	/* NOT_NULL "<" NULL */
+		}
+		else
+		{
+			compare = DatumGetInt32(FunctionCall2Coll(&entry->sk_func,
+													  entry->sk_collation,
+													  attrDatum1,
+													  attrDatum2));
+
+			if (entry->sk_flags & SK_BT_DESC)
+				compare = -compare;
+		}
+		if (compare != 0)
+			return compare;
+	}
+
+	return 0;
+}
+
+/*
+ * Merge the sorted runs of the participants of a parallel build, and load
+ * the tuples into btree leaves.  Source 0 of the merge is the leader's own
+ * tuplesort, source i + 1 is the tuple queue of worker i.
+ *
+ * For a unique index, we also check here that no two live tuples without
+ * nulls are equal.  The merge brings any such tuples together, so it's
+ * enough to compare each one with the last of them we loaded.
+ */
+static BTPageState *
+_bt_load_parallel(BTWriteState *wstate, BTSpool *btspool)
+{
+	BTParallelBuild *btparallel = btspool->parallel;
+	volatile BTShared *btshared = btparallel->btshared;
+	BTPageState *state = NULL;
+	BTMergeState mstate;
+	binaryheap *heap;
+	int			nsources = btparallel->nworkers + 1;
+	bool		should_free = false;
+	IndexTuple	lastitup = NULL;
+	bool		havelast = false;
+	int			nfinished;
+	int			i;
+
+	if (btparallel->btshared->isunique)
+		lastitup = (IndexTuple) palloc(INDEX_SIZE_MASK);
+
+	mstate.nkeys = RelationGetNumberOfAttributes(wstate->index);
+	mstate.indexScanKey = _bt_mkscankey_nodata(wstate->index);
+	mstate.tupdesc = RelationGetDescr(wstate->index);
+	mstate.itups = (IndexTuple *) palloc(nsources * sizeof(IndexTuple));
+
+	heap = binaryheap_allocate(nsources, _bt_merge_compare, &mstate);
+
+	/*
+	 * Prime the merge with the first tuple of each source.  This waits for
+	 * every worker to finish its sort.
+	 */
+	mstate.itups[0] = tuplesort_getindextuple(btspool->sortstate,
+											  true, &should_free);
+	if (mstate.itups[0] != NULL)
+		binaryheap_add_unordered(heap, Int32GetDatum(0));
+	for (i = 0; i < btparallel->nworkers; i++)
+	{
+		if (_bt_parallel_receive(btparallel, i, &mstate.itups[i + 1]))
+			binaryheap_add_unordered(heap, Int32GetDatum(i + 1));
+	}
+	binaryheap_build(heap);
+
+	while (!binaryheap_empty(heap))
+	{
+		int			source = DatumGetInt32(binaryheap_first(heap));
+		IndexTuple	itup = mstate.itups[source];
+		bool		more;
+
+		if (lastitup != NULL)
+		{
+			if (itup->t_info & BTREE_DEAD_TUPLE)
+				itup->t_info &= ~BTREE_DEAD_TUPLE;
+			else if (!IndexTupleHasNulls(itup))
+			{
+				if (havelast &&
+					_bt_itupcompare(mstate.nkeys, mstate.indexScanKey,
+									mstate.tupdesc, lastitup, itup) == 0)
+					_bt_report_duplicate(wstate, itup);
+				memcpy(lastitup, itup, IndexTupleSize(itup));
+				havelast = true;
+			}
+		}
+
+		/* When we see first tuple, create first index page */
+		if (state == NULL)
+			state = _bt_pagestate(wstate, 0);
+
+		_bt_buildadd(wstate, state, itup);
+
+		/* Advance the source we just loaded from */
+		if (source == 0)
+		{
+			if (should_free)
+				pfree(itup);
+			mstate.itups[0] = tuplesort_getindextuple(btspool->sortstate,
+													  true, &should_free);
+			more = (mstate.itups[0] != NULL);
+		}
+		else
+			more = _bt_parallel_receive(btparallel, source - 1,
+										&mstate.itups[source]);
+
+		if (more)
+			binaryheap_replace_first(heap, Int32GetDatum(source));
+		else
+			(void) binaryheap_remove_first(heap);
+	}
+
+	/*
+	 * A worker that failed shows up only as a queue that was detached before
+	 * the worker reported having sent everything.  Its error, if any, went to
+	 * the server log.
+	 */
+	SpinLockAcquire(&btshared->mutex);
+	nfinished = btshared->nfinished;
+	SpinLockRelease(&btshared->mutex);
+	if (nfinished < btparallel->nworkers)
+		ereport(ERROR,
+				(errmsg("parallel index build worker exited unexpectedly")));
+
+	_bt_freeskey(mstate.indexScanKey);
+	binaryheap_free(heap);
+	pfree(mstate.itups);
+	if (lastitup != NULL)
+		pfree(lastitup);
+
+	return state;
+}
+
+/*
+ * Complain about a duplicate key found while building a unique index in
+ * parallel, the same way tuplesort does in a serial build.
+ */
+static void
+_bt_report_duplicate(BTWriteState *wstate, IndexTuple itup)
+{
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+
+	index_deform_tuple(itup, RelationGetDescr(wstate->index),
+					   values, isnull);
+	ereport(ERROR,
+			(errcode(ERRCODE_UNIQUE_VIOLATION),
+			 errmsg("could not create unique index \"%s\"",
+					RelationGetRelationName(wstate->index)),
+			 errdetail("Key %s is duplicated.",
+					   BuildIndexValueDescription(wstate->index,
+												  values, isnull)),
+			 errtableconstraint(wstate->heap,
+								RelationGetRelationName(wstate->index))));
+}
+
+/*
+ * binaryheap comparator for the merge in _bt_load_parallel.  Ties between
+ * sources are broken by heap TID, so that equal keys come out in physical
+ * order as they do in a serial build.
+ */
+static int
+_bt_merge_compare(Datum a, Datum b, void *arg)
+{
+	BTMergeState *mstate = (BTMergeState *) arg;
+	IndexTuple	itup = mstate->itups[DatumGetInt32(a)];
+	IndexTuple	itup2 = mstate->itups[DatumGetInt32(b)];
+	int			compare;
+
+	compare = _bt_itupcompare(mstate->nkeys, mstate->indexScanKey,
+							  mstate->tupdesc, itup, itup2);
+	if (compare == 0)
+		compare = ItemPointerCompare(&itup->t_tid, &itup2->t_tid);
+
+	/* binaryheap keeps the largest element on top; we want the smallest */
+	return -compare;
+}
+
+/*
+ * Fetch the next tuple sent by the given worker.  The tuple points into the
+ * queue, and stays valid until the next call for the same worker.  Returns
+ * false once the worker has detached from the queue and all of its tuples
+ * have been read.
+ */
+static bool
+_bt_parallel_receive(BTParallelBuild *btparallel, int worker,
+					 IndexTuple *itup)
+{
+	shm_mq_result res;
+	Size		nbytes;
+	void	   *data;
+
+	res = shm_mq_receive(btparallel->queues[worker], &nbytes, &data, false);
+	if (res != SHM_MQ_SUCCESS)
+	{
+		Assert(res == SHM_MQ_DETACHED);
+		*itup = NULL;
+		return false;
+	}
+
+	Assert(nbytes == IndexTupleSize((IndexTuple) data));
+	*itup = (IndexTuple) data;
+	return true;
+}
+
+/*
+ * Decide how many workers to use for building an index, if any.
+ */
+static int
+_bt_parallel_plan(Relation heap, IndexInfo *indexInfo)
+{
+#ifdef EXEC_BACKEND
+	/* workers' entry point is passed as a function pointer */
+	return 0;
+#else
+	HeapTuple	classtup;
+	bool		changed;
+	BlockNumber nblocks;
+	int			nworkers;
+
+	if (max_parallel_maintenance_workers <= 0 ||
+		IsBootstrapProcessingMode() ||
+		indexInfo->ii_Expressions != NIL ||
+		indexInfo->ii_Predicate != NIL ||
+		indexInfo->ii_ExclusionOps != NULL ||
+		indexInfo->ii_Concurrent ||
+		IsSystemRelation(heap) ||
+		RelationUsesLocalBuffers(heap))
+		return 0;
+
+	/*
+	 * Workers only see committed catalog state, so they'd get the table wrong
+	 * if our own transaction has created, rewritten or altered it.
+	 */
+	classtup = SearchSysCache1(RELOID,
+							   ObjectIdGetDatum(RelationGetRelid(heap)));
+	if (!HeapTupleIsValid(classtup))
+		elog(ERROR, "cache lookup failed for relation %u",
+			 RelationGetRelid(heap));
+	changed = TransactionIdIsCurrentTransactionId(
+								 HeapTupleHeaderGetXmin(classtup->t_data));
+	ReleaseSysCache(classtup);
+	if (changed)
+		return 0;
+
+	nblocks = RelationGetNumberOfBlocks(heap);
+	nworkers = (int) (nblocks / BTREE_PARALLEL_MIN_BLOCKS) - 1;
+	nworkers = Min(nworkers, max_parallel_maintenance_workers);
+
+	return Max(nworkers, 0);
+#endif
+}
+
+/*
+ * Try to set up a parallel build of a btree index: launch background workers
+ * that scan and sort part of the heap each, and create a spool for the
+ * leader's own share of the work.  The participants divide the heap between
+ * them through a parallel heap scan, so a participant that is slow to start
+ * or to get through its blocks simply ends up with fewer of them.
+ *
+ * Returns NULL if the index is to be built serially.  Otherwise, the caller
+ * must take part in the parallel heap scan returned in *pscan, feeding the
+ * returned spool, and later add the workers' counts with
+ * _bt_parallel_spoolresults.
+ */
+BTSpool *
+_bt_parallel_spoolinit(Relation heap, Relation index, IndexInfo *indexInfo,
+					   ParallelHeapScanDesc *pscan)
+{
+	BTSpool    *btspool;
+	BTParallelBuild *btparallel;
+	BTShared   *btshared;
+	ParallelHeapScanDesc heapscan;
+	TupleDesc	tupdesc = RelationGetDescr(index);
+	ScanKey		indexScanKey;
+	int			nworkers;
+	int			btKbytes;
+	shm_toc_estimator e;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	BackgroundWorker worker;
+	MemoryContext oldcontext;
+	int			i;
+
+	nworkers = _bt_parallel_plan(heap, indexInfo);
+	if (nworkers == 0)
+		return NULL;
+
+	/* Divide the sort memory evenly among the workers and the leader */
+	btKbytes = Max(maintenance_work_mem / (nworkers + 1), 64);
+
+	/*
+	 * Create the shared segment, with the parallel heap scan and one tuple
+	 * queue per worker
+	 */
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sizeof(BTShared));
+	shm_toc_estimate_chunk(&e, heap_parallelscan_estimate());
+	for (i = 0; i < nworkers; i++)
+		shm_toc_estimate_chunk(&e, PARALLEL_TUPLE_QUEUE_SIZE);
+	shm_toc_estimate_keys(&e, 2 + nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	seg = dsm_create(segsize);
+	toc = shm_toc_create(PARALLEL_BTREE_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	btshared = shm_toc_allocate(toc, sizeof(BTShared));
+	namestrcpy(&btshared->dbname, get_database_name(MyDatabaseId));
+	namestrcpy(&btshared->username, GetUserNameFromId(GetUserId()));
+	btshared->heaprelid = RelationGetRelid(heap);
+	btshared->heaprelfilenode = heap->rd_node.relNode;
+	btshared->leaderxid = GetTopTransactionId();
+	btshared->workmem = btKbytes;
+	btshared->isunique = indexInfo->ii_Unique;
+	btshared->nkeys = indexInfo->ii_NumIndexAttrs;
+	indexScanKey = _bt_mkscankey_nodata(index);
+	for (i = 0; i < btshared->nkeys; i++)
+	{
+		btshared->attnums[i] = indexInfo->ii_KeyAttrNumbers[i];
+		btshared->sortprocs[i] = indexScanKey[i].sk_func.fn_oid;
+		btshared->collations[i] = indexScanKey[i].sk_collation;
+		btshared->skflags[i] = indexScanKey[i].sk_flags;
+		memcpy(btshared->indexatts[i], tupdesc->attrs[i],
+			   ATTRIBUTE_FIXED_PART_SIZE);
+	}
+	_bt_freeskey(indexScanKey);
+	btshared->leadopfamily = index->rd_opfamily[0];
+	btshared->leadopcintype = index->rd_opcintype[0];
+	SpinLockInit(&btshared->mutex);
+	btshared->nclaimed = 0;
+	btshared->nfinished = 0;
+	btshared->reltuples = 0;
+	btshared->indtuples = 0;
+	btshared->brokenhotchain = false;
+	shm_toc_insert(toc, PARALLEL_KEY_BTREE_SHARED, btshared);
+
+	heapscan = shm_toc_allocate(toc, heap_parallelscan_estimate());
+	heap_parallelscan_initialize(heapscan, heap, PARALLEL_BTREE_SCAN_CHUNK);
+	shm_toc_insert(toc, PARALLEL_KEY_HEAP_SCAN, heapscan);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_TUPLE_QUEUE_SIZE),
+						   PARALLEL_TUPLE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		shm_toc_insert(toc, PARALLEL_KEY_TUPLE_QUEUE + i, mq);
+	}
+
+	/*
+	 * Launch as many workers as we can get.  If we error out later on,
+	 * detaching from the segment terminates them.
+	 */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	btparallel = palloc0(offsetof(BTParallelBuild, handles) +
+						 nworkers * sizeof(BackgroundWorkerHandle *));
+	btparallel->seg = seg;
+	btparallel->btshared = btshared;
+	on_dsm_detach(seg, _bt_parallel_cleanup, PointerGetDatum(btparallel));
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = _bt_parallel_build_main;
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel btree build worker");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(seg));
+	/* set bgw_notify_pid, so we can detect if a worker fails to start */
+	worker.bgw_notify_pid = MyProcPid;
+
+	for (i = 0; i < nworkers; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &btparallel->handles[i]))
+			break;
+		btparallel->nworkers++;
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	if (btparallel->nworkers == 0)
+	{
+		dsm_detach(seg);
+		pfree(btparallel);
+		return NULL;
+	}
+
+	btparallel->mqs = (shm_mq **)
+		palloc(btparallel->nworkers * sizeof(shm_mq *));
+	btparallel->queues = (shm_mq_handle **)
+		palloc(btparallel->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < btparallel->nworkers; i++)
+	{
+		btparallel->mqs[i] = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE + i);
+		btparallel->queues[i] = shm_mq_attach(btparallel->mqs[i], seg, NULL);
+	}
+
+	_bt_parallel_wait_for_workers(btparallel);
+
+	/* The leader sorts its own share with the same memory as a worker */
+	btspool = (BTSpool *) palloc0(sizeof(BTSpool));
+	btspool->heap = heap;
+	btspool->index = index;
+	btspool->isunique = indexInfo->ii_Unique;
+	btspool->sortstate = tuplesort_begin_index_btree(heap, index, false,
+													 btKbytes, false);
+	btspool->parallel = btparallel;
+
+	*pscan = heapscan;
+
+	return btspool;
+}
+
+/*
+ * Add the heap and index tuple counts of a parallel build's workers to the
+ * leader's, and report any broken HOT chain they found.  Must be called
+ * after _bt_leafbuild.  Does nothing for a serial build.
+ */
+void
+_bt_parallel_spoolresults(BTSpool *btspool, IndexInfo *indexInfo,
+						  double *reltuples, double *indtuples)
+{
+	volatile BTShared *btshared;
+
+	if (btspool->parallel == NULL)
+		return;
+
+	btshared = btspool->parallel->btshared;
+	SpinLockAcquire(&btshared->mutex);
+	*reltuples += btshared->reltuples;
+	*indtuples += btshared->indtuples;
+	if (btshared->brokenhotchain)
+		indexInfo->ii_BrokenHotChain = true;
+	SpinLockRelease(&btshared->mutex);
+}
+
+/*
+ * Wait until all the launched workers have attached to their tuple queues.
+ * Past that point, a worker that dies detaches from its queue, which the
+ * merge notices; before it, only the postmaster can tell us.
+ */
+static void
+_bt_parallel_wait_for_workers(BTParallelBuild *btparallel)
+{
+	bool		save_set_latch_on_sigusr1;
+	bool		failed = false;
+
+	save_set_latch_on_sigusr1 = set_latch_on_sigusr1;
+	set_latch_on_sigusr1 = true;
+
+	PG_TRY();
+	{
+		for (;;)
+		{
+			int			nattached = 0;
+			int			i;
+
+			for (i = 0; i < btparallel->nworkers; i++)
+			{
+				BgwHandleStatus status;
+				pid_t		pid;
+
+				if (shm_mq_get_sender(btparallel->mqs[i]) != NULL)
+				{
+					nattached++;
+					continue;
+				}
+
+				/*
+				 * Worker numbers are handed out in the order workers start, so
+				 * we can't tell which one of them will attach to this queue.
+				 * But if any unattached worker has stopped, some queue will
+				 * never be attached.
+				 */
+				status = GetBackgroundWorkerPid(btparallel->handles[i], &pid);
+				if (status == BGWH_STOPPED || status == BGWH_POSTMASTER_DIED)
+					failed = true;
+			}
+			if (nattached == btparallel->nworkers || failed)
+				break;
+
+			/* Wait to be signalled. */
+			WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+
+			/* An interrupt may have occurred while we were waiting. */
+			CHECK_FOR_INTERRUPTS();
+
+			/* Reset the latch so we don't spin. */
+			ResetLatch(&MyProc->procLatch);
+		}
+	}
+	PG_CATCH();
+	{
+		set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+
+	if (failed)
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				 errmsg("parallel index build worker failed to start")));
+}
+
+/*
+ * on_dsm_detach callback: terminate any workers still running.
+ */
+static void
+_bt_parallel_cleanup(dsm_segment *seg, Datum arg)
+{
+	BTParallelBuild *btparallel = (BTParallelBuild *) DatumGetPointer(arg);
+
+	while (btparallel->nworkers > 0)
+	{
+		--btparallel->nworkers;
+		TerminateBackgroundWorker(btparallel->handles[btparallel->nworkers]);
+	}
+}
+
+/*
+ * Per-tuple callback from IndexBuildHeapRangeScan, in a worker.
+ */
+static void
+_bt_parallel_build_callback(Relation index,
+							HeapTuple htup,
+							Datum *values,
+							bool *isnull,
+							bool tupleIsAlive,
+							void *state)
+{
+	BTWorkerBuildState *buildstate = (BTWorkerBuildState *) state;
+	IndexTuple	itup;
+
+	/* form an index tuple and point it at the heap tuple */
+	itup = index_form_tuple(buildstate->tupdesc, values, isnull);
+	itup->t_tid = htup->t_self;
+
+	/* keep dead tuples out of the leader's uniqueness check */
+	if (!tupleIsAlive && buildstate->isunique)
+		itup->t_info |= BTREE_DEAD_TUPLE;
+
+	tuplesort_putindextuple(buildstate->sortstate, itup);
+	buildstate->indtuples += 1;
+
+	pfree(itup);
+}
+
+/*
+ * Main entry point of a parallel btree build worker.
+ *
+ * The worker scans the heap blocks the parallel heap scan hands to it, sorts
+ * the index tuples, and sends them in order to the leader through its tuple
+ * queue.
+ */
+void
+_bt_parallel_build_main(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	BTShared   *btshared;
+	volatile BTShared *vbtshared;
+	ParallelHeapScanDesc heapscan;
+	int			workernum;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	Relation	heap;
+	IndexInfo  *indexInfo;
+	TupleDesc	tupdesc;
+	ScanKey		indexScanKey;
+	BTWorkerBuildState buildstate;
+	double		reltuples;
+	IndexTuple	itup;
+	bool		should_free;
+	int			i;
+
+	/* We can be terminated by the leader if it errors out */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Attach to the leader's shared segment */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel btree build");
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_BTREE_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			   errmsg("bad magic number in dynamic shared memory segment")));
+	btshared = shm_toc_lookup(toc, PARALLEL_KEY_BTREE_SHARED);
+	vbtshared = btshared;
+	heapscan = shm_toc_lookup(toc, PARALLEL_KEY_HEAP_SCAN);
+
+	SpinLockAcquire(&vbtshared->mutex);
+	workernum = vbtshared->nclaimed++;
+	SpinLockRelease(&vbtshared->mutex);
+
+	mq = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE + workernum);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	BackgroundWorkerInitializeConnection(NameStr(btshared->dbname),
+										 NameStr(btshared->username));
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * The leader holds a lock that keeps out any concurrent change to the
+	 * table, and waits for us while holding it.  Taking a lock of our own
+	 * could only deadlock against the leader's.
+	 */
+	heap = heap_open(btshared->heaprelid, NoLock);
+	if (heap->rd_node.relNode != btshared->heaprelfilenode)
+		elog(ERROR, "parallel index build worker sees a different version of relation \"%s\"",
+			 RelationGetRelationName(heap));
+
+	/* Rebuild what we need of the index definition */
+	indexInfo = makeNode(IndexInfo);
+	indexInfo->ii_NumIndexAttrs = btshared->nkeys;
+	indexInfo->ii_Unique = btshared->isunique;
+	indexInfo->ii_ReadyForInserts = true;
+	indexInfo->ii_ParallelLeaderXid = btshared->leaderxid;
+	tupdesc = CreateTemplateTupleDesc(btshared->nkeys, false);
+	indexScanKey = (ScanKey) palloc(btshared->nkeys * sizeof(ScanKeyData));
+	for (i = 0; i < btshared->nkeys; i++)
+	{
+		indexInfo->ii_KeyAttrNumbers[i] = btshared->attnums[i];
+		memcpy(tupdesc->attrs[i], btshared->indexatts[i],
+			   ATTRIBUTE_FIXED_PART_SIZE);
+		ScanKeyEntryInitialize(&indexScanKey[i],
+							   btshared->skflags[i],
+							   (AttrNumber) (i + 1),
+							   InvalidStrategy,
+							   InvalidOid,
+							   btshared->collations[i],
+							   btshared->sortprocs[i],
+							   (Datum) 0);
+	}
+
+	/* Scan our share of the heap, and sort */
+	buildstate.sortstate =
+		tuplesort_begin_index_btree_scankeys(tupdesc, btshared->nkeys,
+											 indexScanKey,
+											 btshared->leadopfamily,
+											 btshared->leadopcintype,
+											 btshared->workmem, false);
+	buildstate.tupdesc = tupdesc;
+	buildstate.isunique = btshared->isunique;
+	buildstate.indtuples = 0;
+	reltuples = IndexBuildHeapParallelScan(heap, NULL, indexInfo, heapscan,
+										   _bt_parallel_build_callback,
+										   (void *) &buildstate);
+	tuplesort_performsort(buildstate.sortstate);
+
+	/* Send the sorted tuples to the leader */
+	while ((itup = tuplesort_getindextuple(buildstate.sortstate,
+										   true, &should_free)) != NULL)
+	{
+		/* if the leader has gone away, it gave up on the build */
+		if (shm_mq_send(mqh, IndexTupleSize(itup), itup, false) !=
+			SHM_MQ_SUCCESS)
+			proc_exit(1);
+		if (should_free)
+			pfree(itup);
+	}
+	tuplesort_end(buildstate.sortstate);
+
+	/* Report our results; detaching from the queue then ends our output */
+	SpinLockAcquire(&vbtshared->mutex);
+	vbtshared->nfinished++;
+	vbtshared->reltuples += reltuples;
+	vbtshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		vbtshared->brokenhotchain = true;
+	SpinLockRelease(&vbtshared->mutex);
+
+	heap_close(heap, NoLock);
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	dsm_detach(seg);
+	proc_exit(0);
+}
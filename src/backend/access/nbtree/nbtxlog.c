@@ -1160,3 +1160,96 @@ btree_redo(XLogRecPtr lsn, XLogRecord *record)
 			elog(PANIC, "btree_redo: unknown op code %u", info);
 	}
 }
+
+/*
+ * Report the index blocks that replaying a btree record will read, for
+ * recovery prefetching.  Newly allocated pages (the right half of a split,
+ * a new root) are initialized from scratch, so they are left out.
+ */
+int
+btree_blockrefs(XLogRecord *record, XLogBlockRef *refs)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	char	   *data = XLogRecGetData(record);
+	RelFileNode rnode;
+	BlockNumber blknos[XLR_MAX_BKP_BLOCKS];
+	int			nblknos = 0;
+	int			i;
+
+	switch (info)
+	{
+		case XLOG_BTREE_INSERT_LEAF:
+		case XLOG_BTREE_INSERT_UPPER:
+		case XLOG_BTREE_INSERT_META:
+			{
+				xl_btree_insert *xlrec = (xl_btree_insert *) data;
+
+				rnode = xlrec->target.node;
+				blknos[nblknos++] = ItemPointerGetBlockNumber(&xlrec->target.tid);
+			}
+			break;
+		case XLOG_BTREE_SPLIT_L:
+		case XLOG_BTREE_SPLIT_R:
+		case XLOG_BTREE_SPLIT_L_ROOT:
+		case XLOG_BTREE_SPLIT_R_ROOT:
+			{
+				xl_btree_split *xlrec = (xl_btree_split *) data;
+
+				rnode = xlrec->node;
+				blknos[nblknos++] = xlrec->leftsib;
+				if (xlrec->rnext != P_NONE)
+					blknos[nblknos++] = xlrec->rnext;
+			}
+			break;
+		case XLOG_BTREE_VACUUM:
+			{
+				xl_btree_vacuum *xlrec = (xl_btree_vacuum *) data;
+
+				rnode = xlrec->node;
+				blknos[nblknos++] = xlrec->block;
+			}
+			break;
+		case XLOG_BTREE_DELETE:
+			{
+				xl_btree_delete *xlrec = (xl_btree_delete *) data;
+
+				rnode = xlrec->node;
+				blknos[nblknos++] = xlrec->block;
+			}
+			break;
+		case XLOG_BTREE_MARK_PAGE_HALFDEAD:
+			{
+				xl_btree_mark_page_halfdead *xlrec =
+				(xl_btree_mark_page_halfdead *) data;
+
+				rnode = xlrec->target.node;
+				blknos[nblknos++] = ItemPointerGetBlockNumber(&xlrec->target.tid);
+				blknos[nblknos++] = xlrec->leafblk;
+			}
+			break;
+		case XLOG_BTREE_UNLINK_PAGE:
+		case XLOG_BTREE_UNLINK_PAGE_META:
+			{
+				xl_btree_unlink_page *xlrec = (xl_btree_unlink_page *) data;
+
+				rnode = xlrec->node;
+				blknos[nblknos++] = xlrec->deadblk;
+				if (xlrec->leftsib != P_NONE)
+					blknos[nblknos++] = xlrec->leftsib;
+				blknos[nblknos++] = xlrec->rightsib;
+			}
+			break;
+		default:
+			/* NEWROOT and REUSE_PAGE don't read existing pages */
+			return 0;
+	}
+
+	for (i = 0; i < nblknos; i++)
+	{
+		refs[i].rnode = rnode;
+		refs[i].forknum = MAIN_FORKNUM;
+		refs[i].blkno = blknos[i];
+	}
+
+	return nblknos;
+}
@@ -1,7 +1,7 @@
 /*-------------------------------------------------------------------------
  *
  * hashdesc.c
- *	  rmgr descriptor routines for access/hash/hash.c
+ *	  rmgr descriptor routines for access/hash/hashxlog.c
  *
  * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -16,7 +16,122 @@
 
 #include "access/hash.h"
 
+static void
+out_node(StringInfo buf, RelFileNode *node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u",
+					 node->spcNode, node->dbNode, node->relNode);
+}
+
 void
 hash_desc(StringInfo buf, uint8 xl_info, char *rec)
 {
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_HASH_INSERT:
+			{
+				xl_hash_insert *xlrec = (xl_hash_insert *) rec;
+
+				appendStringInfoString(buf, "insert: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; tid %u/%u",
+								 xlrec->blkno, xlrec->offnum);
+				break;
+			}
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			{
+				xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) rec;
+
+				appendStringInfoString(buf, "add_ovfl_page: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; bucket %u, page %u after %u",
+								 xlrec->bucket, xlrec->ovflblkno,
+								 xlrec->tailblkno);
+				if (BlockNumberIsValid(xlrec->mapblkno))
+					appendStringInfo(buf, ", bitmap %u bit %u",
+									 xlrec->mapblkno, xlrec->mapbit);
+				if (BlockNumberIsValid(xlrec->newmapblkno))
+					appendStringInfo(buf, ", new bitmap %u",
+									 xlrec->newmapblkno);
+				break;
+			}
+		case XLOG_HASH_SPLIT_ALLOCATE_PAGE:
+			{
+				xl_hash_split_allocate_page *xlrec = (xl_hash_split_allocate_page *) rec;
+
+				appendStringInfoString(buf, "split_allocate_page: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; new bucket %u, old %u, new %u",
+								 xlrec->new_bucket, xlrec->old_blkno,
+								 xlrec->new_blkno);
+				break;
+			}
+		case XLOG_HASH_SPLIT_COMPLETE:
+			{
+				xl_hash_split_complete *xlrec = (xl_hash_split_complete *) rec;
+
+				appendStringInfoString(buf, "split_complete: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; old %u, new %u",
+								 xlrec->old_blkno, xlrec->new_blkno);
+				break;
+			}
+		case XLOG_HASH_SPLIT_CLEANUP:
+			{
+				xl_hash_split_cleanup *xlrec = (xl_hash_split_cleanup *) rec;
+
+				appendStringInfoString(buf, "split_cleanup: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; bucket page %u", xlrec->bucket_blkno);
+				break;
+			}
+		case XLOG_HASH_DELETE:
+			{
+				xl_hash_delete *xlrec = (xl_hash_delete *) rec;
+
+				appendStringInfoString(buf, "delete: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; bucket page %u, page %u",
+								 xlrec->bucket_blkno, xlrec->blkno);
+				break;
+			}
+		case XLOG_HASH_MOVE_PAGE_CONTENTS:
+			{
+				xl_hash_move_page_contents *xlrec = (xl_hash_move_page_contents *) rec;
+
+				appendStringInfoString(buf, "move_page_contents: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; bucket page %u, %u tuples from %u to %u",
+								 xlrec->bucket_blkno, xlrec->ntups,
+								 xlrec->rblkno, xlrec->wblkno);
+				break;
+			}
+		case XLOG_HASH_FREE_OVFL_PAGE:
+			{
+				xl_hash_free_ovfl_page *xlrec = (xl_hash_free_ovfl_page *) rec;
+
+				appendStringInfoString(buf, "free_ovfl_page: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; bucket page %u, page %u, bitmap %u bit %u",
+								 xlrec->bucket_blkno, xlrec->ovflblkno,
+								 xlrec->mapblkno, xlrec->mapbit);
+				if (xlrec->update_firstfree)
+					appendStringInfo(buf, ", firstfree %u", xlrec->firstfree);
+				break;
+			}
+		case XLOG_HASH_UPDATE_META_PAGE:
+			{
+				xl_hash_update_meta_page *xlrec = (xl_hash_update_meta_page *) rec;
+
+				appendStringInfoString(buf, "update_meta_page: ");
+				out_node(buf, &xlrec->node);
+				appendStringInfo(buf, "; ntuples %.0f", xlrec->ntuples);
+				break;
+			}
+		default:
+			appendStringInfoString(buf, "UNKNOWN");
+			break;
+	}
 }
@@ -556,6 +556,11 @@ AssignTransactionId(TransactionState s)
 	 *
 	 * This is correct even for the case where several levels above us didn't
 	 * have an xid assigned as we recursed up to them beforehand.
+	 *
+	 * With wal_level = logical the assignment is logged right away, so that
+	 * logical decoding knows the toplevel transaction of a subtransaction
+	 * before it sees the subtransaction's changes. That's required to stream
+	 * the changes of large in-progress transactions.
 	 */
 	if (isSubXact && XLogStandbyInfoActive())
 	{
@@ -567,7 +572,7 @@ AssignTransactionId(TransactionState s)
 		 * RecoverPreparedTransactions()
 		 */
 		if (nUnreportedXids >= PGPROC_MAX_CACHED_SUBXIDS ||
-			log_unknown_top)
+			log_unknown_top || XLogLogicalInfoActive())
 		{
 			XLogRecData rdata[2];
 			xl_xact_assignment xlrec;
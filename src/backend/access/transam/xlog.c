@@ -31,11 +31,13 @@
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
 #include "catalog/pg_control.h"
 #include "catalog/pg_database.h"
+#include "common/relpath.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/bgwriter.h"
@@ -59,6 +61,7 @@
 #include "storage/spin.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/pg_lzcompress.h"
 #include "utils/ps_status.h"
 #include "utils/relmapper.h"
 #include "utils/snapmgr.h"
@@ -84,6 +87,7 @@ char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
 bool		wal_log_hints = false;
+bool		wal_compression = false;
 bool		log_checkpoints = false;
 int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
@@ -491,6 +495,17 @@ typedef struct XLogCtlData
 	XLogRecPtr	unloggedLSN;
 	slock_t		ulsn_lck;
 
+	/*
+	 * Queue of backends waiting in XLogFlush, most recent first, and whether
+	 * some backend is acting as flush leader for them.  The histogram counts
+	 * the flushes done by leaders by the number of requests they served.
+	 * Protected by flushqueue_lck.
+	 */
+	PGPROC	   *flushQueueHead;
+	bool		flushLeaderActive;
+	uint64		flushBatches[XLOG_FLUSH_BATCH_BUCKETS];
+	slock_t		flushqueue_lck;
+
 	/* Time of last xlog segment switch. Protected by WALWriteLock. */
 	pg_time_t	lastSegSwitchTime;
 
@@ -725,6 +740,19 @@ static bool updateMinRecoveryPoint = true;
  */
 bool		reachedConsistency = false;
 
+/*
+ * Scratch space for compressed backup blocks, while XLogInsert assembles a
+ * record.  The union forces the alignment pglz needs for its header.
+ */
+typedef union
+{
+	char		data[PGLZ_MAX_OUTPUT(BLCKSZ)];
+	double		force_align_d;
+	int64		force_align_i64;
+} CompressedPageBuffer;
+
+static CompressedPageBuffer compressed_pages[XLR_MAX_BKP_BLOCKS];
+
 static bool InRedo = false;
 
 /* Have we launched bgwriter during recovery? */
@@ -754,11 +782,17 @@ static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 
 static bool XLogCheckBuffer(XLogRecData *rdata, bool holdsExclusiveLock,
 				XLogRecPtr *lsn, BkpBlock *bkpb);
+static bool XLogCompressBackupBlock(char *source, BkpBlock *bkpb, char *dest);
 static Buffer RestoreBackupBlockContents(XLogRecPtr lsn, BkpBlock bkpb,
 						 char *blk, bool get_cleanup_lock, bool keep_buffer);
 static void AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
 static bool XLogCheckpointNeeded(XLogSegNo new_segno);
 static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
+static void XLogFlushUpTo(XLogRecPtr target);
+static bool XLogFlushJoinGroup(XLogRecPtr record);
+static XLogRecPtr XLogFlushGatherGroup(XLogRecPtr record, PGPROC **group,
+					 int *nmembers);
+static void XLogFlushReleaseGroup(PGPROC *group, int nmembers);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 					   bool find_free, int *max_advance,
 					   bool use_lock);
@@ -845,7 +879,7 @@ XLogInsert(RmgrId rmid, uint8 info, XLogRecData *rdata)
 	XLogRecData dtbuf_rdt2[XLR_MAX_BKP_BLOCKS];
 	XLogRecData dtbuf_rdt3[XLR_MAX_BKP_BLOCKS];
 	XLogRecData hdr_rdt;
-	pg_crc32	rdata_crc;
+	pg_crc32c	rdata_crc;
 	uint32		len,
 				write_len;
 	unsigned	i;
@@ -993,6 +1027,7 @@ begin:;
 	{
 		BkpBlock   *bkpb;
 		char	   *page;
+		bool		compressed = false;
 
 		if (!dtbuf_bkp[i])
 			continue;
@@ -1012,7 +1047,31 @@ begin:;
 		rdt->next = &(dtbuf_rdt2[i]);
 		rdt = rdt->next;
 
-		if (bkpb->hole_length == 0)
+		if (wal_compression)
+		{
+			char		hole_free[BLCKSZ];
+			char	   *source = page;
+
+			if (bkpb->hole_length != 0)
+			{
+				memcpy(hole_free, page, bkpb->hole_offset);
+				memcpy(hole_free + bkpb->hole_offset,
+					   page + (bkpb->hole_offset + bkpb->hole_length),
+					   BLCKSZ - (bkpb->hole_offset + bkpb->hole_length));
+				source = hole_free;
+			}
+			compressed = XLogCompressBackupBlock(source, bkpb,
+												 compressed_pages[i].data);
+		}
+
+		if (compressed)
+		{
+			rdt->data = compressed_pages[i].data;
+			rdt->len = bkpb->length;
+			write_len += bkpb->length;
+			rdt->next = NULL;
+		}
+		else if (bkpb->hole_length == 0)
 		{
 			rdt->data = page;
 			rdt->len = BLCKSZ;
@@ -1044,9 +1103,9 @@ begin:;
 	 * the whole record in the order: rdata, then backup blocks, then record
 	 * header.
 	 */
-	INIT_CRC32(rdata_crc);
+	INIT_CRC32C(rdata_crc);
 	for (rdt = rdata; rdt != NULL; rdt = rdt->next)
-		COMP_CRC32(rdata_crc, rdt->data, rdt->len);
+		COMP_CRC32C(rdata_crc, rdt->data, rdt->len);
 
 	/*
 	 * Construct record header (prev-link is filled in later, after reserving
@@ -1061,7 +1120,7 @@ begin:;
 	rechdr->xl_info = info;
 	rechdr->xl_rmid = rmid;
 	rechdr->xl_prev = InvalidXLogRecPtr;
-	COMP_CRC32(rdata_crc, ((char *) rechdr), offsetof(XLogRecord, xl_prev));
+	COMP_CRC32C(rdata_crc, ((char *) rechdr), offsetof(XLogRecord, xl_prev));
 
 	hdr_rdt.next = rdata;
 	hdr_rdt.data = (char *) rechdr;
@@ -1178,8 +1237,8 @@ begin:;
 		 * Now that xl_prev has been filled in, finish CRC calculation of the
 		 * record header.
 		 */
-		COMP_CRC32(rdata_crc, ((char *) &rechdr->xl_prev), sizeof(XLogRecPtr));
-		FIN_CRC32(rdata_crc);
+		COMP_CRC32C(rdata_crc, ((char *) &rechdr->xl_prev), sizeof(XLogRecPtr));
+		FIN_CRC32C(rdata_crc);
 		rechdr->xl_crc = rdata_crc;
 
 		/*
@@ -2009,6 +2068,31 @@ XLogCheckBufferNeedsBackup(Buffer buffer)
 	return false;				/* buffer does not need to be backed up */
 }
 
+/*
+ * Try to compress the image of a page being backed up.  source is the page
+ * with its hole already left out, so BLCKSZ - bkpb->hole_length bytes long.
+ *
+ * If compression makes it smaller, store the compressed image in dest,
+ * which must have room for PGLZ_MAX_OUTPUT(BLCKSZ) bytes and be suitably
+ * aligned, set BKPBLOCK_IS_COMPRESSED and the length in *bkpb, and return
+ * true.  Otherwise leave *bkpb alone and return false.
+ */
+static bool
+XLogCompressBackupBlock(char *source, BkpBlock *bkpb, char *dest)
+{
+	int32		orig_len = BLCKSZ - bkpb->hole_length;
+
+	if (!pglz_compress(source, orig_len, (PGLZ_Header *) dest,
+					   PGLZ_strategy_default))
+		return false;
+	if (VARSIZE(dest) >= orig_len)
+		return false;
+
+	bkpb->length = VARSIZE(dest);
+	bkpb->flags |= BKPBLOCK_IS_COMPRESSED;
+	return true;
+}
+
 /*
  * Determine whether the buffer referenced by an XLogRecData item has to
  * be backed up, and if so fill a BkpBlock struct for it.  In any case
@@ -2066,6 +2150,8 @@ XLogCheckBuffer(XLogRecData *rdata, bool holdsExclusiveLock,
 			bkpb->hole_offset = 0;
 			bkpb->hole_length = 0;
 		}
+		bkpb->length = BLCKSZ - bkpb->hole_length;
+		bkpb->flags = 0;
 
 		return true;			/* buffer requires backup */
 	}
@@ -2705,44 +2791,17 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 }
 
 /*
- * Ensure that all XLOG data through the given position is flushed to disk.
+ * Write and flush XLOG at least up to 'target', on behalf of XLogFlush.
  *
- * NOTE: this differs from XLogWrite mainly in that the WALWriteLock is not
- * already held, and we try to avoid acquiring it if possible.
+ * Must be called in a critical section.  On return, LogwrtResult is up to
+ * date.
  */
-void
-XLogFlush(XLogRecPtr record)
+static void
+XLogFlushUpTo(XLogRecPtr target)
 {
 	XLogRecPtr	WriteRqstPtr;
 	XLogwrtRqst WriteRqst;
 
-	/*
-	 * During REDO, we are reading not writing WAL.  Therefore, instead of
-	 * trying to flush the WAL, we should update minRecoveryPoint instead. We
-	 * test XLogInsertAllowed(), not InRecovery, because we need checkpointer
-	 * to act this way too, and because when it tries to write the
-	 * end-of-recovery checkpoint, it should indeed flush.
-	 */
-	if (!XLogInsertAllowed())
-	{
-		UpdateMinRecoveryPoint(record, false);
-		return;
-	}
-
-	/* Quick exit if already known flushed */
-	if (record <= LogwrtResult.Flush)
-		return;
-
-#ifdef WAL_DEBUG
-	if (XLOG_DEBUG)
-		elog(LOG, "xlog flush request %X/%X; write %X/%X; flush %X/%X",
-			 (uint32) (record >> 32), (uint32) record,
-			 (uint32) (LogwrtResult.Write >> 32), (uint32) LogwrtResult.Write,
-		   (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
-#endif
-
-	START_CRIT_SECTION();
-
 	/*
 	 * Since fsync is usually a horribly expensive operation, we try to
 	 * piggyback as much data as we can on each fsync: if we see any more data
@@ -2752,7 +2811,7 @@ XLogFlush(XLogRecPtr record)
 	 */
 
 	/* initialize to given target; may increase below */
-	WriteRqstPtr = record;
+	WriteRqstPtr = target;
 
 	/*
 	 * Now wait until we get the write lock, or someone else does the flush
@@ -2772,7 +2831,7 @@ XLogFlush(XLogRecPtr record)
 		SpinLockRelease(&xlogctl->info_lck);
 
 		/* done already? */
-		if (record <= LogwrtResult.Flush)
+		if (target <= LogwrtResult.Flush)
 			break;
 
 		/*
@@ -2800,15 +2859,230 @@ XLogFlush(XLogRecPtr record)
 
 		/* Got the lock; recheck whether request is satisfied */
 		LogwrtResult = XLogCtl->LogwrtResult;
-		if (record <= LogwrtResult.Flush)
+		if (target <= LogwrtResult.Flush)
 		{
 			LWLockRelease(WALWriteLock);
 			break;
 		}
 
+		/* try to write/flush later additions to XLOG as well */
+		WriteRqst.Write = insertpos;
+		WriteRqst.Flush = insertpos;
+
+		XLogWrite(WriteRqst, false);
+
+		LWLockRelease(WALWriteLock);
+		/* done */
+		break;
+	}
+}
+
+/*
+ * Join the queue of backends waiting in XLogFlush to have WAL flushed up to
+ * 'record'.
+ *
+ * If no other backend is acting as flush leader, we become the leader and
+ * return true at once.  Otherwise we sleep on our semaphore until the leader
+ * tells us that it has flushed our request, and return false; or until it
+ * passes leadership on to us because more requests queued up behind it, in
+ * which case we return true.  A leader must call XLogFlushGatherGroup and
+ * XLogFlushReleaseGroup in turn.
+ *
+ * We don't use the process latch for this, because a wakeup meant for
+ * somebody else waiting on it in this backend would be lost.  Like
+ * LWLockAcquire, we absorb any unrelated semaphore wakeups while we wait and
+ * re-post them before returning.
+ */
+static bool
+XLogFlushJoinGroup(XLogRecPtr record)
+{
+	/* use volatile pointers to prevent code rearrangement */
+	volatile XLogCtlData *xlogctl = XLogCtl;
+	volatile PGPROC *proc = MyProc;
+	bool		leader;
+	int			extraWaits = 0;
+
+	Assert(proc->flushState == XLOG_FLUSH_NOT_WAITING);
+
+	proc->flushRqst = record;
+	proc->flushState = XLOG_FLUSH_WAITING;
+
+	SpinLockAcquire(&xlogctl->flushqueue_lck);
+	proc->flushWaitLink = xlogctl->flushQueueHead;
+	xlogctl->flushQueueHead = MyProc;
+	leader = !xlogctl->flushLeaderActive;
+	xlogctl->flushLeaderActive = true;
+	SpinLockRelease(&xlogctl->flushqueue_lck);
+
+	if (leader)
+		return true;
+
+	for (;;)
+	{
+		/* "false" means cannot accept cancel/die interrupt here. */
+		PGSemaphoreLock(&MyProc->sem, false);
+		if (proc->flushState != XLOG_FLUSH_WAITING)
+			break;
+		extraWaits++;
+	}
+
+	/* make sure we see whatever the leader did before waking us */
+	pg_read_barrier();
+
+	/*
+	 * Fix the process wait semaphore's count for any absorbed wakeups.
+	 */
+	while (extraWaits-- > 0)
+		PGSemaphoreUnlock(&MyProc->sem);
+
+	if (proc->flushState == XLOG_FLUSH_LEADER)
+		return true;
+
+	proc->flushState = XLOG_FLUSH_NOT_WAITING;
+	return false;
+}
+
+/*
+ * Take over the queue of XLogFlush waiters as its leader.
+ *
+ * The queue is detached, so that backends arriving from now on form the
+ * next group.  Returns the highest LSN requested in the group, which
+ * includes our own 'record', and the group and its size for
+ * XLogFlushReleaseGroup.
+ */
+static XLogRecPtr
+XLogFlushGatherGroup(XLogRecPtr record, PGPROC **group, int *nmembers)
+{
+	volatile XLogCtlData *xlogctl = XLogCtl;
+	XLogRecPtr	target = record;
+	volatile PGPROC *proc;
+	int			n = 0;
+
+	SpinLockAcquire(&xlogctl->flushqueue_lck);
+	*group = xlogctl->flushQueueHead;
+	xlogctl->flushQueueHead = NULL;
+	SpinLockRelease(&xlogctl->flushqueue_lck);
+
+	for (proc = *group; proc != NULL; proc = proc->flushWaitLink)
+	{
+		if (target < proc->flushRqst)
+			target = proc->flushRqst;
+		n++;
+	}
+
+	*nmembers = n;
+	return target;
+}
+
+/*
+ * Wake up the followers in a group after flushing for them, and hand
+ * leadership over to the first backend that has queued up meanwhile, if any.
+ */
+static void
+XLogFlushReleaseGroup(PGPROC *group, int nmembers)
+{
+	volatile XLogCtlData *xlogctl = XLogCtl;
+	volatile PGPROC *nextleader;
+	int			bucket;
+
+	while (group != NULL)
+	{
+		volatile PGPROC *proc = group;
+
+		group = proc->flushWaitLink;
+		if (proc == MyProc)
+			continue;
+
 		/*
-		 * Sleep before flush! By adding a delay here, we may give further
-		 * backends the opportunity to join the backlog of group commit
+		 * Once flushState is changed, the follower can return and queue up
+		 * again, so unlink it first.
+		 */
+		proc->flushWaitLink = NULL;
+		pg_write_barrier();
+		proc->flushState = XLOG_FLUSH_DONE;
+		PGSemaphoreUnlock((PGSemaphore) &proc->sem);
+	}
+
+	MyProc->flushWaitLink = NULL;
+	MyProc->flushState = XLOG_FLUSH_NOT_WAITING;
+
+	/* bucket i holds batches of 2^i up to 2^(i+1) - 1 backends */
+	for (bucket = 0; bucket < XLOG_FLUSH_BATCH_BUCKETS - 1; bucket++)
+	{
+		if (nmembers < (2 << bucket))
+			break;
+	}
+
+	SpinLockAcquire(&xlogctl->flushqueue_lck);
+	xlogctl->flushBatches[bucket]++;
+	nextleader = xlogctl->flushQueueHead;
+	if (nextleader != NULL)
+		nextleader->flushState = XLOG_FLUSH_LEADER;
+	else
+		xlogctl->flushLeaderActive = false;
+	SpinLockRelease(&xlogctl->flushqueue_lck);
+
+	if (nextleader != NULL)
+		PGSemaphoreUnlock((PGSemaphore) &nextleader->sem);
+}
+
+/*
+ * Ensure that all XLOG data through the given position is flushed to disk.
+ *
+ * NOTE: this differs from XLogWrite mainly in that the WALWriteLock is not
+ * already held, and we try to avoid acquiring it if possible.
+ */
+void
+XLogFlush(XLogRecPtr record)
+{
+
+	/*
+	 * During REDO, we are reading not writing WAL.  Therefore, instead of
+	 * trying to flush the WAL, we should update minRecoveryPoint instead. We
+	 * test XLogInsertAllowed(), not InRecovery, because we need checkpointer
+	 * to act this way too, and because when it tries to write the
+	 * end-of-recovery checkpoint, it should indeed flush.
+	 */
+	if (!XLogInsertAllowed())
+	{
+		UpdateMinRecoveryPoint(record, false);
+		return;
+	}
+
+	/* Quick exit if already known flushed */
+	if (record <= LogwrtResult.Flush)
+		return;
+
+#ifdef WAL_DEBUG
+	if (XLOG_DEBUG)
+		elog(LOG, "xlog flush request %X/%X; write %X/%X; flush %X/%X",
+			 (uint32) (record >> 32), (uint32) record,
+			 (uint32) (LogwrtResult.Write >> 32), (uint32) LogwrtResult.Write,
+		   (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
+#endif
+
+	START_CRIT_SECTION();
+
+	/*
+	 * Join the queue of backends waiting for a flush.  If there's already a
+	 * flush leader, we just sleep until a leader has flushed our record, or
+	 * until we're chosen to lead the next flush.  The leader flushes up to
+	 * the highest LSN requested by anyone in the queue, so that concurrently
+	 * committing backends share a single write and fsync.
+	 *
+	 * Processes without a PGPROC can't wait; they just flush on their own.
+	 */
+	if (MyProc == NULL)
+		XLogFlushUpTo(record);
+	else if (XLogFlushJoinGroup(record))
+	{
+		XLogRecPtr	target;
+		PGPROC	   *group;
+		int			nmembers;
+
+		/*
+		 * Sleep before flush!  By adding a delay here, we may give further
+		 * backends the opportunity to join the queue of group commit
 		 * followers; this can significantly improve transaction throughput,
 		 * at the risk of increasing transaction latency.
 		 *
@@ -2817,31 +3091,23 @@ XLogFlush(XLogRecPtr record)
 		 */
 		if (CommitDelay > 0 && enableFsync &&
 			MinimumActiveBackends(CommitSiblings))
-		{
 			pg_usleep(CommitDelay);
 
-			/*
-			 * Re-check how far we can now flush the WAL. It's generally not
-			 * safe to call WaitXLogInsetionsToFinish while holding
-			 * WALWriteLock, because an in-progress insertion might need to
-			 * also grab WALWriteLock to make progress. But we know that all
-			 * the insertions up to insertpos have already finished, because
-			 * that's what the earlier WaitXLogInsertionsToFinish() returned.
-			 * We're only calling it again to allow insertpos to be moved
-			 * further forward, not to actually wait for anyone.
-			 */
-			insertpos = WaitXLogInsertionsToFinish(insertpos);
-		}
-
-		/* try to write/flush later additions to XLOG as well */
-		WriteRqst.Write = insertpos;
-		WriteRqst.Flush = insertpos;
+		/* take over the queue, and flush far enough for all of it */
+		target = XLogFlushGatherGroup(record, &group, &nmembers);
+		XLogFlushUpTo(target);
 
-		XLogWrite(WriteRqst, false);
+		/* let the followers go, and pass on leadership if more have queued */
+		XLogFlushReleaseGroup(group, nmembers);
+	}
+	else
+	{
+		/* a leader did the flush for us; fetch the result */
+		volatile XLogCtlData *xlogctl = XLogCtl;
 
-		LWLockRelease(WALWriteLock);
-		/* done */
-		break;
+		SpinLockAcquire(&xlogctl->info_lck);
+		LogwrtResult = xlogctl->LogwrtResult;
+		SpinLockRelease(&xlogctl->info_lck);
 	}
 
 	END_CRIT_SECTION();
@@ -4018,7 +4284,7 @@ RestoreBackupBlock(XLogRecPtr lsn, XLogRecord *record, int block_index,
 											  keep_buffer);
 		}
 
-		blk += BLCKSZ - bkpb.hole_length;
+		blk += bkpb.length;
 	}
 
 	/* Caller specified a bogus block_index */
@@ -4037,6 +4303,26 @@ RestoreBackupBlockContents(XLogRecPtr lsn, BkpBlock bkpb, char *blk,
 {
 	Buffer		buffer;
 	Page		page;
+	char		uncompressed[BLCKSZ];
+
+	/* Decompress the image first, if needed */
+	if (bkpb.flags & BKPBLOCK_IS_COMPRESSED)
+	{
+		CompressedPageBuffer compressed;
+
+		/* copy to aligned storage; the header is accessed as int32s */
+		if (bkpb.length > sizeof(compressed))
+			elog(ERROR, "invalid compressed backup block length %u",
+				 bkpb.length);
+		memcpy(compressed.data, blk, bkpb.length);
+		if (VARSIZE(compressed.data) != bkpb.length ||
+			PGLZ_RAW_SIZE((PGLZ_Header *) compressed.data) !=
+			BLCKSZ - bkpb.hole_length)
+			elog(ERROR, "invalid compressed backup block of %s block %u",
+				 relpathperm(bkpb.node, bkpb.fork), bkpb.block);
+		pglz_decompress((PGLZ_Header *) compressed.data, uncompressed);
+		blk = uncompressed;
+	}
 
 	buffer = XLogReadBufferExtended(bkpb.node, bkpb.fork, bkpb.block,
 									RBM_ZERO);
@@ -4354,11 +4640,11 @@ WriteControlFile(void)
 	ControlFile->float8ByVal = FLOAT8PASSBYVAL;
 
 	/* Contents are protected with a CRC */
-	INIT_CRC32(ControlFile->crc);
-	COMP_CRC32(ControlFile->crc,
+	INIT_CRC32C(ControlFile->crc);
+	COMP_CRC32C(ControlFile->crc,
 			   (char *) ControlFile,
 			   offsetof(ControlFileData, crc));
-	FIN_CRC32(ControlFile->crc);
+	FIN_CRC32C(ControlFile->crc);
 
 	/*
 	 * We write out PG_CONTROL_SIZE bytes into pg_control, zero-padding the
@@ -4407,7 +4693,7 @@ WriteControlFile(void)
 static void
 ReadControlFile(void)
 {
-	pg_crc32	crc;
+	pg_crc32c	crc;
 	int			fd;
 
 	/*
@@ -4454,13 +4740,13 @@ ReadControlFile(void)
 				 errhint("It looks like you need to initdb.")));
 
 	/* Now check the CRC. */
-	INIT_CRC32(crc);
-	COMP_CRC32(crc,
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc,
 			   (char *) ControlFile,
 			   offsetof(ControlFileData, crc));
-	FIN_CRC32(crc);
+	FIN_CRC32C(crc);
 
-	if (!EQ_CRC32(crc, ControlFile->crc))
+	if (!EQ_CRC32C(crc, ControlFile->crc))
 		ereport(FATAL,
 				(errmsg("incorrect checksum in control file")));
 
@@ -4596,11 +4882,11 @@ UpdateControlFile(void)
 {
 	int			fd;
 
-	INIT_CRC32(ControlFile->crc);
-	COMP_CRC32(ControlFile->crc,
+	INIT_CRC32C(ControlFile->crc);
+	COMP_CRC32C(ControlFile->crc,
 			   (char *) ControlFile,
 			   offsetof(ControlFileData, crc));
-	FIN_CRC32(ControlFile->crc);
+	FIN_CRC32C(ControlFile->crc);
 
 	fd = BasicOpenFile(XLOG_CONTROL_FILE,
 					   O_RDWR | PG_BINARY,
@@ -4855,6 +5141,7 @@ XLOGShmemInit(void)
 	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
+	SpinLockInit(&XLogCtl->flushqueue_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
 
 	/*
@@ -4881,7 +5168,7 @@ BootStrapXLOG(void)
 	bool		use_existent;
 	uint64		sysidentifier;
 	struct timeval tv;
-	pg_crc32	crc;
+	pg_crc32c	crc;
 
 	/*
 	 * Select a hopefully-unique system identifier code for this installation.
@@ -4957,10 +5244,10 @@ BootStrapXLOG(void)
 	record->xl_rmid = RM_XLOG_ID;
 	memcpy(XLogRecGetData(record), &checkPoint, sizeof(checkPoint));
 
-	INIT_CRC32(crc);
-	COMP_CRC32(crc, &checkPoint, sizeof(checkPoint));
-	COMP_CRC32(crc, (char *) record, offsetof(XLogRecord, xl_crc));
-	FIN_CRC32(crc);
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, &checkPoint, sizeof(checkPoint));
+	COMP_CRC32C(crc, (char *) record, offsetof(XLogRecord, xl_crc));
+	FIN_CRC32C(crc);
 	record->xl_crc = crc;
 
 	/* Create first XLOG segment file */
@@ -6326,6 +6613,13 @@ StartupXLOG(void)
 		InRecovery = true;
 	}
 
+	/*
+	 * After a clean shutdown, load the activity statistics saved by the
+	 * checkpointer.  If we have to recover, they are reset below instead.
+	 */
+	if (!InRecovery)
+		pgstat_restore_stats();
+
 	/* REDO */
 	if (InRecovery)
 	{
@@ -6581,6 +6875,7 @@ StartupXLOG(void)
 		{
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
+			XLogPrefetcher *prefetcher;
 
 			InRedo = true;
 
@@ -6588,6 +6883,9 @@ StartupXLOG(void)
 					(errmsg("redo starts at %X/%X",
 						 (uint32) (ReadRecPtr >> 32), (uint32) ReadRecPtr)));
 
+			/* Start reading ahead to prefetch the blocks we'll need */
+			prefetcher = XLogPrefetcherAllocate(ThisTimeLineID);
+
 			/*
 			 * main redo apply loop
 			 */
@@ -6619,6 +6917,9 @@ StartupXLOG(void)
 				/* Handle interrupt signals of startup process */
 				HandleStartupProcInterrupts();
 
+				/* Prefetch blocks for records further ahead */
+				XLogPrefetcherReadAhead(prefetcher, ReadRecPtr, ThisTimeLineID);
+
 				/*
 				 * Pause WAL replay, if requested by a hot-standby session via
 				 * SetRecoveryPause().
@@ -6786,6 +7087,8 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			XLogPrefetcherFree(prefetcher);
+
 			if (recoveryPauseAtTarget && reachedStopPoint)
 			{
 				SetRecoveryPause(true);
@@ -8865,6 +9168,21 @@ XLogSaveBufferForHint(Buffer buffer, bool buffer_std)
 		memcpy(copied_buffer + bkpb.hole_offset,
 			   origdata + bkpb.hole_offset + bkpb.hole_length,
 			   BLCKSZ - bkpb.hole_offset - bkpb.hole_length);
+		rdata[1].data = copied_buffer;
+		rdata[1].len = bkpb.length;
+
+		/*
+		 * Compress the copy, if requested.  We can borrow the first
+		 * compressed_pages slot, since XLogInsert won't need it for a record
+		 * that references no buffers.
+		 */
+		if (wal_compression &&
+			XLogCompressBackupBlock(copied_buffer, &bkpb,
+									compressed_pages[0].data))
+		{
+			rdata[1].data = compressed_pages[0].data;
+			rdata[1].len = bkpb.length;
+		}
 
 		/*
 		 * Header for backup block.
@@ -8877,8 +9195,6 @@ XLogSaveBufferForHint(Buffer buffer, bool buffer_std)
 		/*
 		 * Save copy of the buffer.
 		 */
-		rdata[1].data = copied_buffer;
-		rdata[1].len = BLCKSZ - bkpb.hole_length;
 		rdata[1].buffer = InvalidBuffer;
 		rdata[1].next = NULL;
 
@@ -10320,6 +10636,23 @@ GetXLogWriteRecPtr(void)
 	return LogwrtResult.Write;
 }
 
+/*
+ * Get the histogram of group flush batch sizes; 'batches' must have room for
+ * XLOG_FLUSH_BATCH_BUCKETS counters.
+ */
+void
+GetXLogFlushBatchStats(uint64 *batches)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogCtlData *xlogctl = XLogCtl;
+	int			i;
+
+	SpinLockAcquire(&xlogctl->flushqueue_lck);
+	for (i = 0; i < XLOG_FLUSH_BATCH_BUCKETS; i++)
+		batches[i] = xlogctl->flushBatches[i];
+	SpinLockRelease(&xlogctl->flushqueue_lck);
+}
+
 /*
  * Returns the redo pointer of the last checkpoint or restartpoint. This is
  * the oldest point in WAL that we still need, if we have to restart recovery.
@@ -0,0 +1,635 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Read-ahead of data blocks referenced by WAL during recovery.
+ *
+ * The startup process replays WAL records one at a time, and each record
+ * that modifies a page not already in shared buffers has to wait for a
+ * synchronous read of that page.  On storage with high latency that makes
+ * replay much slower than the primary, even though the disks are mostly
+ * idle.  To avoid that, we decode records up to recovery_prefetch_distance
+ * bytes ahead of the replay position with a second XLogReader, ask each
+ * record's resource manager which blocks it will read, and issue
+ * asynchronous prefetch requests for those that are not in shared buffers
+ * yet.  By the time replay gets to the record, the read is hopefully done.
+ *
+ * The prefetcher reads only WAL that is already on disk in pg_xlog: segment
+ * files left from before a crash, or files written by the walreceiver, up to
+ * the point it has flushed.  It does not restore files from the archive or
+ * wait for more WAL to arrive; when it runs out, it simply waits for replay
+ * to catch up with it and then tries again.  Any failure to read or decode
+ * WAL ahead is ignored, since replay itself will deal with it in due course.
+ *
+ * Blocks restored from full-page images don't need to be read, nor do
+ * blocks past the current end of their relation (or of relations that don't
+ * exist yet), which WAL replay will extend or create.  We can't prefetch
+ * those anyway, so we need to know whether each relation fork exists and how
+ * long it is.  We can't ask the storage manager: mdexists() and mdnblocks()
+ * raise an ERROR if a segment file is missing or can't be opened, and so does
+ * mdprefetch() for a block that isn't there, and an ERROR in the startup
+ * process ends recovery.  Instead we stat() the segment files ourselves, and
+ * only hand blocks that we have seen on disk to smgrprefetch().  To avoid
+ * doing that for every block reference, we remember the answers in a small
+ * cache.  Replay only ever extends relations, except when it replays records
+ * that create, truncate or drop storage; the prefetcher sees those records
+ * before replay does, and then forgets the cache and checks every block
+ * directly until replay has caught up with them.
+ *
+ * The counters shown in pg_stat_prefetch_recovery are kept locally and only
+ * copied to shared memory every XLOGPREFETCH_PUBLISH_RECORDS replayed
+ * records, and whenever the prefetcher runs out of WAL or starts over, so
+ * that replay doesn't take a spinlock for every record.
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "common/relpath.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "utils/hsearch.h"
+
+
+/* GUC variable: how far ahead of replay to look, in kilobytes of WAL */
+int			recovery_prefetch_distance = 256;
+
+/* Forget the relation size cache when it gets this big */
+#define XLOGPREFETCH_MAX_RELS	1024
+
+/* Copy the counters to shared memory this often, in replayed records */
+#define XLOGPREFETCH_PUBLISH_RECORDS	256
+
+/* What we know about the size of a relation fork */
+typedef struct XLogPrefetchRelKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} XLogPrefetchRelKey;
+
+typedef struct XLogPrefetchRel
+{
+	XLogPrefetchRelKey key;		/* hash key (must be first) */
+	bool		exists;			/* does the fork exist? */
+	BlockNumber nblocks;		/* its length, if so */
+	XLogRecPtr	checkedPtr;		/* replay position when we checked */
+} XLogPrefetchRel;
+
+/* Private state of the prefetcher, kept by the startup process */
+struct XLogPrefetcher
+{
+	XLogReaderState *reader;	/* our own reader, ahead of replay */
+	TimeLineID	tli;			/* timeline we are reading WAL from */
+	bool		positioned;		/* has reader read a valid record? */
+	bool		stalled;		/* ran out of WAL at reader->EndRecPtr? */
+
+	/* currently open WAL segment, if any */
+	int			readFile;
+	XLogSegNo	readSegNo;
+
+	/* last block considered, to skip runs of references to it */
+	bool		haveLastRef;
+	XLogBlockRef lastRef;
+
+	/*
+	 * Cache of relation fork sizes, or NULL if not built yet.  It's not
+	 * used until replay reaches noCacheUntil, the end of the last record
+	 * seen that creates, truncates or drops storage.
+	 */
+	HTAB	   *relCache;
+	XLogRecPtr	noCacheUntil;
+
+	XLogPrefetchStats stats;	/* local copy of the counters */
+	int			unpublished;	/* records replayed since we copied them */
+};
+
+/* Shared copy of the counters, for pg_stat_prefetch_recovery */
+typedef struct XLogPrefetchShared
+{
+	slock_t		mutex;			/* protects stats */
+	XLogPrefetchStats stats;
+} XLogPrefetchShared;
+
+static XLogPrefetchShared *XLogPrefetchShmem = NULL;
+
+static int XLogPrefetcherReadPage(XLogReaderState *reader,
+					   XLogRecPtr targetPagePtr, int reqLen,
+					   XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI);
+static void XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher,
+						 XLogRecord *record, XLogRecPtr replayPtr);
+static bool XLogPrefetcherBlockExists(XLogPrefetcher *prefetcher,
+						  RelFileNode rnode, ForkNumber forknum,
+						  BlockNumber blkno, XLogRecPtr replayPtr);
+static BlockNumber XLogPrefetcherRelSize(RelFileNode rnode,
+					  ForkNumber forknum);
+static bool XLogRecordChangesStorage(XLogRecord *record);
+static void XLogPrefetcherForgetRels(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherReset(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherPublishStats(XLogPrefetcher *prefetcher);
+
+
+/*
+ * Initialization of shared memory for the prefetch statistics
+ */
+Size
+XLogPrefetchShmemSize(void)
+{
+	return sizeof(XLogPrefetchShared);
+}
+
+void
+XLogPrefetchShmemInit(void)
+{
+	bool		found;
+
+	XLogPrefetchShmem = (XLogPrefetchShared *)
+		ShmemInitStruct("XLog Prefetch Stats", XLogPrefetchShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		SpinLockInit(&XLogPrefetchShmem->mutex);
+		memset(&XLogPrefetchShmem->stats, 0, sizeof(XLogPrefetchStats));
+	}
+}
+
+/*
+ * Set up read-ahead for WAL replay, starting on timeline tli.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(TimeLineID tli)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader = XLogReaderAllocate(&XLogPrefetcherReadPage,
+											prefetcher);
+	if (prefetcher->reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+			errdetail("Failed while allocating an XLog reading processor.")));
+	prefetcher->reader->system_identifier = GetSystemIdentifier();
+	prefetcher->tli = tli;
+	prefetcher->readFile = -1;
+
+	XLogPrefetcherPublishStats(prefetcher);
+
+	return prefetcher;
+}
+
+/*
+ * Shut down read-ahead at the end of replay.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	XLogPrefetcherReset(prefetcher);
+	XLogPrefetcherPublishStats(prefetcher);
+	XLogReaderFree(prefetcher->reader);
+	pfree(prefetcher);
+}
+
+/*
+ * Forget the read-ahead position, so that we start over from the replay
+ * position next time.
+ */
+static void
+XLogPrefetcherReset(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->readFile >= 0)
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+	prefetcher->positioned = false;
+	prefetcher->stalled = false;
+	prefetcher->haveLastRef = false;
+	prefetcher->stats.distance = 0;
+
+	/* we won't see the storage changes between here and where we restart */
+	XLogPrefetcherForgetRels(prefetcher);
+}
+
+/*
+ * Forget the cached relation sizes.
+ */
+static void
+XLogPrefetcherForgetRels(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->relCache != NULL)
+	{
+		hash_destroy(prefetcher->relCache);
+		prefetcher->relCache = NULL;
+	}
+}
+
+/*
+ * Read ahead of the record starting at replayPtr, which is about to be
+ * replayed on timeline tli, and issue prefetches for the blocks referenced
+ * by records up to recovery_prefetch_distance beyond it.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogRecPtr replayPtr,
+						TimeLineID tli)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	XLogRecPtr	limit;
+	XLogRecord *record;
+	char	   *errormsg;
+
+	if (recovery_prefetch_distance <= 0)
+	{
+		/* disabled, maybe just now by a config reload */
+		if (prefetcher->positioned)
+		{
+			XLogPrefetcherReset(prefetcher);
+			XLogPrefetcherPublishStats(prefetcher);
+		}
+		return;
+	}
+
+	/* Segment files are named by timeline, so start over if it changes */
+	if (tli != prefetcher->tli)
+	{
+		XLogPrefetcherReset(prefetcher);
+		prefetcher->tli = tli;
+	}
+
+	if (prefetcher->positioned && reader->EndRecPtr > replayPtr)
+	{
+		/* If we ran out of WAL, wait until replay has caught up with us */
+		if (prefetcher->stalled)
+			return;
+	}
+	else
+	{
+		/*
+		 * We haven't started yet, or replay has overtaken us.  Start reading
+		 * from the record being replayed, which is known to be valid.
+		 */
+		prefetcher->positioned = false;
+		prefetcher->stalled = false;
+		record = XLogReadRecord(reader, replayPtr, &errormsg);
+		if (record == NULL)
+		{
+			if (prefetcher->stats.distance != 0)
+			{
+				prefetcher->stats.distance = 0;
+				XLogPrefetcherPublishStats(prefetcher);
+			}
+			return;
+		}
+		prefetcher->positioned = true;
+	}
+
+	limit = replayPtr + (XLogRecPtr) recovery_prefetch_distance * 1024;
+	while (reader->EndRecPtr < limit)
+	{
+		record = XLogReadRecord(reader, InvalidXLogRecPtr, &errormsg);
+		if (record == NULL)
+		{
+			prefetcher->stalled = true;
+			break;
+		}
+		XLogPrefetcherScanRecord(prefetcher, record, replayPtr);
+	}
+
+	prefetcher->stats.distance = reader->EndRecPtr - replayPtr;
+
+	/*
+	 * Replay may be about to wait for more WAL when we run out, so make sure
+	 * the counters are up to date then; otherwise publish them only now and
+	 * then.
+	 */
+	if (prefetcher->stalled ||
+		++prefetcher->unpublished >= XLOGPREFETCH_PUBLISH_RECORDS)
+		XLogPrefetcherPublishStats(prefetcher);
+}
+
+/*
+ * Issue prefetches for the blocks that replay of record will read.
+ */
+static void
+XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher, XLogRecord *record,
+						 XLogRecPtr replayPtr)
+{
+	const RmgrData *rmgr = &RmgrTable[record->xl_rmid];
+	XLogBlockRef refs[XLR_MAX_BKP_BLOCKS];
+	BkpBlock	bkpbs[XLR_MAX_BKP_BLOCKS];
+	int			nrefs;
+	int			nbkpbs = 0;
+	char	   *blk;
+	int			i;
+	int			j;
+
+	/*
+	 * Until replay has done what this record does to storage, sizes read
+	 * from disk can't be trusted to stay valid.
+	 */
+	if (XLogRecordChangesStorage(record))
+	{
+		XLogPrefetcherForgetRels(prefetcher);
+		prefetcher->noCacheUntil = prefetcher->reader->EndRecPtr;
+	}
+
+	if (rmgr->rm_blockrefs == NULL)
+		return;
+	nrefs = rmgr->rm_blockrefs(record, refs);
+	if (nrefs == 0)
+		return;
+
+	/* Collect the full-page images attached to the record */
+	blk = (char *) XLogRecGetData(record) + record->xl_len;
+	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
+	{
+		if (!(record->xl_info & XLR_BKP_BLOCK(i)))
+			continue;
+
+		memcpy(&bkpbs[nbkpbs], blk, sizeof(BkpBlock));
+		blk += sizeof(BkpBlock) + bkpbs[nbkpbs].length;
+		nbkpbs++;
+	}
+
+	for (i = 0; i < nrefs; i++)
+	{
+		XLogBlockRef *ref = &refs[i];
+		SMgrRelation reln;
+
+		/* Replay will restore the page from its image, no need to read it */
+		for (j = 0; j < nbkpbs; j++)
+		{
+			if (RelFileNodeEquals(bkpbs[j].node, ref->rnode) &&
+				bkpbs[j].fork == ref->forknum &&
+				bkpbs[j].block == ref->blkno)
+				break;
+		}
+		if (j < nbkpbs)
+		{
+			prefetcher->stats.skip_fpw++;
+			continue;
+		}
+
+		/* Consecutive records often touch the same page */
+		if (prefetcher->haveLastRef &&
+			RelFileNodeEquals(prefetcher->lastRef.rnode, ref->rnode) &&
+			prefetcher->lastRef.forknum == ref->forknum &&
+			prefetcher->lastRef.blkno == ref->blkno)
+		{
+			prefetcher->stats.skip_seq++;
+			continue;
+		}
+		prefetcher->lastRef = *ref;
+		prefetcher->haveLastRef = true;
+
+		/*
+		 * The relation might not have been created yet, or the block might
+		 * be about to be added by an extension we haven't replayed yet.
+		 * smgrprefetch() requires the block to exist, so check first.
+		 */
+		if (!XLogPrefetcherBlockExists(prefetcher, ref->rnode, ref->forknum,
+									   ref->blkno, replayPtr))
+		{
+			prefetcher->stats.skip_new++;
+			continue;
+		}
+
+		reln = smgropen(ref->rnode, InvalidBackendId);
+		if (PrefetchSharedBuffer(reln, ref->forknum, ref->blkno))
+			prefetcher->stats.prefetch++;
+		else
+			prefetcher->stats.skip_hit++;
+	}
+}
+
+/*
+ * Does the block exist on disk?
+ *
+ * Uses the relation size cache when it's safe to do so.  A cached size may
+ * be too small, since replay extends relations; if the block is past it, the
+ * size is read again, but no more than once per replayed record.
+ */
+static bool
+XLogPrefetcherBlockExists(XLogPrefetcher *prefetcher, RelFileNode rnode,
+						  ForkNumber forknum, BlockNumber blkno,
+						  XLogRecPtr replayPtr)
+{
+	XLogPrefetchRelKey key;
+	XLogPrefetchRel *rel;
+	BlockNumber nblocks;
+	bool		found;
+
+	/* Storage is about to change under us; check directly */
+	if (replayPtr < prefetcher->noCacheUntil)
+	{
+		nblocks = XLogPrefetcherRelSize(rnode, forknum);
+		return nblocks != InvalidBlockNumber && blkno < nblocks;
+	}
+
+	if (prefetcher->relCache == NULL ||
+		hash_get_num_entries(prefetcher->relCache) >= XLOGPREFETCH_MAX_RELS)
+	{
+		HASHCTL		ctl;
+
+		XLogPrefetcherForgetRels(prefetcher);
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(XLogPrefetchRelKey);
+		ctl.entrysize = sizeof(XLogPrefetchRel);
+		ctl.hash = tag_hash;
+		prefetcher->relCache = hash_create("XLog prefetch relation sizes",
+										   XLOGPREFETCH_MAX_RELS, &ctl,
+										   HASH_ELEM | HASH_FUNCTION);
+	}
+
+	/* RelFileNode and ForkNumber leave no padding in the key */
+	key.rnode = rnode;
+	key.forknum = forknum;
+	rel = (XLogPrefetchRel *) hash_search(prefetcher->relCache, &key,
+										  HASH_ENTER, &found);
+
+	if (!found ||
+		(blkno >= rel->nblocks && rel->checkedPtr < replayPtr))
+	{
+		nblocks = XLogPrefetcherRelSize(rnode, forknum);
+		rel->exists = (nblocks != InvalidBlockNumber);
+		rel->nblocks = rel->exists ? nblocks : 0;
+		rel->checkedPtr = replayPtr;
+	}
+
+	return rel->exists && blkno < rel->nblocks;
+}
+
+/*
+ * How many blocks does a relation fork have on disk?  Returns
+ * InvalidBlockNumber if it doesn't exist.
+ *
+ * Like mdnblocks(), this counts the blocks in the segment files up to the
+ * first one that isn't full, but it uses stat() and never raises an ERROR;
+ * any problem with a file just makes the count stop there.  Since all the
+ * segments up to the one holding a counted block exist, smgrprefetch() of
+ * that block won't fail for want of a segment, nor create one.
+ */
+static BlockNumber
+XLogPrefetcherRelSize(RelFileNode rnode, ForkNumber forknum)
+{
+	char	   *path;
+	char	   *segpath;
+	struct stat st;
+	BlockNumber nblocks = 0;
+	BlockNumber segno;
+
+	path = relpathperm(rnode, forknum);
+	if (stat(path, &st) < 0)
+	{
+		pfree(path);
+		return InvalidBlockNumber;
+	}
+
+	segpath = (char *) palloc(strlen(path) + 12);
+	for (segno = 1;; segno++)
+	{
+		nblocks += (BlockNumber) (st.st_size / BLCKSZ);
+		if (st.st_size < (off_t) RELSEG_SIZE * BLCKSZ)
+			break;
+
+		sprintf(segpath, "%s.%u", path, segno);
+		if (stat(segpath, &st) < 0)
+			break;
+	}
+
+	pfree(segpath);
+	pfree(path);
+
+	return nblocks;
+}
+
+/*
+ * Does replay of this record create, truncate or remove relation files?
+ */
+static bool
+XLogRecordChangesStorage(XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	char	   *data = XLogRecGetData(record);
+
+	switch (record->xl_rmid)
+	{
+		case RM_SMGR_ID:
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			return true;
+
+		case RM_XACT_ID:
+			/* commits and aborts can drop relations */
+			switch (info)
+			{
+				case XLOG_XACT_COMMIT:
+					return ((xl_xact_commit *) data)->nrels > 0;
+				case XLOG_XACT_ABORT:
+					return ((xl_xact_abort *) data)->nrels > 0;
+				case XLOG_XACT_COMMIT_PREPARED:
+					return ((xl_xact_commit_prepared *) data)->crec.nrels > 0;
+				case XLOG_XACT_ABORT_PREPARED:
+					return ((xl_xact_abort_prepared *) data)->arec.nrels > 0;
+				default:
+					return false;
+			}
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * XLogReader read_page callback for the prefetcher.  Reads the page from a
+ * segment file in pg_xlog if it is there, and fails otherwise.
+ */
+static int
+XLogPrefetcherReadPage(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogRecPtr	flushPtr = InvalidXLogRecPtr;
+	XLogSegNo	segno;
+	uint32		offset;
+
+	/* Don't read beyond what the walreceiver has flushed */
+	if (WalRcvRunning())
+	{
+		flushPtr = GetWalRcvWriteRecPtr(NULL, NULL);
+		if (targetPagePtr + reqLen > flushPtr)
+			return -1;
+	}
+
+	XLByteToSeg(targetPagePtr, segno);
+	if (prefetcher->readFile >= 0 && segno != prefetcher->readSegNo)
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+	if (prefetcher->readFile < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno);
+		prefetcher->readFile = BasicOpenFile(path, O_RDONLY | PG_BINARY, 0);
+		if (prefetcher->readFile < 0)
+			return -1;
+		prefetcher->readSegNo = segno;
+	}
+
+	offset = targetPagePtr % XLogSegSize;
+	if (lseek(prefetcher->readFile, (off_t) offset, SEEK_SET) < 0 ||
+		read(prefetcher->readFile, readBuf, XLOG_BLCKSZ) != XLOG_BLCKSZ)
+		return -1;
+
+	*pageTLI = prefetcher->tli;
+
+	if (!XLogRecPtrIsInvalid(flushPtr) &&
+		flushPtr - targetPagePtr < XLOG_BLCKSZ)
+		return (int) (flushPtr - targetPagePtr);
+	return XLOG_BLCKSZ;
+}
+
+/*
+ * Copy the startup process's counters to shared memory.
+ */
+static void
+XLogPrefetcherPublishStats(XLogPrefetcher *prefetcher)
+{
+	SpinLockAcquire(&XLogPrefetchShmem->mutex);
+	XLogPrefetchShmem->stats = prefetcher->stats;
+	SpinLockRelease(&XLogPrefetchShmem->mutex);
+
+	prefetcher->unpublished = 0;
+}
+
+/*
+ * Fetch the current counters, for pg_stat_prefetch_recovery.
+ */
+void
+XLogPrefetchGetStats(XLogPrefetchStats *stats)
+{
+	SpinLockAcquire(&XLogPrefetchShmem->mutex);
+	*stats = XLogPrefetchShmem->stats;
+	SpinLockRelease(&XLogPrefetchShmem->mutex);
+}
@@ -46,6 +46,8 @@
 #include "catalog/pg_foreign_table.h"
 #include "catalog/pg_inherits.h"
 #include "catalog/pg_namespace.h"
+#include "catalog/pg_opclass.h"
+#include "catalog/pg_partitioned_table.h"
 #include "catalog/pg_statistic.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_type.h"
@@ -1396,7 +1398,13 @@ RelationRemoveInheritance(Oid relid)
 							  NULL, 1, &key);
 
 	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		/* a partitioned parent caches the bounds of its partitions */
+		if (!heap_attisnull(tuple, Anum_pg_inherits_inhpartbound))
+			CacheInvalidateRelcacheByRelid(((Form_pg_inherits) GETSTRUCT(tuple))->inhparent);
+
 		simple_heap_delete(catalogRelation, &tuple->t_self);
+	}
 
 	systable_endscan(scan);
 	heap_close(catalogRelation, RowExclusiveLock);
@@ -1783,6 +1791,12 @@ heap_drop_with_catalog(Oid relid)
 		heap_close(rel, RowExclusiveLock);
 	}
 
+	/*
+	 * Likewise the pg_partitioned_table tuple of a partitioned table.
+	 */
+	if (rel->rd_rel->relkind == RELKIND_RELATION)
+		RemovePartitionKeyByRelId(relid);
+
 	/*
 	 * Schedule unlinking of the relation's physical files at commit.
 	 */
@@ -2659,6 +2673,88 @@ RemoveStatistics(Oid relid, AttrNumber attnum)
 }
 
 
+/*
+ * StorePartitionKey
+ *		Store the partition key of a partitioned table rel in
+ *		pg_partitioned_table.
+ */
+void
+StorePartitionKey(Relation rel, char strategy, AttrNumber partattr,
+				  Oid partopclass, Oid partcollation)
+{
+	Relation	pg_partitioned_table;
+	HeapTuple	tuple;
+	Datum		values[Natts_pg_partitioned_table];
+	bool		nulls[Natts_pg_partitioned_table];
+	ObjectAddress myself;
+	ObjectAddress referenced;
+
+	Assert(rel->rd_rel->relkind == RELKIND_RELATION);
+
+	pg_partitioned_table = heap_open(PartitionedRelationId, RowExclusiveLock);
+
+	MemSet(nulls, false, sizeof(nulls));
+	values[Anum_pg_partitioned_table_partrelid - 1] =
+		ObjectIdGetDatum(RelationGetRelid(rel));
+	values[Anum_pg_partitioned_table_partstrat - 1] = CharGetDatum(strategy);
+	values[Anum_pg_partitioned_table_partattr - 1] = Int16GetDatum(partattr);
+	values[Anum_pg_partitioned_table_partclass - 1] =
+		ObjectIdGetDatum(partopclass);
+	values[Anum_pg_partitioned_table_partcollation - 1] =
+		ObjectIdGetDatum(partcollation);
+
+	tuple = heap_form_tuple(RelationGetDescr(pg_partitioned_table),
+							values, nulls);
+
+	simple_heap_insert(pg_partitioned_table, tuple);
+	CatalogUpdateIndexes(pg_partitioned_table, tuple);
+
+	heap_freetuple(tuple);
+	heap_close(pg_partitioned_table, RowExclusiveLock);
+
+	/* The key depends on its operator class and collation */
+	myself.classId = RelationRelationId;
+	myself.objectId = RelationGetRelid(rel);
+	myself.objectSubId = 0;
+
+	referenced.classId = OperatorClassRelationId;
+	referenced.objectId = partopclass;
+	referenced.objectSubId = 0;
+	recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+
+	if (OidIsValid(partcollation) && partcollation != DEFAULT_COLLATION_OID)
+	{
+		referenced.classId = CollationRelationId;
+		referenced.objectId = partcollation;
+		referenced.objectSubId = 0;
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
+	CacheInvalidateRelcache(rel);
+}
+
+/*
+ * RemovePartitionKeyByRelId
+ *		Remove the pg_partitioned_table entry of a relation, if it has one.
+ */
+void
+RemovePartitionKeyByRelId(Oid relid)
+{
+	Relation	rel;
+	HeapTuple	tuple;
+
+	tuple = SearchSysCache1(PARTRELID, ObjectIdGetDatum(relid));
+	if (!HeapTupleIsValid(tuple))
+		return;
+
+	rel = heap_open(PartitionedRelationId, RowExclusiveLock);
+	simple_heap_delete(rel, &tuple->t_self);
+	heap_close(rel, RowExclusiveLock);
+
+	ReleaseSysCache(tuple);
+}
+
+
 /*
  * RelationTruncateIndexes - truncate all indexes associated
  * with the heap relation to zero tuples.
@@ -25,6 +25,7 @@
 
 #include "access/multixact.h"
 #include "access/relscan.h"
+#include "access/subtrans.h"
 #include "access/sysattr.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
@@ -105,6 +106,18 @@ static void UpdateIndexRelation(Oid indexoid, Oid heapoid,
 static void index_update_stats(Relation rel,
 				   bool hasindex, bool isprimary,
 				   double reltuples);
+static bool IndexBuildIsOwnTransaction(IndexInfo *indexInfo,
+						   TransactionId xid);
+static double IndexBuildHeapScanInternal(Relation heapRelation,
+						   Relation indexRelation,
+						   IndexInfo *indexInfo,
+						   bool allow_sync,
+						   bool anyvisible,
+						   BlockNumber start_blockno,
+						   BlockNumber numblocks,
+						   ParallelHeapScanDesc pscan,
+						   IndexBuildCallback callback,
+						   void *callback_state);
 static void IndexCheckExclusion(Relation heapRelation,
 					Relation indexRelation,
 					IndexInfo *indexInfo);
@@ -2095,6 +2108,100 @@ IndexBuildHeapScan(Relation heapRelation,
 				   bool allow_sync,
 				   IndexBuildCallback callback,
 				   void *callback_state)
+{
+	return IndexBuildHeapRangeScan(heapRelation, indexRelation,
+								   indexInfo, allow_sync,
+								   false,
+								   0, InvalidBlockNumber,
+								   callback, callback_state);
+}
+
+/*
+ * Is the given in-progress XID one that the index build treats as its own?
+ *
+ * Normally that's just our own (sub)transactions.  The workers of a parallel
+ * index build run in transactions of their own, though, and must treat
+ * insertions and deletions made by the leader's transaction as it would:
+ * waiting for the leader to finish would deadlock, since it waits for them.
+ */
+static bool
+IndexBuildIsOwnTransaction(IndexInfo *indexInfo, TransactionId xid)
+{
+	TransactionId leaderxid = indexInfo->ii_ParallelLeaderXid;
+
+	if (TransactionIdIsCurrentTransactionId(xid))
+		return true;
+	if (!TransactionIdIsValid(leaderxid))
+		return false;
+	/* subtransactions of the leader have later XIDs than its top level */
+	if (TransactionIdPrecedes(xid, leaderxid))
+		return false;
+	return TransactionIdEquals(SubTransGetTopmostTransaction(xid), leaderxid);
+}
+
+/*
+ * As above, except that instead of scanning the complete heap, only the given
+ * number of blocks are scanned.  Scan to end-of-rel can be signalled by
+ * passing InvalidBlockNumber as numblocks.  Note that restricting the range
+ * to scan cannot be done when requesting syncscan.
+ *
+ * When "anyvisible" mode is requested, all tuples visible to any transaction
+ * are considered, including those inserted or deleted by transactions that are
+ * still in progress.  This is meant for callers that only hold a lock which
+ * allows concurrent insertions, and that can tolerate indexing tuples that
+ * will never become visible (such as block-range summaries).
+ */
+double
+IndexBuildHeapRangeScan(Relation heapRelation,
+						Relation indexRelation,
+						IndexInfo *indexInfo,
+						bool allow_sync,
+						bool anyvisible,
+						BlockNumber start_blockno,
+						BlockNumber numblocks,
+						IndexBuildCallback callback,
+						void *callback_state)
+{
+	return IndexBuildHeapScanInternal(heapRelation, indexRelation,
+									  indexInfo, allow_sync, anyvisible,
+									  start_blockno, numblocks, NULL,
+									  callback, callback_state);
+}
+
+/*
+ * As IndexBuildHeapScan, except that only the blocks handed out by the
+ * given parallel heap scan are scanned.  All the participants of a parallel
+ * index build call this with the same shared scan state, so that between
+ * them they scan every block of the heap exactly once.
+ */
+double
+IndexBuildHeapParallelScan(Relation heapRelation,
+						   Relation indexRelation,
+						   IndexInfo *indexInfo,
+						   ParallelHeapScanDesc pscan,
+						   IndexBuildCallback callback,
+						   void *callback_state)
+{
+	return IndexBuildHeapScanInternal(heapRelation, indexRelation,
+									  indexInfo, false, false,
+									  0, InvalidBlockNumber, pscan,
+									  callback, callback_state);
+}
+
+/*
+ * Workhorse of IndexBuildHeapRangeScan and IndexBuildHeapParallelScan.
+ */
+static double
+IndexBuildHeapScanInternal(Relation heapRelation,
+						   Relation indexRelation,
+						   IndexInfo *indexInfo,
+						   bool allow_sync,
+						   bool anyvisible,
+						   BlockNumber start_blockno,
+						   BlockNumber numblocks,
+						   ParallelHeapScanDesc pscan,
+						   IndexBuildCallback callback,
+						   void *callback_state)
 {
 	bool		is_system_catalog;
 	bool		checking_uniqueness;
@@ -2113,9 +2220,12 @@ IndexBuildHeapScan(Relation heapRelation,
 	OffsetNumber root_offsets[MaxHeapTuplesPerPage];
 
 	/*
-	 * sanity checks
+	 * sanity checks.  A parallel index build worker has no relcache entry for
+	 * the index being built, and passes a NULL indexRelation.
 	 */
-	Assert(OidIsValid(indexRelation->rd_rel->relam));
+	Assert(indexRelation != NULL ?
+		   OidIsValid(indexRelation->rd_rel->relam) :
+		   TransactionIdIsValid(indexInfo->ii_ParallelLeaderXid));
 
 	/* Remember if it's a system catalog */
 	is_system_catalog = IsSystemRelation(heapRelation);
@@ -2159,12 +2269,33 @@ IndexBuildHeapScan(Relation heapRelation,
 		OldestXmin = GetOldestXmin(heapRelation, true);
 	}
 
-	scan = heap_beginscan_strat(heapRelation,	/* relation */
-								snapshot,		/* snapshot */
-								0,		/* number of keys */
-								NULL,	/* scan key */
-								true,	/* buffer access strategy OK */
-								allow_sync);	/* syncscan OK? */
+	if (pscan != NULL)
+	{
+		/* the shared scan state decides which blocks we get to see */
+		Assert(!allow_sync);
+		Assert(start_blockno == 0 && numblocks == InvalidBlockNumber);
+		scan = heap_beginscan_parallel(heapRelation, pscan, snapshot,
+									   0, NULL);
+	}
+	else
+	{
+		scan = heap_beginscan_strat(heapRelation,	/* relation */
+									snapshot,	/* snapshot */
+									0,	/* number of keys */
+									NULL,	/* scan key */
+									true,	/* buffer access strategy OK */
+									allow_sync);	/* syncscan OK? */
+
+		/* set our scan endpoints */
+		if (!allow_sync)
+			heap_setscanlimits(scan, start_blockno, numblocks);
+		else
+		{
+			/* syncscan can only be requested on whole relation */
+			Assert(start_blockno == 0);
+			Assert(numblocks == InvalidBlockNumber);
+		}
+	}
 
 	reltuples = 0;
 
@@ -2268,6 +2399,17 @@ IndexBuildHeapScan(Relation heapRelation,
 					break;
 				case HEAPTUPLE_INSERT_IN_PROGRESS:
 
+					/*
+					 * In "anyvisible" mode, this tuple is visible and we
+					 * don't need any further checks.
+					 */
+					if (anyvisible)
+					{
+						indexIt = true;
+						tupleIsAlive = true;
+						break;
+					}
+
 					/*
 					 * Since caller should hold ShareLock or better, normally
 					 * the only way to see this is if it was inserted earlier
@@ -2277,7 +2419,7 @@ IndexBuildHeapScan(Relation heapRelation,
 					 * applies.
 					 */
 					xwait = HeapTupleHeaderGetXmin(heapTuple->t_data);
-					if (!TransactionIdIsCurrentTransactionId(xwait))
+					if (!IndexBuildIsOwnTransaction(indexInfo, xwait))
 					{
 						if (!is_system_catalog)
 							elog(WARNING, "concurrent insert in progress within table \"%s\"",
@@ -2311,12 +2453,23 @@ IndexBuildHeapScan(Relation heapRelation,
 					break;
 				case HEAPTUPLE_DELETE_IN_PROGRESS:
 
+					/*
+					 * In "anyvisible" mode, this tuple is visible and we
+					 * don't need any further checks.
+					 */
+					if (anyvisible)
+					{
+						indexIt = true;
+						tupleIsAlive = false;
+						break;
+					}
+
 					/*
 					 * As with INSERT_IN_PROGRESS case, this is unexpected
 					 * unless it's our own deletion or a system catalog.
 					 */
 					xwait = HeapTupleHeaderGetUpdateXid(heapTuple->t_data);
-					if (!TransactionIdIsCurrentTransactionId(xwait))
+					if (!IndexBuildIsOwnTransaction(indexInfo, xwait))
 					{
 						if (!is_system_catalog)
 							elog(WARNING, "concurrent delete in progress within table \"%s\"",
@@ -2442,6 +2595,20 @@ IndexBuildHeapScan(Relation heapRelation,
 			rootTuple = *heapTuple;
 			offnum = ItemPointerGetOffsetNumber(&heapTuple->t_self);
 
+			/*
+			 * In "anyvisible" mode the page may have gained new HOT chain
+			 * members since we built the root map, so rebuild it once before
+			 * complaining.
+			 */
+			if (anyvisible && !OffsetNumberIsValid(root_offsets[offnum - 1]))
+			{
+				Page		page = BufferGetPage(scan->rs_cbuf);
+
+				LockBuffer(scan->rs_cbuf, BUFFER_LOCK_SHARE);
+				heap_get_root_tuples(page, root_offsets);
+				LockBuffer(scan->rs_cbuf, BUFFER_LOCK_UNLOCK);
+			}
+
 			if (!OffsetNumberIsValid(root_offsets[offnum - 1]))
 				elog(ERROR, "failed to find parent tuple for heap-only tuple at (%u,%u) in table \"%s\"",
 					 ItemPointerGetBlockNumber(&heapTuple->t_self),
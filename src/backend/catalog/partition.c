@@ -0,0 +1,1259 @@
+/*-------------------------------------------------------------------------
+ *
+ * partition.c
+ *	  Partitioning related data structures and functions.
+ *
+ * A partitioned table is an inheritance parent whose key (one column and a
+ * btree operator class) is recorded in pg_partitioned_table, and whose
+ * children each carry a partition bound in pg_inherits.inhpartbound.  The
+ * bounds are cached in the parent's relcache entry sorted by the key's
+ * comparison function, so that both routing a tuple to its partition and
+ * pruning partitions that can't satisfy a qual are binary searches rather
+ * than a walk over every partition's constraint.
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/partition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/nbtree.h"
+#include "catalog/indexing.h"
+#include "catalog/partition.h"
+#include "catalog/pg_inherits.h"
+#include "catalog/pg_partitioned_table.h"
+#include "catalog/pg_type.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/relation.h"
+#include "optimizer/clauses.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/tqual.h"
+
+
+/* One partition's bound while the relcache entry is being built */
+typedef struct PartitionBoundEntry
+{
+	Oid			oid;
+	PartitionBoundSpec *spec;
+} PartitionBoundEntry;
+
+/* One listed value of a list partition, for sorting */
+typedef struct PartitionListValue
+{
+	Datum		value;
+	int			index;
+} PartitionListValue;
+
+static void RelationBuildPartitionKey(Relation rel);
+static void RelationBuildPartitionDesc(Relation rel);
+static MemoryContext RelationGetPartitionContext(Relation rel);
+static int	partition_range_entry_cmp(const void *a, const void *b, void *arg);
+static int	partition_list_value_cmp(const void *a, const void *b, void *arg);
+static int	oid_cmp(const void *p1, const void *p2);
+static int partition_rbound_cmp(PartitionKey key,
+					 Datum d1, bool inf1, bool lower1,
+					 Datum d2, bool inf2, bool lower2);
+static int partition_bound_cmp_value(FmgrInfo *cmpfn, Oid collation,
+						  Datum bound, bool inf, bool is_lower,
+						  Datum value);
+static int partition_bound_bsearch(FmgrInfo *cmpfn, Oid collation,
+						Datum *bounds, bool *infs, bool is_lower,
+						int n, Datum value, bool orequal);
+static int partition_index_for_value(PartitionKey key, PartitionDesc pdesc,
+						  FmgrInfo *cmpfn, Datum value);
+static Expr *partition_key_operand(PartitionKey key, Expr *expr);
+static void partition_prune_clause(PartitionKey key, PartitionDesc pdesc,
+					   Index varno, Node *clause, bool *keep);
+static bool partition_prune_value(PartitionKey key, PartitionDesc pdesc,
+					  Oid opno, Oid inputcollid,
+					  bool varonleft, Oid valtype, Datum value,
+					  bool isnull, bool *keep);
+static bool partition_match_key(PartitionKey key, Index varno, Node *node);
+
+
+/*
+ * RelationGetPartitionKey -- get the partition key of a relation
+ *
+ * Returns NULL if the relation is not partitioned.  The result points into
+ * the relcache entry, so callers must not hold on to it across anything
+ * that might process invalidation messages.
+ */
+PartitionKey
+RelationGetPartitionKey(Relation rel)
+{
+	if (!rel->rd_partkeyvalid)
+	{
+		if (rel->rd_rel->relkind == RELKIND_RELATION)
+			RelationBuildPartitionKey(rel);
+		rel->rd_partkeyvalid = true;
+	}
+	return rel->rd_partkey;
+}
+
+/*
+ * RelationGetPartitionDesc -- get the partitions of a partitioned table
+ *
+ * Returns NULL if the relation is not partitioned.  The same caveat about
+ * holding on to the result applies as for RelationGetPartitionKey.  Note
+ * that the set of partitions can't change while the caller holds any lock
+ * on the relation, since adding or removing one takes AccessExclusiveLock.
+ */
+PartitionDesc
+RelationGetPartitionDesc(Relation rel)
+{
+	if (rel->rd_partdesc != NULL)
+		return rel->rd_partdesc;
+
+	if (RelationGetPartitionKey(rel) == NULL)
+		return NULL;
+
+	RelationBuildPartitionDesc(rel);
+	return rel->rd_partdesc;
+}
+
+/*
+ * Get the memory context holding a relation's partitioning information,
+ * creating it if need be.
+ */
+static MemoryContext
+RelationGetPartitionContext(Relation rel)
+{
+	if (rel->rd_partcxt == NULL)
+		rel->rd_partcxt = AllocSetContextCreate(CacheMemoryContext,
+												"partition info",
+												ALLOCSET_SMALL_MINSIZE,
+												ALLOCSET_SMALL_INITSIZE,
+												ALLOCSET_SMALL_MAXSIZE);
+	return rel->rd_partcxt;
+}
+
+/*
+ * RelationBuildPartitionKey
+ *		Load the pg_partitioned_table row of a relation, if any.
+ *
+ * All catalog lookups are done before anything is stored into the relcache
+ * entry: they may process invalidation messages that rebuild the entry.
+ */
+static void
+RelationBuildPartitionKey(Relation rel)
+{
+	HeapTuple	tuple;
+	Form_pg_partitioned_table form;
+	Form_pg_attribute attr;
+	PartitionKeyData keydata;
+	Oid			procid;
+	FmgrInfo	finfo;
+	PartitionKey key;
+
+	tuple = SearchSysCache1(PARTRELID, ObjectIdGetDatum(RelationGetRelid(rel)));
+	if (!HeapTupleIsValid(tuple))
+		return;
+	form = (Form_pg_partitioned_table) GETSTRUCT(tuple);
+
+	keydata.strategy = form->partstrat;
+	keydata.partattr = form->partattr;
+	keydata.partcollation = form->partcollation;
+	keydata.partopfamily = get_opclass_family(form->partclass);
+	keydata.partopcintype = get_opclass_input_type(form->partclass);
+	ReleaseSysCache(tuple);
+
+	attr = rel->rd_att->attrs[keydata.partattr - 1];
+	keydata.parttypid = attr->atttypid;
+	keydata.parttypmod = attr->atttypmod;
+	keydata.parttyplen = attr->attlen;
+	keydata.parttypbyval = attr->attbyval;
+
+	procid = get_opfamily_proc(keydata.partopfamily,
+							   keydata.partopcintype,
+							   keydata.partopcintype,
+							   BTORDER_PROC);
+	if (!OidIsValid(procid))
+		elog(ERROR, "missing support function %d(%u,%u) in opfamily %u",
+			 BTORDER_PROC, keydata.partopcintype, keydata.partopcintype,
+			 keydata.partopfamily);
+	fmgr_info(procid, &finfo);
+
+	key = (PartitionKey) MemoryContextAlloc(RelationGetPartitionContext(rel),
+											sizeof(PartitionKeyData));
+	memcpy(key, &keydata, sizeof(PartitionKeyData));
+	fmgr_info_copy(&key->partsupfunc, &finfo, rel->rd_partcxt);
+
+	rel->rd_partkey = key;
+}
+
+/*
+ * RelationBuildPartitionDesc
+ *		Collect the bounds of a partitioned table's partitions and sort them.
+ *
+ * As in RelationBuildPartitionKey, the result is built in the caller's
+ * context and only copied into the relcache entry once no more catalog
+ * access is needed.
+ */
+static void
+RelationBuildPartitionDesc(Relation rel)
+{
+	PartitionKey key;
+	Relation	inhrel;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	tuple;
+	PartitionBoundEntry *entries;
+	int			nparts = 0;
+	int			maxparts = 32;
+	PartitionListValue *values = NULL;
+	int			nvalues = 0;
+	int			null_index = -1;
+	MemoryContext oldcxt;
+	PartitionDesc pdesc;
+	int			i;
+
+	entries = (PartitionBoundEntry *)
+		palloc(maxparts * sizeof(PartitionBoundEntry));
+
+	inhrel = heap_open(InheritsRelationId, AccessShareLock);
+
+	ScanKeyInit(&skey,
+				Anum_pg_inherits_inhparent,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationGetRelid(rel)));
+
+	scan = systable_beginscan(inhrel, InheritsParentIndexId, true,
+							  NULL, 1, &skey);
+
+	while ((tuple = systable_getnext(scan)) != NULL)
+	{
+		Datum		datum;
+		bool		isnull;
+
+		datum = heap_getattr(tuple, Anum_pg_inherits_inhpartbound,
+							 RelationGetDescr(inhrel), &isnull);
+		if (isnull)
+			continue;
+
+		if (nparts >= maxparts)
+		{
+			maxparts *= 2;
+			entries = (PartitionBoundEntry *)
+				repalloc(entries, maxparts * sizeof(PartitionBoundEntry));
+		}
+		entries[nparts].oid = ((Form_pg_inherits) GETSTRUCT(tuple))->inhrelid;
+		entries[nparts].spec = (PartitionBoundSpec *)
+			stringToNode(TextDatumGetCString(datum));
+		nparts++;
+	}
+
+	systable_endscan(scan);
+	heap_close(inhrel, AccessShareLock);
+
+	key = RelationGetPartitionKey(rel);
+
+	/*
+	 * Put the partitions in their canonical order: by lower bound for range
+	 * partitioning, by OID for list partitioning.
+	 */
+	if (key->strategy == PARTITION_STRATEGY_RANGE)
+		qsort_arg(entries, nparts, sizeof(PartitionBoundEntry),
+				  partition_range_entry_cmp, key);
+	else
+	{
+		int			maxvalues = 32;
+
+		qsort(entries, nparts, sizeof(PartitionBoundEntry), oid_cmp);
+
+		values = (PartitionListValue *)
+			palloc(maxvalues * sizeof(PartitionListValue));
+		for (i = 0; i < nparts; i++)
+		{
+			ListCell   *lc;
+
+			foreach(lc, entries[i].spec->listdatums)
+			{
+				Const	   *val = (Const *) lfirst(lc);
+
+				if (val->constisnull)
+				{
+					null_index = i;
+					continue;
+				}
+				if (nvalues >= maxvalues)
+				{
+					maxvalues *= 2;
+					values = (PartitionListValue *)
+						repalloc(values, maxvalues * sizeof(PartitionListValue));
+				}
+				values[nvalues].value = val->constvalue;
+				values[nvalues].index = i;
+				nvalues++;
+			}
+		}
+		qsort_arg(values, nvalues, sizeof(PartitionListValue),
+				  partition_list_value_cmp, key);
+	}
+
+	/* Now copy it all into the relcache entry */
+	oldcxt = MemoryContextSwitchTo(RelationGetPartitionContext(rel));
+
+	pdesc = (PartitionDesc) palloc0(sizeof(PartitionDescData));
+	pdesc->nparts = nparts;
+	pdesc->oids = (Oid *) palloc(nparts * sizeof(Oid));
+	for (i = 0; i < nparts; i++)
+		pdesc->oids[i] = entries[i].oid;
+	pdesc->null_index = null_index;
+
+	if (key->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		pdesc->lower = (Datum *) palloc0(nparts * sizeof(Datum));
+		pdesc->upper = (Datum *) palloc0(nparts * sizeof(Datum));
+		pdesc->lower_inf = (bool *) palloc(nparts * sizeof(bool));
+		pdesc->upper_inf = (bool *) palloc(nparts * sizeof(bool));
+		for (i = 0; i < nparts; i++)
+		{
+			Const	   *lower = (Const *) entries[i].spec->lowerdatum;
+			Const	   *upper = (Const *) entries[i].spec->upperdatum;
+
+			pdesc->lower_inf[i] = (lower == NULL);
+			if (lower)
+				pdesc->lower[i] = datumCopy(lower->constvalue,
+											key->parttypbyval,
+											key->parttyplen);
+			pdesc->upper_inf[i] = (upper == NULL);
+			if (upper)
+				pdesc->upper[i] = datumCopy(upper->constvalue,
+											key->parttypbyval,
+											key->parttyplen);
+		}
+	}
+	else
+	{
+		pdesc->ndatums = nvalues;
+		pdesc->datums = (Datum *) palloc(nvalues * sizeof(Datum));
+		pdesc->indexes = (int *) palloc(nvalues * sizeof(int));
+		for (i = 0; i < nvalues; i++)
+		{
+			pdesc->datums[i] = datumCopy(values[i].value,
+										 key->parttypbyval,
+										 key->parttyplen);
+			pdesc->indexes[i] = values[i].index;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	rel->rd_partdesc = pdesc;
+}
+
+/* qsort_arg comparator ordering range partitions by lower bound */
+static int
+partition_range_entry_cmp(const void *a, const void *b, void *arg)
+{
+	PartitionKey key = (PartitionKey) arg;
+	Const	   *lower1 = (Const *) ((const PartitionBoundEntry *) a)->spec->lowerdatum;
+	Const	   *lower2 = (Const *) ((const PartitionBoundEntry *) b)->spec->lowerdatum;
+
+	return partition_rbound_cmp(key,
+								lower1 ? lower1->constvalue : (Datum) 0,
+								lower1 == NULL, true,
+								lower2 ? lower2->constvalue : (Datum) 0,
+								lower2 == NULL, true);
+}
+
+/* qsort_arg comparator ordering the values of list partitions */
+static int
+partition_list_value_cmp(const void *a, const void *b, void *arg)
+{
+	PartitionKey key = (PartitionKey) arg;
+
+	return DatumGetInt32(FunctionCall2Coll(&key->partsupfunc,
+										   key->partcollation,
+								   ((const PartitionListValue *) a)->value,
+								  ((const PartitionListValue *) b)->value));
+}
+
+static int
+oid_cmp(const void *p1, const void *p2)
+{
+	Oid			v1 = *((const Oid *) p1);
+	Oid			v2 = *((const Oid *) p2);
+
+	if (v1 < v2)
+		return -1;
+	if (v1 > v2)
+		return 1;
+	return 0;
+}
+
+/*
+ * partition_rbound_cmp
+ *		Compare two range bounds.
+ *
+ * An UNBOUNDED lower bound is below every value and an UNBOUNDED upper
+ * bound above every value.
+ */
+static int
+partition_rbound_cmp(PartitionKey key,
+					 Datum d1, bool inf1, bool lower1,
+					 Datum d2, bool inf2, bool lower2)
+{
+	int			class1 = inf1 ? (lower1 ? -1 : 1) : 0;
+	int			class2 = inf2 ? (lower2 ? -1 : 1) : 0;
+
+	if (class1 != class2)
+		return class1 - class2;
+	if (class1 != 0)
+		return 0;
+	return DatumGetInt32(FunctionCall2Coll(&key->partsupfunc,
+										   key->partcollation,
+										   d1, d2));
+}
+
+/*
+ * partition_bound_cmp_value
+ *		Compare a (possibly UNBOUNDED) partition bound with a value.
+ *
+ * cmpfn is the btree comparison function taking the key's type on the
+ * left and the value's type on the right.
+ */
+static int
+partition_bound_cmp_value(FmgrInfo *cmpfn, Oid collation,
+						  Datum bound, bool inf, bool is_lower,
+						  Datum value)
+{
+	if (inf)
+		return is_lower ? -1 : 1;
+	return DatumGetInt32(FunctionCall2Coll(cmpfn, collation, bound, value));
+}
+
+/*
+ * partition_bound_bsearch
+ *		Count the sorted bounds that are less than value, or less than or
+ *		equal to it if orequal.
+ *
+ * Equivalently, returns the position of the first bound that is above
+ * value (or not below it).  infs may be NULL if no bound is UNBOUNDED.
+ */
+static int
+partition_bound_bsearch(FmgrInfo *cmpfn, Oid collation,
+						Datum *bounds, bool *infs, bool is_lower,
+						int n, Datum value, bool orequal)
+{
+	int			lo = 0,
+				hi = n;
+
+	while (lo < hi)
+	{
+		int			mid = (lo + hi) / 2;
+		int			cmpval;
+
+		cmpval = partition_bound_cmp_value(cmpfn, collation, bounds[mid],
+										   infs ? infs[mid] : false,
+										   is_lower, value);
+		if (cmpval < 0 || (orequal && cmpval == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * partition_index_for_value
+ *		Find the position in pdesc->oids of the partition accepting a
+ *		non-null value, or -1 if there is none.
+ */
+static int
+partition_index_for_value(PartitionKey key, PartitionDesc pdesc,
+						  FmgrInfo *cmpfn, Datum value)
+{
+	int			i;
+
+	if (key->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		/* the last partition whose lower bound is <= value is the candidate */
+		i = partition_bound_bsearch(cmpfn, key->partcollation,
+									pdesc->lower, pdesc->lower_inf, true,
+									pdesc->nparts, value, true) - 1;
+		if (i >= 0 &&
+			partition_bound_cmp_value(cmpfn, key->partcollation,
+									  pdesc->upper[i], pdesc->upper_inf[i],
+									  false, value) > 0)
+			return i;
+	}
+	else
+	{
+		i = partition_bound_bsearch(cmpfn, key->partcollation,
+									pdesc->datums, NULL, false,
+									pdesc->ndatums, value, false);
+		if (i < pdesc->ndatums &&
+			partition_bound_cmp_value(cmpfn, key->partcollation,
+									  pdesc->datums[i], false,
+									  false, value) == 0)
+			return pdesc->indexes[i];
+	}
+	return -1;
+}
+
+/*
+ * get_partition_parent
+ *		Return the partitioned table a relation is a partition of, or
+ *		InvalidOid if it is not a partition.
+ */
+Oid
+get_partition_parent(Oid relid)
+{
+	Relation	inhrel;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	tuple;
+	Oid			result = InvalidOid;
+
+	inhrel = heap_open(InheritsRelationId, AccessShareLock);
+
+	ScanKeyInit(&skey,
+				Anum_pg_inherits_inhrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	scan = systable_beginscan(inhrel, InheritsRelidSeqnoIndexId, true,
+							  NULL, 1, &skey);
+
+	while ((tuple = systable_getnext(scan)) != NULL)
+	{
+		if (!heap_attisnull(tuple, Anum_pg_inherits_inhpartbound))
+		{
+			result = ((Form_pg_inherits) GETSTRUCT(tuple))->inhparent;
+			break;
+		}
+	}
+
+	systable_endscan(scan);
+	heap_close(inhrel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * check_new_partition_bound
+ *		Error out if a new partition's bound is empty or overlaps the bound
+ *		of an existing partition of parent.
+ *
+ * spec must already have been through transformPartitionBound.
+ */
+void
+check_new_partition_bound(char *relname, Relation parent,
+						  PartitionBoundSpec *spec)
+{
+	PartitionKey key = RelationGetPartitionKey(parent);
+	PartitionDesc pdesc = RelationGetPartitionDesc(parent);
+	Oid			overlap = InvalidOid;
+
+	Assert(key != NULL && pdesc != NULL);
+
+	if (spec->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		Const	   *lower = (Const *) spec->lowerdatum;
+		Const	   *upper = (Const *) spec->upperdatum;
+		Datum		lo = lower ? lower->constvalue : (Datum) 0;
+		Datum		hi = upper ? upper->constvalue : (Datum) 0;
+		int			nparts = pdesc->nparts;
+		int			i;
+
+		if (partition_rbound_cmp(key, lo, lower == NULL, true,
+								 hi, upper == NULL, false) >= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+					 errmsg("empty range bound specified for partition \"%s\"",
+							relname)));
+
+		/*
+		 * Since the existing ranges are sorted and disjoint, only the one
+		 * starting at or below the new lower bound and the one after it can
+		 * overlap the new range.
+		 */
+		for (i = 0; i < nparts; i++)
+		{
+			if (partition_rbound_cmp(key, pdesc->lower[i], pdesc->lower_inf[i],
+									 true, lo, lower == NULL, true) > 0)
+				break;
+		}
+		i--;
+
+		if (i >= 0 &&
+			partition_rbound_cmp(key, lo, lower == NULL, true,
+								 pdesc->upper[i], pdesc->upper_inf[i],
+								 false) < 0)
+			overlap = pdesc->oids[i];
+		else if (i + 1 < nparts &&
+				 partition_rbound_cmp(key, pdesc->lower[i + 1],
+									  pdesc->lower_inf[i + 1], true,
+									  hi, upper == NULL, false) < 0)
+			overlap = pdesc->oids[i + 1];
+	}
+	else
+	{
+		ListCell   *lc;
+
+		foreach(lc, spec->listdatums)
+		{
+			Const	   *val = (Const *) lfirst(lc);
+			int			i;
+
+			if (val->constisnull)
+				i = pdesc->null_index;
+			else
+				i = partition_index_for_value(key, pdesc, &key->partsupfunc,
+											  val->constvalue);
+			if (i >= 0)
+			{
+				overlap = pdesc->oids[i];
+				break;
+			}
+		}
+	}
+
+	if (OidIsValid(overlap))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+				 errmsg("partition \"%s\" would overlap partition \"%s\"",
+						relname, get_rel_name(overlap))));
+}
+
+/*
+ * partition_key_operand
+ *		Label an expression of the key column's type with the operator
+ *		class's input type, if they differ.
+ */
+static Expr *
+partition_key_operand(PartitionKey key, Expr *expr)
+{
+	if (key->parttypid != key->partopcintype &&
+		!IsPolymorphicType(key->partopcintype))
+		expr = (Expr *) makeRelabelType(expr, key->partopcintype, -1,
+										key->partcollation,
+										COERCE_IMPLICIT_CAST);
+	return expr;
+}
+
+/*
+ * get_qual_for_partition_bound
+ *		Build the constraint expression implied by a partition bound.
+ *
+ * The expression refers to the key column as attribute childattno of
+ * varno 1, and is suitable for storing as the partition's CHECK constraint.
+ */
+Node *
+get_qual_for_partition_bound(Relation parent, AttrNumber childattno,
+							 PartitionBoundSpec *spec)
+{
+	PartitionKeyData keydata = *RelationGetPartitionKey(parent);
+	PartitionKey key = &keydata;
+	Var		   *keyvar;
+	NullTest   *nulltest;
+	List	   *result = NIL;
+
+	keyvar = makeVar(1, childattno, key->parttypid, key->parttypmod,
+					 key->partcollation, 0);
+
+	if (spec->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		nulltest = makeNode(NullTest);
+		nulltest->arg = (Expr *) keyvar;
+		nulltest->nulltesttype = IS_NOT_NULL;
+		nulltest->argisrow = false;
+		result = lappend(result, nulltest);
+
+		if (spec->lowerdatum)
+		{
+			Oid			opno;
+
+			opno = get_opfamily_member(key->partopfamily,
+									   key->partopcintype,
+									   key->partopcintype,
+									   BTGreaterEqualStrategyNumber);
+			if (!OidIsValid(opno))
+				elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+					 BTGreaterEqualStrategyNumber, key->partopcintype,
+					 key->partopcintype, key->partopfamily);
+			result = lappend(result,
+							 make_opclause(opno, BOOLOID, false,
+							partition_key_operand(key, (Expr *) keyvar),
+					  partition_key_operand(key, (Expr *) spec->lowerdatum),
+										   InvalidOid, key->partcollation));
+		}
+		if (spec->upperdatum)
+		{
+			Oid			opno;
+
+			opno = get_opfamily_member(key->partopfamily,
+									   key->partopcintype,
+									   key->partopcintype,
+									   BTLessStrategyNumber);
+			if (!OidIsValid(opno))
+				elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+					 BTLessStrategyNumber, key->partopcintype,
+					 key->partopcintype, key->partopfamily);
+			result = lappend(result,
+							 make_opclause(opno, BOOLOID, false,
+							partition_key_operand(key, (Expr *) keyvar),
+					  partition_key_operand(key, (Expr *) spec->upperdatum),
+										   InvalidOid, key->partcollation));
+		}
+
+		return (Node *) make_ands_explicit(result);
+	}
+	else
+	{
+		Datum	   *elems;
+		int			nelems = 0;
+		bool		accepts_null = false;
+		ListCell   *lc;
+
+		elems = (Datum *) palloc(list_length(spec->listdatums) * sizeof(Datum));
+		foreach(lc, spec->listdatums)
+		{
+			Const	   *val = (Const *) lfirst(lc);
+
+			if (val->constisnull)
+				accepts_null = true;
+			else
+				elems[nelems++] = val->constvalue;
+		}
+
+		nulltest = makeNode(NullTest);
+		nulltest->arg = (Expr *) keyvar;
+		nulltest->nulltesttype = accepts_null ? IS_NULL : IS_NOT_NULL;
+		nulltest->argisrow = false;
+
+		if (nelems > 0)
+		{
+			ScalarArrayOpExpr *saop;
+			Oid			arraytype;
+			int16		typlen;
+			bool		typbyval;
+			char		typalign;
+			Const	   *arrayconst;
+
+			arraytype = get_array_type(key->parttypid);
+			if (!OidIsValid(arraytype))
+				elog(ERROR, "could not find array type for data type %s",
+					 format_type_be(key->parttypid));
+			get_typlenbyvalalign(key->parttypid, &typlen, &typbyval, &typalign);
+			arrayconst = makeConst(arraytype, -1, InvalidOid, -1,
+								   PointerGetDatum(construct_array(elems,
+																   nelems,
+															key->parttypid,
+																   typlen,
+																   typbyval,
+																 typalign)),
+								   false, false);
+
+			saop = makeNode(ScalarArrayOpExpr);
+			saop->opno = get_opfamily_member(key->partopfamily,
+											 key->partopcintype,
+											 key->partopcintype,
+											 BTEqualStrategyNumber);
+			if (!OidIsValid(saop->opno))
+				elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+					 BTEqualStrategyNumber, key->partopcintype,
+					 key->partopcintype, key->partopfamily);
+			saop->opfuncid = get_opcode(saop->opno);
+			saop->useOr = true;
+			saop->inputcollid = key->partcollation;
+			saop->args = list_make2(partition_key_operand(key, (Expr *) keyvar),
+									arrayconst);
+			saop->location = -1;
+
+			/* NULL is accepted on top of the listed values, if at all */
+			if (accepts_null)
+				return (Node *) makeBoolExpr(OR_EXPR,
+											 list_make2(nulltest, saop),
+											 -1);
+			return (Node *) makeBoolExpr(AND_EXPR,
+										 list_make2(nulltest, saop),
+										 -1);
+		}
+
+		return (Node *) nulltest;
+	}
+}
+
+/*
+ * copy_partition_key
+ *		Copy a partition key into the current memory context.
+ *
+ * Code that needs the key and bounds for longer than RelationGetPartitionKey
+ * and RelationGetPartitionDesc promise them, such as the executor's tuple
+ * routing, works on copies made with this and copy_partition_desc.
+ */
+PartitionKey
+copy_partition_key(PartitionKey key)
+{
+	PartitionKey newkey;
+
+	newkey = (PartitionKey) palloc(sizeof(PartitionKeyData));
+	memcpy(newkey, key, sizeof(PartitionKeyData));
+	fmgr_info_copy(&newkey->partsupfunc, &key->partsupfunc,
+				   CurrentMemoryContext);
+
+	return newkey;
+}
+
+/*
+ * copy_partition_desc
+ *		Copy a partitioned table's partition bounds into the current memory
+ *		context.
+ */
+PartitionDesc
+copy_partition_desc(PartitionKey key, PartitionDesc pdesc)
+{
+	PartitionDesc newdesc;
+	int			nparts = pdesc->nparts;
+	int			i;
+
+	newdesc = (PartitionDesc) palloc0(sizeof(PartitionDescData));
+	newdesc->nparts = nparts;
+	newdesc->oids = (Oid *) palloc(nparts * sizeof(Oid));
+	memcpy(newdesc->oids, pdesc->oids, nparts * sizeof(Oid));
+	newdesc->null_index = pdesc->null_index;
+
+	if (key->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		newdesc->lower = (Datum *) palloc0(nparts * sizeof(Datum));
+		newdesc->upper = (Datum *) palloc0(nparts * sizeof(Datum));
+		newdesc->lower_inf = (bool *) palloc(nparts * sizeof(bool));
+		newdesc->upper_inf = (bool *) palloc(nparts * sizeof(bool));
+		memcpy(newdesc->lower_inf, pdesc->lower_inf, nparts * sizeof(bool));
+		memcpy(newdesc->upper_inf, pdesc->upper_inf, nparts * sizeof(bool));
+		for (i = 0; i < nparts; i++)
+		{
+			if (!pdesc->lower_inf[i])
+				newdesc->lower[i] = datumCopy(pdesc->lower[i],
+											  key->parttypbyval,
+											  key->parttyplen);
+			if (!pdesc->upper_inf[i])
+				newdesc->upper[i] = datumCopy(pdesc->upper[i],
+											  key->parttypbyval,
+											  key->parttyplen);
+		}
+	}
+	else
+	{
+		newdesc->ndatums = pdesc->ndatums;
+		newdesc->datums = (Datum *) palloc(pdesc->ndatums * sizeof(Datum));
+		newdesc->indexes = (int *) palloc(pdesc->ndatums * sizeof(int));
+		memcpy(newdesc->indexes, pdesc->indexes, pdesc->ndatums * sizeof(int));
+		for (i = 0; i < pdesc->ndatums; i++)
+			newdesc->datums[i] = datumCopy(pdesc->datums[i],
+										   key->parttypbyval,
+										   key->parttyplen);
+	}
+
+	return newdesc;
+}
+
+/*
+ * get_partition_index_for_value
+ *		Return the position in pdesc->oids of the partition that accepts the
+ *		given key value, or -1 if there is none.
+ */
+int
+get_partition_index_for_value(PartitionKey key, PartitionDesc pdesc,
+							  Datum value, bool isnull)
+{
+	if (isnull)
+		return pdesc->null_index;
+
+	return partition_index_for_value(key, pdesc, &key->partsupfunc, value);
+}
+
+/*
+ * get_partitions_for_clauses
+ *		Return the OIDs of the partitions of rel that may contain rows
+ *		satisfying all of clauses, in OID order.
+ *
+ * clauses is an implicitly-ANDed list of expressions (or RestrictInfos)
+ * in which varno refers to rel.  Each clause is expected to have been
+ * simplified by eval_const_expressions already.  Clauses comparing the
+ * partition key with a constant using a btree operator of the key's
+ * operator family are used to narrow down the partitions by binary search
+ * over their bounds, as are AND and OR combinations of such clauses;
+ * anything else is ignored.
+ *
+ * Looking up operators while pruning may process invalidation messages, and
+ * so rebuild rel's relcache entry, so the pruning works on copies of the
+ * partition key and bounds rather than on the relcache's.
+ */
+List *
+get_partitions_for_clauses(Relation rel, Index varno, List *clauses)
+{
+	PartitionKey key;
+	PartitionDesc pdesc = RelationGetPartitionDesc(rel);
+	int			nparts;
+	bool	   *keep;
+	bool	   *sub;
+	Oid		   *oids;
+	int			noids = 0;
+	List	   *result = NIL;
+	ListCell   *lc;
+	int			i;
+
+	if (pdesc == NULL || pdesc->nparts == 0)
+		return NIL;
+
+	key = copy_partition_key(RelationGetPartitionKey(rel));
+	pdesc = copy_partition_desc(key, RelationGetPartitionDesc(rel));
+
+	nparts = pdesc->nparts;
+	keep = (bool *) palloc(nparts * sizeof(bool));
+	sub = (bool *) palloc(nparts * sizeof(bool));
+	memset(keep, true, nparts * sizeof(bool));
+
+	foreach(lc, clauses)
+	{
+		partition_prune_clause(key, pdesc, varno, (Node *) lfirst(lc), sub);
+		for (i = 0; i < nparts; i++)
+			keep[i] = keep[i] && sub[i];
+	}
+
+	oids = (Oid *) palloc(nparts * sizeof(Oid));
+	for (i = 0; i < nparts; i++)
+	{
+		if (keep[i])
+			oids[noids++] = pdesc->oids[i];
+	}
+	qsort(oids, noids, sizeof(Oid), oid_cmp);
+	for (i = 0; i < noids; i++)
+		result = lappend_oid(result, oids[i]);
+
+	pfree(keep);
+	pfree(sub);
+	pfree(oids);
+
+	return result;
+}
+
+/*
+ * partition_prune_clause
+ *		Set keep[i] for each partition that may contain rows satisfying
+ *		clause.
+ */
+static void
+partition_prune_clause(PartitionKey key, PartitionDesc pdesc,
+					   Index varno, Node *clause, bool *keep)
+{
+	int			nparts = pdesc->nparts;
+
+	if (clause && IsA(clause, RestrictInfo))
+		clause = (Node *) ((RestrictInfo *) clause)->clause;
+
+	if (clause == NULL)
+	{
+		memset(keep, true, nparts * sizeof(bool));
+		return;
+	}
+
+	if (IsA(clause, Const))
+	{
+		Const	   *con = (Const *) clause;
+		bool		result = !con->constisnull && DatumGetBool(con->constvalue);
+
+		memset(keep, result, nparts * sizeof(bool));
+		return;
+	}
+
+	if (and_clause(clause) || or_clause(clause))
+	{
+		bool		is_and = and_clause(clause);
+		bool	   *sub = (bool *) palloc(nparts * sizeof(bool));
+		ListCell   *lc;
+		int			i;
+
+		memset(keep, is_and, nparts * sizeof(bool));
+		foreach(lc, ((BoolExpr *) clause)->args)
+		{
+			partition_prune_clause(key, pdesc, varno, (Node *) lfirst(lc), sub);
+			for (i = 0; i < nparts; i++)
+				keep[i] = is_and ? (keep[i] && sub[i]) : (keep[i] || sub[i]);
+		}
+		pfree(sub);
+		return;
+	}
+
+	if (IsA(clause, OpExpr) &&
+		list_length(((OpExpr *) clause)->args) == 2)
+	{
+		OpExpr	   *opexpr = (OpExpr *) clause;
+		Node	   *leftop = (Node *) linitial(opexpr->args);
+		Node	   *rightop = (Node *) lsecond(opexpr->args);
+
+		if (partition_match_key(key, varno, leftop) && IsA(rightop, Const))
+		{
+			Const	   *con = (Const *) rightop;
+
+			if (partition_prune_value(key, pdesc,
+									  opexpr->opno, opexpr->inputcollid,
+									  true, con->consttype, con->constvalue,
+									  con->constisnull, keep))
+				return;
+		}
+		else if (partition_match_key(key, varno, rightop) && IsA(leftop, Const))
+		{
+			Const	   *con = (Const *) leftop;
+
+			if (partition_prune_value(key, pdesc,
+									  opexpr->opno, opexpr->inputcollid,
+									  false, con->consttype, con->constvalue,
+									  con->constisnull, keep))
+				return;
+		}
+	}
+	else if (IsA(clause, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) clause;
+		Node	   *leftop = (Node *) linitial(saop->args);
+		Node	   *rightop = (Node *) lsecond(saop->args);
+
+		if (partition_match_key(key, varno, leftop) && IsA(rightop, Const))
+		{
+			Const	   *arrayconst = (Const *) rightop;
+			ArrayType  *arrayval;
+			Oid			elemtype;
+			int16		elemlen;
+			bool		elembyval;
+			char		elemalign;
+			Datum	   *elems;
+			bool	   *elemnulls;
+			int			nelems;
+			bool	   *sub;
+			bool		usable = true;
+			int			i,
+						j;
+
+			if (arrayconst->constisnull)
+			{
+				memset(keep, false, nparts * sizeof(bool));
+				return;
+			}
+
+			arrayval = DatumGetArrayTypeP(arrayconst->constvalue);
+			elemtype = ARR_ELEMTYPE(arrayval);
+			get_typlenbyvalalign(elemtype, &elemlen, &elembyval, &elemalign);
+			deconstruct_array(arrayval, elemtype, elemlen, elembyval, elemalign,
+							  &elems, &elemnulls, &nelems);
+
+			sub = (bool *) palloc(nparts * sizeof(bool));
+			memset(keep, !saop->useOr, nparts * sizeof(bool));
+			for (j = 0; j < nelems && usable; j++)
+			{
+				usable = partition_prune_value(key, pdesc, saop->opno,
+											   saop->inputcollid, true,
+											   elemtype, elems[j],
+											   elemnulls[j], sub);
+				for (i = 0; i < nparts; i++)
+					keep[i] = saop->useOr ? (keep[i] || sub[i]) :
+						(keep[i] && sub[i]);
+			}
+			pfree(sub);
+
+			if (usable)
+				return;
+		}
+	}
+	else if (IsA(clause, NullTest))
+	{
+		NullTest   *nulltest = (NullTest *) clause;
+
+		if (nulltest->nulltesttype == IS_NULL && !nulltest->argisrow &&
+			partition_match_key(key, varno, (Node *) nulltest->arg))
+		{
+			memset(keep, false, nparts * sizeof(bool));
+			if (pdesc->null_index >= 0)
+				keep[pdesc->null_index] = true;
+			return;
+		}
+	}
+
+	/* Not something we can use; every partition has to be scanned */
+	memset(keep, true, nparts * sizeof(bool));
+}
+
+/*
+ * partition_match_key
+ *		Is node a reference to the partition key column of varno?
+ */
+static bool
+partition_match_key(PartitionKey key, Index varno, Node *node)
+{
+	while (node && IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+
+	return (node && IsA(node, Var) &&
+			((Var *) node)->varno == varno &&
+			((Var *) node)->varattno == key->partattr &&
+			((Var *) node)->varlevelsup == 0);
+}
+
+/*
+ * partition_prune_value
+ *		Set keep[i] for each partition that may contain a key value
+ *		satisfying "key opno value" (or "value opno key" if !varonleft).
+ *
+ * Returns false, leaving keep undefined, if the operator isn't one that
+ * the partition bounds are ordered by.
+ */
+static bool
+partition_prune_value(PartitionKey key, PartitionDesc pdesc,
+					  Oid opno, Oid inputcollid,
+					  bool varonleft, Oid valtype, Datum value,
+					  bool isnull, bool *keep)
+{
+	Oid			opfamily = key->partopfamily;
+	Oid			opcintype = key->partopcintype;
+	Oid			collation = key->partcollation;
+	int			strategy;
+	Oid			lefttype;
+	Oid			righttype;
+	FmgrInfo	crossfn;
+	FmgrInfo   *cmpfn;
+	int			lo,
+				hi,
+				i;
+
+	if (OidIsValid(collation) && inputcollid != collation)
+		return false;
+	if (!op_in_opfamily(opno, opfamily) || !op_strict(opno))
+		return false;
+
+	get_op_opfamily_properties(opno, opfamily, false,
+							   &strategy, &lefttype, &righttype);
+	if (!varonleft)
+	{
+		Oid			tmp = lefttype;
+
+		lefttype = righttype;
+		righttype = tmp;
+		strategy = BTCommuteStrategyNumber(strategy);
+	}
+	if (lefttype != opcintype)
+		return false;
+
+	/* A strict operator can't be satisfied by a null value */
+	if (isnull)
+	{
+		memset(keep, false, pdesc->nparts * sizeof(bool));
+		return true;
+	}
+
+	/*
+	 * Comparing a bound with a value of another type takes the family's
+	 * cross-type comparison function.
+	 */
+	cmpfn = NULL;
+	if (righttype != opcintype)
+	{
+		Oid			procid;
+
+		procid = get_opfamily_proc(opfamily, opcintype, righttype,
+								   BTORDER_PROC);
+		if (!OidIsValid(procid))
+			return false;
+		fmgr_info(procid, &crossfn);
+		cmpfn = &crossfn;
+	}
+
+	if (cmpfn == NULL)
+		cmpfn = &key->partsupfunc;
+
+	memset(keep, false, pdesc->nparts * sizeof(bool));
+
+	if (key->strategy == PARTITION_STRATEGY_RANGE)
+	{
+		switch (strategy)
+		{
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				/* partitions starting below (or at) value */
+				lo = 0;
+				hi = partition_bound_bsearch(cmpfn, collation,
+											 pdesc->lower, pdesc->lower_inf,
+											 true, pdesc->nparts, value,
+										 strategy == BTLessEqualStrategyNumber);
+				break;
+			case BTGreaterStrategyNumber:
+			case BTGreaterEqualStrategyNumber:
+				/* partitions ending above value (upper bounds are exclusive) */
+				lo = partition_bound_bsearch(cmpfn, collation,
+											 pdesc->upper, pdesc->upper_inf,
+											 false, pdesc->nparts, value,
+											 true);
+				hi = pdesc->nparts;
+				break;
+			case BTEqualStrategyNumber:
+				i = partition_index_for_value(key, pdesc, cmpfn, value);
+				if (i >= 0)
+					keep[i] = true;
+				return true;
+			default:
+				elog(ERROR, "unrecognized StrategyNumber: %d", strategy);
+				lo = hi = 0;	/* keep compiler quiet */
+				break;
+		}
+
+		for (i = lo; i < hi; i++)
+			keep[i] = true;
+	}
+	else
+	{
+		switch (strategy)
+		{
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				lo = 0;
+				hi = partition_bound_bsearch(cmpfn, collation,
+											 pdesc->datums, NULL, false,
+											 pdesc->ndatums, value,
+										 strategy == BTLessEqualStrategyNumber);
+				break;
+			case BTGreaterStrategyNumber:
+			case BTGreaterEqualStrategyNumber:
+				lo = partition_bound_bsearch(cmpfn, collation,
+											 pdesc->datums, NULL, false,
+											 pdesc->ndatums, value,
+										  strategy == BTGreaterStrategyNumber);
+				hi = pdesc->ndatums;
+				break;
+			case BTEqualStrategyNumber:
+				lo = partition_bound_bsearch(cmpfn, collation,
+											 pdesc->datums, NULL, false,
+											 pdesc->ndatums, value, false);
+				hi = partition_bound_bsearch(cmpfn, collation,
+											 pdesc->datums, NULL, false,
+											 pdesc->ndatums, value, true);
+				break;
+			default:
+				elog(ERROR, "unrecognized StrategyNumber: %d", strategy);
+				lo = hi = 0;	/* keep compiler quiet */
+				break;
+		}
+
+		for (i = lo; i < hi; i++)
+			keep[pdesc->indexes[i]] = true;
+	}
+
+	return true;
+}
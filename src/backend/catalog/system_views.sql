@@ -626,7 +626,9 @@ CREATE VIEW pg_replication_slots AS
             L.active,
             L.xmin,
             L.catalog_xmin,
-            L.restart_lsn
+            L.restart_lsn,
+            L.snapshot_state,
+            L.snapshot_pending_xacts
     FROM pg_get_replication_slots() AS L
             LEFT JOIN pg_database D ON (L.datoid = D.oid);
 
@@ -700,6 +702,29 @@ CREATE VIEW pg_stat_archiver AS
         s.stats_reset
     FROM pg_stat_get_archiver() s;
 
+CREATE VIEW pg_stat_prefetch_recovery AS
+    SELECT
+        s.prefetch,
+        s.skip_hit,
+        s.skip_new,
+        s.skip_fpw,
+        s.skip_seq,
+        s.distance
+    FROM pg_stat_get_prefetch_recovery() s;
+
+CREATE VIEW pg_stat_wal_flush_batches AS
+    SELECT
+        s.min_batch_size,
+        s.max_batch_size,
+        s.flushes
+    FROM pg_stat_get_wal_flush_batches() s;
+
+CREATE VIEW pg_stat_snapshot_cache AS
+    SELECT
+        s.hits,
+        s.misses
+    FROM pg_stat_get_snapshot_cache() s;
+
 CREATE VIEW pg_stat_bgwriter AS
     SELECT
         pg_stat_get_bgwriter_timed_checkpoints() AS checkpoints_timed,
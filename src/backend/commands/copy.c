@@ -25,6 +25,7 @@
 #include "access/sysattr.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
+#include "catalog/partition.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
@@ -2049,9 +2050,15 @@ CopyFrom(CopyState cstate)
 	Datum	   *values;
 	bool	   *nulls;
 	ResultRelInfo *resultRelInfo;
+	ResultRelInfo *targetRelInfo;
+	ResultRelInfo *lastRelInfo;
+	ResultRelInfo *bufferedRelInfo = NULL;
+	PartitionRoutingState *routing;
+	bool		partitioned;
 	EState	   *estate = CreateExecutorState(); /* for ExecConstraints() */
 	ExprContext *econtext;
 	TupleTableSlot *myslot;
+	TupleTableSlot *batchslot;
 	MemoryContext oldcontext = CurrentMemoryContext;
 
 	ErrorContextCallback errcallback;
@@ -2061,6 +2068,7 @@ CopyFrom(CopyState cstate)
 	uint64		processed = 0;
 	bool		useHeapMultiInsert;
 	int			nBufferedTuples = 0;
+	ListCell   *lc;
 
 #define MAX_BUFFERED_TUPLES 1000
 	HeapTuple  *bufferedTuples = NULL;	/* initialize to silence warning */
@@ -2100,6 +2108,17 @@ CopyFrom(CopyState cstate)
 
 	tupDesc = RelationGetDescr(cstate->rel);
 
+	/*
+	 * The rows of a partitioned table go into its partitions, none of which
+	 * need have been created or truncated in this transaction, so neither
+	 * the WAL-skipping optimization below nor FREEZE applies.
+	 */
+	partitioned = (RelationGetPartitionKey(cstate->rel) != NULL);
+	if (partitioned && cstate->freeze)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot perform FREEZE on a partitioned table")));
+
 	/*----------
 	 * Check to see if we can avoid writing WAL
 	 *
@@ -2136,8 +2155,9 @@ CopyFrom(CopyState cstate)
 	 *----------
 	 */
 	/* createSubid is creation check, newRelfilenodeSubid is truncation check */
-	if (cstate->rel->rd_createSubid != InvalidSubTransactionId ||
-		cstate->rel->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+	if (!partitioned &&
+		(cstate->rel->rd_createSubid != InvalidSubTransactionId ||
+		 cstate->rel->rd_newRelfilenodeSubid != InvalidSubTransactionId))
 	{
 		hi_options |= HEAP_INSERT_SKIP_FSM;
 		if (!XLogIsNeeded())
@@ -2191,6 +2211,16 @@ CopyFrom(CopyState cstate)
 	/* Triggers might need a slot as well */
 	estate->es_trig_tuple_slot = ExecInitExtraTupleSlot(estate);
 
+	/* Set up for routing the rows of a partitioned table to its partitions */
+	routing = NULL;
+	batchslot = myslot;
+	if (partitioned)
+	{
+		routing = ExecSetupPartitionRouting(estate, resultRelInfo);
+		/* partitions' rows may not match the parent's descriptor */
+		batchslot = ExecInitExtraTupleSlot(estate);
+	}
+
 	/*
 	 * It's more efficient to prepare a bunch of tuples for insertion, and
 	 * insert them in one heap_multi_insert() call, than call heap_insert()
@@ -2199,6 +2229,11 @@ CopyFrom(CopyState cstate)
 	 * expressions. Such triggers or expressions might query the table we're
 	 * inserting to, and act differently if the tuples that have already been
 	 * processed and prepared for insertion are not there.
+	 *
+	 * For a partitioned table, the buffer holds rows for one partition at a
+	 * time, and is flushed whenever a row is routed to a different one.
+	 * Rows for a partition with BEFORE ROW triggers are inserted one at a
+	 * time, which is decided per row below.
 	 */
 	if ((resultRelInfo->ri_TrigDesc != NULL &&
 		 (resultRelInfo->ri_TrigDesc->trig_insert_before_row ||
@@ -2228,6 +2263,7 @@ CopyFrom(CopyState cstate)
 	nulls = (bool *) palloc(tupDesc->natts * sizeof(bool));
 
 	bistate = GetBulkInsertState();
+	lastRelInfo = resultRelInfo;
 	econtext = GetPerTupleExprContext(estate);
 
 	/* Set up callback to identify error line number */
@@ -2279,13 +2315,44 @@ CopyFrom(CopyState cstate)
 		slot = myslot;
 		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
 
+		/* Route the tuple to its partition, if the table is partitioned */
+		targetRelInfo = resultRelInfo;
+		if (routing != NULL)
+		{
+			targetRelInfo = ExecFindPartition(routing, &slot, estate);
+
+			/*
+			 * Moving to another partition: the buffered rows must reach their
+			 * own partition first, and the bulk insert state's pinned buffer
+			 * belongs to the old one.
+			 */
+			if (targetRelInfo != lastRelInfo)
+			{
+				if (nBufferedTuples > 0)
+				{
+					CopyFromInsertBatch(cstate, estate, mycid, hi_options,
+										bufferedRelInfo, batchslot, bistate,
+										nBufferedTuples, bufferedTuples,
+										firstBufferedLineNo);
+					nBufferedTuples = 0;
+					bufferedTuplesSize = 0;
+				}
+				ReleaseBulkInsertStatePin(bistate);
+				lastRelInfo = targetRelInfo;
+			}
+
+			estate->es_result_relation_info = targetRelInfo;
+			tuple = ExecMaterializeSlot(slot);
+			tuple->t_tableOid = RelationGetRelid(targetRelInfo->ri_RelationDesc);
+		}
+
 		skip_tuple = false;
 
 		/* BEFORE ROW INSERT Triggers */
-		if (resultRelInfo->ri_TrigDesc &&
-			resultRelInfo->ri_TrigDesc->trig_insert_before_row)
+		if (targetRelInfo->ri_TrigDesc &&
+			targetRelInfo->ri_TrigDesc->trig_insert_before_row)
 		{
-			slot = ExecBRInsertTriggers(estate, resultRelInfo, slot);
+			slot = ExecBRInsertTriggers(estate, targetRelInfo, slot);
 
 			if (slot == NULL)	/* "do nothing" */
 				skip_tuple = true;
@@ -2296,14 +2363,32 @@ CopyFrom(CopyState cstate)
 		if (!skip_tuple)
 		{
 			/* Check the constraints of the tuple */
-			if (cstate->rel->rd_att->constr)
-				ExecConstraints(resultRelInfo, slot, estate);
+			if (targetRelInfo->ri_RelationDesc->rd_att->constr)
+				ExecConstraints(targetRelInfo, slot, estate);
 
-			if (useHeapMultiInsert)
+			if (useHeapMultiInsert &&
+				!(targetRelInfo->ri_TrigDesc != NULL &&
+				  (targetRelInfo->ri_TrigDesc->trig_insert_before_row ||
+				   targetRelInfo->ri_TrigDesc->trig_insert_instead_row)))
 			{
+				/*
+				 * A converted tuple belongs to the routing slot, which frees
+				 * it when the next row is stored; keep a copy alongside the
+				 * other buffered tuples.
+				 */
+				if (slot != myslot)
+				{
+					MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+					tuple = heap_copytuple(tuple);
+					MemoryContextSwitchTo(oldcontext);
+				}
+
 				/* Add this tuple to the tuple buffer */
 				if (nBufferedTuples == 0)
+				{
 					firstBufferedLineNo = cstate->cur_lineno;
+					bufferedRelInfo = targetRelInfo;
+				}
 				bufferedTuples[nBufferedTuples++] = tuple;
 				bufferedTuplesSize += tuple->t_len;
 
@@ -2317,7 +2402,7 @@ CopyFrom(CopyState cstate)
 					bufferedTuplesSize > 65535)
 				{
 					CopyFromInsertBatch(cstate, estate, mycid, hi_options,
-										resultRelInfo, myslot, bistate,
+										bufferedRelInfo, batchslot, bistate,
 										nBufferedTuples, bufferedTuples,
 										firstBufferedLineNo);
 					nBufferedTuples = 0;
@@ -2329,14 +2414,15 @@ CopyFrom(CopyState cstate)
 				List	   *recheckIndexes = NIL;
 
 				/* OK, store the tuple and create index entries for it */
-				heap_insert(cstate->rel, tuple, mycid, hi_options, bistate);
+				heap_insert(targetRelInfo->ri_RelationDesc, tuple, mycid,
+							hi_options, bistate);
 
-				if (resultRelInfo->ri_NumIndices > 0)
+				if (targetRelInfo->ri_NumIndices > 0)
 					recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
 														   estate);
 
 				/* AFTER ROW INSERT Triggers */
-				ExecARInsertTriggers(estate, resultRelInfo, tuple,
+				ExecARInsertTriggers(estate, targetRelInfo, tuple,
 									 recheckIndexes);
 
 				list_free(recheckIndexes);
@@ -2354,7 +2440,7 @@ CopyFrom(CopyState cstate)
 	/* Flush any remaining buffered tuples */
 	if (nBufferedTuples > 0)
 		CopyFromInsertBatch(cstate, estate, mycid, hi_options,
-							resultRelInfo, myslot, bistate,
+							bufferedRelInfo, batchslot, bistate,
 							nBufferedTuples, bufferedTuples,
 							firstBufferedLineNo);
 
@@ -2365,6 +2451,8 @@ CopyFrom(CopyState cstate)
 
 	MemoryContextSwitchTo(oldcontext);
 
+	estate->es_result_relation_info = resultRelInfo;
+
 	/* Execute AFTER STATEMENT insertion triggers */
 	ExecASInsertTriggers(estate, resultRelInfo);
 
@@ -2378,6 +2466,15 @@ CopyFrom(CopyState cstate)
 
 	ExecCloseIndices(resultRelInfo);
 
+	/* Close the partitions, and any other trigger target relations */
+	foreach(lc, estate->es_trig_target_relations)
+	{
+		ResultRelInfo *rInfo = (ResultRelInfo *) lfirst(lc);
+
+		ExecCloseIndices(rInfo);
+		heap_close(rInfo->ri_RelationDesc, NoLock);
+	}
+
 	FreeExecutorState(estate);
 
 	/*
@@ -2394,6 +2491,9 @@ CopyFrom(CopyState cstate)
  * A subroutine of CopyFrom, to write the current batch of buffered heap
  * tuples to the heap. Also updates indexes and runs AFTER ROW INSERT
  * triggers.
+ *
+ * resultRelInfo is the relation the batch was buffered for, which is a
+ * partition when copying into a partitioned table.
  */
 static void
 CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
@@ -2402,6 +2502,8 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
 					int firstBufferedLineNo)
 {
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	ResultRelInfo *saveRelInfo = estate->es_result_relation_info;
 	MemoryContext oldcontext;
 	int			i;
 	int			save_cur_lineno;
@@ -2418,7 +2520,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	 * before calling it.
 	 */
 	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	heap_multi_insert(cstate->rel,
+	heap_multi_insert(rel,
 					  bufferedTuples,
 					  nBufferedTuples,
 					  mycid,
@@ -2432,6 +2534,11 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	 */
 	if (resultRelInfo->ri_NumIndices > 0)
 	{
+		/* index insertion looks at the current result relation */
+		estate->es_result_relation_info = resultRelInfo;
+		if (myslot->tts_tupleDescriptor != RelationGetDescr(rel))
+			ExecSetSlotDescriptor(myslot, RelationGetDescr(rel));
+
 		for (i = 0; i < nBufferedTuples; i++)
 		{
 			List	   *recheckIndexes;
@@ -2466,6 +2573,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 
 	/* reset cur_lineno to where we were */
 	cstate->cur_lineno = save_cur_lineno;
+	estate->es_result_relation_info = saveRelInfo;
 }
 
 /*
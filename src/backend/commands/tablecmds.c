@@ -29,6 +29,8 @@
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/partition.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_depend.h"
@@ -263,13 +265,19 @@ struct DropRelationCallbackState
 
 static void truncate_check_rel(Relation rel);
 static List *MergeAttributes(List *schema, List *supers, char relpersistence,
-				List **supOids, List **supconstr, int *supOidCount);
+				bool is_partition, List **supOids, List **supconstr,
+				int *supOidCount);
 static bool MergeCheckConstraint(List *constraints, char *name, Node *expr);
 static void MergeAttributesIntoExisting(Relation child_rel, Relation parent_rel);
 static void MergeConstraintsIntoExisting(Relation child_rel, Relation parent_rel);
-static void StoreCatalogInheritance(Oid relationId, List *supers);
+static void StoreCatalogInheritance(Oid relationId, List *supers,
+						PartitionBoundSpec *bound);
 static void StoreCatalogInheritance1(Oid relationId, Oid parentOid,
-						 int16 seqNumber, Relation inhRelation);
+						 int16 seqNumber, PartitionBoundSpec *bound,
+						 Relation inhRelation);
+static void ComputePartitionKey(Relation rel, PartitionSpec *partspec);
+static void StorePartitionConstraint(Relation rel, Relation parent,
+						 PartitionBoundSpec *bound);
 static int	findAttrByName(const char *attributeName, List *schema);
 static void AlterIndexNamespaces(Relation classRel, Relation rel,
 				   Oid oldNspOid, Oid newNspOid, ObjectAddresses *objsMoved);
@@ -396,7 +404,8 @@ static void ATExecEnableDisableTrigger(Relation rel, char *trigname,
 static void ATExecEnableDisableRule(Relation rel, char *rulename,
 						char fires_when, LOCKMODE lockmode);
 static void ATPrepAddInherit(Relation child_rel);
-static void ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode);
+static void ATExecAddInherit(Relation child_rel, RangeVar *parent,
+				 PartitionBoundSpec *bound, LOCKMODE lockmode);
 static void ATExecDropInherit(Relation rel, RangeVar *parent, LOCKMODE lockmode);
 static void drop_parent_dependency(Oid relid, Oid refclassid, Oid refobjid);
 static void ATExecAddOf(Relation rel, const TypeName *ofTypename, LOCKMODE lockmode);
@@ -452,6 +461,8 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 	AttrNumber	attnum;
 	static char *validnsps[] = HEAP_RELOPT_NAMESPACES;
 	Oid			ofTypeId;
+	Relation	parent = NULL;
+	PartitionBoundSpec *bound = NULL;
 
 	/*
 	 * Truncate relname to appropriate length (probably a waste of time, as
@@ -471,6 +482,10 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 		ereport(ERROR,
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 				 errmsg("constraints are not supported on foreign tables")));
+	if (stmt->partspec != NULL && stmt->inhRelations != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot create partitioned table as inheritance child")));
 
 	/*
 	 * Look up the namespace in which we are supposed to create the relation,
@@ -555,8 +570,23 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 	 */
 	schema = MergeAttributes(schema, stmt->inhRelations,
 							 stmt->relation->relpersistence,
+							 stmt->partbound != NULL,
 							 &inheritOids, &old_constraints, &parentOidCount);
 
+	/*
+	 * For a partition, check that its bound fits in with those of the
+	 * parent's existing partitions.  MergeAttributes has locked the parent
+	 * exclusively, so they can't change under us.
+	 */
+	if (stmt->partbound)
+	{
+		Assert(list_length(inheritOids) == 1);
+		parent = heap_open(linitial_oid(inheritOids), NoLock);
+
+		bound = transformPartitionBound(parent, stmt->partbound);
+		check_new_partition_bound(relname, parent, bound);
+	}
+
 	/*
 	 * Create a tuple descriptor from the relation schema.	Note that this
 	 * deals with column names, types, and NOT NULL constraints, but not
@@ -649,7 +679,7 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 										  false);
 
 	/* Store inheritance information for new rel. */
-	StoreCatalogInheritance(relationId, inheritOids);
+	StoreCatalogInheritance(relationId, inheritOids, bound);
 
 	/*
 	 * We must bump the command counter to make the newly-created relation
@@ -678,6 +708,27 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId)
 		AddRelationNewConstraints(rel, rawDefaults, stmt->constraints,
 								  true, true, false);
 
+	/*
+	 * A partition gets a CHECK constraint matching its bound, and the parent
+	 * must forget its cached list of partitions.
+	 */
+	if (parent)
+	{
+		StorePartitionConstraint(rel, parent, bound);
+		CacheInvalidateRelcache(parent);
+		heap_close(parent, NoLock);
+	}
+
+	/* Store the partition key, if any */
+	if (stmt->partspec)
+	{
+		if (relkind != RELKIND_RELATION)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("only tables can be partitioned")));
+		ComputePartitionKey(rel, stmt->partspec);
+	}
+
 	/*
 	 * Clean up.  We keep lock on new relation (although it shouldn't be
 	 * visible to anyone else anyway, until commit).
@@ -902,9 +953,9 @@ RangeVarCallbackForDropRelation(const RangeVar *rel, Oid relOid, Oid oldRelOid,
 		ShareUpdateExclusiveLock : AccessExclusiveLock;
 
 	/*
-	 * If we previously locked some other index's heap, and the name we're
-	 * looking up no longer refers to that relation, release the now-useless
-	 * lock.
+	 * If we previously locked some other index's heap (or partition's
+	 * parent), and the name we're looking up no longer refers to that
+	 * relation, release the now-useless lock.
 	 */
 	if (relOid != oldRelOid && OidIsValid(state->heapOid))
 	{
@@ -951,6 +1002,17 @@ RangeVarCallbackForDropRelation(const RangeVar *rel, Oid relOid, Oid oldRelOid,
 		if (OidIsValid(state->heapOid))
 			LockRelationOid(state->heapOid, heap_lockmode);
 	}
+
+	/*
+	 * Similarly, in DROP TABLE of a partition, lock the partitioned table
+	 * first: removing a partition changes the bounds cached for it.
+	 */
+	if (relkind == RELKIND_RELATION && relOid != oldRelOid)
+	{
+		state->heapOid = get_partition_parent(relOid);
+		if (OidIsValid(state->heapOid))
+			LockRelationOid(state->heapOid, heap_lockmode);
+	}
 }
 
 /*
@@ -1372,7 +1434,8 @@ storage_name(char c)
  */
 static List *
 MergeAttributes(List *schema, List *supers, char relpersistence,
-				List **supOids, List **supconstr, int *supOidCount)
+				bool is_partition, List **supOids, List **supconstr,
+				int *supOidCount)
 {
 	ListCell   *entry;
 	List	   *inhSchema = NIL;
@@ -1480,14 +1543,41 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 		 * on the parent table, which might otherwise be attempting to clear
 		 * the parent's relhassubclass field, if its previous children were
 		 * recently dropped.
+		 *
+		 * Adding a partition changes the partition bounds cached for the
+		 * parent, which queries rely on while they hold any lock on it, so
+		 * that takes AccessExclusiveLock instead.
 		 */
-		relation = heap_openrv(parent, ShareUpdateExclusiveLock);
+		relation = heap_openrv(parent, is_partition ?
+							   AccessExclusiveLock : ShareUpdateExclusiveLock);
 
 		if (relation->rd_rel->relkind != RELKIND_RELATION)
 			ereport(ERROR,
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 					 errmsg("inherited relation \"%s\" is not a table",
 							parent->relname)));
+		if (is_partition && RelationGetPartitionKey(relation) == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("\"%s\" is not partitioned",
+							parent->relname)));
+		if (!is_partition && RelationGetPartitionKey(relation) != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot inherit from partitioned table \"%s\"",
+							parent->relname)));
+		if (OidIsValid(get_partition_parent(RelationGetRelid(relation))))
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot inherit from partition \"%s\"",
+							parent->relname)));
+		/* Partitions of a permanent table must be permanent too */
+		if (is_partition && relpersistence == RELPERSISTENCE_TEMP &&
+			relation->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot create a temporary partition of permanent relation \"%s\"",
+							parent->relname)));
 		/* Permanent rels cannot inherit from temporary ones */
 		if (relpersistence != RELPERSISTENCE_TEMP &&
 			relation->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
@@ -1920,7 +2010,8 @@ MergeCheckConstraint(List *constraints, char *name, Node *expr)
  * supers is a list of the OIDs of the new relation's direct ancestors.
  */
 static void
-StoreCatalogInheritance(Oid relationId, List *supers)
+StoreCatalogInheritance(Oid relationId, List *supers,
+						PartitionBoundSpec *bound)
 {
 	Relation	relation;
 	int16		seqNumber;
@@ -1950,7 +2041,8 @@ StoreCatalogInheritance(Oid relationId, List *supers)
 	{
 		Oid			parentOid = lfirst_oid(entry);
 
-		StoreCatalogInheritance1(relationId, parentOid, seqNumber, relation);
+		StoreCatalogInheritance1(relationId, parentOid, seqNumber, bound,
+								 relation);
 		seqNumber++;
 	}
 
@@ -1960,10 +2052,13 @@ StoreCatalogInheritance(Oid relationId, List *supers)
 /*
  * Make catalog entries showing relationId as being an inheritance child
  * of parentOid.  inhRelation is the already-opened pg_inherits catalog.
+ * bound is the partition bound if relationId is a partition of parentOid,
+ * else NULL.
  */
 static void
 StoreCatalogInheritance1(Oid relationId, Oid parentOid,
-						 int16 seqNumber, Relation inhRelation)
+						 int16 seqNumber, PartitionBoundSpec *bound,
+						 Relation inhRelation)
 {
 	TupleDesc	desc = RelationGetDescr(inhRelation);
 	Datum		values[Natts_pg_inherits];
@@ -1981,6 +2076,12 @@ StoreCatalogInheritance1(Oid relationId, Oid parentOid,
 
 	memset(nulls, 0, sizeof(nulls));
 
+	if (bound)
+		values[Anum_pg_inherits_inhpartbound - 1] =
+			CStringGetTextDatum(nodeToString(bound));
+	else
+		nulls[Anum_pg_inherits_inhpartbound - 1] = true;
+
 	tuple = heap_form_tuple(desc, values, nulls);
 
 	simple_heap_insert(inhRelation, tuple);
@@ -1999,7 +2100,9 @@ StoreCatalogInheritance1(Oid relationId, Oid parentOid,
 	childobject.objectId = relationId;
 	childobject.objectSubId = 0;
 
-	recordDependencyOn(&childobject, &parentobject, DEPENDENCY_NORMAL);
+	/* Partitions go away with their parent */
+	recordDependencyOn(&childobject, &parentobject,
+					   bound ? DEPENDENCY_AUTO : DEPENDENCY_NORMAL);
 
 	/*
 	 * Post creation hook of this inheritance. Since object_access_hook
@@ -2016,6 +2119,113 @@ StoreCatalogInheritance1(Oid relationId, Oid parentOid,
 	SetRelationHasSubclass(parentOid, true);
 }
 
+/*
+ * ComputePartitionKey
+ *		Resolve the PARTITION BY clause of a new table and record the key
+ *		in pg_partitioned_table.
+ */
+static void
+ComputePartitionKey(Relation rel, PartitionSpec *partspec)
+{
+	PartitionElem *pelem = partspec->partParam;
+	char		strategy;
+	HeapTuple	atttuple;
+	Form_pg_attribute attform;
+	AttrNumber	partattr;
+	Oid			atttype;
+	Oid			partcollation;
+	Oid			partopclass;
+
+	if (strcmp(partspec->strategy, "list") == 0)
+		strategy = PARTITION_STRATEGY_LIST;
+	else if (strcmp(partspec->strategy, "range") == 0)
+		strategy = PARTITION_STRATEGY_RANGE;
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized partitioning strategy \"%s\"",
+						partspec->strategy)));
+
+	atttuple = SearchSysCacheAttName(RelationGetRelid(rel), pelem->name);
+	if (!HeapTupleIsValid(atttuple))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" named in partition key does not exist",
+						pelem->name)));
+	attform = (Form_pg_attribute) GETSTRUCT(atttuple);
+
+	if (attform->attnum <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot use system column \"%s\" in partition key",
+						pelem->name)));
+
+	partattr = attform->attnum;
+	atttype = attform->atttypid;
+	partcollation = attform->attcollation;
+	ReleaseSysCache(atttuple);
+
+	if (pelem->collation)
+	{
+		partcollation = get_collation_oid(pelem->collation, false);
+		if (!type_is_collatable(atttype))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("collations are not supported by type %s",
+							format_type_be(atttype))));
+	}
+
+	/* The bounds are ordered by the btree operator class of the key */
+	partopclass = GetIndexOpClass(pelem->opclass, atttype,
+								  "btree", BTREE_AM_OID);
+
+	StorePartitionKey(rel, strategy, partattr, partopclass, partcollation);
+}
+
+/*
+ * StorePartitionConstraint
+ *		Add the CHECK constraint implied by a new partition's bound.
+ *
+ * Besides rejecting rows inserted directly into the partition that don't
+ * belong there, this lets constraint exclusion treat the partition like
+ * any other inheritance child.
+ *
+ * The constraint is stored as inherited rather than local, so that it
+ * can't be dropped on its own, and so that pg_dump leaves it to be
+ * recreated along with the partition.
+ */
+static void
+StorePartitionConstraint(Relation rel, Relation parent,
+						 PartitionBoundSpec *bound)
+{
+	AttrNumber	parentattno = RelationGetPartitionKey(parent)->partattr;
+	AttrNumber	childattno;
+	Constraint *constr;
+
+	/* The key column may be at a different position in the partition */
+	childattno = get_attnum(RelationGetRelid(rel),
+							get_attname(RelationGetRelid(parent), parentattno));
+	Assert(childattno != InvalidAttrNumber);
+
+	constr = makeNode(Constraint);
+	constr->contype = CONSTR_CHECK;
+	constr->conname = ChooseConstraintName(RelationGetRelationName(rel),
+										   NULL,
+										   "partition_check",
+										   RelationGetNamespace(rel),
+										   NIL);
+	constr->location = -1;
+	constr->is_no_inherit = true;
+	constr->raw_expr = NULL;
+	constr->cooked_expr =
+		nodeToString(get_qual_for_partition_bound(parent, childattno, bound));
+	constr->skip_validation = false;
+	constr->initially_valid = true;
+
+	AddRelationNewConstraints(rel, NIL, list_make1(constr),
+							  false, false, true);
+}
+
 /*
  * Look for an existing schema entry with the given name.
  *
@@ -3508,7 +3718,11 @@ ATExecCmd(List **wqueue, AlteredTableInfo *tab, Relation rel,
 			break;
 
 		case AT_AddInherit:
-			ATExecAddInherit(rel, (RangeVar *) cmd->def, lockmode);
+			if (IsA(cmd->def, PartitionCmd))
+				ATExecAddInherit(rel, ((PartitionCmd *) cmd->def)->parent,
+								 ((PartitionCmd *) cmd->def)->bound, lockmode);
+			else
+				ATExecAddInherit(rel, (RangeVar *) cmd->def, NULL, lockmode);
 			break;
 		case AT_DropInherit:
 			ATExecDropInherit(rel, (RangeVar *) cmd->def, lockmode);
@@ -4460,6 +4674,18 @@ ATPrepAddColumn(List **wqueue, Relation rel, bool recurse, bool recursing,
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 				 errmsg("cannot add column to typed table")));
 
+	/* A partition has exactly its parent's columns */
+	if (!recursing && OidIsValid(get_partition_parent(RelationGetRelid(rel))))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot add column to a partition")));
+	if (!recurse && RelationGetPartitionKey(rel) != NULL &&
+		find_inheritance_children(RelationGetRelid(rel), NoLock) != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot add column to only the partitioned table when partitions exist"),
+				 errhint("Do not specify the ONLY keyword.")));
+
 	if (rel->rd_rel->relkind == RELKIND_COMPOSITE_TYPE)
 		ATTypedTableRecursion(wqueue, rel, cmd, lockmode);
 
@@ -5421,6 +5647,13 @@ ATExecDropColumn(List **wqueue, Relation rel, const char *colName,
 				 errmsg("cannot drop system column \"%s\"",
 						colName)));
 
+	/* Don't drop the partition key column */
+	if (RelationGetPartitionKey(rel) != NULL &&
+		RelationGetPartitionKey(rel)->partattr == attnum)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot drop column named in partition key")));
+
 	/* Don't drop inherited columns */
 	if (targetatt->attinhcount > 0 && !recursing)
 		ereport(ERROR,
@@ -5437,6 +5670,13 @@ ATExecDropColumn(List **wqueue, Relation rel, const char *colName,
 	 */
 	children = find_inheritance_children(RelationGetRelid(rel), lockmode);
 
+	/* Partitions must keep exactly the parent's columns */
+	if (children && !recurse && RelationGetPartitionKey(rel) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot drop column from only the partitioned table when partitions exist"),
+				 errhint("Do not specify the ONLY keyword.")));
+
 	if (children)
 	{
 		Relation	attr_rel;
@@ -7498,6 +7738,13 @@ ATPrepAlterColumnType(List **wqueue,
 				 errmsg("cannot alter inherited column \"%s\"",
 						colName)));
 
+	/* Don't alter the partition key column; its bounds are of its type */
+	if (RelationGetPartitionKey(rel) != NULL &&
+		RelationGetPartitionKey(rel)->partattr == attnum)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("cannot alter type of column named in partition key")));
+
 	/* Look up the target type */
 	typenameTypeIdAndMod(NULL, typeName, &targettype, &targettypmod);
 
@@ -9316,7 +9563,8 @@ ATPrepAddInherit(Relation child_rel)
 }
 
 static void
-ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
+ATExecAddInherit(Relation child_rel, RangeVar *parent,
+				 PartitionBoundSpec *bound, LOCKMODE lockmode)
 {
 	Relation	parent_rel,
 				catalogRelation;
@@ -9328,9 +9576,11 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 
 	/*
 	 * A self-exclusive lock is needed here.  See the similar case in
-	 * MergeAttributes() for a full explanation.
+	 * MergeAttributes() for a full explanation, and for why attaching a
+	 * partition takes AccessExclusiveLock instead.
 	 */
-	parent_rel = heap_openrv(parent, ShareUpdateExclusiveLock);
+	parent_rel = heap_openrv(parent, bound ?
+							 AccessExclusiveLock : ShareUpdateExclusiveLock);
 
 	/*
 	 * Must be owner of both parent and child -- child was checked by
@@ -9360,6 +9610,43 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 		 errmsg("cannot inherit to temporary relation of another session")));
 
+	/*
+	 * Partitions can only be added by CREATE TABLE ... PARTITION OF, except
+	 * that pg_upgrade must attach a partition it has created with the
+	 * original physical column layout.  Existing rows are not checked
+	 * against the bound, which is why that is all we allow.
+	 */
+	if (bound != NULL && !IsBinaryUpgrade)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot attach a partition with ALTER TABLE"),
+				 errhint("Use CREATE TABLE ... PARTITION OF instead.")));
+	if (bound != NULL && RelationGetPartitionKey(parent_rel) == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not partitioned",
+						RelationGetRelationName(parent_rel))));
+	if (bound == NULL && RelationGetPartitionKey(parent_rel) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot inherit from partitioned table \"%s\"",
+						RelationGetRelationName(parent_rel))));
+	if (OidIsValid(get_partition_parent(RelationGetRelid(parent_rel))))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot inherit from partition \"%s\"",
+						RelationGetRelationName(parent_rel))));
+	if (RelationGetPartitionKey(child_rel) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot change inheritance of partitioned table \"%s\"",
+						RelationGetRelationName(child_rel))));
+	if (OidIsValid(get_partition_parent(RelationGetRelid(child_rel))))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot change inheritance of partition \"%s\"",
+						RelationGetRelationName(child_rel))));
+
 	/*
 	 * Check for duplicates in the list of parents, and determine the highest
 	 * inhseqno already present; we'll use the next one for the new parent.
@@ -9392,6 +9679,12 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 	}
 	systable_endscan(scan);
 
+	if (bound != NULL && inhseqno > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot attach inheritance child \"%s\" as a partition",
+						RelationGetRelationName(child_rel))));
+
 	/*
 	 * Prevent circularity by seeing if proposed parent inherits from child.
 	 * (In particular, this disallows making a rel inherit from itself.)
@@ -9417,6 +9710,13 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 						   parent->relname,
 						   RelationGetRelationName(child_rel))));
 
+	/* A partition can't have children of its own */
+	if (bound != NULL && list_length(children) > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot attach inheritance parent \"%s\" as a partition",
+						RelationGetRelationName(child_rel))));
+
 	/* If parent has OIDs then child must have OIDs */
 	if (parent_rel->rd_rel->relhasoids && !child_rel->rd_rel->relhasoids)
 		ereport(ERROR,
@@ -9431,17 +9731,32 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 	/* Match up the constraints and bump coninhcount as needed */
 	MergeConstraintsIntoExisting(child_rel, parent_rel);
 
+	/* The bound must fit in with those of the existing partitions */
+	if (bound != NULL)
+	{
+		bound = transformPartitionBound(parent_rel, bound);
+		check_new_partition_bound(RelationGetRelationName(child_rel),
+								  parent_rel, bound);
+	}
+
 	/*
 	 * OK, it looks valid.	Make the catalog entries that show inheritance.
 	 */
 	StoreCatalogInheritance1(RelationGetRelid(child_rel),
 							 RelationGetRelid(parent_rel),
-							 inhseqno + 1,
+							 inhseqno + 1, bound,
 							 catalogRelation);
 
 	/* Now we're done with pg_inherits */
 	heap_close(catalogRelation, RowExclusiveLock);
 
+	/* As in DefineRelation, add the bound's constraint */
+	if (bound != NULL)
+	{
+		StorePartitionConstraint(child_rel, parent_rel, bound);
+		CacheInvalidateRelcache(parent_rel);
+	}
+
 	/* keep our lock on the parent relation until commit */
 	heap_close(parent_rel, NoLock);
 }
@@ -9725,6 +10040,12 @@ ATExecDropInherit(Relation rel, RangeVar *parent, LOCKMODE lockmode)
 	List	   *connames;
 	bool		found = false;
 
+	if (OidIsValid(get_partition_parent(RelationGetRelid(rel))))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot change inheritance of partition \"%s\"",
+						RelationGetRelationName(rel))));
+
 	/*
 	 * AccessShareLock on the parent is probably enough, seeing that DROP
 	 * TABLE doesn't lock parent tables at all.  We need some lock since we'll
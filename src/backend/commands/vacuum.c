@@ -108,6 +108,12 @@ vacuum(VacuumStmt *vacstmt, Oid relid, bool do_toast,
 		   !(vacstmt->options & (VACOPT_FULL | VACOPT_FREEZE)));
 	Assert((vacstmt->options & VACOPT_ANALYZE) || vacstmt->va_cols == NIL);
 
+	/* VACUUM FULL rebuilds indexes rather than vacuuming them */
+	if ((vacstmt->options & VACOPT_FULL) && vacstmt->parallel_workers > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("VACUUM option PARALLEL cannot be used with FULL")));
+
 	stmttype = (vacstmt->options & VACOPT_VACUUM) ? "VACUUM" : "ANALYZE";
 
 	/*
@@ -4,24 +4,33 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead
- * tuple TIDs, with the next biggest need being storage for per-disk-page
- * free space info.  We want to ensure we can vacuum even the very largest
- * relations with finite memory space usage.  To do that, we set upper bounds
- * on the number of tuples and pages we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs,
+ * with the next biggest need being storage for per-disk-page free space info.
+ * We want to ensure we can vacuum even the very largest relations with finite
+ * memory space usage.  To do that, we set upper bounds on the number of
+ * tuples and pages we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a TidStore (see access/common/tidstore.c) of that size,
+ * with an upper limit that depends on table size (this limit ensures we don't
+ * allocate a huge area uselessly for vacuuming small tables).  If the store
+ * threatens to overflow, we suspend the heap scan phase and perform a pass of
+ * index cleanup and page compaction, then resume the heap scan with an empty
+ * store.  The dead tuples of the page being scanned are collected separately
+ * and added to the store once the page is done.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the TID store, just the smallest one that can be created.
+ *
+ * With VACUUM (PARALLEL n), the index vacuuming passes of a table with more
+ * than one index are spread over background workers.  The TID store then
+ * lives in a dynamic shared memory segment, and at each pass the leader
+ * launches up to n workers; the leader and the workers claim the indexes
+ * one at a time and bulk-delete from them, until all are done.  The heap
+ * scan and the heap vacuuming passes are still done by the leader alone.
  *
  *
  * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
@@ -42,8 +51,10 @@
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/tidstore.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
@@ -52,12 +63,23 @@
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/bgworker.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
 #include "storage/freespace.h"
+#include "storage/ipc.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/procsignal.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/resowner.h"
+#include "utils/snapmgr.h"
 #include "utils/timestamp.h"
 #include "utils/tqual.h"
 
@@ -83,19 +105,68 @@
 #define VACUUM_TRUNCATE_LOCK_WAIT_INTERVAL		50		/* ms */
 #define VACUUM_TRUNCATE_LOCK_TIMEOUT			5000	/* ms */
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
  */
 #define SKIP_PAGES_THRESHOLD	((BlockNumber) 32)
 
+/* Magic number and TOC keys of a parallel vacuum's shared segment */
+#define PARALLEL_VACUUM_MAGIC			0x76616375
+#define PARALLEL_KEY_VACUUM_SHARED		0
+#define PARALLEL_KEY_DEAD_TUPLES		1
+
+/* Index statistics of one index, passed between the leader and workers */
+typedef struct LVSharedIndStats
+{
+	Oid			indexoid;
+	bool		updated;		/* is stats valid? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndStats;
+
+/*
+ * State shared between the leader and the workers of a parallel vacuum, in
+ * a dynamic shared memory segment together with the dead tuple array.
+ */
+typedef struct LVShared
+{
+	/* Immutable state, set up by the leader */
+	NameData	dbname;
+	NameData	username;
+	int			elevel;
+	int			cost_delay;
+	int			cost_limit;
+	int			nindexes;
+
+	/* Set by the leader before each pass, while no worker is running */
+	double		num_heap_tuples;
+
+	/* Mutable state, protected by mutex */
+	slock_t		mutex;
+	int			nextindex;		/* next index to be vacuumed in this pass */
+	int			ndone;			/* number of indexes done in this pass */
+
+	/* the first error a worker failed with, reported by the leader */
+	BackgroundWorkerError error;
+
+	/* per-index statistics, each written only by whoever claimed the index */
+	LVSharedIndStats indstats[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/*
+ * Leader's state for a parallel vacuum.  It is allocated in
+ * TopTransactionContext, so that the on_dsm_detach callback can still use
+ * it during abort.
+ */
+typedef struct LVParallelState
+{
+	dsm_segment *seg;
+	LVShared   *lvshared;
+	int			nrequested;		/* number of workers to launch each pass */
+	int			nworkers;		/* number launched for the current pass */
+	BackgroundWorkerHandle *handles[FLEXIBLE_ARRAY_MEMBER];
+} LVParallelState;
+
 typedef struct LVRelStats
 {
 	/* hasindex = true means two-pass strategy; false means one-pass */
@@ -111,14 +182,17 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete */
+	TidStore   *dead_tuples;
+	/* Dead tuples of the page being scanned, not yet added to dead_tuples */
+	int			num_page_dead;
+	OffsetNumber page_dead[MaxHeapTuplesPerPage];
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* Parallel index vacuuming */
+	int			parallel_workers;	/* number of workers requested */
+	LVParallelState *lps;		/* NULL unless vacuuming in parallel */
 } LVRelStats;
 
 
@@ -137,22 +211,38 @@ static void lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			   Relation *Irel, int nindexes, bool scan_all);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf);
+static void lazy_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+					int nindexes, LVRelStats *vacrelstats);
 static void lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
 				  LVRelStats *vacrelstats);
 static void lazy_cleanup_index(Relation indrel,
 				   IndexBulkDeleteResult *stats,
 				   LVRelStats *vacrelstats);
-static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+				 OffsetNumber *deadoffsets, int ndead,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
+static Size lazy_dead_tuples_size(LVRelStats *vacrelstats,
+					  BlockNumber relblocks);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
+static LVParallelState *begin_parallel_vacuum(Relation onerel,
+					  LVRelStats *vacrelstats,
+					  Relation *Irel, int nindexes,
+					  BlockNumber relblocks);
+static void end_parallel_vacuum(LVRelStats *vacrelstats);
+static void lazy_parallel_vacuum_indexes(Relation *Irel,
+							 IndexBulkDeleteResult **indstats,
+							 int nindexes, LVRelStats *vacrelstats);
+static void lazy_parallel_vacuum_claim(LVShared *lvshared, Relation *Irel,
+						   LVRelStats *vacrelstats);
+static void lazy_parallel_cleanup(dsm_segment *seg, Datum arg);
+static void lazy_parallel_vacuum_work(shm_toc *toc, LVShared *lvshared);
 static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 						 TransactionId *visibility_cutoff_xid);
 
@@ -230,6 +320,7 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	vacrelstats->num_index_scans = 0;
 	vacrelstats->pages_removed = 0;
 	vacrelstats->lock_waiter_detected = false;
+	vacrelstats->parallel_workers = vacstmt->parallel_workers;
 
 	/* Open all indexes of the relation */
 	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
@@ -457,7 +548,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	if (vacrelstats->parallel_workers > 0 && nindexes > 1)
+		vacrelstats->lps = begin_parallel_vacuum(onerel, vacrelstats,
+												 Irel, nindexes, nblocks);
+	if (vacrelstats->lps == NULL)
+		lazy_space_alloc(vacrelstats, nblocks);
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
 	/*
@@ -512,7 +607,6 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
 		int			nfrozen;
 		Size		freespace;
 		bool		all_visible_according_to_vm;
@@ -558,8 +652,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (TidStoreIsFull(vacrelstats->dead_tuples) &&
+			TidStoreNumTids(vacrelstats->dead_tuples) > 0)
 		{
 			/*
 			 * Before beginning index vacuuming, we release any pin we may
@@ -577,10 +671,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			vacuum_log_cleanup_info(onerel, vacrelstats);
 
 			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
+			lazy_vacuum_indexes(Irel, indstats, nindexes, vacrelstats);
 			/* Remove tuples from heap */
 			lazy_vacuum_heap(onerel, vacrelstats);
 
@@ -589,7 +680,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			TidStoreReset(vacrelstats->dead_tuples);
 			vacrelstats->num_index_scans++;
 		}
 
@@ -743,7 +834,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		vacrelstats->num_page_dead = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -949,10 +1040,12 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * instead of doing a second scan.
 		 */
 		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+			vacrelstats->num_page_dead > 0)
 		{
 			/* Remove tuples from heap */
-			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
+			lazy_vacuum_page(onerel, blkno, buf, vacrelstats->page_dead,
+							 vacrelstats->num_page_dead, vacrelstats,
+							 &vmbuffer);
 			has_dead_tuples = false;
 
 			/*
@@ -960,7 +1053,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			vacrelstats->num_page_dead = 0;
 			vacuumed_pages++;
 		}
 
@@ -1038,7 +1131,14 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.	(This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (vacrelstats->num_page_dead > 0)
+		{
+			TidStoreAddBlock(vacrelstats->dead_tuples, blkno,
+							 vacrelstats->page_dead,
+							 vacrelstats->num_page_dead);
+			vacrelstats->num_page_dead = 0;
+		}
+		else
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
@@ -1066,16 +1166,13 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	if (TidStoreNumTids(vacrelstats->dead_tuples) > 0)
 	{
 		/* Log cleanup info before we touch indexes */
 		vacuum_log_cleanup_info(onerel, vacrelstats);
 
 		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+		lazy_vacuum_indexes(Irel, indstats, nindexes, vacrelstats);
 		/* Remove tuples from heap */
 		lazy_vacuum_heap(onerel, vacrelstats);
 		vacrelstats->num_index_scans++;
@@ -1085,6 +1182,9 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	for (i = 0; i < nindexes; i++)
 		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
 
+	if (vacrelstats->lps != NULL)
+		end_parallel_vacuum(vacrelstats);
+
 	/* If no indexes, make log report that lazy_vacuum_heap would've made */
 	if (vacuumed_pages)
 		ereport(elevel,
@@ -1122,35 +1222,39 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	TidStoreIter iter;
+	BlockNumber tblk;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	int			ndead;
+	int			ntuples;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 
 	pg_rusage_init(&ru0);
+	ntuples = 0;
 	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	TidStoreBeginIterate(&iter);
+	while ((ndead = TidStoreIterateNext(vacrelstats->dead_tuples, &iter,
+										&tblk, deadoffsets)) > 0)
 	{
-		BlockNumber tblk;
 		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		lazy_vacuum_page(onerel, tblk, buf, deadoffsets, ndead, vacrelstats,
+						 &vmbuffer);
+		ntuples += ndead;
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1170,7 +1274,7 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	ereport(elevel,
 			(errmsg("\"%s\": removed %d row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail("%s.",
 					   pg_rusage_show(&ru0))));
 }
@@ -1181,34 +1285,26 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * deadoffsets[] lists the ndead offsets of the dead tuples of this page,
+ * in ascending order.
  */
-static int
+static void
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 OffsetNumber *deadoffsets, int ndead,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
-	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
 	TransactionId visibility_cutoff_xid;
+	int			i;
 
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < ndead; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, deadoffsets[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1232,7 +1328,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 		recptr = log_heap_clean(onerel, buffer,
 								NULL, 0, NULL, 0,
-								unused, uncnt,
+								deadoffsets, ndead,
 								vacrelstats->latestRemovedXid);
 		PageSetLSN(page, recptr);
 	}
@@ -1250,8 +1346,6 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	}
 
 	END_CRIT_SECTION();
-
-	return tupindex;
 }
 
 /*
@@ -1299,6 +1393,25 @@ lazy_check_needs_freeze(Buffer buf)
 }
 
 
+/*
+ *	lazy_vacuum_indexes() -- vacuum all the indexes of the relation.
+ */
+static void
+lazy_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+					int nindexes, LVRelStats *vacrelstats)
+{
+	int			i;
+
+	if (vacrelstats->lps != NULL)
+	{
+		lazy_parallel_vacuum_indexes(Irel, indstats, nindexes, vacrelstats);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &indstats[i], vacrelstats);
+}
+
 /*
  *	lazy_vacuum_index() -- vacuum one index relation.
  *
@@ -1327,9 +1440,9 @@ lazy_vacuum_index(Relation indrel,
 							   lazy_tid_reaped, (void *) vacrelstats);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					(double) TidStoreNumTids(vacrelstats->dead_tuples)),
 			 errdetail("%s.", pg_rusage_show(&ru0))));
 }
 
@@ -1634,104 +1747,72 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
-	long		maxtuples;
+	Size		size = lazy_dead_tuples_size(vacrelstats, relblocks);
+
+	vacrelstats->dead_tuples =
+		TidStoreCreate(MemoryContextAllocHuge(CurrentMemoryContext, size),
+					   size, relblocks);
+	vacrelstats->num_page_dead = 0;
+}
+
+/*
+ * lazy_dead_tuples_size - size of the dead tuple store for lazy vacuum
+ */
+static Size
+lazy_dead_tuples_size(LVRelStats *vacrelstats, BlockNumber relblocks)
+{
+	Size		size;
 	int			vac_work_mem =  IsAutoVacuumWorkerProcess() &&
 									autovacuum_work_mem != -1 ?
 								autovacuum_work_mem : maintenance_work_mem;
 
 	if (vacrelstats->hasindex)
 	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+		size = (Size) vac_work_mem * 1024;
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+		/*
+		 * No point in more than the table can ever need, nor in more than
+		 * the store can address.
+		 */
+		size = Min(size, TidStoreMaxSize(relblocks));
 
 		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		size = Max(size, TidStoreMinSize(relblocks));
 	}
 	else
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		size = TidStoreMinSize(relblocks);
 	}
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	return size;
 }
 
 /*
  * lazy_record_dead_tuple - remember one deletable tuple
+ *
+ * The tuples of the page being scanned are collected in page_dead[], and
+ * added to the store as a whole by lazy_scan_heap once the page is done.
  */
 static void
 lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr)
 {
-	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
-	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
-	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
-	}
+	Assert(vacrelstats->num_page_dead < MaxHeapTuplesPerPage);
+	vacrelstats->page_dead[vacrelstats->num_page_dead++] =
+		ItemPointerGetOffsetNumber(itemptr);
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
-
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
-}
-
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
-
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
-
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
-
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
-
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
 
-	return 0;
+	return TidStoreIsMember(vacrelstats->dead_tuples, itemptr);
 }
 
 /*
@@ -1830,3 +1911,419 @@ heap_page_is_all_visible(Relation rel, Buffer buf, TransactionId *visibility_cut
 
 	return all_visible;
 }
+
+/*
+ * begin_parallel_vacuum - set up a parallel vacuum of the indexes
+ *
+ * Creates the dynamic shared memory segment holding the dead tuple array
+ * and the state shared with the workers.  Returns NULL if the indexes are
+ * to be vacuumed serially, in which case the caller allocates the dead tuple
+ * array in local memory as usual.
+ */
+static LVParallelState *
+begin_parallel_vacuum(Relation onerel, LVRelStats *vacrelstats,
+					  Relation *Irel, int nindexes, BlockNumber relblocks)
+{
+#ifdef EXEC_BACKEND
+	/* bgw_main can't be a function pointer in an EXEC_BACKEND build */
+	return NULL;
+#else
+	LVParallelState *lps;
+	LVShared   *lvshared;
+	Size		deadsize;
+	int			nworkers;
+	Size		sharedsize;
+	shm_toc_estimator e;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	MemoryContext oldcontext;
+	int			i;
+
+	/*
+	 * The leader vacuums indexes too, so more workers than indexes less one
+	 * would have nothing to do.  Workers can't see our temporary tables'
+	 * local buffers.
+	 */
+	nworkers = Min(vacrelstats->parallel_workers,
+				   max_parallel_maintenance_workers);
+	nworkers = Min(nworkers, nindexes - 1);
+	if (nworkers <= 0 || RelationUsesLocalBuffers(onerel))
+		return NULL;
+
+	deadsize = lazy_dead_tuples_size(vacrelstats, relblocks);
+
+	sharedsize = add_size(offsetof(LVShared, indstats),
+						  mul_size(nindexes, sizeof(LVSharedIndStats)));
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	shm_toc_estimate_chunk(&e, deadsize);
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	seg = dsm_create(segsize);
+	toc = shm_toc_create(PARALLEL_VACUUM_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	lvshared = shm_toc_allocate(toc, sharedsize);
+	namestrcpy(&lvshared->dbname, get_database_name(MyDatabaseId));
+	namestrcpy(&lvshared->username, GetUserNameFromId(GetUserId()));
+	lvshared->elevel = elevel;
+	lvshared->cost_delay = VacuumCostDelay;
+	lvshared->cost_limit = VacuumCostLimit;
+	lvshared->nindexes = nindexes;
+	lvshared->num_heap_tuples = 0;
+	SpinLockInit(&lvshared->mutex);
+	lvshared->nextindex = 0;
+	lvshared->ndone = 0;
+	BackgroundWorkerInitError(&lvshared->error);
+	for (i = 0; i < nindexes; i++)
+	{
+		lvshared->indstats[i].indexoid = RelationGetRelid(Irel[i]);
+		lvshared->indstats[i].updated = false;
+	}
+	shm_toc_insert(toc, PARALLEL_KEY_VACUUM_SHARED, lvshared);
+
+	vacrelstats->dead_tuples = TidStoreCreate(shm_toc_allocate(toc, deadsize),
+											  deadsize, relblocks);
+	shm_toc_insert(toc, PARALLEL_KEY_DEAD_TUPLES, vacrelstats->dead_tuples);
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	lps = palloc0(offsetof(LVParallelState, handles) +
+				  nworkers * sizeof(BackgroundWorkerHandle *));
+	lps->seg = seg;
+	lps->lvshared = lvshared;
+	lps->nrequested = nworkers;
+	on_dsm_detach(seg, lazy_parallel_cleanup, PointerGetDatum(lps));
+	MemoryContextSwitchTo(oldcontext);
+
+	return lps;
+#endif   /* EXEC_BACKEND */
+}
+
+/*
+ * end_parallel_vacuum - release the resources of a parallel vacuum
+ *
+ * The dead tuple array goes away with the segment.
+ */
+static void
+end_parallel_vacuum(LVRelStats *vacrelstats)
+{
+	LVParallelState *lps = vacrelstats->lps;
+
+	Assert(lps->nworkers == 0);
+	dsm_detach(lps->seg);
+	pfree(lps);
+	vacrelstats->lps = NULL;
+	vacrelstats->dead_tuples = NULL;
+}
+
+/*
+ * lazy_parallel_vacuum_indexes - vacuum all the indexes, with workers
+ *
+ * Launches the workers for this pass, vacuums indexes alongside them until
+ * none is left, and waits for the workers to exit.  The index statistics
+ * are passed through shared memory both ways.
+ */
+static void
+lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+							 int nindexes, LVRelStats *vacrelstats)
+{
+	LVParallelState *lps = vacrelstats->lps;
+	LVShared   *lvshared = lps->lvshared;
+	BackgroundWorker worker;
+	MemoryContext oldcontext;
+	bool		save_set_latch_on_sigusr1;
+	PGRUsage	ru0;
+	int			nlaunched;
+	int			i;
+
+	pg_rusage_init(&ru0);
+
+	/* No worker is running, so no need for the lock here */
+	lvshared->num_heap_tuples = vacrelstats->old_rel_tuples;
+	lvshared->nextindex = 0;
+	lvshared->ndone = 0;
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *sstats = &lvshared->indstats[i];
+
+		sstats->updated = (indstats[i] != NULL);
+		if (sstats->updated)
+			memcpy(&sstats->stats, indstats[i], sizeof(IndexBulkDeleteResult));
+	}
+
+	/*
+	 * Launch as many workers as we can get; if there are none, we simply do
+	 * all the work ourselves.  If we error out, detaching from the segment
+	 * terminates them.
+	 */
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = lazy_parallel_vacuum_main;
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel vacuum worker");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(lps->seg));
+	/* set bgw_notify_pid, so that we are signalled as workers exit */
+	worker.bgw_notify_pid = MyProcPid;
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	for (i = 0; i < lps->nrequested; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &lps->handles[lps->nworkers]))
+			break;
+		lps->nworkers++;
+	}
+	MemoryContextSwitchTo(oldcontext);
+	nlaunched = lps->nworkers;
+
+	/* Do our share of the work */
+	lazy_parallel_vacuum_claim(lvshared, Irel, vacrelstats);
+
+	/*
+	 * Wait for all the workers to exit.  We can't just wait for the last
+	 * index to be done, since a worker that died while vacuuming an index
+	 * would leave us waiting forever.
+	 */
+	save_set_latch_on_sigusr1 = set_latch_on_sigusr1;
+	set_latch_on_sigusr1 = true;
+
+	PG_TRY();
+	{
+		while (lps->nworkers > 0)
+		{
+			BgwHandleStatus status;
+			pid_t		pid;
+
+			status = GetBackgroundWorkerPid(lps->handles[lps->nworkers - 1],
+											&pid);
+			if (status == BGWH_STOPPED || status == BGWH_POSTMASTER_DIED)
+			{
+				pfree(lps->handles[--lps->nworkers]);
+				continue;
+			}
+
+			/* Wait to be signalled. */
+			WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+
+			/* An interrupt may have occurred while we were waiting. */
+			CHECK_FOR_INTERRUPTS();
+
+			/* Reset the latch so we don't spin. */
+			ResetLatch(&MyProc->procLatch);
+		}
+	}
+	PG_CATCH();
+	{
+		set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+
+	/*
+	 * Report the error a worker failed with, if any; a worker that went away
+	 * without finishing the index it claimed, and without saving an error,
+	 * is an error too.
+	 */
+	BackgroundWorkerRethrowError(&lvshared->error, "parallel vacuum worker");
+	if (lvshared->ndone < nindexes)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("parallel vacuum worker exited unexpectedly")));
+
+	/* Bring back the statistics */
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *sstats = &lvshared->indstats[i];
+
+		if (!sstats->updated)
+			continue;
+		if (indstats[i] == NULL)
+			indstats[i] = (IndexBulkDeleteResult *)
+				palloc(sizeof(IndexBulkDeleteResult));
+		memcpy(indstats[i], &sstats->stats, sizeof(IndexBulkDeleteResult));
+	}
+
+	for (i = 0; i < nindexes; i++)
+		ereport(elevel,
+				(errmsg("scanned index \"%s\" to remove %.0f row versions",
+						RelationGetRelationName(Irel[i]),
+					(double) TidStoreNumTids(vacrelstats->dead_tuples))));
+	ereport(elevel,
+			(errmsg("scanned %d indexes using %d parallel workers",
+					nindexes, nlaunched),
+			 errdetail("%s.", pg_rusage_show(&ru0))));
+}
+
+/*
+ * lazy_parallel_vacuum_claim - vacuum indexes until none is left unclaimed
+ *
+ * Used by both the leader and the workers.  Irel is the leader's array of
+ * open indexes, or NULL in a worker, which opens each index it claims.
+ */
+static void
+lazy_parallel_vacuum_claim(LVShared *lvshared, Relation *Irel,
+						   LVRelStats *vacrelstats)
+{
+	volatile LVShared *vlvshared = lvshared;
+
+	for (;;)
+	{
+		LVSharedIndStats *sstats;
+		IndexVacuumInfo ivinfo;
+		IndexBulkDeleteResult *stats;
+		Relation	indrel;
+		int			idx;
+
+		SpinLockAcquire(&vlvshared->mutex);
+		idx = vlvshared->nextindex;
+		if (idx < vlvshared->nindexes)
+			vlvshared->nextindex++;
+		SpinLockRelease(&vlvshared->mutex);
+
+		if (idx >= lvshared->nindexes)
+			break;
+		sstats = &lvshared->indstats[idx];
+
+		/*
+		 * The leader holds a lock on the index, and waits for us while holding
+		 * it.  Taking a lock of our own could only deadlock against the
+		 * leader's.
+		 */
+		if (Irel != NULL)
+			indrel = Irel[idx];
+		else
+			indrel = index_open(sstats->indexoid, NoLock);
+
+		ivinfo.index = indrel;
+		ivinfo.analyze_only = false;
+		ivinfo.estimated_count = true;
+		ivinfo.message_level = elevel;
+		ivinfo.num_heap_tuples = lvshared->num_heap_tuples;
+		ivinfo.strategy = vac_strategy;
+
+		/* Do bulk deletion, accumulating into the shared statistics */
+		stats = index_bulk_delete(&ivinfo,
+								  sstats->updated ? &sstats->stats : NULL,
+								  lazy_tid_reaped, (void *) vacrelstats);
+		if (stats != NULL && stats != &sstats->stats)
+		{
+			memcpy(&sstats->stats, stats, sizeof(IndexBulkDeleteResult));
+			pfree(stats);
+		}
+		sstats->updated = (stats != NULL);
+
+		if (Irel == NULL)
+			index_close(indrel, NoLock);
+
+		SpinLockAcquire(&vlvshared->mutex);
+		vlvshared->ndone++;
+		SpinLockRelease(&vlvshared->mutex);
+	}
+}
+
+/*
+ * on_dsm_detach callback: terminate any workers still running.
+ */
+static void
+lazy_parallel_cleanup(dsm_segment *seg, Datum arg)
+{
+	LVParallelState *lps = (LVParallelState *) DatumGetPointer(arg);
+
+	while (lps->nworkers > 0)
+	{
+		--lps->nworkers;
+		TerminateBackgroundWorker(lps->handles[lps->nworkers]);
+	}
+}
+
+/*
+ * Main entry point of a parallel vacuum worker.
+ *
+ * The worker vacuums indexes claimed from the shared state until none is
+ * left, with the leader's dead tuple array and cost settings.
+ */
+void
+lazy_parallel_vacuum_main(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	LVShared   *lvshared;
+
+	/* We can be terminated by the leader if it errors out */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Attach to the leader's shared segment */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel vacuum");
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_VACUUM_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			   errmsg("bad magic number in dynamic shared memory segment")));
+	lvshared = shm_toc_lookup(toc, PARALLEL_KEY_VACUUM_SHARED);
+
+	BackgroundWorkerInitializeConnection(NameStr(lvshared->dbname),
+										 NameStr(lvshared->username));
+
+	/* From here on, the leader reports our errors */
+	PG_TRY();
+	{
+		lazy_parallel_vacuum_work(toc, lvshared);
+	}
+	PG_CATCH();
+	{
+		BackgroundWorkerSaveError(&lvshared->error);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	dsm_detach(seg);
+	proc_exit(0);
+}
+
+/*
+ * Do a parallel vacuum worker's share of the index vacuuming.
+ */
+static void
+lazy_parallel_vacuum_work(shm_toc *toc, LVShared *lvshared)
+{
+	LVRelStats	vacrelstats;
+
+	StartTransactionCommand();
+
+	/* Let concurrent VACUUMs ignore us, like the leader (see vacuum_rel) */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyPgXact->vacuumFlags |= PROC_IN_VACUUM;
+	LWLockRelease(ProcArrayLock);
+
+	/* Vacuum with the same settings as the leader */
+	VacuumCostDelay = lvshared->cost_delay;
+	VacuumCostLimit = lvshared->cost_limit;
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	elevel = lvshared->elevel;
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/* lazy_tid_reaped only looks at the dead tuple store */
+	memset(&vacrelstats, 0, sizeof(vacrelstats));
+	vacrelstats.dead_tuples = (TidStore *)
+		shm_toc_lookup(toc, PARALLEL_KEY_DEAD_TUPLES);
+
+	lazy_parallel_vacuum_claim(lvshared, NULL, &vacrelstats);
+
+	CommitTransactionCommand();
+}
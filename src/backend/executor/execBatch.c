@@ -0,0 +1,436 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Batched evaluation of simple scan quals.
+ *
+ * Evaluating a scan's qual one tuple at a time through ExecQual costs a
+ * few function calls per clause and per Var fetch, which dominates the CPU
+ * time of scans over wide tables that filter out most rows.  For the common
+ * case of a clause comparing a column with a constant, using one of the
+ * built-in comparison operators of a fixed-width type, we can do much
+ * better: deform a whole batch of tuples into per-column arrays, and apply
+ * the comparison in a tight loop over those arrays.  The loops produce a
+ * selection vector, the list of tuples that passed all the clauses so far,
+ * which each subsequent clause narrows down further.
+ *
+ * Clauses that don't fit that pattern are left to the regular expression
+ * evaluation machinery; the scan node runs them on the tuples that survive
+ * the batch clauses.
+ *
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "executor/execBatch.h"
+#include "nodes/primnodes.h"
+#include "optimizer/planmain.h"
+#include "utils/fmgroids.h"
+
+
+/*
+ * The comparison functions we know how to evaluate in batches.  The
+ * comparison is always applied as "column OP constant"; a clause written
+ * the other way around is commuted when it's recognized.
+ */
+typedef struct BatchFunction
+{
+	Oid			funcid;
+	BatchValueType type;
+	BatchCmpOp	op;
+} BatchFunction;
+
+static const BatchFunction batch_functions[] =
+{
+	{F_INT4EQ, BATCH_VALUE_INT32, BATCH_CMP_EQ},
+	{F_INT4NE, BATCH_VALUE_INT32, BATCH_CMP_NE},
+	{F_INT4LT, BATCH_VALUE_INT32, BATCH_CMP_LT},
+	{F_INT4LE, BATCH_VALUE_INT32, BATCH_CMP_LE},
+	{F_INT4GT, BATCH_VALUE_INT32, BATCH_CMP_GT},
+	{F_INT4GE, BATCH_VALUE_INT32, BATCH_CMP_GE},
+	{F_DATE_EQ, BATCH_VALUE_INT32, BATCH_CMP_EQ},
+	{F_DATE_NE, BATCH_VALUE_INT32, BATCH_CMP_NE},
+	{F_DATE_LT, BATCH_VALUE_INT32, BATCH_CMP_LT},
+	{F_DATE_LE, BATCH_VALUE_INT32, BATCH_CMP_LE},
+	{F_DATE_GT, BATCH_VALUE_INT32, BATCH_CMP_GT},
+	{F_DATE_GE, BATCH_VALUE_INT32, BATCH_CMP_GE},
+	{F_INT8EQ, BATCH_VALUE_INT64, BATCH_CMP_EQ},
+	{F_INT8NE, BATCH_VALUE_INT64, BATCH_CMP_NE},
+	{F_INT8LT, BATCH_VALUE_INT64, BATCH_CMP_LT},
+	{F_INT8LE, BATCH_VALUE_INT64, BATCH_CMP_LE},
+	{F_INT8GT, BATCH_VALUE_INT64, BATCH_CMP_GT},
+	{F_INT8GE, BATCH_VALUE_INT64, BATCH_CMP_GE},
+	{F_FLOAT8EQ, BATCH_VALUE_FLOAT8, BATCH_CMP_EQ},
+	{F_FLOAT8NE, BATCH_VALUE_FLOAT8, BATCH_CMP_NE},
+	{F_FLOAT8LT, BATCH_VALUE_FLOAT8, BATCH_CMP_LT},
+	{F_FLOAT8LE, BATCH_VALUE_FLOAT8, BATCH_CMP_LE},
+	{F_FLOAT8GT, BATCH_VALUE_FLOAT8, BATCH_CMP_GT},
+	{F_FLOAT8GE, BATCH_VALUE_FLOAT8, BATCH_CMP_GE}
+};
+
+static bool batch_qual_clause(Expr *clause, Index scanrelid,
+				  BatchQualClause *result);
+static int batch_filter_int32(BatchQualClause *clause, Datum *values,
+				   bool *isnull, uint16 *sel, int nsel);
+static int batch_filter_int64(BatchQualClause *clause, Datum *values,
+				   bool *isnull, uint16 *sel, int nsel);
+static int batch_filter_float8(BatchQualClause *clause, Datum *values,
+					bool *isnull, uint16 *sel, int nsel);
+
+
+/*
+ * ExecInitScanBatch
+ *		Prepare batched evaluation of a scan node's qual
+ *
+ * qual is the plan's qual list (implicit-AND, not yet passed through
+ * ExecInitExpr), scanrelid the range table index of the scanned relation,
+ * and tupdesc the descriptor of its tuples.  The clauses are split into
+ * those that can be evaluated in batches, returned in *batchqual, and the
+ * rest, returned in *otherqual.  If there are no batchable clauses, NULL is
+ * returned and *otherqual is just the whole qual.
+ *
+ * The result is allocated in the current memory context.
+ */
+ScanBatch *
+ExecInitScanBatch(List *qual, Index scanrelid, TupleDesc tupdesc,
+				  List **batchqual, List **otherqual)
+{
+	ScanBatch  *batch;
+	BatchQualClause *clauses;
+	int			nclauses = 0;
+	int			natts = 0;
+	int			i;
+	ListCell   *lc;
+
+	*batchqual = NIL;
+	*otherqual = NIL;
+
+	if (qual == NIL)
+		return NULL;
+
+	clauses = (BatchQualClause *)
+		palloc(list_length(qual) * sizeof(BatchQualClause));
+
+	foreach(lc, qual)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+
+		if (batch_qual_clause(clause, scanrelid, &clauses[nclauses]))
+		{
+			natts = Max(natts, clauses[nclauses].attno);
+			nclauses++;
+			*batchqual = lappend(*batchqual, clause);
+		}
+		else
+			*otherqual = lappend(*otherqual, clause);
+	}
+
+	if (nclauses == 0)
+	{
+		pfree(clauses);
+		list_free(*otherqual);
+		*otherqual = qual;
+		return NULL;
+	}
+
+	Assert(natts <= tupdesc->natts);
+
+	batch = (ScanBatch *) palloc0(sizeof(ScanBatch));
+	batch->tupdesc = tupdesc;
+	batch->nclauses = nclauses;
+	batch->clauses = clauses;
+	batch->natts = natts;
+	batch->values = (Datum **) palloc0(natts * sizeof(Datum *));
+	batch->isnull = (bool **) palloc0(natts * sizeof(bool *));
+
+	/* Allocate arrays only for the columns that the clauses look at */
+	for (i = 0; i < nclauses; i++)
+	{
+		int			col = clauses[i].attno - 1;
+
+		if (batch->values[col] == NULL)
+		{
+			batch->values[col] = (Datum *)
+				palloc(SCANBATCH_MAX_TUPLES * sizeof(Datum));
+			batch->isnull[col] = (bool *)
+				palloc(SCANBATCH_MAX_TUPLES * sizeof(bool));
+		}
+	}
+
+	return batch;
+}
+
+/*
+ * ExecScanBatchQual
+ *		Evaluate the batch clauses over the tuples in batch->tuples
+ *
+ * The caller has filled the first ntuples entries of batch->tuples.  On
+ * return, batch->sel[] lists the indexes of the tuples that passed all the
+ * clauses, in their original order.
+ */
+void
+ExecScanBatchQual(ScanBatch *batch, int ntuples)
+{
+	int			nsel;
+	int			i;
+
+	Assert(ntuples <= SCANBATCH_MAX_TUPLES);
+
+	heap_deform_tuples(batch->tuples, ntuples, batch->tupdesc, batch->natts,
+					   batch->values, batch->isnull);
+
+	for (i = 0; i < ntuples; i++)
+		batch->sel[i] = (uint16) i;
+	nsel = ntuples;
+
+	for (i = 0; i < batch->nclauses && nsel > 0; i++)
+	{
+		BatchQualClause *clause = &batch->clauses[i];
+		Datum	   *values = batch->values[clause->attno - 1];
+		bool	   *isnull = batch->isnull[clause->attno - 1];
+
+		switch (clause->type)
+		{
+			case BATCH_VALUE_INT32:
+				nsel = batch_filter_int32(clause, values, isnull,
+										  batch->sel, nsel);
+				break;
+			case BATCH_VALUE_INT64:
+				nsel = batch_filter_int64(clause, values, isnull,
+										  batch->sel, nsel);
+				break;
+			case BATCH_VALUE_FLOAT8:
+				nsel = batch_filter_float8(clause, values, isnull,
+										   batch->sel, nsel);
+				break;
+		}
+	}
+
+	batch->ntuples = ntuples;
+	batch->nselected = nsel;
+	batch->next = 0;
+}
+
+/*
+ * ExecScanBatchReset
+ *		Forget the current batch, e.g. when the scan is restarted
+ */
+void
+ExecScanBatchReset(ScanBatch *batch)
+{
+	batch->ntuples = 0;
+	batch->nselected = 0;
+	batch->next = 0;
+}
+
+/*
+ * Check whether a qual clause can be evaluated in batches, and if so, fill
+ * in *result.
+ */
+static bool
+batch_qual_clause(Expr *clause, Index scanrelid, BatchQualClause *result)
+{
+	OpExpr	   *opexpr;
+	Node	   *leftop;
+	Node	   *rightop;
+	Var		   *var;
+	Const	   *con;
+	bool		commuted;
+	int			i;
+
+	if (!IsA(clause, OpExpr))
+		return false;
+	opexpr = (OpExpr *) clause;
+	if (list_length(opexpr->args) != 2)
+		return false;
+
+	leftop = (Node *) linitial(opexpr->args);
+	rightop = (Node *) lsecond(opexpr->args);
+	if (IsA(leftop, Var) && IsA(rightop, Const))
+	{
+		var = (Var *) leftop;
+		con = (Const *) rightop;
+		commuted = false;
+	}
+	else if (IsA(leftop, Const) && IsA(rightop, Var))
+	{
+		var = (Var *) rightop;
+		con = (Const *) leftop;
+		commuted = true;
+	}
+	else
+		return false;
+
+	/* Must be a plain user column of the scanned relation */
+	if (var->varno != scanrelid || var->varlevelsup != 0 ||
+		var->varattno <= 0)
+		return false;
+
+	/*
+	 * A null constant makes a strict comparison null, hence false; that is
+	 * rare enough that we don't bother to special-case it.
+	 */
+	if (con->constisnull)
+		return false;
+
+	set_opfuncid(opexpr);
+
+	for (i = 0; i < lengthof(batch_functions); i++)
+	{
+		if (batch_functions[i].funcid != opexpr->opfuncid)
+			continue;
+
+		result->attno = var->varattno;
+		result->type = batch_functions[i].type;
+		result->op = batch_functions[i].op;
+		result->constval = con->constvalue;
+
+		if (commuted)
+		{
+			switch (result->op)
+			{
+				case BATCH_CMP_LT:
+					result->op = BATCH_CMP_GT;
+					break;
+				case BATCH_CMP_LE:
+					result->op = BATCH_CMP_GE;
+					break;
+				case BATCH_CMP_GT:
+					result->op = BATCH_CMP_LT;
+					break;
+				case BATCH_CMP_GE:
+					result->op = BATCH_CMP_LE;
+					break;
+				default:
+					/* EQ and NE are symmetric */
+					break;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * The filter loops.
+ *
+ * Each loop walks the current selection vector and keeps the entries whose
+ * value satisfies "value OP c".  It is written without branches: every
+ * entry is copied down to the output position, which only advances if the
+ * entry passed.  Null values never pass, since all the comparison functions
+ * handled here are strict.
+ *
+ * CMP(a, b) must return a negative, zero or positive number like a btree
+ * comparison function; GETVAL(i) fetches the value of tuple i.
+ */
+#define BATCH_FILTER_LOOP(GETVAL, CMP, OP) \
+	for (j = 0; j < nsel; j++) \
+	{ \
+		int			i = sel[j]; \
+		sel[n] = (uint16) i; \
+		n += (!isnull[i]) & (CMP(GETVAL(i), c) OP 0); \
+	}
+
+#define BATCH_FILTER(GETVAL, CMP) \
+	switch (clause->op) \
+	{ \
+		case BATCH_CMP_EQ: \
+			BATCH_FILTER_LOOP(GETVAL, CMP, ==); \
+			break; \
+		case BATCH_CMP_NE: \
+			BATCH_FILTER_LOOP(GETVAL, CMP, !=); \
+			break; \
+		case BATCH_CMP_LT: \
+			BATCH_FILTER_LOOP(GETVAL, CMP, <); \
+			break; \
+		case BATCH_CMP_LE: \
+			BATCH_FILTER_LOOP(GETVAL, CMP, <=); \
+			break; \
+		case BATCH_CMP_GT: \
+			BATCH_FILTER_LOOP(GETVAL, CMP, >); \
+			break; \
+		case BATCH_CMP_GE: \
+			BATCH_FILTER_LOOP(GETVAL, CMP, >=); \
+			break; \
+	}
+
+/* three-way comparison of integers, without branches */
+#define BATCH_INT_CMP(a, b)		(((a) > (b)) - ((a) < (b)))
+
+/*
+ * Fetching a pass-by-reference value of a null entry would dereference a
+ * null pointer, so in that case substitute zero; the entry fails the
+ * isnull test anyway.
+ */
+#define BATCH_GET_INT32(i)		DatumGetInt32(values[i])
+#ifdef USE_FLOAT8_BYVAL
+#define BATCH_GET_INT64(i)		DatumGetInt64(values[i])
+#define BATCH_GET_FLOAT8(i)		DatumGetFloat8(values[i])
+#else
+#define BATCH_GET_INT64(i)		(isnull[i] ? 0 : DatumGetInt64(values[i]))
+#define BATCH_GET_FLOAT8(i)		(isnull[i] ? 0.0 : DatumGetFloat8(values[i]))
+#endif
+
+/*
+ * Comparison of float8 values, with the same NaN semantics as
+ * float8_cmp_internal: NaNs are equal to each other and greater than any
+ * non-NaN value.
+ */
+static inline int
+batch_float8_cmp(float8 a, float8 b)
+{
+	if (isnan(a))
+		return isnan(b) ? 0 : 1;
+	if (isnan(b))
+		return -1;
+	return BATCH_INT_CMP(a, b);
+}
+
+static int
+batch_filter_int32(BatchQualClause *clause, Datum *values, bool *isnull,
+				   uint16 *sel, int nsel)
+{
+	int32		c = DatumGetInt32(clause->constval);
+	int			n = 0;
+	int			j;
+
+	BATCH_FILTER(BATCH_GET_INT32, BATCH_INT_CMP);
+
+	return n;
+}
+
+static int
+batch_filter_int64(BatchQualClause *clause, Datum *values, bool *isnull,
+				   uint16 *sel, int nsel)
+{
+	int64		c = DatumGetInt64(clause->constval);
+	int			n = 0;
+	int			j;
+
+	BATCH_FILTER(BATCH_GET_INT64, BATCH_INT_CMP);
+
+	return n;
+}
+
+static int
+batch_filter_float8(BatchQualClause *clause, Datum *values, bool *isnull,
+					uint16 *sel, int nsel)
+{
+	float8		c = DatumGetFloat8(clause->constval);
+	int			n = 0;
+	int			j;
+
+	BATCH_FILTER(BATCH_GET_FLOAT8, batch_float8_cmp);
+
+	return n;
+}
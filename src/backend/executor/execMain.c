@@ -40,8 +40,10 @@
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/transam.h"
+#include "access/tupconvert.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
+#include "catalog/partition.h"
 #include "commands/matview.h"
 #include "commands/trigger.h"
 #include "executor/execdebug.h"
@@ -57,6 +59,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
+#include "utils/syscache.h"
 #include "utils/tqual.h"
 
 
@@ -82,6 +85,8 @@ static void ExecutePlan(EState *estate, PlanState *planstate,
 			DestReceiver *dest);
 static bool ExecCheckRTEPerms(RangeTblEntry *rte);
 static void ExecCheckXactReadOnly(PlannedStmt *plannedstmt);
+static bool ExecOpenPartition(PartitionRoutingState *routing, int partidx,
+				  EState *estate);
 static char *ExecBuildSlotValueDescription(TupleTableSlot *slot,
 							  TupleDesc tupdesc,
 							  int maxfieldlen);
@@ -1247,6 +1252,199 @@ ExecGetTriggerResultRel(EState *estate, Oid relid)
 	return rInfo;
 }
 
+/*
+ *		ExecSetupPartitionRouting
+ *
+ * Set up for routing the tuples inserted into a result relation to its
+ * partitions.  Returns NULL if the relation is not partitioned.
+ *
+ * The partitions are opened lazily by ExecFindPartition.  Their
+ * ResultRelInfos are put in es_trig_target_relations, so that AFTER
+ * triggers find them and ExecEndPlan closes them.
+ */
+PartitionRoutingState *
+ExecSetupPartitionRouting(EState *estate, ResultRelInfo *rootResultRelInfo)
+{
+	Relation	rel = rootResultRelInfo->ri_RelationDesc;
+	PartitionKey key;
+	PartitionDesc pdesc;
+	PartitionRoutingState *routing;
+	MemoryContext oldcontext;
+	int			nparts;
+
+	key = RelationGetPartitionKey(rel);
+	if (key == NULL)
+		return NULL;
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	routing = (PartitionRoutingState *) palloc0(sizeof(PartitionRoutingState));
+	routing->rootResultRelInfo = rootResultRelInfo;
+
+	/* fetch the key again, building the bounds may have rebuilt the entry */
+	pdesc = RelationGetPartitionDesc(rel);
+	key = RelationGetPartitionKey(rel);
+	routing->partKey = copy_partition_key(key);
+	routing->partDesc = copy_partition_desc(routing->partKey, pdesc);
+
+	nparts = routing->partDesc->nparts;
+	routing->partitions = (ResultRelInfo **)
+		palloc0(nparts * sizeof(ResultRelInfo *));
+	routing->partTupMaps = (TupleConversionMap **)
+		palloc0(nparts * sizeof(TupleConversionMap *));
+	routing->parentTupMaps = (TupleConversionMap **)
+		palloc0(nparts * sizeof(TupleConversionMap *));
+	routing->partSlot = ExecInitExtraTupleSlot(estate);
+	routing->parentSlot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(routing->parentSlot, RelationGetDescr(rel));
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return routing;
+}
+
+/*
+ *		ExecFindPartition
+ *
+ * Find the partition that accepts the tuple in *slot, and return its
+ * ResultRelInfo.  If the partition's row type differs from the partitioned
+ * table's, *slot is replaced by a slot holding the converted tuple.
+ */
+ResultRelInfo *
+ExecFindPartition(PartitionRoutingState *routing, TupleTableSlot **slot,
+				  EState *estate)
+{
+	PartitionKey key = routing->partKey;
+	PartitionDesc pdesc = routing->partDesc;
+	Relation	rel = routing->rootResultRelInfo->ri_RelationDesc;
+	ResultRelInfo *partRelInfo;
+	TupleConversionMap *map;
+	Datum		value;
+	bool		isnull;
+	int			i;
+
+	value = slot_getattr(*slot, key->partattr, &isnull);
+	i = get_partition_index_for_value(key, pdesc, value, isnull);
+
+	/* if the partition was dropped meanwhile, there's none for the row */
+	if (i >= 0 && routing->partitions[i] == NULL &&
+		!ExecOpenPartition(routing, i, estate))
+		i = -1;
+
+	if (i < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_CHECK_VIOLATION),
+				 errmsg("no partition of relation \"%s\" found for row",
+						RelationGetRelationName(rel)),
+				 errdetail("Failing row contains %s.",
+						   ExecBuildSlotValueDescription(*slot,
+														 RelationGetDescr(rel),
+														 64)),
+				 errtable(rel)));
+
+	partRelInfo = routing->partitions[i];
+	routing->curParentTupMap = routing->parentTupMaps[i];
+
+	map = routing->partTupMaps[i];
+	if (map != NULL)
+	{
+		Relation	partrel = partRelInfo->ri_RelationDesc;
+		MemoryContext oldcontext;
+		HeapTuple	tuple;
+
+		/* the slot owns the converted tuple, so it must outlive the row */
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		tuple = do_convert_tuple(ExecMaterializeSlot(*slot), map);
+		MemoryContextSwitchTo(oldcontext);
+
+		if (routing->partSlot->tts_tupleDescriptor != RelationGetDescr(partrel))
+			ExecSetSlotDescriptor(routing->partSlot, RelationGetDescr(partrel));
+		*slot = ExecStoreTuple(tuple, routing->partSlot, InvalidBuffer, true);
+	}
+
+	return partRelInfo;
+}
+
+/*
+ * Open partition number partidx of a routing state, the first time a row
+ * is routed to it.  Returns false if the partition doesn't exist anymore.
+ */
+static bool
+ExecOpenPartition(PartitionRoutingState *routing, int partidx,
+				  EState *estate)
+{
+	Relation	rel = routing->rootResultRelInfo->ri_RelationDesc;
+	Oid			partoid = routing->partDesc->oids[partidx];
+	ResultRelInfo *partRelInfo;
+	MemoryContext oldcontext;
+	Relation	partrel;
+
+	/*
+	 * Dropping a partition locks only the partition, not the partitioned
+	 * table, so it may have gone away since the partition descriptor was
+	 * built.  As in find_inheritance_children, double-check once we have
+	 * the lock.
+	 */
+	LockRelationOid(partoid, RowExclusiveLock);
+	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(partoid)))
+	{
+		UnlockRelationOid(partoid, RowExclusiveLock);
+		return false;
+	}
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	partrel = heap_open(partoid, NoLock);
+	CheckValidResultRel(partrel, CMD_INSERT);
+
+	partRelInfo = makeNode(ResultRelInfo);
+	InitResultRelInfo(partRelInfo,
+					  partrel,
+					  routing->rootResultRelInfo->ri_RangeTableIndex,
+					  estate->es_instrument);
+	if (partrel->rd_rel->relhasindex)
+		ExecOpenIndices(partRelInfo);
+	estate->es_trig_target_relations =
+		lappend(estate->es_trig_target_relations, partRelInfo);
+
+	routing->partTupMaps[partidx] =
+		convert_tuples_by_name(RelationGetDescr(rel),
+							   RelationGetDescr(partrel),
+							   gettext_noop("could not convert row type"));
+	if (routing->partTupMaps[partidx] != NULL)
+		routing->parentTupMaps[partidx] =
+			convert_tuples_by_name(RelationGetDescr(partrel),
+								   RelationGetDescr(rel),
+								 gettext_noop("could not convert row type"));
+	routing->partitions[partidx] = partRelInfo;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return true;
+}
+
+/*
+ *		ExecPartitionTupleToParent
+ *
+ * Convert the tuple last routed by ExecFindPartition, as inserted into its
+ * partition, back to the partitioned table's row type.  This is needed for
+ * computing RETURNING lists and checking WITH CHECK OPTIONs, which belong
+ * to the table the tuple was inserted into.
+ */
+TupleTableSlot *
+ExecPartitionTupleToParent(PartitionRoutingState *routing,
+						   TupleTableSlot *slot)
+{
+	HeapTuple	tuple;
+
+	if (routing->curParentTupMap == NULL)
+		return slot;
+
+	tuple = do_convert_tuple(ExecMaterializeSlot(slot),
+							 routing->curParentTupMap);
+	return ExecStoreTuple(tuple, routing->parentSlot, InvalidBuffer, true);
+}
+
 /*
  *		ExecContextForcesOids
  *
@@ -49,8 +49,13 @@ ExecScanFetch(ScanState *node,
 		 */
 		Index		scanrelid = ((Scan *) node->ps.plan)->scanrelid;
 
-		Assert(scanrelid > 0);
-		if (estate->es_epqTupleSet[scanrelid - 1])
+		/*
+		 * A ForeignScan that performs a join or aggregation remotely has
+		 * scanrelid 0 and no test tuple of its own.  The planner doesn't
+		 * generate those where a recheck could reach them, so just run the
+		 * access method in that case.
+		 */
+		if (scanrelid > 0 && estate->es_epqTupleSet[scanrelid - 1])
 		{
 			TupleTableSlot *slot = node->ss_ScanTupleSlot;
 
@@ -240,6 +245,10 @@ ExecScan(ScanState *node,
  * the scan node, because the planner will preferentially generate a matching
  * tlist.
  *
+ * Vars in the tlist of an index-only scan, or of a foreign scan that does a
+ * join or aggregation remotely (scanrelid 0), are INDEX_VARs referencing the
+ * scan tuple's columns.
+ *
  * ExecAssignScanType must have been called already.
  */
 void
@@ -248,8 +257,8 @@ ExecAssignScanProjectionInfo(ScanState *node)
 	Scan	   *scan = (Scan *) node->ps.plan;
 	Index		varno;
 
-	/* Vars in an index-only scan's tlist should be INDEX_VAR */
-	if (IsA(scan, IndexOnlyScan))
+	/* Vars in an index-only or scanrelid-0 scan's tlist should be INDEX_VAR */
+	if (IsA(scan, IndexOnlyScan) || scan->scanrelid == 0)
 		varno = INDEX_VAR;
 	else
 		varno = scan->scanrelid;
@@ -342,8 +351,8 @@ ExecScanReScan(ScanState *node)
 	{
 		Index		scanrelid = ((Scan *) node->ps.plan)->scanrelid;
 
-		Assert(scanrelid > 0);
-
-		estate->es_epqScanDone[scanrelid - 1] = false;
+		/* a remote join or aggregation has no test tuple; see above */
+		if (scanrelid > 0)
+			estate->es_epqScanDone[scanrelid - 1] = false;
 	}
 }
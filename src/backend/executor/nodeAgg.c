@@ -84,6 +84,16 @@
  *	  need some fallback logic to use this, since there's no Aggref node
  *	  for a window function.)
  *
+ *	  In AGG_HASHED mode, the hash table is not allowed to grow much past
+ *	  work_mem.  Once it is full, input tuples belonging to groups that are
+ *	  already in the table are still aggregated as usual, but tuples for any
+ *	  other group are written out to one of several batch files, chosen by
+ *	  their hash value, much as nodeHash.c does for an oversized hash join.
+ *	  After the groups in memory have been returned, the table is emptied
+ *	  and each batch file is aggregated in turn, spilling again if need be.
+ *	  The estimate of the table's size does not include pass-by-reference
+ *	  transition values, just as the planner's estimate doesn't.
+ *
  *
  * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -96,6 +106,7 @@
 
 #include "postgres.h"
 
+#include "access/hash.h"
 #include "access/htup_details.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
@@ -108,6 +119,7 @@
 #include "optimizer/tlist.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
+#include "storage/buffile.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -301,6 +313,42 @@ typedef struct AggHashEntryData
 	AggStatePerGroupData pergroup[1];	/* VARIABLE LENGTH ARRAY */
 }	AggHashEntryData;	/* VARIABLE LENGTH STRUCT */
 
+/*
+ * When the hash table fills up, tuples of groups not in the table are
+ * spilled to HASHAGG_SPILL_PARTITIONS batch files, using HASHAGG_SPILL_BITS
+ * bits of the hash value to choose the file.  Batches read back from disk
+ * that overflow again are split using the next lower bits of the hash value,
+ * down to HASHAGG_MAX_SPILL_DEPTH levels; beyond that, we just spill all the
+ * leftover tuples into a single batch.  Every pass still consumes a table's
+ * worth of groups, so that's guaranteed to finish eventually.  We don't use
+ * the low-order bits, since those decide the bucket in the hash table.
+ */
+#define HASHAGG_SPILL_BITS			5
+#define HASHAGG_SPILL_PARTITIONS	(1 << HASHAGG_SPILL_BITS)
+#define HASHAGG_MAX_SPILL_DEPTH		3
+
+/* A batch of spilled tuples waiting to be aggregated */
+typedef struct AggHashBatch
+{
+	BufFile    *file;			/* spilled tuples, rewound to the start */
+	int			depth;			/* partitioning depth of these tuples */
+} AggHashBatch;
+
+/*
+ * AggHashSpillData - state for running AGG_HASHED mode within work_mem
+ */
+typedef struct AggHashSpillData
+{
+	long		mem_used;		/* estimated size of hash table, in bytes */
+	bool		spilling;		/* diverting new groups to batch files? */
+	bool		spilled;		/* spilled any tuples since (re)scan start? */
+	BufFile    *curbatch;		/* batch being read, or NULL for outer plan */
+	int			curdepth;		/* partitioning depth of current input */
+	BufFile    *partitions[HASHAGG_SPILL_PARTITIONS];	/* spill files */
+	List	   *pending;		/* AggHashBatches not yet processed */
+	TupleTableSlot *slot;		/* holds tuples read back from a batch */
+} AggHashSpillData;
+
 
 static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerAgg peragg,
@@ -323,7 +371,14 @@ static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
 static AggHashEntry lookup_hash_entry(AggState *aggstate,
-				  TupleTableSlot *inputslot);
+				  TupleTableSlot *inputslot, bool create);
+static uint32 agg_spill_hash(AggState *aggstate, TupleTableSlot *slot);
+static void agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot,
+				uint32 hashvalue);
+static TupleTableSlot *agg_read_spilled_tuple(AggState *aggstate,
+					   uint32 *hashvalue);
+static bool agg_next_batch(AggState *aggstate);
+static void agg_reset_spill(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
@@ -933,6 +988,7 @@ build_hash_table(AggState *aggstate)
 	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		entrysize;
+	long		nbuckets;
 
 	Assert(node->aggstrategy == AGG_HASHED);
 	Assert(node->numGroups > 0);
@@ -940,11 +996,19 @@ build_hash_table(AggState *aggstate)
 	entrysize = sizeof(AggHashEntryData) +
 		(aggstate->numaggs - 1) * sizeof(AggStatePerGroupData);
 
+	/*
+	 * The planner may expect more groups than fit into work_mem, but the
+	 * table never holds more than that; the rest are spilled.
+	 */
+	nbuckets = Min(node->numGroups,
+				   Max(work_mem * 1024L /
+					   (long) hash_agg_entry_size(aggstate->numaggs), 1));
+
 	aggstate->hashtable = BuildTupleHashTable(node->numCols,
 											  node->grpColIdx,
 											  aggstate->eqfunctions,
 											  aggstate->hashfunctions,
-											  node->numGroups,
+											  nbuckets,
 											  entrysize,
 											  aggstate->aggcontext,
 											  tmpmem);
@@ -1017,19 +1081,48 @@ hash_agg_entry_size(int numAggs)
 	return entrysize;
 }
 
+/*
+ * Estimate for the planner how much of the input will be spilled to batch
+ * files if the hash table would take up tablesize bytes, as a fraction of
+ * the input tuples.  Tuples that are spilled again from a batch are counted
+ * again.
+ *
+ * Each pass keeps a work_mem sized table in memory and spills the tuples of
+ * the other groups, spread evenly over HASHAGG_SPILL_PARTITIONS batches.
+ * We don't bother to model HASHAGG_MAX_SPILL_DEPTH, as it takes a table of
+ * hundreds of gigabytes to reach it.
+ */
+double
+hash_agg_spill_fraction(double tablesize)
+{
+	double		hash_table_bytes = work_mem * 1024.0;
+	double		level_fraction = 1.0;
+	double		spill_fraction = 0.0;
+
+	while (tablesize > hash_table_bytes)
+	{
+		level_fraction *= (tablesize - hash_table_bytes) / tablesize;
+		spill_fraction += level_fraction;
+		tablesize = (tablesize - hash_table_bytes) / HASHAGG_SPILL_PARTITIONS;
+	}
+
+	return spill_fraction;
+}
+
 /*
  * Find or create a hashtable entry for the tuple group containing the
- * given tuple.
+ * given tuple.  If create is false, return NULL rather than creating a new
+ * entry when the group isn't in the table yet.
  *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static AggHashEntry
-lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
+lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot, bool create)
 {
 	TupleTableSlot *hashslot = aggstate->hashslot;
 	ListCell   *l;
 	AggHashEntry entry;
-	bool		isnew;
+	bool		isnew = false;
 
 	/* if first time through, initialize hashslot by cloning input slot */
 	if (hashslot->tts_tupleDescriptor == NULL)
@@ -1052,17 +1145,223 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
 												hashslot,
-												&isnew);
+												create ? &isnew : NULL);
 
 	if (isnew)
 	{
+		AggHashSpill spill = aggstate->hash_spill;
+
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, aggstate->peragg, entry->pergroup);
+
+		/* once the table is full, divert any other groups to disk */
+		spill->mem_used += hash_agg_entry_size(aggstate->numaggs) +
+			MAXALIGN(entry->shared.firstTuple->t_len);
+		if (spill->mem_used > work_mem * 1024L)
+			spill->spilling = true;
 	}
 
 	return entry;
 }
 
+/*
+ * Compute the hash value used to assign a tuple to a spill file.
+ *
+ * This combines the per-column hashes the same way execGrouping.c does, and
+ * then mixes the result once more so that its high-order bits, which choose
+ * the file, are unrelated to the hash table's choice of bucket.
+ */
+static uint32
+agg_spill_hash(AggState *aggstate, TupleTableSlot *slot)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	int			i;
+
+	/* hash functions might leak, so run them in the per-tuple context */
+	oldContext =
+		MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, node->grpColIdx[i], &isNull);
+
+		if (!isNull)			/* treat nulls as having hash key 0 */
+			hashkey ^= DatumGetUInt32(FunctionCall1(&aggstate->hashfunctions[i],
+													attr));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return DatumGetUInt32(hash_uint32(hashkey));
+}
+
+/*
+ * Write a tuple whose group is not in the hash table to a spill file.
+ *
+ * The format is the same one nodeHashjoin.c uses for its batch files: the
+ * hash value, followed by the tuple as a MinimalTuple.
+ */
+static void
+agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot, uint32 hashvalue)
+{
+	AggHashSpill spill = aggstate->hash_spill;
+	MinimalTuple tuple;
+	int			partno;
+	size_t		written;
+
+	if (spill->curdepth < HASHAGG_MAX_SPILL_DEPTH)
+		partno = (hashvalue >> (32 - (spill->curdepth + 1) * HASHAGG_SPILL_BITS)) &
+			(HASHAGG_SPILL_PARTITIONS - 1);
+	else
+		partno = 0;
+
+	if (spill->partitions[partno] == NULL)
+		spill->partitions[partno] = BufFileCreateTemp(false);
+	spill->spilled = true;
+
+	tuple = ExecFetchSlotMinimalTuple(slot);
+
+	written = BufFileWrite(spill->partitions[partno],
+						   (void *) &hashvalue, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(spill->partitions[partno],
+						   (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+}
+
+/*
+ * Read the next tuple from the batch currently being processed.  Return
+ * NULL if there are no more.
+ *
+ * On success, *hashvalue is set to the hash value saved with the tuple, and
+ * the tuple itself is stored in the spill state's slot.
+ */
+static TupleTableSlot *
+agg_read_spilled_tuple(AggState *aggstate, uint32 *hashvalue)
+{
+	AggHashSpill spill = aggstate->hash_spill;
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	/*
+	 * Since both the hash value and the MinimalTuple length word are uint32,
+	 * we can read them both in one BufFileRead() call without any type
+	 * cheating.
+	 */
+	nread = BufFileRead(spill->curbatch, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+	{
+		ExecClearTuple(spill->slot);
+		return NULL;
+	}
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	*hashvalue = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(spill->curbatch,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, spill->slot, true);
+}
+
+/*
+ * Throw away the groups we have already returned, and build a new hash
+ * table from the next pending batch.  Returns false if there are no more
+ * batches.
+ */
+static bool
+agg_next_batch(AggState *aggstate)
+{
+	AggHashSpill spill = aggstate->hash_spill;
+	AggHashBatch *batch;
+
+	if (spill->pending == NIL)
+		return false;
+
+	batch = (AggHashBatch *) linitial(spill->pending);
+	spill->pending = list_delete_first(spill->pending);
+
+	/*
+	 * We're done with every group in the table, so it's time to run any
+	 * shutdown callbacks the aggregates registered.  Then release the table,
+	 * which lives in a sub-context of the aggcontext, along with the
+	 * transition values and the representative tuples.
+	 */
+	ExecClearTuple(aggstate->ss.ss_ScanTupleSlot);
+	ReScanExprContext(aggstate->ss.ps.ps_ExprContext);
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	build_hash_table(aggstate);
+	spill->mem_used = 0;
+
+	spill->curbatch = batch->file;
+	spill->curdepth = batch->depth;
+	pfree(batch);
+
+	agg_fill_hash_table(aggstate);
+
+	return true;
+}
+
+/*
+ * Close all spill files and forget about any pending batches.
+ */
+static void
+agg_reset_spill(AggState *aggstate)
+{
+	AggHashSpill spill = aggstate->hash_spill;
+	ListCell   *lc;
+	int			i;
+
+	if (spill->curbatch != NULL)
+		BufFileClose(spill->curbatch);
+	spill->curbatch = NULL;
+
+	for (i = 0; i < HASHAGG_SPILL_PARTITIONS; i++)
+	{
+		if (spill->partitions[i] != NULL)
+			BufFileClose(spill->partitions[i]);
+		spill->partitions[i] = NULL;
+	}
+
+	foreach(lc, spill->pending)
+	{
+		AggHashBatch *batch = (AggHashBatch *) lfirst(lc);
+
+		BufFileClose(batch->file);
+		pfree(batch);
+	}
+	list_free(spill->pending);
+	spill->pending = NIL;
+
+	spill->mem_used = 0;
+	spill->spilling = false;
+	spill->spilled = false;
+	spill->curdepth = 0;
+}
+
 /*
  * ExecAgg -
  *
@@ -1324,14 +1623,20 @@ agg_retrieve_direct(AggState *aggstate)
 
 /*
  * ExecAgg for hashed case: phase 1, read input and build hash table
+ *
+ * The input is the outer plan the first time through, and a spilled batch
+ * after that; see agg_next_batch.
  */
 static void
 agg_fill_hash_table(AggState *aggstate)
 {
 	PlanState  *outerPlan;
 	ExprContext *tmpcontext;
+	AggHashSpill spill = aggstate->hash_spill;
 	AggHashEntry entry;
 	TupleTableSlot *outerslot;
+	uint32		hashvalue = 0;
+	int			i;
 
 	/*
 	 * get state info from node
@@ -1346,22 +1651,71 @@ agg_fill_hash_table(AggState *aggstate)
 	 */
 	for (;;)
 	{
-		outerslot = ExecProcNode(outerPlan);
-		if (TupIsNull(outerslot))
-			break;
+		if (spill->curbatch == NULL)
+		{
+			outerslot = ExecProcNode(outerPlan);
+			if (TupIsNull(outerslot))
+				break;
+		}
+		else
+		{
+			outerslot = agg_read_spilled_tuple(aggstate, &hashvalue);
+			if (TupIsNull(outerslot))
+				break;
+		}
 		/* set up for advance_aggregates call */
 		tmpcontext->ecxt_outertuple = outerslot;
 
-		/* Find or build hashtable entry for this tuple's group */
-		entry = lookup_hash_entry(aggstate, outerslot);
+		/*
+		 * Find or build hashtable entry for this tuple's group.  If the table
+		 * is full and the group isn't in it, save the tuple for later.
+		 */
+		entry = lookup_hash_entry(aggstate, outerslot, !spill->spilling);
 
-		/* Advance the aggregates */
-		advance_aggregates(aggstate, entry->pergroup);
+		if (entry != NULL)
+		{
+			/* Advance the aggregates */
+			advance_aggregates(aggstate, entry->pergroup);
+		}
+		else
+		{
+			if (spill->curbatch == NULL)
+				hashvalue = agg_spill_hash(aggstate, outerslot);
+			agg_spill_tuple(aggstate, outerslot, hashvalue);
+		}
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(tmpcontext);
 	}
 
+	/* Done with this batch's input */
+	if (spill->curbatch != NULL)
+	{
+		BufFileClose(spill->curbatch);
+		spill->curbatch = NULL;
+	}
+
+	/* Queue up whatever we spilled to be processed after this batch */
+	for (i = 0; i < HASHAGG_SPILL_PARTITIONS; i++)
+	{
+		AggHashBatch *batch;
+
+		if (spill->partitions[i] == NULL)
+			continue;
+
+		if (BufFileSeek(spill->partitions[i], 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+		batch = (AggHashBatch *) palloc(sizeof(AggHashBatch));
+		batch->file = spill->partitions[i];
+		batch->depth = spill->curdepth + 1;
+		spill->pending = lcons(batch, spill->pending);
+		spill->partitions[i] = NULL;
+	}
+	spill->spilling = false;
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the hash table */
 	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
@@ -1404,7 +1758,11 @@ agg_retrieve_hash_table(AggState *aggstate)
 		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
 		if (entry == NULL)
 		{
-			/* No more entries in hashtable, so done */
+			/* No more entries in hashtable; try the next spilled batch */
+			if (agg_next_batch(aggstate))
+				continue;
+
+			/* No more batches either, so done */
 			aggstate->agg_done = TRUE;
 			return NULL;
 		}
@@ -1516,6 +1874,7 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	aggstate->pergroup = NULL;
 	aggstate->grp_firstTuple = NULL;
 	aggstate->hashtable = NULL;
+	aggstate->hash_spill = NULL;
 
 	/*
 	 * Create expression contexts.	We need two, one for per-input-tuple
@@ -1640,6 +1999,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		aggstate->table_filled = false;
 		/* Compute the columns we actually need to hash on */
 		aggstate->hash_needed = find_hash_columns(aggstate);
+
+		/* Set up for spilling, with a slot to read back spilled tuples */
+		aggstate->hash_spill = (AggHashSpill) palloc0(sizeof(AggHashSpillData));
+		aggstate->hash_spill->slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(aggstate->hash_spill->slot,
+							  ExecGetResultType(outerPlanState(aggstate)));
 	}
 	else
 	{
@@ -2029,6 +2394,10 @@ ExecEndAgg(AggState *node)
 	/* And ensure any agg shutdown callbacks have been called */
 	ReScanExprContext(node->ss.ps.ps_ExprContext);
 
+	/* Close any spill files */
+	if (node->hash_spill != NULL)
+		agg_reset_spill(node);
+
 	/*
 	 * Free both the expr contexts.
 	 */
@@ -2069,13 +2438,17 @@ ExecReScanAgg(AggState *node)
 		/*
 		 * If we do have the hash table and the subplan does not have any
 		 * parameter changes, then we can just rescan the existing hash table;
-		 * no need to build it again.
+		 * no need to build it again.  That doesn't work if some groups were
+		 * spilled, though, since then the table holds only the last batch.
 		 */
-		if (node->ss.ps.lefttree->chgParam == NULL)
+		if (node->ss.ps.lefttree->chgParam == NULL &&
+			!node->hash_spill->spilled)
 		{
 			ResetTupleHashIterator(node->hashtable, &node->hashiter);
 			return;
 		}
+
+		agg_reset_spill(node);
 	}
 
 	/* Make sure we have closed any open tuplesorts */
@@ -53,14 +53,28 @@
  *			  nil	nil		 Scan	 Scan	  Scan	   Scan
  *							  |		  |		   |		|
  *							person employee student student-emp
+ *
+ *		When scanning a partitioned table, the planner may leave us
+ *		clauses on the partition key that compare it with parameters of
+ *		the query.  The subplans of partitions that those clauses rule
+ *		out, given the parameter values, are not even initialized.
  */
 
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "catalog/partition.h"
 #include "executor/execdebug.h"
 #include "executor/nodeAppend.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "parser/parsetree.h"
+#include "utils/lsyscache.h"
 
 static bool exec_append_initialize_next(AppendState *appendstate);
+static bool *exec_append_prune_partitions(Append *node, EState *estate);
+static Node *exec_append_substitute_params(Node *node, ParamListInfo params);
 
 
 /* ----------------------------------------------------------------
@@ -105,10 +119,104 @@ exec_append_initialize_next(AppendState *appendstate)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		exec_append_prune_partitions
+ *
+ *		If the planner left us clauses to prune partitions with, evaluate
+ *		them using the query's parameter values, and return an array
+ *		telling which subplans still need to be run.  Returns NULL if
+ *		all of them do.
+ *
+ *		The partitioned table's own subplan is always kept, so that there
+ *		is at least one.
+ * ----------------------------------------------------------------
+ */
+static bool *
+exec_append_prune_partitions(Append *node, EState *estate)
+{
+	ParamListInfo params = estate->es_param_list_info;
+	Oid			parentoid;
+	Relation	parentrel;
+	List	   *quals;
+	List	   *partoids;
+	bool	   *keep;
+	ListCell   *lc;
+	int			i;
+
+	if (node->part_prune_quals == NIL || params == NULL)
+		return NULL;
+
+	quals = (List *) exec_append_substitute_params((Node *) node->part_prune_quals,
+												   params);
+	quals = (List *) eval_const_expressions(NULL, (Node *) quals);
+
+	/* The planner or plancache has locked the table already */
+	parentoid = getrelid(node->part_prune_rti, estate->es_range_table);
+	parentrel = heap_open(parentoid, NoLock);
+	partoids = get_partitions_for_clauses(parentrel, node->part_prune_rti,
+										  quals);
+	heap_close(parentrel, NoLock);
+
+	keep = (bool *) palloc(list_length(node->appendplans) * sizeof(bool));
+	i = 0;
+	foreach(lc, node->part_prune_oids)
+	{
+		Oid			relid = lfirst_oid(lc);
+
+		keep[i++] = (relid == parentoid || list_member_oid(partoids, relid));
+	}
+
+	return keep;
+}
+
+/*
+ * Replace external Params by Consts holding their values.
+ */
+static Node *
+exec_append_substitute_params(Node *node, ParamListInfo params)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+		int			thisParamId = param->paramid;
+
+		if (param->paramkind == PARAM_EXTERN &&
+			thisParamId > 0 && thisParamId <= params->numParams)
+		{
+			ParamExternData *prm = &params->params[thisParamId - 1];
+
+			/* give hook a chance in case parameter is dynamic */
+			if (!OidIsValid(prm->ptype) && params->paramFetch != NULL)
+				(*params->paramFetch) (params, thisParamId);
+
+			if (OidIsValid(prm->ptype) && prm->ptype == param->paramtype)
+			{
+				int16		typLen;
+				bool		typByVal;
+
+				get_typlenbyval(param->paramtype, &typLen, &typByVal);
+				return (Node *) makeConst(param->paramtype,
+										  param->paramtypmod,
+										  param->paramcollid,
+										  (int) typLen,
+										  prm->value,
+										  prm->isnull,
+										  typByVal);
+			}
+		}
+		return node;
+	}
+	return expression_tree_mutator(node, exec_append_substitute_params,
+								   (void *) params);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitAppend
  *
- *		Begin all of the subscans of the append node.
+ *		Begin all of the subscans of the append node, except those for
+ *		partitions that the parameter values rule out.
  *
  *	   (This is potentially wasteful, since the entire result of the
  *		append node may not be scanned, but this way all of the
@@ -121,6 +229,7 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 {
 	AppendState *appendstate = makeNode(AppendState);
 	PlanState **appendplanstates;
+	bool	   *keep;
 	int			nplans;
 	int			i;
 	ListCell   *lc;
@@ -131,7 +240,13 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	/*
 	 * Set up empty vector of subplan states
 	 */
-	nplans = list_length(node->appendplans);
+	keep = exec_append_prune_partitions(node, estate);
+	nplans = 0;
+	for (i = 0; i < list_length(node->appendplans); i++)
+	{
+		if (keep == NULL || keep[i])
+			nplans++;
+	}
 
 	appendplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
 
@@ -161,11 +276,13 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 * results into the array "appendplans".
 	 */
 	i = 0;
+	nplans = 0;
 	foreach(lc, node->appendplans)
 	{
 		Plan	   *initNode = (Plan *) lfirst(lc);
 
-		appendplanstates[i] = ExecInitNode(initNode, estate, eflags);
+		if (keep == NULL || keep[i])
+			appendplanstates[nplans++] = ExecInitNode(initNode, estate, eflags);
 		i++;
 	}
 
@@ -15,7 +15,8 @@
 /*
  * INTERFACE ROUTINES
  *
- *		ExecForeignScan			scans a foreign table.
+ *		ExecForeignScan			scans a foreign table, or a join or
+ *								aggregation performed by the FDW.
  *		ExecInitForeignScan		creates and initializes state info.
  *		ExecReScanForeignScan	rescans the foreign relation.
  *		ExecEndForeignScan		releases any resources allocated.
@@ -140,17 +141,38 @@ ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags)
 	ExecInitResultTupleSlot(estate, &scanstate->ss.ps);
 	ExecInitScanTupleSlot(estate, &scanstate->ss);
 
-	/*
-	 * open the base relation and acquire appropriate lock on it.
-	 */
-	currentRelation = ExecOpenScanRelation(estate, node->scan.scanrelid, eflags);
-	scanstate->ss.ss_currentRelation = currentRelation;
-
-	/*
-	 * get the scan type from the relation descriptor.	(XXX at some point we
-	 * might want to let the FDW editorialize on the scan tupdesc.)
-	 */
-	ExecAssignScanType(&scanstate->ss, RelationGetDescr(currentRelation));
+	if (node->scan.scanrelid > 0)
+	{
+		/*
+		 * open the base relation and acquire appropriate lock on it.
+		 */
+		currentRelation = ExecOpenScanRelation(estate, node->scan.scanrelid,
+											   eflags);
+		scanstate->ss.ss_currentRelation = currentRelation;
+
+		/*
+		 * get the scan type from the relation descriptor.	(XXX at some
+		 * point we might want to let the FDW editorialize on the scan
+		 * tupdesc.)
+		 */
+		ExecAssignScanType(&scanstate->ss, RelationGetDescr(currentRelation));
+
+		/*
+		 * Acquire function pointers from the FDW's handler.
+		 */
+		fdwroutine = GetFdwRoutineForRelation(currentRelation, true);
+	}
+	else
+	{
+		/*
+		 * The FDW performs a join or aggregation remotely, so there's no
+		 * relation to open.  The scan tuple is described by fdw_scan_tlist.
+		 */
+		scanstate->ss.ss_currentRelation = NULL;
+		ExecAssignScanType(&scanstate->ss,
+						   ExecTypeFromTL(node->fdw_scan_tlist, false));
+		fdwroutine = GetFdwRoutineByServerId(node->fs_server);
+	}
 
 	/*
 	 * Initialize result tuple type and projection info.
@@ -159,9 +181,8 @@ ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags)
 	ExecAssignScanProjectionInfo(&scanstate->ss);
 
 	/*
-	 * Acquire function pointers from the FDW's handler, and init fdw_state.
+	 * Save the FDW's function pointers, and init fdw_state.
 	 */
-	fdwroutine = GetFdwRoutineForRelation(currentRelation, true);
 	scanstate->fdwroutine = fdwroutine;
 	scanstate->fdw_state = NULL;
 
@@ -192,8 +213,9 @@ ExecEndForeignScan(ForeignScanState *node)
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
-	/* close the relation. */
-	ExecCloseScanRelation(node->ss.ss_currentRelation);
+	/* close the relation, if we opened one */
+	if (node->ss.ss_currentRelation)
+		ExecCloseScanRelation(node->ss.ss_currentRelation);
 }
 
 /* ----------------------------------------------------------------
@@ -0,0 +1,810 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeGather.c
+ *	  Support routines for running a sequential scan in parallel.
+ *
+ * A Gather node launches background workers that each run a copy of its
+ * subplan, a sequential scan, and send the resulting tuples back through
+ * a shared memory queue.  The backend running the query scans too, so the
+ * participants divide the blocks of the relation between them through a
+ * parallel heap scan, and Gather returns the union of their output.
+ *
+ * The workers don't run a plan tree of their own.  They evaluate the scan's
+ * qual and target list, passed to them in nodeToString form, against the
+ * tuples their share of the scan returns, using the leader's snapshot.
+ * That's only safe for quals and target lists the planner has checked to
+ * contain nothing but immutable functions, and only while the leader has
+ * no XID of its own, since workers can't see the leader's changes.  If a
+ * worker fails, the leader reports its error; if no workers can be
+ * launched, the leader simply scans the whole relation itself.
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeGather.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecGather				returns the next tuple of any participant
+ *		ExecInitGather			creates and initializes a gather node
+ *		ExecEndGather			shuts down the workers and the subplan
+ *		ExecReScanGather		rescans the relation
+ */
+#include "postgres.h"
+
+#include "access/relscan.h"
+#include "access/xact.h"
+#include "commands/dbcommands.h"
+#include "executor/executor.h"
+#include "executor/nodeGather.h"
+#include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "optimizer/planmain.h"
+#include "postmaster/bgworker.h"
+#include "storage/dsm.h"
+#include "storage/dsm_impl.h"
+#include "storage/ipc.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/procsignal.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/resowner.h"
+#include "utils/snapmgr.h"
+#include "utils/tqual.h"
+
+
+/* Magic number and TOC keys of a parallel scan's shared segment */
+#define PARALLEL_GATHER_MAGIC			0x67617468
+#define PARALLEL_KEY_GATHER_SHARED		0
+#define PARALLEL_KEY_SNAPSHOT			1
+#define PARALLEL_KEY_HEAP_SCAN			2
+#define PARALLEL_KEY_PLAN				3
+#define PARALLEL_KEY_TUPLE_QUEUE		4	/* plus worker number */
+
+/* Size of each worker's tuple queue */
+#define PARALLEL_TUPLE_QUEUE_SIZE		((Size) 65536)
+
+/* Number of heap blocks a participant claims from the shared scan at once */
+#define PARALLEL_GATHER_SCAN_CHUNK		16
+
+/* Progress of a worker, as far as the leader needs to know it */
+typedef enum
+{
+	GATHER_WORKER_NOT_STARTED,	/* hasn't claimed any blocks yet */
+	GATHER_WORKER_SCANNING,		/* may have claimed blocks */
+	GATHER_WORKER_DONE			/* has sent all of its tuples */
+} GatherWorkerStatus;
+
+typedef struct GatherWorker
+{
+	GatherWorkerStatus status;	/* protected by the GatherShared mutex */
+	BackgroundWorkerError error;	/* error the worker failed with, if any */
+} GatherWorker;
+
+/*
+ * State shared between the leader and the workers.  It lives in a dynamic
+ * shared memory segment, together with the leader's snapshot, the parallel
+ * heap scan, the subplan's qual and target list, and one tuple queue per
+ * worker.
+ */
+typedef struct GatherShared
+{
+	/*
+	 * Immutable state, set up by the leader before launching the workers.
+	 */
+	NameData	dbname;
+	NameData	username;		/* session user */
+	Oid			userid;			/* current user ... */
+	int			sec_context;	/* ... and security context */
+	int			leaderprocno;	/* pgprocno of the leader */
+	Oid			relid;			/* relation to scan */
+	int			nworkers;
+
+	/* Mutable state, protected by mutex */
+	slock_t		mutex;
+	int			nclaimed;		/* worker numbers handed out so far */
+	GatherWorker workers[FLEXIBLE_ARRAY_MEMBER];
+} GatherShared;
+
+/*
+ * Leader's state for the launched workers.  The struct and the worker
+ * handles are allocated in TopTransactionContext, so that they survive until
+ * the on_dsm_detach callback runs during abort.
+ */
+typedef struct ParallelGatherState
+{
+	dsm_segment *seg;
+	GatherShared *shared;
+	int			nworkers;		/* number of workers launched */
+	int			nactive;		/* number of queues not yet read to the end */
+	shm_mq	  **mqs;			/* tuple queue of each worker */
+	shm_mq_handle **queues;		/* our handle for each queue, or NULL */
+	BackgroundWorkerHandle *handles[FLEXIBLE_ARRAY_MEMBER];
+} ParallelGatherState;
+
+static void ExecGatherLaunchWorkers(GatherState *node);
+static void ExecGatherShutdownWorkers(GatherState *node);
+static bool gather_readnext(GatherState *node);
+static void gather_worker_finished(ParallelGatherState *pstate, int worker);
+static void gather_wait(ParallelGatherState *pstate);
+static void gather_cleanup(dsm_segment *seg, Datum arg);
+static void gather_worker_main(Datum main_arg);
+static void gather_worker_scan(shm_toc *toc, GatherShared *shared,
+				   int workernum, shm_mq_handle *mqh);
+
+
+/* ----------------------------------------------------------------
+ *		ExecGather
+ *
+ *		Returns the next tuple produced by any participant of the scan,
+ *		or an empty slot once all of them are done.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecGather(GatherState *node)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *slot;
+
+	if (!node->initialized)
+	{
+		ExecGatherLaunchWorkers(node);
+		node->initialized = true;
+	}
+
+	for (;;)
+	{
+		/* Return a tuple from a worker, if one is ready */
+		if (node->pstate != NULL && node->pstate->nactive > 0 &&
+			gather_readnext(node))
+		{
+			slot = node->ps.ps_ResultTupleSlot;
+			ExecStoreTuple(&node->tuple, slot, InvalidBuffer, false);
+			return slot;
+		}
+
+		/* Otherwise, scan a tuple of our own */
+		if (!node->child_done)
+		{
+			slot = ExecProcNode(outerNode);
+			if (!TupIsNull(slot))
+				return slot;
+			node->child_done = true;
+			continue;
+		}
+
+		if (node->pstate == NULL || node->pstate->nactive == 0)
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+		/* Our share is done; wait for the workers to send more */
+		gather_wait(node->pstate);
+	}
+}
+
+/*
+ * Read the next tuple from the workers' queues into node->tuple, trying each
+ * queue once, in turn.  Returns false if none had a tuple ready.
+ */
+static bool
+gather_readnext(GatherState *node)
+{
+	ParallelGatherState *pstate = node->pstate;
+	int			nvisited;
+
+	for (nvisited = 0; nvisited < pstate->nworkers; nvisited++)
+	{
+		int			i = node->nextreader;
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		node->nextreader = (i + 1) % pstate->nworkers;
+		if (pstate->queues[i] == NULL)
+			continue;
+
+		res = shm_mq_receive(pstate->queues[i], &nbytes, &data, true);
+		if (res == SHM_MQ_SUCCESS)
+		{
+			node->tuple.t_len = nbytes;
+			ItemPointerSetInvalid(&node->tuple.t_self);
+			node->tuple.t_tableOid = InvalidOid;
+			node->tuple.t_data = (HeapTupleHeader) data;
+			return true;
+		}
+		if (res == SHM_MQ_DETACHED)
+			gather_worker_finished(pstate, i);
+	}
+
+	return false;
+}
+
+/*
+ * A worker has detached from its queue, and we've read all of its tuples.
+ * Report its error if it failed; a worker that went away in the middle of
+ * its share of the scan without reporting an error is an error too.
+ */
+static void
+gather_worker_finished(ParallelGatherState *pstate, int worker)
+{
+	volatile GatherShared *shared = pstate->shared;
+	GatherWorkerStatus status;
+
+	pstate->queues[worker] = NULL;
+	pstate->nactive--;
+
+	BackgroundWorkerRethrowError(&pstate->shared->workers[worker].error,
+								 "parallel worker");
+
+	SpinLockAcquire(&shared->mutex);
+	status = shared->workers[worker].status;
+	SpinLockRelease(&shared->mutex);
+
+	if (status == GATHER_WORKER_SCANNING)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("parallel worker exited unexpectedly")));
+}
+
+/*
+ * Wait until a worker sends a tuple, detaches or stops.
+ */
+static void
+gather_wait(ParallelGatherState *pstate)
+{
+	bool		save_set_latch_on_sigusr1;
+	bool		allstopped = true;
+	int			i;
+
+	/*
+	 * Worker numbers are handed out in the order workers start, so we can't
+	 * tell which worker will attach to which queue.  But once every worker
+	 * has stopped, a queue that no one attached to never will be.  Such a
+	 * worker never got to claim any blocks, so we just forget about it.
+	 * Check the workers before the queues, so that a worker that attaches
+	 * and stops in between is seen as attached.
+	 */
+	for (i = 0; i < pstate->nworkers; i++)
+	{
+		BgwHandleStatus status;
+		pid_t		pid;
+
+		status = GetBackgroundWorkerPid(pstate->handles[i], &pid);
+		if (status != BGWH_STOPPED && status != BGWH_POSTMASTER_DIED)
+		{
+			allstopped = false;
+			break;
+		}
+	}
+	if (allstopped)
+	{
+		for (i = 0; i < pstate->nworkers; i++)
+		{
+			if (pstate->queues[i] != NULL &&
+				shm_mq_get_sender(pstate->mqs[i]) == NULL)
+			{
+				pstate->queues[i] = NULL;
+				pstate->nactive--;
+			}
+		}
+		if (pstate->nactive == 0)
+			return;
+	}
+
+	/*
+	 * Workers set our latch when they send a tuple or detach, and the
+	 * postmaster signals us when one of them stops.
+	 */
+	save_set_latch_on_sigusr1 = set_latch_on_sigusr1;
+	set_latch_on_sigusr1 = true;
+
+	PG_TRY();
+	{
+		WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+		ResetLatch(&MyProc->procLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+	PG_CATCH();
+	{
+		set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	set_latch_on_sigusr1 = save_set_latch_on_sigusr1;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecGatherLaunchWorkers
+ *
+ *		Set up the shared state, launch as many of the planned workers
+ *		as we can get, and switch our own copy of the subplan over to the
+ *		parallel scan.  If no workers can be launched, we leave the subplan
+ *		alone and it scans the whole relation.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecGatherLaunchWorkers(GatherState *node)
+{
+	Gather	   *plan = (Gather *) node->ps.plan;
+	SeqScanState *child = (SeqScanState *) outerPlanState(node);
+	Relation	rel = child->ss.ss_currentRelation;
+	Snapshot	snapshot = node->ps.state->es_snapshot;
+	int			nworkers = plan->num_workers;
+	ParallelGatherState *pstate;
+	GatherShared *shared;
+	ParallelHeapScanDesc pscan;
+	char	   *snapspace;
+	char	   *qualstr;
+	char	   *tliststr;
+	char	   *planstr;
+	Size		qualsize;
+	Size		tlistsize;
+	Size		sharedsize;
+	shm_toc_estimator e;
+	Size		segsize;
+	dsm_segment *seg;
+	shm_toc    *toc;
+	BackgroundWorker worker;
+	MemoryContext oldcontext;
+	int			i;
+
+	node->nworkers_launched = 0;
+
+#ifdef EXEC_BACKEND
+	/* workers' entry point is passed as a function pointer */
+	return;
+#endif
+
+	/*
+	 * Workers can't see our changes, nor take part in our serializable
+	 * transaction, so use them only if we have neither.
+	 */
+	if (nworkers <= 0 ||
+		dynamic_shared_memory_type == DSM_IMPL_NONE ||
+		!IsMVCCSnapshot(snapshot) ||
+		IsolationIsSerializable() ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return;
+
+	qualstr = nodeToString(child->ss.ps.plan->qual);
+	tliststr = nodeToString(child->ss.ps.plan->targetlist);
+	qualsize = strlen(qualstr) + 1;
+	tlistsize = strlen(tliststr) + 1;
+	sharedsize = add_size(offsetof(GatherShared, workers),
+						  mul_size(nworkers, sizeof(GatherWorker)));
+
+	/*
+	 * Create the shared segment, with the snapshot, the parallel heap scan,
+	 * the qual and target list, and one tuple queue per worker
+	 */
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	shm_toc_estimate_chunk(&e, EstimateSnapshotSpace(snapshot));
+	shm_toc_estimate_chunk(&e, heap_parallelscan_estimate());
+	shm_toc_estimate_chunk(&e, qualsize + tlistsize);
+	for (i = 0; i < nworkers; i++)
+		shm_toc_estimate_chunk(&e, PARALLEL_TUPLE_QUEUE_SIZE);
+	shm_toc_estimate_keys(&e, 4 + nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	seg = dsm_create(segsize);
+	toc = shm_toc_create(PARALLEL_GATHER_MAGIC, dsm_segment_address(seg),
+						 segsize);
+
+	shared = shm_toc_allocate(toc, sharedsize);
+	namestrcpy(&shared->dbname, get_database_name(MyDatabaseId));
+	namestrcpy(&shared->username, GetUserNameFromId(GetSessionUserId()));
+	GetUserIdAndSecContext(&shared->userid, &shared->sec_context);
+	shared->leaderprocno = MyProc->pgprocno;
+	shared->relid = RelationGetRelid(rel);
+	shared->nworkers = nworkers;
+	SpinLockInit(&shared->mutex);
+	shared->nclaimed = 0;
+	for (i = 0; i < nworkers; i++)
+	{
+		shared->workers[i].status = GATHER_WORKER_NOT_STARTED;
+		BackgroundWorkerInitError(&shared->workers[i].error);
+	}
+	shm_toc_insert(toc, PARALLEL_KEY_GATHER_SHARED, shared);
+
+	snapspace = shm_toc_allocate(toc, EstimateSnapshotSpace(snapshot));
+	SerializeSnapshot(snapshot, snapspace);
+	shm_toc_insert(toc, PARALLEL_KEY_SNAPSHOT, snapspace);
+
+	pscan = shm_toc_allocate(toc, heap_parallelscan_estimate());
+	heap_parallelscan_initialize(pscan, rel, PARALLEL_GATHER_SCAN_CHUNK);
+	shm_toc_insert(toc, PARALLEL_KEY_HEAP_SCAN, pscan);
+
+	planstr = shm_toc_allocate(toc, qualsize + tlistsize);
+	memcpy(planstr, qualstr, qualsize);
+	memcpy(planstr + qualsize, tliststr, tlistsize);
+	shm_toc_insert(toc, PARALLEL_KEY_PLAN, planstr);
+	pfree(qualstr);
+	pfree(tliststr);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_TUPLE_QUEUE_SIZE),
+						   PARALLEL_TUPLE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		shm_toc_insert(toc, PARALLEL_KEY_TUPLE_QUEUE + i, mq);
+	}
+
+	/*
+	 * Launch as many workers as we can get.  If we error out later on,
+	 * detaching from the segment terminates them.
+	 */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	pstate = palloc0(offsetof(ParallelGatherState, handles) +
+					 nworkers * sizeof(BackgroundWorkerHandle *));
+	pstate->seg = seg;
+	pstate->shared = shared;
+	on_dsm_detach(seg, gather_cleanup, PointerGetDatum(pstate));
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = gather_worker_main;
+	snprintf(worker.bgw_name, BGW_MAXLEN, "parallel worker for PID %d",
+			 MyProcPid);
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(seg));
+	/* set bgw_notify_pid, so we hear about workers that stop */
+	worker.bgw_notify_pid = MyProcPid;
+
+	for (i = 0; i < nworkers; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, &pstate->handles[i]))
+			break;
+		pstate->nworkers++;
+	}
+
+	if (pstate->nworkers == 0)
+	{
+		MemoryContextSwitchTo(oldcontext);
+		dsm_detach(seg);
+		pfree(pstate);
+		return;
+	}
+
+	pstate->nactive = pstate->nworkers;
+	pstate->mqs = (shm_mq **)
+		palloc(pstate->nworkers * sizeof(shm_mq *));
+	pstate->queues = (shm_mq_handle **)
+		palloc(pstate->nworkers * sizeof(shm_mq_handle *));
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < pstate->nworkers; i++)
+	{
+		pstate->mqs[i] = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE + i);
+		pstate->queues[i] = shm_mq_attach(pstate->mqs[i], seg, NULL);
+	}
+
+	node->pstate = pstate;
+	node->nworkers_launched = pstate->nworkers;
+	node->nextreader = 0;
+
+	/* Take part in the parallel scan ourselves */
+	ExecSeqScanInitializeParallel(child, pscan);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecGatherShutdownWorkers
+ *
+ *		Detach from the shared segment, which terminates any workers that
+ *		are still running.  Our copy of the subplan mustn't use the
+ *		parallel scan anymore.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecGatherShutdownWorkers(GatherState *node)
+{
+	ParallelGatherState *pstate = node->pstate;
+
+	if (pstate == NULL)
+		return;
+
+	/* The result slot may point into a tuple queue */
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	dsm_detach(pstate->seg);
+	pfree(pstate->mqs);
+	pfree(pstate->queues);
+	pfree(pstate);
+	node->pstate = NULL;
+}
+
+/*
+ * on_dsm_detach callback: terminate any workers still running.
+ */
+static void
+gather_cleanup(dsm_segment *seg, Datum arg)
+{
+	ParallelGatherState *pstate = (ParallelGatherState *) DatumGetPointer(arg);
+	int			i;
+
+	for (i = 0; i < pstate->nworkers; i++)
+		TerminateBackgroundWorker(pstate->handles[i]);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitGather
+ * ----------------------------------------------------------------
+ */
+GatherState *
+ExecInitGather(Gather *node, EState *estate, int eflags)
+{
+	GatherState *gatherstate;
+
+	/* Gather node doesn't support backward scan or mark/restore */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	gatherstate = makeNode(GatherState);
+	gatherstate->ps.plan = (Plan *) node;
+	gatherstate->ps.state = estate;
+	gatherstate->initialized = false;
+	gatherstate->child_done = false;
+	gatherstate->nworkers_launched = 0;
+	gatherstate->nextreader = 0;
+	gatherstate->pstate = NULL;
+
+	/*
+	 * Gather doesn't evaluate quals or project, so no ExprContext is needed.
+	 */
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &gatherstate->ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(gatherstate) = ExecInitNode(outerPlan(node), estate, eflags);
+	Assert(IsA(outerPlanState(gatherstate), SeqScanState));
+
+	/*
+	 * Initialize result tuple type; workers' tuples look like the subplan's.
+	 */
+	ExecAssignResultTypeFromTL(&gatherstate->ps);
+	gatherstate->ps.ps_ProjInfo = NULL;
+
+	return gatherstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndGather
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndGather(GatherState *node)
+{
+	/*
+	 * shut down the subplan first; it may be using the parallel scan in
+	 * shared memory
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	ExecGatherShutdownWorkers(node);
+
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanGather
+ *
+ *		The workers can't be restarted, so we shut them down and launch
+ *		new ones on the next call to ExecGather.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanGather(GatherState *node)
+{
+	if (node->pstate != NULL)
+	{
+		ExecSeqScanInitializeParallel((SeqScanState *) outerPlanState(node),
+									  NULL);
+		ExecGatherShutdownWorkers(node);
+	}
+
+	node->initialized = false;
+	node->child_done = false;
+	ExecClearTuple(node->ps.ps_ResultTupleSlot);
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (node->ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ps.lefttree);
+}
+
+/*
+ * Main entry point of a parallel worker.
+ *
+ * The worker scans the heap blocks the parallel heap scan hands to it, and
+ * sends the tuples that pass the subplan's qual, projected, to the leader
+ * through its tuple queue.
+ */
+static void
+gather_worker_main(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	GatherShared *shared;
+	volatile GatherShared *vshared;
+	int			workernum;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+
+	/* We can be terminated by the leader if it is done, or errors out */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Attach to the leader's shared segment */
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "parallel worker");
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_GATHER_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			   errmsg("bad magic number in dynamic shared memory segment")));
+	shared = shm_toc_lookup(toc, PARALLEL_KEY_GATHER_SHARED);
+	vshared = shared;
+
+	SpinLockAcquire(&vshared->mutex);
+	workernum = vshared->nclaimed++;
+	SpinLockRelease(&vshared->mutex);
+	Assert(workernum < shared->nworkers);
+
+	mq = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE + workernum);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* From here on, the leader reports our errors */
+	PG_TRY();
+	{
+		gather_worker_scan(toc, shared, workernum, mqh);
+	}
+	PG_CATCH();
+	{
+		BackgroundWorkerSaveError(&shared->workers[workernum].error);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	dsm_detach(seg);
+	proc_exit(0);
+}
+
+/*
+ * Do a parallel worker's share of the scan.
+ */
+static void
+gather_worker_scan(shm_toc *toc, GatherShared *shared, int workernum,
+				   shm_mq_handle *mqh)
+{
+	volatile GatherShared *vshared = shared;
+	ParallelHeapScanDesc pscan;
+	Snapshot	snapshot;
+	PGPROC	   *leader;
+	char	   *planstr;
+	List	   *qual;
+	List	   *targetlist;
+	Relation	rel;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+	ExprContext *econtext;
+	TupleTableSlot *scanslot;
+	ProjectionInfo *projinfo;
+	bool		finished = true;
+
+	BackgroundWorkerInitializeConnection(NameStr(shared->dbname),
+										 NameStr(shared->username));
+	SetUserIdAndSecContext(shared->userid, shared->sec_context);
+
+	StartTransactionCommand();
+
+	/*
+	 * Scan with the leader's snapshot.  The leader keeps it registered, and
+	 * so its xmin in place, until we're done.
+	 */
+	snapshot = RestoreSnapshot(shm_toc_lookup(toc, PARALLEL_KEY_SNAPSHOT));
+	leader = &ProcGlobal->allProcs[shared->leaderprocno];
+	if (!ProcArrayInstallRestoredXmin(snapshot->xmin, leader))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not use the snapshot of the parallel leader")));
+	PushActiveSnapshot(snapshot);
+
+	/*
+	 * The leader holds a lock on the relation until we're done, so we don't
+	 * take one; that could only deadlock against whoever waits for the
+	 * leader's.
+	 */
+	rel = heap_open(shared->relid, NoLock);
+
+	/* Rebuild the subplan's qual and target list */
+	planstr = shm_toc_lookup(toc, PARALLEL_KEY_PLAN);
+	qual = (List *) stringToNode(planstr);
+	targetlist = (List *) stringToNode(planstr + strlen(planstr) + 1);
+	fix_opfuncids((Node *) qual);
+	fix_opfuncids((Node *) targetlist);
+
+	econtext = CreateStandaloneExprContext();
+	scanslot = MakeSingleTupleTableSlot(RelationGetDescr(rel));
+	econtext->ecxt_scantuple = scanslot;
+	projinfo = ExecBuildProjectionInfo((List *) ExecInitExpr((Expr *) targetlist,
+															 NULL),
+									   econtext,
+						MakeSingleTupleTableSlot(ExecTypeFromTL(targetlist,
+																false)),
+									   RelationGetDescr(rel));
+	qual = (List *) ExecInitExpr((Expr *) qual, NULL);
+
+	SpinLockAcquire(&vshared->mutex);
+	vshared->workers[workernum].status = GATHER_WORKER_SCANNING;
+	SpinLockRelease(&vshared->mutex);
+
+	pscan = shm_toc_lookup(toc, PARALLEL_KEY_HEAP_SCAN);
+	scan = heap_beginscan_parallel(rel, pscan, snapshot, 0, NULL);
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		TupleTableSlot *resultslot;
+		ExprDoneCond isDone;
+		HeapTuple	result;
+
+		CHECK_FOR_INTERRUPTS();
+
+		ResetExprContext(econtext);
+		ExecStoreTuple(tuple, scanslot, scan->rs_cbuf, false);
+		if (!ExecQual(qual, econtext, false))
+			continue;
+
+		resultslot = ExecProject(projinfo, &isDone);
+		result = ExecMaterializeSlot(resultslot);
+
+		/* if the leader has gone away, it doesn't need the rest */
+		if (shm_mq_send(mqh, result->t_len, result->t_data, false) !=
+			SHM_MQ_SUCCESS)
+		{
+			finished = false;
+			break;
+		}
+	}
+	ExecClearTuple(scanslot);
+	heap_endscan(scan);
+
+	if (finished)
+	{
+		SpinLockAcquire(&vshared->mutex);
+		vshared->workers[workernum].status = GATHER_WORKER_DONE;
+		SpinLockRelease(&vshared->mutex);
+	}
+
+	ExecDropSingleTupleTableSlot(scanslot);
+	FreeExprContext(econtext, true);
+	heap_close(rel, NoLock);
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+}
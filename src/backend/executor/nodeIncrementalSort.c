@@ -0,0 +1,351 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecIncrementalSort		- return the next tuple in sorted order
+ *		ExecInitIncrementalSort - initialize node and subnodes
+ *		ExecEndIncrementalSort	- shutdown node and subnodes
+ *
+ * NOTES
+ *		The input is already sorted on the first presortedCols sort keys.
+ *		Tuples that are equal on those columns form a group; each group is
+ *		sorted on the remaining keys on its own and returned before the next
+ *		one is read.  That needs much less memory than sorting all the input
+ *		at once, and lets the first tuples come out after reading only the
+ *		first group, which matters a lot under a LIMIT.
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/executor.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Reads the next group of tuples with equal presorted columns from
+ *		the outer subtree, sorts it using tuplesort, and returns its tuples
+ *		one per call.  When the group is exhausted, moves on to the next.
+ *
+ *		The first tuple of each group after the first is only seen when
+ *		reading the previous group; it is kept in group_pivot until the
+ *		group it belongs to is started.
+ *
+ *		Conditions:
+ *		  -- none.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+TupleTableSlot *
+ExecIncrementalSort(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	int			presortedCols = plannode->presortedCols;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		PlanState  *outerNode;
+		TupleDesc	tupDesc;
+
+		/*
+		 * If we have a sorted group, return its next tuple.
+		 */
+		if (node->sort_Done)
+		{
+			tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+			slot = node->ss.ps.ps_ResultTupleSlot;
+			if (tuplesort_gettupleslot(tuplesortstate, true, slot))
+			{
+				node->ntuples++;
+				return slot;
+			}
+
+			/* The group is done, get rid of it */
+			tuplesort_end(tuplesortstate);
+			node->tuplesortstate = NULL;
+			node->sort_Done = false;
+		}
+
+		/*
+		 * Nothing more to do if the input is exhausted and there's no leftover
+		 * tuple to start another group with.
+		 */
+		if (node->finished && !node->pivot_pending)
+		{
+			ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+			return NULL;
+		}
+
+		SO1_printf("ExecIncrementalSort: %s\n",
+				   "sorting next group");
+
+		outerNode = outerPlanState(node);
+		tupDesc = ExecGetResultType(outerNode);
+
+		/*
+		 * Start a new tuplesort for the group.  The tuples all agree on the
+		 * presorted columns, so only the remaining ones need to be compared.
+		 */
+		tuplesortstate = tuplesort_begin_heap(tupDesc,
+										plannode->sort.numCols - presortedCols,
+								  &plannode->sort.sortColIdx[presortedCols],
+							   &plannode->sort.sortOperators[presortedCols],
+								  &plannode->sort.collations[presortedCols],
+								   &plannode->sort.nullsFirst[presortedCols],
+											  work_mem,
+											  false);
+		if (node->bounded && node->bound > node->ntuples)
+			tuplesort_set_bound(tuplesortstate,
+								node->bound - node->ntuples);
+		node->tuplesortstate = (void *) tuplesortstate;
+
+		/*
+		 * The group starts with the tuple left over from the previous one, or
+		 * else with the very first tuple of the input.
+		 */
+		if (node->pivot_pending)
+		{
+			tuplesort_puttupleslot(tuplesortstate, node->group_pivot);
+			node->pivot_pending = false;
+		}
+		else
+		{
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+			{
+				node->finished = true;
+				continue;
+			}
+			tuplesort_puttupleslot(tuplesortstate, slot);
+			ExecCopySlot(node->group_pivot, slot);
+		}
+
+		/*
+		 * Add tuples to the group until one differs from its first tuple in
+		 * the presorted columns; that one is the start of the next group.
+		 */
+		for (;;)
+		{
+			slot = ExecProcNode(outerNode);
+
+			if (TupIsNull(slot))
+			{
+				node->finished = true;
+				break;
+			}
+
+			if (!execTuplesMatch(slot, node->group_pivot,
+								 presortedCols,
+								 plannode->sort.sortColIdx,
+								 node->eqfunctions,
+								 node->tempContext))
+			{
+				ExecCopySlot(node->group_pivot, slot);
+				node->pivot_pending = true;
+				break;
+			}
+
+			tuplesort_puttupleslot(tuplesortstate, slot);
+		}
+
+		/*
+		 * Complete the sort of the group, and go return its tuples.
+		 */
+		tuplesort_performsort(tuplesortstate);
+		node->sort_Done = true;
+		node->ngroups++;
+		SO1_printf("ExecIncrementalSort: %s\n", "group sorted");
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	Oid		   *eqOperators;
+	int			i;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing sort node");
+
+	/*
+	 * We hold only the current group in memory, so we can't support
+	 * EXEC_FLAG_BACKWARD or EXEC_FLAG_MARK.  Rewinding is done by reading
+	 * the input again.
+	 */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+	Assert(node->presortedCols > 0 &&
+		   node->presortedCols < node->sort.numCols);
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+
+	incrsortstate->bounded = false;
+	incrsortstate->ntuples = 0;
+	incrsortstate->sort_Done = false;
+	incrsortstate->finished = false;
+	incrsortstate->pivot_pending = false;
+	incrsortstate->ngroups = 0;
+	incrsortstate->tuplesortstate = NULL;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * Incremental sort nodes don't initialize their ExprContexts because
+	 * they never call ExecQual or ExecProject.  But they do need a per-tuple
+	 * memory context for calling execTuplesMatch.
+	 */
+	incrsortstate->tempContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "IncrementalSort",
+							  ALLOCSET_DEFAULT_MINSIZE,
+							  ALLOCSET_DEFAULT_INITSIZE,
+							  ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * tuple table initialization
+	 *
+	 * incremental sort nodes only return scan tuples from their sorted
+	 * relation; they also keep a copy of the first tuple of a group.
+	 */
+	ExecInitResultTupleSlot(estate, &incrsortstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &incrsortstate->ss);
+	incrsortstate->group_pivot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We shield the child node from the need to support REWIND, BACKWARD, or
+	 * MARK/RESTORE.
+	 */
+	eflags &= ~(EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK);
+
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&incrsortstate->ss.ps);
+	ExecAssignScanTypeFromOuterPlan(&incrsortstate->ss);
+	ExecSetSlotDescriptor(incrsortstate->group_pivot,
+						  ExecGetResultType(outerPlanState(incrsortstate)));
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Precompute fmgr lookup data for detecting group boundaries.  The
+	 * equality operators are the ones matching the sort operators.
+	 */
+	eqOperators = (Oid *) palloc(node->presortedCols * sizeof(Oid));
+	for (i = 0; i < node->presortedCols; i++)
+	{
+		eqOperators[i] = get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+														 NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "could not find equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+	incrsortstate->eqfunctions = execTuplesMatchPrepare(node->presortedCols,
+														eqOperators);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down sort node");
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	MemoryContextDelete(node->tempContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	/*
+	 * We only ever hold one group, so there's nothing to rewind; forget
+	 * everything and start over from the beginning of the input.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	node->ntuples = 0;
+	node->sort_Done = false;
+	node->finished = false;
+	node->pivot_pending = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (node->ss.ps.lefttree->chgParam == NULL)
+		ExecReScan(node->ss.ps.lefttree);
+}
@@ -157,12 +157,18 @@ ExecProcessReturning(ProjectionInfo *projectReturning,
  *		For INSERT, we have to insert the tuple into the target relation
  *		and insert appropriate tuples into the index relations.
  *
+ *		If the target relation is partitioned, routing is its
+ *		PartitionRoutingState, and the tuple goes into the partition
+ *		that accepts it.  es_result_relation_info is then left pointing
+ *		at that partition; the caller must reset it.
+ *
  *		Returns RETURNING result if any, otherwise NULL.
  * ----------------------------------------------------------------
  */
 static TupleTableSlot *
 ExecInsert(TupleTableSlot *slot,
 		   TupleTableSlot *planSlot,
+		   PartitionRoutingState *routing,
 		   EState *estate,
 		   bool canSetTag)
 {
@@ -182,6 +188,17 @@ ExecInsert(TupleTableSlot *slot,
 	 * get information on the (current) result relation
 	 */
 	resultRelInfo = estate->es_result_relation_info;
+
+	/*
+	 * Route the tuple to its partition, if the target is partitioned.  From
+	 * here on, it's the partition that we're inserting into.
+	 */
+	if (routing != NULL)
+	{
+		resultRelInfo = ExecFindPartition(routing, &slot, estate);
+		estate->es_result_relation_info = resultRelInfo;
+		tuple = ExecMaterializeSlot(slot);
+	}
 	resultRelationDesc = resultRelInfo->ri_RelationDesc;
 
 	/*
@@ -287,6 +304,18 @@ ExecInsert(TupleTableSlot *slot,
 
 	list_free(recheckIndexes);
 
+	/*
+	 * WITH CHECK OPTIONs and RETURNING belong to the partitioned table, so
+	 * give them the tuple in its row type.
+	 */
+	if (routing != NULL)
+	{
+		resultRelInfo = routing->rootResultRelInfo;
+		if (resultRelInfo->ri_WithCheckOptions != NIL ||
+			resultRelInfo->ri_projectReturning)
+			slot = ExecPartitionTupleToParent(routing, slot);
+	}
+
 	/* Check any WITH CHECK OPTION constraints */
 	if (resultRelInfo->ri_WithCheckOptions != NIL)
 		ExecWithCheckOptions(resultRelInfo, slot, estate);
@@ -1021,7 +1050,10 @@ ExecModifyTable(ModifyTableState *node)
 		switch (operation)
 		{
 			case CMD_INSERT:
-				slot = ExecInsert(slot, planSlot, estate, node->canSetTag);
+				slot = ExecInsert(slot, planSlot, node->mt_partrouting,
+								  estate, node->canSetTag);
+				/* undo the switch to a partition, if any */
+				estate->es_result_relation_info = resultRelInfo;
 				break;
 			case CMD_UPDATE:
 				slot = ExecUpdate(tupleid, oldtuple, slot, planSlot,
@@ -1159,6 +1191,14 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 
 	estate->es_result_relation_info = saved_resultRelInfo;
 
+	/*
+	 * If inserting into a partitioned table, set up for routing the tuples to
+	 * its partitions.
+	 */
+	if (operation == CMD_INSERT)
+		mtstate->mt_partrouting =
+			ExecSetupPartitionRouting(estate, mtstate->resultRelInfo);
+
 	/*
 	 * Initialize any WITH CHECK OPTION constraints if needed.
 	 */
@@ -21,16 +21,21 @@
  *		ExecReScanSeqScan		rescans the relation
  *		ExecSeqMarkPos			marks scan position
  *		ExecSeqRestrPos			restores scan position
+ *		ExecSeqScanInitializeParallel	joins or leaves a parallel scan
  */
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "executor/execBatch.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
 static void InitScanRelation(SeqScanState *node, EState *estate, int eflags);
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static TupleTableSlot *SeqNextBatch(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -52,13 +57,16 @@ SeqNext(SeqScanState *node)
 	ScanDirection direction;
 	TupleTableSlot *slot;
 
+	if (node->batch != NULL)
+		return SeqNextBatch(node);
+
 	/*
 	 * get information from the estate and scan state
 	 */
-	scandesc = node->ss_currentScanDesc;
-	estate = node->ps.state;
+	scandesc = node->ss.ss_currentScanDesc;
+	estate = node->ss.ps.state;
 	direction = estate->es_direction;
-	slot = node->ss_ScanTupleSlot;
+	slot = node->ss.ss_ScanTupleSlot;
 
 	/*
 	 * get the next tuple from the table
@@ -85,17 +93,84 @@ SeqNext(SeqScanState *node)
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		SeqNextBatch
+ *
+ *		Variant of SeqNext used when some of the quals are evaluated
+ *		in batches.  We fetch all the visible tuples of a page at once,
+ *		run the batch quals over them, and then hand out the tuples that
+ *		passed one at a time.  The remaining quals, if any, are checked
+ *		by ExecScan as usual.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+SeqNextBatch(SeqScanState *node)
+{
+	ScanBatch  *batch = node->batch;
+	HeapScanDesc scandesc = node->ss.ss_currentScanDesc;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	while (batch->next >= batch->nselected)
+	{
+		int			ntuples;
+
+		/*
+		 * The slot may point at one of the batch's tuples; clear it before
+		 * we overwrite them, and release the pin on the old page.
+		 */
+		ExecClearTuple(slot);
+
+		ntuples = heap_getnextbatch(scandesc, batch->tuples);
+		if (ntuples == 0)
+		{
+			ExecScanBatchReset(batch);
+			return slot;
+		}
+
+		ExecScanBatchQual(batch, ntuples);
+
+		/* count the tuples the batch quals removed, as ExecScan would */
+		InstrCountFiltered1(node, batch->ntuples - batch->nselected);
+
+		/* a long run of non-qualifying pages shouldn't block interrupts */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	ExecStoreTuple(&batch->tuples[batch->sel[batch->next++]],
+				   slot,
+				   scandesc->rs_cbuf,
+				   false);
+
+	return slot;
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
 static bool
 SeqRecheck(SeqScanState *node, TupleTableSlot *slot)
 {
+	ExprContext *econtext;
+
 	/*
 	 * Note that unlike IndexScan, SeqScan never use keys in heap_beginscan
 	 * (and this is very bad) - so, here we do not check are keys ok or not.
+	 * But if some of the quals are evaluated in batches, they're not part of
+	 * ps.qual, so we have to check them here.
 	 */
-	return true;
+	if (node->batchqualorig == NIL)
+		return true;
+
+	econtext = node->ss.ps.ps_ExprContext;
+
+	/* Does the tuple meet the batch-evaluated quals? */
+	econtext->ecxt_scantuple = slot;
+
+	ResetExprContext(econtext);
+
+	return ExecQual(node->batchqualorig, econtext, false);
 }
 
 /* ----------------------------------------------------------------
@@ -110,7 +185,7 @@ SeqRecheck(SeqScanState *node, TupleTableSlot *slot)
 TupleTableSlot *
 ExecSeqScan(SeqScanState *node)
 {
-	return ExecScan((ScanState *) node,
+	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) SeqNext,
 					(ExecScanRecheckMtd) SeqRecheck);
 }
@@ -132,7 +207,7 @@ InitScanRelation(SeqScanState *node, EState *estate, int eflags)
 	 * open that relation and acquire appropriate lock on it.
 	 */
 	currentRelation = ExecOpenScanRelation(estate,
-									  ((SeqScan *) node->ps.plan)->scanrelid,
+								   ((SeqScan *) node->ss.ps.plan)->scanrelid,
 										   eflags);
 
 	/* initialize a heapscan */
@@ -141,11 +216,11 @@ InitScanRelation(SeqScanState *node, EState *estate, int eflags)
 									 0,
 									 NULL);
 
-	node->ss_currentRelation = currentRelation;
-	node->ss_currentScanDesc = currentScanDesc;
+	node->ss.ss_currentRelation = currentRelation;
+	node->ss.ss_currentScanDesc = currentScanDesc;
 
 	/* and report the scan tuple slot's rowtype */
-	ExecAssignScanType(node, RelationGetDescr(currentRelation));
+	ExecAssignScanType(&node->ss, RelationGetDescr(currentRelation));
 }
 
 
@@ -169,44 +244,72 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 * create state structure
 	 */
 	scanstate = makeNode(SeqScanState);
-	scanstate->ps.plan = (Plan *) node;
-	scanstate->ps.state = estate;
+	scanstate->ss.ps.plan = (Plan *) node;
+	scanstate->ss.ps.state = estate;
 
 	/*
 	 * Miscellaneous initialization
 	 *
 	 * create expression context for node
 	 */
-	ExecAssignExprContext(estate, &scanstate->ps);
-
-	/*
-	 * initialize child expressions
-	 */
-	scanstate->ps.targetlist = (List *)
-		ExecInitExpr((Expr *) node->plan.targetlist,
-					 (PlanState *) scanstate);
-	scanstate->ps.qual = (List *)
-		ExecInitExpr((Expr *) node->plan.qual,
-					 (PlanState *) scanstate);
+	ExecAssignExprContext(estate, &scanstate->ss.ps);
 
 	/*
 	 * tuple table initialization
 	 */
-	ExecInitResultTupleSlot(estate, &scanstate->ps);
-	ExecInitScanTupleSlot(estate, scanstate);
+	ExecInitResultTupleSlot(estate, &scanstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &scanstate->ss);
 
 	/*
 	 * initialize scan relation
 	 */
 	InitScanRelation(scanstate, estate, eflags);
 
-	scanstate->ps.ps_TupFromTlist = false;
+	/*
+	 * Decide whether some of the quals can be evaluated in batches.  That
+	 * requires reading the table a page at a time in forward direction, so
+	 * it's not possible if the scan might have to run backwards or restore
+	 * a marked position.
+	 */
+	if (scanstate->ss.ss_currentScanDesc->rs_pageatatime &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)))
+	{
+		List	   *batchqual;
+		List	   *otherqual;
+
+		scanstate->batch =
+			ExecInitScanBatch(node->plan.qual, node->scanrelid,
+						RelationGetDescr(scanstate->ss.ss_currentRelation),
+							  &batchqual, &otherqual);
+		if (scanstate->batch != NULL)
+		{
+			scanstate->batchqualorig = (List *)
+				ExecInitExpr((Expr *) batchqual,
+							 (PlanState *) scanstate);
+			scanstate->ss.ps.qual = (List *)
+				ExecInitExpr((Expr *) otherqual,
+							 (PlanState *) scanstate);
+		}
+	}
+
+	/*
+	 * initialize child expressions
+	 */
+	scanstate->ss.ps.targetlist = (List *)
+		ExecInitExpr((Expr *) node->plan.targetlist,
+					 (PlanState *) scanstate);
+	if (scanstate->batch == NULL)
+		scanstate->ss.ps.qual = (List *)
+			ExecInitExpr((Expr *) node->plan.qual,
+						 (PlanState *) scanstate);
+
+	scanstate->ss.ps.ps_TupFromTlist = false;
 
 	/*
 	 * Initialize result tuple type and projection info.
 	 */
-	ExecAssignResultTypeFromTL(&scanstate->ps);
-	ExecAssignScanProjectionInfo(scanstate);
+	ExecAssignResultTypeFromTL(&scanstate->ss.ps);
+	ExecAssignScanProjectionInfo(&scanstate->ss);
 
 	return scanstate;
 }
@@ -226,19 +329,19 @@ ExecEndSeqScan(SeqScanState *node)
 	/*
 	 * get information from node
 	 */
-	relation = node->ss_currentRelation;
-	scanDesc = node->ss_currentScanDesc;
+	relation = node->ss.ss_currentRelation;
+	scanDesc = node->ss.ss_currentScanDesc;
 
 	/*
 	 * Free the exprcontext
 	 */
-	ExecFreeExprContext(&node->ps);
+	ExecFreeExprContext(&node->ss.ps);
 
 	/*
 	 * clean out the tuple table
 	 */
-	ExecClearTuple(node->ps.ps_ResultTupleSlot);
-	ExecClearTuple(node->ss_ScanTupleSlot);
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
 	/*
 	 * close heap scan
@@ -267,12 +370,15 @@ ExecReScanSeqScan(SeqScanState *node)
 {
 	HeapScanDesc scan;
 
-	scan = node->ss_currentScanDesc;
+	scan = node->ss.ss_currentScanDesc;
 
 	heap_rescan(scan,			/* scan desc */
 				NULL);			/* new scan keys */
 
-	ExecScanReScan((ScanState *) node);
+	if (node->batch != NULL)
+		ExecScanBatchReset(node->batch);
+
+	ExecScanReScan(&node->ss);
 }
 
 /* ----------------------------------------------------------------
@@ -284,7 +390,9 @@ ExecReScanSeqScan(SeqScanState *node)
 void
 ExecSeqMarkPos(SeqScanState *node)
 {
-	HeapScanDesc scan = node->ss_currentScanDesc;
+	HeapScanDesc scan = node->ss.ss_currentScanDesc;
+
+	Assert(node->batch == NULL);
 
 	heap_markpos(scan);
 }
@@ -298,7 +406,9 @@ ExecSeqMarkPos(SeqScanState *node)
 void
 ExecSeqRestrPos(SeqScanState *node)
 {
-	HeapScanDesc scan = node->ss_currentScanDesc;
+	HeapScanDesc scan = node->ss.ss_currentScanDesc;
+
+	Assert(node->batch == NULL);
 
 	/*
 	 * Clear any reference to the previously returned tuple.  This is needed
@@ -306,7 +416,39 @@ ExecSeqRestrPos(SeqScanState *node)
 	 * heap_restrpos will change; we'd have an internally inconsistent slot if
 	 * we didn't do this.
 	 */
-	ExecClearTuple(node->ss_ScanTupleSlot);
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
 	heap_restrpos(scan);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitializeParallel
+ *
+ *		Make the scan take part in the given parallel heap scan, so that
+ *		it only visits the blocks the parallel scan hands to it; or, if
+ *		pscan is NULL, go back to scanning the whole relation.  Used by
+ *		Gather, before the first fetch or after a rescan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanInitializeParallel(SeqScanState *node, ParallelHeapScanDesc pscan)
+{
+	EState	   *estate = node->ss.ps.state;
+	Relation	relation = node->ss.ss_currentRelation;
+
+	/* the scan slot and the batch may point into the old scan's storage */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	if (node->batch != NULL)
+		ExecScanBatchReset(node->batch);
+
+	heap_endscan(node->ss.ss_currentScanDesc);
+
+	if (pscan != NULL)
+		node->ss.ss_currentScanDesc = heap_beginscan_parallel(relation, pscan,
+														estate->es_snapshot,
+															  0, NULL);
+	else
+		node->ss.ss_currentScanDesc = heap_beginscan(relation,
+													 estate->es_snapshot,
+													 0, NULL);
+}
@@ -17,8 +17,10 @@
 
 #include <math.h>
 
+#include "access/xact.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
 #include "foreign/fdwapi.h"
 #include "nodes/nodeFuncs.h"
 #ifdef OPTIMIZER_DEBUG
@@ -43,6 +45,7 @@
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			min_parallel_relation_size;
 
 /* Hook for plugins to replace standard_join_search() */
 join_search_hook_type join_search_hook = NULL;
@@ -58,6 +61,10 @@ static void set_plain_rel_size(PlannerInfo *root, RelOptInfo *rel,
 				   RangeTblEntry *rte);
 static void set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					   RangeTblEntry *rte);
+static void create_gather_paths(PlannerInfo *root, RelOptInfo *rel,
+					RangeTblEntry *rte);
+static bool parallel_unsafe_expr(Node *node);
+static bool parallel_unsafe_walker(Node *node, void *context);
 static void set_foreign_size(PlannerInfo *root, RelOptInfo *rel,
 				 RangeTblEntry *rte);
 static void set_foreign_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -383,6 +390,10 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	/* Consider sequential scan */
 	add_path(rel, create_seqscan_path(root, rel, required_outer));
 
+	/* Consider running a sequential scan in parallel */
+	if (required_outer == NULL)
+		create_gather_paths(root, rel, rte);
+
 	/* Consider index scans */
 	create_index_paths(root, rel);
 
@@ -393,6 +404,109 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	set_cheapest(rel);
 }
 
+/*
+ * create_gather_paths
+ *	  Build a path that runs a sequential scan of a plain relation in
+ *	  parallel, if that's possible and the relation is large enough
+ */
+static void
+create_gather_paths(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	Query	   *parse = root->parse;
+	int			parallel_threshold;
+	int			parallel_workers;
+	ListCell   *lc;
+
+	/*
+	 * Workers can't see any changes made by the query, nor take part in a
+	 * serializable transaction; nodeGather.c checks the same at execution
+	 * time, when it also looks at whether the transaction has made changes
+	 * of its own.  They can't read temporary tables, which live in our
+	 * local buffers.
+	 */
+	if (max_parallel_workers_per_gather <= 0 ||
+		parse->commandType != CMD_SELECT ||
+		parse->rowMarks != NIL ||
+		parse->hasModifyingCTE ||
+		IsolationIsSerializable() ||
+		rte->relkind != RELKIND_RELATION ||
+		get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+		return;
+
+	/*
+	 * The workers evaluate the scan's quals and target list themselves, so
+	 * those must give the same results in a worker, and be passable to it.
+	 */
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		/* a gating qual would put a Result between Gather and the scan */
+		if (rinfo->pseudoconstant ||
+			parallel_unsafe_expr((Node *) rinfo->clause))
+			return;
+	}
+	if (parallel_unsafe_expr((Node *) rel->reltargetlist))
+		return;
+
+	/*
+	 * Use one worker for relations of at least min_parallel_relation_size
+	 * pages, and one more each time the size triples.
+	 */
+	if (rel->pages < (BlockNumber) min_parallel_relation_size)
+		return;
+	parallel_threshold = Max(min_parallel_relation_size, 1);
+	parallel_workers = 1;
+	while (rel->pages >= (BlockNumber) parallel_threshold * 3)
+	{
+		parallel_workers++;
+		parallel_threshold *= 3;
+		if (parallel_threshold > INT_MAX / 3)
+			break;				/* avoid overflow */
+	}
+	parallel_workers = Min(parallel_workers, max_parallel_workers_per_gather);
+
+	add_path(rel, (Path *)
+			 create_gather_path(root, rel,
+								create_seqscan_path(root, rel, NULL),
+								parallel_workers));
+}
+
+/*
+ * Check whether an expression is unsafe for a parallel worker to evaluate:
+ * whether it calls a function that isn't immutable, or contains something
+ * a worker couldn't rebuild from the expression's nodeToString form, such
+ * as a parameter or a subplan.  Anonymous record types are backend-local,
+ * so a worker mustn't build values of them either.
+ */
+static bool
+parallel_unsafe_expr(Node *node)
+{
+	if (contain_mutable_functions(node))
+		return true;
+	return parallel_unsafe_walker(node, NULL);
+}
+
+static bool
+parallel_unsafe_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param) ||
+		IsA(node, SubLink) ||
+		IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan) ||
+		IsA(node, Aggref) ||
+		IsA(node, WindowFunc) ||
+		IsA(node, CurrentOfExpr) ||
+		IsA(node, PlaceHolderVar))
+		return true;
+	if (IsA(node, RowExpr) &&
+		((RowExpr *) node)->row_typeid == RECORDOID)
+		return true;
+	return expression_tree_walker(node, parallel_unsafe_walker, context);
+}
+
 /*
  * set_foreign_size
  *		Set size estimates for a foreign table RTE
@@ -2115,6 +2229,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Material";
 			subpath = ((MaterialPath *) path)->subpath;
 			break;
+		case T_GatherPath:
+			ptype = "Gather";
+			subpath = ((GatherPath *) path)->subpath;
+			break;
 		case T_UniquePath:
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
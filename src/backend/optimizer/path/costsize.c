@@ -76,6 +76,7 @@
 
 #include "access/htup_details.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -103,17 +104,22 @@ double		random_page_cost = DEFAULT_RANDOM_PAGE_COST;
 double		cpu_tuple_cost = DEFAULT_CPU_TUPLE_COST;
 double		cpu_index_tuple_cost = DEFAULT_CPU_INDEX_TUPLE_COST;
 double		cpu_operator_cost = DEFAULT_CPU_OPERATOR_COST;
+double		parallel_tuple_cost = DEFAULT_PARALLEL_TUPLE_COST;
+double		parallel_setup_cost = DEFAULT_PARALLEL_SETUP_COST;
 
 int			effective_cache_size = -1;	/* will get replaced */
 
 Cost		disable_cost = 1.0e10;
 
+int			max_parallel_workers_per_gather = 0;
+
 bool		enable_seqscan = true;
 bool		enable_indexscan = true;
 bool		enable_indexonlyscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
@@ -858,6 +864,54 @@ cost_bitmap_or_node(BitmapOrPath *path, PlannerInfo *root)
 	path->path.total_cost = totalCost;
 }
 
+/*
+ * cost_gather
+ *	  Determines and returns the cost of a sequential scan run in parallel
+ *	  by a Gather node.
+ *
+ * The workers and the backend itself each scan part of the relation, so
+ * the CPU cost of the scan is divided among them.  The backend also has to
+ * read the workers' tuples, which leaves it less time for scanning the
+ * more workers there are; we assume each worker takes 30% of its time.
+ * The I/O cost is not divided, since the participants read from the same
+ * disks.  Launching the workers costs parallel_setup_cost, and passing a
+ * tuple from a worker to the backend parallel_tuple_cost.
+ */
+void
+cost_gather(GatherPath *path, PlannerInfo *root, RelOptInfo *baserel)
+{
+	Path	   *subpath = path->subpath;
+	double		spc_seq_page_cost;
+	Cost		disk_run_cost;
+	Cost		cpu_run_cost;
+	double		parallel_divisor;
+	double		leader_share;
+
+	/* Should only be applied to base relations */
+	Assert(baserel->relid > 0);
+	Assert(baserel->rtekind == RTE_RELATION);
+	Assert(path->num_workers > 0);
+
+	path->path.rows = subpath->rows;
+
+	/* separate the subpath's run cost into disk and CPU costs */
+	get_tablespace_page_costs(baserel->reltablespace,
+							  NULL,
+							  &spc_seq_page_cost);
+	disk_run_cost = spc_seq_page_cost * baserel->pages;
+	cpu_run_cost = subpath->total_cost - subpath->startup_cost - disk_run_cost;
+
+	parallel_divisor = path->num_workers;
+	leader_share = 1.0 - 0.3 * path->num_workers;
+	if (leader_share > 0)
+		parallel_divisor += leader_share;
+
+	path->path.startup_cost = subpath->startup_cost + parallel_setup_cost;
+	path->path.total_cost = path->path.startup_cost + disk_run_cost +
+		cpu_run_cost / parallel_divisor +
+		parallel_tuple_cost * path->path.rows;
+}
+
 /*
  * cost_tidscan
  *	  Determines and returns the cost of scanning a relation using TIDs.
@@ -1335,6 +1389,101 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of sorting a relation whose input is
+ *	  already sorted by the first 'presorted_keys' of 'pathkeys'.
+ *
+ * The input is split into groups of tuples that are equal on the presorted
+ * keys, and each group is sorted on its own.  We estimate the number of
+ * groups from the presorted key expressions, and charge for sorting each
+ * group with cost_sort; that also accounts for a group outgrowing sort_mem.
+ *
+ * Unlike a full sort, the first output tuple is available as soon as the
+ * first group has been read and sorted, so startup cost includes only that
+ * share of the input.  On top of the group sorts, every input tuple has to
+ * be compared with the first tuple of its group on the presorted keys.
+ *
+ * The other arguments are as for cost_sort, except that the input cost is
+ * given as startup and total cost.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double tuples, int width, Cost comparison_cost,
+					  int sort_mem, double limit_tuples)
+{
+	Cost		startup_cost;
+	Cost		run_cost;
+	Cost		input_run_cost = input_total_cost - input_startup_cost;
+	List	   *presortedExprs = NIL;
+	ListCell   *l;
+	int			i = 0;
+	double		num_groups;
+	double		group_tuples;
+	Path		group_path;		/* dummy for result of cost_sort */
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	/*
+	 * We want to be sure the cost of a sort is never estimated as zero, even
+	 * if passed-in tuple count is zero.
+	 */
+	if (tuples < 2.0)
+		tuples = 2.0;
+
+	/* Collect an expression for each presorted key to estimate groups */
+	foreach(l, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(l);
+		EquivalenceMember *member = (EquivalenceMember *)
+		linitial(key->pk_eclass->ec_members);
+
+		presortedExprs = lappend(presortedExprs, member->em_expr);
+
+		if (++i >= presorted_keys)
+			break;
+	}
+
+	num_groups = estimate_num_groups(root, presortedExprs, tuples);
+	num_groups = clamp_row_est(Min(num_groups, tuples));
+	group_tuples = tuples / num_groups;
+
+	/*
+	 * Cost one group's sort.  The input cost is accounted for separately, so
+	 * pass zero.  A LIMIT smaller than a group can only help the first one,
+	 * but then we never get to the later groups anyway.
+	 */
+	cost_sort(&group_path, root, NIL, 0.0, group_tuples, width,
+			  comparison_cost, sort_mem,
+			  (limit_tuples > 0 && limit_tuples < group_tuples) ?
+			  limit_tuples : -1.0);
+
+	/*
+	 * Startup: we must read the first group of input and sort it.
+	 */
+	startup_cost = input_startup_cost + input_run_cost / num_groups +
+		group_path.startup_cost;
+
+	/*
+	 * Run: the rest of the input, the sorts of the remaining groups, and
+	 * extracting all tuples from the group sorts.  Then add the comparisons
+	 * of each input tuple against the current group's first tuple.
+	 */
+	run_cost = input_run_cost * (num_groups - 1.0) / num_groups +
+		(group_path.total_cost - group_path.startup_cost) +
+		group_path.total_cost * (num_groups - 1.0);
+	run_cost += cpu_operator_cost * tuples * presorted_keys;
+
+	if (!enable_incrementalsort)
+		startup_cost += disable_cost;
+
+	path->rows = tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_merge_append
  *	  Determines and returns the cost of a MergeAppend node.
@@ -1462,6 +1611,9 @@ cost_material(Path *path,
  * aggcosts can be NULL when there are no actual aggregate functions (i.e.,
  * we are using a hashed Agg node just to do grouping).
  *
+ * input_width is only used to cost spilling a hash table that doesn't fit
+ * into work_mem.
+ *
  * Note: when aggstrategy == AGG_SORTED, caller must ensure that input costs
  * are for appropriately-sorted input.
  */
@@ -1470,7 +1622,7 @@ cost_agg(Path *path, PlannerInfo *root,
 		 AggStrategy aggstrategy, const AggClauseCosts *aggcosts,
 		 int numGroupCols, double numGroups,
 		 Cost input_startup_cost, Cost input_total_cost,
-		 double input_tuples)
+		 double input_tuples, int input_width)
 {
 	double		output_tuples;
 	Cost		startup_cost;
@@ -1506,6 +1658,10 @@ cost_agg(Path *path, PlannerInfo *root,
 	 * there's roundoff error we might do the wrong thing.  So be sure that
 	 * the computations below form the same intermediate values in the same
 	 * order.
+	 *
+	 * AGG_HASHED is additionally charged for spilling the input tuples of
+	 * groups that don't fit into work_mem to disk and reading them back, see
+	 * nodeAgg.c.
 	 */
 	if (aggstrategy == AGG_PLAIN)
 	{
@@ -1532,6 +1688,9 @@ cost_agg(Path *path, PlannerInfo *root,
 	}
 	else
 	{
+		double		hashentrysize;
+		double		spilled_tuples;
+
 		/* must be AGG_HASHED */
 		startup_cost = input_total_cost;
 		startup_cost += aggcosts->transCost.startup;
@@ -1541,6 +1700,33 @@ cost_agg(Path *path, PlannerInfo *root,
 		total_cost += aggcosts->finalCost * numGroups;
 		total_cost += cpu_tuple_cost * numGroups;
 		output_tuples = numGroups;
+
+		/*
+		 * Estimate the hash table's size the same way the executor does, and
+		 * charge for writing out the tuples it has no room for and reading
+		 * them back in again.  Assume 3/4ths of the accesses are sequential,
+		 * 1/4th are not, as in cost_sort.
+		 */
+		hashentrysize = MAXALIGN(input_width) +
+			MAXALIGN(sizeof(MinimalTupleData)) +
+			aggcosts->transitionSpace +
+			hash_agg_entry_size(aggcosts->numAggs);
+		spilled_tuples = input_tuples *
+			hash_agg_spill_fraction(hashentrysize * numGroups);
+		if (spilled_tuples > 0)
+		{
+			double		spilled_pages;
+			Cost		page_cost;
+
+			spilled_pages = ceil(relation_byte_size(spilled_tuples,
+													input_width) / BLCKSZ);
+			page_cost = spilled_pages *
+				(seq_page_cost * 0.75 + random_page_cost * 0.25);
+
+			/* they're all written out before the first group is returned */
+			startup_cost += page_cost + cpu_tuple_cost * spilled_tuples;
+			total_cost += 2 * (page_cost + cpu_tuple_cost * spilled_tuples);
+		}
 	}
 
 	path->rows = output_tuples;
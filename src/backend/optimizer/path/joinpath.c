@@ -17,6 +17,7 @@
 #include <math.h>
 
 #include "executor/executor.h"
+#include "foreign/fdwapi.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -259,6 +260,21 @@ add_paths_to_joinrel(PlannerInfo *root,
 							 restrictlist, jointype,
 							 sjinfo, &semifactors,
 							 param_source_rels, extra_lateral_rels);
+
+	/*
+	 * 5. If both inner and outer relations are managed by the same FDW, give
+	 * it a chance to push down the join.  We don't do this when the query
+	 * has row marks or is an UPDATE or DELETE, since then EvalPlanQual could
+	 * need to recheck a row of the join, which a remote join can't supply.
+	 */
+	if (joinrel->fdwroutine &&
+		joinrel->fdwroutine->GetForeignJoinPaths &&
+		root->parse->commandType == CMD_SELECT &&
+		root->rowMarks == NIL)
+		joinrel->fdwroutine->GetForeignJoinPaths(root, joinrel,
+												 outerrel, innerrel,
+												 jointype, sjinfo,
+												 restrictlist);
 }
 
 /*
@@ -22,6 +22,7 @@
 #include "nodes/nodeFuncs.h"
 #include "nodes/plannodes.h"
 #include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/tlist.h"
@@ -330,6 +331,30 @@ pathkeys_contained_in(List *keys1, List *keys2)
 	return false;
 }
 
+/*
+ * pathkeys_common
+ *	  Returns the length of the longest common prefix of keys1 and keys2.
+ *
+ * Input sorted by keys2 is then already sorted by that many leading keys of
+ * keys1, which is what an incremental sort can make use of.
+ */
+int
+pathkeys_common(List *keys1, List *keys2)
+{
+	int			n = 0;
+	ListCell   *key1,
+			   *key2;
+
+	/* see compare_pathkeys about comparing canonical pathkeys by address */
+	forboth(key1, keys1, key2, keys2)
+	{
+		if (lfirst(key1) != lfirst(key2))
+			break;
+		n++;
+	}
+	return n;
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
@@ -1450,9 +1475,11 @@ right_merge_direction(PlannerInfo *root, PathKey *pathkey)
  *		Count the number of pathkeys that are useful for meeting the
  *		query's requested output ordering.
  *
- * Unlike merge pathkeys, this is an all-or-nothing affair: it does us
- * no good to order by just the first key(s) of the requested ordering.
- * So the result is always either 0 or list_length(root->query_pathkeys).
+ * Without incremental sort, this is an all-or-nothing affair: it does us
+ * no good to order by just the first key(s) of the requested ordering, so
+ * the result is either 0 or list_length(root->query_pathkeys).  An
+ * incremental sort can finish off a path sorted by a leading part of the
+ * requested ordering, though, so then any common prefix is useful.
  */
 static int
 pathkeys_useful_for_ordering(PlannerInfo *root, List *pathkeys)
@@ -1469,6 +1496,9 @@ pathkeys_useful_for_ordering(PlannerInfo *root, List *pathkeys)
 		return list_length(root->query_pathkeys);
 	}
 
+	if (enable_incrementalsort)
+		return pathkeys_common(root->query_pathkeys, pathkeys);
+
 	return 0;					/* path ordering not useful */
 }
 
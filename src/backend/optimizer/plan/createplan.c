@@ -40,6 +40,7 @@
 #include "parser/parse_clause.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
+#include "utils/syscache.h"
 
 
 static Plan *create_plan_recurse(PlannerInfo *root, Path *best_path);
@@ -50,9 +51,13 @@ static void disuse_physical_tlist(PlannerInfo *root, Plan *plan, Path *path);
 static Plan *create_gating_plan(PlannerInfo *root, Plan *plan, List *quals);
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
+static void set_append_partition_pruning(PlannerInfo *root,
+							 AppendPath *best_path, Append *plan);
+static bool partition_pruning_param_walker(Node *node, bool *has_extern);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path);
+static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path);
 static SeqScan *create_seqscan_plan(PlannerInfo *root, Path *best_path,
 					List *tlist, List *scan_clauses);
@@ -261,6 +266,10 @@ create_plan_recurse(PlannerInfo *root, Path *best_path)
 			plan = create_unique_plan(root,
 									  (UniquePath *) best_path);
 			break;
+		case T_Gather:
+			plan = (Plan *) create_gather_plan(root,
+											   (GatherPath *) best_path);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->pathtype);
@@ -524,7 +533,8 @@ use_physical_tlist(PlannerInfo *root, RelOptInfo *rel)
  * If the plan node immediately above a scan would prefer to get only
  * needed Vars and not a physical tlist, it must call this routine to
  * undo the decision made by use_physical_tlist().	Currently, Hash, Sort,
- * and Material nodes want this, so they don't have to store useless columns.
+ * and Material nodes want this, so they don't have to store useless columns,
+ * and Gather, so its workers don't have to send them.
  */
 static void
 disuse_physical_tlist(PlannerInfo *root, Plan *plan, Path *path)
@@ -717,9 +727,94 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 
 	plan = make_append(subplans, tlist);
 
+	set_append_partition_pruning(root, best_path, plan);
+
 	return (Plan *) plan;
 }
 
+/*
+ * set_append_partition_pruning
+ *	  If best_path scans the partitions of a partitioned table, and some of
+ *	  the table's restriction clauses depend on parameters that aren't known
+ *	  until execution, save those clauses in the Append so that the executor
+ *	  can prune the partitions they rule out.
+ *
+ * Clauses without parameters were already used to prune partitions by
+ * expand_inherited_rtentry; these are the ones left over in a generic plan.
+ */
+static void
+set_append_partition_pruning(PlannerInfo *root, AppendPath *best_path,
+							 Append *plan)
+{
+	RelOptInfo *rel = best_path->path.parent;
+	RangeTblEntry *rte;
+	List	   *quals = NIL;
+	ListCell   *lc;
+
+	if (rel->reloptkind != RELOPT_BASEREL)
+		return;
+	rte = planner_rt_fetch(rel->relid, root);
+	if (rte->rtekind != RTE_RELATION || !rte->inh)
+		return;
+
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		bool		has_extern = false;
+
+		if (rinfo->pseudoconstant)
+			continue;
+		if (partition_pruning_param_walker((Node *) rinfo->clause,
+										   &has_extern) ||
+			!has_extern)
+			continue;
+		if (contain_volatile_functions((Node *) rinfo->clause))
+			continue;
+		quals = lappend(quals, rinfo->clause);
+	}
+
+	if (quals == NIL ||
+		!SearchSysCacheExists1(PARTRELID, ObjectIdGetDatum(rte->relid)))
+		return;
+
+	foreach(lc, best_path->subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(lc);
+
+		plan->part_prune_oids =
+			lappend_oid(plan->part_prune_oids,
+						planner_rt_fetch(subpath->parent->relid, root)->relid);
+	}
+	plan->part_prune_rti = rel->relid;
+	plan->part_prune_quals = quals;
+}
+
+/*
+ * partition_pruning_param_walker
+ *	  Set *has_extern if the expression contains external Params.  Returns
+ *	  true, aborting the walk, if it contains anything the executor couldn't
+ *	  evaluate before starting the scan: PARAM_EXEC Params or sublinks.
+ */
+static bool
+partition_pruning_param_walker(Node *node, bool *has_extern)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		if (((Param *) node)->paramkind != PARAM_EXTERN)
+			return true;
+		*has_extern = true;
+		return false;
+	}
+	if (IsA(node, SubLink) ||
+		IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan))
+		return true;
+	return expression_tree_walker(node, partition_pruning_param_walker,
+								  (void *) has_extern);
+}
+
 /*
  * create_merge_append_plan
  *	  Create a MergeAppend plan for 'best_path' and (recursively) plans
@@ -870,6 +965,39 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path)
 	return plan;
 }
 
+/*
+ * create_gather_plan
+ *	  Create a Gather plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static Gather *
+create_gather_plan(PlannerInfo *root, GatherPath *best_path)
+{
+	Gather	   *plan;
+	Plan	   *subplan;
+
+	subplan = create_plan_recurse(root, best_path->subpath);
+
+	/* The workers mustn't send more columns than needed */
+	disuse_physical_tlist(root, subplan, best_path->subpath);
+
+	/* nodeGather.c expects a plain SeqScan, without a gating Result */
+	Assert(IsA(subplan, SeqScan));
+
+	plan = makeNode(Gather);
+	plan->plan.targetlist = subplan->targetlist;
+	plan->plan.qual = NIL;
+	plan->plan.lefttree = subplan;
+	plan->plan.righttree = NULL;
+	plan->num_workers = best_path->num_workers;
+
+	copy_path_costsize(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -1934,8 +2062,11 @@ create_worktablescan_plan(PlannerInfo *root, Path *best_path,
 
 /*
  * create_foreignscan_plan
- *	 Returns a foreignscan plan for the base relation scanned by 'best_path'
+ *	 Returns a foreignscan plan for the relation scanned by 'best_path'
  *	 with restriction clauses 'scan_clauses' and targetlist 'tlist'.
+ *
+ * The relation is usually a foreign table, but it can also be a join of
+ * foreign tables that the FDW has offered to perform remotely.
  */
 static ForeignScan *
 create_foreignscan_plan(PlannerInfo *root, ForeignPath *best_path,
@@ -1944,14 +2075,24 @@ create_foreignscan_plan(PlannerInfo *root, ForeignPath *best_path,
 	ForeignScan *scan_plan;
 	RelOptInfo *rel = best_path->path.parent;
 	Index		scan_relid = rel->relid;
-	RangeTblEntry *rte;
+	Oid			rel_oid = InvalidOid;
 	int			i;
 
-	/* it should be a base rel... */
-	Assert(scan_relid > 0);
-	Assert(rel->rtekind == RTE_RELATION);
-	rte = planner_rt_fetch(scan_relid, root);
-	Assert(rte->rtekind == RTE_RELATION);
+	/*
+	 * If we're scanning a base relation, fetch its OID.  (Irrelevant if
+	 * scanning a join relation.)
+	 */
+	if (scan_relid > 0)
+	{
+		RangeTblEntry *rte;
+
+		Assert(rel->rtekind == RTE_RELATION);
+		rte = planner_rt_fetch(scan_relid, root);
+		Assert(rte->rtekind == RTE_RELATION);
+		rel_oid = rte->relid;
+	}
+	else
+		Assert(rel->reloptkind == RELOPT_JOINREL);
 
 	/*
 	 * Sort clauses into best execution order.	We do this first since the FDW
@@ -1966,13 +2107,17 @@ create_foreignscan_plan(PlannerInfo *root, ForeignPath *best_path,
 	 * has selected some join clauses for remote use but also wants them
 	 * rechecked locally).
 	 */
-	scan_plan = rel->fdwroutine->GetForeignPlan(root, rel, rte->relid,
+	scan_plan = rel->fdwroutine->GetForeignPlan(root, rel, rel_oid,
 												best_path,
 												tlist, scan_clauses);
 
 	/* Copy cost data from Path to Plan; no need to make FDW do this */
 	copy_path_costsize(&scan_plan->scan.plan, &best_path->path);
 
+	/* Likewise fill in the foreign server OID and the relids scanned */
+	scan_plan->fs_server = rel->serverid;
+	scan_plan->fs_relids = best_path->path.parent->relids;
+
 	/*
 	 * Replace any outer-relation variables with nestloop params in the qual
 	 * and fdw_exprs expressions.  We do this last so that the FDW doesn't
@@ -1991,15 +2136,19 @@ create_foreignscan_plan(PlannerInfo *root, ForeignPath *best_path,
 	/*
 	 * Detect whether any system columns are requested from rel.  This is a
 	 * bit of a kluge and might go away someday, so we intentionally leave it
-	 * out of the API presented to FDWs.
+	 * out of the API presented to FDWs.  A join relation has no system
+	 * columns of its own.
 	 */
 	scan_plan->fsSystemCol = false;
-	for (i = rel->min_attr; i < 0; i++)
+	if (scan_relid > 0)
 	{
-		if (!bms_is_empty(rel->attr_needed[i - rel->min_attr]))
+		for (i = rel->min_attr; i < 0; i++)
 		{
-			scan_plan->fsSystemCol = true;
-			break;
+			if (!bms_is_empty(rel->attr_needed[i - rel->min_attr]))
+			{
+				scan_plan->fsSystemCol = true;
+				break;
+			}
 		}
 	}
 
@@ -3474,8 +3623,13 @@ make_foreignscan(List *qptlist,
 	plan->lefttree = NULL;
 	plan->righttree = NULL;
 	node->scan.scanrelid = scanrelid;
+	/* fs_server and fs_relids will be filled in by create_foreignscan_plan */
+	node->fs_server = InvalidOid;
 	node->fdw_exprs = fdw_exprs;
 	node->fdw_private = fdw_private;
+	/* an FDW performing a join or aggregation must set this itself */
+	node->fdw_scan_tlist = NIL;
+	node->fs_relids = NULL;
 	/* fsSystemCol will be filled in by create_foreignscan_plan */
 	node->fsSystemCol = false;
 
@@ -4112,6 +4266,64 @@ make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
 					 nullsFirst, limit_tuples);
 }
 
+/*
+ * make_incrementalsort_from_pathkeys
+ *	  Create an incremental sort plan to sort according to given pathkeys,
+ *	  where the input is already sorted by the first 'presortedCols' of them
+ *
+ *	  Other arguments are as for make_sort_from_pathkeys.
+ */
+IncrementalSort *
+make_incrementalsort_from_pathkeys(PlannerInfo *root, Plan *lefttree,
+								   List *pathkeys, int presortedCols,
+								   double limit_tuples)
+{
+	IncrementalSort *node = makeNode(IncrementalSort);
+	Plan	   *plan = &node->sort.plan;
+	Path		sort_path;		/* dummy for result of cost_incremental_sort */
+	int			numsortkeys;
+	AttrNumber *sortColIdx;
+	Oid		   *sortOperators;
+	Oid		   *collations;
+	bool	   *nullsFirst;
+
+	/* Compute sort column info, and adjust lefttree as needed */
+	lefttree = prepare_sort_from_pathkeys(root, lefttree, pathkeys,
+										  NULL,
+										  NULL,
+										  false,
+										  &numsortkeys,
+										  &sortColIdx,
+										  &sortOperators,
+										  &collations,
+										  &nullsFirst);
+	Assert(presortedCols > 0 && presortedCols < numsortkeys);
+
+	copy_plan_costsize(plan, lefttree); /* only care about copying size */
+	cost_incremental_sort(&sort_path, root, pathkeys, presortedCols,
+						  lefttree->startup_cost,
+						  lefttree->total_cost,
+						  lefttree->plan_rows,
+						  lefttree->plan_width,
+						  0.0,
+						  work_mem,
+						  limit_tuples);
+	plan->startup_cost = sort_path.startup_cost;
+	plan->total_cost = sort_path.total_cost;
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->sort.numCols = numsortkeys;
+	node->sort.sortColIdx = sortColIdx;
+	node->sort.sortOperators = sortOperators;
+	node->sort.collations = collations;
+	node->sort.nullsFirst = nullsFirst;
+	node->presortedCols = presortedCols;
+
+	return node;
+}
+
 /*
  * make_sort_from_sortclauses
  *	  Create sort plan to sort according to given sortclauses
@@ -4285,7 +4497,7 @@ make_agg(PlannerInfo *root, List *tlist, List *qual,
 			 numGroupCols, numGroups,
 			 lefttree->startup_cost,
 			 lefttree->total_cost,
-			 lefttree->plan_rows);
+			 lefttree->plan_rows, lefttree->plan_width);
 	plan->startup_cost = agg_path.startup_cost;
 	plan->total_cost = agg_path.total_cost;
 
@@ -4836,6 +5048,7 @@ is_projection_capable_plan(Plan *plan)
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
@@ -4844,6 +5057,7 @@ is_projection_capable_plan(Plan *plan)
 		case T_Append:
 		case T_MergeAppend:
 		case T_RecursiveUnion:
+		case T_Gather:
 			return false;
 		default:
 			break;
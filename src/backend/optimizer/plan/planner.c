@@ -19,7 +19,7 @@
 
 #include "access/htup_details.h"
 #include "executor/executor.h"
-#include "executor/nodeAgg.h"
+#include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #ifdef OPTIMIZER_DEBUG
@@ -84,6 +84,13 @@ static bool choose_hashed_grouping(PlannerInfo *root,
 					   double path_rows, int path_width,
 					   Path *cheapest_path, Path *sorted_path,
 					   double dNumGroups, AggClauseCosts *agg_costs);
+static Path *choose_incremental_sort_path(PlannerInfo *root,
+							 RelOptInfo *final_rel, Path *best_path,
+							 double tuple_fraction,
+							 double path_rows, int path_width);
+static int choose_incremental_sort(PlannerInfo *root, Plan *plan,
+						List *pathkeys, List *current_pathkeys,
+						double limit_tuples);
 static bool choose_hashed_distinct(PlannerInfo *root,
 					   double tuple_fraction, double limit_tuples,
 					   double path_rows, int path_width,
@@ -1482,6 +1489,21 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 		else
 			best_path = sorted_path;
 
+		/*
+		 * If the ORDER BY is the only ordering we need, a path sorted by a
+		 * leading part of it might be finished off more cheaply by an
+		 * incremental sort; that is particularly likely under a LIMIT.
+		 */
+		if (root->query_pathkeys != NIL &&
+			!parse->groupClause && !parse->hasAggs &&
+			!root->hasHavingQual && !activeWindows &&
+			!parse->distinctClause)
+			best_path = choose_incremental_sort_path(root, final_rel,
+													 best_path,
+													 tuple_fraction,
+													 path_rows,
+													 path_width);
+
 		/*
 		 * Check to see if it's possible to optimize MIN/MAX aggregates. If
 		 * so, we will forget all the work we did so far to choose a "regular"
@@ -1683,6 +1705,32 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 												   parse->havingQual,
 												   NULL);
 			}
+
+			/*
+			 * If we're grouping the output of a foreign table, or of a join
+			 * that its FDW performs remotely, the FDW may be able to do the
+			 * grouping and aggregation on the remote side as well.  Use its
+			 * plan instead if that's estimated to be cheaper.
+			 */
+			if ((parse->groupClause || parse->hasAggs) && !activeWindows &&
+				final_rel->fdwroutine &&
+				final_rel->fdwroutine->GetForeignGroupingPlan)
+			{
+				Plan	   *fdw_plan;
+
+				fdw_plan = (Plan *)
+					final_rel->fdwroutine->GetForeignGroupingPlan(root,
+																  final_rel,
+																  tlist,
+																  dNumGroups);
+				if (fdw_plan &&
+					fdw_plan->total_cost < result_plan->total_cost)
+				{
+					result_plan = fdw_plan;
+					/* Remote grouping produces randomly-ordered results */
+					current_pathkeys = NIL;
+				}
+			}
 		}						/* end of non-minmax-aggregate case */
 
 		/*
@@ -1949,10 +1997,24 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 	{
 		if (!pathkeys_contained_in(root->sort_pathkeys, current_pathkeys))
 		{
-			result_plan = (Plan *) make_sort_from_pathkeys(root,
-														   result_plan,
+			int			presortedCols;
+
+			presortedCols = choose_incremental_sort(root, result_plan,
+													root->sort_pathkeys,
+													current_pathkeys,
+													limit_tuples);
+			if (presortedCols > 0)
+				result_plan = (Plan *)
+					make_incrementalsort_from_pathkeys(root,
+													   result_plan,
+													   root->sort_pathkeys,
+													   presortedCols,
+													   limit_tuples);
+			else
+				result_plan = (Plan *) make_sort_from_pathkeys(root,
+															   result_plan,
 														 root->sort_pathkeys,
-														   limit_tuples);
+															   limit_tuples);
 			current_pathkeys = root->sort_pathkeys;
 		}
 	}
@@ -2692,7 +2754,6 @@ choose_hashed_grouping(PlannerInfo *root,
 	int			numGroupCols = list_length(parse->groupClause);
 	bool		can_hash;
 	bool		can_sort;
-	Size		hashentrysize;
 	List	   *target_pathkeys;
 	List	   *current_pathkeys;
 	Path		hashed_p;
@@ -2728,21 +2789,6 @@ choose_hashed_grouping(PlannerInfo *root,
 	if (!enable_hashagg)
 		return false;
 
-	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
-	 */
-
-	/* Estimate per-hash-entry space at tuple width... */
-	hashentrysize = MAXALIGN(path_width) + MAXALIGN(sizeof(MinimalTupleData));
-	/* plus space for pass-by-ref transition values... */
-	hashentrysize += agg_costs->transitionSpace;
-	/* plus the per-hash-entry overhead */
-	hashentrysize += hash_agg_entry_size(agg_costs->numAggs);
-
-	if (hashentrysize * dNumGroups > work_mem * 1024L)
-		return false;
-
 	/*
 	 * When we have both GROUP BY and DISTINCT, use the more-rigorous of
 	 * DISTINCT and ORDER BY as the assumed required output sort order. This
@@ -2775,7 +2821,7 @@ choose_hashed_grouping(PlannerInfo *root,
 	cost_agg(&hashed_p, root, AGG_HASHED, agg_costs,
 			 numGroupCols, dNumGroups,
 			 cheapest_path->startup_cost, cheapest_path->total_cost,
-			 path_rows);
+			 path_rows, path_width);
 	/* Result of hashed agg is always unsorted */
 	if (target_pathkeys)
 		cost_sort(&hashed_p, root, target_pathkeys, hashed_p.total_cost,
@@ -2806,7 +2852,7 @@ choose_hashed_grouping(PlannerInfo *root,
 		cost_agg(&sorted_p, root, AGG_SORTED, agg_costs,
 				 numGroupCols, dNumGroups,
 				 sorted_p.startup_cost, sorted_p.total_cost,
-				 path_rows);
+				 path_rows, path_width);
 	else
 		cost_group(&sorted_p, root, numGroupCols, dNumGroups,
 				   sorted_p.startup_cost, sorted_p.total_cost,
@@ -2830,6 +2876,115 @@ choose_hashed_grouping(PlannerInfo *root,
 	return false;
 }
 
+/*
+ * choose_incremental_sort_path - consider finishing the ORDER BY with an
+ *		incremental sort of a partially sorted path
+ *
+ * best_path is the path chosen so far, either presorted or to be sorted in
+ * full.  We return it, or another path of final_rel whose pathkeys start
+ * with some of the query pathkeys if incrementally sorting that one is
+ * cheaper at the given tuple_fraction.  In the latter case the final sort
+ * step will see the common prefix and build an IncrementalSort.
+ */
+static Path *
+choose_incremental_sort_path(PlannerInfo *root, RelOptInfo *final_rel,
+							 Path *best_path, double tuple_fraction,
+							 double path_rows, int path_width)
+{
+	Path		best_cost;		/* dummy for cost of the current choice */
+	Path		incr_path;		/* dummy for result of cost_incremental_sort */
+	int			nkeys = list_length(root->query_pathkeys);
+	ListCell   *lc;
+
+	if (!enable_incrementalsort)
+		return best_path;
+
+	if (pathkeys_contained_in(root->query_pathkeys, best_path->pathkeys))
+	{
+		best_cost.startup_cost = best_path->startup_cost;
+		best_cost.total_cost = best_path->total_cost;
+	}
+	else
+		cost_sort(&best_cost, root, root->query_pathkeys,
+				  best_path->total_cost,
+				  path_rows, path_width,
+				  0.0, work_mem, root->limit_tuples);
+
+	foreach(lc, final_rel->pathlist)
+	{
+		Path	   *path = (Path *) lfirst(lc);
+		int			presorted_keys;
+
+		/* query_planner's caller can't use parameterized paths */
+		if (path->param_info)
+			continue;
+
+		presorted_keys = pathkeys_common(root->query_pathkeys,
+										 path->pathkeys);
+		if (presorted_keys == 0 || presorted_keys >= nkeys)
+			continue;
+
+		cost_incremental_sort(&incr_path, root, root->query_pathkeys,
+							  presorted_keys,
+							  path->startup_cost, path->total_cost,
+							  path_rows, path_width,
+							  0.0, work_mem, root->limit_tuples);
+
+		if (compare_fractional_path_costs(&incr_path, &best_cost,
+										  tuple_fraction) < 0)
+		{
+			best_path = path;
+			best_cost.startup_cost = incr_path.startup_cost;
+			best_cost.total_cost = incr_path.total_cost;
+		}
+	}
+
+	return best_path;
+}
+
+/*
+ * choose_incremental_sort - decide how to sort a plan for ORDER BY
+ *
+ * The plan's output is sorted by current_pathkeys.  Returns the number of
+ * leading pathkeys it shares with the wanted ones if an incremental sort is
+ * estimated to be cheaper than a full sort, else zero.
+ */
+static int
+choose_incremental_sort(PlannerInfo *root, Plan *plan,
+						List *pathkeys, List *current_pathkeys,
+						double limit_tuples)
+{
+	Path		sort_path;		/* dummy for result of cost_sort */
+	Path		incr_path;		/* dummy for result of cost_incremental_sort */
+	int			presorted_keys;
+	double		fraction;
+
+	if (!enable_incrementalsort)
+		return 0;
+
+	presorted_keys = pathkeys_common(pathkeys, current_pathkeys);
+	if (presorted_keys == 0 || presorted_keys >= list_length(pathkeys))
+		return 0;
+
+	cost_sort(&sort_path, root, pathkeys, plan->total_cost,
+			  plan->plan_rows, plan->plan_width,
+			  0.0, work_mem, limit_tuples);
+	cost_incremental_sort(&incr_path, root, pathkeys, presorted_keys,
+						  plan->startup_cost, plan->total_cost,
+						  plan->plan_rows, plan->plan_width,
+						  0.0, work_mem, limit_tuples);
+
+	/* A LIMIT means we only need that fraction of the sorted output */
+	if (limit_tuples > 0 && plan->plan_rows > 0)
+		fraction = limit_tuples / plan->plan_rows;
+	else
+		fraction = 0.0;
+
+	if (compare_fractional_path_costs(&incr_path, &sort_path, fraction) < 0)
+		return presorted_keys;
+	return 0;
+}
+
 /*
  * choose_hashed_distinct - should we use hashing for DISTINCT?
  *
@@ -2862,7 +3017,6 @@ choose_hashed_distinct(PlannerInfo *root,
 	int			numDistinctCols = list_length(parse->distinctClause);
 	bool		can_sort;
 	bool		can_hash;
-	Size		hashentrysize;
 	List	   *current_pathkeys;
 	List	   *needed_pathkeys;
 	Path		hashed_p;
@@ -2896,19 +3050,6 @@ choose_hashed_distinct(PlannerInfo *root,
 	if (!enable_hashagg)
 		return false;
 
-	/*
-	 * Don't do it if it doesn't look like the hashtable will fit into
-	 * work_mem.
-	 */
-
-	/* Estimate per-hash-entry space at tuple width... */
-	hashentrysize = MAXALIGN(path_width) + MAXALIGN(sizeof(MinimalTupleData));
-	/* plus the per-hash-entry overhead */
-	hashentrysize += hash_agg_entry_size(0);
-
-	if (hashentrysize * dNumDistinctRows > work_mem * 1024L)
-		return false;
-
 	/*
 	 * See if the estimated cost is no more than doing it the other way. While
 	 * avoiding the need for sorted input is usually a win, the fact that the
@@ -2925,7 +3066,7 @@ choose_hashed_distinct(PlannerInfo *root,
 	cost_agg(&hashed_p, root, AGG_HASHED, NULL,
 			 numDistinctCols, dNumDistinctRows,
 			 cheapest_startup_cost, cheapest_total_cost,
-			 path_rows);
+			 path_rows, path_width);
 
 	/*
 	 * Result of hashed agg is always unsorted, so if ORDER BY is present we
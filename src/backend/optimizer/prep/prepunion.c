@@ -33,11 +33,13 @@
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
+#include "catalog/partition.h"
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/planmain.h"
@@ -46,9 +48,11 @@
 #include "optimizer/tlist.h"
 #include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
+#include "storage/lmgr.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
+#include "utils/syscache.h"
 
 
 typedef struct
@@ -101,6 +105,9 @@ static List *generate_append_tlist(List *colTypes, List *colCollations,
 static List *generate_setop_grouplist(SetOperationStmt *op, List *targetlist);
 static void expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte,
 						 Index rti);
+static List *find_partitions_for_query(PlannerInfo *root, Relation parentrel,
+						  Index rti, LOCKMODE lockmode);
+static bool partition_quals_apply(Node *jtnode, Index rti);
 static void make_inh_translation_list(Relation oldrelation,
 						  Relation newrelation,
 						  Index newvarno,
@@ -851,7 +858,7 @@ choose_hashed_setop(PlannerInfo *root, List *groupClauses,
 	cost_agg(&hashed_p, root, AGG_HASHED, NULL,
 			 numGroupCols, dNumGroups,
 			 input_plan->startup_cost, input_plan->total_cost,
-			 input_plan->plan_rows);
+			 input_plan->plan_rows, input_plan->plan_width);
 
 	/*
 	 * Now for the sorted case.  Note that the input is *always* unsorted,
@@ -1278,8 +1285,21 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	else
 		lockmode = AccessShareLock;
 
-	/* Scan for all members of inheritance set, acquire needed locks */
-	inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
+	/*
+	 * Must open the parent relation to examine its tupdesc.  We need not lock
+	 * it; we assume the rewriter already did.
+	 */
+	oldrelation = heap_open(parentOID, NoLock);
+
+	/*
+	 * Scan for all members of inheritance set, acquire needed locks.  For a
+	 * partitioned table, that's only the partitions the query's quals don't
+	 * rule out.
+	 */
+	if (RelationGetPartitionKey(oldrelation) != NULL)
+		inhOIDs = find_partitions_for_query(root, oldrelation, rti, lockmode);
+	else
+		inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
 
 	/*
 	 * Check that there's at least one descendant, else treat as no-child
@@ -1288,6 +1308,7 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	 */
 	if (list_length(inhOIDs) < 2)
 	{
+		heap_close(oldrelation, NoLock);
 		/* Clear flag before returning */
 		rte->inh = false;
 		return;
@@ -1301,12 +1322,6 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	if (oldrc)
 		oldrc->isParent = true;
 
-	/*
-	 * Must open the parent relation to examine its tupdesc.  We need not lock
-	 * it; we assume the rewriter already did.
-	 */
-	oldrelation = heap_open(parentOID, NoLock);
-
 	/* Scan the inheritance set and expand it */
 	appinfos = NIL;
 	foreach(l, inhOIDs)
@@ -1418,6 +1433,113 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	root->append_rel_list = list_concat(root->append_rel_list, appinfos);
 }
 
+/*
+ * find_partitions_for_query
+ *		Get the OIDs of a partitioned table and of those of its partitions
+ *		that may hold rows satisfying the query's WHERE clause, locking the
+ *		partitions with lockmode.
+ *
+ * This takes a binary search over the partition bounds rather than a
+ * constraint exclusion proof for every partition, and it saves us locking
+ * and opening the partitions that aren't needed.  The quals haven't been
+ * through preprocess_expression yet, so we simplify them here; with a
+ * custom plan for a prepared statement, that substitutes the values of
+ * the parameters.
+ */
+static List *
+find_partitions_for_query(PlannerInfo *root, Relation parentrel,
+						  Index rti, LOCKMODE lockmode)
+{
+	Query	   *parse = root->parse;
+	List	   *clauses = NIL;
+	List	   *partoids;
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	if (partition_quals_apply((Node *) parse->jointree, rti))
+	{
+		foreach(lc, make_ands_implicit((Expr *) parse->jointree->quals))
+		{
+			Node	   *clause = (Node *) lfirst(lc);
+
+			/* sublinks haven't been planned yet, so leave them alone */
+			if (contain_subplans(clause))
+				continue;
+			clauses = lappend(clauses, eval_const_expressions(root, clause));
+		}
+	}
+
+	partoids = get_partitions_for_clauses(parentrel, rti, clauses);
+
+	/* get_partitions_for_clauses returns them in OID order, as we need */
+	foreach(lc, partoids)
+	{
+		Oid			partoid = lfirst_oid(lc);
+
+		LockRelationOid(partoid, lockmode);
+
+		/*
+		 * Dropping a partition locks only the partition, so it may have gone
+		 * away while we waited for the lock.  As in
+		 * find_inheritance_children, double-check, and ignore it if so.
+		 */
+		if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(partoid)))
+		{
+			UnlockRelationOid(partoid, lockmode);
+			continue;
+		}
+
+		result = lappend_oid(result, partoid);
+	}
+
+	return lcons_oid(RelationGetRelid(parentrel), result);
+}
+
+/*
+ * partition_quals_apply
+ *		Do the top-level WHERE quals restrict the rows of rel rti?
+ *
+ * That's not so if rti is on the nullable side of an outer join, where a
+ * qual like "x IS NULL" may be satisfied by null-extended rows instead.
+ */
+static bool
+partition_quals_apply(Node *jtnode, Index rti)
+{
+	if (jtnode == NULL)
+		return false;
+	if (IsA(jtnode, RangeTblRef))
+		return ((RangeTblRef *) jtnode)->rtindex == rti;
+	if (IsA(jtnode, FromExpr))
+	{
+		ListCell   *lc;
+
+		foreach(lc, ((FromExpr *) jtnode)->fromlist)
+		{
+			if (partition_quals_apply((Node *) lfirst(lc), rti))
+				return true;
+		}
+		return false;
+	}
+	if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		switch (j->jointype)
+		{
+			case JOIN_INNER:
+				return partition_quals_apply(j->larg, rti) ||
+					partition_quals_apply(j->rarg, rti);
+			case JOIN_LEFT:
+				return partition_quals_apply(j->larg, rti);
+			case JOIN_RIGHT:
+				return partition_quals_apply(j->rarg, rti);
+			default:
+				return false;
+		}
+	}
+	return false;
+}
+
 /*
  * make_inh_translation_list
  *	  Build the list of translations from parent Vars to child Vars for
@@ -1070,6 +1070,35 @@ create_material_path(RelOptInfo *rel, Path *subpath)
 	return pathnode;
 }
 
+/*
+ * create_gather_path
+ *	  Creates a path corresponding to a Gather plan, which runs subpath, a
+ *	  sequential scan, in num_workers background workers as well as in the
+ *	  backend itself, returning the pathnode.
+ */
+GatherPath *
+create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+				   int num_workers)
+{
+	GatherPath *pathnode = makeNode(GatherPath);
+
+	Assert(subpath->parent == rel);
+	Assert(subpath->pathtype == T_SeqScan);
+	Assert(subpath->param_info == NULL);
+
+	pathnode->path.pathtype = T_Gather;
+	pathnode->path.parent = rel;
+	pathnode->path.param_info = NULL;
+	pathnode->path.pathkeys = NIL;		/* output order is unpredictable */
+
+	pathnode->subpath = subpath;
+	pathnode->num_workers = num_workers;
+
+	cost_gather(pathnode, root, rel);
+
+	return pathnode;
+}
+
 /*
  * create_unique_path
  *	  Creates a path representing elimination of distinct rows from the
@@ -1376,7 +1405,7 @@ create_unique_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 					 numCols, pathnode->path.rows,
 					 subpath->startup_cost,
 					 subpath->total_cost,
-					 rel->rows);
+					 rel->rows, rel->width);
 	}
 
 	if (all_btree && all_hash)
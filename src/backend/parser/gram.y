@@ -163,6 +163,7 @@ static void SplitColQualList(List *qualList,
 static void processCASbits(int cas_bits, int location, const char *constrType,
 			   bool *deferrable, bool *initdeferred, bool *not_valid,
 			   bool *no_inherit, core_yyscan_t yyscanner);
+static void processVacuumOptions(VacuumStmt *n, List *options);
 static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 
 %}
@@ -201,6 +202,9 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 	WindowDef			*windef;
 	JoinExpr			*jexpr;
 	IndexElem			*ielem;
+	PartitionElem		*partelem;
+	PartitionSpec		*partspec;
+	PartitionBoundSpec	*partboundspec;
 	Alias				*alias;
 	RangeVar			*range;
 	IntoClause			*into;
@@ -264,12 +268,13 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 %type <list>	createdb_opt_list alterdb_opt_list copy_opt_list
 				transaction_mode_list
 				create_extension_opt_list alter_extension_opt_list
+				vacuum_option_list
 %type <defelt>	createdb_opt_item alterdb_opt_item copy_opt_item
 				transaction_mode_item
 				create_extension_opt_item alter_extension_opt_item
+				vacuum_option_elem
 
 %type <ival>	opt_lock lock_type cast_context
-%type <ival>	vacuum_option_list vacuum_option_elem
 %type <boolean>	opt_force opt_or_replace
 				opt_grant_grant_option opt_grant_admin_option
 				opt_nowait opt_if_exists opt_with_data
@@ -423,6 +428,11 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 %type <list>	func_alias_clause
 %type <sortby>	sortby
 %type <ielem>	index_elem
+%type <partelem>	part_elem
+%type <partspec>	PartitionSpec OptPartitionSpec
+%type <partboundspec>	ForValues
+%type <node>	partbound_datum range_bound_datum
+%type <list>	partbound_datum_list
 %type <node>	table_ref
 %type <jexpr>	joined_table
 %type <range>	relation_expr
@@ -574,7 +584,7 @@ static Node *makeRecursiveViewSelect(char *relname, List *aliases, Node *query);
 	OBJECT_P OF OFF OFFSET OIDS ON ONLY OPERATOR OPTION OPTIONS OR
 	ORDER ORDINALITY OUT_P OUTER_P OVER OVERLAPS OVERLAY OWNED OWNER
 
-	PARSER PARTIAL PARTITION PASSING PASSWORD PLACING PLANS POSITION
+	PARALLEL PARSER PARTIAL PARTITION PASSING PASSWORD PLACING PLANS POSITION
 	PRECEDING PRECISION PRESERVE PREPARE PREPARED PRIMARY
 	PRIOR PRIVILEGES PROCEDURAL PROCEDURE PROGRAM
 
@@ -2133,6 +2143,17 @@ alter_table_cmd:
 					n->def = (Node *) $2;
 					$$ = (Node *)n;
 				}
+			/* ALTER TABLE <name> INHERIT <parent> FOR VALUES ... */
+			| INHERIT qualified_name ForValues
+				{
+					AlterTableCmd *n = makeNode(AlterTableCmd);
+					PartitionCmd *cmd = makeNode(PartitionCmd);
+					cmd->parent = $2;
+					cmd->bound = $3;
+					n->subtype = AT_AddInherit;
+					n->def = (Node *) cmd;
+					$$ = (Node *)n;
+				}
 			/* ALTER TABLE <name> NO INHERIT <parent> */
 			| NO INHERIT qualified_name
 				{
@@ -2642,33 +2663,35 @@ copy_generic_opt_arg_list_item:
  *****************************************************************************/
 
 CreateStmt:	CREATE OptTemp TABLE qualified_name '(' OptTableElementList ')'
-			OptInherit OptWith OnCommitOption OptTableSpace
+			OptInherit OptPartitionSpec OptWith OnCommitOption OptTableSpace
 				{
 					CreateStmt *n = makeNode(CreateStmt);
 					$4->relpersistence = $2;
 					n->relation = $4;
 					n->tableElts = $6;
 					n->inhRelations = $8;
+					n->partspec = $9;
 					n->constraints = NIL;
-					n->options = $9;
-					n->oncommit = $10;
-					n->tablespacename = $11;
+					n->options = $10;
+					n->oncommit = $11;
+					n->tablespacename = $12;
 					n->if_not_exists = false;
 					$$ = (Node *)n;
 				}
 		| CREATE OptTemp TABLE IF_P NOT EXISTS qualified_name '('
-			OptTableElementList ')' OptInherit OptWith OnCommitOption
-			OptTableSpace
+			OptTableElementList ')' OptInherit OptPartitionSpec OptWith
+			OnCommitOption OptTableSpace
 				{
 					CreateStmt *n = makeNode(CreateStmt);
 					$7->relpersistence = $2;
 					n->relation = $7;
 					n->tableElts = $9;
 					n->inhRelations = $11;
+					n->partspec = $12;
 					n->constraints = NIL;
-					n->options = $12;
-					n->oncommit = $13;
-					n->tablespacename = $14;
+					n->options = $13;
+					n->oncommit = $14;
+					n->tablespacename = $15;
 					n->if_not_exists = true;
 					$$ = (Node *)n;
 				}
@@ -2704,6 +2727,38 @@ CreateStmt:	CREATE OptTemp TABLE qualified_name '(' OptTableElementList ')'
 					n->if_not_exists = true;
 					$$ = (Node *)n;
 				}
+		| CREATE OptTemp TABLE qualified_name PARTITION OF qualified_name
+			ForValues OptWith OnCommitOption OptTableSpace
+				{
+					CreateStmt *n = makeNode(CreateStmt);
+					$4->relpersistence = $2;
+					n->relation = $4;
+					n->tableElts = NIL;
+					n->inhRelations = list_make1($7);
+					n->partbound = $8;
+					n->constraints = NIL;
+					n->options = $9;
+					n->oncommit = $10;
+					n->tablespacename = $11;
+					n->if_not_exists = false;
+					$$ = (Node *)n;
+				}
+		| CREATE OptTemp TABLE IF_P NOT EXISTS qualified_name PARTITION OF
+			qualified_name ForValues OptWith OnCommitOption OptTableSpace
+				{
+					CreateStmt *n = makeNode(CreateStmt);
+					$7->relpersistence = $2;
+					n->relation = $7;
+					n->tableElts = NIL;
+					n->inhRelations = list_make1($10);
+					n->partbound = $11;
+					n->constraints = NIL;
+					n->options = $12;
+					n->oncommit = $13;
+					n->tablespacename = $14;
+					n->if_not_exists = true;
+					$$ = (Node *)n;
+				}
 		;
 
 /*
@@ -3243,6 +3298,73 @@ OptInherit: INHERITS '(' qualified_name_list ')'	{ $$ = $3; }
 			| /*EMPTY*/								{ $$ = NIL; }
 		;
 
+/*
+ * Partitioning.  The strategy is given as a plain identifier, so that LIST
+ * needn't become a keyword; it is checked in DefineRelation.
+ */
+OptPartitionSpec: PartitionSpec						{ $$ = $1; }
+			| /*EMPTY*/								{ $$ = NULL; }
+		;
+
+PartitionSpec: PARTITION BY ColId '(' part_elem ')'
+				{
+					PartitionSpec *n = makeNode(PartitionSpec);
+					n->strategy = $3;
+					n->partParam = $5;
+					n->location = @1;
+					$$ = n;
+				}
+		;
+
+part_elem:	ColId opt_collate opt_class
+				{
+					PartitionElem *n = makeNode(PartitionElem);
+					n->name = $1;
+					n->collation = $2;
+					n->opclass = $3;
+					n->location = @1;
+					$$ = n;
+				}
+		;
+
+ForValues:
+			FOR VALUES IN_P '(' partbound_datum_list ')'
+				{
+					PartitionBoundSpec *n = makeNode(PartitionBoundSpec);
+					n->strategy = PARTITION_STRATEGY_LIST;
+					n->listdatums = $5;
+					n->location = @3;
+					$$ = n;
+				}
+			| FOR VALUES FROM '(' range_bound_datum ')'
+				TO '(' range_bound_datum ')'
+				{
+					PartitionBoundSpec *n = makeNode(PartitionBoundSpec);
+					n->strategy = PARTITION_STRATEGY_RANGE;
+					n->lowerdatum = $5;
+					n->upperdatum = $9;
+					n->location = @3;
+					$$ = n;
+				}
+		;
+
+partbound_datum:
+			Sconst						{ $$ = makeStringConst($1, @1); }
+			| NumericOnly				{ $$ = makeAConst($1, @1); }
+			| NULL_P					{ $$ = makeNullAConst(@1); }
+		;
+
+partbound_datum_list:
+			partbound_datum						{ $$ = list_make1($1); }
+			| partbound_datum_list ',' partbound_datum
+												{ $$ = lappend($1, $3); }
+		;
+
+range_bound_datum:
+			partbound_datum						{ $$ = $1; }
+			| UNBOUNDED							{ $$ = NULL; }
+		;
+
 /* WITH (options) is preferred, WITH OIDS and WITHOUT OIDS are legacy forms */
 OptWith:
 			WITH reloptions				{ $$ = $2; }
@@ -8776,7 +8898,8 @@ VacuumStmt: VACUUM opt_full opt_freeze opt_verbose
 			| VACUUM '(' vacuum_option_list ')'
 				{
 					VacuumStmt *n = makeNode(VacuumStmt);
-					n->options = VACOPT_VACUUM | $3;
+					n->options = VACOPT_VACUUM;
+					processVacuumOptions(n, $3);
 					if (n->options & VACOPT_FREEZE)
 					{
 						n->freeze_min_age = n->freeze_table_age = 0;
@@ -8796,7 +8919,8 @@ VacuumStmt: VACUUM opt_full opt_freeze opt_verbose
 			| VACUUM '(' vacuum_option_list ')' qualified_name opt_name_list
 				{
 					VacuumStmt *n = makeNode(VacuumStmt);
-					n->options = VACOPT_VACUUM | $3;
+					n->options = VACOPT_VACUUM;
+					processVacuumOptions(n, $3);
 					if (n->options & VACOPT_FREEZE)
 					{
 						n->freeze_min_age = n->freeze_table_age = 0;
@@ -8818,15 +8942,19 @@ VacuumStmt: VACUUM opt_full opt_freeze opt_verbose
 		;
 
 vacuum_option_list:
-			vacuum_option_elem								{ $$ = $1; }
-			| vacuum_option_list ',' vacuum_option_elem		{ $$ = $1 | $3; }
+			vacuum_option_elem								{ $$ = list_make1($1); }
+			| vacuum_option_list ',' vacuum_option_elem		{ $$ = lappend($1, $3); }
 		;
 
 vacuum_option_elem:
-			analyze_keyword		{ $$ = VACOPT_ANALYZE; }
-			| VERBOSE			{ $$ = VACOPT_VERBOSE; }
-			| FREEZE			{ $$ = VACOPT_FREEZE; }
-			| FULL				{ $$ = VACOPT_FULL; }
+			analyze_keyword		{ $$ = makeDefElem("analyze", NULL); }
+			| VERBOSE			{ $$ = makeDefElem("verbose", NULL); }
+			| FREEZE			{ $$ = makeDefElem("freeze", NULL); }
+			| FULL				{ $$ = makeDefElem("full", NULL); }
+			| PARALLEL Iconst
+				{
+					$$ = makeDefElem("parallel", (Node *) makeInteger($2));
+				}
 		;
 
 AnalyzeStmt:
@@ -12949,6 +13077,7 @@ unreserved_keyword:
 			| OVER
 			| OWNED
 			| OWNER
+			| PARALLEL
 			| PARSER
 			| PARTIAL
 			| PARTITION
@@ -13853,6 +13982,34 @@ SplitColQualList(List *qualList,
 	*constraintList = qualList;
 }
 
+/*
+ * Apply the options given in VACUUM's parenthesized option list to the
+ * VacuumStmt.
+ */
+static void
+processVacuumOptions(VacuumStmt *n, List *options)
+{
+	ListCell   *lc;
+
+	foreach(lc, options)
+	{
+		DefElem    *opt = (DefElem *) lfirst(lc);
+
+		if (strcmp(opt->defname, "analyze") == 0)
+			n->options |= VACOPT_ANALYZE;
+		else if (strcmp(opt->defname, "verbose") == 0)
+			n->options |= VACOPT_VERBOSE;
+		else if (strcmp(opt->defname, "freeze") == 0)
+			n->options |= VACOPT_FREEZE;
+		else if (strcmp(opt->defname, "full") == 0)
+			n->options |= VACOPT_FULL;
+		else if (strcmp(opt->defname, "parallel") == 0)
+			n->parallel_workers = intVal(opt->arg);
+		else
+			elog(ERROR, "unrecognized VACUUM option \"%s\"", opt->defname);
+	}
+}
+
 /*
  * Process result of ConstraintAttributeSpec, and set appropriate bool flags
  * in the output command node.  Pass NULL for any flags the particular
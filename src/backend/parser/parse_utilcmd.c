@@ -32,6 +32,7 @@
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/namespace.h"
+#include "catalog/partition.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_opclass.h"
@@ -44,8 +45,10 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "parser/analyze.h"
 #include "parser/parse_clause.h"
+#include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_relation.h"
@@ -123,6 +126,8 @@ static void transformConstraintAttrs(CreateStmtContext *cxt,
 						 List *constraintList);
 static void transformColumnType(CreateStmtContext *cxt, ColumnDef *column);
 static void setSchemaName(char *context_schema, char **stmt_schema_name);
+static Const *transformPartitionBoundValue(Node *val, char *colname,
+							 Oid parttypid, int32 parttypmod);
 
 
 /*
@@ -2795,3 +2800,118 @@ setSchemaName(char *context_schema, char **stmt_schema_name)
 						"different from the one being created (%s)",
 						*stmt_schema_name, context_schema)));
 }
+
+/*
+ * transformPartitionBound
+ *		Transform a partition bound specification for a new partition of
+ *		parent.
+ *
+ * Each value is coerced to the type of the partition key column and
+ * reduced to a Const, which is the form stored in pg_inherits.inhpartbound.
+ */
+PartitionBoundSpec *
+transformPartitionBound(Relation parent, PartitionBoundSpec *spec)
+{
+	PartitionKey key = RelationGetPartitionKey(parent);
+	char		strategy;
+	Oid			parttypid;
+	int32		parttypmod;
+	char	   *colname;
+	PartitionBoundSpec *result;
+	ListCell   *lc;
+
+	if (key == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not partitioned",
+						RelationGetRelationName(parent))));
+
+	/* copy what we need, since catalog lookups may reset key */
+	strategy = key->strategy;
+	parttypid = key->parttypid;
+	parttypmod = key->parttypmod;
+	colname = get_attname(RelationGetRelid(parent), key->partattr);
+
+	if (spec->strategy != strategy)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg(strategy == PARTITION_STRATEGY_LIST ?
+						"invalid bound specification for a list partition" :
+						"invalid bound specification for a range partition"),
+				 parser_errposition(NULL, spec->location)));
+
+	result = makeNode(PartitionBoundSpec);
+	result->strategy = spec->strategy;
+	result->location = spec->location;
+
+	if (strategy == PARTITION_STRATEGY_LIST)
+	{
+		foreach(lc, spec->listdatums)
+			result->listdatums = lappend(result->listdatums,
+							transformPartitionBoundValue((Node *) lfirst(lc),
+														 colname, parttypid,
+														 parttypmod));
+	}
+	else
+	{
+		Const	   *lower = NULL;
+		Const	   *upper = NULL;
+
+		if (spec->lowerdatum)
+			lower = transformPartitionBoundValue(spec->lowerdatum, colname,
+												 parttypid, parttypmod);
+		if (spec->upperdatum)
+			upper = transformPartitionBoundValue(spec->upperdatum, colname,
+												 parttypid, parttypmod);
+
+		if ((lower && lower->constisnull) || (upper && upper->constisnull))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+					 errmsg("cannot specify NULL in range bound"),
+					 parser_errposition(NULL, spec->location)));
+
+		result->lowerdatum = (Node *) lower;
+		result->upperdatum = (Node *) upper;
+	}
+
+	return result;
+}
+
+/*
+ * transformPartitionBoundValue
+ *		Coerce one value of a partition bound to the key column's type.
+ */
+static Const *
+transformPartitionBoundValue(Node *val, char *colname,
+							 Oid parttypid, int32 parttypmod)
+{
+	A_Const    *con = (A_Const *) val;
+	Node	   *expr;
+
+	Assert(IsA(con, A_Const));
+
+	expr = (Node *) make_const(NULL, &con->val, con->location);
+	expr = coerce_to_target_type(NULL, expr, exprType(expr),
+								 parttypid, parttypmod,
+								 COERCION_ASSIGNMENT,
+								 COERCE_IMPLICIT_CAST,
+								 -1);
+	if (expr == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("specified value cannot be cast to type %s of column \"%s\"",
+						format_type_be(parttypid), colname),
+				 parser_errposition(NULL, con->location)));
+
+	/* The coercion functions are immutable, so this gives a Const */
+	assign_expr_collations(NULL, expr);
+	expr = eval_const_expressions(NULL, expr);
+	if (!IsA(expr, Const))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+				 errmsg("partition bound for column \"%s\" must be a constant",
+						colname),
+				 parser_errposition(NULL, con->location)));
+
+	return (Const *) expr;
+}
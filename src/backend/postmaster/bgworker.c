@@ -17,6 +17,7 @@
 
 #include "miscadmin.h"
 #include "libpq/pqsignal.h"
+#include "mb/pg_wchar.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/postmaster.h"
 #include "storage/barrier.h"
@@ -960,3 +961,97 @@ TerminateBackgroundWorker(BackgroundWorkerHandle *handle)
 	if (signal_postmaster)
 		SendPostmasterSignal(PMSIGNAL_BACKGROUND_WORKER_CHANGE);
 }
+
+/*
+ * Initialize the space for a worker's error, before launching the worker.
+ */
+void
+BackgroundWorkerInitError(BackgroundWorkerError *error)
+{
+	SpinLockInit(&error->mutex);
+	error->haserror = false;
+}
+
+/*
+ * Copy a string into a fixed-size buffer of a BackgroundWorkerError,
+ * truncating it at a character boundary if it doesn't fit.
+ */
+static void
+save_error_string(char *dst, const char *src)
+{
+	int			len;
+
+	if (src == NULL)
+	{
+		dst[0] = '\0';
+		return;
+	}
+	len = strlen(src);
+	if (len >= BGW_ERROR_MSGLEN)
+		len = pg_mbcliplen(src, len, BGW_ERROR_MSGLEN - 1);
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
+
+/*
+ * Save the error being handled, for the backend that launched us.
+ *
+ * To be called by a dynamic background worker in a PG_CATCH block, which
+ * then re-throws the error.  Only the first error is kept.
+ */
+void
+BackgroundWorkerSaveError(BackgroundWorkerError *error)
+{
+	volatile BackgroundWorkerError *verror = error;
+	ErrorData  *edata;
+	bool		haserror;
+
+	SpinLockAcquire(&verror->mutex);
+	haserror = verror->haserror;
+	SpinLockRelease(&verror->mutex);
+	if (haserror)
+		return;
+
+	edata = CopyErrorData();
+
+	save_error_string(error->message, edata->message);
+	save_error_string(error->detail, edata->detail);
+	save_error_string(error->hint, edata->hint);
+	save_error_string(error->context, edata->context);
+
+	SpinLockAcquire(&verror->mutex);
+	verror->sqlerrcode = edata->sqlerrcode;
+	verror->haserror = true;
+	SpinLockRelease(&verror->mutex);
+
+	FreeErrorData(edata);
+}
+
+/*
+ * Report the error a worker saved, if any, as an ERROR of our own.
+ *
+ * The worker must have exited, or at least be past the point of saving an
+ * error.  workername goes into the error context.  Returns if the worker
+ * saved no error.
+ */
+void
+BackgroundWorkerRethrowError(BackgroundWorkerError *error,
+							 const char *workername)
+{
+	volatile BackgroundWorkerError *verror = error;
+	bool		haserror;
+
+	SpinLockAcquire(&verror->mutex);
+	haserror = verror->haserror;
+	SpinLockRelease(&verror->mutex);
+	if (!haserror)
+		return;
+
+	ereport(ERROR,
+			(errcode(error->sqlerrcode),
+			 errmsg_internal("%s", error->message),
+			 error->detail[0] ? errdetail_internal("%s", error->detail) : 0,
+			 error->hint[0] ? errhint("%s", error->hint) : 0,
+			 error->context[0] ? errcontext("%s", error->context) : 0,
+			 errcontext("%s", workername)));
+}
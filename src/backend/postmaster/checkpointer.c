@@ -411,6 +411,13 @@ CheckpointerMain(void)
 			ExitOnAnyError = true;
 			/* Close down the database */
 			ShutdownXLOG(0, 0);
+
+			/*
+			 * Save the activity statistics, so that they survive the
+			 * restart.  All regular backends are gone by now.
+			 */
+			pgstat_send_bgwriter();
+			pgstat_write_statsfile();
 			/* Normal exit from the checkpointer is here */
 			proc_exit(0);		/* done */
 		}
@@ -44,7 +44,6 @@
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/latch.h"
-#include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "utils/guc.h"
 #include "utils/ps_status.h"
@@ -163,9 +162,13 @@ pgarch_start(void)
 			/* Lose the postmaster's on-exit routines */
 			on_exit_reset();
 
-			/* Drop our connection to postmaster's shared memory, as well */
+			/*
+			 * Drop our connection to dynamic shared memory, as well.  We stay
+			 * attached to the main shared memory segment, but only to report
+			 * our statistics, which are protected by a spinlock: the archiver
+			 * has no PGPROC and must not touch anything else there.
+			 */
 			dsm_detach_all();
-			PGSharedMemoryDetach();
 
 			PgArchiverMain(0, NULL);
 			break;
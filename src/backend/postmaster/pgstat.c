@@ -1,9 +1,9 @@
 /* ----------
  * pgstat.c
  *
- *	All the statistics collector stuff hacked up in one big, ugly file.
+ *	All the statistics stuff hacked up in one big, ugly file.
  *
- *	TODO:	- Separate collector, postmaster and backend stuff
+ *	TODO:	- Separate shared-memory, postmaster and backend stuff
  *			  into different files.
  *
  *			- Add some automatic call for pgstat vacuuming.
@@ -22,10 +22,6 @@
 #include <fcntl.h>
 #include <sys/param.h>
 #include <sys/time.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <signal.h>
 #include <time.h>
 
@@ -38,29 +34,24 @@
 #include "access/xact.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
-#include "lib/ilist.h"
-#include "libpq/ip.h"
 #include "libpq/libpq.h"
-#include "libpq/pqsignal.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "postmaster/autovacuum.h"
-#include "postmaster/fork_process.h"
 #include "postmaster/postmaster.h"
 #include "storage/proc.h"
 #include "storage/backendid.h"
-#include "storage/dsm.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
-#include "storage/latch.h"
-#include "storage/pg_shmem.h"
+#include "storage/lwlock.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "storage/sinvaladt.h"
+#include "storage/spin.h"
 #include "utils/ascii.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
-#include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
@@ -79,34 +70,27 @@
  * Timer definitions.
  * ----------
  */
-#define PGSTAT_STAT_INTERVAL	500		/* Minimum time between stats file
-										 * updates; in milliseconds. */
-
-#define PGSTAT_RETRY_DELAY		10		/* How long to wait between checks for
-										 * a new file; in milliseconds. */
-
-#define PGSTAT_MAX_WAIT_TIME	10000	/* Maximum time to wait for a stats
-										 * file update; in milliseconds. */
-
-#define PGSTAT_INQ_INTERVAL		640		/* How often to ping the collector for
-										 * a new file; in milliseconds. */
-
-#define PGSTAT_RESTART_INTERVAL 60		/* How often to attempt to restart a
-										 * failed statistics collector; in
-										 * seconds. */
-
-#define PGSTAT_POLL_LOOP_COUNT	(PGSTAT_MAX_WAIT_TIME / PGSTAT_RETRY_DELAY)
-#define PGSTAT_INQ_LOOP_COUNT	(PGSTAT_INQ_INTERVAL / PGSTAT_RETRY_DELAY)
+#define PGSTAT_STAT_INTERVAL	500		/* Minimum time between reports of
+										 * table and function counts; in
+										 * milliseconds. */
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the local snapshot hash tables.
  * ----------
  */
 #define PGSTAT_DB_HASH_SIZE		16
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
 
+/* ----------
+ * Maximum number of databases in the shared statistics.  Tables and
+ * functions are limited by the stats_max_tables and stats_max_functions
+ * GUCs instead.
+ * ----------
+ */
+#define PGSTAT_SHARED_DB_HASH_SIZE	1024
+
 
 /* ----------
  * GUC parameters
@@ -116,6 +100,8 @@ bool		pgstat_track_activities = false;
 bool		pgstat_track_counts = false;
 int			pgstat_track_functions = TRACK_FUNC_OFF;
 int			pgstat_track_activity_query_size = 1024;
+int			pgstat_max_tables = 10000;
+int			pgstat_max_functions = 1000;
 
 /* ----------
  * Built from GUC parameter
@@ -133,22 +119,98 @@ char	   *pgstat_stat_tmpname = NULL;
 PgStat_MsgBgWriter BgWriterStats;
 
 /* ----------
- * Local data
+ * Statistics kept in shared memory
+ *
+ * The statistics of all databases live in shared hash tables.  There is
+ * one with an entry per database, protected by PgStatDBLock.  Backends
+ * reporting their activity take that lock only in shared mode, and add to
+ * the counters of their database's entry under the entry's spinlock; adding
+ * or removing entries, and any other change to them, needs the lock in
+ * exclusive mode.
+ *
+ * The table entries are split NUM_PGSTAT_PARTITIONS ways by hash code, into
+ * separate hash tables that each have their own lock, so that reporting
+ * backends hardly ever contend, and so that the entries can be copied or
+ * scanned one partition at a time, without blocking all writers at once.
+ *
+ * Finally, there is one hash table with an entry per function, protected by
+ * PgStatFuncLock.  Where more than one of these locks is needed, they are
+ * taken in the order given here.  Table and function entries are keyed by
+ * database and object OID together.
+ *
+ * The cluster-wide statistics are protected by a spinlock, because the
+ * archiver reports its statistics without having a PGPROC.
  * ----------
  */
-NON_EXEC_STATIC pgsocket pgStatSock = PGINVALID_SOCKET;
+typedef struct PgStat_SharedObjectKey
+{
+	Oid			databaseid;		/* database, or InvalidOid for shared rels */
+	Oid			objectid;		/* table or function OID */
+} PgStat_SharedObjectKey;
+
+typedef struct PgStat_SharedDBEntry
+{
+	PgStat_StatDBEntry stats;	/* hash key is stats.databaseid (first) */
+	slock_t		mutex;			/* protects the counters in stats */
+} PgStat_SharedDBEntry;
+
+#define PgStatDBEntryMutex(dbentry) \
+	(&((PgStat_SharedDBEntry *) (dbentry))->mutex)
+
+typedef struct PgStat_SharedTabEntry
+{
+	PgStat_SharedObjectKey key; /* hash key (must be first) */
+	PgStat_StatTabEntry stats;
+} PgStat_SharedTabEntry;
 
-static Latch pgStatLatch;
+typedef struct PgStat_SharedFuncEntry
+{
+	PgStat_SharedObjectKey key; /* hash key (must be first) */
+	PgStat_StatFuncEntry stats;
+} PgStat_SharedFuncEntry;
+
+struct PgStat_SharedGlobal
+{
+	slock_t		mutex;			/* protects the following fields */
+	PgStat_GlobalStats globalStats;
+	PgStat_ArchiverStats archiverStats;
 
-static struct sockaddr_storage pgStatAddr;
+	/* have we complained that a hash table is full? */
+	bool		dbHashFull;
+	bool		tabHashFull;
+	bool		funcHashFull;
+};
 
-static time_t last_pgstat_start_time;
+/*
+ * The partition is chosen by the high-order bits of the hash code, since
+ * dynahash uses the low-order bits to choose a bucket within each table.
+ */
+#define PgStatHashPartition(hashcode) \
+	((hashcode) / ((uint32) 0xFFFFFFFF / NUM_PGSTAT_PARTITIONS + 1))
+#define PgStatPartitionLock(hashcode) \
+	(&MainLWLockArray[PGSTAT_LWLOCK_OFFSET + \
+		PgStatHashPartition(hashcode)].lock)
+#define PgStatPartitionLockByIndex(i) \
+	(&MainLWLockArray[PGSTAT_LWLOCK_OFFSET + (i)].lock)
+#define PgStatPartitionHash(hashcode) \
+	(pgStatSharedTabHash[PgStatHashPartition(hashcode)])
+#define PgStatTabHashCode(key) \
+	tag_hash((const void *) (key), sizeof(PgStat_SharedObjectKey))
+
+PgStat_SharedGlobal *pgStatShared = NULL;
+
+static HTAB *pgStatSharedDBHash = NULL;
+static HTAB *pgStatSharedTabHash[NUM_PGSTAT_PARTITIONS];
+static HTAB *pgStatSharedFuncHash = NULL;
 
-static bool pgStatRunningInCollector = false;
+/* ----------
+ * Local data
+ * ----------
+ */
 
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * reported to the shared statistics.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -169,14 +231,14 @@ typedef struct TabStatusArray
 static TabStatusArray *pgStatTabList = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be reported to the
+ * shared statistics in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * reported.
  */
 static bool have_function_stats = false;
 
@@ -212,7 +274,7 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Info about current "snapshot" of the shared statistics
  */
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
@@ -220,27 +282,12 @@ static LocalPgBackendStatus *localBackendStatusTable = NULL;
 static int	localNumBackends = 0;
 
 /*
- * Cluster wide statistics, kept in the stats collector.
- * Contains statistics that are not collected per database
- * or per table.
+ * Snapshot of the cluster wide statistics, which are not collected per
+ * database or per table.
  */
 static PgStat_ArchiverStats archiverStats;
 static PgStat_GlobalStats globalStats;
 
-/* Write request info for each database */
-typedef struct DBWriteRequest
-{
-	Oid			databaseid;		/* OID of the database to write */
-	TimestampTz request_time;	/* timestamp of the last write request */
-	slist_node	next;
-} DBWriteRequest;
-
-/* Latest statistics request times from backends */
-static slist_head last_statrequests = SLIST_STATIC_INIT(last_statrequests);
-
-static volatile bool need_exit = false;
-static volatile bool got_SIGHUP = false;
-
 /*
  * Total time charged to functions so far in the current backend.
  * We use this to help separate "self" and "other" time charges.
@@ -253,28 +300,16 @@ static instr_time total_func_time;
  * Local function forward declarations
  * ----------
  */
-#ifdef EXEC_BACKEND
-static pid_t pgstat_forkexec(void);
-#endif
-
-NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) __attribute__((noreturn));
-static void pgstat_exit(SIGNAL_ARGS);
 static void pgstat_beshutdown_hook(int code, Datum arg);
-static void pgstat_sighup_handler(SIGNAL_ARGS);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-					 Oid tableoid, bool create);
-static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
-static void backend_read_statsfile(void);
+static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_SharedObjectKey *key,
+					 uint32 hashcode, bool create);
+static void pgstat_create_db_entry(Oid databaseid);
+static void pgstat_remove_db_objects(Oid databaseid);
+static void pgstat_build_snapshot(void);
 static void pgstat_read_current_status(void);
 
-static bool pgstat_write_statsfile_needed(void);
-static bool pgstat_db_requested(Oid databaseid);
-
 static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
 static void pgstat_send_funcstats(void);
 static HTAB *pgstat_collect_oids(Oid catalogid);
@@ -282,11 +317,14 @@ static HTAB *pgstat_collect_oids(Oid catalogid);
 static PgStat_TableStatus *get_tabstat_entry(Oid rel_id, bool isshared);
 
 static void pgstat_setup_memcxt(void);
+static bool pgstat_first_overflow(bool *reported);
+static void pgstat_report_db_overflow(void);
+static void pgstat_report_tab_overflow(void);
+static void pgstat_report_func_overflow(void);
 
 static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
 
-static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
 static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
 static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
@@ -309,263 +347,116 @@ static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
  * ------------------------------------------------------------
  */
 
-/* ----------
- * pgstat_init() -
- *
- *	Called from postmaster at startup. Create the resources required
- *	by the statistics collector process.  If unable to do so, do not
- *	fail --- better to let the postmaster start with stats collection
- *	disabled.
- * ----------
+/*
+ * Number of entries in each partition of the shared table statistics.
+ * Round up, and leave some room for the partitions not being filled evenly.
  */
-void
-pgstat_init(void)
+static long
+pgstat_tab_partition_size(void)
 {
-	ACCEPT_TYPE_ARG3 alen;
-	struct addrinfo *addrs = NULL,
-			   *addr,
-				hints;
-	int			ret;
-	fd_set		rset;
-	struct timeval tv;
-	char		test_byte;
-	int			sel_res;
-	int			tries = 0;
-
-#define TESTBYTEVAL ((char) 199)
-
-	/*
-	 * This static assertion verifies that we didn't mess up the calculations
-	 * involved in selecting maximum payload sizes for our UDP messages.
-	 * Because the only consequence of overrunning PGSTAT_MAX_MSG_SIZE would
-	 * be silent performance loss from fragmentation, it seems worth having a
-	 * compile-time cross-check that we didn't.
-	 */
-	StaticAssertStmt(sizeof(PgStat_Msg) <= PGSTAT_MAX_MSG_SIZE,
-				   "maximum stats message size exceeds PGSTAT_MAX_MSG_SIZE");
-
-	/*
-	 * Create the UDP socket for sending and receiving statistic messages
-	 */
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = SOCK_DGRAM;
-	hints.ai_protocol = 0;
-	hints.ai_addrlen = 0;
-	hints.ai_addr = NULL;
-	hints.ai_canonname = NULL;
-	hints.ai_next = NULL;
-	ret = pg_getaddrinfo_all("localhost", NULL, &hints, &addrs);
-	if (ret || !addrs)
-	{
-		ereport(LOG,
-				(errmsg("could not resolve \"localhost\": %s",
-						gai_strerror(ret))));
-		goto startup_failed;
-	}
-
-	/*
-	 * On some platforms, pg_getaddrinfo_all() may return multiple addresses
-	 * only one of which will actually work (eg, both IPv6 and IPv4 addresses
-	 * when kernel will reject IPv6).  Worse, the failure may occur at the
-	 * bind() or perhaps even connect() stage.	So we must loop through the
-	 * results till we find a working combination. We will generate LOG
-	 * messages, but no error, for bogus combinations.
-	 */
-	for (addr = addrs; addr; addr = addr->ai_next)
-	{
-#ifdef HAVE_UNIX_SOCKETS
-		/* Ignore AF_UNIX sockets, if any are returned. */
-		if (addr->ai_family == AF_UNIX)
-			continue;
-#endif
-
-		if (++tries > 1)
-			ereport(LOG,
-			(errmsg("trying another address for the statistics collector")));
-
-		/*
-		 * Create the socket.
-		 */
-		if ((pgStatSock = socket(addr->ai_family, SOCK_DGRAM, 0)) == PGINVALID_SOCKET)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			errmsg("could not create socket for statistics collector: %m")));
-			continue;
-		}
-
-		/*
-		 * Bind it to a kernel assigned port on localhost and get the assigned
-		 * port via getsockname().
-		 */
-		if (bind(pgStatSock, addr->ai_addr, addr->ai_addrlen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			  errmsg("could not bind socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		alen = sizeof(pgStatAddr);
-		if (getsockname(pgStatSock, (struct sockaddr *) & pgStatAddr, &alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not get address of socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	long		size;
 
-		/*
-		 * Connect the socket to its own address.  This saves a few cycles by
-		 * not having to respecify the target address on every send. This also
-		 * provides a kernel-level check that only packets from this same
-		 * address will be received.
-		 */
-		if (connect(pgStatSock, (struct sockaddr *) & pgStatAddr, alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			errmsg("could not connect socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	size = (pgstat_max_tables + NUM_PGSTAT_PARTITIONS - 1) /
+		NUM_PGSTAT_PARTITIONS;
 
-		/*
-		 * Try to send and receive a one-byte test message on the socket. This
-		 * is to catch situations where the socket can be created but will not
-		 * actually pass data (for instance, because kernel packet filtering
-		 * rules prevent it).
-		 */
-		test_byte = TESTBYTEVAL;
+	return size + size / 8;
+}
 
-retry1:
-		if (send(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry1;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not send test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+/* ----------
+ * StatsShmemSize() -
+ *
+ *	Report the amount of shared memory needed for the shared statistics.
+ * ----------
+ */
+Size
+StatsShmemSize(void)
+{
+	Size		size;
+	Size		tabsize;
 
-		/*
-		 * There could possibly be a little delay before the message can be
-		 * received.  We arbitrarily allow up to half a second before deciding
-		 * it's broken.
-		 */
-		for (;;)				/* need a loop to handle EINTR */
-		{
-			FD_ZERO(&rset);
-			FD_SET(pgStatSock, &rset);
+	size = MAXALIGN(sizeof(PgStat_SharedGlobal));
+	size = add_size(size, hash_estimate_size(PGSTAT_SHARED_DB_HASH_SIZE,
+											 sizeof(PgStat_SharedDBEntry)));
+	tabsize = hash_estimate_size(pgstat_tab_partition_size(),
+								 sizeof(PgStat_SharedTabEntry));
+	size = add_size(size, mul_size(tabsize, NUM_PGSTAT_PARTITIONS));
+	size = add_size(size, hash_estimate_size(pgstat_max_functions,
+											 sizeof(PgStat_SharedFuncEntry)));
 
-			tv.tv_sec = 0;
-			tv.tv_usec = 500000;
-			sel_res = select(pgStatSock + 1, &rset, NULL, NULL, &tv);
-			if (sel_res >= 0 || errno != EINTR)
-				break;
-		}
-		if (sel_res < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("select() failed in statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-		if (sel_res == 0 || !FD_ISSET(pgStatSock, &rset))
-		{
-			/*
-			 * This is the case we actually think is likely, so take pains to
-			 * give a specific message for it.
-			 *
-			 * errno will not be set meaningfully here, so don't use it.
-			 */
-			ereport(LOG,
-					(errcode(ERRCODE_CONNECTION_FAILURE),
-					 errmsg("test message did not get through on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	return size;
+}
 
-		test_byte++;			/* just make sure variable is changed */
+/* ----------
+ * StatsShmemInit() -
+ *
+ *	Initialize the shared statistics during postmaster startup, or attach
+ *	to them in an EXEC_BACKEND child.  The statistics start out empty; the
+ *	startup process loads the ones saved at the last shutdown, if any.
+ * ----------
+ */
+void
+StatsShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	long		tabsize;
+	int			i;
 
-retry2:
-		if (recv(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry2;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not receive test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	pgStatShared = (PgStat_SharedGlobal *)
+		ShmemInitStruct("Shared Statistics", sizeof(PgStat_SharedGlobal),
+						&found);
 
-		if (test_byte != TESTBYTEVAL)	/* strictly paranoia ... */
-		{
-			ereport(LOG,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("incorrect test message transmission on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	if (!found)
+	{
+		TimestampTz now = GetCurrentTimestamp();
 
-		/* If we get here, we have a working socket */
-		break;
+		MemSet(pgStatShared, 0, sizeof(PgStat_SharedGlobal));
+		SpinLockInit(&pgStatShared->mutex);
+		pgStatShared->globalStats.stat_reset_timestamp = now;
+		pgStatShared->archiverStats.stat_reset_timestamp = now;
 	}
 
-	/* Did we find a working address? */
-	if (!addr || pgStatSock == PGINVALID_SOCKET)
-		goto startup_failed;
-
 	/*
-	 * Set the socket to non-blocking IO.  This ensures that if the collector
-	 * falls behind, statistics messages will be discarded; backends won't
-	 * block waiting to send messages to the collector.
+	 * The hash tables are sized for their maximum number of entries, like
+	 * the lock manager's; there's no way to enlarge them later.
 	 */
-	if (!pg_set_noblock(pgStatSock))
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(PgStat_SharedDBEntry);
+	info.hash = oid_hash;
+	pgStatSharedDBHash = ShmemInitHash("Shared Statistics Databases",
+									   PGSTAT_SHARED_DB_HASH_SIZE,
+									   PGSTAT_SHARED_DB_HASH_SIZE,
+									   &info,
+									   HASH_ELEM | HASH_FUNCTION);
+
+	tabsize = pgstat_tab_partition_size();
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
 	{
-		ereport(LOG,
-				(errcode_for_socket_access(),
-				 errmsg("could not set statistics collector socket to nonblocking mode: %m")));
-		goto startup_failed;
+		char		name[64];
+
+		snprintf(name, sizeof(name), "Shared Statistics Tables %d", i);
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(PgStat_SharedObjectKey);
+		info.entrysize = sizeof(PgStat_SharedTabEntry);
+		info.hash = tag_hash;
+		pgStatSharedTabHash[i] = ShmemInitHash(name,
+											   tabsize,
+											   tabsize,
+											   &info,
+											   HASH_ELEM | HASH_FUNCTION);
 	}
 
-	pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	return;
-
-startup_failed:
-	ereport(LOG,
-	  (errmsg("disabling statistics collector for lack of working socket")));
-
-	if (addrs)
-		pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	if (pgStatSock != PGINVALID_SOCKET)
-		closesocket(pgStatSock);
-	pgStatSock = PGINVALID_SOCKET;
-
-	/*
-	 * Adjust GUC variables to suppress useless activity, and for debugging
-	 * purposes (seeing track_counts off is a clue that we failed here). We
-	 * use PGC_S_OVERRIDE because there is no point in trying to turn it back
-	 * on from postgresql.conf without a restart.
-	 */
-	SetConfigOption("track_counts", "off", PGC_INTERNAL, PGC_S_OVERRIDE);
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(PgStat_SharedObjectKey);
+	info.entrysize = sizeof(PgStat_SharedFuncEntry);
+	info.hash = tag_hash;
+	pgStatSharedFuncHash = ShmemInitHash("Shared Statistics Functions",
+										 pgstat_max_functions,
+										 pgstat_max_functions,
+										 &info,
+										 HASH_ELEM | HASH_FUNCTION);
 }
 
 /*
@@ -586,7 +477,8 @@ pgstat_reset_remove_files(const char *directory)
 
 		/*
 		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
+		 * Per-database "db_<oid>" files are no longer written, but remove
+		 * any that were left behind by a statistics collector process.
 		 */
 		if (strncmp(entry->d_name, "global.", 7) == 0)
 			nchars = 7;
@@ -626,111 +518,6 @@ pgstat_reset_all(void)
 	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
 }
 
-#ifdef EXEC_BACKEND
-
-/*
- * pgstat_forkexec() -
- *
- * Format up the arglist for, then fork and exec, statistics collector process
- */
-static pid_t
-pgstat_forkexec(void)
-{
-	char	   *av[10];
-	int			ac = 0;
-
-	av[ac++] = "postgres";
-	av[ac++] = "--forkcol";
-	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
-
-	av[ac] = NULL;
-	Assert(ac < lengthof(av));
-
-	return postmaster_forkexec(ac, av);
-}
-#endif   /* EXEC_BACKEND */
-
-
-/*
- * pgstat_start() -
- *
- *	Called from postmaster at startup or after an existing collector
- *	died.  Attempt to fire up a fresh statistics collector.
- *
- *	Returns PID of child process, or 0 if fail.
- *
- *	Note: if fail, we will be called again from the postmaster main loop.
- */
-int
-pgstat_start(void)
-{
-	time_t		curtime;
-	pid_t		pgStatPid;
-
-	/*
-	 * Check that the socket is there, else pgstat_init failed and we can do
-	 * nothing useful.
-	 */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return 0;
-
-	/*
-	 * Do nothing if too soon since last collector start.  This is a safety
-	 * valve to protect against continuous respawn attempts if the collector
-	 * is dying immediately at launch.	Note that since we will be re-called
-	 * from the postmaster main loop, we will get another chance later.
-	 */
-	curtime = time(NULL);
-	if ((unsigned int) (curtime - last_pgstat_start_time) <
-		(unsigned int) PGSTAT_RESTART_INTERVAL)
-		return 0;
-	last_pgstat_start_time = curtime;
-
-	/*
-	 * Okay, fork off the collector.
-	 */
-#ifdef EXEC_BACKEND
-	switch ((pgStatPid = pgstat_forkexec()))
-#else
-	switch ((pgStatPid = fork_process()))
-#endif
-	{
-		case -1:
-			ereport(LOG,
-					(errmsg("could not fork statistics collector: %m")));
-			return 0;
-
-#ifndef EXEC_BACKEND
-		case 0:
-			/* in postmaster child ... */
-			/* Close the postmaster's sockets */
-			ClosePostmasterPorts(false);
-
-			/* Lose the postmaster's on-exit routines */
-			on_exit_reset();
-
-			/* Drop our connection to postmaster's shared memory, as well */
-			dsm_detach_all();
-			PGSharedMemoryDetach();
-
-			PgstatCollectorMain(0, NULL);
-			break;
-#endif
-
-		default:
-			return (int) pgStatPid;
-	}
-
-	/* shouldn't get here */
-	return 0;
-}
-
-void
-allow_immediate_pgstat_restart(void)
-{
-	last_pgstat_start_time = 0;
-}
-
 /* ------------------------------------------------------------
  * Public functions used by backends follow
  *------------------------------------------------------------
@@ -741,7 +528,7 @@ allow_immediate_pgstat_restart(void)
  * pgstat_report_stat() -
  *
  *	Called from tcop/postgres.c to send the so far collected per-table
- *	and function usage statistics to the collector.  Note that this is
+ *	and function usage statistics to the shared statistics.  Note that this is
  *	called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  * ----------
@@ -847,8 +634,7 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 	int			n;
 	int			len;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	/*
@@ -941,7 +727,7 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Get rid of the statistics of objects that no longer exist.
  * ----------
  */
 void
@@ -956,14 +742,14 @@ pgstat_vacuum_stat(void)
 	PgStat_StatFuncEntry *funcentry;
 	int			len;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.
 	 */
-	backend_read_statsfile();
+	pgstat_build_snapshot();
 
 	/*
 	 * Read pg_database and make a list of OIDs of all existing databases
@@ -971,8 +757,8 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(DatabaseRelationId);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases and drop their
+	 * statistics.
 	 */
 	hash_seq_init(&hstat, pgStatDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
@@ -1168,8 +954,8 @@ pgstat_collect_oids(Oid catalogid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
+ *	Forget the statistics of a database we just dropped.
+ *	(If we fail to get here, we will still clean the dead DB eventually
  *	via future invocations of pgstat_vacuum_stat().)
  * ----------
  */
@@ -1178,7 +964,7 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DROPDB);
@@ -1190,8 +976,8 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
+ *	Forget the statistics of a relation we just dropped.
+ *	(If we fail to get here, we will still clean the dead entry eventually
  *	via future invocations of pgstat_vacuum_stat().)
  *
  *	Currently not used for lack of any good place to call it; we rely
@@ -1205,7 +991,7 @@ pgstat_drop_relation(Oid relid)
 	PgStat_MsgTabpurge msg;
 	int			len;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	msg.m_tableid[0] = relid;
@@ -1223,7 +1009,7 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset counters for our database.
  * ----------
  */
 void
@@ -1231,7 +1017,7 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	if (!superuser())
@@ -1247,7 +1033,7 @@ pgstat_reset_counters(void)
 /* ----------
  * pgstat_reset_shared_counters() -
  *
- *	Tell the statistics collector to reset cluster-wide shared counters.
+ *	Reset cluster-wide shared counters.
  * ----------
  */
 void
@@ -1255,7 +1041,7 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	if (!superuser())
@@ -1280,7 +1066,7 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset a single counter.
  * ----------
  */
 void
@@ -1288,7 +1074,7 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	if (!superuser())
@@ -1317,7 +1103,7 @@ pgstat_report_autovac(Oid dboid)
 {
 	PgStat_MsgAutovacStart msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_AUTOVAC_START);
@@ -1331,7 +1117,7 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Report the table we just vacuumed.
  * ---------
  */
 void
@@ -1340,7 +1126,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared,
 {
 	PgStat_MsgVacuum msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatShared == NULL || !pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
@@ -1356,7 +1142,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared,
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Report the table we just analyzed.
  * --------
  */
 void
@@ -1365,7 +1151,7 @@ pgstat_report_analyze(Relation rel,
 {
 	PgStat_MsgAnalyze msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatShared == NULL || !pgstat_track_counts)
 		return;
 
 	/*
@@ -1373,9 +1159,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
+	 * off these counts from what we report now, else they'll
 	 * be double-counted after commit.	(This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
+	 * shared statistics end up with the right numbers if we abort instead of
 	 * committing.)
 	 */
 	if (rel->pgstat_info != NULL)
@@ -1407,7 +1193,7 @@ pgstat_report_analyze(Relation rel,
 /* --------
  * pgstat_report_recovery_conflict() -
  *
- *	Tell the collector about a Hot Standby recovery conflict.
+ *	Report a Hot Standby recovery conflict.
  * --------
  */
 void
@@ -1415,7 +1201,7 @@ pgstat_report_recovery_conflict(int reason)
 {
 	PgStat_MsgRecoveryConflict msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatShared == NULL || !pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RECOVERYCONFLICT);
@@ -1427,7 +1213,7 @@ pgstat_report_recovery_conflict(int reason)
 /* --------
  * pgstat_report_deadlock() -
  *
- *	Tell the collector about a deadlock detected.
+ *	Report a deadlock detected.
  * --------
  */
 void
@@ -1435,7 +1221,7 @@ pgstat_report_deadlock(void)
 {
 	PgStat_MsgDeadlock msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatShared == NULL || !pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DEADLOCK);
@@ -1446,7 +1232,7 @@ pgstat_report_deadlock(void)
 /* --------
  * pgstat_report_tempfile() -
  *
- *	Tell the collector about a temporary file.
+ *	Report a temporary file.
  * --------
  */
 void
@@ -1454,7 +1240,7 @@ pgstat_report_tempfile(size_t filesize)
 {
 	PgStat_MsgTempFile msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatShared == NULL || !pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPFILE);
@@ -1464,43 +1250,6 @@ pgstat_report_tempfile(size_t filesize)
 }
 
 
-/* ----------
- * pgstat_ping() -
- *
- *	Send some junk data to the collector to increase traffic.
- * ----------
- */
-void
-pgstat_ping(void)
-{
-	PgStat_MsgDummy msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DUMMY);
-	pgstat_send(&msg, sizeof(msg));
-}
-
-/* ----------
- * pgstat_send_inquiry() -
- *
- *	Notify collector that we need fresh data.
- * ----------
- */
-static void
-pgstat_send_inquiry(TimestampTz clock_time, TimestampTz cutoff_time, Oid databaseid)
-{
-	PgStat_MsgInquiry msg;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_INQUIRY);
-	msg.clock_time = clock_time;
-	msg.cutoff_time = cutoff_time;
-	msg.databaseid = databaseid;
-	pgstat_send(&msg, sizeof(msg));
-}
-
-
 /*
  * Initialize function call usage data.
  * Called by the executor before invoking a function.
@@ -1652,7 +1401,7 @@ pgstat_initstats(Relation rel)
 		return;
 	}
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (pgStatShared == NULL || !pgstat_track_counts)
 	{
 		/* We're not counting at all */
 		rel->pgstat_info = NULL;
@@ -2092,7 +1841,7 @@ AtPrepare_PgStat(void)
  *
  * All we need do here is unlink the transaction stats state from the
  * nontransactional state.	The nontransactional action counts will be
- * reported to the stats collector immediately, while the effects on live
+ * reported to the shared statistics immediately, while the effects on live
  * and dead tuple counts are preserved in the 2PC state file.
  *
  * Note: AtEOXact_PgStat is not called during PREPARE.
@@ -2183,18 +1932,18 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one database or NULL. NULL doesn't mean
- *	that the database doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the database doesn't exist, it just has no statistics yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatDBEntry *
 pgstat_fetch_stat_dbentry(Oid dbid)
 {
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.
 	 */
-	backend_read_statsfile();
+	pgstat_build_snapshot();
 
 	/*
 	 * Lookup the requested database; return NULL if not found
@@ -2210,8 +1959,8 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it just has no statistics yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
@@ -2222,10 +1971,10 @@ pgstat_fetch_stat_tabentry(Oid relid)
 	PgStat_StatTabEntry *tabentry;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.
 	 */
-	backend_read_statsfile();
+	pgstat_build_snapshot();
 
 	/*
 	 * Lookup our database, then look in its table hash table.
@@ -2277,7 +2026,7 @@ pgstat_fetch_stat_funcentry(Oid func_id)
 	PgStat_StatFuncEntry *funcentry = NULL;
 
 	/* load the stats file if needed */
-	backend_read_statsfile();
+	pgstat_build_snapshot();
 
 	/* Lookup our database, then find the requested function.  */
 	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
@@ -2362,7 +2111,7 @@ pgstat_fetch_stat_numbackends(void)
 PgStat_ArchiverStats *
 pgstat_fetch_stat_archiver(void)
 {
-	backend_read_statsfile();
+	pgstat_build_snapshot();
 
 	return &archiverStats;
 }
@@ -2379,7 +2128,7 @@ pgstat_fetch_stat_archiver(void)
 PgStat_GlobalStats *
 pgstat_fetch_global(void)
 {
-	backend_read_statsfile();
+	pgstat_build_snapshot();
 
 	return &globalStats;
 }
@@ -2606,7 +2355,7 @@ pgstat_bestart(void)
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
+ * Flush any remaining statistics counts out to shared memory.
  * Without this, operations triggered during backend exit (such as
  * temp table deletions) won't be counted.
  *
@@ -2619,7 +2368,7 @@ pgstat_beshutdown_hook(int code, Datum arg)
 
 	/*
 	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
+	 * we did.  Otherwise, we'd be reporting an invalid
 	 * database ID, so forget it.  (This means that accesses to pg_database
 	 * during failed backend starts might never get counted.)
 	 */
@@ -2816,7 +2565,6 @@ pgstat_read_current_status(void)
 			   *localactivity;
 	int			i;
 
-	Assert(!pgStatRunningInCollector);
 	if (localBackendStatusTable)
 		return;					/* already done */
 
@@ -3061,37 +2809,104 @@ pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype)
 /* ----------
  * pgstat_send() -
  *
- *		Send out one statistics message to the collector
+ *		Apply one statistics message to the shared statistics
+ *
+ *	Backends still batch up what they have to report in the message formats
+ *	that used to be shipped to a separate collector process, but instead of
+ *	going through a socket the messages are now processed right here, by
+ *	the reporting process itself, against the shared hash tables.
  * ----------
  */
 static void
 pgstat_send(void *msg, int len)
 {
-	int			rc;
+	PgStat_MsgHdr *hdr = (PgStat_MsgHdr *) msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (pgStatShared == NULL)
 		return;
 
-	((PgStat_MsgHdr *) msg)->m_size = len;
+	hdr->m_size = len;
 
-	/* We'll retry after EINTR, but ignore all other failures */
-	do
+	switch (hdr->m_type)
 	{
-		rc = send(pgStatSock, msg, len, 0);
-	} while (rc < 0 && errno == EINTR);
-
-#ifdef USE_ASSERT_CHECKING
-	/* In debug builds, log send failures ... */
-	if (rc < 0)
-		elog(LOG, "could not send to statistics collector: %m");
-#endif
+		case PGSTAT_MTYPE_TABSTAT:
+			pgstat_recv_tabstat((PgStat_MsgTabstat *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_TABPURGE:
+			pgstat_recv_tabpurge((PgStat_MsgTabpurge *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_DROPDB:
+			pgstat_recv_dropdb((PgStat_MsgDropdb *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETCOUNTER:
+			pgstat_recv_resetcounter((PgStat_MsgResetcounter *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
+			pgstat_recv_resetsharedcounter((PgStat_MsgResetsharedcounter *) msg,
+										   len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSINGLECOUNTER:
+			pgstat_recv_resetsinglecounter((PgStat_MsgResetsinglecounter *) msg,
+										   len);
+			break;
+
+		case PGSTAT_MTYPE_AUTOVAC_START:
+			pgstat_recv_autovac((PgStat_MsgAutovacStart *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_VACUUM:
+			pgstat_recv_vacuum((PgStat_MsgVacuum *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_ANALYZE:
+			pgstat_recv_analyze((PgStat_MsgAnalyze *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_ARCHIVER:
+			pgstat_recv_archiver((PgStat_MsgArchiver *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_BGWRITER:
+			pgstat_recv_bgwriter((PgStat_MsgBgWriter *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCSTAT:
+			pgstat_recv_funcstat((PgStat_MsgFuncstat *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCPURGE:
+			pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RECOVERYCONFLICT:
+			pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) msg,
+										 len);
+			break;
+
+		case PGSTAT_MTYPE_DEADLOCK:
+			pgstat_recv_deadlock((PgStat_MsgDeadlock *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_TEMPFILE:
+			pgstat_recv_tempfile((PgStat_MsgTempFile *) msg, len);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized statistics message type: %d",
+				 (int) hdr->m_type);
+	}
 }
 
 /* ----------
  * pgstat_send_archiver() -
  *
- *	Tell the collector about the WAL file that we successfully
- *	archived or failed to archive.
+ *	Report the WAL file that we successfully archived or failed to
+ *	archive.
  * ----------
  */
 void
@@ -3112,7 +2927,7 @@ pgstat_send_archiver(const char *xlog, bool failed)
 /* ----------
  * pgstat_send_bgwriter() -
  *
- *		Send bgwriter statistics to the collector
+ *		Send bgwriter statistics to the shared statistics
  * ----------
  */
 void
@@ -3123,8 +2938,7 @@ pgstat_send_bgwriter(void)
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, avoid processing a completely empty message.
 	 */
 	if (memcmp(&BgWriterStats, &all_zeroes, sizeof(PgStat_MsgBgWriter)) == 0)
 		return;
@@ -3142,324 +2956,15 @@ pgstat_send_bgwriter(void)
 }
 
 
-/* ----------
- * PgstatCollectorMain() -
- *
- *	Start up the statistics collector process.	This is the body of the
- *	postmaster child process.
+/*
+ * Subroutine to clear stats in a database entry
  *
- *	The argc/argv parameters are valid only in EXEC_BACKEND case.
- * ----------
+ * The entry's tables and functions live in the shared hash tables keyed by
+ * database OID, so the hash table pointers of a shared entry are always NULL.
  */
-NON_EXEC_STATIC void
-PgstatCollectorMain(int argc, char *argv[])
+static void
+reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 {
-	int			len;
-	PgStat_Msg	msg;
-	int			wr;
-
-	IsUnderPostmaster = true;	/* we are a postmaster subprocess now */
-
-	MyProcPid = getpid();		/* reset MyProcPid */
-
-	MyStartTime = time(NULL);	/* record Start Time for logging */
-
-	/*
-	 * If possible, make this process a group leader, so that the postmaster
-	 * can signal any child processes too.	(pgstat probably never has any
-	 * child processes, but for consistency we make all postmaster child
-	 * processes do this.)
-	 */
-#ifdef HAVE_SETSID
-	if (setsid() < 0)
-		elog(FATAL, "setsid() failed: %m");
-#endif
-
-	InitializeLatchSupport();	/* needed for latch waits */
-
-	/* Initialize private latch for use by signal handlers */
-	InitLatch(&pgStatLatch);
-
-	/*
-	 * Ignore all signals usually bound to some action in the postmaster,
-	 * except SIGHUP and SIGQUIT.  Note we don't need a SIGUSR1 handler to
-	 * support latch operations, because pgStatLatch is local not shared.
-	 */
-	pqsignal(SIGHUP, pgstat_sighup_handler);
-	pqsignal(SIGINT, SIG_IGN);
-	pqsignal(SIGTERM, SIG_IGN);
-	pqsignal(SIGQUIT, pgstat_exit);
-	pqsignal(SIGALRM, SIG_IGN);
-	pqsignal(SIGPIPE, SIG_IGN);
-	pqsignal(SIGUSR1, SIG_IGN);
-	pqsignal(SIGUSR2, SIG_IGN);
-	pqsignal(SIGCHLD, SIG_DFL);
-	pqsignal(SIGTTIN, SIG_DFL);
-	pqsignal(SIGTTOU, SIG_DFL);
-	pqsignal(SIGCONT, SIG_DFL);
-	pqsignal(SIGWINCH, SIG_DFL);
-	PG_SETMASK(&UnBlockSig);
-
-	/*
-	 * Identify myself via ps
-	 */
-	init_ps_display("stats collector process", "", "", "");
-
-	/*
-	 * Read in an existing statistics stats file or initialize the stats to
-	 * zero.
-	 */
-	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
-
-	/*
-	 * Loop to process messages until we get SIGQUIT or detect ungraceful
-	 * death of our parent postmaster.
-	 *
-	 * For performance reasons, we don't want to do ResetLatch/WaitLatch after
-	 * every message; instead, do that only after a recv() fails to obtain a
-	 * message.  (This effectively means that if backends are sending us stuff
-	 * like mad, we won't notice postmaster death until things slack off a
-	 * bit; which seems fine.)	To do that, we have an inner loop that
-	 * iterates as long as recv() succeeds.  We do recognize got_SIGHUP inside
-	 * the inner loop, which means that such interrupts will get serviced but
-	 * the latch won't get cleared until next time there is a break in the
-	 * action.
-	 */
-	for (;;)
-	{
-		/* Clear any already-pending wakeups */
-		ResetLatch(&pgStatLatch);
-
-		/*
-		 * Quit if we get SIGQUIT from the postmaster.
-		 */
-		if (need_exit)
-			break;
-
-		/*
-		 * Inner loop iterates as long as we keep getting messages, or until
-		 * need_exit becomes set.
-		 */
-		while (!need_exit)
-		{
-			/*
-			 * Reload configuration if we got SIGHUP from the postmaster.
-			 */
-			if (got_SIGHUP)
-			{
-				got_SIGHUP = false;
-				ProcessConfigFile(PGC_SIGHUP);
-			}
-
-			/*
-			 * Write the stats file if a new request has arrived that is not
-			 * satisfied by existing file.
-			 */
-			if (pgstat_write_statsfile_needed())
-				pgstat_write_statsfiles(false, false);
-
-			/*
-			 * Try to receive and process a message.  This will not block,
-			 * since the socket is set to non-blocking mode.
-			 *
-			 * XXX On Windows, we have to force pgwin32_recv to cooperate,
-			 * despite the previous use of pg_set_noblock() on the socket.
-			 * This is extremely broken and should be fixed someday.
-			 */
-#ifdef WIN32
-			pgwin32_noblock = 1;
-#endif
-
-			len = recv(pgStatSock, (char *) &msg,
-					   sizeof(PgStat_Msg), 0);
-
-#ifdef WIN32
-			pgwin32_noblock = 0;
-#endif
-
-			if (len < 0)
-			{
-				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
-					break;		/* out of inner loop */
-				ereport(ERROR,
-						(errcode_for_socket_access(),
-						 errmsg("could not read statistics message: %m")));
-			}
-
-			/*
-			 * We ignore messages that are smaller than our common header
-			 */
-			if (len < sizeof(PgStat_MsgHdr))
-				continue;
-
-			/*
-			 * The received length must match the length in the header
-			 */
-			if (msg.msg_hdr.m_size != len)
-				continue;
-
-			/*
-			 * O.K. - we accept this message.  Process it.
-			 */
-			switch (msg.msg_hdr.m_type)
-			{
-				case PGSTAT_MTYPE_DUMMY:
-					break;
-
-				case PGSTAT_MTYPE_INQUIRY:
-					pgstat_recv_inquiry((PgStat_MsgInquiry *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat((PgStat_MsgTabstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge((PgStat_MsgTabpurge *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_DROPDB:
-					pgstat_recv_dropdb((PgStat_MsgDropdb *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETCOUNTER:
-					pgstat_recv_resetcounter((PgStat_MsgResetcounter *) &msg,
-											 len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
-					pgstat_recv_resetsharedcounter(
-									   (PgStat_MsgResetsharedcounter *) &msg,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSINGLECOUNTER:
-					pgstat_recv_resetsinglecounter(
-									   (PgStat_MsgResetsinglecounter *) &msg,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_AUTOVAC_START:
-					pgstat_recv_autovac((PgStat_MsgAutovacStart *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum((PgStat_MsgVacuum *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze((PgStat_MsgAnalyze *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_ARCHIVER:
-					pgstat_recv_archiver((PgStat_MsgArchiver *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_BGWRITER:
-					pgstat_recv_bgwriter((PgStat_MsgBgWriter *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat((PgStat_MsgFuncstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_RECOVERYCONFLICT:
-					pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_DEADLOCK:
-					pgstat_recv_deadlock((PgStat_MsgDeadlock *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TEMPFILE:
-					pgstat_recv_tempfile((PgStat_MsgTempFile *) &msg, len);
-					break;
-
-				default:
-					break;
-			}
-		}						/* end of inner message-processing loop */
-
-		/* Sleep until there's something to do */
-#ifndef WIN32
-		wr = WaitLatchOrSocket(&pgStatLatch,
-					 WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_SOCKET_READABLE,
-							   pgStatSock,
-							   -1L);
-#else
-
-		/*
-		 * Windows, at least in its Windows Server 2003 R2 incarnation,
-		 * sometimes loses FD_READ events.	Waking up and retrying the recv()
-		 * fixes that, so don't sleep indefinitely.  This is a crock of the
-		 * first water, but until somebody wants to debug exactly what's
-		 * happening there, this is the best we can do.  The two-second
-		 * timeout matches our pre-9.2 behavior, and needs to be short enough
-		 * to not provoke "pgstat wait timeout" complaints from
-		 * backend_read_statsfile.
-		 */
-		wr = WaitLatchOrSocket(&pgStatLatch,
-		WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_SOCKET_READABLE | WL_TIMEOUT,
-							   pgStatSock,
-							   2 * 1000L /* msec */ );
-#endif
-
-		/*
-		 * Emergency bailout if postmaster has died.  This is to avoid the
-		 * necessity for manual cleanup of all postmaster children.
-		 */
-		if (wr & WL_POSTMASTER_DEATH)
-			break;
-	}							/* end of outer loop */
-
-	/*
-	 * Save the final stats to reuse at next startup.
-	 */
-	pgstat_write_statsfiles(true, true);
-
-	exit(0);
-}
-
-
-/* SIGQUIT signal handler for collector process */
-static void
-pgstat_exit(SIGNAL_ARGS)
-{
-	int			save_errno = errno;
-
-	need_exit = true;
-	SetLatch(&pgStatLatch);
-
-	errno = save_errno;
-}
-
-/* SIGHUP handler for collector process */
-static void
-pgstat_sighup_handler(SIGNAL_ARGS)
-{
-	int			save_errno = errno;
-
-	got_SIGHUP = true;
-	SetLatch(&pgStatLatch);
-
-	errno = save_errno;
-}
-
-/*
- * Subroutine to clear stats in a database entry
- *
- * Tables and functions hashes are initialized to empty.
- */
-static void
-reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
-{
-	HASHCTL		hash_ctl;
-
 	dbentry->n_xact_commit = 0;
 	dbentry->n_xact_rollback = 0;
 	dbentry->n_blocks_fetched = 0;
@@ -3484,78 +2989,142 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 	dbentry->stats_timestamp = 0;
 
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	hash_ctl.hash = oid_hash;
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_FUNCTION);
+	dbentry->tables = NULL;
+	dbentry->functions = NULL;
+}
 
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	hash_ctl.hash = oid_hash;
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_FUNCTION);
+/*
+ * Have we not yet complained about a full hash table?  *reported is one of
+ * the flags in pgStatShared; it's set, and we return true, only the first
+ * time, so that the log isn't flooded with one message per report.
+ */
+static bool
+pgstat_first_overflow(bool *reported)
+{
+	bool		first;
+
+	SpinLockAcquire(&pgStatShared->mutex);
+	first = !*reported;
+	*reported = true;
+	SpinLockRelease(&pgStatShared->mutex);
+
+	return first;
 }
 
 /*
- * Lookup the hash table entry for the specified database. If no hash
+ * Complain, once per server lifetime, that there was no room for a new entry
+ * in one of the shared hash tables.  The statistics of the objects that don't
+ * fit are lost, and in the case of tables, that means autovacuum never sees
+ * the changes to them, so this is worth a message in the log.
+ */
+static void
+pgstat_report_db_overflow(void)
+{
+	if (pgstat_first_overflow(&pgStatShared->dbHashFull))
+		ereport(LOG,
+				(errmsg("too many databases to keep activity statistics for all of them"),
+				 errdetail("Statistics are kept for at most %d databases.",
+						   PGSTAT_SHARED_DB_HASH_SIZE)));
+}
+
+static void
+pgstat_report_tab_overflow(void)
+{
+	if (pgstat_first_overflow(&pgStatShared->tabHashFull))
+		ereport(LOG,
+				(errmsg("too many tables and indexes to keep activity statistics for all of them"),
+				 errdetail("Activity of tables and indexes beyond the first %d is not counted, and autovacuum will not process those tables.",
+						   pgstat_max_tables),
+				 errhint("Increase the configuration parameter \"stats_max_tables\".")));
+}
+
+static void
+pgstat_report_func_overflow(void)
+{
+	if (pgstat_first_overflow(&pgStatShared->funcHashFull))
+		ereport(LOG,
+				(errmsg("too many functions to keep call statistics for all of them"),
+				 errdetail("Calls of functions beyond the first %d are not counted.",
+						   pgstat_max_functions),
+				 errhint("Increase the configuration parameter \"stats_max_functions\".")));
+}
+
+/*
+ * Lookup the shared hash table entry for the specified database. If no hash
  * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Returns NULL if there is no entry and it was not requested or there is no
+ * room left to create one.
+ *
+ * The caller must hold PgStatDBLock, in exclusive mode if create is true.
  */
 static PgStat_StatDBEntry *
 pgstat_get_db_entry(Oid databaseid, bool create)
 {
 	PgStat_StatDBEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
+	HASHACTION	action = (create ? HASH_ENTER_NULL : HASH_FIND);
 
 	/* Lookup or create the hash table entry for this database */
-	result = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+	result = (PgStat_StatDBEntry *) hash_search(pgStatSharedDBHash,
 												&databaseid,
 												action, &found);
 
-	if (!create && !found)
+	if (result == NULL)
+	{
+		if (create)
+			pgstat_report_db_overflow();
 		return NULL;
+	}
 
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
+	/* If not found, initialize the new one. */
 	if (!found)
+	{
+		SpinLockInit(PgStatDBEntryMutex(result));
 		reset_dbentry_counters(result);
+	}
 
 	return result;
 }
 
 
 /*
- * Lookup the hash table entry for the specified table. If no hash
+ * Lookup the shared hash table entry for the specified table. If no hash
  * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Returns NULL if there is no entry and it was not requested or there is no
+ * room left to create one.
+ *
+ * The caller must have computed the hash code of the key with
+ * PgStatTabHashCode, and must hold the corresponding partition lock, in
+ * exclusive mode if create is true.
  */
 static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+pgstat_get_tab_entry(PgStat_SharedObjectKey *key, uint32 hashcode, bool create)
 {
+	PgStat_SharedTabEntry *entry;
 	PgStat_StatTabEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
+	HASHACTION	action = (create ? HASH_ENTER_NULL : HASH_FIND);
 
 	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
+	entry = (PgStat_SharedTabEntry *)
+		hash_search_with_hash_value(PgStatPartitionHash(hashcode),
+									(void *) key,
+									hashcode,
+									action, &found);
 
-	if (!create && !found)
+	if (entry == NULL)
+	{
+		if (create)
+			pgstat_report_tab_overflow();
 		return NULL;
+	}
+
+	result = &entry->stats;
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
+		result->tableid = key->objectid;
 		result->numscans = 0;
 		result->tuples_returned = 0;
 		result->tuples_fetched = 0;
@@ -3581,31 +3150,83 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 	return result;
 }
 
+/*
+ * Remove all the table and function entries of a database from the shared
+ * hash tables.
+ */
+static void
+pgstat_remove_db_objects(Oid databaseid)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	int			i;
+
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+	{
+		LWLockAcquire(PgStatPartitionLockByIndex(i), LW_EXCLUSIVE);
+
+		hash_seq_init(&hstat, pgStatSharedTabHash[i]);
+		while ((tabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
+		{
+			if (tabentry->key.databaseid != databaseid)
+				continue;
+
+			if (hash_search(pgStatSharedTabHash[i],
+							(void *) &tabentry->key,
+							HASH_REMOVE, NULL) == NULL)
+				elog(ERROR, "table statistics hash table corrupted");
+		}
+
+		LWLockRelease(PgStatPartitionLockByIndex(i));
+	}
+
+	LWLockAcquire(PgStatFuncLock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((funcentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		if (funcentry->key.databaseid != databaseid)
+			continue;
+
+		if (hash_search(pgStatSharedFuncHash,
+						(void *) &funcentry->key,
+						HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "function statistics hash table corrupted");
+	}
+
+	LWLockRelease(PgStatFuncLock);
+}
+
 
 /* ----------
- * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
- *
- *	If writing to the permanent files (happens when the collector is
- *	shutting down only), remove the temporary files so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
+ * pgstat_write_statsfile() -
+ *		Write the shared statistics out to the permanent stats file.
  *
- *	When 'allDbs' is false, only the requested databases (listed in
- *	last_statrequests) will be written; otherwise, all databases will be
- *	written.
+ *	This happens only once, at shutdown, in the checkpointer after the
+ *	shutdown checkpoint; the file is read back by pgstat_restore_stats()
+ *	when the server starts up again.
  * ----------
  */
-static void
-pgstat_write_statsfiles(bool permanent, bool allDbs)
+void
+pgstat_write_statsfile(void)
 {
 	HASH_SEQ_STATUS hstat;
 	PgStat_StatDBEntry *dbentry;
+	PgStat_StatDBEntry dbbuf;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	PgStat_GlobalStats myGlobalStats;
+	PgStat_ArchiverStats myArchiverStats;
 	FILE	   *fpout;
 	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	const char *tmpfile = PGSTAT_STAT_PERMANENT_TMPFILE;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 	int			rc;
+	int			i;
+
+	if (pgStatShared == NULL)
+		return;
 
 	elog(DEBUG2, "writing statsfile '%s'", statfile);
 
@@ -3622,10 +3243,16 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 		return;
 	}
 
+	SpinLockAcquire(&pgStatShared->mutex);
+	memcpy(&myGlobalStats, &pgStatShared->globalStats, sizeof(myGlobalStats));
+	memcpy(&myArchiverStats, &pgStatShared->archiverStats,
+		   sizeof(myArchiverStats));
+	SpinLockRelease(&pgStatShared->mutex);
+
 	/*
 	 * Set the timestamp of the stats file.
 	 */
-	globalStats.stats_timestamp = GetCurrentTimestamp();
+	myGlobalStats.stats_timestamp = GetCurrentTimestamp();
 
 	/*
 	 * Write the file header --- currently just a format ID.
@@ -3637,196 +3264,61 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	/*
 	 * Write global stats struct
 	 */
-	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
+	rc = fwrite(&myGlobalStats, sizeof(myGlobalStats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
 	 * Write archiver stats struct
 	 */
-	rc = fwrite(&archiverStats, sizeof(archiverStats), 1, fpout);
+	rc = fwrite(&myArchiverStats, sizeof(myArchiverStats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Walk through the database table.
+	 * Walk through the database table.  We don't write the tables or
+	 * functions pointers, since they're of no use to any other process.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+	hash_seq_init(&hstat, pgStatSharedDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the tables and functions into the DB stat file, if
-		 * required.
-		 *
-		 * We need to do this before the dbentry write, to ensure the
-		 * timestamps written to both are consistent.
-		 */
-		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			dbentry->stats_timestamp = globalStats.stats_timestamp;
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
-
-		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
-		 */
+		SpinLockAcquire(PgStatDBEntryMutex(dbentry));
+		memcpy(&dbbuf, dbentry, offsetof(PgStat_StatDBEntry, tables));
+		SpinLockRelease(PgStatDBEntryMutex(dbentry));
+		dbbuf.stats_timestamp = myGlobalStats.stats_timestamp;
 		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		rc = fwrite(&dbbuf, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
+	LWLockRelease(PgStatDBLock);
 
 	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
+	 * Walk through the access stats per table, of all databases.
 	 */
-	fputc('E', fpout);
-
-	if (ferror(fpout))
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
 	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-			   errmsg("could not write temporary statistics file \"%s\": %m",
-					  tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-			   errmsg("could not close temporary statistics file \"%s\": %m",
-					  tmpfile)));
-		unlink(tmpfile);
-	}
-	else if (rename(tmpfile, statfile) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
-						tmpfile, statfile)));
-		unlink(tmpfile);
-	}
-
-	if (permanent)
-		unlink(pgstat_stat_filename);
-
-	/*
-	 * Now throw away the list of requests.  Note that requests sent after we
-	 * started the write are still waiting on the network socket.
-	 */
-	if (!slist_is_empty(&last_statrequests))
-	{
-		slist_mutable_iter iter;
-
-		/*
-		 * Strictly speaking we should do slist_delete_current() before
-		 * freeing each request struct.  We skip that and instead
-		 * re-initialize the list header at the end.  Nonetheless, we must use
-		 * slist_foreach_modify, not just slist_foreach, since we will free
-		 * the node's storage before advancing.
-		 */
-		slist_foreach_modify(iter, &last_statrequests)
+		LWLockAcquire(PgStatPartitionLockByIndex(i), LW_SHARED);
+		hash_seq_init(&hstat, pgStatSharedTabHash[i]);
+		while ((tabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
 		{
-			DBWriteRequest *req;
-
-			req = slist_container(DBWriteRequest, next, iter.cur);
-			pfree(req);
+			fputc('T', fpout);
+			rc = fwrite(tabentry, sizeof(PgStat_SharedTabEntry), 1, fpout);
+			(void) rc;			/* we'll check for error with ferror */
 		}
-
-		slist_init(&last_statrequests);
+		LWLockRelease(PgStatPartitionLockByIndex(i));
 	}
-}
-
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
- */
-static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
-{
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed > len)
-		elog(ERROR, "overlength pgstat path");
-}
-
-/* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
- *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
- * ----------
- */
-static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
-{
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
-	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
-
-	elog(DEBUG2, "writing statsfile '%s'", statfile);
 
 	/*
-	 * Open the statistics temp file to write out the current values.
+	 * Walk through the function stats table.
 	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
-		return;
-	}
-
-	/*
-	 * Write the file header --- currently just a format ID.
-	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Walk through the database's access stats per table.
-	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * Walk through the database's function stats table.
-	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
+	LWLockAcquire(PgStatFuncLock, LW_SHARED);
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((funcentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
 	{
 		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
+		rc = fwrite(funcentry, sizeof(PgStat_SharedFuncEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
+	LWLockRelease(PgStatFuncLock);
 
 	/*
 	 * No more output to be done. Close the temp file and replace the old
@@ -3860,88 +3352,54 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 						tmpfile, statfile)));
 		unlink(tmpfile);
 	}
-
-	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing temporary stat file '%s'", statfile);
-		unlink(statfile);
-	}
 }
 
 /* ----------
- * pgstat_read_statsfiles() -
+ * pgstat_restore_stats() -
  *
- *	Reads in the existing statistics collector files and initializes the
- *	databases' hash table.  If the permanent file name is requested (which
- *	only happens in the stats collector itself), also remove the file after
- *	reading; the in-memory status is now authoritative, and the permanent file
- *	would be out of date in case somebody else reads it.
+ *	Reads in the permanent statistics file written at the last shutdown,
+ *	if any, and loads it into the shared hash tables.  Called by the startup
+ *	process before any other process can report statistics.  The file is
+ *	removed after reading; the shared-memory status is now authoritative,
+ *	and the file would be out of date in case somebody else reads it.
  *
- *	If a deep read is requested, table/function stats are read also, otherwise
- *	the table/function hash tables remain empty.
+ *	A standalone backend doesn't write the file at exit, so it leaves the
+ *	file alone, too.
  * ----------
  */
-static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
+void
+pgstat_restore_stats(void)
 {
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatDBEntry dbbuf;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
+	PgStat_SharedTabEntry tabbuf;
+	PgStat_SharedFuncEntry funcbuf;
+	PgStat_StatTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	PgStat_GlobalStats myGlobalStats;
+	PgStat_ArchiverStats myArchiverStats;
 	FILE	   *fpin;
 	int32		format_id;
 	bool		found;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 
-	/*
-	 * Create the DB hashtable
-	 */
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hash = oid_hash;
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-	/*
-	 * Clear out global and archiver statistics so they start from zero
-	 * in case we can't load an existing statsfile.
-	 */
-	memset(&globalStats, 0, sizeof(globalStats));
-	memset(&archiverStats, 0, sizeof(archiverStats));
-
-	/*
-	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile).
-	 */
-	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
-	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
+	if (pgStatShared == NULL || !IsUnderPostmaster)
+		return;
 
 	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
+	 * Try to open the stats file. If it doesn't exist, we simply start from
+	 * scratch with empty counters.
 	 */
 	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
 	{
 		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
+			ereport(LOG,
 					(errcode_for_file_access(),
 					 errmsg("could not open statistics file \"%s\": %m",
 							statfile)));
-		return dbhash;
+		return;
 	}
 
 	/*
@@ -3950,34 +3408,35 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
 		format_id != PGSTAT_FILE_FORMAT_ID)
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
+		ereport(LOG,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
 		goto done;
 	}
 
 	/*
-	 * Read global stats struct
+	 * Read global and archiver stats structs
 	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
+	if (fread(&myGlobalStats, 1, sizeof(myGlobalStats),
+			  fpin) != sizeof(myGlobalStats) ||
+		fread(&myArchiverStats, 1, sizeof(myArchiverStats),
+			  fpin) != sizeof(myArchiverStats))
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
+		ereport(LOG,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
 		goto done;
 	}
 
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&archiverStats, 1, sizeof(archiverStats), fpin) != sizeof(archiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
+	SpinLockAcquire(&pgStatShared->mutex);
+	memcpy(&pgStatShared->globalStats, &myGlobalStats, sizeof(myGlobalStats));
+	memcpy(&pgStatShared->archiverStats, &myArchiverStats,
+		   sizeof(myArchiverStats));
+	SpinLockRelease(&pgStatShared->mutex);
 
 	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
+	 * We found an existing stats file. Read it and put all the hashtable
+	 * entries into place.  If we run out of room in shared memory (because
+	 * stats_max_tables or stats_max_functions was lowered), the remaining
+	 * entries are forgotten, with a message in the log.
 	 */
 	for (;;)
 	{
@@ -3991,229 +3450,69 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
 						  fpin) != offsetof(PgStat_StatDBEntry, tables))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
+					ereport(LOG,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
 					goto done;
 				}
 
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-												  (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
-				if (found)
+				LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+				dbentry = pgstat_get_db_entry(dbbuf.databaseid, true);
+				if (dbentry != NULL)
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
+					memcpy(dbentry, &dbbuf, offsetof(PgStat_StatDBEntry, tables));
+					dbentry->tables = NULL;
+					dbentry->functions = NULL;
 				}
-
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
-
-				/*
-				 * Don't collect tables if not the requested DB (or the
-				 * shared-table info)
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hash = oid_hash;
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hash = oid_hash;
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-				/*
-				 * If requested, read the data from the database-specific
-				 * file. If there was onlydb specified (!= InvalidOid), we
-				 * would not get here because of a break above. So we don't
-				 * need to recheck.
-				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
-
+				LWLockRelease(PgStatDBLock);
 				break;
 
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	/* If requested to read the permanent file, also get rid of it. */
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file '%s'", statfile);
-		unlink(statfile);
-	}
-
-	return dbhash;
-}
-
-
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	and initializes the tables and functions hash tables.
- *
- *	As pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- * ----------
- */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
-{
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
 				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
+				 * 'T'	A PgStat_SharedTabEntry follows.
 				 */
 			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
+				if (fread(&tabbuf, 1, sizeof(PgStat_SharedTabEntry),
+						  fpin) != sizeof(PgStat_SharedTabEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
+					ereport(LOG,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
 					goto done;
 				}
 
-				/*
-				 * Skip if table belongs to a not requested database.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-													(void *) &tabbuf.tableid,
-														 HASH_ENTER, &found);
+				hashcode = PgStatTabHashCode(&tabbuf.key);
+				partitionLock = PgStatPartitionLock(hashcode);
 
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
+				LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+				tabentry = pgstat_get_tab_entry(&tabbuf.key, hashcode, true);
+				if (tabentry != NULL)
+					memcpy(tabentry, &tabbuf.stats, sizeof(PgStat_StatTabEntry));
+				LWLockRelease(partitionLock);
 				break;
 
 				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
+				 * 'F'	A PgStat_SharedFuncEntry follows.
 				 */
 			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if function belongs to a not requested database.
-				 */
-				if (funchash == NULL)
-					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-												(void *) &funcbuf.functionid,
-														 HASH_ENTER, &found);
-
-				if (found)
+				if (fread(&funcbuf, 1, sizeof(PgStat_SharedFuncEntry),
+						  fpin) != sizeof(PgStat_SharedFuncEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
+					ereport(LOG,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
 					goto done;
 				}
 
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
+				LWLockAcquire(PgStatFuncLock, LW_EXCLUSIVE);
+				funcentry = (PgStat_SharedFuncEntry *)
+					hash_search(pgStatSharedFuncHash,
+								(void *) &funcbuf.key,
+								HASH_ENTER_NULL, &found);
+				if (funcentry == NULL)
+					pgstat_report_func_overflow();
+				else
+					memcpy(funcentry, &funcbuf, sizeof(PgStat_SharedFuncEntry));
+				LWLockRelease(PgStatFuncLock);
 				break;
 
 				/*
@@ -4223,7 +3522,7 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 				goto done;
 
 			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
+				ereport(LOG,
 						(errmsg("corrupted statistics file \"%s\"",
 								statfile)));
 				goto done;
@@ -4233,261 +3532,189 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 done:
 	FreeFile(fpin);
 
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file '%s'", statfile);
-		unlink(statfile);
-	}
-
-	return;
+	elog(DEBUG2, "removing permanent stats file '%s'", statfile);
+	unlink(statfile);
 }
 
-/* ----------
- * pgstat_read_db_statsfile_timestamp() -
- *
- *	Attempt to determine the timestamp of the last db statfile write.
- *	Returns TRUE if successful; the timestamp is stored in *ts.
- *
- *	This needs to be careful about handling databases for which no stats file
- *	exists, such as databases without a stat entry or those not yet written:
- *
- *	- if there's a database entry in the global file, return the corresponding
- *	stats_timestamp value.
+/*
+ * If not already done, copy the shared statistics into some local hash
+ * tables.  The results will be kept until pgstat_clear_snapshot() is called
+ * (typically, at end of transaction), so that repeated queries within a
+ * transaction see consistent values.
  *
- *	- if there's no db stat entry (e.g. for a new or inactive database),
- *	there's no stats_timestamp value, but also nothing to write so we return
- *	the timestamp of the global statfile.
- * ----------
+ * Only the statistics of our own database and of shared relations are
+ * copied in full.  The autovacuum launcher needs only the database entries
+ * of all databases, so it gets nothing more.
  */
-static bool
-pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
-								   TimestampTz *ts)
+static void
+pgstat_build_snapshot(void)
 {
-	PgStat_StatDBEntry dbentry;
-	PgStat_GlobalStats myGlobalStats;
-	PgStat_ArchiverStats myArchiverStats;
-	FILE	   *fpin;
-	int32		format_id;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	PgStat_StatDBEntry *dbentry;
+	PgStat_StatDBEntry *shdbentry;
+	PgStat_SharedTabEntry *shtabentry;
+	PgStat_SharedFuncEntry *shfuncentry;
+	HASHCTL		hash_ctl;
+	HASH_SEQ_STATUS hstat;
+	Oid			deepdbs[2];
+	int			i;
 
-	/*
-	 * Try to open the stats file.	As above, anything but ENOENT is worthy of
-	 * complaining about.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return false;
-	}
+	/* already done it? */
+	if (pgStatDBHash)
+		return;
 
 	/*
-	 * Verify it's of the expected format.
+	 * The tables will live in pgStatLocalContext.
 	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
+	pgstat_setup_memcxt();
 
 	/*
-	 * Read global stats struct
+	 * Create the DB hashtable
 	 */
-	if (fread(&myGlobalStats, 1, sizeof(myGlobalStats),
-			  fpin) != sizeof(myGlobalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
+	hash_ctl.hash = oid_hash;
+	hash_ctl.hcxt = pgStatLocalContext;
+	pgStatDBHash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE,
+							   &hash_ctl,
+							   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
 
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&myArchiverStats, 1, sizeof(myArchiverStats),
-			  fpin) != sizeof(myArchiverStats))
+	if (pgStatShared == NULL)
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
+		memset(&globalStats, 0, sizeof(globalStats));
+		memset(&archiverStats, 0, sizeof(archiverStats));
+		return;
 	}
 
-	/* By default, we're going to return the timestamp of the global file. */
-	*ts = myGlobalStats.stats_timestamp;
-
 	/*
-	 * We found an existing collector stats file.  Read it and look for a
-	 * record for the requested database.  If found, use its timestamp.
+	 * Copy the cluster-wide statistics.  The snapshot time is reported as
+	 * the "stats file" timestamp.
 	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * If this is the DB we're looking for, save its timestamp and
-				 * we're done.
-				 */
-				if (dbentry.databaseid == databaseid)
-				{
-					*ts = dbentry.stats_timestamp;
-					goto done;
-				}
+	SpinLockAcquire(&pgStatShared->mutex);
+	memcpy(&globalStats, &pgStatShared->globalStats, sizeof(globalStats));
+	memcpy(&archiverStats, &pgStatShared->archiverStats,
+		   sizeof(archiverStats));
+	SpinLockRelease(&pgStatShared->mutex);
 
-				break;
-
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-	return true;
-}
+	globalStats.stats_timestamp = GetCurrentTimestamp();
 
-/*
- * If not already done, read the statistics collector stats file into
- * some hash tables.  The results will be kept until pgstat_clear_snapshot()
- * is called (typically, at end of transaction).
- */
-static void
-backend_read_statsfile(void)
-{
-	TimestampTz min_ts = 0;
-	TimestampTz ref_ts = 0;
-	int			count;
+	/*
+	 * Copy the database entries.
+	 */
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+	hash_seq_init(&hstat, pgStatSharedDBHash);
+	while ((shdbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+												(void *) &shdbentry->databaseid,
+													 HASH_ENTER, NULL);
+		SpinLockAcquire(PgStatDBEntryMutex(shdbentry));
+		memcpy(dbentry, shdbentry, sizeof(PgStat_StatDBEntry));
+		SpinLockRelease(PgStatDBEntryMutex(shdbentry));
+		dbentry->stats_timestamp = globalStats.stats_timestamp;
+		dbentry->tables = NULL;
+		dbentry->functions = NULL;
+	}
+	LWLockRelease(PgStatDBLock);
 
-	/* already read it? */
-	if (pgStatDBHash)
+	/*
+	 * Autovacuum launcher wants stats about all databases, but a shallow
+	 * copy is sufficient.
+	 */
+	if (IsAutoVacuumLauncherProcess())
 		return;
-	Assert(!pgStatRunningInCollector);
 
 	/*
-	 * Loop until fresh enough stats file is available or we ran out of time.
-	 * The stats inquiry message is sent repeatedly in case collector drops
-	 * it; but not every single time, as that just swamps the collector.
+	 * Set up table and function hash tables for our own database and for
+	 * the shared relations.
 	 */
-	for (count = 0; count < PGSTAT_POLL_LOOP_COUNT; count++)
+	deepdbs[0] = MyDatabaseId;
+	deepdbs[1] = InvalidOid;
+	for (i = 0; i < lengthof(deepdbs); i++)
 	{
-		bool		ok;
-		TimestampTz file_ts = 0;
-		TimestampTz cur_ts;
-
-		CHECK_FOR_INTERRUPTS();
+		dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+													 (void *) &deepdbs[i],
+													 HASH_FIND, NULL);
+		if (dbentry == NULL || dbentry->tables != NULL)
+			continue;
 
-		ok = pgstat_read_db_statsfile_timestamp(MyDatabaseId, false, &file_ts);
+		memset(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
+		hash_ctl.hash = oid_hash;
+		hash_ctl.hcxt = pgStatLocalContext;
+		dbentry->tables = hash_create("Per-database table",
+									  PGSTAT_TAB_HASH_SIZE,
+									  &hash_ctl,
+								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
 
-		cur_ts = GetCurrentTimestamp();
-		/* Calculate min acceptable timestamp, if we didn't already */
-		if (count == 0 || cur_ts < ref_ts)
-		{
-			/*
-			 * We set the minimum acceptable timestamp to PGSTAT_STAT_INTERVAL
-			 * msec before now.  This indirectly ensures that the collector
-			 * needn't write the file more often than PGSTAT_STAT_INTERVAL. In
-			 * an autovacuum worker, however, we want a lower delay to avoid
-			 * using stale data, so we use PGSTAT_RETRY_DELAY (since the
-			 * number of workers is low, this shouldn't be a problem).
-			 *
-			 * We don't recompute min_ts after sleeping, except in the
-			 * unlikely case that cur_ts went backwards.  So we might end up
-			 * accepting a file a bit older than PGSTAT_STAT_INTERVAL.	In
-			 * practice that shouldn't happen, though, as long as the sleep
-			 * time is less than PGSTAT_STAT_INTERVAL; and we don't want to
-			 * tell the collector that our cutoff time is less than what we'd
-			 * actually accept.
-			 */
-			ref_ts = cur_ts;
-			if (IsAutoVacuumWorkerProcess())
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_RETRY_DELAY);
-			else
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_STAT_INTERVAL);
-		}
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
+		hash_ctl.hash = oid_hash;
+		hash_ctl.hcxt = pgStatLocalContext;
+		dbentry->functions = hash_create("Per-database function",
+										 PGSTAT_FUNCTION_HASH_SIZE,
+										 &hash_ctl,
+								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+	}
 
-		/*
-		 * If the file timestamp is actually newer than cur_ts, we must have
-		 * had a clock glitch (system time went backwards) or there is clock
-		 * skew between our processor and the stats collector's processor.
-		 * Accept the file, but send an inquiry message anyway to make
-		 * pgstat_recv_inquiry do a sanity check on the collector's time.
-		 */
-		if (ok && file_ts > cur_ts)
+	/*
+	 * Copy the table entries of those databases, one partition at a time so
+	 * that backends reporting to the other partitions can proceed meanwhile.
+	 * The result is not an atomic snapshot of all the tables, but each
+	 * entry is consistent in itself, which is all we promise.
+	 */
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+	{
+		LWLockAcquire(PgStatPartitionLockByIndex(i), LW_SHARED);
+		hash_seq_init(&hstat, pgStatSharedTabHash[i]);
+		while ((shtabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
 		{
-			/*
-			 * A small amount of clock skew between processors isn't terribly
-			 * surprising, but a large difference is worth logging.  We
-			 * arbitrarily define "large" as 1000 msec.
-			 */
-			if (file_ts >= TimestampTzPlusMilliseconds(cur_ts, 1000))
-			{
-				char	   *filetime;
-				char	   *mytime;
-
-				/* Copy because timestamptz_to_str returns a static buffer */
-				filetime = pstrdup(timestamptz_to_str(file_ts));
-				mytime = pstrdup(timestamptz_to_str(cur_ts));
-				elog(LOG, "stats collector's time %s is later than backend local time %s",
-					 filetime, mytime);
-				pfree(filetime);
-				pfree(mytime);
-			}
-
-			pgstat_send_inquiry(cur_ts, min_ts, MyDatabaseId);
-			break;
-		}
+			PgStat_StatTabEntry *tabentry;
 
-		/* Normal acceptance case: file is not older than cutoff time */
-		if (ok && file_ts >= min_ts)
-			break;
+			if (shtabentry->key.databaseid != MyDatabaseId &&
+				shtabentry->key.databaseid != InvalidOid)
+				continue;
 
-		/* Not there or too old, so kick the collector and wait a bit */
-		if ((count % PGSTAT_INQ_LOOP_COUNT) == 0)
-			pgstat_send_inquiry(cur_ts, min_ts, MyDatabaseId);
+			dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+										(void *) &shtabentry->key.databaseid,
+														 HASH_FIND, NULL);
+			if (dbentry == NULL)
+				continue;
 
-		pg_usleep(PGSTAT_RETRY_DELAY * 1000L);
+			tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
+										  (void *) &shtabentry->key.objectid,
+														   HASH_ENTER, NULL);
+			memcpy(tabentry, &shtabentry->stats, sizeof(PgStat_StatTabEntry));
+		}
+		LWLockRelease(PgStatPartitionLockByIndex(i));
 	}
 
-	if (count >= PGSTAT_POLL_LOOP_COUNT)
-		elog(WARNING, "pgstat wait timeout");
-
 	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.
+	 * And likewise for functions.
 	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
+	LWLockAcquire(PgStatFuncLock, LW_SHARED);
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((shfuncentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		PgStat_StatFuncEntry *funcentry;
+
+		if (shfuncentry->key.databaseid != MyDatabaseId &&
+			shfuncentry->key.databaseid != InvalidOid)
+			continue;
+
+		dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+									   (void *) &shfuncentry->key.databaseid,
+													 HASH_FIND, NULL);
+		if (dbentry == NULL)
+			continue;
+
+		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
+										 (void *) &shfuncentry->key.objectid,
+														 HASH_ENTER, NULL);
+		memcpy(funcentry, &shfuncentry->stats, sizeof(PgStat_StatFuncEntry));
+	}
+	LWLockRelease(PgStatFuncLock);
 }
 
 
@@ -4535,156 +3762,95 @@ pgstat_clear_snapshot(void)
 
 
 /* ----------
- * pgstat_recv_inquiry() -
+ * pgstat_recv_tabstat() -
  *
- *	Process stat inquiry requests.
+ *	Count what the backend has done.
  * ----------
  */
 static void
-pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
+pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 {
-	slist_iter	iter;
-	DBWriteRequest *newreq;
 	PgStat_StatDBEntry *dbentry;
-
-	elog(DEBUG2, "received inquiry for %d", msg->databaseid);
+	PgStat_StatTabEntry *tabentry;
+	PgStat_SharedObjectKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	PgStat_TableCounts sums;
+	int			i;
 
 	/*
-	 * Find the last write request for this DB.  If it's older than the
-	 * request's cutoff time, update it; otherwise there's nothing to do.
-	 *
-	 * Note that if a request is found, we return early and skip the below
-	 * check for clock skew.  This is okay, since the only way for a DB
-	 * request to be present in the list is that we have been here since the
-	 * last write round.
+	 * Sum up the per-table stats over all the table entries in the message,
+	 * so that the database entry is locked only briefly.
 	 */
-	slist_foreach(iter, &last_statrequests)
+	memset(&sums, 0, sizeof(sums));
+	for (i = 0; i < msg->m_nentries; i++)
 	{
-		DBWriteRequest *req = slist_container(DBWriteRequest, next, iter.cur);
-
-		if (req->databaseid != msg->databaseid)
-			continue;
+		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
 
-		if (msg->cutoff_time > req->request_time)
-			req->request_time = msg->cutoff_time;
-		return;
+		sums.t_tuples_returned += tabmsg->t_counts.t_tuples_returned;
+		sums.t_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
+		sums.t_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
+		sums.t_tuples_updated += tabmsg->t_counts.t_tuples_updated;
+		sums.t_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
+		sums.t_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
+		sums.t_blocks_hit += tabmsg->t_counts.t_blocks_hit;
 	}
 
 	/*
-	 * There's no request for this DB yet, so create one.
-	 */
-	newreq = palloc(sizeof(DBWriteRequest));
-
-	newreq->databaseid = msg->databaseid;
-	newreq->request_time = msg->clock_time;
-	slist_push_head(&last_statrequests, &newreq->next);
-
-	/*
-	 * If the requestor's local clock time is older than stats_timestamp, we
-	 * should suspect a clock glitch, ie system time going backwards; though
-	 * the more likely explanation is just delayed message receipt.  It is
-	 * worth expending a GetCurrentTimestamp call to be sure, since a large
-	 * retreat in the system clock reading could otherwise cause us to neglect
-	 * to update the stats file for a long time.
+	 * Update database-wide stats.  Normally the database entry exists
+	 * already, and we need PgStatDBLock only in shared mode; the counters are
+	 * protected by the entry's spinlock.
 	 */
-	dbentry = pgstat_get_db_entry(msg->databaseid, false);
-	if ((dbentry != NULL) && (msg->clock_time < dbentry->stats_timestamp))
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	if (dbentry == NULL)
 	{
-		TimestampTz cur_ts = GetCurrentTimestamp();
-
-		if (cur_ts < dbentry->stats_timestamp)
-		{
-			/*
-			 * Sure enough, time went backwards.  Force a new stats file write
-			 * to get back in sync; but first, log a complaint.
-			 */
-			char	   *writetime;
-			char	   *mytime;
-
-			/* Copy because timestamptz_to_str returns a static buffer */
-			writetime = pstrdup(timestamptz_to_str(dbentry->stats_timestamp));
-			mytime = pstrdup(timestamptz_to_str(cur_ts));
-			elog(LOG,
-			"stats_timestamp %s is later than collector's time %s for db %d",
-				 writetime, mytime, dbentry->databaseid);
-			pfree(writetime);
-			pfree(mytime);
-
-			newreq->request_time = cur_ts;
-			dbentry->stats_timestamp = cur_ts - 1;
-		}
+		LWLockRelease(PgStatDBLock);
+		LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+		dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
 	}
-}
-
-
-/* ----------
- * pgstat_recv_tabstat() -
- *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+	{
+		SpinLockAcquire(PgStatDBEntryMutex(dbentry));
+		dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
+		dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
+		dbentry->n_block_read_time += msg->m_block_read_time;
+		dbentry->n_block_write_time += msg->m_block_write_time;
+		dbentry->n_tuples_returned += sums.t_tuples_returned;
+		dbentry->n_tuples_fetched += sums.t_tuples_fetched;
+		dbentry->n_tuples_inserted += sums.t_tuples_inserted;
+		dbentry->n_tuples_updated += sums.t_tuples_updated;
+		dbentry->n_tuples_deleted += sums.t_tuples_deleted;
+		dbentry->n_blocks_fetched += sums.t_blocks_fetched;
+		dbentry->n_blocks_hit += sums.t_blocks_hit;
+		SpinLockRelease(PgStatDBEntryMutex(dbentry));
+	}
 
-	/*
-	 * Update database-wide stats.
-	 */
-	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
-	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
-	dbentry->n_block_read_time += msg->m_block_read_time;
-	dbentry->n_block_write_time += msg->m_block_write_time;
+	LWLockRelease(PgStatDBLock);
 
 	/*
-	 * Process all table entries in the message.
+	 * Process all table entries in the message, taking only the lock of the
+	 * partition each one belongs to.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++)
 	{
 		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
 
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													(void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
+		key.objectid = tabmsg->t_id;
+		hashcode = PgStatTabHashCode(&key);
+		partitionLock = PgStatPartitionLock(hashcode);
 
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+		/*
+		 * A new table entry starts out with all counters zeroed; if there is
+		 * no room for it, the counts are lost.
+		 */
+		tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+		if (tabentry != NULL)
 		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
 			tabentry->numscans += tabmsg->t_counts.t_numscans;
 			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
 			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
@@ -4697,23 +3863,14 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
 			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
 
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+			/* Clamp n_live_tuples in case of negative delta_live_tuples */
+			tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+			/* Likewise for n_dead_tuples */
+			tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+		}
 
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
+		LWLockRelease(partitionLock);
 	}
 }
 
@@ -4727,26 +3884,28 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 static void
 pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_SharedObjectKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
 	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
 	/*
 	 * Process all table entries in the message.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++)
 	{
+		key.objectid = msg->m_tableid[i];
+		hashcode = PgStatTabHashCode(&key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
 		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		(void) hash_search_with_hash_value(PgStatPartitionHash(hashcode),
+										   (void *) &key,
+										   hashcode,
+										   HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
 	}
 }
 
@@ -4761,36 +3920,16 @@ static void
 pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 {
 	Oid			dbid = msg->m_databaseid;
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Lookup the database in the hashtable.
-	 */
-	dbentry = pgstat_get_db_entry(dbid, false);
 
 	/*
-	 * If found, remove it (along with the db statfile).
+	 * Remove the database entry, if any, and then everything that belongs
+	 * to the database.
 	 */
-	if (dbentry)
-	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing %s", statfile);
-		unlink(statfile);
-
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+	(void) hash_search(pgStatSharedDBHash, (void *) &dbid, HASH_REMOVE, NULL);
+	LWLockRelease(PgStatDBLock);
 
-		if (hash_search(pgStatDBHash,
-						(void *) &dbid,
-						HASH_REMOVE, NULL) == NULL)
-			ereport(ERROR,
-					(errmsg("database hash table corrupted during cleanup --- abort")));
-	}
+	pgstat_remove_db_objects(dbid);
 }
 
 
@@ -4808,28 +3947,26 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 	/*
 	 * Lookup the database in the hashtable.  Nothing to do if not there.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
 
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
 	if (!dbentry)
+	{
+		LWLockRelease(PgStatDBLock);
 		return;
+	}
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
+	 * Reset database-level stats.
 	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
+	reset_dbentry_counters(dbentry);
 
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
+	LWLockRelease(PgStatDBLock);
 
 	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * We simply throw away all the database's table and function entries.
 	 */
-	reset_dbentry_counters(dbentry);
+	pgstat_remove_db_objects(msg->m_databaseid);
 }
 
 /* ----------
@@ -4841,23 +3978,29 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 static void
 pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 {
+	TimestampTz now = GetCurrentTimestamp();
+
+	SpinLockAcquire(&pgStatShared->mutex);
+
 	if (msg->m_resettarget == RESET_BGWRITER)
 	{
 		/* Reset the global background writer statistics for the cluster. */
-		memset(&globalStats, 0, sizeof(globalStats));
-		globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+		memset(&pgStatShared->globalStats, 0, sizeof(PgStat_GlobalStats));
+		pgStatShared->globalStats.stat_reset_timestamp = now;
 	}
 	else if (msg->m_resettarget == RESET_ARCHIVER)
 	{
 		/* Reset the archiver statistics for the cluster. */
-		memset(&archiverStats, 0, sizeof(archiverStats));
-		archiverStats.stat_reset_timestamp = GetCurrentTimestamp();
+		memset(&pgStatShared->archiverStats, 0, sizeof(PgStat_ArchiverStats));
+		pgStatShared->archiverStats.stat_reset_timestamp = now;
 	}
 
 	/*
 	 * Presumably the sender of this message validated the target, don't
 	 * complain here if it's not valid
 	 */
+
+	SpinLockRelease(&pgStatShared->mutex);
 }
 
 /* ----------
@@ -4870,22 +4013,48 @@ static void
 pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
+	PgStat_SharedObjectKey key;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
 
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
 	if (!dbentry)
+	{
+		LWLockRelease(PgStatDBLock);
 		return;
+	}
 
 	/* Set the reset timestamp for the whole database */
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 
+	LWLockRelease(PgStatDBLock);
+
 	/* Remove object if it exists, ignore it if not */
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_objectid;
+
 	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+	{
+		uint32		hashcode;
+		LWLock	   *partitionLock;
+
+		hashcode = PgStatTabHashCode(&key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		(void) hash_search_with_hash_value(PgStatPartitionHash(hashcode),
+										   (void *) &key,
+										   hashcode,
+										   HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
+	}
 	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
+	{
+		LWLockAcquire(PgStatFuncLock, LW_EXCLUSIVE);
+		(void) hash_search(pgStatSharedFuncHash, (void *) &key,
 						   HASH_REMOVE, NULL);
+		LWLockRelease(PgStatFuncLock);
+	}
 }
 
 /* ----------
@@ -4902,9 +4071,35 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	/*
 	 * Store the last autovacuum time in the database's hashtable entry.
 	 */
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+		dbentry->last_autovac_time = msg->m_start_time;
+
+	LWLockRelease(PgStatDBLock);
+}
+
+/*
+ * Subroutine for pgstat_recv_vacuum and pgstat_recv_analyze: make sure the
+ * database has an entry, so that the table will be seen by autovacuum.
+ */
+static void
+pgstat_create_db_entry(Oid databaseid)
+{
+	PgStat_StatDBEntry *dbentry;
+
+	/* Usually it's there already, and a shared lock is enough to see it */
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+	dbentry = pgstat_get_db_entry(databaseid, false);
+	LWLockRelease(PgStatDBLock);
 
-	dbentry->last_autovac_time = msg->m_start_time;
+	if (dbentry == NULL)
+	{
+		LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+		(void) pgstat_get_db_entry(databaseid, true);
+		LWLockRelease(PgStatDBLock);
+	}
 }
 
 /* ----------
@@ -4916,29 +4111,42 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 static void
 pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_SharedObjectKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	pgstat_create_db_entry(msg->m_databaseid);
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_tableoid;
+	hashcode = PgStatTabHashCode(&key);
+	partitionLock = PgStatPartitionLock(hashcode);
 
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
+	tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+	if (tabentry != NULL)
 	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
+		tabentry->n_live_tuples = msg->m_live_tuples;
+		tabentry->n_dead_tuples = msg->m_dead_tuples;
+
+		if (msg->m_autovacuum)
+		{
+			tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
+			tabentry->autovac_vacuum_count++;
+		}
+		else
+		{
+			tabentry->vacuum_timestamp = msg->m_vacuumtime;
+			tabentry->vacuum_count++;
+		}
 	}
+
+	LWLockRelease(partitionLock);
 }
 
 /* ----------
@@ -4950,35 +4158,48 @@ pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 static void
 pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_SharedObjectKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	pgstat_create_db_entry(msg->m_databaseid);
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_tableoid;
+	hashcode = PgStatTabHashCode(&key);
+	partitionLock = PgStatPartitionLock(hashcode);
 
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
+	tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+	if (tabentry != NULL)
+	{
+		tabentry->n_live_tuples = msg->m_live_tuples;
+		tabentry->n_dead_tuples = msg->m_dead_tuples;
 
-	/*
-	 * We reset changes_since_analyze to zero, forgetting any changes that
-	 * occurred while the ANALYZE was in progress.
-	 */
-	tabentry->changes_since_analyze = 0;
+		/*
+		 * We reset changes_since_analyze to zero, forgetting any changes that
+		 * occurred while the ANALYZE was in progress.
+		 */
+		tabentry->changes_since_analyze = 0;
 
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
+		if (msg->m_autovacuum)
+		{
+			tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
+			tabentry->autovac_analyze_count++;
+		}
+		else
+		{
+			tabentry->analyze_timestamp = msg->m_analyzetime;
+			tabentry->analyze_count++;
+		}
 	}
+
+	LWLockRelease(partitionLock);
 }
 
 
@@ -4986,27 +4207,37 @@ pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
  * pgstat_recv_archiver() -
  *
  *	Process a ARCHIVER message.
+ *
+ *	The archiver has no PGPROC and cannot take LWLocks, which is why the
+ *	cluster-wide statistics are protected by a spinlock only.
  * ----------
  */
 static void
 pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len)
 {
+	volatile PgStat_ArchiverStats *archiverStats;
+
+	SpinLockAcquire(&pgStatShared->mutex);
+
+	archiverStats = &pgStatShared->archiverStats;
 	if (msg->m_failed)
 	{
 		/* Failed archival attempt */
-		++archiverStats.failed_count;
-		memcpy(archiverStats.last_failed_wal, msg->m_xlog,
-			sizeof(archiverStats.last_failed_wal));
-		archiverStats.last_failed_timestamp = msg->m_timestamp;
+		++archiverStats->failed_count;
+		memcpy((char *) archiverStats->last_failed_wal, msg->m_xlog,
+			   sizeof(archiverStats->last_failed_wal));
+		archiverStats->last_failed_timestamp = msg->m_timestamp;
 	}
 	else
 	{
 		/* Successful archival operation */
-		++archiverStats.archived_count;
-		memcpy(archiverStats.last_archived_wal, msg->m_xlog,
-			sizeof(archiverStats.last_archived_wal));
-		archiverStats.last_archived_timestamp = msg->m_timestamp;
+		++archiverStats->archived_count;
+		memcpy((char *) archiverStats->last_archived_wal, msg->m_xlog,
+			   sizeof(archiverStats->last_archived_wal));
+		archiverStats->last_archived_timestamp = msg->m_timestamp;
 	}
+
+	SpinLockRelease(&pgStatShared->mutex);
 }
 
 /* ----------
@@ -5018,16 +4249,23 @@ pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len)
 static void
 pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
 {
-	globalStats.timed_checkpoints += msg->m_timed_checkpoints;
-	globalStats.requested_checkpoints += msg->m_requested_checkpoints;
-	globalStats.checkpoint_write_time += msg->m_checkpoint_write_time;
-	globalStats.checkpoint_sync_time += msg->m_checkpoint_sync_time;
-	globalStats.buf_written_checkpoints += msg->m_buf_written_checkpoints;
-	globalStats.buf_written_clean += msg->m_buf_written_clean;
-	globalStats.maxwritten_clean += msg->m_maxwritten_clean;
-	globalStats.buf_written_backend += msg->m_buf_written_backend;
-	globalStats.buf_fsync_backend += msg->m_buf_fsync_backend;
-	globalStats.buf_alloc += msg->m_buf_alloc;
+	volatile PgStat_GlobalStats *globalStats;
+
+	SpinLockAcquire(&pgStatShared->mutex);
+
+	globalStats = &pgStatShared->globalStats;
+	globalStats->timed_checkpoints += msg->m_timed_checkpoints;
+	globalStats->requested_checkpoints += msg->m_requested_checkpoints;
+	globalStats->checkpoint_write_time += msg->m_checkpoint_write_time;
+	globalStats->checkpoint_sync_time += msg->m_checkpoint_sync_time;
+	globalStats->buf_written_checkpoints += msg->m_buf_written_checkpoints;
+	globalStats->buf_written_clean += msg->m_buf_written_clean;
+	globalStats->maxwritten_clean += msg->m_maxwritten_clean;
+	globalStats->buf_written_backend += msg->m_buf_written_backend;
+	globalStats->buf_fsync_backend += msg->m_buf_fsync_backend;
+	globalStats->buf_alloc += msg->m_buf_alloc;
+
+	SpinLockRelease(&pgStatShared->mutex);
 }
 
 /* ----------
@@ -5041,7 +4279,14 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry == NULL)
+	{
+		LWLockRelease(PgStatDBLock);
+		return;
+	}
 
 	switch (msg->m_reason)
 	{
@@ -5068,6 +4313,8 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 			dbentry->n_conflict_startup_deadlock++;
 			break;
 	}
+
+	LWLockRelease(PgStatDBLock);
 }
 
 /* ----------
@@ -5081,9 +4328,13 @@ pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+		dbentry->n_deadlocks++;
 
-	dbentry->n_deadlocks++;
+	LWLockRelease(PgStatDBLock);
 }
 
 /* ----------
@@ -5097,10 +4348,16 @@ pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+	{
+		dbentry->n_temp_bytes += msg->m_filesize;
+		dbentry->n_temp_files += 1;
+	}
 
-	dbentry->n_temp_bytes += msg->m_filesize;
-	dbentry->n_temp_files += 1;
+	LWLockRelease(PgStatDBLock);
 }
 
 /* ----------
@@ -5113,21 +4370,32 @@ static void
 pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 {
 	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry;
+	PgStat_SharedFuncEntry *funcentry;
+	PgStat_SharedObjectKey key;
 	int			i;
 	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	pgstat_create_db_entry(msg->m_databaseid);
 
 	/*
 	 * Process all function entries in the message.
 	 */
+	LWLockAcquire(PgStatFuncLock, LW_EXCLUSIVE);
+
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
 	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-												   (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
+		key.objectid = funcmsg->f_id;
+		funcentry = (PgStat_SharedFuncEntry *) hash_search(pgStatSharedFuncHash,
+														   (void *) &key,
+													HASH_ENTER_NULL, &found);
+
+		/* If there is no room for a new entry, the counts are lost */
+		if (funcentry == NULL)
+		{
+			pgstat_report_func_overflow();
+			continue;
+		}
 
 		if (!found)
 		{
@@ -5135,20 +4403,23 @@ pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 			 * If it's a new function entry, initialize counters to the values
 			 * we just got.
 			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_total_time = funcmsg->f_total_time;
-			funcentry->f_self_time = funcmsg->f_self_time;
+			funcentry->stats.functionid = funcmsg->f_id;
+			funcentry->stats.f_numcalls = funcmsg->f_numcalls;
+			funcentry->stats.f_total_time = funcmsg->f_total_time;
+			funcentry->stats.f_self_time = funcmsg->f_self_time;
 		}
 		else
 		{
 			/*
 			 * Otherwise add the values to the existing entry.
 			 */
-			funcentry->f_numcalls += funcmsg->f_numcalls;
-			funcentry->f_total_time += funcmsg->f_total_time;
-			funcentry->f_self_time += funcmsg->f_self_time;
+			funcentry->stats.f_numcalls += funcmsg->f_numcalls;
+			funcentry->stats.f_total_time += funcmsg->f_total_time;
+			funcentry->stats.f_self_time += funcmsg->f_self_time;
 		}
 	}
+
+	LWLockRelease(PgStatFuncLock);
 }
 
 /* ----------
@@ -5160,64 +4431,22 @@ pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 static void
 pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_SharedObjectKey key;
 	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
+	LWLockAcquire(PgStatFuncLock, LW_EXCLUSIVE);
 
 	/*
 	 * Process all function entries in the message.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++)
 	{
 		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
+		key.objectid = msg->m_functionid[i];
+		(void) hash_search(pgStatSharedFuncHash, (void *) &key,
 						   HASH_REMOVE, NULL);
 	}
-}
-
-/* ----------
- * pgstat_write_statsfile_needed() -
- *
- *	Do we need to write out the files?
- * ----------
- */
-static bool
-pgstat_write_statsfile_needed(void)
-{
-	if (!slist_is_empty(&last_statrequests))
-		return true;
-
-	/* Everything was written recently */
-	return false;
-}
-
-/* ----------
- * pgstat_db_requested() -
- *
- *	Checks whether stats for a particular DB need to be written to a file.
- * ----------
- */
-static bool
-pgstat_db_requested(Oid databaseid)
-{
-	slist_iter	iter;
-
-	/* Check the databases if they need to refresh the stats. */
-	slist_foreach(iter, &last_statrequests)
-	{
-		DBWriteRequest *req = slist_container(DBWriteRequest, next, iter.cur);
-
-		if (req->databaseid == databaseid)
-			return true;
-	}
 
-	return false;
+	LWLockRelease(PgStatFuncLock);
 }
@@ -63,8 +63,18 @@ static void commit_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
 							   XLogRecPtr commit_lsn);
 static void change_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
 						   Relation relation, ReorderBufferChange *change);
+static void stream_start_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn);
+static void stream_stop_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn);
+static void stream_change_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
+						   Relation relation, ReorderBufferChange *change);
+static void stream_abort_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
+						XLogRecPtr abort_lsn);
+static void stream_commit_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
+						 XLogRecPtr commit_lsn);
 
 static void LoadOutputPlugin(OutputPluginCallbacks *callbacks, char *plugin);
+static void StartFromOtherSlot(LogicalDecodingContext *ctx);
+static void SetupStreaming(LogicalDecodingContext *ctx);
 
 /*
  * Make sure the current settings & environment are capable of doing logical
@@ -178,6 +188,8 @@ StartupDecodingContext(List *output_plugin_options,
  *
  * plugin contains the name of the output plugin
  * output_plugin_options contains options passed to the output plugin
+ * need_full_snapshot has to be set if the caller wants to export a snapshot
+ *		once the slot is consistent
  * read_page, prepare_write, do_write are callbacks that have to be filled to
  *		perform the use-case dependent, actual, work.
  *
@@ -191,6 +203,7 @@ StartupDecodingContext(List *output_plugin_options,
 LogicalDecodingContext *
 CreateInitDecodingContext(char *plugin,
 						  List *output_plugin_options,
+						  bool need_full_snapshot,
 						  XLogPageReadCB read_page,
 						  LogicalOutputPluginWriterPrepareWrite prepare_write,
 						  LogicalOutputPluginWriterWrite do_write)
@@ -318,15 +331,135 @@ CreateInitDecodingContext(char *plugin,
 	ctx = StartupDecodingContext(NIL, InvalidXLogRecPtr, xmin_horizon,
 								  read_page, prepare_write, do_write);
 
+	/*
+	 * Unless a snapshot has to be exported, try to spare waiting for the
+	 * transactions running right now by using another slot's snapshot.
+	 */
+	if (!need_full_snapshot && !RecoveryInProgress())
+		StartFromOtherSlot(ctx);
+
 	/* call output plugin initialization callback */
 	old_context = MemoryContextSwitchTo(ctx->context);
 	if (ctx->callbacks.startup_cb != NULL)
 		startup_cb_wrapper(ctx, &ctx->options, true);
 	MemoryContextSwitchTo(old_context);
 
+	SetupStreaming(ctx);
+
 	return ctx;
 }
 
+/*
+ * Make a new slot start decoding where another slot of the same database can
+ * restart decoding from, using the snapshot that slot serialized there.
+ *
+ * A new slot normally has to wait for the transactions running at its start
+ * point to finish, as their earlier changes were never read. But all the
+ * transactions running at the other slot's restart_lsn finished before its
+ * confirmed_flush, or restart_lsn could not have advanced that far. So we
+ * can instead skip everything committing up to confirmed_flush, like the
+ * other slot itself does when it restarts. The resulting snapshot only
+ * tracks catalog changing transactions, so it cannot be exported.
+ *
+ * The slot and the snapshot builder are left alone if there's no such slot,
+ * or its snapshot or WAL have been removed in the meantime.
+ */
+static void
+StartFromOtherSlot(LogicalDecodingContext *ctx)
+{
+	ReplicationSlot *slot = MyReplicationSlot;
+	XLogRecPtr	own_restart_lsn = slot->data.restart_lsn;
+	TransactionId own_catalog_xmin = slot->data.catalog_xmin;
+	XLogRecPtr	restart_lsn = InvalidXLogRecPtr;
+	XLogRecPtr	confirmed_flush = InvalidXLogRecPtr;
+	TransactionId catalog_xmin = InvalidTransactionId;
+	XLogSegNo	segno;
+	int			i;
+
+	/*
+	 * As in CreateInitDecodingContext(), hold ProcArrayLock so no new xmin
+	 * horizon can be computed until we have taken over the other slot's
+	 * catalog_xmin: that is still protecting the catalog rows it needs.
+	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	LWLockAcquire(ReplicationSlotControlLock, LW_SHARED);
+
+	for (i = 0; i < max_replication_slots; i++)
+	{
+		volatile ReplicationSlot *s = &ReplicationSlotCtl->replication_slots[i];
+		XLogRecPtr	s_restart_lsn;
+		XLogRecPtr	s_confirmed_flush;
+		TransactionId s_catalog_xmin;
+
+		if (!s->in_use || s == slot)
+			continue;
+
+		/* the slot only tracks transactions of its own database */
+		if (s->data.database != slot->data.database)
+			continue;
+
+		SpinLockAcquire(&s->mutex);
+		s_restart_lsn = s->data.restart_lsn;
+		s_confirmed_flush = s->data.confirmed_flush;
+		s_catalog_xmin = s->effective_catalog_xmin;
+		SpinLockRelease(&s->mutex);
+
+		/* not done building its own initial snapshot yet */
+		if (s_restart_lsn == InvalidXLogRecPtr ||
+			s_confirmed_flush == InvalidXLogRecPtr ||
+			!TransactionIdIsValid(s_catalog_xmin))
+			continue;
+
+		/* the further along, the less WAL we have to read */
+		if (s_restart_lsn > restart_lsn)
+		{
+			restart_lsn = s_restart_lsn;
+			confirmed_flush = s_confirmed_flush;
+			catalog_xmin = s_catalog_xmin;
+		}
+	}
+
+	LWLockRelease(ReplicationSlotControlLock);
+
+	if (restart_lsn == InvalidXLogRecPtr)
+	{
+		LWLockRelease(ProcArrayLock);
+		return;
+	}
+
+	slot->effective_catalog_xmin = catalog_xmin;
+	slot->data.catalog_xmin = catalog_xmin;
+	ReplicationSlotsComputeRequiredXmin(true);
+
+	LWLockRelease(ProcArrayLock);
+
+	slot->data.restart_lsn = restart_lsn;
+	ReplicationSlotsComputeRequiredLSN();
+
+	XLByteToSeg(restart_lsn, segno);
+	if (XLogGetLastRemovedSegno() < segno &&
+		SnapBuildRestoreFromSlot(ctx->snapshot_builder, restart_lsn,
+								 confirmed_flush))
+	{
+		/* DecodingContextFindStartpoint() has to read up to here */
+		slot->data.confirmed_flush = confirmed_flush;
+
+		ReplicationSlotMarkDirty();
+		ReplicationSlotSave();
+		return;
+	}
+
+	/* build the snapshot from where we were going to start after all */
+	slot->data.restart_lsn = own_restart_lsn;
+	ReplicationSlotsComputeRequiredLSN();
+
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	slot->effective_catalog_xmin = own_catalog_xmin;
+	slot->data.catalog_xmin = own_catalog_xmin;
+	ReplicationSlotsComputeRequiredXmin(true);
+	LWLockRelease(ProcArrayLock);
+}
+
 /*
  * Create a new decoding context, for a logical slot that has previously been
  * used already.
@@ -405,6 +538,8 @@ CreateDecodingContext(XLogRecPtr start_lsn,
 		startup_cb_wrapper(ctx, &ctx->options, false);
 	MemoryContextSwitchTo(old_context);
 
+	SetupStreaming(ctx);
+
 	ereport(LOG,
 			(errmsg("starting logical decoding for slot %s",
 					NameStr(slot->data.name)),
@@ -463,8 +598,12 @@ DecodingContextFindStartpoint(LogicalDecodingContext *ctx)
 
 		LogicalDecodingProcessRecord(ctx, record);
 
-		/* only continue till we found a consistent spot */
-		if (DecodingContextReady(ctx))
+		/*
+		 * only continue till we found a consistent spot, and got past where
+		 * we were told to start streaming changes at
+		 */
+		if (DecodingContextReady(ctx) &&
+			ctx->reader->EndRecPtr >= ctx->slot->data.confirmed_flush)
 			break;
 	}
 
@@ -539,6 +678,30 @@ LoadOutputPlugin(OutputPluginCallbacks *callbacks, char *plugin)
 		elog(ERROR, "output plugins have to register a commit callback");
 }
 
+/*
+ * If the output plugin asked for large in-progress transactions to be
+ * streamed in its startup callback, make the reorder buffer do so.
+ */
+static void
+SetupStreaming(LogicalDecodingContext *ctx)
+{
+	OutputPluginCallbacks *cb = &ctx->callbacks;
+
+	if (!ctx->options.streaming)
+		return;
+
+	if (cb->stream_start_cb == NULL || cb->stream_stop_cb == NULL ||
+		cb->stream_change_cb == NULL || cb->stream_abort_cb == NULL ||
+		cb->stream_commit_cb == NULL)
+		elog(ERROR, "output plugins requesting streaming have to register all stream callbacks");
+
+	ctx->reorder->stream_start = stream_start_cb_wrapper;
+	ctx->reorder->stream_stop = stream_stop_cb_wrapper;
+	ctx->reorder->stream_change = stream_change_cb_wrapper;
+	ctx->reorder->stream_abort = stream_abort_cb_wrapper;
+	ctx->reorder->stream_commit = stream_commit_cb_wrapper;
+}
+
 static void
 output_plugin_error_callback(void *arg)
 {
@@ -704,6 +867,148 @@ change_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
 	error_context_stack = errcallback.previous;
 }
 
+static void
+stream_start_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn)
+{
+	LogicalDecodingContext *ctx = cache->private_data;
+	LogicalErrorCallbackState state;
+	ErrorContextCallback errcallback;
+
+	/* Push callback + info on the error context stack */
+	state.ctx = ctx;
+	state.callback_name = "stream_start";
+	state.report_location = txn->first_lsn;
+	errcallback.callback = output_plugin_error_callback;
+	errcallback.arg = (void *) &state;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* set output state */
+	ctx->accept_writes = true;
+	ctx->write_xid = txn->xid;
+	ctx->write_location = txn->first_lsn;
+
+	/* do the actual work: call callback */
+	ctx->callbacks.stream_start_cb(ctx, txn);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+}
+
+static void
+stream_stop_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn)
+{
+	LogicalDecodingContext *ctx = cache->private_data;
+	LogicalErrorCallbackState state;
+	ErrorContextCallback errcallback;
+
+	/* Push callback + info on the error context stack */
+	state.ctx = ctx;
+	state.callback_name = "stream_stop";
+	state.report_location = txn->first_lsn;
+	errcallback.callback = output_plugin_error_callback;
+	errcallback.arg = (void *) &state;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* set output state */
+	ctx->accept_writes = true;
+	ctx->write_xid = txn->xid;
+	ctx->write_location = txn->first_lsn;
+
+	/* do the actual work: call callback */
+	ctx->callbacks.stream_stop_cb(ctx, txn);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+}
+
+static void
+stream_change_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
+						 Relation relation, ReorderBufferChange *change)
+{
+	LogicalDecodingContext *ctx = cache->private_data;
+	LogicalErrorCallbackState state;
+	ErrorContextCallback errcallback;
+
+	/* Push callback + info on the error context stack */
+	state.ctx = ctx;
+	state.callback_name = "stream_change";
+	state.report_location = change->lsn;
+	errcallback.callback = output_plugin_error_callback;
+	errcallback.arg = (void *) &state;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* set output state, see change_cb_wrapper about the location */
+	ctx->accept_writes = true;
+	ctx->write_xid = txn->xid;
+	ctx->write_location = change->lsn;
+
+	ctx->callbacks.stream_change_cb(ctx, txn, relation, change);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+}
+
+static void
+stream_abort_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
+						XLogRecPtr abort_lsn)
+{
+	LogicalDecodingContext *ctx = cache->private_data;
+	LogicalErrorCallbackState state;
+	ErrorContextCallback errcallback;
+
+	/* Push callback + info on the error context stack */
+	state.ctx = ctx;
+	state.callback_name = "stream_abort";
+	state.report_location = abort_lsn;
+	errcallback.callback = output_plugin_error_callback;
+	errcallback.arg = (void *) &state;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* set output state */
+	ctx->accept_writes = true;
+	ctx->write_xid = txn->xid;
+	ctx->write_location = abort_lsn;
+
+	/* do the actual work: call callback */
+	ctx->callbacks.stream_abort_cb(ctx, txn, abort_lsn);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+}
+
+static void
+stream_commit_cb_wrapper(ReorderBuffer *cache, ReorderBufferTXN *txn,
+						 XLogRecPtr commit_lsn)
+{
+	LogicalDecodingContext *ctx = cache->private_data;
+	LogicalErrorCallbackState state;
+	ErrorContextCallback errcallback;
+
+	/* Push callback + info on the error context stack */
+	state.ctx = ctx;
+	state.callback_name = "stream_commit";
+	state.report_location = txn->final_lsn; /* beginning of commit record */
+	errcallback.callback = output_plugin_error_callback;
+	errcallback.arg = (void *) &state;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/* set output state */
+	ctx->accept_writes = true;
+	ctx->write_xid = txn->xid;
+	ctx->write_location = txn->end_lsn; /* points to the end of the record */
+
+	/* do the actual work: call callback */
+	ctx->callbacks.stream_commit_cb(ctx, txn, commit_lsn);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+}
+
 /*
  * Set the required catalog xmin horizon for historic snapshots in the current
  * replication slot.
@@ -36,6 +36,13 @@
  *	  contents of individual (sub-)transactions will be read from disk in
  *	  chunks.
  *
+ *	  If the output plugin supports it, the changes of a large transaction are
+ *	  instead streamed to it while the transaction is still in progress, in
+ *	  blocks of the same size as spilled to disk otherwise. That's only done
+ *	  for transactions that haven't (yet) modified the catalog, as decoding
+ *	  their changes doesn't depend on invalidations only known at commit. If
+ *	  such a transaction ends up aborting, the output plugin is told so.
+ *
  *	  This module also has to deal with reassembling toast records from the
  *	  individual chunks stored in WAL. When a new (or initial) version of a
  *	  tuple is stored in WAL it will always be preceded by the toast chunks
@@ -66,7 +73,7 @@
 #include "replication/logical.h"
 #include "replication/reorderbuffer.h"
 #include "replication/slot.h"
-#include "replication/snapbuild.h" /* just for SnapBuildSnapDecRefcount */
+#include "replication/snapbuild.h"
 
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -102,14 +109,24 @@ typedef struct ReorderBufferTupleCidEnt
 	CommandId	combocid;		/* just for debugging */
 } ReorderBufferTupleCidEnt;
 
+/* read-ahead state for restoring the spilled changes of a transaction */
+typedef struct ReorderBufferSpillReader
+{
+	int			fd;				/* currently open spill file, or -1 */
+	XLogSegNo	segno;			/* segment of that file */
+	char	   *buf;			/* read-ahead buffer, allocated lazily */
+	Size		bufsize;		/* allocated size of buf */
+	Size		off;			/* start of the not yet consumed data */
+	Size		len;			/* end of the valid data */
+} ReorderBufferSpillReader;
+
 /* k-way in-order change iteration support structures */
 typedef struct ReorderBufferIterTXNEntry
 {
 	XLogRecPtr	lsn;
 	ReorderBufferChange *change;
 	ReorderBufferTXN *txn;
-	int			fd;
-	XLogSegNo	segno;
+	ReorderBufferSpillReader reader;
 } ReorderBufferIterTXNEntry;
 
 typedef struct ReorderBufferIterTXNState
@@ -133,14 +150,32 @@ typedef struct ReorderBufferToastEnt
 										 * to in main tup */
 } ReorderBufferToastEnt;
 
-/* Disk serialization support datastructures */
+/*
+ * Disk serialization support datastructures.
+ *
+ * Every spilled change starts with a ReorderBufferDiskChange header, followed
+ * by the action specific data: for INSERT/UPDATE/DELETE the RelFileNode and
+ * the old and new tuple, each as a ReorderBufferDiskTuple followed by t_len
+ * bytes of tuple data; for snapshots the SnapshotData followed by its xip and
+ * subxip arrays; for the other internal changes the respective union member.
+ * Nothing on disk is aligned, it's all read back with memcpy().
+ */
 typedef struct ReorderBufferDiskChange
 {
-	Size		size;
-	ReorderBufferChange change;
+	uint32		size;			/* total size, including this header */
+	uint32		action;			/* enum ReorderBufferChangeType */
+	XLogRecPtr	lsn;
 	/* data follows */
 } ReorderBufferDiskChange;
 
+typedef struct ReorderBufferDiskTuple
+{
+	uint32		t_len;			/* 0 if there's no such tuple */
+	ItemPointerData t_self;
+	Oid			t_tableOid;
+	/* t_len bytes of tuple data follow */
+} ReorderBufferDiskTuple;
+
 /*
  * Maximum number of changes kept in memory, per transaction. After that,
  * changes are spooled to disk.
@@ -155,6 +190,15 @@ typedef struct ReorderBufferDiskChange
  */
 static const Size max_changes_in_memory = 4096;
 
+/*
+ * Spilled changes are written out in chunks of up to max_spill_write_size
+ * bytes, and read back through a read-ahead buffer of max_spill_read_size
+ * bytes per (sub-)transaction, instead of using one or two system calls per
+ * change.
+ */
+static const Size max_spill_write_size = 64 * 1024;
+static const Size max_spill_read_size = 16 * 1024;
+
 /*
  * We use a very simple form of a slab allocator for frequently allocated
  * objects, simply keeping a fixed number in a linked list when unused,
@@ -203,12 +247,26 @@ static void ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 							 int fd, ReorderBufferChange *change);
+static void ReorderBufferSerializeFlush(ReorderBuffer *rb, ReorderBufferTXN *txn,
+							int fd);
 static Size ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
-							int *fd, XLogSegNo *segno);
+							ReorderBufferSpillReader *reader);
 static void ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 						   char *change);
 static void ReorderBufferRestoreCleanup(ReorderBuffer *rb, ReorderBufferTXN *txn);
 
+/* ---------------------------------------
+ * Streaming of large in-progress transactions
+ * ---------------------------------------
+ */
+static bool ReorderBufferCanStream(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						XLogRecPtr commit_lsn);
+static void ReorderBufferTransferSnapToParent(ReorderBufferTXN *txn,
+								  ReorderBufferTXN *subtxn);
+
 static void ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap);
 static Snapshot ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
 					  ReorderBufferTXN *txn, CommandId cid);
@@ -266,6 +324,14 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->outbuf_used = 0;
+
+	/* no streaming unless the output plugin asks for it */
+	buffer->stream_start = NULL;
+	buffer->stream_stop = NULL;
+	buffer->stream_change = NULL;
+	buffer->stream_abort = NULL;
+	buffer->stream_commit = NULL;
 
 	buffer->current_restart_decoding_lsn = InvalidXLogRecPtr;
 
@@ -665,33 +731,38 @@ ReorderBufferAssignChild(ReorderBuffer *rb, TransactionId xid,
 	txn = ReorderBufferTXNByXid(rb, xid, true, &new_top, lsn, true);
 	subtxn = ReorderBufferTXNByXid(rb, subxid, true, &new_sub, lsn, false);
 
-	if (new_sub)
+	if (!new_sub)
 	{
-		/*
-		 * we assign subtransactions to top level transaction even if we don't
-		 * have data for it yet, assignment records frequently reference xids
-		 * that have not yet produced any records. Knowing those aren't top
-		 * level xids allows us to make processing cheaper in some places.
-		 */
-		dlist_push_tail(&txn->subtxns, &subtxn->node);
-		txn->nsubtxns++;
-	}
-	else if (!subtxn->is_known_as_subxact)
-	{
-		subtxn->is_known_as_subxact = true;
+		if (subtxn->is_known_as_subxact)
+		{
+			if (new_top)
+				elog(ERROR, "existing subxact assigned to unknown toplevel xact");
+
+			/* already associated, nothing to do */
+			return;
+		}
+
+		if (subtxn->streamed)
+			elog(ERROR, "subtransaction %u was streamed as a toplevel transaction",
+				 subxid);
+
 		Assert(subtxn->nsubtxns == 0);
 
 		/* remove from lsn order list of top-level transactions */
 		dlist_delete(&subtxn->node);
-
-		/* add to toplevel transaction */
-		dlist_push_tail(&txn->subtxns, &subtxn->node);
-		txn->nsubtxns++;
-	}
-	else if (new_top)
-	{
-		elog(ERROR, "existing subxact assigned to unknown toplevel xact");
 	}
+
+	/*
+	 * we assign subtransactions to top level transaction even if we don't
+	 * have data for it yet, assignment records frequently reference xids
+	 * that have not yet produced any records. Knowing those aren't top level
+	 * xids allows us to make processing cheaper in some places, and is
+	 * required to stream the transaction before it commits.
+	 */
+	subtxn->is_known_as_subxact = true;
+	subtxn->toptxn = txn;
+	dlist_push_tail(&txn->subtxns, &subtxn->node);
+	txn->nsubtxns++;
 }
 
 /*
@@ -720,27 +791,19 @@ ReorderBufferCommitChild(ReorderBuffer *rb, TransactionId xid,
 	if (txn == NULL)
 		elog(ERROR, "subxact logged without previous toplevel record");
 
-	/*
-	 * Pass the our base snapshot to the parent transaction if it doesn't have
-	 * one, or ours is older. That can happen if there are no changes in the
-	 * toplevel transaction but in one of the child transactions. This allows
-	 * the parent to simply use it's base snapshot initially.
-	 */
-	if (txn->base_snapshot == NULL ||
-		txn->base_snapshot_lsn > subtxn->base_snapshot_lsn)
-	{
-		txn->base_snapshot = subtxn->base_snapshot;
-		txn->base_snapshot_lsn = subtxn->base_snapshot_lsn;
-		subtxn->base_snapshot = NULL;
-		subtxn->base_snapshot_lsn = InvalidXLogRecPtr;
-	}
+	ReorderBufferTransferSnapToParent(txn, subtxn);
 
 	subtxn->final_lsn = commit_lsn;
 	subtxn->end_lsn = end_lsn;
 
 	if (!subtxn->is_known_as_subxact)
 	{
+		if (subtxn->streamed)
+			elog(ERROR, "subtransaction %u was streamed as a toplevel transaction",
+				 subxid);
+
 		subtxn->is_known_as_subxact = true;
+		subtxn->toptxn = txn;
 		Assert(subtxn->nsubtxns == 0);
 
 		/* remove from lsn order list of top-level transactions */
@@ -752,6 +815,33 @@ ReorderBufferCommitChild(ReorderBuffer *rb, TransactionId xid,
 	}
 }
 
+/*
+ * Pass the base snapshot of a subtransaction to its toplevel transaction if
+ * that doesn't have one, or the subtransaction's is older. That can happen if
+ * there are no changes in the toplevel transaction but in one of the child
+ * transactions. This allows the parent to simply use its base snapshot
+ * initially.
+ */
+static void
+ReorderBufferTransferSnapToParent(ReorderBufferTXN *txn,
+								  ReorderBufferTXN *subtxn)
+{
+	if (subtxn->base_snapshot == NULL)
+		return;
+
+	if (txn->base_snapshot == NULL ||
+		txn->base_snapshot_lsn > subtxn->base_snapshot_lsn)
+	{
+		if (txn->base_snapshot != NULL)
+			SnapBuildSnapDecRefcount(txn->base_snapshot);
+
+		txn->base_snapshot = subtxn->base_snapshot;
+		txn->base_snapshot_lsn = subtxn->base_snapshot_lsn;
+		subtxn->base_snapshot = NULL;
+		subtxn->base_snapshot_lsn = InvalidXLogRecPtr;
+	}
+}
+
 
 /*
  * Support for efficiently iterating over a transaction's and its
@@ -828,8 +918,9 @@ ReorderBufferIterTXNInit(ReorderBuffer *rb, ReorderBufferTXN *txn)
 
 	for (off = 0; off < state->nr_txns; off++)
 	{
-		state->entries[off].fd = -1;
-		state->entries[off].segno = 0;
+		state->entries[off].reader.fd = -1;
+		state->entries[off].reader.segno = 0;
+		state->entries[off].reader.buf = NULL;
 	}
 
 	/* allocate heap */
@@ -850,8 +941,7 @@ ReorderBufferIterTXNInit(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		ReorderBufferChange *cur_change;
 
 		if (txn->nentries != txn->nentries_mem)
-			ReorderBufferRestoreChanges(rb, txn, &state->entries[off].fd,
-										&state->entries[off].segno);
+			ReorderBufferRestoreChanges(rb, txn, &state->entries[off].reader);
 
 		cur_change = dlist_head_element(ReorderBufferChange, node,
 										&txn->changes);
@@ -874,10 +964,9 @@ ReorderBufferIterTXNInit(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		{
 			ReorderBufferChange *cur_change;
 
-			if (txn->nentries != txn->nentries_mem)
+			if (cur_txn->nentries != cur_txn->nentries_mem)
 				ReorderBufferRestoreChanges(rb, cur_txn,
-											&state->entries[off].fd,
-											&state->entries[off].segno);
+											&state->entries[off].reader);
 
 			cur_change = dlist_head_element(ReorderBufferChange, node,
 											&cur_txn->changes);
@@ -957,8 +1046,7 @@ ReorderBufferIterTXNNext(ReorderBuffer *rb, ReorderBufferIterTXNState *state)
 		dlist_delete(&change->node);
 		dlist_push_tail(&state->old_change, &change->node);
 
-		if (ReorderBufferRestoreChanges(rb, entry->txn, &entry->fd,
-										&state->entries[off].segno))
+		if (ReorderBufferRestoreChanges(rb, entry->txn, &entry->reader))
 		{
 			/* successfully restored changes from disk */
 			ReorderBufferChange *next_change =
@@ -996,8 +1084,10 @@ ReorderBufferIterTXNFinish(ReorderBuffer *rb,
 
 	for (off = 0; off < state->nr_txns; off++)
 	{
-		if (state->entries[off].fd != -1)
-			CloseTransientFile(state->entries[off].fd);
+		if (state->entries[off].reader.fd != -1)
+			CloseTransientFile(state->entries[off].reader.fd);
+		if (state->entries[off].reader.buf != NULL)
+			pfree(state->entries[off].reader.buf);
 	}
 
 	/* free memory we might have "leaked" in the last *Next call */
@@ -1073,6 +1163,15 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		txn->base_snapshot_lsn = InvalidXLogRecPtr;
 	}
 
+	if (txn->snapshot_now != NULL)
+	{
+		ReorderBufferFreeSnap(rb, txn->snapshot_now);
+		txn->snapshot_now = NULL;
+	}
+
+	/* toast chunks of a streamed transaction still waiting for their row */
+	ReorderBufferToastReset(rb, txn);
+
 	/* delete from list of known subxacts */
 	if (txn->is_known_as_subxact)
 	{
@@ -1093,7 +1192,7 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	Assert(found);
 
 	/* remove entries spilled to disk */
-	if (txn->nentries != txn->nentries_mem)
+	if (txn->serialized)
 		ReorderBufferRestoreCleanup(rb, txn);
 
 	/* deallocate */
@@ -1258,7 +1357,9 @@ ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap)
  * record is read because that's currently the only place where we know about
  * cache invalidations. Thus, once a toplevel commit is read, we iterate over
  * the top and subtransactions (using a k-way merge) and replay the changes in
- * lsn order.
+ * lsn order. Transactions whose earlier changes have already been streamed
+ * get their remaining changes streamed as a last block instead, followed by
+ * the stream_commit callback.
  */
 void
 ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
@@ -1266,13 +1367,6 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					TimestampTz commit_time)
 {
 	ReorderBufferTXN *txn;
-	ReorderBufferIterTXNState *iterstate = NULL;
-	ReorderBufferChange *change;
-
-	volatile CommandId	command_id = FirstCommandId;
-	volatile Snapshot	snapshot_now = NULL;
-	volatile bool		txn_started = false;
-	volatile bool		subtxn_started = false;
 
 	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
 								false);
@@ -1298,11 +1392,48 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 	if (txn->base_snapshot == NULL)
 	{
 		Assert(txn->ninvalidations == 0);
+		Assert(!txn->streamed);
 		ReorderBufferCleanupTXN(rb, txn);
 		return;
 	}
 
-	snapshot_now = txn->base_snapshot;
+	ReorderBufferProcessTXN(rb, txn, commit_lsn);
+}
+
+/*
+ * Replay the changes of a toplevel transaction and its subtransactions.
+ *
+ * If commit_lsn is valid the transaction has committed, and is cleaned up
+ * afterwards. Otherwise the changes accumulated so far are streamed as a
+ * block, and discarded afterwards; the snapshot and CommandId in use at the
+ * end of the block are remembered so that the next block continues from
+ * there.
+ */
+static void
+ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						XLogRecPtr commit_lsn)
+{
+	ReorderBufferIterTXNState *volatile iterstate = NULL;
+	ReorderBufferChange *change;
+	bool		in_progress = (commit_lsn == InvalidXLogRecPtr);
+
+	volatile CommandId	command_id = FirstCommandId;
+	volatile Snapshot	snapshot_now = NULL;
+	volatile bool		txn_started = false;
+	volatile bool		subtxn_started = false;
+	volatile bool		block_started = false;
+
+	Assert(!in_progress || txn->streamed);
+
+	if (txn->snapshot_now != NULL)
+	{
+		/* continue where the last streamed block stopped */
+		command_id = txn->command_id;
+		snapshot_now = ReorderBufferCopySnap(rb, txn->snapshot_now,
+											 txn, command_id);
+	}
+	else
+		snapshot_now = txn->base_snapshot;
 
 	/* build data to be able to lookup the CommandIds of catalog tuples */
 	ReorderBufferBuildTupleCidHash(rb, txn);
@@ -1335,7 +1466,8 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 			txn_started = true;
 		}
 
-		rb->begin(rb, txn);
+		if (!txn->streamed)
+			rb->begin(rb, txn);
 
 		iterstate = ReorderBufferIterTXNInit(rb, txn);
 		while ((change = ReorderBufferIterTXNNext(rb, iterstate)))
@@ -1386,7 +1518,20 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 						else if (!IsToastRelation(relation))
 						{
 							ReorderBufferToastReplace(rb, txn, relation, change);
-							rb->apply_change(rb, txn, relation, change);
+
+							if (!txn->streamed)
+								rb->apply_change(rb, txn, relation, change);
+							else
+							{
+								/* only open a block if there's something in it */
+								if (!block_started)
+								{
+									rb->stream_start(rb, txn);
+									block_started = true;
+								}
+								rb->stream_change(rb, txn, relation, change);
+							}
+
 							ReorderBufferToastReset(rb, txn);
 						}
 						/* we're not interested in toast deletions */
@@ -1476,9 +1621,20 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		}
 
 		ReorderBufferIterTXNFinish(rb, iterstate);
+		iterstate = NULL;
 
-		/* call commit callback */
-		rb->commit(rb, txn, commit_lsn);
+		if (!txn->streamed)
+		{
+			/* call commit callback */
+			rb->commit(rb, txn, commit_lsn);
+		}
+		else
+		{
+			if (block_started)
+				rb->stream_stop(rb, txn);
+			if (!in_progress)
+				rb->stream_commit(rb, txn, commit_lsn);
+		}
 
 		/* this is just a sanity check against bad output plugin behaviour */
 		if (GetCurrentTransactionIdIfAny() != InvalidTransactionId)
@@ -1502,11 +1658,29 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		else if (txn_started)
 			AbortCurrentTransaction();
 
+		if (in_progress)
+		{
+			/* remember the snapshot for the next block */
+			if (txn->snapshot_now != NULL)
+				ReorderBufferFreeSnap(rb, txn->snapshot_now);
+			txn->snapshot_now = ReorderBufferCopySnap(rb, snapshot_now,
+													  txn, command_id);
+			txn->command_id = command_id;
+		}
+
 		if (snapshot_now->copied)
 			ReorderBufferFreeSnap(rb, snapshot_now);
 
-		/* remove potential on-disk data, and deallocate */
-		ReorderBufferCleanupTXN(rb, txn);
+		if (in_progress)
+		{
+			/* get rid of the streamed changes, but keep the transaction */
+			ReorderBufferTruncateTXN(rb, txn);
+		}
+		else
+		{
+			/* remove potential on-disk data, and deallocate */
+			ReorderBufferCleanupTXN(rb, txn);
+		}
 	}
 	PG_CATCH();
 	{
@@ -1565,6 +1739,10 @@ ReorderBufferAbort(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	/* cosmetic... */
 	txn->final_lsn = lsn;
 
+	/* the output plugin has to discard the changes it already got */
+	if (txn->streamed)
+		rb->stream_abort(rb, txn, lsn);
+
 	/* remove potential on-disk data, and deallocate */
 	ReorderBufferCleanupTXN(rb, txn);
 }
@@ -1596,8 +1774,22 @@ ReorderBufferAbortOld(ReorderBuffer *rb, TransactionId oldestRunningXid)
 
 		if (TransactionIdPrecedes(txn->xid, oldestRunningXid))
 		{
+			dlist_iter	subtxn_i;
+
 			elog(DEBUG1, "aborting old transaction %u", txn->xid);
 
+			/* there's no abort record to point to */
+			dlist_foreach(subtxn_i, &txn->subtxns)
+			{
+				ReorderBufferTXN *subtxn;
+
+				subtxn = dlist_container(ReorderBufferTXN, node, subtxn_i.cur);
+				if (subtxn->streamed)
+					rb->stream_abort(rb, subtxn, InvalidXLogRecPtr);
+			}
+			if (txn->streamed)
+				rb->stream_abort(rb, txn, InvalidXLogRecPtr);
+
 			/* remove potential on-disk data, and deallocate this tx */
 			ReorderBufferCleanupTXN(rb, txn);
 		}
@@ -1634,6 +1826,10 @@ ReorderBufferForget(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	/* cosmetic... */
 	txn->final_lsn = lsn;
 
+	/* we're not interested in it after all, so have its changes discarded */
+	if (txn->streamed)
+		rb->stream_abort(rb, txn, lsn);
+
 	/*
 	 * Proccess cache invalidation messages if there are any. Even if we're
 	 * not interested in the transaction's contents, it could have manipulated
@@ -1881,7 +2077,8 @@ ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
 }
 
 /*
- * Check whether the transaction tx should spill its data to disk.
+ * Check whether the transaction tx should spill its data to disk, or, if
+ * possible, have it streamed to the output plugin.
  */
 static void
 ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
@@ -1892,11 +2089,132 @@ ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	 */
 	if (txn->nentries_mem >= max_changes_in_memory)
 	{
-		ReorderBufferSerializeTXN(rb, txn);
+		ReorderBufferTXN *toptxn = txn->toptxn ? txn->toptxn : txn;
+
+		if (ReorderBufferCanStream(rb, toptxn))
+			ReorderBufferStreamTXN(rb, toptxn);
+		else
+			ReorderBufferSerializeTXN(rb, txn);
 		Assert(txn->nentries_mem == 0);
 	}
 }
 
+/*
+ * Can the changes accumulated for a toplevel transaction be streamed to the
+ * output plugin right now?
+ */
+static bool
+ReorderBufferCanStream(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	LogicalDecodingContext *ctx = rb->private_data;
+	SnapBuild  *builder = ctx->snapshot_builder;
+	bool		has_snapshot = txn->base_snapshot != NULL;
+	dlist_iter	iter;
+
+	/* the output plugin doesn't support streaming */
+	if (rb->stream_change == NULL)
+		return false;
+
+	/*
+	 * Only stream changes the client is going to be interested in, i.e. ones
+	 * that would otherwise be replayed at commit.
+	 */
+	if (SnapBuildCurrentState(builder) != SNAPBUILD_CONSISTENT ||
+		SnapBuildXactNeedsSkip(builder, ctx->reader->ReadRecPtr))
+		return false;
+
+	/*
+	 * Catalog modifying transactions need the invalidations only known at
+	 * commit to be decoded correctly.
+	 */
+	if (txn->has_catalog_changes)
+		return false;
+
+	dlist_foreach(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, iter.cur);
+
+		if (subtxn->has_catalog_changes)
+			return false;
+		if (subtxn->base_snapshot != NULL)
+			has_snapshot = true;
+	}
+
+	return has_snapshot;
+}
+
+/*
+ * Stream the changes accumulated for a toplevel transaction and its known
+ * subtransactions as a block, and discard them afterwards.
+ */
+static void
+ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	dlist_iter	iter;
+
+	Assert(!txn->is_known_as_subxact);
+
+	/*
+	 * Decode all changes with the oldest base snapshot of the transaction, as
+	 * will be done after ReorderBufferCommitChild() if it doesn't end up
+	 * being streamed. Also remember which subtransactions have had changes
+	 * streamed, so the output plugin gets to know if they abort.
+	 */
+	dlist_foreach(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, iter.cur);
+
+		ReorderBufferTransferSnapToParent(txn, subtxn);
+		if (subtxn->nentries > 0)
+			subtxn->streamed = true;
+	}
+	txn->streamed = true;
+
+	elog(DEBUG2, "streaming changes of in-progress transaction %u", txn->xid);
+
+	ReorderBufferProcessTXN(rb, txn, InvalidXLogRecPtr);
+}
+
+/*
+ * Discard the changes of a transaction and its subtransactions after they
+ * have been streamed, keeping the transactions themselves around.
+ */
+static void
+ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	dlist_iter	subtxn_i;
+	dlist_mutable_iter change_i;
+
+	dlist_foreach(subtxn_i, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, subtxn_i.cur);
+		ReorderBufferTruncateTXN(rb, subtxn);
+	}
+
+	dlist_foreach_modify(change_i, &txn->changes)
+	{
+		ReorderBufferChange *change;
+
+		change = dlist_container(ReorderBufferChange, node, change_i.cur);
+		dlist_delete(&change->node);
+		ReorderBufferReturnChange(rb, change);
+	}
+	txn->nentries = 0;
+	txn->nentries_mem = 0;
+
+	if (txn->serialized)
+	{
+		ReorderBufferRestoreCleanup(rb, txn);
+		txn->serialized = false;
+	}
+}
+
 /*
  * Spill data of a large transaction (and its subtransactions) to disk.
  */
@@ -1908,6 +2226,7 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	int			fd = -1;
 	XLogSegNo	curOpenSegNo = 0;
 	Size		spilled = 0;
+	XLogRecPtr	last_lsn = InvalidXLogRecPtr;
 	char		path[MAXPGPATH];
 
 	elog(DEBUG2, "spill %u changes in tx %u to disk",
@@ -1933,12 +2252,15 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		 * store in segment in which it belongs by start lsn, don't split over
 		 * multiple segments tho
 		 */
-		if (fd == -1 || XLByteInSeg(change->lsn, curOpenSegNo))
+		if (fd == -1 || !XLByteInSeg(change->lsn, curOpenSegNo))
 		{
 			XLogRecPtr	recptr;
 
 			if (fd != -1)
+			{
+				ReorderBufferSerializeFlush(rb, txn, fd);
 				CloseTransientFile(fd);
+			}
 
 			XLByteToSeg(change->lsn, curOpenSegNo);
 			XLogSegNoOffsetToRecPtr(curOpenSegNo, 0, recptr);
@@ -1964,6 +2286,7 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		}
 
 		ReorderBufferSerializeChange(rb, txn, fd, change);
+		last_lsn = change->lsn;
 		dlist_delete(&change->node);
 		ReorderBufferReturnChange(rb, change);
 
@@ -1975,24 +2298,90 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	txn->nentries_mem = 0;
 
 	if (fd != -1)
+	{
+		ReorderBufferSerializeFlush(rb, txn, fd);
+		CloseTransientFile(fd);
+	}
+
+	/*
+	 * Remember that there's data on disk, and make sure final_lsn covers it
+	 * even while the transaction is still in progress, so it can be found
+	 * again by ReorderBufferRestoreChanges and ReorderBufferRestoreCleanup.
+	 */
+	if (spilled > 0)
+	{
+		txn->serialized = true;
+		if (txn->final_lsn < last_lsn)
+			txn->final_lsn = last_lsn;
+	}
+}
+
+/*
+ * Write out the changes buffered by ReorderBufferSerializeChange.
+ */
+static void
+ReorderBufferSerializeFlush(ReorderBuffer *rb, ReorderBufferTXN *txn, int fd)
+{
+	Size		len = rb->outbuf_used;
+
+	if (len == 0)
+		return;
+
+	rb->outbuf_used = 0;
+
+	if (write(fd, rb->outbuf, len) != len)
+	{
 		CloseTransientFile(fd);
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to xid %u's data file: %m",
+						txn->xid)));
+	}
 }
 
 /*
- * Serialize individual change to disk.
+ * Serialize a tuple of a change into data, returning the position after it.
+ */
+static char *
+ReorderBufferSerializeTuple(char *data, ReorderBufferTupleBuf *tup)
+{
+	ReorderBufferDiskTuple disktup;
+
+	/* be careful about padding, the file shouldn't contain garbage */
+	memset(&disktup, 0, sizeof(ReorderBufferDiskTuple));
+
+	if (tup != NULL)
+	{
+		disktup.t_len = tup->tuple.t_len;
+		disktup.t_self = tup->tuple.t_self;
+		disktup.t_tableOid = tup->tuple.t_tableOid;
+	}
+
+	memcpy(data, &disktup, sizeof(ReorderBufferDiskTuple));
+	data += sizeof(ReorderBufferDiskTuple);
+
+	if (tup != NULL)
+	{
+		memcpy(data, tup->tuple.t_data, tup->tuple.t_len);
+		data += tup->tuple.t_len;
+	}
+
+	return data;
+}
+
+/*
+ * Serialize individual change into the IO buffer, to be written to disk by
+ * ReorderBufferSerializeFlush.
  */
 static void
 ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 							 int fd, ReorderBufferChange *change)
 {
-	ReorderBufferDiskChange *ondisk;
+	ReorderBufferDiskChange ondisk;
 	Size		sz = sizeof(ReorderBufferDiskChange);
+	char	   *data;
 
-	ReorderBufferSerializeReserve(rb, sz);
-
-	ondisk = (ReorderBufferDiskChange *) rb->outbuf;
-	memcpy(&ondisk->change, change, sizeof(ReorderBufferChange));
-
+	/* compute the size of the on-disk representation */
 	switch (change->action)
 	{
 		case REORDER_BUFFER_CHANGE_INSERT:
@@ -2000,104 +2389,144 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 		case REORDER_BUFFER_CHANGE_UPDATE:
 			/* fall through */
 		case REORDER_BUFFER_CHANGE_DELETE:
-			{
-				char	   *data;
-				ReorderBufferTupleBuf *oldtup, *newtup;
-				Size		oldlen = 0;
-				Size		newlen = 0;
-
-				oldtup = change->data.tp.oldtuple;
-				newtup = change->data.tp.newtuple;
-
-				if (oldtup)
-					oldlen = offsetof(ReorderBufferTupleBuf, data)
-						+ oldtup->tuple.t_len
-						- offsetof(HeapTupleHeaderData, t_bits);
-
-				if (newtup)
-					newlen = offsetof(ReorderBufferTupleBuf, data)
-						+ newtup->tuple.t_len
-						- offsetof(HeapTupleHeaderData, t_bits);
-
-				sz += oldlen;
-				sz += newlen;
-
-				/* make sure we have enough space */
-				ReorderBufferSerializeReserve(rb, sz);
-
-				data = ((char *) rb->outbuf) + sizeof(ReorderBufferDiskChange);
-				/* might have been reallocated above */
-				ondisk = (ReorderBufferDiskChange *) rb->outbuf;
-
-				if (oldlen)
-				{
-					memcpy(data, oldtup, oldlen);
-					data += oldlen;
-				}
-
-				if (newlen)
-				{
-					memcpy(data, newtup, newlen);
-					data += newlen;
-				}
-				break;
-			}
+			sz += sizeof(RelFileNode) + 2 * sizeof(ReorderBufferDiskTuple);
+			if (change->data.tp.oldtuple)
+				sz += change->data.tp.oldtuple->tuple.t_len;
+			if (change->data.tp.newtuple)
+				sz += change->data.tp.newtuple->tuple.t_len;
+			break;
 		case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
-			{
-				Snapshot	snap;
-				char	   *data;
+			sz += sizeof(SnapshotData) +
+				sizeof(TransactionId) * change->data.snapshot->xcnt +
+				sizeof(TransactionId) * change->data.snapshot->subxcnt;
+			break;
+		case REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID:
+			sz += sizeof(CommandId);
+			break;
+		case REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID:
+			sz += sizeof(change->data.tuplecid);
+			break;
+	}
 
-				snap = change->data.snapshot;
+	/* write out what's buffered if this change doesn't fit anymore */
+	if (rb->outbuf_used + sz > max_spill_write_size)
+		ReorderBufferSerializeFlush(rb, txn, fd);
 
-				sz += sizeof(SnapshotData) +
-					sizeof(TransactionId) * snap->xcnt +
-					sizeof(TransactionId) * snap->subxcnt
-					;
+	/* make sure we have enough space */
+	ReorderBufferSerializeReserve(rb, Max(rb->outbuf_used + sz,
+										  max_spill_write_size));
 
-				/* make sure we have enough space */
-				ReorderBufferSerializeReserve(rb, sz);
-				data = ((char *) rb->outbuf) + sizeof(ReorderBufferDiskChange);
-				/* might have been reallocated above */
-				ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+	data = rb->outbuf + rb->outbuf_used;
+
+	ondisk.size = sz;
+	ondisk.action = change->action;
+	ondisk.lsn = change->lsn;
+	memcpy(data, &ondisk, sizeof(ReorderBufferDiskChange));
+	data += sizeof(ReorderBufferDiskChange);
+
+	switch (change->action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+			/* fall through */
+		case REORDER_BUFFER_CHANGE_UPDATE:
+			/* fall through */
+		case REORDER_BUFFER_CHANGE_DELETE:
+			memcpy(data, &change->data.tp.relnode, sizeof(RelFileNode));
+			data += sizeof(RelFileNode);
+			data = ReorderBufferSerializeTuple(data, change->data.tp.oldtuple);
+			data = ReorderBufferSerializeTuple(data, change->data.tp.newtuple);
+			break;
+		case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
+			{
+				Snapshot	snap = change->data.snapshot;
 
 				memcpy(data, snap, sizeof(SnapshotData));
 				data += sizeof(SnapshotData);
 
-				if (snap->xcnt)
-				{
-					memcpy(data, snap->xip,
-						   sizeof(TransactionId) + snap->xcnt);
-					data += sizeof(TransactionId) + snap->xcnt;
-				}
-
-				if (snap->subxcnt)
-				{
-					memcpy(data, snap->subxip,
-						   sizeof(TransactionId) + snap->subxcnt);
-					data += sizeof(TransactionId) + snap->subxcnt;
-				}
+				memcpy(data, snap->xip, sizeof(TransactionId) * snap->xcnt);
+				data += sizeof(TransactionId) * snap->xcnt;
+
+				memcpy(data, snap->subxip,
+					   sizeof(TransactionId) * snap->subxcnt);
+				data += sizeof(TransactionId) * snap->subxcnt;
 				break;
 			}
 		case REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID:
-			/* ReorderBufferChange contains everything important */
+			memcpy(data, &change->data.command_id, sizeof(CommandId));
+			data += sizeof(CommandId);
 			break;
 		case REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID:
-			/* ReorderBufferChange contains everything important */
+			memcpy(data, &change->data.tuplecid,
+				   sizeof(change->data.tuplecid));
+			data += sizeof(change->data.tuplecid);
 			break;
 	}
 
-	ondisk->size = sz;
+	Assert(data == rb->outbuf + rb->outbuf_used + sz);
+	rb->outbuf_used += sz;
+}
 
-	if (write(fd, rb->outbuf, ondisk->size) != ondisk->size)
+/*
+ * Make sure at least needed bytes of a spill file are available in the
+ * reader's read-ahead buffer, starting at reader->off.
+ *
+ * Returns false if the end of the file was reached with no data left over.
+ */
+static bool
+ReorderBufferSpillRead(ReorderBuffer *rb, ReorderBufferSpillReader *reader,
+					   Size needed)
+{
+	Size		avail = reader->len - reader->off;
+
+	while (avail < needed)
 	{
-		CloseTransientFile(fd);
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not write to xid %u's data file: %m",
-						txn->xid)));
+		Size		bufsize = Max(needed, max_spill_read_size);
+		int			readBytes;
+
+		/* move the leftover to the front of the buffer */
+		if (reader->off > 0)
+		{
+			memmove(reader->buf, reader->buf + reader->off, avail);
+			reader->off = 0;
+			reader->len = avail;
+		}
+
+		/* a single change may be larger than the usual buffer */
+		if (reader->buf == NULL)
+		{
+			reader->buf = MemoryContextAlloc(rb->context, bufsize);
+			reader->bufsize = bufsize;
+		}
+		else if (reader->bufsize < bufsize)
+		{
+			reader->buf = repalloc(reader->buf, bufsize);
+			reader->bufsize = bufsize;
+		}
+
+		readBytes = read(reader->fd, reader->buf + reader->len,
+						 reader->bufsize - reader->len);
+
+		if (readBytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from reorderbuffer spill file: %m")));
+		else if (readBytes == 0)
+		{
+			/* eof */
+			if (avail == 0)
+				return false;
+
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("incomplete read from reorderbuffer spill file: read %u instead of %u bytes",
+							(uint32) avail, (uint32) needed)));
+		}
+
+		reader->len += readBytes;
+		avail += readBytes;
 	}
 
-	Assert(ondisk->change.action == change->action);
+	return true;
 }
 
 /*
@@ -2105,7 +2534,7 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
  */
 static Size
 ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
-							int *fd, XLogSegNo *segno)
+							ReorderBufferSpillReader *reader)
 {
 	Size		restored = 0;
 	XLogSegNo	last_segno;
@@ -2128,24 +2557,23 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	XLByteToSeg(txn->final_lsn, last_segno);
 
-	while (restored < max_changes_in_memory && *segno <= last_segno)
+	while (restored < max_changes_in_memory && reader->segno <= last_segno)
 	{
-		int			readBytes;
-		ReorderBufferDiskChange *ondisk;
+		ReorderBufferDiskChange ondisk;
 
-		if (*fd == -1)
+		if (reader->fd == -1)
 		{
 			XLogRecPtr	recptr;
 			char		path[MAXPGPATH];
 
 			/* first time in */
-			if (*segno == 0)
+			if (reader->segno == 0)
 			{
-				XLByteToSeg(txn->first_lsn, *segno);
+				XLByteToSeg(txn->first_lsn, reader->segno);
 			}
 
-			Assert(*segno != 0 || dlist_is_empty(&txn->changes));
-			XLogSegNoOffsetToRecPtr(*segno, 0, recptr);
+			Assert(reader->segno != 0 || dlist_is_empty(&txn->changes));
+			XLogSegNoOffsetToRecPtr(reader->segno, 0, recptr);
 
 			/*
 			 * No need to care about TLIs here, only used during a single run,
@@ -2155,82 +2583,82 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 					NameStr(MyReplicationSlot->data.name), txn->xid,
 					(uint32) (recptr >> 32), (uint32) recptr);
 
-			*fd = OpenTransientFile(path, O_RDONLY | PG_BINARY, 0);
-			if (*fd < 0 && errno == ENOENT)
+			reader->fd = OpenTransientFile(path, O_RDONLY | PG_BINARY, 0);
+			if (reader->fd < 0 && errno == ENOENT)
 			{
-				*fd = -1;
-				(*segno)++;
+				reader->fd = -1;
+				reader->segno++;
 				continue;
 			}
-			else if (*fd < 0)
+			else if (reader->fd < 0)
 				ereport(ERROR,
 						(errcode_for_file_access(),
 						 errmsg("could not open file \"%s\": %m",
 								path)));
 
+			reader->off = 0;
+			reader->len = 0;
 		}
 
-		ReorderBufferSerializeReserve(rb, sizeof(ReorderBufferDiskChange));
-
-
 		/*
 		 * Read the statically sized part of a change which has information
 		 * about the total size. If we couldn't read a record, we're at the
 		 * end of this file.
 		 */
-
-		readBytes = read(*fd, rb->outbuf, sizeof(ReorderBufferDiskChange));
-
-		/* eof */
-		if (readBytes == 0)
+		if (!ReorderBufferSpillRead(rb, reader,
+									sizeof(ReorderBufferDiskChange)))
 		{
-			CloseTransientFile(*fd);
-			*fd = -1;
-			(*segno)++;
+			CloseTransientFile(reader->fd);
+			reader->fd = -1;
+			reader->segno++;
 			continue;
 		}
-		else if (readBytes < 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != sizeof(ReorderBufferDiskChange))
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("incomplete read from reorderbuffer spill file: read %d instead of %u",
-							readBytes,
-							(uint32) sizeof(ReorderBufferDiskChange))));
-
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
-
-		ReorderBufferSerializeReserve(rb,
-									  sizeof(ReorderBufferDiskChange) + ondisk->size);
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
 
-		readBytes = read(*fd, rb->outbuf + sizeof(ReorderBufferDiskChange),
-						 ondisk->size - sizeof(ReorderBufferDiskChange));
+		memcpy(&ondisk, reader->buf + reader->off,
+			   sizeof(ReorderBufferDiskChange));
 
-		if (readBytes < 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != ondisk->size - sizeof(ReorderBufferDiskChange))
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u",
-							readBytes,
-							(uint32) (ondisk->size - sizeof(ReorderBufferDiskChange)))));
+		/* and the rest of it, which can't be at the end of the file */
+		ReorderBufferSpillRead(rb, reader, ondisk.size);
 
 		/*
 		 * ok, read a full change from disk, now restore it into proper
 		 * in-memory format
 		 */
-		ReorderBufferRestoreChange(rb, txn, rb->outbuf);
+		ReorderBufferRestoreChange(rb, txn, reader->buf + reader->off);
+		reader->off += ondisk.size;
 		restored++;
 	}
 
 	return restored;
 }
 
+/*
+ * Restore a tuple serialized by ReorderBufferSerializeTuple, advancing *data
+ * past it.
+ */
+static ReorderBufferTupleBuf *
+ReorderBufferRestoreTuple(ReorderBuffer *rb, char **data)
+{
+	ReorderBufferDiskTuple disktup;
+	ReorderBufferTupleBuf *tup;
+
+	memcpy(&disktup, *data, sizeof(ReorderBufferDiskTuple));
+	*data += sizeof(ReorderBufferDiskTuple);
+
+	if (disktup.t_len == 0)
+		return NULL;
+
+	tup = ReorderBufferGetTupleBuf(rb);
+	tup->tuple.t_len = disktup.t_len;
+	tup->tuple.t_self = disktup.t_self;
+	tup->tuple.t_tableOid = disktup.t_tableOid;
+	tup->tuple.t_data = &tup->header;
+	memcpy(tup->tuple.t_data, *data, disktup.t_len);
+	*data += disktup.t_len;
+
+	return tup;
+}
+
 /*
  * Convert change from its on-disk format to in-memory format and queue it onto
  * the TXN's ->changes list.
@@ -2239,17 +2667,15 @@ static void
 ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 						   char *data)
 {
-	ReorderBufferDiskChange *ondisk;
+	ReorderBufferDiskChange ondisk;
 	ReorderBufferChange *change;
 
-	ondisk = (ReorderBufferDiskChange *) data;
+	memcpy(&ondisk, data, sizeof(ReorderBufferDiskChange));
+	data += sizeof(ReorderBufferDiskChange);
 
 	change = ReorderBufferGetChange(rb);
-
-	/* copy static part */
-	memcpy(change, &ondisk->change, sizeof(ReorderBufferChange));
-
-	data += sizeof(ReorderBufferDiskChange);
+	change->action = (enum ReorderBufferChangeType) ondisk.action;
+	change->lsn = ondisk.lsn;
 
 	/* restore individual stuff */
 	switch (change->action)
@@ -2259,43 +2685,22 @@ ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 		case REORDER_BUFFER_CHANGE_UPDATE:
 			/* fall through */
 		case REORDER_BUFFER_CHANGE_DELETE:
-			if (change->data.tp.newtuple)
-			{
-				Size		len = offsetof(ReorderBufferTupleBuf, data)
-				+((ReorderBufferTupleBuf *) data)->tuple.t_len
-				- offsetof(HeapTupleHeaderData, t_bits);
-
-				change->data.tp.newtuple = ReorderBufferGetTupleBuf(rb);
-				memcpy(change->data.tp.newtuple, data, len);
-				change->data.tp.newtuple->tuple.t_data =
-					&change->data.tp.newtuple->header;
-				data += len;
-			}
-
-			if (change->data.tp.oldtuple)
-			{
-				Size		len = offsetof(ReorderBufferTupleBuf, data)
-				+((ReorderBufferTupleBuf *) data)->tuple.t_len
-				- offsetof(HeapTupleHeaderData, t_bits);
-
-				change->data.tp.oldtuple = ReorderBufferGetTupleBuf(rb);
-				memcpy(change->data.tp.oldtuple, data, len);
-				change->data.tp.oldtuple->tuple.t_data =
-					&change->data.tp.oldtuple->header;
-				data += len;
-			}
+			memcpy(&change->data.tp.relnode, data, sizeof(RelFileNode));
+			data += sizeof(RelFileNode);
+			change->data.tp.oldtuple = ReorderBufferRestoreTuple(rb, &data);
+			change->data.tp.newtuple = ReorderBufferRestoreTuple(rb, &data);
 			break;
 		case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
 			{
-				Snapshot	oldsnap;
+				SnapshotData oldsnap;
 				Snapshot	newsnap;
 				Size		size;
 
-				oldsnap = (Snapshot) data;
+				memcpy(&oldsnap, data, sizeof(SnapshotData));
 
 				size = sizeof(SnapshotData) +
-					sizeof(TransactionId) * oldsnap->xcnt +
-					sizeof(TransactionId) * (oldsnap->subxcnt + 0);
+					sizeof(TransactionId) * oldsnap.xcnt +
+					sizeof(TransactionId) * oldsnap.subxcnt;
 
 				change->data.snapshot = MemoryContextAllocZero(rb->context, size);
 
@@ -2308,9 +2713,12 @@ ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 				newsnap->copied = true;
 				break;
 			}
-			/* the base struct contains all the data, easy peasy */
 		case REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID:
+			memcpy(&change->data.command_id, data, sizeof(CommandId));
+			break;
 		case REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID:
+			memcpy(&change->data.tuplecid, data,
+				   sizeof(change->data.tuplecid));
 			break;
 	}
 
@@ -87,7 +87,11 @@
  * snapshot means that all transactions that start henceforth can be decoded
  * in their entirety, but transactions that started previously can't. In
  * FULL_SNAPSHOT we'll switch into CONSISTENT once all those previously
- * running transactions have committed or aborted.
+ * running transactions have committed or aborted. As a backend that crashed
+ * doesn't get to log an abort record, we also switch as soon as a later
+ * running_xacts record shows that none of them is running anymore; to get
+ * such a record quickly, we log one ourselves after having waited for the
+ * initially running transactions to finish.
  *
  * Only transactions that commit after CONSISTENT state has been reached will
  * be replayed, even though they might have started while still in
@@ -118,6 +122,7 @@
 
 #include "replication/logical.h"
 #include "replication/reorderbuffer.h"
+#include "replication/slot.h"
 #include "replication/snapbuild.h"
 
 #include "utils/builtins.h"
@@ -264,6 +269,8 @@ static void SnapBuildSnapIncRefcount(Snapshot snap);
 
 static void SnapBuildDistributeNewCatalogSnapshot(SnapBuild *builder, XLogRecPtr lsn);
 
+static void SnapBuildReportProgress(SnapBuild *builder);
+
 /* xlog reading helper functions for SnapBuildProcessRecord */
 static bool SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *running);
 
@@ -314,6 +321,8 @@ AllocateSnapshotBuilder(ReorderBuffer *reorder,
 
 	MemoryContextSwitchTo(oldcontext);
 
+	SnapBuildReportProgress(builder);
+
 	return builder;
 }
 
@@ -334,6 +343,16 @@ FreeSnapshotBuilder(SnapBuild *builder)
 
 	/* other resources are deallocated via memory context reset */
 	MemoryContextDelete(context);
+
+	/* nothing to report about anymore */
+	if (MyReplicationSlot != NULL)
+	{
+		volatile ReplicationSlot *slot = MyReplicationSlot;
+
+		SpinLockAcquire(&slot->mutex);
+		slot->snapbuild_valid = false;
+		SpinLockRelease(&slot->mutex);
+	}
 }
 
 /*
@@ -370,6 +389,28 @@ SnapBuildCurrentState(SnapBuild *builder)
 	return builder->state;
 }
 
+/*
+ * Publish how far along building a snapshot we are in the replication slot
+ * we're decoding for, so it can be monitored via pg_replication_slots.
+ */
+static void
+SnapBuildReportProgress(SnapBuild *builder)
+{
+	volatile ReplicationSlot *slot = MyReplicationSlot;
+
+	if (slot == NULL)
+		return;
+
+	SpinLockAcquire(&slot->mutex);
+	slot->snapbuild_valid = true;
+	slot->snapbuild_state = builder->state;
+	if (builder->state == SNAPBUILD_FULL_SNAPSHOT)
+		slot->snapbuild_pending = builder->running.xcnt;
+	else
+		slot->snapbuild_pending = 0;
+	SpinLockRelease(&slot->mutex);
+}
+
 /*
  * Should the contents of transaction ending at 'ptr' be decoded?
  */
@@ -906,6 +947,8 @@ SnapBuildEndTxn(SnapBuild *builder, XLogRecPtr lsn, TransactionId xid)
 							   xid)));
 			builder->state = SNAPBUILD_CONSISTENT;
 		}
+
+		SnapBuildReportProgress(builder);
 	}
 }
 
@@ -1200,7 +1243,7 @@ SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *runn
 	 *
 	 * a) There were no running transactions when the xl_running_xacts record
 	 *    was inserted, jump to CONSISTENT immediately. We might find such a
-	 *    state we were waiting for b) and c).
+	 *    state we were waiting for b) to d).
 	 *
 	 * b) Wait for all toplevel transactions that were running to end. We
 	 *    simply track the number of in-progress toplevel transactions and
@@ -1214,8 +1257,14 @@ SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *runn
 	 *	  subtransactions - and by extension suboverflowed xl_running_xacts -
 	 *	  at all.
 	 *
-	 * c) This (in a previous run) or another decoding slot serialized a
-	 *    snapshot to disk that we can use.
+	 * c) While waiting as in b), a later xl_running_xacts record shows that
+	 *    none of the initially running transactions is running anymore,
+	 *    even if we didn't see all of them end. Go to CONSISTENT.
+	 *
+	 * d) This (in a previous run) or another decoding slot serialized a
+	 *    snapshot to disk that we can use. A new slot that doesn't need to
+	 *    export a snapshot can also start out from another slot's snapshot
+	 *    before reading any WAL, see SnapBuildRestoreFromSlot().
 	 * ---
 	 */
 
@@ -1260,6 +1309,7 @@ SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *runn
 		builder->running.xmax = InvalidTransactionId;
 
 		builder->state = SNAPBUILD_CONSISTENT;
+		SnapBuildReportProgress(builder);
 
 		ereport(LOG,
 				(errmsg("logical decoding found consistent point at %X/%X",
@@ -1268,7 +1318,38 @@ SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *runn
 
 		return false;
 	}
-	/* c) valid on disk state */
+	/*
+	 * c) All transactions that were running when we reached FULL_SNAPSHOT
+	 * have finished, even though we might not have seen all of them end: a
+	 * transaction whose backend crashed never logs an abort record. As xids
+	 * are assigned in ascending order, none of them can be running anymore
+	 * once the oldest running xid is past the newest of them.
+	 */
+	else if (builder->state == SNAPBUILD_FULL_SNAPSHOT &&
+			 !NormalTransactionIdPrecedes(running->oldestRunningXid,
+										  builder->running.xmax))
+	{
+		if (builder->transactions_after == InvalidXLogRecPtr ||
+			builder->transactions_after < lsn)
+			builder->transactions_after = lsn;
+
+		builder->running.xcnt = 0;
+		builder->state = SNAPBUILD_CONSISTENT;
+		SnapBuildReportProgress(builder);
+
+		ereport(LOG,
+				(errmsg("logical decoding found consistent point at %X/%X",
+						(uint32)(lsn >> 32), (uint32)lsn),
+				 errdetail("oldest running xid %u is newer than all initially running xacts",
+						   running->oldestRunningXid)));
+
+		/*
+		 * There might be committed transactions to purge, and the slot's
+		 * xmin to advance.
+		 */
+		return true;
+	}
+	/* d) valid on disk state */
 	else if (SnapBuildRestore(builder, lsn))
 	{
 		/* there won't be any state to cleanup */
@@ -1318,6 +1399,7 @@ SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *runn
 		TransactionIdAdvance(builder->running.xmax);
 
 		builder->state = SNAPBUILD_FULL_SNAPSHOT;
+		SnapBuildReportProgress(builder);
 
 		ereport(LOG,
 				(errmsg("logical decoding found initial starting point at %X/%X",
@@ -1346,6 +1428,15 @@ SnapBuildFindSnapshot(SnapBuild *builder, XLogRecPtr lsn, xl_running_xacts *runn
 			XactLockTableWait(xid, NULL, NULL, XLTW_None);
 		}
 
+		/*
+		 * All of them have finished now, but we'll only notice once we've
+		 * decoded their commit or abort records, and some of them might not
+		 * have logged one. Log a new xl_running_xacts record, so we can
+		 * become consistent when we reach it instead of having to wait for
+		 * the next one logged by the bgwriter or a checkpoint.
+		 */
+		LogStandbySnapshot();
+
 		/* nothing could have built up so far, so don't perform cleanup */
 		return false;
 	}
@@ -1378,7 +1469,7 @@ typedef struct SnapBuildOnDisk
 
 	/* data not covered by checksum */
 	uint32		magic;
-	pg_crc32	checksum;
+	pg_crc32c	checksum;
 
 	/* data covered by checksum */
 
@@ -1515,8 +1606,8 @@ SnapBuildSerialize(SnapBuild *builder, XLogRecPtr lsn)
 	ondisk->magic = SNAPBUILD_MAGIC;
 	ondisk->version = SNAPBUILD_VERSION;
 	ondisk->length = needed_length;
-	INIT_CRC32(ondisk->checksum);
-	COMP_CRC32(ondisk->checksum,
+	INIT_CRC32C(ondisk->checksum);
+	COMP_CRC32C(ondisk->checksum,
 			   ((char *) ondisk) + SnapBuildOnDiskNotChecksummedSize,
 			   SnapBuildOnDiskConstantSize - SnapBuildOnDiskNotChecksummedSize);
 	ondisk_c += sizeof(SnapBuildOnDisk);
@@ -1529,20 +1620,20 @@ SnapBuildSerialize(SnapBuild *builder, XLogRecPtr lsn)
 	ondisk->builder.running.xip = NULL;
 	ondisk->builder.committed.xip = NULL;
 
-	COMP_CRC32(ondisk->checksum,
+	COMP_CRC32C(ondisk->checksum,
 			   &ondisk->builder,
 			   sizeof(SnapBuild));
 
 	/* copy running xacts */
 	sz = sizeof(TransactionId) * builder->running.xcnt_space;
 	memcpy(ondisk_c, builder->running.xip, sz);
-	COMP_CRC32(ondisk->checksum, ondisk_c, sz);
+	COMP_CRC32C(ondisk->checksum, ondisk_c, sz);
 	ondisk_c += sz;
 
 	/* copy committed xacts */
 	sz = sizeof(TransactionId) * builder->committed.xcnt;
 	memcpy(ondisk_c, builder->committed.xip, sz);
-	COMP_CRC32(ondisk->checksum, ondisk_c, sz);
+	COMP_CRC32C(ondisk->checksum, ondisk_c, sz);
 	ondisk_c += sz;
 
 	/* we have valid data now, open tempfile and write it there */
@@ -1619,7 +1710,7 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 	char		path[MAXPGPATH];
 	Size		sz;
 	int			readBytes;
-	pg_crc32	checksum;
+	pg_crc32c	checksum;
 
 	/* no point in loading a snapshot if we're already there */
 	if (builder->state == SNAPBUILD_CONSISTENT)
@@ -1670,8 +1761,8 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 				(errmsg("snapbuild state file \"%s\" has unsupported version %u instead of %u",
 						path, ondisk.version, SNAPBUILD_VERSION)));
 
-	INIT_CRC32(checksum);
-	COMP_CRC32(checksum,
+	INIT_CRC32C(checksum);
+	COMP_CRC32C(checksum,
 			   ((char *) &ondisk) + SnapBuildOnDiskNotChecksummedSize,
 			   SnapBuildOnDiskConstantSize - SnapBuildOnDiskNotChecksummedSize);
 
@@ -1685,7 +1776,7 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 				 errmsg("could not read file \"%s\", read %d of %d: %m",
 						path, readBytes, (int) sizeof(SnapBuild))));
 	}
-	COMP_CRC32(checksum, &ondisk.builder, sizeof(SnapBuild));
+	COMP_CRC32C(checksum, &ondisk.builder, sizeof(SnapBuild));
 
 	/* restore running xacts information */
 	sz = sizeof(TransactionId) * ondisk.builder.running.xcnt_space;
@@ -1699,7 +1790,7 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 				 errmsg("could not read file \"%s\", read %d of %d: %m",
 						path, readBytes, (int) sz)));
 	}
-	COMP_CRC32(checksum, ondisk.builder.running.xip, sz);
+	COMP_CRC32C(checksum, ondisk.builder.running.xip, sz);
 
 	/* restore committed xacts information */
 	sz = sizeof(TransactionId) * ondisk.builder.committed.xcnt;
@@ -1713,12 +1804,12 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 				 errmsg("could not read file \"%s\", read %d of %d: %m",
 						path, readBytes, (int) sz)));
 	}
-	COMP_CRC32(checksum, ondisk.builder.committed.xip, sz);
+	COMP_CRC32C(checksum, ondisk.builder.committed.xip, sz);
 
 	CloseTransientFile(fd);
 
 	/* verify checksum of what we've read */
-	if (!EQ_CRC32(checksum, ondisk.checksum))
+	if (!EQ_CRC32C(checksum, ondisk.checksum))
 		ereport(ERROR,
 				(errcode_for_file_access(),
 				 errmsg("snapbuild state file %s: checksum mismatch, is %u, should be %u",
@@ -1761,10 +1852,10 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 	}
 	ondisk.builder.committed.xip = NULL;
 
-	builder->running.xcnt = ondisk.builder.committed.xcnt;
+	builder->running.xcnt = ondisk.builder.running.xcnt;
 	if (builder->running.xip)
 		pfree(builder->running.xip);
-	builder->running.xcnt_space = ondisk.builder.committed.xcnt_space;
+	builder->running.xcnt_space = ondisk.builder.running.xcnt_space;
 	builder->running.xip = ondisk.builder.running.xip;
 
 	/* our snapshot is not interesting anymore, build a new one */
@@ -1778,6 +1869,7 @@ SnapBuildRestore(SnapBuild *builder, XLogRecPtr lsn)
 	ReorderBufferSetRestartPoint(builder->reorder, lsn);
 
 	Assert(builder->state == SNAPBUILD_CONSISTENT);
+	SnapBuildReportProgress(builder);
 
 	ereport(LOG,
 			(errmsg("logical decoding found consistent point at %X/%X",
@@ -1793,6 +1885,44 @@ snapshot_not_interesting:
 	return false;
 }
 
+/*
+ * Start building the initial snapshot of a new slot from the snapshot another
+ * slot serialized at 'lsn', where that slot can restart decoding from.
+ * Commits up to 'confirmed_flush', the other slot's confirmed position, are
+ * not decoded, as the transactions running at 'lsn' may have changes before
+ * it. Returns false, leaving the builder alone, if there's no consistent
+ * snapshot at 'lsn'.
+ */
+bool
+SnapBuildRestoreFromSlot(SnapBuild *builder, XLogRecPtr lsn,
+						 XLogRecPtr confirmed_flush)
+{
+	TransactionId initial_xmin_horizon = builder->initial_xmin_horizon;
+
+	Assert(builder->state == SNAPBUILD_START);
+
+	/*
+	 * The caller took over the other slot's catalog_xmin, which protects the
+	 * catalog rows needed from here on just as when that slot restarts, and
+	 * a restarting slot doesn't check the snapshot's xmin either.
+	 */
+	builder->initial_xmin_horizon = InvalidTransactionId;
+
+	if (!SnapBuildRestore(builder, lsn))
+	{
+		builder->initial_xmin_horizon = initial_xmin_horizon;
+		return false;
+	}
+
+	if (builder->transactions_after < confirmed_flush)
+		builder->transactions_after = confirmed_flush;
+
+	/* the other slot only kept track of catalog modifying transactions */
+	builder->committed.includes_all_transactions = false;
+
+	return true;
+}
+
 /*
  * Remove all serialized snapshots that are not required anymore because no
  * slot can need them. This doesn't actually have to run during a checkpoint,
@@ -55,7 +55,7 @@ typedef struct ReplicationSlotOnDisk
 
 	/* data not covered by checksum */
 	uint32		magic;
-	pg_crc32	checksum;
+	pg_crc32c	checksum;
 
 	/* data covered by checksum */
 	uint32		version;
@@ -257,6 +257,8 @@ ReplicationSlotCreate(const char *name, bool db_specific,
 	NameStr(slot->data.name)[NAMEDATALEN - 1] = '\0';
 	slot->data.database = db_specific ? MyDatabaseId : InvalidOid;
 	slot->data.restart_lsn = InvalidXLogRecPtr;
+	slot->data.confirmed_flush = InvalidXLogRecPtr;
+	slot->snapbuild_valid = false;
 
 	/*
 	 * Create the slot on disk.  We haven't actually marked the slot allocated
@@ -368,6 +370,7 @@ ReplicationSlotRelease(void)
 		volatile ReplicationSlot *vslot = slot;
 		SpinLockAcquire(&slot->mutex);
 		vslot->active = false;
+		vslot->snapbuild_valid = false;
 		SpinLockRelease(&slot->mutex);
 	}
 
@@ -992,7 +995,7 @@ SaveSlotToPath(ReplicationSlot *slot, const char *dir, int elevel)
 	}
 
 	cp.magic = SLOT_MAGIC;
-	INIT_CRC32(cp.checksum);
+	INIT_CRC32C(cp.checksum);
 	cp.version = 1;
 	cp.length = ReplicationSlotOnDiskDynamicSize;
 
@@ -1002,7 +1005,7 @@ SaveSlotToPath(ReplicationSlot *slot, const char *dir, int elevel)
 
 	SpinLockRelease(&slot->mutex);
 
-	COMP_CRC32(cp.checksum,
+	COMP_CRC32C(cp.checksum,
 			   (char *)(&cp) + ReplicationSlotOnDiskConstantSize,
 			   ReplicationSlotOnDiskDynamicSize);
 
@@ -1080,7 +1083,7 @@ RestoreSlotFromDisk(const char *name)
 	int			fd;
 	bool		restored = false;
 	int			readBytes;
-	pg_crc32	checksum;
+	pg_crc32c	checksum;
 
 	/* no need to lock here, no concurrent access allowed yet */
 
@@ -1179,12 +1182,12 @@ RestoreSlotFromDisk(const char *name)
 	CloseTransientFile(fd);
 
 	/* now verify the CRC32 */
-	INIT_CRC32(checksum);
-	COMP_CRC32(checksum,
+	INIT_CRC32C(checksum);
+	COMP_CRC32C(checksum,
 			   (char *)&cp + ReplicationSlotOnDiskConstantSize,
 			   ReplicationSlotOnDiskDynamicSize);
 
-	if (!EQ_CRC32(checksum, cp.checksum))
+	if (!EQ_CRC32C(checksum, cp.checksum))
 		ereport(PANIC,
 				(errmsg("replication slot file %s: checksum mismatch, is %u, should be %u",
 						path, checksum, cp.checksum)));
@@ -1215,6 +1218,7 @@ RestoreSlotFromDisk(const char *name)
 		slot->candidate_xmin_lsn = InvalidXLogRecPtr;
 		slot->candidate_restart_lsn = InvalidXLogRecPtr;
 		slot->candidate_restart_valid = InvalidXLogRecPtr;
+		slot->snapbuild_valid = false;
 
 		slot->in_use = true;
 		slot->active = false;
@@ -106,7 +106,7 @@ pg_create_logical_replication_slot(PG_FUNCTION_ARGS)
 	 * Create logical decoding context, to build the initial snapshot.
 	 */
 	ctx = CreateInitDecodingContext(
-		NameStr(*plugin), NIL,
+		NameStr(*plugin), NIL, false,
 		logical_read_local_xlog_page, NULL, NULL);
 
 	/* build initial snapshot, might take a while */
@@ -154,7 +154,7 @@ pg_drop_replication_slot(PG_FUNCTION_ARGS)
 Datum
 pg_get_replication_slots(PG_FUNCTION_ARGS)
 {
-#define PG_GET_REPLICATION_SLOTS_COLS 8
+#define PG_GET_REPLICATION_SLOTS_COLS 10
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	TupleDesc	tupdesc;
 	Tuplestorestate *tupstore;
@@ -203,6 +203,9 @@ pg_get_replication_slots(PG_FUNCTION_ARGS)
 		TransactionId catalog_xmin;
 		XLogRecPtr	restart_lsn;
 		bool		active;
+		bool		snapbuild_valid;
+		SnapBuildState snapbuild_state;
+		uint32		snapbuild_pending;
 		Oid			database;
 		NameData	slot_name;
 		NameData	plugin;
@@ -224,6 +227,10 @@ pg_get_replication_slots(PG_FUNCTION_ARGS)
 			namecpy(&plugin, &slot->data.plugin);
 
 			active = slot->active;
+
+			snapbuild_valid = slot->snapbuild_valid;
+			snapbuild_state = slot->snapbuild_state;
+			snapbuild_pending = slot->snapbuild_pending;
 		}
 		SpinLockRelease(&slot->mutex);
 
@@ -264,6 +271,38 @@ pg_get_replication_slots(PG_FUNCTION_ARGS)
 		else
 			nulls[i++] = true;
 
+		if (!snapbuild_valid)
+		{
+			nulls[i++] = true;
+			nulls[i++] = true;
+		}
+		else
+		{
+			const char *state = NULL;
+
+			switch (snapbuild_state)
+			{
+				case SNAPBUILD_START:
+					state = "start";
+					break;
+				case SNAPBUILD_FULL_SNAPSHOT:
+					state = "full snapshot";
+					break;
+				case SNAPBUILD_CONSISTENT:
+					state = "consistent";
+					break;
+			}
+			Assert(state != NULL);
+
+			values[i++] = CStringGetTextDatum(state);
+
+			/* we don't know how many transactions to wait for yet */
+			if (snapbuild_state == SNAPBUILD_START)
+				nulls[i++] = true;
+			else
+				values[i++] = Int32GetDatum((int32) snapbuild_pending);
+		}
+
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 	}
 
@@ -792,7 +792,7 @@ CreateReplicationSlot(CreateReplicationSlotCmd *cmd)
 		LogicalDecodingContext *ctx;
 
 		ctx = CreateInitDecodingContext(
-			cmd->plugin, NIL,
+			cmd->plugin, NIL, true,
 			logical_read_xlog_page,
 			WalSndPrepareWrite, WalSndWriteData);
 
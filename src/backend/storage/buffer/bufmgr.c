@@ -37,6 +37,7 @@
 #include "catalog/storage.h"
 #include "common/relpath.h"
 #include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
@@ -66,11 +67,42 @@
 
 #define DROP_RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * Progress of a checkpoint's writes to one tablespace; see BufferSync.
+ */
+typedef struct CkptTsStatus
+{
+	Oid			tsId;			/* tablespace oid */
+
+	/*
+	 * Each write to this tablespace advances progress by progress_slice, so
+	 * that all tablespaces reach the same total at the end.  The tablespace
+	 * with the least progress is written to next.
+	 */
+	float8		progress;
+	float8		progress_slice;
+
+	int			num_to_scan;	/* number of buffers to process */
+	int			num_scanned;	/* number already processed */
+	int			index;			/* current offset in CkptBufferIds */
+} CkptTsStatus;
+
+/*
+ * Writes a checkpoint has issued, but not yet asked the kernel to write
+ * back; see ScheduleBufferTagForWriteback.
+ */
+typedef struct WritebackContext
+{
+	int			nr_pending;
+	BufferTag	pending[WRITEBACK_MAX_PENDING_FLUSHES];
+} WritebackContext;
+
 /* GUC variables */
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
 bool		track_io_timing = false;
+int			checkpoint_flush_after = DEFAULT_CHECKPOINT_FLUSH_AFTER;
 
 /*
  * How many buffers PrefetchBuffer callers should try to stay ahead of their
@@ -95,7 +127,11 @@ static bool PinBuffer(volatile BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(volatile BufferDesc *buf);
 static void UnpinBuffer(volatile BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
-static int	SyncOneBuffer(int buf_id, bool skip_recently_used);
+static int SyncOneBuffer(int buf_id, bool skip_recently_used,
+			  WritebackContext *wb_context);
+static void ScheduleBufferTagForWriteback(WritebackContext *context,
+							  BufferTag *tag);
+static void IssuePendingWritebacks(WritebackContext *context);
 static void WaitIO(volatile BufferDesc *buf);
 static bool StartBufferIO(volatile BufferDesc *buf, bool forInput);
 static void TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
@@ -111,6 +147,9 @@ static volatile BufferDesc *BufferAlloc(SMgrRelation smgr,
 static void FlushBuffer(volatile BufferDesc *buf, SMgrRelation reln);
 static void AtProcExit_Buffers(int code, Datum arg);
 static int	rnode_comparator(const void *p1, const void *p2);
+static int	ckpt_buforder_comparator(const void *pa, const void *pb);
+static int	ts_ckpt_progress_comparator(Datum a, Datum b, void *arg);
+static int	buffertag_comparator(const void *pa, const void *pb);
 
 
 /*
@@ -143,42 +182,66 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 		LocalPrefetchBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 	else
-	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLock	   *newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
+		PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
+#endif   /* USE_PREFETCH */
+}
+
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a block of a
+ *		shared (non-temporary) relation, identified at the smgr level
+ *
+ * This is the guts of PrefetchBuffer, exposed separately for the benefit of
+ * recovery, which has no relcache entries to work with.  Returns true if a
+ * prefetch was issued, false if the block was found in shared buffers (or
+ * prefetching isn't supported).  The caller must be sure that the block
+ * exists on disk.
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	LWLock	   *newPartitionLock;	/* buffer partition lock for it */
+	int			buf_id;
 
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
+	Assert(BlockNumberIsValid(blockNum));
 
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node,
+				   forkNum, blockNum);
 
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
+	/* determine its hash code and partition lock ID */
+	newHash = BufTableHashCode(&newTag);
+	newPartitionLock = BufMappingPartitionLock(newHash);
 
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
+	/* see if the block is in the buffer pool already */
+	LWLockAcquire(newPartitionLock, LW_SHARED);
+	buf_id = BufTableLookup(&newTag, newHash);
+	LWLockRelease(newPartitionLock);
 
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		pgBufferUsage.shared_blks_prefetch_issued++;
+		return true;
 	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really ideal:
+	 * the block might be just about to be evicted, which would be stupid
+	 * since we know we are going to need it soon.  But the only easy answer
+	 * is to bump the usage_count, which does not seem like a great solution:
+	 * when the caller does ultimately touch the block, usage_count would get
+	 * bumped again, resulting in too much favoritism for blocks that are
+	 * involved in a prefetch sequence. A real fix would involve some
+	 * additional per-buffer state, and it's not clear that there's enough of
+	 * a problem to justify that.
+	 */
 #endif   /* USE_PREFETCH */
+	return false;
 }
 
 
@@ -605,15 +668,11 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
 	{
-		bool		lock_held;
-
 		/*
 		 * Select a victim buffer.	The buffer is returned with its header
-		 * spinlock still held!  Also (in most cases) the BufFreelistLock is
-		 * still held, since it would be bad to hold the spinlock while
-		 * possibly waking up other processes.
+		 * spinlock still held!
 		 */
-		buf = StrategyGetBuffer(strategy, &lock_held);
+		buf = StrategyGetBuffer(strategy);
 
 		Assert(buf->refcount == 0);
 
@@ -623,10 +682,6 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		/* Pin the buffer and then release the buffer spinlock */
 		PinBuffer_Locked(buf);
 
-		/* Now it's safe to release the freelist lock */
-		if (lock_held)
-			LWLockRelease(BufFreelistLock);
-
 		/*
 		 * If the buffer was dirty, try to write it out.  There is a race
 		 * condition here, in that someone might dirty it after we released it
@@ -1208,15 +1263,29 @@ UnpinBuffer(volatile BufferDesc *buf, bool fixOwner)
  * is set, we disable delays between writes; if CHECKPOINT_IS_SHUTDOWN is
  * set, we write even unlogged buffers, which are otherwise skipped.  The
  * remaining flags currently have no effect here.
+ *
+ * The buffers are written in file and block order, so that the kernel sees
+ * mostly sequential writes to each file, and interleaved between tablespaces
+ * in proportion to the number of buffers each has to write, so that all
+ * the disks are kept busy throughout the checkpoint.  Every
+ * checkpoint_flush_after writes, we ask the kernel to start writing back
+ * what we wrote, so that the fsyncs at the end of the checkpoint don't
+ * find a mountain of dirty data to flush at once.
  */
 static void
 BufferSync(int flags)
 {
 	int			buf_id;
 	int			num_to_scan;
-	int			num_to_write;
+	int			num_spaces;
+	int			num_processed;
 	int			num_written;
+	CkptTsStatus *per_ts_stat = NULL;
+	Oid			last_tsid;
+	binaryheap *ts_heap;
+	int			i;
 	int			mask = BM_DIRTY;
+	WritebackContext wb_context;
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
@@ -1231,8 +1300,9 @@ BufferSync(int flags)
 
 	/*
 	 * Loop over all buffers, and mark the ones that need to be written with
-	 * BM_CHECKPOINT_NEEDED.  Count them as we go (num_to_write), so that we
-	 * can estimate how much work needs to be done.
+	 * BM_CHECKPOINT_NEEDED.  Count them as we go (num_to_scan), so that we
+	 * can estimate how much work needs to be done, and remember where they
+	 * belong in CkptBufferIds, so that we can sort them.
 	 *
 	 * This allows us to write only those pages that were dirty when the
 	 * checkpoint began, and not those that get dirtied while it proceeds.
@@ -1242,10 +1312,10 @@ BufferSync(int flags)
 	 * have the flag set.
 	 *
 	 * Note that if we fail to write some buffer, we may leave buffers with
-	 * BM_CHECKPOINT_NEEDED still set.	This is OK since any such buffer would
+	 * BM_CHECKPOINT_NEEDED still set.  This is OK since any such buffer would
 	 * certainly need to be written for the next checkpoint attempt, too.
 	 */
-	num_to_write = 0;
+	num_to_scan = 0;
 	for (buf_id = 0; buf_id < NBuffers; buf_id++)
 	{
 		volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
@@ -1258,32 +1328,107 @@ BufferSync(int flags)
 
 		if ((bufHdr->flags & mask) == mask)
 		{
+			CkptSortItem *item;
+
 			bufHdr->flags |= BM_CHECKPOINT_NEEDED;
-			num_to_write++;
+
+			item = &CkptBufferIds[num_to_scan++];
+			item->buf_id = buf_id;
+			item->tsId = bufHdr->tag.rnode.spcNode;
+			item->relNode = bufHdr->tag.rnode.relNode;
+			item->forkNum = bufHdr->tag.forkNum;
+			item->blockNum = bufHdr->tag.blockNum;
 		}
 
 		UnlockBufHdr(bufHdr);
 	}
 
-	if (num_to_write == 0)
+	if (num_to_scan == 0)
 		return;					/* nothing to do */
 
-	TRACE_POSTGRESQL_BUFFER_SYNC_START(NBuffers, num_to_write);
+	TRACE_POSTGRESQL_BUFFER_SYNC_START(NBuffers, num_to_scan);
 
 	/*
-	 * Loop over all buffers again, and write the ones (still) marked with
-	 * BM_CHECKPOINT_NEEDED.  In this loop, we start at the clock sweep point
-	 * since we might as well dump soon-to-be-recycled buffers first.
+	 * Sort the buffers.  The tags may have changed since we looked at them,
+	 * but that doesn't matter: we just write in a less than ideal order.
+	 */
+	qsort(CkptBufferIds, num_to_scan, sizeof(CkptSortItem),
+		  ckpt_buforder_comparator);
+
+	/*
+	 * The array is now grouped by tablespace.  Collect the number of
+	 * buffers to write to each.
+	 */
+	num_spaces = 0;
+	last_tsid = InvalidOid;
+	for (i = 0; i < num_to_scan; i++)
+	{
+		CkptTsStatus *s;
+		Oid			cur_tsid = CkptBufferIds[i].tsId;
+
+		if (i == 0 || cur_tsid != last_tsid)
+		{
+			Size		sz;
+
+			num_spaces++;
+			sz = sizeof(CkptTsStatus) * num_spaces;
+			if (per_ts_stat == NULL)
+				per_ts_stat = (CkptTsStatus *) palloc(sz);
+			else
+				per_ts_stat = (CkptTsStatus *) repalloc(per_ts_stat, sz);
+
+			s = &per_ts_stat[num_spaces - 1];
+			memset(s, 0, sizeof(*s));
+			s->tsId = cur_tsid;
+			s->index = i;
+			last_tsid = cur_tsid;
+		}
+		else
+			s = &per_ts_stat[num_spaces - 1];
+
+		s->num_to_scan++;
+	}
+
+	Assert(num_spaces > 0);
+
+	/*
+	 * Build a min-heap over the tablespaces' progress, so that we always
+	 * write to the tablespace that is furthest behind.  (binaryheap is a
+	 * max-heap; the comparator is inverted.)
+	 */
+	ts_heap = binaryheap_allocate(num_spaces, ts_ckpt_progress_comparator,
+								  NULL);
+	for (i = 0; i < num_spaces; i++)
+	{
+		CkptTsStatus *ts_stat = &per_ts_stat[i];
+
+		ts_stat->progress_slice = (float8) num_to_scan / ts_stat->num_to_scan;
+		binaryheap_add_unordered(ts_heap, PointerGetDatum(ts_stat));
+	}
+	binaryheap_build(ts_heap);
+
+	/*
+	 * Write the buffers (still) marked with BM_CHECKPOINT_NEEDED.  We throttle
+	 * on the number of buffers processed rather than written, since buffers
+	 * written by others also count as progress.
 	 *
 	 * Note that we don't read the buffer alloc count here --- that should be
 	 * left untouched till the next BgBufferSync() call.
 	 */
-	buf_id = StrategySyncStart(NULL, NULL);
-	num_to_scan = NBuffers;
+	wb_context.nr_pending = 0;
+	num_processed = 0;
 	num_written = 0;
-	while (num_to_scan-- > 0)
+	while (!binaryheap_empty(ts_heap))
 	{
-		volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
+		CkptTsStatus *ts_stat = (CkptTsStatus *)
+			DatumGetPointer(binaryheap_first(ts_heap));
+		volatile BufferDesc *bufHdr;
+
+		buf_id = CkptBufferIds[ts_stat->index].buf_id;
+		Assert(buf_id != -1);
+		bufHdr = &BufferDescriptors[buf_id];
+
+		num_processed++;
 
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
@@ -1299,44 +1444,47 @@ BufferSync(int flags)
 		 */
 		if (bufHdr->flags & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false) & BUF_WRITTEN)
+			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				BgWriterStats.m_buf_written_checkpoints++;
 				num_written++;
-
-				/*
-				 * We know there are at most num_to_write buffers with
-				 * BM_CHECKPOINT_NEEDED set; so we can stop scanning if
-				 * num_written reaches num_to_write.
-				 *
-				 * Note that num_written doesn't include buffers written by
-				 * other backends, or by the bgwriter cleaning scan. That
-				 * means that the estimate of how much progress we've made is
-				 * conservative, and also that this test will often fail to
-				 * trigger.  But it seems worth making anyway.
-				 */
-				if (num_written >= num_to_write)
-					break;
-
-				/*
-				 * Sleep to throttle our I/O rate.
-				 */
-				CheckpointWriteDelay(flags, (double) num_written / num_to_write);
 			}
 		}
 
-		if (++buf_id >= NBuffers)
-			buf_id = 0;
+		/*
+		 * Measure progress independently of actually having to write a
+		 * buffer, so that the tablespaces stay balanced.
+		 */
+		ts_stat->progress += ts_stat->progress_slice;
+		ts_stat->num_scanned++;
+		ts_stat->index++;
+
+		/* Have all the buffers of this tablespace been processed? */
+		if (ts_stat->num_scanned == ts_stat->num_to_scan)
+			binaryheap_remove_first(ts_heap);
+		else
+			binaryheap_replace_first(ts_heap, PointerGetDatum(ts_stat));
+
+		/*
+		 * Sleep to throttle our I/O rate.
+		 */
+		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
+	/* Issue the writebacks still pending */
+	IssuePendingWritebacks(&wb_context);
+
+	pfree(per_ts_stat);
+	binaryheap_free(ts_heap);
+
 	/*
 	 * Update checkpoint statistics. As noted above, this doesn't include
 	 * buffers written by other backends or bgwriter scan.
 	 */
 	CheckpointStats.ckpt_bufs_written += num_written;
 
-	TRACE_POSTGRESQL_BUFFER_SYNC_DONE(NBuffers, num_written, num_to_write);
+	TRACE_POSTGRESQL_BUFFER_SYNC_DONE(NBuffers, num_written, num_to_scan);
 }
 
 /*
@@ -1576,7 +1724,7 @@ BgBufferSync(void)
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			buffer_state = SyncOneBuffer(next_to_clean, true);
+		int			buffer_state = SyncOneBuffer(next_to_clean, true, NULL);
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -1650,13 +1798,17 @@ BgBufferSync(void)
  * (BUF_WRITTEN could be set in error if FlushBuffers finds the buffer clean
  * after locking it, but we don't care all that much.)
  *
+ * If wb_context isn't NULL, the write is scheduled for kernel writeback.
+ *
  * Note: caller must have done ResourceOwnerEnlargeBuffers.
  */
 static int
-SyncOneBuffer(int buf_id, bool skip_recently_used)
+SyncOneBuffer(int buf_id, bool skip_recently_used,
+			  WritebackContext *wb_context)
 {
 	volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
 	int			result = 0;
+	BufferTag	tag;
 
 	/*
 	 * Check whether buffer needs writing.
@@ -1695,11 +1847,92 @@ SyncOneBuffer(int buf_id, bool skip_recently_used)
 	FlushBuffer(bufHdr, NULL);
 
 	LWLockRelease(bufHdr->content_lock);
+
+	/* The tag can't change while we hold the pin */
+	tag = bufHdr->tag;
+
 	UnpinBuffer(bufHdr, true);
 
+	if (wb_context != NULL)
+		ScheduleBufferTagForWriteback(wb_context, &tag);
+
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * ScheduleBufferTagForWriteback -- remember a block to be written back
+ *
+ * Once checkpoint_flush_after blocks have accumulated, they are all handed
+ * to the kernel for writeback.
+ */
+static void
+ScheduleBufferTagForWriteback(WritebackContext *context, BufferTag *tag)
+{
+	if (checkpoint_flush_after <= 0)
+		return;
+
+	Assert(context->nr_pending < WRITEBACK_MAX_PENDING_FLUSHES);
+	context->pending[context->nr_pending++] = *tag;
+
+	/*
+	 * checkpoint_flush_after may have been lowered since the last call, so
+	 * check for >= rather than ==.
+	 */
+	if (context->nr_pending >= checkpoint_flush_after)
+		IssuePendingWritebacks(context);
+}
+
+/*
+ * IssuePendingWritebacks -- ask the kernel to write back pending blocks
+ *
+ * The pending blocks are sorted so that consecutive blocks of a file can be
+ * flushed with a single request.
+ */
+static void
+IssuePendingWritebacks(WritebackContext *context)
+{
+	int			i;
+
+	if (context->nr_pending == 0)
+		return;
+
+	qsort(context->pending, context->nr_pending, sizeof(BufferTag),
+		  buffertag_comparator);
+
+	i = 0;
+	while (i < context->nr_pending)
+	{
+		BufferTag  *tag = &context->pending[i];
+		BlockNumber nblocks = 1;
+		SMgrRelation reln;
+		int			ahead;
+
+		/* Extend the run over following blocks of the same fork */
+		for (ahead = i + 1; ahead < context->nr_pending; ahead++)
+		{
+			BufferTag  *next = &context->pending[ahead];
+
+			if (!RelFileNodeEquals(tag->rnode, next->rnode) ||
+				tag->forkNum != next->forkNum)
+				break;
+
+			/* the same block may have been written twice */
+			if (next->blockNum == tag->blockNum + nblocks - 1)
+				continue;
+			if (next->blockNum != tag->blockNum + nblocks)
+				break;
+			nblocks++;
+		}
+
+		reln = smgropen(tag->rnode, InvalidBackendId);
+		smgrwriteback(reln, tag->forkNum, tag->blockNum, nblocks);
+
+		i = ahead;
+	}
+
+	context->nr_pending = 0;
+}
+
 
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
@@ -3189,6 +3422,76 @@ local_buffer_write_error_callback(void *arg)
 	}
 }
 
+/*
+ * Comparator determining the order in which a checkpoint writes buffers:
+ * by tablespace, then file, then block.
+ */
+static int
+ckpt_buforder_comparator(const void *pa, const void *pb)
+{
+	const CkptSortItem *a = (const CkptSortItem *) pa;
+	const CkptSortItem *b = (const CkptSortItem *) pb;
+
+	if (a->tsId < b->tsId)
+		return -1;
+	else if (a->tsId > b->tsId)
+		return 1;
+	if (a->relNode < b->relNode)
+		return -1;
+	else if (a->relNode > b->relNode)
+		return 1;
+	if (a->forkNum < b->forkNum)
+		return -1;
+	else if (a->forkNum > b->forkNum)
+		return 1;
+	if (a->blockNum < b->blockNum)
+		return -1;
+	else if (a->blockNum > b->blockNum)
+		return 1;
+	return 0;
+}
+
+/*
+ * binaryheap comparator putting the tablespace with the least checkpoint
+ * progress first.
+ */
+static int
+ts_ckpt_progress_comparator(Datum a, Datum b, void *arg)
+{
+	CkptTsStatus *sa = (CkptTsStatus *) DatumGetPointer(a);
+	CkptTsStatus *sb = (CkptTsStatus *) DatumGetPointer(b);
+
+	if (sa->progress < sb->progress)
+		return 1;
+	else if (sa->progress > sb->progress)
+		return -1;
+	return 0;
+}
+
+/*
+ * BufferTag qsort comparator, for IssuePendingWritebacks.
+ */
+static int
+buffertag_comparator(const void *pa, const void *pb)
+{
+	const BufferTag *a = (const BufferTag *) pa;
+	const BufferTag *b = (const BufferTag *) pb;
+	int			ret;
+
+	ret = rnode_comparator(&a->rnode, &b->rnode);
+	if (ret != 0)
+		return ret;
+	if (a->forkNum < b->forkNum)
+		return -1;
+	else if (a->forkNum > b->forkNum)
+		return 1;
+	if (a->blockNum < b->blockNum)
+		return -1;
+	else if (a->blockNum > b->blockNum)
+		return 1;
+	return 0;
+}
+
 /*
  * RelFileNode qsort/bsearch comparator; see RelFileNodeEquals.
  */
@@ -17,6 +17,7 @@
 
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/spin.h"
 
 
 /*
@@ -24,6 +25,9 @@
  */
 typedef struct
 {
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
+
 	/* Clock sweep hand: index of next buffer to consider grabbing */
 	int			nextVictimBuffer;
 
@@ -91,6 +95,33 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 				volatile BufferDesc *buf);
 
 
+/*
+ * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ *
+ * Move the clock hand one buffer ahead of its current position and return
+ * the id of the buffer now under the hand.  Only the advancement of the hand
+ * needs the buffer_strategy_lock; the caller inspects the buffer header on
+ * its own, so concurrent backends can sweep different buffers in parallel.
+ */
+static inline int
+ClockSweepTick(void)
+{
+	volatile BufferStrategyControl *sc = StrategyControl;
+	int			victim;
+
+	SpinLockAcquire(&sc->buffer_strategy_lock);
+	victim = sc->nextVictimBuffer;
+	if (++sc->nextVictimBuffer >= NBuffers)
+	{
+		sc->nextVictimBuffer = 0;
+		sc->completePasses++;
+	}
+	SpinLockRelease(&sc->buffer_strategy_lock);
+
+	return victim;
+}
+
+
 /*
  * StrategyGetBuffer
  *
@@ -101,75 +132,76 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
  *	strategy is a BufferAccessStrategy object, or NULL for default strategy.
  *
  *	To ensure that no one else can pin the buffer before we do, we must
- *	return the buffer with the buffer header spinlock still held.  If
- *	*lock_held is set on exit, we have returned with the BufFreelistLock
- *	still held, as well; the caller must release that lock once the spinlock
- *	is dropped.  We do it that way because releasing the BufFreelistLock
- *	might awaken other processes, and it would be bad to do the associated
- *	kernel calls while holding the buffer header spinlock.
+ *	return the buffer with the buffer header spinlock still held.
  */
 volatile BufferDesc *
-StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
+StrategyGetBuffer(BufferAccessStrategy strategy)
 {
+	volatile BufferStrategyControl *sc = StrategyControl;
 	volatile BufferDesc *buf;
 	Latch	   *bgwriterLatch;
 	int			trycounter;
 
 	/*
 	 * If given a strategy object, see whether it can select a buffer. We
-	 * assume strategy objects don't need the BufFreelistLock.
+	 * assume strategy objects don't need buffer_strategy_lock.
 	 */
 	if (strategy != NULL)
 	{
 		buf = GetBufferFromRing(strategy);
 		if (buf != NULL)
-		{
-			*lock_held = false;
 			return buf;
-		}
 	}
 
-	/* Nope, so lock the freelist */
-	*lock_held = true;
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-
 	/*
 	 * We count buffer allocation requests so that the bgwriter can estimate
 	 * the rate of buffer consumption.	Note that buffers recycled by a
 	 * strategy object are intentionally not counted here.
+	 *
+	 * If bgwriterLatch is set, we need to waken the bgwriter, but we must not
+	 * do so while holding buffer_strategy_lock, since SetLatch may need to
+	 * issue a kernel call.  Remember the latch and set it once we've let go.
 	 */
-	StrategyControl->numBufferAllocs++;
+	SpinLockAcquire(&sc->buffer_strategy_lock);
+	sc->numBufferAllocs++;
+	bgwriterLatch = sc->bgwriterLatch;
+	sc->bgwriterLatch = NULL;
+	SpinLockRelease(&sc->buffer_strategy_lock);
 
-	/*
-	 * If bgwriterLatch is set, we need to waken the bgwriter, but we should
-	 * not do so while holding BufFreelistLock; so release and re-grab.  This
-	 * is annoyingly tedious, but it happens at most once per bgwriter cycle,
-	 * so the performance hit is minimal.
-	 */
-	bgwriterLatch = StrategyControl->bgwriterLatch;
 	if (bgwriterLatch)
-	{
-		StrategyControl->bgwriterLatch = NULL;
-		LWLockRelease(BufFreelistLock);
 		SetLatch(bgwriterLatch);
-		LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-	}
 
 	/*
 	 * Try to get a buffer from the freelist.  Note that the freeNext fields
-	 * are considered to be protected by the BufFreelistLock not the
+	 * are considered to be protected by buffer_strategy_lock not the
 	 * individual buffer spinlocks, so it's OK to manipulate them without
-	 * holding the spinlock.
+	 * holding the buffer header spinlock.  We must not take a buffer header
+	 * spinlock while holding buffer_strategy_lock, though, so the buffer is
+	 * unlinked first and only then examined.
+	 *
+	 * The unlocked check of firstFreeBuffer is merely an optimization to
+	 * avoid the spinlock in the common case of an empty freelist; if we miss
+	 * a buffer that was just freed, the clock sweep will find it.
 	 */
-	while (StrategyControl->firstFreeBuffer >= 0)
+	while (sc->firstFreeBuffer >= 0)
 	{
-		buf = &BufferDescriptors[StrategyControl->firstFreeBuffer];
+		SpinLockAcquire(&sc->buffer_strategy_lock);
+
+		if (sc->firstFreeBuffer < 0)
+		{
+			SpinLockRelease(&sc->buffer_strategy_lock);
+			break;
+		}
+
+		buf = &BufferDescriptors[sc->firstFreeBuffer];
 		Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
 
 		/* Unconditionally remove buffer from freelist */
-		StrategyControl->firstFreeBuffer = buf->freeNext;
+		sc->firstFreeBuffer = buf->freeNext;
 		buf->freeNext = FREENEXT_NOT_IN_LIST;
 
+		SpinLockRelease(&sc->buffer_strategy_lock);
+
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
 		 * it; discard it and retry.  (This can only happen if VACUUM put a
@@ -187,17 +219,16 @@ StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
 		UnlockBufHdr(buf);
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
+	/*
+	 * Nothing on the freelist, so run the "clock sweep" algorithm.  The
+	 * buffer_strategy_lock is only held long enough to advance the hand, so
+	 * several backends can be examining (and decrementing the usage counts
+	 * of) different buffers at the same time.
+	 */
 	trycounter = NBuffers;
 	for (;;)
 	{
-		buf = &BufferDescriptors[StrategyControl->nextVictimBuffer];
-
-		if (++StrategyControl->nextVictimBuffer >= NBuffers)
-		{
-			StrategyControl->nextVictimBuffer = 0;
-			StrategyControl->completePasses++;
-		}
+		buf = &BufferDescriptors[ClockSweepTick()];
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -241,7 +272,9 @@ StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
 void
 StrategyFreeBuffer(volatile BufferDesc *buf)
 {
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
+	volatile BufferStrategyControl *sc = StrategyControl;
+
+	SpinLockAcquire(&sc->buffer_strategy_lock);
 
 	/*
 	 * It is possible that we are told to put something in the freelist that
@@ -249,13 +282,13 @@ StrategyFreeBuffer(volatile BufferDesc *buf)
 	 */
 	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
 	{
-		buf->freeNext = StrategyControl->firstFreeBuffer;
+		buf->freeNext = sc->firstFreeBuffer;
 		if (buf->freeNext < 0)
-			StrategyControl->lastFreeBuffer = buf->buf_id;
-		StrategyControl->firstFreeBuffer = buf->buf_id;
+			sc->lastFreeBuffer = buf->buf_id;
+		sc->firstFreeBuffer = buf->buf_id;
 	}
 
-	LWLockRelease(BufFreelistLock);
+	SpinLockRelease(&sc->buffer_strategy_lock);
 }
 
 /*
@@ -272,18 +305,19 @@ StrategyFreeBuffer(volatile BufferDesc *buf)
 int
 StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
 {
+	volatile BufferStrategyControl *sc = StrategyControl;
 	int			result;
 
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-	result = StrategyControl->nextVictimBuffer;
+	SpinLockAcquire(&sc->buffer_strategy_lock);
+	result = sc->nextVictimBuffer;
 	if (complete_passes)
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = sc->completePasses;
 	if (num_buf_alloc)
 	{
-		*num_buf_alloc = StrategyControl->numBufferAllocs;
-		StrategyControl->numBufferAllocs = 0;
+		*num_buf_alloc = sc->numBufferAllocs;
+		sc->numBufferAllocs = 0;
 	}
-	LWLockRelease(BufFreelistLock);
+	SpinLockRelease(&sc->buffer_strategy_lock);
 	return result;
 }
 
@@ -298,14 +332,16 @@ StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
 void
 StrategyNotifyBgWriter(Latch *bgwriterLatch)
 {
+	volatile BufferStrategyControl *sc = StrategyControl;
+
 	/*
-	 * We acquire the BufFreelistLock just to ensure that the store appears
+	 * We acquire buffer_strategy_lock just to ensure that the store appears
 	 * atomic to StrategyGetBuffer.  The bgwriter should call this rather
 	 * infrequently, so there's no performance penalty from being safe.
 	 */
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-	StrategyControl->bgwriterLatch = bgwriterLatch;
-	LWLockRelease(BufFreelistLock);
+	SpinLockAcquire(&sc->buffer_strategy_lock);
+	sc->bgwriterLatch = bgwriterLatch;
+	SpinLockRelease(&sc->buffer_strategy_lock);
 }
 
 
@@ -370,6 +406,8 @@ StrategyInitialize(bool init)
 		 */
 		Assert(init);
 
+		SpinLockInit(&StrategyControl->buffer_strategy_lock);
+
 		/*
 		 * Grab the whole linked list of free buffers for our strategy. We
 		 * assume it was previously set up by InitBufferPool().
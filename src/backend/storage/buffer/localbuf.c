@@ -86,6 +86,7 @@ LocalPrefetchBuffer(SMgrRelation smgr, ForkNumber forkNum,
 
 	/* Not in buffers, so initiate prefetch */
 	smgrprefetch(smgr, forkNum, blockNum);
+	pgBufferUsage.local_blks_prefetch_issued++;
 #endif   /* USE_PREFETCH */
 }
 
@@ -1267,6 +1267,32 @@ FilePrefetch(File file, off_t offset, int amount)
 #endif
 }
 
+/*
+ * Ask the kernel to start writing back the given range of the file.  Used
+ * to spread the write-out of dirty data over time, rather than leaving it
+ * all for the next fsync.
+ */
+int
+FileWriteback(File file, off_t offset, off_t nbytes)
+{
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileWriteback: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) nbytes));
+
+	if (nbytes <= 0)
+		return 0;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	return pg_flush_data(VfdCache[file].fd, offset, nbytes);
+}
+
 int
 FileRead(File file, char *buffer, int amount)
 {
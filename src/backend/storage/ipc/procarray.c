@@ -32,6 +32,11 @@
  * happen, it would tie up KnownAssignedXids indefinitely, so we protect
  * ourselves by pruning the array when a valid list of running XIDs arrives.
  *
+ * Outside recovery, the last snapshot computed is also kept in shared memory
+ * until the set of running transactions changes, that is, until some
+ * transaction ends.  While it is valid, GetSnapshotData can copy it instead
+ * of scanning the whole array.
+ *
  * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -52,6 +57,7 @@
 #include "access/twophase.h"
 #include "catalog/catalog.h"
 #include "miscadmin.h"
+#include "storage/barrier.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "storage/spin.h"
@@ -89,6 +95,28 @@ typedef struct ProcArrayStruct
 	/* oldest catalog xmin of any replication slot */
 	TransactionId replication_slot_catalog_xmin;
 
+	/*
+	 * Cached snapshot, see GetSnapshotData.  It includes the XIDs of all
+	 * running transactions, unlike a snapshot for a particular backend, which
+	 * leaves out the backend's own XIDs.  The cache is only valid until a
+	 * transaction ends: snapshot_cache_valid is cleared with ProcArrayLock
+	 * held exclusively, and set again, once the cache has been filled, by a
+	 * backend holding it in shared mode.  So readers holding the lock in
+	 * either mode can trust the contents while it is set.  Since several
+	 * backends may hold the lock shared at once, only the one that sets
+	 * snapshot_cache_filling under snapshot_cache_lck may fill the cache.
+	 * The XID arrays themselves are cachedXip and cachedSubxip.
+	 */
+	bool		snapshot_cache_valid;
+	bool		snapshot_cache_filling;
+	slock_t		snapshot_cache_lck;
+	TransactionId cached_xmin;
+	TransactionId cached_xmax;
+	TransactionId cached_globalxmin;
+	int			cached_xcnt;
+	int			cached_subxcnt;
+	bool		cached_suboverflowed;
+
 	/*
 	 * We declare pgprocnos[] as 1 entry because C wants a fixed-size array,
 	 * but actually it is maxProcs entries long.
@@ -101,6 +129,10 @@ static ProcArrayStruct *procArray;
 static PGPROC *allProcs;
 static PGXACT *allPgXact;
 
+/* XID arrays of the cached snapshot, see ProcArrayStruct */
+static TransactionId *cachedXip;
+static TransactionId *cachedSubxip;
+
 /*
  * Bookkeeping for tracking emulated transactions in recovery
  */
@@ -152,6 +184,14 @@ static void DisplayXidCache(void);
 #define xc_slow_answer_inc()		((void) 0)
 #endif   /* XIDCACHE_DEBUG */
 
+/* Shared snapshot cache */
+static bool SnapshotCacheFetch(Snapshot snapshot, TransactionId xmax,
+				   TransactionId *xmin, TransactionId *globalxmin,
+				   int *count, int *subcount, bool *suboverflowed);
+static void SnapshotCacheStore(Snapshot snapshot, TransactionId xmin,
+				   TransactionId xmax, TransactionId globalxmin,
+				   int count, int subcount, bool suboverflowed);
+
 /* Primitives for KnownAssignedXids array handling for standby */
 static void KnownAssignedXidsCompress(bool force);
 static void KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
@@ -209,6 +249,11 @@ ProcArrayShmemSize(void)
 						mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS));
 	}
 
+	/* XID arrays for the cached snapshot */
+	size = add_size(size, mul_size(sizeof(TransactionId), PROCARRAY_MAXPROCS));
+	size = add_size(size,
+					mul_size(sizeof(TransactionId), TOTAL_MAX_CACHED_SUBXIDS));
+
 	return size;
 }
 
@@ -242,11 +287,25 @@ CreateSharedProcArray(void)
 		procArray->headKnownAssignedXids = 0;
 		SpinLockInit(&procArray->known_assigned_xids_lck);
 		procArray->lastOverflowedXid = InvalidTransactionId;
+		procArray->snapshot_cache_valid = false;
+		procArray->snapshot_cache_filling = false;
+		SpinLockInit(&procArray->snapshot_cache_lck);
 	}
 
 	allProcs = ProcGlobal->allProcs;
 	allPgXact = ProcGlobal->allPgXact;
 
+	/* Create or attach to the cached snapshot's XID arrays */
+	cachedXip = (TransactionId *)
+		ShmemInitStruct("Snapshot Cache Xids",
+						mul_size(sizeof(TransactionId), PROCARRAY_MAXPROCS),
+						&found);
+	cachedSubxip = (TransactionId *)
+		ShmemInitStruct("Snapshot Cache Subxids",
+						mul_size(sizeof(TransactionId),
+								 TOTAL_MAX_CACHED_SUBXIDS),
+						&found);
+
 	/* Create or attach to the KnownAssignedXids arrays too, if needed */
 	if (EnableHotStandby)
 	{
@@ -345,6 +404,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
+
+		/* The transaction is no longer running; forget cached snapshot */
+		arrayP->snapshot_cache_valid = false;
 	}
 	else
 	{
@@ -420,6 +482,9 @@ ProcArrayEndTransaction(PGPROC *proc, TransactionId latestXid)
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
 
+		/* Snapshots taken from now on must see us as finished */
+		procArray->snapshot_cache_valid = false;
+
 		LWLockRelease(ProcArrayLock);
 	}
 	else
@@ -1418,7 +1483,16 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	if (!snapshot->takenDuringRecovery &&
+		SnapshotCacheFetch(snapshot, xmax, &xmin, &globalxmin,
+						   &count, &subcount, &suboverflowed))
+	{
+		/*
+		 * No transaction has ended since the cached snapshot was taken, so
+		 * it's still right and we've copied it.
+		 */
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		int		   *pgprocnos = arrayP->pgprocnos;
 		int			numProcs;
@@ -1512,6 +1586,10 @@ GetSnapshotData(Snapshot snapshot)
 				}
 			}
 		}
+
+		/* Let others use the result until some transaction ends */
+		SnapshotCacheStore(snapshot, xmin, xmax, globalxmin,
+						   count, subcount, suboverflowed);
 	}
 	else
 	{
@@ -1611,6 +1689,149 @@ GetSnapshotData(Snapshot snapshot)
 	return snapshot;
 }
 
+/*
+ * SnapshotCacheFetch -- copy the cached snapshot, if it's valid
+ *
+ * Caller must hold ProcArrayLock and pass the current xmax.  Our own XID is
+ * left out of snapshot->xip, as GetSnapshotData does when scanning the proc
+ * array.  Our own subtransaction XIDs may be in snapshot->subxip, though;
+ * that does no harm, since visibility checks test for XIDs of the current
+ * transaction before consulting the snapshot.
+ *
+ * Returns false, leaving the snapshot untouched, if the cache isn't valid.
+ */
+static bool
+SnapshotCacheFetch(Snapshot snapshot, TransactionId xmax,
+				   TransactionId *xmin, TransactionId *globalxmin,
+				   int *count, int *subcount, bool *suboverflowed)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile ProcArrayStruct *arrayP = procArray;
+	TransactionId myxid = MyPgXact->xid;
+	int			xcnt;
+	int			n = 0;
+	int			i;
+
+	if (!arrayP->snapshot_cache_valid)
+	{
+		MyProc->snapshotCacheMisses++;
+		return false;
+	}
+
+	/* don't read the contents before seeing them marked valid */
+	pg_read_barrier();
+
+	Assert(TransactionIdEquals(arrayP->cached_xmax, xmax));
+
+	xcnt = arrayP->cached_xcnt;
+	for (i = 0; i < xcnt; i++)
+	{
+		if (!TransactionIdEquals(cachedXip[i], myxid))
+			snapshot->xip[n++] = cachedXip[i];
+	}
+	*count = n;
+
+	*subcount = arrayP->cached_subxcnt;
+	memcpy(snapshot->subxip, cachedSubxip,
+		   *subcount * sizeof(TransactionId));
+	*suboverflowed = arrayP->cached_suboverflowed;
+
+	*xmin = arrayP->cached_xmin;
+	*globalxmin = arrayP->cached_globalxmin;
+
+	MyProc->snapshotCacheHits++;
+	return true;
+}
+
+/*
+ * SnapshotCacheStore -- save a freshly computed snapshot in the cache
+ *
+ * Caller must hold ProcArrayLock, and pass the results of its scan of the
+ * proc array.  If the cache is already valid or someone else is filling it,
+ * we do nothing.  Since the scan left out our own XIDs, we add them here.
+ */
+static void
+SnapshotCacheStore(Snapshot snapshot, TransactionId xmin, TransactionId xmax,
+				   TransactionId globalxmin, int count, int subcount,
+				   bool suboverflowed)
+{
+	/* use volatile pointers to prevent code rearrangement */
+	volatile ProcArrayStruct *arrayP = procArray;
+	volatile PGXACT *pgxact = MyPgXact;
+	TransactionId myxid = pgxact->xid;
+	bool		fill;
+
+	SpinLockAcquire(&arrayP->snapshot_cache_lck);
+	fill = !arrayP->snapshot_cache_valid && !arrayP->snapshot_cache_filling;
+	if (fill)
+		arrayP->snapshot_cache_filling = true;
+	SpinLockRelease(&arrayP->snapshot_cache_lck);
+
+	if (!fill)
+		return;
+
+	memcpy(cachedXip, snapshot->xip, count * sizeof(TransactionId));
+	memcpy(cachedSubxip, snapshot->subxip, subcount * sizeof(TransactionId));
+
+	/* add our own XIDs by the same rules the scan applies to others */
+	if (!(pgxact->vacuumFlags & (PROC_IN_LOGICAL_DECODING | PROC_IN_VACUUM)) &&
+		TransactionIdIsNormal(myxid) &&
+		NormalTransactionIdPrecedes(myxid, xmax))
+	{
+		cachedXip[count++] = myxid;
+
+		if (!suboverflowed)
+		{
+			if (pgxact->overflowed)
+				suboverflowed = true;
+			else if (pgxact->nxids > 0)
+			{
+				memcpy(cachedSubxip + subcount,
+					   (void *) MyProc->subxids.xids,
+					   pgxact->nxids * sizeof(TransactionId));
+				subcount += pgxact->nxids;
+			}
+		}
+	}
+
+	arrayP->cached_xmin = xmin;
+	arrayP->cached_xmax = xmax;
+	arrayP->cached_globalxmin = globalxmin;
+	arrayP->cached_xcnt = count;
+	arrayP->cached_subxcnt = subcount;
+	arrayP->cached_suboverflowed = suboverflowed;
+
+	/* make sure the contents are in place before anyone can use them */
+	pg_write_barrier();
+
+	SpinLockAcquire(&arrayP->snapshot_cache_lck);
+	arrayP->snapshot_cache_valid = true;
+	arrayP->snapshot_cache_filling = false;
+	SpinLockRelease(&arrayP->snapshot_cache_lck);
+}
+
+/*
+ * GetSnapshotCacheStats -- count uses of the cached snapshot
+ *
+ * Returns the number of snapshots copied from the cache, and the number
+ * that had to be computed because it wasn't valid, since server start.
+ */
+void
+GetSnapshotCacheStats(uint64 *hits, uint64 *misses)
+{
+	int			i;
+
+	*hits = 0;
+	*misses = 0;
+	for (i = 0; i < ProcGlobal->allProcCount; i++)
+	{
+		volatile PGPROC *proc = &allProcs[i];
+
+		*hits += proc->snapshotCacheHits;
+		*misses += proc->snapshotCacheMisses;
+	}
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyPgXact->xmin
  *
@@ -1684,6 +1905,45 @@ ProcArrayInstallImportedXmin(TransactionId xmin, TransactionId sourcexid)
 	return result;
 }
 
+/*
+ * ProcArrayInstallRestoredXmin -- install restored xmin into MyPgXact->xmin
+ *
+ * Like ProcArrayInstallImportedXmin, but for a snapshot passed to us by
+ * another backend that keeps running while we use it, such as the leader of
+ * a parallel query.  Its xmin keeps the snapshot's xmin from going away,
+ * and we check that it does so atomically with installing the new xmin.
+ *
+ * Returns TRUE if successful, FALSE if proc's xmin doesn't cover xmin.
+ */
+bool
+ProcArrayInstallRestoredXmin(TransactionId xmin, PGPROC *proc)
+{
+	bool		result = false;
+	volatile PGXACT *pgxact;
+	TransactionId xid;
+
+	Assert(TransactionIdIsNormal(xmin));
+	Assert(proc != NULL);
+
+	/* Get lock so source proc's xmin can't change while we're doing this */
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+
+	pgxact = &allPgXact[proc->pgprocno];
+
+	xid = pgxact->xmin;			/* fetch just once */
+	if (proc->databaseId == MyDatabaseId &&
+		TransactionIdIsNormal(xid) &&
+		TransactionIdPrecedesOrEquals(xid, xmin))
+	{
+		MyPgXact->xmin = TransactionXmin = xmin;
+		result = true;
+	}
+
+	LWLockRelease(ProcArrayLock);
+
+	return result;
+}
+
 /*
  * GetRunningTransactionData -- returns information about running transactions.
  *
@@ -2792,6 +3052,9 @@ XidCacheRemoveRunningXids(TransactionId xid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
 
+	/* The subtransactions are no longer running; forget cached snapshot */
+	procArray->snapshot_cache_valid = false;
+
 	LWLockRelease(ProcArrayLock);
 }
 
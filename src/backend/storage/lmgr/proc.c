@@ -38,6 +38,7 @@
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "miscadmin.h"
 #include "postmaster/autovacuum.h"
 #include "replication/slot.h"
@@ -392,6 +393,11 @@ InitProcess(void)
 	MyProc->syncRepState = SYNC_REP_NOT_WAITING;
 	SHMQueueElemInit(&(MyProc->syncRepLinks));
 
+	/* Initialize fields for group flushing of WAL */
+	MyProc->flushRqst = InvalidXLogRecPtr;
+	MyProc->flushState = XLOG_FLUSH_NOT_WAITING;
+	MyProc->flushWaitLink = NULL;
+
 	/*
 	 * Acquire ownership of the PGPROC's latch, so that we can use WaitLatch.
 	 * Note that there's no particular need to do ResetLatch here.
@@ -538,6 +544,9 @@ InitAuxiliaryProcess(void)
 	MyProc->lwWaitLink = NULL;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
+	MyProc->flushRqst = InvalidXLogRecPtr;
+	MyProc->flushState = XLOG_FLUSH_NOT_WAITING;
+	MyProc->flushWaitLink = NULL;
 #ifdef USE_ASSERT_CHECKING
 	if (assert_enabled)
 	{
@@ -896,6 +896,86 @@ PageIndexMultiDelete(Page page, OffsetNumber *itemnos, int nitems)
 	phdr->pd_upper = upper;
 }
 
+/*
+ * PageIndexDeleteNoCompact
+ *
+ * Remove the specified tuple from an index page, but mark its line pointer
+ * unused instead of compacting the line pointer array.  This is useful for
+ * index AMs (such as BRIN) that keep external references to items by TID,
+ * and so cannot have other items move to a different offset when one is
+ * deleted.  The space occupied by the tuple's data is reclaimed.
+ *
+ * A subsequent PageAddItem with overwrite = true can reuse the line pointer.
+ */
+void
+PageIndexDeleteNoCompact(Page page, OffsetNumber offnum)
+{
+	PageHeader	phdr = (PageHeader) page;
+	ItemId		tup;
+	char	   *addr;
+	unsigned	offset;
+	Size		size;
+	int			nline;
+	int			i;
+
+	/*
+	 * As with PageRepairFragmentation, paranoia seems justified.
+	 */
+	if (phdr->pd_lower < SizeOfPageHeaderData ||
+		phdr->pd_lower > phdr->pd_upper ||
+		phdr->pd_upper > phdr->pd_special ||
+		phdr->pd_special > BLCKSZ)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("corrupted page pointers: lower = %u, upper = %u, special = %u",
+						phdr->pd_lower, phdr->pd_upper, phdr->pd_special)));
+
+	nline = PageGetMaxOffsetNumber(page);
+	if ((int) offnum <= 0 || (int) offnum > nline)
+		elog(ERROR, "invalid index offnum: %u", offnum);
+
+	tup = PageGetItemId(page, offnum);
+	Assert(ItemIdHasStorage(tup));
+	size = MAXALIGN(ItemIdGetLength(tup));
+	offset = ItemIdGetOffset(tup);
+
+	if (offset < phdr->pd_upper || (offset + size) > phdr->pd_special ||
+		offset != MAXALIGN(offset))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("corrupted item pointer: offset = %u, size = %u",
+						offset, (unsigned int) size)));
+
+	/*
+	 * Move everything between the beginning of tuple space and the beginning
+	 * of the deleted tuple forward, so that space in the middle of the page
+	 * is left free.
+	 */
+	addr = (char *) page + phdr->pd_upper;
+
+	if (offset > phdr->pd_upper)
+		memmove(addr + size, addr, (int) (offset - phdr->pd_upper));
+
+	phdr->pd_upper += size;
+
+	/*
+	 * Mark the line pointer unused, and adjust the remaining ones: anything
+	 * that used to be before the deleted tuple's data was moved forward by
+	 * the size of the deleted tuple.
+	 */
+	ItemIdSetUnused(tup);
+
+	for (i = 1; i <= nline; i++)
+	{
+		ItemId		ii = PageGetItemId(phdr, i);
+
+		if (ItemIdHasStorage(ii) && ItemIdGetOffset(ii) <= offset)
+			ii->lp_off += size;
+	}
+
+	PageSetHasFreeLinePointers(page);
+}
+
 
 /*
  * Set checksum for a page in shared buffers.
@@ -35,6 +35,7 @@
 #include "utils/builtins.h"
 #include "utils/int8.h"
 #include "utils/numeric.h"
+#include "utils/sortsupport.h"
 
 /* ----------
  * Uncomment the following to enable compilation of dump_numeric()
@@ -393,6 +394,7 @@ static double numeric_to_double_no_overflow(Numeric num);
 static double numericvar_to_double_no_overflow(NumericVar *var);
 
 static int	cmp_numerics(Numeric num1, Numeric num2);
+static int	numeric_fast_cmp(Datum x, Datum y, SortSupport ssup);
 static int	cmp_var(NumericVar *var1, NumericVar *var2);
 static int cmp_var_common(const NumericDigit *var1digits, int var1ndigits,
 			   int var1weight, int var1sign,
@@ -1369,6 +1371,118 @@ numeric_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+static int
+numeric_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	Numeric		num1 = DatumGetNumeric(x);
+	Numeric		num2 = DatumGetNumeric(y);
+	int			result;
+
+	result = cmp_numerics(num1, num2);
+
+	if ((Pointer) num1 != DatumGetPointer(x))
+		pfree(num1);
+	if ((Pointer) num2 != DatumGetPointer(y))
+		pfree(num2);
+
+	return result;
+}
+
+/*
+ * Abbreviated keys for numeric pack the weight and the first four base-NBASE
+ * digits of the absolute value into a signed 64-bit integer, negated for
+ * negative values, so that comparing the integers gives the same order as
+ * comparing the numerics unless the integers are equal.  Bit 63 is left
+ * for the sign, bits 56-62 hold the weight offset by NUMERIC_ABBREV_BIAS,
+ * and each digit gets 14 bits below that.  Values too large to represent
+ * that way, and NaN, become the largest possible key; values too small
+ * become zero.  Either way, ties are settled by a full comparison.
+ *
+ * This needs 64-bit Datums and a 14-bit digit, so it's only done for the
+ * usual configuration of NBASE 10000 on 64-bit platforms.
+ */
+#if SIZEOF_DATUM == 8 && NBASE == 10000
+#define NUMERIC_ABBREV_SUPPORTED
+#define NUMERIC_ABBREV_BIAS		44
+#define NUMERIC_ABBREV_MAX		INT64CONST(0x7FFFFFFFFFFFFFFF)
+
+static int
+numeric_cmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	int64		a = (int64) x;
+	int64		b = (int64) y;
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
+static Datum
+numeric_abbrev_convert(Datum original, SortSupport ssup)
+{
+	Numeric		value = DatumGetNumeric(original);
+	int64		result;
+
+	if (NUMERIC_IS_NAN(value))
+		result = NUMERIC_ABBREV_MAX;
+	else
+	{
+		NumericDigit *digits = NUMERIC_DIGITS(value);
+		int			ndigits = NUMERIC_NDIGITS(value);
+		int			weight = NUMERIC_WEIGHT(value);
+
+		if (ndigits == 0 || weight < -NUMERIC_ABBREV_BIAS)
+			result = 0;
+		else if (weight > 127 - NUMERIC_ABBREV_BIAS)
+			result = NUMERIC_ABBREV_MAX;
+		else
+		{
+			result = ((int64) (weight + NUMERIC_ABBREV_BIAS)) << 56;
+			result |= ((int64) digits[0]) << 42;
+			if (ndigits > 1)
+				result |= ((int64) digits[1]) << 28;
+			if (ndigits > 2)
+				result |= ((int64) digits[2]) << 14;
+			if (ndigits > 3)
+				result |= (int64) digits[3];
+		}
+
+		if (NUMERIC_SIGN(value) == NUMERIC_NEG)
+			result = -result;
+	}
+
+	if ((Pointer) value != DatumGetPointer(original))
+		pfree(value);
+
+	return (Datum) result;
+}
+#endif   /* SIZEOF_DATUM == 8 && NBASE == 10000 */
+
+/*
+ * numeric_sortsupport - sort support function for btree
+ */
+Datum
+numeric_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = numeric_fast_cmp;
+
+#ifdef NUMERIC_ABBREV_SUPPORTED
+	if (ssup->abbreviate)
+	{
+		ssup->comparator = numeric_cmp_abbrev;
+		ssup->abbrev_converter = numeric_abbrev_convert;
+		ssup->abbrev_full_comparator = numeric_fast_cmp;
+	}
+#endif
+
+	PG_RETURN_VOID();
+}
+
 
 Datum
 numeric_eq(PG_FUNCTION_ARGS)
@@ -15,11 +15,14 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/xlog.h"
+#include "access/xlogprefetch.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "libpq/ip.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "storage/procarray.h"
 #include "utils/builtins.h"
 #include "utils/inet.h"
 #include "utils/timestamp.h"
@@ -89,6 +92,12 @@ extern Datum pg_stat_get_db_blk_write_time(PG_FUNCTION_ARGS);
 
 extern Datum pg_stat_get_archiver(PG_FUNCTION_ARGS);
 
+extern Datum pg_stat_get_prefetch_recovery(PG_FUNCTION_ARGS);
+
+extern Datum pg_stat_get_wal_flush_batches(PG_FUNCTION_ARGS);
+
+extern Datum pg_stat_get_snapshot_cache(PG_FUNCTION_ARGS);
+
 extern Datum pg_stat_get_bgwriter_timed_checkpoints(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_bgwriter_requested_checkpoints(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_checkpoint_write_time(PG_FUNCTION_ARGS);
@@ -1799,3 +1808,144 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(
 						heap_form_tuple(tupdesc, values, nulls)));
 }
+
+Datum
+pg_stat_get_prefetch_recovery(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[6];
+	bool		nulls[6];
+	XLogPrefetchStats stats;
+
+	/* Initialise values and NULL flags arrays */
+	MemSet(values, 0, sizeof(values));
+	MemSet(nulls, 0, sizeof(nulls));
+
+	/* Initialise attributes information in the tuple descriptor */
+	tupdesc = CreateTemplateTupleDesc(6, false);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "prefetch",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "skip_hit",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "skip_new",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "skip_fpw",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "skip_seq",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "distance",
+					   INT8OID, -1, 0);
+
+	BlessTupleDesc(tupdesc);
+
+	/* Get the counters of the startup process */
+	XLogPrefetchGetStats(&stats);
+
+	values[0] = Int64GetDatum((int64) stats.prefetch);
+	values[1] = Int64GetDatum((int64) stats.skip_hit);
+	values[2] = Int64GetDatum((int64) stats.skip_new);
+	values[3] = Int64GetDatum((int64) stats.skip_fpw);
+	values[4] = Int64GetDatum((int64) stats.skip_seq);
+	values[5] = Int64GetDatum((int64) stats.distance);
+
+	/* Returns the record as Datum */
+	PG_RETURN_DATUM(HeapTupleGetDatum(
+						heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Returns the histogram of WAL group flush batch sizes, one row per bucket.
+ */
+Datum
+pg_stat_get_wal_flush_batches(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	uint64	   *batches;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		tupdesc = CreateTemplateTupleDesc(3, false);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "min_batch_size",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 2, "max_batch_size",
+						   INT4OID, -1, 0);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 3, "flushes",
+						   INT8OID, -1, 0);
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* take a consistent snapshot of all the counters */
+		batches = palloc(XLOG_FLUSH_BATCH_BUCKETS * sizeof(uint64));
+		GetXLogFlushBatchStats(batches);
+		funcctx->user_fctx = batches;
+		funcctx->max_calls = XLOG_FLUSH_BATCH_BUCKETS;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	batches = (uint64 *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		int			i = funcctx->call_cntr;
+		Datum		values[3];
+		bool		nulls[3];
+		HeapTuple	tuple;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(1 << i);
+		/* the last bucket has no upper bound */
+		if (i < XLOG_FLUSH_BATCH_BUCKETS - 1)
+			values[1] = Int32GetDatum((2 << i) - 1);
+		else
+			nulls[1] = true;
+		values[2] = Int64GetDatum((int64) batches[i]);
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+	else
+		SRF_RETURN_DONE(funcctx);
+}
+
+Datum
+pg_stat_get_snapshot_cache(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[2];
+	bool		nulls[2];
+	uint64		hits;
+	uint64		misses;
+
+	/* Initialise values and NULL flags arrays */
+	MemSet(values, 0, sizeof(values));
+	MemSet(nulls, 0, sizeof(nulls));
+
+	/* Initialise attributes information in the tuple descriptor */
+	tupdesc = CreateTemplateTupleDesc(2, false);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "hits",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "misses",
+					   INT8OID, -1, 0);
+
+	BlessTupleDesc(tupdesc);
+
+	/* Sum up the counters of all backends */
+	GetSnapshotCacheStats(&hits, &misses);
+
+	values[0] = Int64GetDatum((int64) hits);
+	values[1] = Int64GetDatum((int64) misses);
+
+	/* Returns the record as Datum */
+	PG_RETURN_DATUM(HeapTupleGetDatum(
+						heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -30,6 +30,7 @@
 #include "catalog/pg_language.h"
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_partitioned_table.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
@@ -383,6 +384,7 @@ static void get_const_expr(Const *constval, deparse_context *context,
 			   int showtype);
 static void get_const_collation(Const *constval, deparse_context *context);
 static void simple_quote_literal(StringInfo buf, const char *val);
+static void get_partition_bound_datum(Node *datum, StringInfo buf);
 static void get_sublink_expr(SubLink *sublink, deparse_context *context);
 static void get_from_clause(Query *query, const char *prefix,
 				deparse_context *context);
@@ -1246,6 +1248,61 @@ pg_get_indexdef_worker(Oid indexrelid, int colno,
 	return buf.data;
 }
 
+/*
+ * pg_get_partkeydef
+ *
+ * Returns the partition key of a partitioned table, ie, everything that
+ * needs to appear after "PARTITION BY" in its CREATE TABLE.  Returns NULL
+ * if the table is not partitioned.
+ */
+Datum
+pg_get_partkeydef(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	HeapTuple	tuple;
+	Form_pg_partitioned_table form;
+	StringInfoData buf;
+	Oid			atttypid;
+	int32		atttypmod;
+	Oid			attcollation;
+
+	tuple = SearchSysCache1(PARTRELID, ObjectIdGetDatum(relid));
+	if (!HeapTupleIsValid(tuple))
+		PG_RETURN_NULL();
+	form = (Form_pg_partitioned_table) GETSTRUCT(tuple);
+
+	initStringInfo(&buf);
+	switch (form->partstrat)
+	{
+		case PARTITION_STRATEGY_LIST:
+			appendStringInfoString(&buf, "LIST");
+			break;
+		case PARTITION_STRATEGY_RANGE:
+			appendStringInfoString(&buf, "RANGE");
+			break;
+		default:
+			elog(ERROR, "unrecognized partitioning strategy: %d",
+				 (int) form->partstrat);
+	}
+
+	appendStringInfo(&buf, " (%s",
+					 quote_identifier(get_relid_attribute_name(relid,
+															 form->partattr)));
+	get_atttypetypmodcoll(relid, form->partattr,
+						  &atttypid, &atttypmod, &attcollation);
+
+	/* As for index columns, show collation and opclass if not default */
+	if (OidIsValid(form->partcollation) && form->partcollation != attcollation)
+		appendStringInfo(&buf, " COLLATE %s",
+						 generate_collation_name(form->partcollation));
+	get_opclass_name(form->partclass, atttypid, &buf);
+	appendStringInfoChar(&buf, ')');
+
+	ReleaseSysCache(tuple);
+
+	PG_RETURN_TEXT_P(string_to_text(buf.data));
+}
+
 
 /*
  * pg_get_constraintdef
@@ -3771,9 +3828,14 @@ set_deparse_planstate(deparse_namespace *dpns, PlanState *ps)
 	else
 		dpns->inner_tlist = NIL;
 
-	/* index_tlist is set only if it's an IndexOnlyScan */
+	/*
+	 * index_tlist is set only if it's an IndexOnlyScan, or a ForeignScan
+	 * that performs a join or aggregation remotely
+	 */
 	if (IsA(ps->plan, IndexOnlyScan))
 		dpns->index_tlist = ((IndexOnlyScan *) ps->plan)->indextlist;
+	else if (IsA(ps->plan, ForeignScan))
+		dpns->index_tlist = ((ForeignScan *) ps->plan)->fdw_scan_tlist;
 	else
 		dpns->index_tlist = NIL;
 }
@@ -7385,6 +7447,41 @@ get_rule_expr(Node *node, deparse_context *context,
 			}
 			break;
 
+		case T_PartitionBoundSpec:
+			{
+				PartitionBoundSpec *spec = (PartitionBoundSpec *) node;
+				ListCell   *cell;
+				char	   *sep;
+
+				switch (spec->strategy)
+				{
+					case PARTITION_STRATEGY_LIST:
+						appendStringInfoString(buf, "FOR VALUES IN (");
+						sep = "";
+						foreach(cell, spec->listdatums)
+						{
+							appendStringInfoString(buf, sep);
+							get_partition_bound_datum(lfirst(cell), buf);
+							sep = ", ";
+						}
+						appendStringInfoChar(buf, ')');
+						break;
+
+					case PARTITION_STRATEGY_RANGE:
+						appendStringInfoString(buf, "FOR VALUES FROM (");
+						get_partition_bound_datum(spec->lowerdatum, buf);
+						appendStringInfoString(buf, ") TO (");
+						get_partition_bound_datum(spec->upperdatum, buf);
+						appendStringInfoChar(buf, ')');
+						break;
+
+					default:
+						elog(ERROR, "unrecognized partitioning strategy: %d",
+							 (int) spec->strategy);
+				}
+			}
+			break;
+
 		case T_List:
 			{
 				char	   *sep;
@@ -7905,6 +8002,62 @@ get_const_collation(Const *constval, deparse_context *context)
 	}
 }
 
+/*
+ * get_partition_bound_datum - deparse one value of a partition bound
+ *
+ * The FOR VALUES grammar accepts only plain numbers, string literals, NULL
+ * and UNBOUNDED (a NULL pointer here), so unlike get_const_expr we never
+ * decorate the value; the literal is coerced to the key's type on input.
+ */
+static void
+get_partition_bound_datum(Node *datum, StringInfo buf)
+{
+	Const	   *con;
+	Oid			typoutput;
+	bool		typIsVarlena;
+	char	   *extval;
+
+	if (datum == NULL)
+	{
+		appendStringInfoString(buf, "UNBOUNDED");
+		return;
+	}
+
+	con = (Const *) datum;
+	Assert(IsA(con, Const));
+	if (con->constisnull)
+	{
+		appendStringInfoString(buf, "NULL");
+		return;
+	}
+
+	getTypeOutputInfo(con->consttype, &typoutput, &typIsVarlena);
+	extval = OidOutputFunctionCall(typoutput, con->constvalue);
+
+	switch (con->consttype)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case OIDOID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+			/* as in get_const_expr, but a sign needs no parentheses */
+			if (strspn(extval, "0123456789+-eE.") == strlen(extval))
+			{
+				appendStringInfoString(buf, extval);
+				break;
+			}
+			/* FALL THRU */
+		default:
+			simple_quote_literal(buf, extval);
+			break;
+	}
+
+	pfree(extval);
+}
+
 /*
  * simple_quote_literal - Format a string as a SQL literal, append to buf
  */
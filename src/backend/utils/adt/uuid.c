@@ -16,6 +16,7 @@
 #include "access/hash.h"
 #include "libpq/pqformat.h"
 #include "utils/builtins.h"
+#include "utils/sortsupport.h"
 #include "utils/uuid.h"
 
 /* uuid size in bytes */
@@ -29,6 +30,9 @@ struct pg_uuid_t
 
 static void string_to_uuid(const char *source, pg_uuid_t *uuid);
 static int	uuid_internal_cmp(const pg_uuid_t *arg1, const pg_uuid_t *arg2);
+static int	uuid_fast_cmp(Datum x, Datum y, SortSupport ssup);
+static int	uuid_cmp_abbrev(Datum x, Datum y, SortSupport ssup);
+static Datum uuid_abbrev_convert(Datum original, SortSupport ssup);
 
 Datum
 uuid_in(PG_FUNCTION_ARGS)
@@ -222,6 +226,58 @@ uuid_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(uuid_internal_cmp(arg1, arg2));
 }
 
+static int
+uuid_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	return uuid_internal_cmp(DatumGetUUIDP(x), DatumGetUUIDP(y));
+}
+
+/*
+ * Abbreviated keys are the leading bytes of the uuid, packed into a Datum
+ * so that comparing them as unsigned integers matches memcmp() order.
+ */
+static int
+uuid_cmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	if (x > y)
+		return 1;
+	else if (x == y)
+		return 0;
+	else
+		return -1;
+}
+
+static Datum
+uuid_abbrev_convert(Datum original, SortSupport ssup)
+{
+	pg_uuid_t  *uuid = DatumGetUUIDP(original);
+	Datum		res = 0;
+	int			i;
+
+	for (i = 0; i < sizeof(Datum); i++)
+		res = (res << 8) | uuid->data[i];
+
+	return res;
+}
+
+/* sort support function for btree */
+Datum
+uuid_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	if (ssup->abbreviate)
+	{
+		ssup->comparator = uuid_cmp_abbrev;
+		ssup->abbrev_converter = uuid_abbrev_convert;
+		ssup->abbrev_full_comparator = uuid_fast_cmp;
+	}
+	else
+		ssup->comparator = uuid_fast_cmp;
+
+	PG_RETURN_VOID();
+}
+
 /* hash index support */
 Datum
 uuid_hash(PG_FUNCTION_ARGS)
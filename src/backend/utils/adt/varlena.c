@@ -16,7 +16,9 @@
 
 #include <ctype.h>
 #include <limits.h>
+#include <math.h>
 
+#include "access/hash.h"
 #include "access/tuptoaster.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
@@ -28,7 +30,9 @@
 #include "utils/builtins.h"
 #include "utils/bytea.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/pg_locale.h"
+#include "utils/sortsupport.h"
 
 
 /* GUC variable */
@@ -1684,6 +1688,242 @@ bttextcmp(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Sort support for text, with abbreviated keys.
+ *
+ * The abbreviated key of a text value is its first sizeof(Datum) bytes in
+ * the C locale, or else the first sizeof(Datum) bytes of its strxfrm()
+ * image, packed into a Datum so that comparing keys as unsigned integers
+ * matches memcmp() order.  Shorter strings are padded with zero bytes,
+ * which sort before any real byte, and strxfrm() images compare with
+ * memcmp() the same way strcoll() compares the original strings.  So
+ * unequal keys decide the comparison, and equal keys need a full
+ * comparison with varstr_cmp().
+ *
+ * strxfrm() is not cheap, and the keys don't help if many distinct values
+ * share a prefix, so we keep a rough count of distinct keys and distinct
+ * values (using linear counting over a small bitmap) and tell tuplesort to
+ * give up on abbreviation if the keys distinguish too few of the values.
+ */
+#define TEXT_ABBREV_DISTINCT_BITS	4096
+#define TEXTBUFLEN					1024
+
+typedef struct
+{
+	bool		collate_c;		/* use memcmp() order? */
+#ifdef HAVE_LOCALE_T
+	pg_locale_t locale;			/* collation's locale, or 0 for default */
+#endif
+	char	   *buf;			/* NUL-terminated copy of current value */
+	int			buflen;
+	char	   *xfrm;			/* strxfrm() image of current value */
+	int			xfrmlen;
+	/* bitmaps for estimating the number of distinct keys and values */
+	uint8		abbr_seen[TEXT_ABBREV_DISTINCT_BITS / BITS_PER_BYTE];
+	uint8		full_seen[TEXT_ABBREV_DISTINCT_BITS / BITS_PER_BYTE];
+} TextSortSupport;
+
+static int	bttextfastcmp(Datum x, Datum y, SortSupport ssup);
+static int	bttextcmp_abbrev(Datum x, Datum y, SortSupport ssup);
+static Datum bttext_abbrev_convert(Datum original, SortSupport ssup);
+static bool bttext_abbrev_abort(int memtupcount, SortSupport ssup);
+
+Datum
+bttextsortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+	Oid			collid = ssup->ssup_collation;
+	TextSortSupport *tss;
+
+	ssup->comparator = bttextfastcmp;
+
+	if (!ssup->abbreviate)
+		PG_RETURN_VOID();
+
+	/*
+	 * Leave it to the comparator to complain about a missing collation, so
+	 * that we fail in just the same cases as without abbreviation.
+	 */
+	if (!lc_collate_is_c(collid) &&
+		collid != DEFAULT_COLLATION_OID && !OidIsValid(collid))
+		PG_RETURN_VOID();
+
+#ifdef WIN32
+	/* varstr_cmp() compares UTF-16 with wcscoll() there; don't try to match */
+	if (!lc_collate_is_c(collid) && GetDatabaseEncoding() == PG_UTF8)
+		PG_RETURN_VOID();
+#endif
+
+	tss = (TextSortSupport *) MemoryContextAllocZero(ssup->ssup_cxt,
+													 sizeof(TextSortSupport));
+	tss->collate_c = lc_collate_is_c(collid);
+#ifdef HAVE_LOCALE_T
+	if (!tss->collate_c && collid != DEFAULT_COLLATION_OID)
+		tss->locale = pg_newlocale_from_collation(collid);
+#endif
+	if (!tss->collate_c)
+	{
+		tss->buflen = TEXTBUFLEN;
+		tss->buf = MemoryContextAlloc(ssup->ssup_cxt, tss->buflen);
+		tss->xfrmlen = TEXTBUFLEN;
+		tss->xfrm = MemoryContextAlloc(ssup->ssup_cxt, tss->xfrmlen);
+	}
+
+	ssup->ssup_extra = tss;
+	ssup->comparator = bttextcmp_abbrev;
+	ssup->abbrev_converter = bttext_abbrev_convert;
+	ssup->abbrev_abort = bttext_abbrev_abort;
+	ssup->abbrev_full_comparator = bttextfastcmp;
+
+	PG_RETURN_VOID();
+}
+
+static int
+bttextfastcmp(Datum x, Datum y, SortSupport ssup)
+{
+	text	   *arg1 = DatumGetTextPP(x);
+	text	   *arg2 = DatumGetTextPP(y);
+	int			result;
+
+	result = text_cmp(arg1, arg2, ssup->ssup_collation);
+
+	if ((Pointer) arg1 != DatumGetPointer(x))
+		pfree(arg1);
+	if ((Pointer) arg2 != DatumGetPointer(y))
+		pfree(arg2);
+
+	return result;
+}
+
+static int
+bttextcmp_abbrev(Datum x, Datum y, SortSupport ssup)
+{
+	if (x > y)
+		return 1;
+	else if (x == y)
+		return 0;
+	else
+		return -1;
+}
+
+static Datum
+bttext_abbrev_convert(Datum original, SortSupport ssup)
+{
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+	text	   *authoritative = DatumGetTextPP(original);
+	char	   *data = VARDATA_ANY(authoritative);
+	int			len = VARSIZE_ANY_EXHDR(authoritative);
+	char	   *key;
+	Size		keylen;
+	Datum		res = 0;
+	uint32		hash;
+	int			i;
+
+	if (tss->collate_c)
+	{
+		key = data;
+		keylen = len;
+	}
+	else
+	{
+		/* strxfrm() wants a NUL-terminated string */
+		if (len >= tss->buflen)
+		{
+			pfree(tss->buf);
+			tss->buflen = Max(len + 1, Min(tss->buflen * 2, MaxAllocSize));
+			tss->buf = MemoryContextAlloc(ssup->ssup_cxt, tss->buflen);
+		}
+		memcpy(tss->buf, data, len);
+		tss->buf[len] = '\0';
+
+		/* the image must be complete, or its contents are undefined */
+		for (;;)
+		{
+#ifdef HAVE_LOCALE_T
+			if (tss->locale)
+				keylen = strxfrm_l(tss->xfrm, tss->buf, tss->xfrmlen,
+								   tss->locale);
+			else
+#endif
+				keylen = strxfrm(tss->xfrm, tss->buf, tss->xfrmlen);
+
+			if (keylen < tss->xfrmlen)
+				break;
+
+			pfree(tss->xfrm);
+			tss->xfrmlen = Max(keylen + 1, Min(tss->xfrmlen * 2, MaxAllocSize));
+			tss->xfrm = MemoryContextAlloc(ssup->ssup_cxt, tss->xfrmlen);
+		}
+		key = tss->xfrm;
+	}
+
+	for (i = 0; i < sizeof(Datum); i++)
+	{
+		res <<= 8;
+		if (i < keylen)
+			res |= (unsigned char) key[i];
+	}
+
+	/* Remember what we've seen, for bttext_abbrev_abort */
+	hash = DatumGetUInt32(hash_any((unsigned char *) &res, sizeof(Datum)));
+	hash %= TEXT_ABBREV_DISTINCT_BITS;
+	tss->abbr_seen[hash / BITS_PER_BYTE] |= 1 << (hash % BITS_PER_BYTE);
+	hash = DatumGetUInt32(hash_any((unsigned char *) data, len));
+	hash %= TEXT_ABBREV_DISTINCT_BITS;
+	tss->full_seen[hash / BITS_PER_BYTE] |= 1 << (hash % BITS_PER_BYTE);
+
+	if ((Pointer) authoritative != DatumGetPointer(original))
+		pfree(authoritative);
+
+	return res;
+}
+
+/*
+ * Linear-counting estimate of the number of distinct values whose hashes
+ * were recorded in the given bitmap.
+ */
+static double
+text_abbrev_estimate_distinct(const uint8 *seen)
+{
+	int			zeroes = 0;
+	int			i;
+
+	for (i = 0; i < TEXT_ABBREV_DISTINCT_BITS; i++)
+	{
+		if ((seen[i / BITS_PER_BYTE] & (1 << (i % BITS_PER_BYTE))) == 0)
+			zeroes++;
+	}
+
+	/* a full bitmap just means "lots" */
+	if (zeroes == 0)
+		zeroes = 1;
+
+	return -TEXT_ABBREV_DISTINCT_BITS *
+		log((double) zeroes / TEXT_ABBREV_DISTINCT_BITS);
+}
+
+static bool
+bttext_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+	double		abbr_card;
+	double		full_card;
+
+	/* Too early to tell */
+	if (memtupcount < 100)
+		return false;
+
+	abbr_card = text_abbrev_estimate_distinct(tss->abbr_seen);
+	full_card = text_abbrev_estimate_distinct(tss->full_seen);
+
+	/*
+	 * Give up if fewer than half of the distinct values can be told apart by
+	 * their abbreviated keys; every comparison among the rest costs the
+	 * conversion plus a full comparison.
+	 */
+	return abbr_card < full_card * 0.5;
+}
+
 Datum
 text_larger(PG_FUNCTION_ARGS)
 {
@@ -1916,6 +1916,8 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 		MemoryContextDelete(relation->rd_rulescxt);
 	if (relation->rd_fdwroutine)
 		pfree(relation->rd_fdwroutine);
+	if (relation->rd_partcxt)
+		MemoryContextDelete(relation->rd_partcxt);
 	pfree(relation);
 }
 
@@ -4609,7 +4611,8 @@ load_relcache_init_file(bool shared)
 		 * format is complex and subject to change).  They must be rebuilt if
 		 * needed by RelationCacheInitializePhase3.  This is not expected to
 		 * be a big performance hit since few system catalogs have such. Ditto
-		 * for index expressions, predicates, exclusion info, and FDW info.
+		 * for index expressions, predicates, exclusion info, FDW info, and
+		 * partitioning info.
 		 */
 		rel->rd_rules = NULL;
 		rel->rd_rulescxt = NULL;
@@ -4620,6 +4623,10 @@ load_relcache_init_file(bool shared)
 		rel->rd_exclprocs = NULL;
 		rel->rd_exclstrats = NULL;
 		rel->rd_fdwroutine = NULL;
+		rel->rd_partcxt = NULL;
+		rel->rd_partkeyvalid = false;
+		rel->rd_partkey = NULL;
+		rel->rd_partdesc = NULL;
 
 		/*
 		 * Reset transient-state fields in the relcache entry
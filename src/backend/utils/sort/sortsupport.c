@@ -18,6 +18,7 @@
 /* See sortsupport.h */
 #define SORTSUPPORT_INCLUDE_DEFINITIONS
 
+#include "access/nbtree.h"
 #include "fmgr.h"
 #include "utils/lsyscache.h"
 #include "utils/sortsupport.h"
@@ -88,8 +89,10 @@ PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup)
  * Fill in SortSupport given an ordering operator (btree "<" or ">" operator).
  *
  * Caller must previously have zeroed the SortSupportData structure and then
- * filled in ssup_cxt, ssup_collation, and ssup_nulls_first.  This will fill
- * in ssup_reverse as well as the comparator function pointer.
+ * filled in ssup_cxt, ssup_collation, and ssup_nulls_first, as well as
+ * abbreviate if it can use abbreviated keys.  This will fill in ssup_reverse
+ * as well as the comparator function pointer, and the abbreviated key
+ * support functions if the opclass provides them.
  */
 void
 PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup)
@@ -116,3 +119,38 @@ PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup)
 		PrepareSortSupportComparisonShim(sortFunction, ssup);
 	}
 }
+
+/*
+ * Fill in SortSupport given a btree index column's operator family and
+ * input type, for sorting in the column's ascending order.
+ *
+ * Caller must previously have zeroed the SortSupportData structure and then
+ * filled in ssup_cxt, ssup_collation, ssup_reverse and ssup_nulls_first, as
+ * well as abbreviate if it can use abbreviated keys.  This will fill in the
+ * comparator function pointer, and the abbreviated key support functions if
+ * the opclass provides them.
+ */
+void
+PrepareSortSupportFromIndexKey(Oid opfamily, Oid opcintype,
+							   SortSupport ssup)
+{
+	Oid			sortFunction;
+
+	sortFunction = get_opfamily_proc(opfamily, opcintype, opcintype,
+									 BTSORTSUPPORT_PROC);
+	if (OidIsValid(sortFunction))
+	{
+		/* The sort support function should provide a comparator */
+		OidFunctionCall1(sortFunction, PointerGetDatum(ssup));
+		Assert(ssup->comparator != NULL);
+		return;
+	}
+
+	/* We'll use a shim to call the old-style btree comparator */
+	sortFunction = get_opfamily_proc(opfamily, opcintype, opcintype,
+									 BTORDER_PROC);
+	if (!OidIsValid(sortFunction))
+		elog(ERROR, "missing support function %d(%u,%u) in opfamily %u",
+			 BTORDER_PROC, opcintype, opcintype, opfamily);
+	PrepareSortSupportComparisonShim(sortFunction, ssup);
+}
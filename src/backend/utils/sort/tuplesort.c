@@ -341,11 +341,20 @@ struct Tuplesortstate
 
 	/*
 	 * These variables are specific to the MinimalTuple case; they are set by
-	 * tuplesort_begin_heap and used only by the MinimalTuple routines.
+	 * tuplesort_begin_heap and used only by the MinimalTuple routines.  The
+	 * IndexTuple routines also use tupDesc, for the index tuple descriptor.
 	 */
 	TupleDesc	tupDesc;
 	SortSupport sortKeys;		/* array of length nKeys */
 
+	/*
+	 * If the leading sort key uses abbreviated keys, datum1 of each
+	 * in-memory SortTuple holds the abbreviated key rather than the original
+	 * value.  abbrevNext is the tuple count at which we next consider
+	 * whether abbreviation is paying off.
+	 */
+	int			abbrevNext;
+
 	/*
 	 * This variable is shared by the single-key MinimalTuple case and the
 	 * Datum case (which both use qsort_ssup()).  Otherwise it's NULL.
@@ -363,11 +372,18 @@ struct Tuplesortstate
 	/*
 	 * These variables are specific to the IndexTuple case; they are set by
 	 * tuplesort_begin_index_xxx and used only by the IndexTuple routines.
+	 * indexRel is NULL when sorting for a parallel btree build worker, which
+	 * has no relcache entry for the index being built.
 	 */
 	Relation	heapRel;		/* table the index is being built on */
 	Relation	indexRel;		/* index being built */
 
-	/* These are specific to the index_btree subcase: */
+	/*
+	 * These are specific to the index_btree subcase.  If the leading column's
+	 * opclass supports abbreviated keys, sortKeys points to a single
+	 * SortSupport for that column, and comparetup_index_btree uses it in
+	 * place of the first scankey for as long as abbreviation is in use.
+	 */
 	ScanKey		indexScanKey;
 	bool		enforceUnique;	/* complain if we find duplicate tuples */
 
@@ -474,6 +490,7 @@ static void writetup_heap(Tuplesortstate *state, int tapenum,
 static void readtup_heap(Tuplesortstate *state, SortTuple *stup,
 			 int tapenum, unsigned int len);
 static void reversedirection_heap(Tuplesortstate *state);
+static bool consider_abort_common(Tuplesortstate *state);
 static int comparetup_cluster(const SortTuple *a, const SortTuple *b,
 				   Tuplesortstate *state);
 static void copytup_cluster(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -491,6 +508,8 @@ static void writetup_index(Tuplesortstate *state, int tapenum,
 static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 			  int tapenum, unsigned int len);
 static void reversedirection_index_btree(Tuplesortstate *state);
+static void prepare_index_btree_abbrev(Tuplesortstate *state,
+						   Oid opfamily, Oid opcintype);
 static void reversedirection_index_hash(Tuplesortstate *state);
 static int comparetup_datum(const SortTuple *a, const SortTuple *b,
 				 Tuplesortstate *state);
@@ -647,11 +666,19 @@ tuplesort_begin_heap(TupleDesc tupDesc,
 		sortKey->ssup_collation = sortCollations[i];
 		sortKey->ssup_nulls_first = nullsFirstFlags[i];
 		sortKey->ssup_attno = attNums[i];
+		/* Only the leading key, which is kept in datum1, is abbreviated */
+		sortKey->abbreviate = (i == 0);
 
 		PrepareSortSupportFromOrderingOp(sortOperators[i], sortKey);
 	}
 
-	if (nkeys == 1)
+	state->abbrevNext = 10;
+
+	/*
+	 * The "onlyKey" optimization cannot be used with abbreviated keys, since
+	 * ties between abbreviated keys have to be broken by a full comparison.
+	 */
+	if (nkeys == 1 && state->sortKeys->abbrev_converter == NULL)
 		state->onlyKey = state->sortKeys;
 
 	MemoryContextSwitchTo(oldcontext);
@@ -753,11 +780,68 @@ tuplesort_begin_index_btree(Relation heapRel,
 	state->readtup = readtup_index;
 	state->reversedirection = reversedirection_index_btree;
 
+	state->tupDesc = RelationGetDescr(indexRel);
 	state->heapRel = heapRel;
 	state->indexRel = indexRel;
 	state->indexScanKey = _bt_mkscankey_nodata(indexRel);
 	state->enforceUnique = enforceUnique;
 
+	prepare_index_btree_abbrev(state, indexRel->rd_opfamily[0],
+							   indexRel->rd_opcintype[0]);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Like tuplesort_begin_index_btree, but the index is described by its tuple
+ * descriptor and sort scankeys (as built by _bt_mkscankey_nodata) rather
+ * than by a relcache entry.  This is used by parallel btree build workers.
+ * Uniqueness cannot be enforced this way.  The scankeys are not copied;
+ * they must outlive the sort.  The leading column's operator family and
+ * input type are needed to look up its abbreviated key support.
+ */
+Tuplesortstate *
+tuplesort_begin_index_btree_scankeys(TupleDesc tupDesc,
+									 int nkeys, ScanKey indexScanKey,
+									 Oid leadopfamily, Oid leadopcintype,
+									 int workMem, bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, randomAccess);
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: nkeys = %d, workMem = %d, randomAccess = %c",
+			 nkeys, workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = nkeys;
+
+	TRACE_POSTGRESQL_SORT_START(INDEX_SORT,
+								false,
+								state->nKeys,
+								workMem,
+								randomAccess);
+
+	state->comparetup = comparetup_index_btree;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index;
+	state->reversedirection = reversedirection_index_btree;
+
+	state->tupDesc = tupDesc;
+	state->heapRel = NULL;
+	state->indexRel = NULL;
+	state->indexScanKey = indexScanKey;
+	state->enforceUnique = false;
+
+	prepare_index_btree_abbrev(state, leadopfamily, leadopcintype);
+
 	MemoryContextSwitchTo(oldcontext);
 
 	return state;
@@ -790,6 +874,7 @@ tuplesort_begin_index_hash(Relation heapRel,
 	state->readtup = readtup_index;
 	state->reversedirection = reversedirection_index_hash;
 
+	state->tupDesc = RelationGetDescr(indexRel);
 	state->heapRel = heapRel;
 	state->indexRel = indexRel;
 
@@ -1975,6 +2060,18 @@ mergeruns(Tuplesortstate *state)
 	Assert(state->status == TSS_BUILDRUNS);
 	Assert(state->memtupcount == 0);
 
+	/*
+	 * readtup routines don't reconstruct abbreviated keys for the tuples they
+	 * read back from tape, so stop using abbreviation from here on.
+	 */
+	if (state->sortKeys != NULL && state->sortKeys->abbrev_converter != NULL)
+	{
+		state->sortKeys->comparator = state->sortKeys->abbrev_full_comparator;
+		state->sortKeys->abbrev_converter = NULL;
+		state->sortKeys->abbrev_abort = NULL;
+		state->sortKeys->abbrev_full_comparator = NULL;
+	}
+
 	/*
 	 * If we produced only one initial run (quite likely if the total data
 	 * volume is between 1X and 2X workMem), we can just use that tape as the
@@ -2843,6 +2940,48 @@ inlineApplySortFunction(FmgrInfo *sortFunction, int sk_flags, Oid collation,
 }
 
 
+/*
+ * Decide whether to give up on abbreviated keys for the leading sort key,
+ * because they're not distinguishing tuples well enough to be worth the
+ * conversion cost.  We only consider this while the whole input still fits
+ * in memory, checking at exponentially spaced tuple counts.  If we do give
+ * up, the caller must replace the abbreviated keys already stored in datum1
+ * with the original values.
+ */
+static bool
+consider_abort_common(Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+
+	Assert(sortKey->abbrev_converter != NULL);
+	Assert(sortKey->abbrev_full_comparator != NULL);
+
+	if (sortKey->abbrev_abort == NULL ||
+		state->status != TSS_INITIAL ||
+		state->memtupcount < state->abbrevNext)
+		return false;
+
+	state->abbrevNext *= 2;
+
+	if (!sortKey->abbrev_abort(state->memtupcount, sortKey))
+		return false;
+
+	/* Switch over to comparing the original values */
+	sortKey->comparator = sortKey->abbrev_full_comparator;
+	sortKey->abbrev_converter = NULL;
+	sortKey->abbrev_abort = NULL;
+	sortKey->abbrev_full_comparator = NULL;
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG, "aborted abbreviated keys after %d tuples",
+			 state->memtupcount);
+#endif
+
+	return true;
+}
+
+
 /*
  * Routines specialized for HeapTuple (actually MinimalTuple) case
  */
@@ -2864,12 +3003,32 @@ comparetup_heap(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
 	if (compare != 0)
 		return compare;
 
-	/* Compare additional sort keys */
 	ltup.t_len = ((MinimalTuple) a->tuple)->t_len + MINIMAL_TUPLE_OFFSET;
 	ltup.t_data = (HeapTupleHeader) ((char *) a->tuple - MINIMAL_TUPLE_OFFSET);
 	rtup.t_len = ((MinimalTuple) b->tuple)->t_len + MINIMAL_TUPLE_OFFSET;
 	rtup.t_data = (HeapTupleHeader) ((char *) b->tuple - MINIMAL_TUPLE_OFFSET);
 	tupDesc = state->tupDesc;
+
+	/* Equal abbreviated keys only mean we must compare the original values */
+	if (sortKey->abbrev_converter != NULL)
+	{
+		AttrNumber	attno = sortKey->ssup_attno;
+		Datum		datum1,
+					datum2;
+		bool		isnull1,
+					isnull2;
+
+		datum1 = heap_getattr(&ltup, attno, tupDesc, &isnull1);
+		datum2 = heap_getattr(&rtup, attno, tupDesc, &isnull2);
+
+		compare = ApplySortAbbrevFullComparator(datum1, isnull1,
+												datum2, isnull2,
+												sortKey);
+		if (compare != 0)
+			return compare;
+	}
+
+	/* Compare additional sort keys */
 	sortKey++;
 	for (nkey = 1; nkey < state->nKeys; nkey++, sortKey++)
 	{
@@ -2902,6 +3061,8 @@ copytup_heap(Tuplesortstate *state, SortTuple *stup, void *tup)
 	TupleTableSlot *slot = (TupleTableSlot *) tup;
 	MinimalTuple tuple;
 	HeapTupleData htup;
+	Datum		original;
+	int			i;
 
 	/* copy the tuple into sort storage */
 	tuple = ExecCopySlotMinimalTuple(slot);
@@ -2910,10 +3071,48 @@ copytup_heap(Tuplesortstate *state, SortTuple *stup, void *tup)
 	/* set up first-column key value */
 	htup.t_len = tuple->t_len + MINIMAL_TUPLE_OFFSET;
 	htup.t_data = (HeapTupleHeader) ((char *) tuple - MINIMAL_TUPLE_OFFSET);
-	stup->datum1 = heap_getattr(&htup,
-								state->sortKeys[0].ssup_attno,
-								state->tupDesc,
-								&stup->isnull1);
+	original = heap_getattr(&htup,
+							state->sortKeys[0].ssup_attno,
+							state->tupDesc,
+							&stup->isnull1);
+
+	if (state->sortKeys->abbrev_converter == NULL || stup->isnull1)
+	{
+		/* Store the original value, or a NULL */
+		stup->datum1 = original;
+	}
+	else if (!consider_abort_common(state))
+	{
+		/* Store the abbreviated key */
+		stup->datum1 = state->sortKeys->abbrev_converter(original,
+														 state->sortKeys);
+	}
+	else
+	{
+		/*
+		 * We just gave up on abbreviation, so put back the original values
+		 * for all the tuples we've already got.  The single-key fast path
+		 * is usable after all.
+		 */
+		stup->datum1 = original;
+
+		if (state->nKeys == 1)
+			state->onlyKey = state->sortKeys;
+
+		for (i = 0; i < state->memtupcount; i++)
+		{
+			SortTuple  *mtup = &state->memtuples[i];
+
+			htup.t_len = ((MinimalTuple) mtup->tuple)->t_len +
+				MINIMAL_TUPLE_OFFSET;
+			htup.t_data = (HeapTupleHeader) ((char *) mtup->tuple -
+											 MINIMAL_TUPLE_OFFSET);
+			mtup->datum1 = heap_getattr(&htup,
+										state->sortKeys[0].ssup_attno,
+										state->tupDesc,
+										&mtup->isnull1);
+		}
+	}
 }
 
 static void
@@ -3186,23 +3385,56 @@ comparetup_index_btree(const SortTuple *a, const SortTuple *b,
 	int			nkey;
 	int32		compare;
 
+	tuple1 = (IndexTuple) a->tuple;
+	tuple2 = (IndexTuple) b->tuple;
+	keysz = state->nKeys;
+	tupDes = state->tupDesc;
+
 	/* Compare the leading sort key */
-	compare = inlineApplySortFunction(&scanKey->sk_func, scanKey->sk_flags,
-									  scanKey->sk_collation,
-									  a->datum1, a->isnull1,
-									  b->datum1, b->isnull1);
-	if (compare != 0)
-		return compare;
+	if (state->sortKeys != NULL && state->sortKeys->abbrev_converter != NULL)
+	{
+		SortSupport sortKey = state->sortKeys;
+
+		compare = ApplySortComparator(a->datum1, a->isnull1,
+									  b->datum1, b->isnull1,
+									  sortKey);
+		if (compare != 0)
+			return compare;
+
+		/* Equal abbreviated keys only mean we must compare the originals */
+		if (!a->isnull1)
+		{
+			Datum		datum1,
+						datum2;
+			bool		isnull1,
+						isnull2;
+
+			datum1 = index_getattr(tuple1, 1, tupDes, &isnull1);
+			datum2 = index_getattr(tuple2, 1, tupDes, &isnull2);
+
+			compare = ApplySortAbbrevFullComparator(datum1, isnull1,
+													datum2, isnull2,
+													sortKey);
+			if (compare != 0)
+				return compare;
+		}
+	}
+	else
+	{
+		compare = inlineApplySortFunction(&scanKey->sk_func,
+										  scanKey->sk_flags,
+										  scanKey->sk_collation,
+										  a->datum1, a->isnull1,
+										  b->datum1, b->isnull1);
+		if (compare != 0)
+			return compare;
+	}
 
 	/* they are equal, so we only need to examine one null flag */
 	if (a->isnull1)
 		equal_hasnull = true;
 
 	/* Compare additional sort keys */
-	tuple1 = (IndexTuple) a->tuple;
-	tuple2 = (IndexTuple) b->tuple;
-	keysz = state->nKeys;
-	tupDes = RelationGetDescr(state->indexRel);
 	scanKey++;
 	for (nkey = 2; nkey <= keysz; nkey++, scanKey++)
 	{
@@ -3338,6 +3570,8 @@ copytup_index(Tuplesortstate *state, SortTuple *stup, void *tup)
 	IndexTuple	tuple = (IndexTuple) tup;
 	unsigned int tuplen = IndexTupleSize(tuple);
 	IndexTuple	newtuple;
+	Datum		original;
+	int			i;
 
 	/* copy the tuple into sort storage */
 	newtuple = (IndexTuple) palloc(tuplen);
@@ -3345,10 +3579,42 @@ copytup_index(Tuplesortstate *state, SortTuple *stup, void *tup)
 	USEMEM(state, GetMemoryChunkSpace(newtuple));
 	stup->tuple = (void *) newtuple;
 	/* set up first-column key value */
-	stup->datum1 = index_getattr(newtuple,
-								 1,
-								 RelationGetDescr(state->indexRel),
-								 &stup->isnull1);
+	original = index_getattr(newtuple,
+							 1,
+							 state->tupDesc,
+							 &stup->isnull1);
+
+	if (state->sortKeys == NULL ||
+		state->sortKeys->abbrev_converter == NULL || stup->isnull1)
+	{
+		/* Store the original value, or a NULL */
+		stup->datum1 = original;
+	}
+	else if (!consider_abort_common(state))
+	{
+		/* Store the abbreviated key */
+		stup->datum1 = state->sortKeys->abbrev_converter(original,
+														 state->sortKeys);
+	}
+	else
+	{
+		/*
+		 * We just gave up on abbreviation, so put back the original values
+		 * for all the tuples we've already got.  From now on the leading
+		 * key is compared through its scankey again.
+		 */
+		stup->datum1 = original;
+
+		for (i = 0; i < state->memtupcount; i++)
+		{
+			SortTuple  *mtup = &state->memtuples[i];
+
+			mtup->datum1 = index_getattr((IndexTuple) mtup->tuple,
+										 1,
+										 state->tupDesc,
+										 &mtup->isnull1);
+		}
+	}
 }
 
 static void
@@ -3387,7 +3653,7 @@ readtup_index(Tuplesortstate *state, SortTuple *stup,
 	/* set up first-column key value */
 	stup->datum1 = index_getattr(tuple,
 								 1,
-								 RelationGetDescr(state->indexRel),
+								 state->tupDesc,
 								 &stup->isnull1);
 }
 
@@ -3401,6 +3667,45 @@ reversedirection_index_btree(Tuplesortstate *state)
 	{
 		scanKey->sk_flags ^= (SK_BT_DESC | SK_BT_NULLS_FIRST);
 	}
+
+	if (state->sortKeys != NULL)
+	{
+		state->sortKeys->ssup_reverse = !state->sortKeys->ssup_reverse;
+		state->sortKeys->ssup_nulls_first = !state->sortKeys->ssup_nulls_first;
+	}
+}
+
+/*
+ * Set up abbreviated keys for the leading column of a btree index sort, if
+ * its opclass supports them.  The column's scankey must already be set up;
+ * it supplies the collation and sort order.
+ */
+static void
+prepare_index_btree_abbrev(Tuplesortstate *state,
+						   Oid opfamily, Oid opcintype)
+{
+	ScanKey		scanKey = state->indexScanKey;
+	SortSupport sortKey;
+
+	sortKey = (SortSupport) palloc0(sizeof(SortSupportData));
+	sortKey->ssup_cxt = CurrentMemoryContext;
+	sortKey->ssup_collation = scanKey->sk_collation;
+	sortKey->ssup_reverse = (scanKey->sk_flags & SK_BT_DESC) != 0;
+	sortKey->ssup_nulls_first = (scanKey->sk_flags & SK_BT_NULLS_FIRST) != 0;
+	sortKey->ssup_attno = 1;
+	sortKey->abbreviate = true;
+
+	PrepareSortSupportFromIndexKey(opfamily, opcintype, sortKey);
+
+	if (sortKey->abbrev_converter == NULL)
+	{
+		/* Nothing to gain over the scankey; keep using that */
+		pfree(sortKey);
+		return;
+	}
+
+	state->sortKeys = sortKey;
+	state->abbrevNext = 10;
 }
 
 static void
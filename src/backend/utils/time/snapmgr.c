@@ -1252,6 +1252,127 @@ ImportSnapshot(const char *idstr)
 	SetTransactionSnapshot(&snapshot, src_xid);
 }
 
+/*
+ * Header of a snapshot serialized by SerializeSnapshot.  The xip and subxip
+ * arrays follow it.
+ */
+typedef struct SerializedSnapshotData
+{
+	TransactionId xmin;
+	TransactionId xmax;
+	uint32		xcnt;
+	int32		subxcnt;
+	bool		suboverflowed;
+	bool		takenDuringRecovery;
+	CommandId	curcid;
+} SerializedSnapshotData;
+
+/*
+ * EstimateSnapshotSpace
+ *		Returns the size needed to serialize the given MVCC snapshot.
+ */
+Size
+EstimateSnapshotSpace(Snapshot snapshot)
+{
+	Size		size;
+
+	Assert(snapshot != InvalidSnapshot);
+	Assert(snapshot->satisfies == HeapTupleSatisfiesMVCC);
+
+	size = add_size(sizeof(SerializedSnapshotData),
+					mul_size(snapshot->xcnt, sizeof(TransactionId)));
+	if (snapshot->subxcnt > 0 &&
+		(!snapshot->suboverflowed || snapshot->takenDuringRecovery))
+		size = add_size(size,
+						mul_size(snapshot->subxcnt, sizeof(TransactionId)));
+
+	return size;
+}
+
+/*
+ * SerializeSnapshot
+ *		Copy an MVCC snapshot into EstimateSnapshotSpace() bytes at start,
+ *		typically in shared memory, so that another backend can use it
+ *		through RestoreSnapshot.
+ */
+void
+SerializeSnapshot(Snapshot snapshot, char *start)
+{
+	SerializedSnapshotData *serialized = (SerializedSnapshotData *) start;
+	TransactionId *xids = (TransactionId *) (serialized + 1);
+
+	Assert(snapshot->satisfies == HeapTupleSatisfiesMVCC);
+
+	serialized->xmin = snapshot->xmin;
+	serialized->xmax = snapshot->xmax;
+	serialized->xcnt = snapshot->xcnt;
+	serialized->suboverflowed = snapshot->suboverflowed;
+	serialized->takenDuringRecovery = snapshot->takenDuringRecovery;
+	serialized->curcid = snapshot->curcid;
+
+	if (snapshot->xcnt > 0)
+		memcpy(xids, snapshot->xip, snapshot->xcnt * sizeof(TransactionId));
+
+	/* As in CopySnapshot, an overflowed subxip array is of no use */
+	if (snapshot->subxcnt > 0 &&
+		(!snapshot->suboverflowed || snapshot->takenDuringRecovery))
+	{
+		serialized->subxcnt = snapshot->subxcnt;
+		memcpy(xids + snapshot->xcnt, snapshot->subxip,
+			   snapshot->subxcnt * sizeof(TransactionId));
+	}
+	else
+		serialized->subxcnt = 0;
+}
+
+/*
+ * RestoreSnapshot
+ *		Restore a snapshot serialized by SerializeSnapshot.
+ *
+ * The copy is palloc'd in TopTransactionContext and has initial refcounts set
+ * to 0, like one made by CopySnapshot.  Note that the backend using it must
+ * see to it that the snapshot's xmin stays protected, for example with
+ * ProcArrayInstallRestoredXmin.
+ */
+Snapshot
+RestoreSnapshot(char *start)
+{
+	SerializedSnapshotData *serialized = (SerializedSnapshotData *) start;
+	TransactionId *xids = (TransactionId *) (serialized + 1);
+	Snapshot	snapshot;
+	Size		size;
+
+	size = sizeof(SnapshotData) +
+		(serialized->xcnt + serialized->subxcnt) * sizeof(TransactionId);
+	snapshot = (Snapshot) MemoryContextAllocZero(TopTransactionContext, size);
+
+	snapshot->satisfies = HeapTupleSatisfiesMVCC;
+	snapshot->xmin = serialized->xmin;
+	snapshot->xmax = serialized->xmax;
+	snapshot->xcnt = serialized->xcnt;
+	snapshot->subxcnt = serialized->subxcnt;
+	snapshot->suboverflowed = serialized->suboverflowed;
+	snapshot->takenDuringRecovery = serialized->takenDuringRecovery;
+	snapshot->curcid = serialized->curcid;
+	snapshot->copied = true;
+
+	if (serialized->xcnt > 0)
+	{
+		snapshot->xip = (TransactionId *) (snapshot + 1);
+		memcpy(snapshot->xip, xids,
+			   serialized->xcnt * sizeof(TransactionId));
+	}
+	if (serialized->subxcnt > 0)
+	{
+		snapshot->subxip = ((TransactionId *) (snapshot + 1)) +
+			serialized->xcnt;
+		memcpy(snapshot->subxip, xids + serialized->xcnt,
+			   serialized->subxcnt * sizeof(TransactionId));
+	}
+
+	return snapshot;
+}
+
 /*
  * XactHasExportedSnapshots
  *		Test whether current transaction has exported any snapshots.
@@ -4265,6 +4265,8 @@ getTables(Archive *fout, int *numTables)
 	int			i_reltablespace;
 	int			i_reloptions;
 	int			i_checkoption;
+	int			i_partkeydef;
+	int			i_partbound;
 	int			i_toastreloptions;
 	int			i_reloftype;
 	int			i_relpages;
@@ -4315,7 +4317,11 @@ getTables(Archive *fout, int *numTables)
 						"array_to_string(array_remove(array_remove(c.reloptions,'check_option=local'),'check_option=cascaded'), ', ') AS reloptions, "
 						  "CASE WHEN 'check_option=local' = ANY (c.reloptions) THEN 'LOCAL'::text "
 							   "WHEN 'check_option=cascaded' = ANY (c.reloptions) THEN 'CASCADED'::text ELSE NULL END AS checkoption, "
-						  "array_to_string(array(SELECT 'toast.' || x FROM unnest(tc.reloptions) x), ', ') AS toast_reloptions "
+						  "array_to_string(array(SELECT 'toast.' || x FROM unnest(tc.reloptions) x), ', ') AS toast_reloptions, "
+						  "pg_catalog.pg_get_partkeydef(c.oid) AS partkeydef, "
+						  "(SELECT pg_catalog.pg_get_expr(i.inhpartbound, i.inhrelid) "
+						  "FROM pg_catalog.pg_inherits i "
+						  "WHERE i.inhrelid = c.oid AND i.inhpartbound IS NOT NULL) AS partbound "
 						  "FROM pg_class c "
 						  "LEFT JOIN pg_depend d ON "
 						  "(c.relkind = '%c' AND "
@@ -4719,6 +4725,8 @@ getTables(Archive *fout, int *numTables)
 	i_reltablespace = PQfnumber(res, "reltablespace");
 	i_reloptions = PQfnumber(res, "reloptions");
 	i_checkoption = PQfnumber(res, "checkoption");
+	i_partkeydef = PQfnumber(res, "partkeydef");
+	i_partbound = PQfnumber(res, "partbound");
 	i_toastreloptions = PQfnumber(res, "toast_reloptions");
 	i_reloftype = PQfnumber(res, "reloftype");
 
@@ -4784,6 +4792,22 @@ getTables(Archive *fout, int *numTables)
 		else
 			tblinfo[i].checkoption = pg_strdup(PQgetvalue(res, i, i_checkoption));
 		tblinfo[i].toast_reloptions = pg_strdup(PQgetvalue(res, i, i_toastreloptions));
+		if (i_partkeydef == -1 || PQgetisnull(res, i, i_partkeydef))
+			tblinfo[i].partkeydef = NULL;
+		else
+			tblinfo[i].partkeydef = pg_strdup(PQgetvalue(res, i, i_partkeydef));
+		if (i_partbound == -1 || PQgetisnull(res, i, i_partbound))
+			tblinfo[i].partbound = NULL;
+		else
+		{
+			tblinfo[i].partbound = pg_strdup(PQgetvalue(res, i, i_partbound));
+
+			/*
+			 * The partition's bound constraint is recreated along with the
+			 * partition, so getTableAttrs won't collect it.
+			 */
+			tblinfo[i].ncheck--;
+		}
 
 		/* other fields were zeroed above */
 
@@ -6631,7 +6655,23 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 						  tbinfo->dobj.name);
 
 			resetPQExpBuffer(q);
-			if (fout->remoteVersion >= 90200)
+			if (fout->remoteVersion >= 90400)
+			{
+				/*
+				 * Skip a partition's bound constraint, the only kind that is
+				 * both inherited and NO INHERIT.
+				 */
+				appendPQExpBuffer(q, "SELECT tableoid, oid, conname, "
+						   "pg_catalog.pg_get_constraintdef(oid) AS consrc, "
+								  "conislocal, convalidated "
+								  "FROM pg_catalog.pg_constraint "
+								  "WHERE conrelid = '%u'::pg_catalog.oid "
+								  "   AND contype = 'c' "
+								  "   AND (conislocal OR NOT connoinherit) "
+								  "ORDER BY conname",
+								  tbinfo->dobj.catId.oid);
+			}
+			else if (fout->remoteVersion >= 90200)
 			{
 				/*
 				 * convalidated is new in 9.2 (actually, it is there in 9.1,
@@ -6756,9 +6796,11 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 				/*
 				 * An unvalidated constraint needs to be dumped separately, so
 				 * that potentially-violating existing data is loaded before
-				 * the constraint.
+				 * the constraint.  So does a partition's own constraint,
+				 * since CREATE TABLE ... PARTITION OF has no place for it.
 				 */
-				constrs[j].separate = !validated;
+				constrs[j].separate = !validated ||
+					(tbinfo->partbound != NULL && constrs[j].conislocal);
 
 				constrs[j].dobj.dump = tbinfo->dobj.dump;
 
@@ -13230,7 +13272,25 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 		if (tbinfo->reloftype && !binary_upgrade)
 			appendPQExpBuffer(q, " OF %s", tbinfo->reloftype);
 
-		if (tbinfo->relkind != RELKIND_MATVIEW)
+		/*
+		 * Likewise, a partition gets its columns from its parent, except in
+		 * a binary upgrade, where it is attached to the parent afterward.
+		 * Any constraints of its own have been marked to be dumped
+		 * separately.
+		 */
+		if (tbinfo->partbound && !binary_upgrade)
+		{
+			TableInfo  *parentRel = parents[0];
+
+			Assert(numParents == 1);
+			appendPQExpBufferStr(q, " PARTITION OF ");
+			if (parentRel->dobj.namespace != tbinfo->dobj.namespace)
+				appendPQExpBuffer(q, "%s.",
+								fmtId(parentRel->dobj.namespace->dobj.name));
+			appendPQExpBufferStr(q, fmtId(parentRel->dobj.name));
+			appendPQExpBuffer(q, "\n%s", tbinfo->partbound);
+		}
+		else if (tbinfo->relkind != RELKIND_MATVIEW)
 		{
 			/* Dump the attributes */
 			actual_atts = 0;
@@ -13379,6 +13439,9 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 				appendPQExpBufferChar(q, ')');
 			}
 
+			if (tbinfo->partkeydef)
+				appendPQExpBuffer(q, "\nPARTITION BY %s", tbinfo->partkeydef);
+
 			if (tbinfo->relkind == RELKIND_FOREIGN_TABLE)
 				appendPQExpBuffer(q, "\nSERVER %s", fmtId(srvname));
 		}
@@ -13512,8 +13575,10 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 					if (parentRel->dobj.namespace != tbinfo->dobj.namespace)
 						appendPQExpBuffer(q, "%s.",
 								fmtId(parentRel->dobj.namespace->dobj.name));
-					appendPQExpBuffer(q, "%s;\n",
-									  fmtId(parentRel->dobj.name));
+					appendPQExpBufferStr(q, fmtId(parentRel->dobj.name));
+					if (tbinfo->partbound)
+						appendPQExpBuffer(q, " %s", tbinfo->partbound);
+					appendPQExpBufferStr(q, ";\n");
 				}
 			}
 
@@ -0,0 +1,51 @@
+use strict;
+use warnings;
+use TestLib;
+use Test::More tests => 6;
+
+# Dump a database with partitioned tables, restore it and dump it again.
+# Partitions must come back as partitions, with their bounds and rows, so
+# that the second dump is identical to the first.
+my $tempdir = TestLib::tempdir;
+start_test_server $tempdir;
+
+psql 'postgres', q{
+CREATE TABLE measurement (logdate date NOT NULL, peak int) PARTITION BY RANGE (logdate);
+CREATE TABLE measurement_y2013 PARTITION OF measurement
+  FOR VALUES FROM ('2013-01-01') TO ('2014-01-01');
+CREATE TABLE measurement_y2014 PARTITION OF measurement
+  FOR VALUES FROM ('2014-01-01') TO (UNBOUNDED);
+ALTER TABLE measurement_y2014 ADD CONSTRAINT peak_check CHECK (peak > 0);
+INSERT INTO measurement VALUES ('2013-06-01', 10), ('2014-06-01', 20);
+CREATE TABLE cities (name text, dropped int, population int) PARTITION BY LIST (name);
+ALTER TABLE cities DROP COLUMN dropped;
+CREATE TABLE cities_ab PARTITION OF cities FOR VALUES IN ('a', 'b');
+CREATE TABLE cities_null PARTITION OF cities FOR VALUES IN (NULL);
+INSERT INTO cities VALUES ('a', 1), (NULL, 2);
+CREATE DATABASE restored;
+};
+
+command_ok([ 'pg_dump', '-f', "$tempdir/dump1.sql", 'postgres' ],
+	'pg_dump of partitioned tables');
+command_ok(
+	[   'psql', '-X', '-q', '-v', 'ON_ERROR_STOP=1', '-d', 'restored',
+		'-f', "$tempdir/dump1.sql" ],
+	'dump restores');
+command_ok([ 'pg_dump', '-f', "$tempdir/dump2.sql", 'restored' ],
+	'pg_dump of restored database');
+
+my $dump1 = `cat $tempdir/dump1.sql`;
+my $dump2 = `cat $tempdir/dump2.sql`;
+is($dump2, $dump1, 'dumps are identical');
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'restored', '-c',
+		'SELECT tableoid::regclass, * FROM measurement ORDER BY logdate' ],
+	qr/^measurement_y2013\|2013-06-01\|10\nmeasurement_y2014\|2014-06-01\|20$/,
+	'rows are restored into their partitions');
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'restored', '-c',
+		"SELECT pg_get_expr(inhpartbound, inhrelid) FROM pg_inherits WHERE inhrelid = 'cities_null'::regclass" ],
+	qr/^FOR VALUES IN \(NULL\)$/,
+	'partition bounds are restored');
@@ -2224,6 +2224,7 @@ describeOneTableDetails(const char *schemaname,
 	{
 		PGresult   *result;
 		int			tuples;
+		bool		partitioned = false;
 
 		/* print foreign server name */
 		if (tableinfo.relkind == 'f')
@@ -2265,12 +2266,43 @@ describeOneTableDetails(const char *schemaname,
 			PQclear(result);
 		}
 
-		/* print inherited tables */
-		printfPQExpBuffer(&buf, "SELECT c.oid::pg_catalog.regclass FROM pg_catalog.pg_class c, pg_catalog.pg_inherits i WHERE c.oid=i.inhparent AND i.inhrelid = '%s' ORDER BY inhseqno;", oid);
+		/* print partition key */
+		if (pset.sversion >= 90400)
+		{
+			printfPQExpBuffer(&buf, "SELECT pg_catalog.pg_get_partkeydef('%s');", oid);
+
+			result = PSQLexec(buf.data, false);
+			if (!result)
+				goto error_return;
+
+			if (PQntuples(result) == 1 && !PQgetisnull(result, 0, 0))
+			{
+				printfPQExpBuffer(&buf, _("Partition key: %s"),
+								  PQgetvalue(result, 0, 0));
+				printTableAddFooter(&cont, buf.data);
+				partitioned = true;
+			}
+			PQclear(result);
+		}
+
+		/* print inherited tables, or the parent of a partition */
+		if (pset.sversion >= 90400)
+			printfPQExpBuffer(&buf, "SELECT c.oid::pg_catalog.regclass, pg_catalog.pg_get_expr(i.inhpartbound, i.inhrelid) FROM pg_catalog.pg_class c, pg_catalog.pg_inherits i WHERE c.oid=i.inhparent AND i.inhrelid = '%s' ORDER BY inhseqno;", oid);
+		else
+			printfPQExpBuffer(&buf, "SELECT c.oid::pg_catalog.regclass, NULL FROM pg_catalog.pg_class c, pg_catalog.pg_inherits i WHERE c.oid=i.inhparent AND i.inhrelid = '%s' ORDER BY inhseqno;", oid);
 
 		result = PSQLexec(buf.data, false);
 		if (!result)
 			goto error_return;
+		else if (PQntuples(result) == 1 && !PQgetisnull(result, 0, 1))
+		{
+			printfPQExpBuffer(&buf, _("Partition of: %s %s"),
+							  PQgetvalue(result, 0, 0),
+							  PQgetvalue(result, 0, 1));
+			printTableAddFooter(&cont, buf.data);
+
+			PQclear(result);
+		}
 		else
 		{
 			const char *s = _("Inherits");
@@ -2295,8 +2327,10 @@ describeOneTableDetails(const char *schemaname,
 			PQclear(result);
 		}
 
-		/* print child tables */
-		if (pset.sversion >= 80300)
+		/* print child tables, or partitions with their bounds */
+		if (partitioned)
+			printfPQExpBuffer(&buf, "SELECT c.oid::pg_catalog.regclass, pg_catalog.pg_get_expr(i.inhpartbound, i.inhrelid) FROM pg_catalog.pg_class c, pg_catalog.pg_inherits i WHERE c.oid=i.inhrelid AND i.inhparent = '%s' ORDER BY c.oid::pg_catalog.regclass::pg_catalog.text;", oid);
+		else if (pset.sversion >= 80300)
 			printfPQExpBuffer(&buf, "SELECT c.oid::pg_catalog.regclass FROM pg_catalog.pg_class c, pg_catalog.pg_inherits i WHERE c.oid=i.inhrelid AND i.inhparent = '%s' ORDER BY c.oid::pg_catalog.regclass::pg_catalog.text;", oid);
 		else
 			printfPQExpBuffer(&buf, "SELECT c.oid::pg_catalog.regclass FROM pg_catalog.pg_class c, pg_catalog.pg_inherits i WHERE c.oid=i.inhrelid AND i.inhparent = '%s' ORDER BY c.relname;", oid);
@@ -2310,7 +2344,12 @@ describeOneTableDetails(const char *schemaname,
 		if (!verbose)
 		{
 			/* print the number of child tables, if any */
-			if (tuples > 0)
+			if (tuples > 0 && partitioned)
+			{
+				printfPQExpBuffer(&buf, _("Number of partitions: %d (Use \\d+ to list them.)"), tuples);
+				printTableAddFooter(&cont, buf.data);
+			}
+			else if (tuples > 0)
 			{
 				printfPQExpBuffer(&buf, _("Number of child tables: %d (Use \\d+ to list them.)"), tuples);
 				printTableAddFooter(&cont, buf.data);
@@ -2319,7 +2358,7 @@ describeOneTableDetails(const char *schemaname,
 		else
 		{
 			/* display the list of child tables */
-			const char *ct = _("Child tables");
+			const char *ct = partitioned ? _("Partitions") : _("Child tables");
 			int			ctw = pg_wcswidth(ct, strlen(ct), pset.encoding);
 
 			for (i = 0; i < tuples; i++)
@@ -2330,6 +2369,8 @@ describeOneTableDetails(const char *schemaname,
 				else
 					printfPQExpBuffer(&buf, "%*s  %s",
 									  ctw, "", PQgetvalue(result, i, 0));
+				if (partitioned)
+					appendPQExpBuffer(&buf, " %s", PQgetvalue(result, i, 1));
 				if (i < tuples - 1)
 					appendPQExpBufferChar(&buf, ',');
 
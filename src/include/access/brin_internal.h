@@ -0,0 +1,71 @@
+/*
+ * brin_internal.h
+ *		internal declarations for BRIN indexes
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/include/access/brin_internal.h
+ */
+#ifndef BRIN_INTERNAL_H
+#define BRIN_INTERNAL_H
+
+#include "fmgr.h"
+#include "storage/buf.h"
+#include "storage/bufpage.h"
+#include "storage/off.h"
+#include "utils/relcache.h"
+
+
+/*
+ * A BrinDesc is a struct designed to enable decoding a BRIN tuple from the
+ * on-disk format to an in-memory tuple and vice-versa.
+ *
+ * Each indexed column is summarized by its minimum and maximum values, so
+ * the on-disk representation of a column is a pair of datums of the column's
+ * type, compared using the btree-style comparison function supplied by the
+ * operator class.
+ */
+typedef struct BrinDesc
+{
+	/* Containing memory context */
+	MemoryContext bd_context;
+
+	/* the index relation itself */
+	Relation	bd_index;
+
+	/* tuple descriptor of the index relation */
+	TupleDesc	bd_tupdesc;
+
+	/* tuple descriptor of on-disk tuples: a (min, max) pair per column */
+	TupleDesc	bd_disktdesc;
+
+	/* total number of Datum entries that are stored on-disk for all columns */
+	int			bd_totalstored;
+
+	/* per-column comparison support procedure */
+	FmgrInfo   *bd_cmp[FLEXIBLE_ARRAY_MEMBER];
+} BrinDesc;
+
+/*
+ * Support procedure numbers.  A BRIN operator class supplies a single
+ * three-way comparison function, with the same signature as the btree
+ * BTORDER_PROC of the corresponding btree operator family.
+ */
+#define BRIN_PROCNUM_COMPARE	1
+#define BRINNProcs				1
+
+#undef BRIN_DEBUG
+
+#ifdef BRIN_DEBUG
+#define BRIN_elog(args) elog args
+#else
+#define BRIN_elog(args) ((void) 0)
+#endif
+
+/* brin.c */
+extern BrinDesc *brin_build_desc(Relation rel);
+extern void brin_free_desc(BrinDesc *bdesc);
+
+#endif   /* BRIN_INTERNAL_H */
@@ -45,19 +45,42 @@ typedef uint32 Bucket;
  * available to other buckets by calling _hash_freeovflpage(). If all
  * the tuples are deleted from a bucket page, no additional action is
  * necessary.
+ *
+ * The low bits of hasho_flag give the page type; the higher bits are only
+ * used on primary bucket pages, to track the progress of a bucket split (see
+ * README).  A bucket being split is marked LH_BUCKET_BEING_SPLIT, and the
+ * bucket it is being split into is marked LH_BUCKET_BEING_POPULATED, until
+ * all the tuples that belong in the new bucket have been copied there.
+ * After that, the old bucket is marked LH_BUCKET_NEEDS_SPLIT_CLEANUP until
+ * the copied tuples have been removed from it.
  */
 #define LH_UNUSED_PAGE			(0)
 #define LH_OVERFLOW_PAGE		(1 << 0)
 #define LH_BUCKET_PAGE			(1 << 1)
 #define LH_BITMAP_PAGE			(1 << 2)
 #define LH_META_PAGE			(1 << 3)
+#define LH_BUCKET_BEING_POPULATED	(1 << 4)
+#define LH_BUCKET_BEING_SPLIT	(1 << 5)
+#define LH_BUCKET_NEEDS_SPLIT_CLEANUP	(1 << 6)
+
+#define LH_PAGE_TYPE \
+	(LH_OVERFLOW_PAGE | LH_BUCKET_PAGE | LH_BITMAP_PAGE | LH_META_PAGE)
 
+/*
+ * In an overflow page, hasho_prevblkno stores the block number of the
+ * previous page in the bucket chain.  In a primary bucket page, there is no
+ * previous page; instead hasho_prevblkno stores the value hashm_maxbucket
+ * had when the bucket was last split, or created, whichever came later.  A
+ * backend that has computed a bucket number from a cached copy of the
+ * metapage can compare this against its copy to tell whether the bucket has
+ * been split since the copy was taken.
+ */
 typedef struct HashPageOpaqueData
 {
-	BlockNumber hasho_prevblkno;	/* previous ovfl (or bucket) blkno */
+	BlockNumber hasho_prevblkno;	/* see above */
 	BlockNumber hasho_nextblkno;	/* next ovfl blkno */
 	Bucket		hasho_bucket;	/* bucket number this pg belongs to */
-	uint16		hasho_flag;		/* page type code, see above */
+	uint16		hasho_flag;		/* page type code + flag bits, see above */
 	uint16		hasho_page_id;	/* for identification of hash indexes */
 } HashPageOpaqueData;
 
@@ -71,6 +94,13 @@ typedef HashPageOpaqueData *HashPageOpaque;
  */
 #define HASHO_PAGE_ID		0xFF80
 
+#define H_BUCKET_BEING_POPULATED(opaque) \
+	(((opaque)->hasho_flag & LH_BUCKET_BEING_POPULATED) != 0)
+#define H_BUCKET_BEING_SPLIT(opaque) \
+	(((opaque)->hasho_flag & LH_BUCKET_BEING_SPLIT) != 0)
+#define H_NEEDS_SPLIT_CLEANUP(opaque) \
+	(((opaque)->hasho_flag & LH_BUCKET_NEEDS_SPLIT_CLEANUP) != 0)
+
 /*
  *	HashScanOpaqueData is private state for a hash index scan.
  */
@@ -88,9 +118,22 @@ typedef struct HashScanOpaqueData
 
 	/*
 	 * If we have a share lock on the bucket, we record it here.  When
-	 * hashso_bucket_blkno is zero, we have no such lock.
+	 * hashso_bucket_blkno is zero, we have no such lock.  We also keep a pin
+	 * on the bucket's primary page for as long as we hold the lock, which
+	 * keeps WAL replay from removing tuples from under us on a standby.
 	 */
 	BlockNumber hashso_bucket_blkno;
+	Buffer		hashso_bucket_buf;
+
+	/*
+	 * If the bucket is the new half of a split that was interrupted, we scan
+	 * the old bucket of the split instead, and hold a share lock and a pin
+	 * on it as well.  When hashso_old_bucket_blkno is zero, we have no such
+	 * lock.
+	 */
+	Bucket		hashso_old_bucket;
+	BlockNumber hashso_old_bucket_blkno;
+	Buffer		hashso_old_bucket_buf;
 
 	/*
 	 * We also want to remember which buffer we're currently examining in the
@@ -116,7 +159,7 @@ typedef HashScanOpaqueData *HashScanOpaque;
 #define HASH_METAPAGE	0		/* metapage is always block 0 */
 
 #define HASH_MAGIC		0x6440640
-#define HASH_VERSION	2		/* 2 signifies only hash key value is stored */
+#define HASH_VERSION	3		/* 3 signifies WAL-logged, with split flags */
 
 /*
  * Spares[] holds the number of overflow pages currently allocated at or
@@ -240,6 +283,166 @@ typedef HashMetaPageData *HashMetaPage;
 #define HASHPROC		1
 
 
+/*
+ * XLOG records for hash operations
+ *
+ * XLOG allows to store some information in high 4 bits of log record xl_info
+ * field.
+ */
+#define XLOG_HASH_INSERT		0x00	/* add index tuple to a bucket page */
+#define XLOG_HASH_ADD_OVFL_PAGE 0x10	/* add overflow page to a bucket */
+#define XLOG_HASH_SPLIT_ALLOCATE_PAGE 0x20	/* start a bucket split */
+#define XLOG_HASH_SPLIT_COMPLETE 0x30	/* all tuples copied to new bucket */
+#define XLOG_HASH_SPLIT_CLEANUP 0x40	/* copied tuples gone from old bucket */
+#define XLOG_HASH_DELETE		0x50	/* delete index tuples from a page */
+#define XLOG_HASH_MOVE_PAGE_CONTENTS 0x60	/* move tuples while squeezing */
+#define XLOG_HASH_FREE_OVFL_PAGE 0x70	/* remove overflow page from a bucket */
+#define XLOG_HASH_UPDATE_META_PAGE 0x80 /* update hashm_ntuples */
+
+/*
+ * This is what we need to know about a simple insertion: the page and
+ * offset the tuple went to.  The metapage's tuple count is incremented too.
+ */
+typedef struct xl_hash_insert
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	OffsetNumber offnum;
+	/* INDEX TUPLE FOLLOWS AT END OF STRUCT */
+} xl_hash_insert;
+
+#define SizeOfHashInsert	(offsetof(xl_hash_insert, offnum) + sizeof(OffsetNumber))
+
+/*
+ * Adding an overflow page to the end of a bucket chain.  The overflow page
+ * is either recycled (mapblkno is the bitmap page whose bit mapbit gets set)
+ * or new at the end of the index, in which case mapblkno is invalid.  If a
+ * new bitmap page had to be added too, newmapblkno is valid.  The new
+ * overflow page is always reinitialized from scratch during replay.
+ */
+typedef struct xl_hash_add_ovfl_page
+{
+	RelFileNode node;
+	BlockNumber ovflblkno;		/* the new overflow page */
+	BlockNumber tailblkno;		/* old last page of the bucket chain */
+	Bucket		bucket;
+	BlockNumber mapblkno;
+	uint32		mapbit;
+	BlockNumber newmapblkno;
+	uint16		bmsize;			/* bitmap size, to init newmapblkno */
+	/* HashMetaPageData FOLLOWS */
+} xl_hash_add_ovfl_page;
+
+#define SizeOfHashAddOvflPage	(offsetof(xl_hash_add_ovfl_page, bmsize) + sizeof(uint16))
+
+/*
+ * The first step of a bucket split: the metapage is updated to include the
+ * new bucket, the old bucket's primary page is marked as being split, and
+ * the new bucket's primary page is initialized, marked as being populated.
+ */
+typedef struct xl_hash_split_allocate_page
+{
+	RelFileNode node;
+	Bucket		new_bucket;
+	BlockNumber old_blkno;		/* primary page of old bucket */
+	BlockNumber new_blkno;		/* primary page of new bucket */
+	/* HashMetaPageData FOLLOWS */
+} xl_hash_split_allocate_page;
+
+#define SizeOfHashSplitAllocatePage	(offsetof(xl_hash_split_allocate_page, new_blkno) + sizeof(BlockNumber))
+
+/*
+ * The end of a bucket split: the flags on both primary pages are updated.
+ * The pages of the new bucket were filled in by XLOG_HEAP_NEWPAGE records.
+ */
+typedef struct xl_hash_split_complete
+{
+	RelFileNode node;
+	BlockNumber old_blkno;
+	BlockNumber new_blkno;
+} xl_hash_split_complete;
+
+#define SizeOfHashSplitComplete	(offsetof(xl_hash_split_complete, new_blkno) + sizeof(BlockNumber))
+
+/*
+ * The tuples that were copied to the new bucket of a split have been
+ * removed from the old one: clear LH_BUCKET_NEEDS_SPLIT_CLEANUP.
+ */
+typedef struct xl_hash_split_cleanup
+{
+	RelFileNode node;
+	BlockNumber bucket_blkno;
+} xl_hash_split_cleanup;
+
+#define SizeOfHashSplitCleanup	(offsetof(xl_hash_split_cleanup, bucket_blkno) + sizeof(BlockNumber))
+
+/*
+ * Removal of tuples from a bucket page, by VACUUM or by split cleanup.
+ * bucket_blkno is the bucket's primary page, which replay must lock for
+ * cleanup before removing anything (see README).
+ */
+typedef struct xl_hash_delete
+{
+	RelFileNode node;
+	BlockNumber bucket_blkno;
+	BlockNumber blkno;
+	/* TARGET OFFSET NUMBERS FOLLOW */
+} xl_hash_delete;
+
+#define SizeOfHashDelete	(offsetof(xl_hash_delete, blkno) + sizeof(BlockNumber))
+
+/*
+ * Moving tuples from the "read" page to the "write" page while squeezing a
+ * bucket.  The data for the write page is ntups offset numbers (where each
+ * tuple was inserted, in order of insertion) followed by the tuples; the
+ * data for the read page is the offset numbers of the removed tuples.
+ */
+typedef struct xl_hash_move_page_contents
+{
+	RelFileNode node;
+	BlockNumber bucket_blkno;
+	BlockNumber wblkno;
+	BlockNumber rblkno;
+	uint16		ntups;
+	uint16		ndeleted;
+	/* OFFSET NUMBERS AND TUPLES FOLLOW */
+} xl_hash_move_page_contents;
+
+#define SizeOfHashMovePageContents	(offsetof(xl_hash_move_page_contents, ndeleted) + sizeof(uint16))
+
+/*
+ * Unlinking an empty overflow page from its bucket chain, and marking it
+ * free in the bitmap.  If the freed page is now the first free one,
+ * hashm_firstfree is updated too.  The freed page itself is reinitialized
+ * as an unused page.
+ */
+typedef struct xl_hash_free_ovfl_page
+{
+	RelFileNode node;
+	BlockNumber bucket_blkno;
+	BlockNumber ovflblkno;
+	BlockNumber prevblkno;
+	BlockNumber nextblkno;		/* InvalidBlockNumber if none */
+	BlockNumber mapblkno;
+	uint32		mapbit;
+	bool		update_firstfree;
+	uint32		firstfree;
+} xl_hash_free_ovfl_page;
+
+#define SizeOfHashFreeOvflPage	(offsetof(xl_hash_free_ovfl_page, firstfree) + sizeof(uint32))
+
+/*
+ * Setting the metapage's tuple count at the end of VACUUM.
+ */
+typedef struct xl_hash_update_meta_page
+{
+	RelFileNode node;
+	double		ntuples;
+} xl_hash_update_meta_page;
+
+#define SizeOfHashUpdateMetaPage	(offsetof(xl_hash_update_meta_page, ntuples) + sizeof(double))
+
+
 /* public routines */
 
 extern Datum hashbuild(PG_FUNCTION_ARGS);
@@ -290,10 +493,11 @@ extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 
 /* hashovfl.c */
 extern Buffer _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf);
-extern BlockNumber _hash_freeovflpage(Relation rel, Buffer ovflbuf,
-				   BufferAccessStrategy bstrategy);
+extern BlockNumber _hash_freeovflpage(Relation rel, BlockNumber bucket_blkno,
+				   Buffer ovflbuf, BufferAccessStrategy bstrategy);
 extern void _hash_initbitmap(Relation rel, HashMetaPage metap,
 				 BlockNumber blkno, ForkNumber forkNum);
+extern void _hash_initbitmapbuffer(Buffer buf, uint16 bmsize, bool initpage);
 extern void _hash_squeezebucket(Relation rel,
 					Bucket bucket, BlockNumber bucket_blkno,
 					BufferAccessStrategy bstrategy);
@@ -312,13 +516,17 @@ extern Buffer _hash_getbuf_with_strategy(Relation rel, BlockNumber blkno,
 						   BufferAccessStrategy bstrategy);
 extern void _hash_relbuf(Relation rel, Buffer buf);
 extern void _hash_dropbuf(Relation rel, Buffer buf);
-extern void _hash_wrtbuf(Relation rel, Buffer buf);
 extern void _hash_chgbufaccess(Relation rel, Buffer buf, int from_access,
 				   int to_access);
+extern HashMetaPage _hash_getcachedmetap(Relation rel, bool force_refresh);
+extern Buffer _hash_getbucketbuf_from_hashkey(Relation rel, uint32 hashkey,
+								int access, HashMetaPage *cachedmetap);
+extern void _hash_dropscanbuf(Relation rel, HashScanOpaque so);
 extern uint32 _hash_metapinit(Relation rel, double num_tuples,
 				ForkNumber forkNum);
 extern void _hash_pageinit(Page page, Size size);
 extern void _hash_expandtable(Relation rel, Buffer metabuf);
+extern bool _hash_finish_split(Relation rel, Bucket nbucket, bool wait);
 
 /* hashscan.c */
 extern void _hash_regscan(IndexScanDesc scan);
@@ -346,6 +554,7 @@ extern uint32 _hash_datum2hashkey_type(Relation rel, Datum key, Oid keytype);
 extern Bucket _hash_hashkey2bucket(uint32 hashkey, uint32 maxbucket,
 					 uint32 highmask, uint32 lowmask);
 extern uint32 _hash_log2(uint32 num);
+extern Bucket _hash_get_oldbucket(Bucket new_bucket);
 extern void _hash_checkpage(Relation rel, Buffer buf, int flags);
 extern uint32 _hash_get_indextuple_hashkey(IndexTuple itup);
 extern IndexTuple _hash_form_tuple(Relation index,
@@ -354,6 +563,14 @@ extern OffsetNumber _hash_binsearch(Page page, uint32 hash_value);
 extern OffsetNumber _hash_binsearch_last(Page page, uint32 hash_value);
 
 /* hash.c */
+extern void hashbucketcleanup(Relation rel, Bucket cur_bucket,
+				  BlockNumber bucket_blkno, BufferAccessStrategy bstrategy,
+				  uint32 maxbucket, uint32 highmask, uint32 lowmask,
+				  double *tuples_removed, double *num_index_tuples,
+				  bool split_cleanup,
+				  IndexBulkDeleteCallback callback, void *callback_state);
+
+/* hashxlog.c */
 extern void hash_redo(XLogRecPtr lsn, XLogRecord *record);
 extern void hash_desc(StringInfo buf, uint8 xl_info, char *rec);
 
@@ -750,6 +750,9 @@ extern HeapTuple heap_modifytuple(HeapTuple tuple,
 				 char *replActions);
 extern void heap_deformtuple(HeapTuple tuple, TupleDesc tupleDesc,
 				 Datum *values, char *nulls);
+extern void heap_deform_tuples(HeapTuple tuples, int ntuples,
+				   TupleDesc tupleDesc, int natts,
+				   Datum **values, bool **isnull);
 extern void heap_freetuple(HeapTuple htup);
 extern MinimalTuple heap_form_minimal_tuple(TupleDesc tupleDescriptor,
 						Datum *values, bool *isnull);
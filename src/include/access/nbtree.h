@@ -546,10 +546,13 @@ typedef struct BTScanPosData
 	 * array back-to-front, so we start at the last slot and fill downwards.
 	 * Hence we need both a first-valid-entry and a last-valid-entry counter.
 	 * itemIndex is a cursor showing which entry was last returned to caller.
+	 * prefetchIndex shows how far ahead of it, in the scan direction, we have
+	 * already issued prefetch requests for the referenced heap blocks.
 	 */
 	int			firstItem;		/* first valid index in items[] */
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
+	int			prefetchIndex;	/* last items[] index prefetched */
 
 	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
 } BTScanPosData;
@@ -714,16 +717,28 @@ extern void BTreeShmemInit(void);
  */
 typedef struct BTSpool BTSpool; /* opaque type known only within nbtsort.c */
 
+struct IndexInfo;				/* avoid including execnodes.h here */
+struct ParallelHeapScanDescData;	/* avoid including relscan.h here */
+
 extern BTSpool *_bt_spoolinit(Relation heap, Relation index,
 			  bool isunique, bool isdead);
 extern void _bt_spooldestroy(BTSpool *btspool);
 extern void _bt_spool(IndexTuple itup, BTSpool *btspool);
+extern void _bt_spooldead(IndexTuple itup, BTSpool *btspool);
 extern void _bt_leafbuild(BTSpool *btspool, BTSpool *spool2);
+extern BTSpool *_bt_parallel_spoolinit(Relation heap, Relation index,
+					   struct IndexInfo *indexInfo,
+					   struct ParallelHeapScanDescData **pscan);
+extern void _bt_parallel_spoolresults(BTSpool *btspool,
+						  struct IndexInfo *indexInfo,
+						  double *reltuples, double *indtuples);
+extern void _bt_parallel_build_main(Datum main_arg);
 
 /*
  * prototypes for functions in nbtxlog.c
  */
 extern void btree_redo(XLogRecPtr lsn, XLogRecord *record);
 extern void btree_desc(StringInfo buf, uint8 xl_info, char *rec);
+extern int	btree_blockrefs(XLogRecord *record, XLogBlockRef *refs);
 
 #endif   /* NBTREE_H */
@@ -19,8 +19,27 @@
 #include "access/htup_details.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/spin.h"
 
 
+/*
+ * Shared state for a parallel heap scan.
+ *
+ * This is placed in dynamic shared memory (normally carved out of a segment
+ * with shm_toc_allocate) by the backend that sets up the scan, and attached
+ * to by every cooperating backend with heap_beginscan_parallel.  Blocks are
+ * handed out in ranges of phs_chunksize consecutive blocks from a shared
+ * counter, so every block is visited by exactly one participant.
+ */
+typedef struct ParallelHeapScanDescData
+{
+	Oid			phs_relid;		/* OID of relation to scan */
+	BlockNumber phs_nblocks;	/* # blocks in relation at start of scan */
+	BlockNumber phs_chunksize;	/* # blocks handed out per request */
+	slock_t		phs_mutex;		/* protects phs_cblock */
+	BlockNumber phs_cblock;		/* next block to be handed out */
+}	ParallelHeapScanDescData;
+
 typedef struct HeapScanDescData
 {
 	/* scan parameters */
@@ -33,10 +52,12 @@ typedef struct HeapScanDescData
 	bool		rs_allow_strat; /* allow or disallow use of access strategy */
 	bool		rs_allow_sync;	/* allow or disallow use of syncscan */
 	bool		rs_temp_snap;	/* unregister snapshot at scan end? */
+	ParallelHeapScanDesc rs_parallel;	/* shared state, or NULL if none */
 
 	/* state set up at initscan time */
 	BlockNumber rs_nblocks;		/* number of blocks to scan */
 	BlockNumber rs_startblock;	/* block # to start at */
+	BlockNumber rs_numblocks;	/* max number of blocks to scan */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 	bool		rs_syncscan;	/* report location to syncscan logic? */
 
@@ -48,6 +69,10 @@ typedef struct HeapScanDescData
 	/* NB: if rs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
 	ItemPointerData rs_mctid;	/* marked scan position, if any */
 
+	/* block range currently claimed from rs_parallel, if any */
+	BlockNumber rs_pchunk_next;	/* next block of the range to visit */
+	BlockNumber rs_pchunk_end;	/* first block past the end of the range */
+
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
 	int			rs_cindex;		/* current tuple's index in vistuples */
 	int			rs_mindex;		/* marked tuple's saved index */
@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.h
+ *	  Compact store of dead tuple TIDs, for VACUUM
+ *
+ * A TidStore is filled one heap block at a time, in increasing block order,
+ * and is then probed for membership and iterated over in block order.  It
+ * lives in a single chunk of memory of a size fixed at creation, and holds
+ * no pointers, so it can be placed in dynamic shared memory.
+ *
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/tidstore.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TIDSTORE_H
+#define TIDSTORE_H
+
+#include "storage/block.h"
+#include "storage/itemptr.h"
+#include "storage/off.h"
+
+/* The representation is private to tidstore.c */
+typedef struct TidStore TidStore;
+
+/* State of an iteration over a TidStore, also private */
+typedef struct TidStoreIter
+{
+	uint32		next;			/* next block array element to return */
+} TidStoreIter;
+
+extern Size TidStoreMinSize(BlockNumber nblocks);
+extern Size TidStoreMaxSize(BlockNumber nblocks);
+extern TidStore *TidStoreCreate(void *space, Size size, BlockNumber nblocks);
+extern void TidStoreReset(TidStore *ts);
+
+extern bool TidStoreIsFull(const TidStore *ts);
+extern void TidStoreAddBlock(TidStore *ts, BlockNumber blkno,
+				 const OffsetNumber *offsets, int noffsets);
+extern int64 TidStoreNumTids(const TidStore *ts);
+extern bool TidStoreIsMember(const TidStore *ts, ItemPointer tid);
+
+extern void TidStoreBeginIterate(TidStoreIter *iter);
+extern int TidStoreIterateNext(const TidStore *ts, TidStoreIter *iter,
+					BlockNumber *blkno, OffsetNumber *offsets);
+
+#endif   /* TIDSTORE_H */
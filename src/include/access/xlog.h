@@ -15,8 +15,10 @@
 #include "access/xlogdefs.h"
 #include "datatype/timestamp.h"
 #include "lib/stringinfo.h"
+#include "port/pg_crc32c.h"
+#include "storage/block.h"
 #include "storage/buf.h"
-#include "utils/pg_crc.h"
+#include "storage/relfilenode.h"
 
 /*
  * The overall layout of an XLOG record is:
@@ -47,7 +49,7 @@ typedef struct XLogRecord
 	RmgrId		xl_rmid;		/* resource manager for this record */
 	/* 2 bytes of padding here, initialize to zero */
 	XLogRecPtr	xl_prev;		/* ptr to previous record in log */
-	pg_crc32	xl_crc;			/* CRC for this record */
+	pg_crc32c	xl_crc;			/* CRC for this record */
 
 	/* If MAXALIGN==8, there are 4 wasted bytes here */
 
@@ -73,6 +75,19 @@ typedef struct XLogRecord
 #define XLR_MAX_BKP_BLOCKS		4
 #define XLR_BKP_BLOCK(iblk)		(0x08 >> (iblk))		/* iblk in 0..3 */
 
+/*
+ * A data block that replay of an XLOG record will read and modify, as
+ * reported by an rmgr's rm_blockrefs callback.  Recovery uses these to
+ * prefetch blocks ahead of the record that needs them.  A record never
+ * touches more blocks than it could have backed up.
+ */
+typedef struct XLogBlockRef
+{
+	RelFileNode rnode;			/* relation containing block */
+	ForkNumber	forknum;		/* fork within the relation */
+	BlockNumber blkno;			/* block number */
+} XLogBlockRef;
+
 /* Sync methods */
 #define SYNC_METHOD_FSYNC		0
 #define SYNC_METHOD_FDATASYNC	1
@@ -191,6 +206,7 @@ extern char *XLogArchiveCommand;
 extern bool EnableHotStandby;
 extern bool fullPageWrites;
 extern bool wal_log_hints;
+extern bool wal_compression;
 extern bool log_checkpoints;
 extern int	num_xloginsert_locks;
 
@@ -278,6 +294,19 @@ typedef struct CheckpointStatsData
 
 extern CheckpointStatsData CheckpointStats;
 
+/* PGPROC->flushState values, for group flushing in XLogFlush */
+#define XLOG_FLUSH_NOT_WAITING	0
+#define XLOG_FLUSH_WAITING		1	/* queued for a flush leader */
+#define XLOG_FLUSH_DONE			2	/* leader has flushed our request */
+#define XLOG_FLUSH_LEADER		3	/* we're to flush for the queue */
+
+/*
+ * Group flushes are counted in a histogram of their batch sizes: bucket i
+ * counts flushes done for between 2^i and 2^(i+1) - 1 waiting backends,
+ * except that the last bucket has no upper bound.
+ */
+#define XLOG_FLUSH_BATCH_BUCKETS	10
+
 extern XLogRecPtr XLogInsert(RmgrId rmid, uint8 info, XLogRecData *rdata);
 extern bool XLogCheckBufferNeedsBackup(Buffer buffer);
 extern void XLogFlush(XLogRecPtr RecPtr);
@@ -310,6 +339,7 @@ extern void GetXLogReceiptTime(TimestampTz *rtime, bool *fromStream);
 extern XLogRecPtr GetXLogReplayRecPtr(TimeLineID *replayTLI);
 extern XLogRecPtr GetXLogInsertRecPtr(void);
 extern XLogRecPtr GetXLogWriteRecPtr(void);
+extern void GetXLogFlushBatchStats(uint64 *batches);
 extern bool RecoveryIsPaused(void);
 extern void SetRecoveryPause(bool recoveryPause);
 extern TimestampTz GetLatestXTime(void);
@@ -34,8 +34,13 @@
  * PG data pages usually contain an unused "hole" in the middle, which
  * contains only zero bytes.  If hole_length > 0 then we have removed
  * such a "hole" from the stored data (and it's not counted in the
- * XLOG record's CRC, either).  Hence, the amount of block data actually
- * present following the BkpBlock struct is BLCKSZ - hole_length bytes.
+ * XLOG record's CRC, either).
+ *
+ * If wal_compression is on, the remaining data is further compressed with
+ * pglz, and BKPBLOCK_IS_COMPRESSED is set.  The compressed data, including
+ * its PGLZ_Header, decompresses to BLCKSZ - hole_length bytes.  Either way,
+ * the amount of block data actually present following the BkpBlock struct
+ * is given by "length".
  *
  * Note that we don't attempt to align either the BkpBlock struct or the
  * block's data.  So, the struct must be copied to aligned local storage
@@ -48,14 +53,19 @@ typedef struct BkpBlock
 	BlockNumber block;			/* block number */
 	uint16		hole_offset;	/* number of bytes before "hole" */
 	uint16		hole_length;	/* number of bytes in "hole" */
+	uint16		length;			/* number of bytes of block data stored */
+	uint16		flags;			/* BKPBLOCK_* flags, see below */
 
 	/* ACTUAL BLOCK DATA FOLLOWS AT END OF STRUCT */
 } BkpBlock;
 
+/* The block data is compressed with pglz */
+#define BKPBLOCK_IS_COMPRESSED		0x0001
+
 /*
  * Each page of XLOG file has a header like this:
  */
-#define XLOG_PAGE_MAGIC 0xD07D	/* can be used as WAL version indicator */
+#define XLOG_PAGE_MAGIC 0xD080	/* can be used as WAL version indicator */
 
 typedef struct XLogPageHeaderData
 {
@@ -228,10 +238,11 @@ typedef struct xl_end_of_recovery
 } xl_end_of_recovery;
 
 /*
- * XLogRecord is defined in xlog.h, but we avoid #including that to keep
- * this file includable in stand-alone programs.
+ * XLogRecord and XLogBlockRef are defined in xlog.h, but we avoid #including
+ * that to keep this file includable in stand-alone programs.
  */
 struct XLogRecord;
+struct XLogBlockRef;
 
 /*
  * Method table for resource managers.
@@ -248,6 +259,8 @@ typedef struct RmgrData
 	void		(*rm_desc) (StringInfo buf, uint8 xl_info, char *rec);
 	void		(*rm_startup) (void);
 	void		(*rm_cleanup) (void);
+	int			(*rm_blockrefs) (struct XLogRecord *rptr,
+											 struct XLogBlockRef *refs);
 } RmgrData;
 
 extern const RmgrData RmgrTable[];
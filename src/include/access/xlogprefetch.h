@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.h
+ *		Declarations for recovery read-ahead of data blocks.
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogprefetch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPREFETCH_H
+#define XLOGPREFETCH_H
+
+#include "access/xlogdefs.h"
+
+/* GUC variable */
+extern int	recovery_prefetch_distance;
+
+typedef struct XLogPrefetcher XLogPrefetcher;
+
+/*
+ * Counters exposed by the pg_stat_prefetch_recovery view.  They describe
+ * the current (or last) recovery run of the startup process.
+ */
+typedef struct XLogPrefetchStats
+{
+	uint64		prefetch;		/* blocks prefetched */
+	uint64		skip_hit;		/* blocks already in shared buffers */
+	uint64		skip_new;		/* blocks not yet on disk */
+	uint64		skip_fpw;		/* blocks restored from full-page images */
+	uint64		skip_seq;		/* repeats of the previous block */
+	uint64		distance;		/* bytes of WAL currently looked ahead */
+} XLogPrefetchStats;
+
+extern Size XLogPrefetchShmemSize(void);
+extern void XLogPrefetchShmemInit(void);
+
+extern XLogPrefetcher *XLogPrefetcherAllocate(TimeLineID tli);
+extern void XLogPrefetcherFree(XLogPrefetcher *prefetcher);
+extern void XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher,
+						XLogRecPtr replayPtr, TimeLineID tli);
+
+extern void XLogPrefetchGetStats(XLogPrefetchStats *stats);
+
+#endif   /* XLOGPREFETCH_H */
@@ -117,6 +117,10 @@ extern void RemoveAttrDefault(Oid relid, AttrNumber attnum,
 extern void RemoveAttrDefaultById(Oid attrdefId);
 extern void RemoveStatistics(Oid relid, AttrNumber attnum);
 
+extern void StorePartitionKey(Relation rel, char strategy, AttrNumber partattr,
+				  Oid partopclass, Oid partcollation);
+extern void RemovePartitionKeyByRelId(Oid relid);
+
 extern Form_pg_attribute SystemAttributeDefinition(AttrNumber attno,
 						  bool relhasoids);
 
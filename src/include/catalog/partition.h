@@ -0,0 +1,96 @@
+/*-------------------------------------------------------------------------
+ *
+ * partition.h
+ *	  Header file for structures and utility functions related to
+ *	  declarative partitioning
+ *
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/partition.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "fmgr.h"
+#include "nodes/parsenodes.h"
+#include "utils/relcache.h"
+
+/*
+ * Information about the partition key of a partitioned table, as cached in
+ * its relcache entry.  partsupfunc is the btree comparison function of the
+ * key's operator class, used to order the partition bounds.
+ */
+typedef struct PartitionKeyData
+{
+	char		strategy;		/* PARTITION_STRATEGY_LIST or _RANGE */
+	AttrNumber	partattr;		/* key column of the partitioned table */
+	Oid			partopfamily;	/* btree opfamily of the key's opclass */
+	Oid			partopcintype;	/* declared input type of the opclass */
+	Oid			partcollation;	/* key collation, or InvalidOid */
+	Oid			parttypid;		/* type of the key column */
+	int32		parttypmod;
+	int16		parttyplen;
+	bool		parttypbyval;
+	FmgrInfo	partsupfunc;	/* BTORDER_PROC of the opclass */
+} PartitionKeyData;
+
+typedef PartitionKeyData *PartitionKey;
+
+/*
+ * The partitions of a partitioned table, with their bounds in a form
+ * that allows binary searching.
+ *
+ * For range partitioning, the partitions are sorted by lower bound, and
+ * since their ranges can't overlap that orders the upper bounds too.
+ * lower[i] and upper[i] are the bounds of oids[i]; lower_inf[i] and
+ * upper_inf[i] are set when the bound is UNBOUNDED.
+ *
+ * For list partitioning, datums holds every listed value in sorted order,
+ * and indexes[i] is the position in oids of the partition that accepts
+ * datums[i].  null_index is the position of the partition that accepts
+ * NULL, or -1.
+ */
+typedef struct PartitionDescData
+{
+	int			nparts;			/* number of partitions */
+	Oid		   *oids;			/* their OIDs */
+
+	/* range partitioning */
+	Datum	   *lower;
+	Datum	   *upper;
+	bool	   *lower_inf;
+	bool	   *upper_inf;
+
+	/* list partitioning */
+	int			ndatums;
+	Datum	   *datums;
+	int		   *indexes;
+	int			null_index;
+} PartitionDescData;
+
+typedef PartitionDescData *PartitionDesc;
+
+extern PartitionKey RelationGetPartitionKey(Relation rel);
+extern PartitionDesc RelationGetPartitionDesc(Relation rel);
+extern Oid	get_partition_parent(Oid relid);
+
+extern void check_new_partition_bound(char *relname, Relation parent,
+						  PartitionBoundSpec *spec);
+extern Node *get_qual_for_partition_bound(Relation parent,
+							 AttrNumber childattno,
+							 PartitionBoundSpec *spec);
+
+extern PartitionKey copy_partition_key(PartitionKey key);
+extern PartitionDesc copy_partition_desc(PartitionKey key,
+					PartitionDesc pdesc);
+extern int get_partition_index_for_value(PartitionKey key,
+							  PartitionDesc pdesc,
+							  Datum value, bool isnull);
+extern List *get_partitions_for_clauses(Relation rel, Index varno,
+						   List *clauses);
+
+#endif   /* PARTITION_H */
@@ -118,10 +118,12 @@ DATA(insert (	1984   829 829 1 836 ));
 DATA(insert (	1986   19 19 1 359 ));
 DATA(insert (	1986   19 19 2 3135 ));
 DATA(insert (	1988   1700 1700 1 1769 ));
+DATA(insert (	1988   1700 1700 2 3283 ));
 DATA(insert (	1989   26 26 1 356 ));
 DATA(insert (	1989   26 26 2 3134 ));
 DATA(insert (	1991   30 30 1 404 ));
 DATA(insert (	1994   25 25 1 360 ));
+DATA(insert (	1994   25 25 2 3255 ));
 DATA(insert (	1996   1083 1083 1 1107 ));
 DATA(insert (	2000   1266 1266 1 1358 ));
 DATA(insert (	2002   1562 1562 1 1672 ));
@@ -132,6 +134,7 @@ DATA(insert (	2233   703 703 1  380 ));
 DATA(insert (	2234   704 704 1  381 ));
 DATA(insert (	2789   27 27 1 2794 ));
 DATA(insert (	2968   2950 2950 1 2960 ));
+DATA(insert (	2968   2950 2950 2 3300 ));
 DATA(insert (	2994   2249 2249 1 2987 ));
 DATA(insert (	3194   2249 2249 1 3187 ));
 DATA(insert (	3522   3500 3500 1 3514 ));
@@ -429,4 +432,41 @@ DATA(insert (	4017   25 25 3 4029 ));
 DATA(insert (	4017   25 25 4 4030 ));
 DATA(insert (	4017   25 25 5 4031 ));
 
+/* BRIN integer_minmax_ops */
+DATA(insert (	4051   21 21 1 350 ));
+DATA(insert (	4051   21 23 1 2190 ));
+DATA(insert (	4051   21 20 1 2192 ));
+DATA(insert (	4051   23 23 1 351 ));
+DATA(insert (	4051   23 20 1 2188 ));
+DATA(insert (	4051   23 21 1 2191 ));
+DATA(insert (	4051   20 20 1 842 ));
+DATA(insert (	4051   20 23 1 2189 ));
+DATA(insert (	4051   20 21 1 2193 ));
+
+/* BRIN float_minmax_ops */
+DATA(insert (	4052   700 700 1 354 ));
+DATA(insert (	4052   700 701 1 2194 ));
+DATA(insert (	4052   701 701 1 355 ));
+DATA(insert (	4052   701 700 1 2195 ));
+
+/* BRIN numeric_minmax_ops */
+DATA(insert (	4053   1700 1700 1 1769 ));
+
+/* BRIN text_minmax_ops */
+DATA(insert (	4054   25 25 1 360 ));
+
+/* BRIN datetime_minmax_ops */
+DATA(insert (	4055   1082 1082 1 1092 ));
+DATA(insert (	4055   1082 1114 1 2344 ));
+DATA(insert (	4055   1082 1184 1 2357 ));
+DATA(insert (	4055   1114 1114 1 2045 ));
+DATA(insert (	4055   1114 1082 1 2370 ));
+DATA(insert (	4055   1114 1184 1 2526 ));
+DATA(insert (	4055   1184 1184 1 1314 ));
+DATA(insert (	4055   1184 1082 1 2383 ));
+DATA(insert (	4055   1184 1114 1 2533 ));
+
+/* BRIN oid_minmax_ops */
+DATA(insert (	4056   26 26 1 356 ));
+
 #endif   /* PG_AMPROC_H */
@@ -17,11 +17,11 @@
 
 #include "access/xlogdefs.h"
 #include "pgtime.h"				/* for pg_time_t */
-#include "utils/pg_crc.h"
+#include "port/pg_crc32c.h"
 
 
 /* Version identifier for this pg_control format */
-#define PG_CONTROL_VERSION	937
+#define PG_CONTROL_VERSION	938
 
 /*
  * Body of CheckPoint XLOG records.  This is declared here because we keep
@@ -219,7 +219,7 @@ typedef struct ControlFileData
 	uint32		data_checksum_version;
 
 	/* CRC of all above ... MUST BE LAST! */
-	pg_crc32	crc;
+	pg_crc32c	crc;
 } ControlFileData;
 
 /*
@@ -33,6 +33,11 @@ CATALOG(pg_inherits,2611) BKI_WITHOUT_OIDS
 	Oid			inhrelid;
 	Oid			inhparent;
 	int32		inhseqno;
+
+#ifdef CATALOG_VARLEN			/* variable-length fields start here */
+	pg_node_tree inhpartbound;	/* partition bound, if inhrelid is a
+								 * partition of inhparent */
+#endif
 } FormData_pg_inherits;
 
 /* ----------------
@@ -46,10 +51,11 @@ typedef FormData_pg_inherits *Form_pg_inherits;
  *		compiler constants for pg_inherits
  * ----------------
  */
-#define Natts_pg_inherits				3
+#define Natts_pg_inherits				4
 #define Anum_pg_inherits_inhrelid		1
 #define Anum_pg_inherits_inhparent		2
 #define Anum_pg_inherits_inhseqno		3
+#define Anum_pg_inherits_inhpartbound	4
 
 /* ----------------
  *		pg_inherits has no initial contents
@@ -234,4 +234,17 @@ DATA(insert (	405		jsonb_ops			PGNSP PGUID 4034  3802 t 0 ));
 DATA(insert (	2742	jsonb_ops			PGNSP PGUID 4036  3802 t 25 ));
 DATA(insert (	2742	jsonb_hash_ops		PGNSP PGUID 4037  3802 f 23 ));
 
+/* BRIN operator classes */
+DATA(insert (	3580	int2_minmax_ops			PGNSP PGUID 4051    21 t 0 ));
+DATA(insert (	3580	int4_minmax_ops			PGNSP PGUID 4051    23 t 0 ));
+DATA(insert (	3580	int8_minmax_ops			PGNSP PGUID 4051    20 t 0 ));
+DATA(insert (	3580	float4_minmax_ops		PGNSP PGUID 4052   700 t 0 ));
+DATA(insert (	3580	float8_minmax_ops		PGNSP PGUID 4052   701 t 0 ));
+DATA(insert (	3580	numeric_minmax_ops		PGNSP PGUID 4053  1700 t 0 ));
+DATA(insert (	3580	text_minmax_ops			PGNSP PGUID 4054    25 t 0 ));
+DATA(insert (	3580	date_minmax_ops			PGNSP PGUID 4055  1082 t 0 ));
+DATA(insert (	3580	timestamp_minmax_ops	PGNSP PGUID 4055  1114 t 0 ));
+DATA(insert (	3580	timestamptz_minmax_ops	PGNSP PGUID 4055  1184 t 0 ));
+DATA(insert (	3580	oid_minmax_ops			PGNSP PGUID 4056    26 t 0 ));
+
 #endif   /* PG_OPCLASS_H */
@@ -153,6 +153,13 @@ DATA(insert OID = 4034 (	405		jsonb_ops		PGNSP PGUID ));
 DATA(insert OID = 4035 (	783		jsonb_ops		PGNSP PGUID ));
 DATA(insert OID = 4036 (	2742	jsonb_ops		PGNSP PGUID ));
 DATA(insert OID = 4037 (	2742	jsonb_hash_ops	PGNSP PGUID ));
+
+DATA(insert OID = 4051 (	3580	integer_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4052 (	3580	float_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4053 (	3580	numeric_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4054 (	3580	text_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 4055 (	3580	datetime_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 4056 (	3580	oid_minmax_ops			PGNSP PGUID ));
 #define TEXT_SPGIST_FAM_OID 4017
 
 #endif   /* PG_OPFAMILY_H */
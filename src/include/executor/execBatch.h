@@ -0,0 +1,79 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Batched evaluation of simple scan quals.
+ *
+ *
+ * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "access/htup_details.h"
+#include "nodes/pg_list.h"
+
+/* Maximum number of tuples in one batch: the visible tuples of one page */
+#define SCANBATCH_MAX_TUPLES	MaxHeapTuplesPerPage
+
+/* Representation of the compared values, as far as batch kernels care */
+typedef enum BatchValueType
+{
+	BATCH_VALUE_INT32,			/* int4, date */
+	BATCH_VALUE_INT64,			/* int8 */
+	BATCH_VALUE_FLOAT8			/* float8 */
+} BatchValueType;
+
+/* Comparison applied as "column OP constant" */
+typedef enum BatchCmpOp
+{
+	BATCH_CMP_EQ,
+	BATCH_CMP_NE,
+	BATCH_CMP_LT,
+	BATCH_CMP_LE,
+	BATCH_CMP_GT,
+	BATCH_CMP_GE
+} BatchCmpOp;
+
+/* One qual clause of the form "Var OP Const" */
+typedef struct BatchQualClause
+{
+	AttrNumber	attno;			/* 1-based column number */
+	BatchValueType type;
+	BatchCmpOp	op;
+	Datum		constval;		/* non-null comparison constant */
+} BatchQualClause;
+
+/*
+ * ScanBatch holds the state for evaluating a scan node's simple quals over
+ * a batch of tuples.  The tuples of a batch are deformed into per-column
+ * arrays (only for the columns the quals reference), and the clauses are
+ * applied one after another, each one narrowing down the selection vector
+ * sel[] that lists the indexes of the tuples still qualifying.
+ */
+typedef struct ScanBatch
+{
+	TupleDesc	tupdesc;		/* descriptor of the scanned tuples */
+	int			nclauses;
+	BatchQualClause *clauses;
+	int			natts;			/* number of leading columns to deform */
+	Datum	  **values;			/* per-column value arrays, NULL if unused */
+	bool	  **isnull;			/* per-column null flags, NULL if unused */
+
+	int			ntuples;		/* number of tuples in the current batch */
+	int			nselected;		/* number of entries in sel[] */
+	int			next;			/* next entry of sel[] to return */
+	uint16		sel[SCANBATCH_MAX_TUPLES];
+	HeapTupleData tuples[SCANBATCH_MAX_TUPLES];
+} ScanBatch;
+
+extern ScanBatch *ExecInitScanBatch(List *qual, Index scanrelid,
+				  TupleDesc tupdesc, List **batchqual, List **otherqual);
+extern void ExecScanBatchQual(ScanBatch *batch, int ntuples);
+extern void ExecScanBatchReset(ScanBatch *batch);
+
+#endif   /* EXECBATCH_H */
@@ -188,6 +188,12 @@ extern void InitResultRelInfo(ResultRelInfo *resultRelInfo,
 				  Index resultRelationIndex,
 				  int instrument_options);
 extern ResultRelInfo *ExecGetTriggerResultRel(EState *estate, Oid relid);
+extern PartitionRoutingState *ExecSetupPartitionRouting(EState *estate,
+						  ResultRelInfo *rootResultRelInfo);
+extern ResultRelInfo *ExecFindPartition(PartitionRoutingState *routing,
+				  TupleTableSlot **slot, EState *estate);
+extern TupleTableSlot *ExecPartitionTupleToParent(PartitionRoutingState *routing,
+						   TupleTableSlot *slot);
 extern bool ExecContextForcesOids(PlanState *planstate, bool *hasoids);
 extern void ExecConstraints(ResultRelInfo *resultRelInfo,
 				TupleTableSlot *slot, EState *estate);
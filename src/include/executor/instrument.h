@@ -22,10 +22,12 @@ typedef struct BufferUsage
 	long		shared_blks_read;		/* # of shared disk blocks read */
 	long		shared_blks_dirtied;	/* # of shared blocks dirtied */
 	long		shared_blks_written;	/* # of shared disk blocks written */
+	long		shared_blks_prefetch_issued;	/* # of shared prefetches issued */
 	long		local_blks_hit; /* # of local buffer hits */
 	long		local_blks_read;	/* # of local disk blocks read */
 	long		local_blks_dirtied;		/* # of shared blocks dirtied */
 	long		local_blks_written;		/* # of local disk blocks written */
+	long		local_blks_prefetch_issued; /* # of local prefetches issued */
 	long		temp_blks_read; /* # of temp blocks read */
 	long		temp_blks_written;		/* # of temp blocks written */
 	instr_time	blk_read_time;	/* time spent reading */
@@ -22,6 +22,7 @@ extern void ExecEndAgg(AggState *node);
 extern void ExecReScanAgg(AggState *node);
 
 extern Size hash_agg_entry_size(int numAggs);
+extern double hash_agg_spill_fraction(double tablesize);
 
 extern Datum aggregate_dummy(PG_FUNCTION_ARGS);
 
@@ -38,6 +38,19 @@ typedef ForeignScan *(*GetForeignPlan_function) (PlannerInfo *root,
 															 List *tlist,
 														 List *scan_clauses);
 
+typedef void (*GetForeignJoinPaths_function) (PlannerInfo *root,
+														  RelOptInfo *joinrel,
+														 RelOptInfo *outerrel,
+														 RelOptInfo *innerrel,
+														  JoinType jointype,
+													   SpecialJoinInfo *sjinfo,
+														 List *restrictlist);
+
+typedef ForeignScan *(*GetForeignGroupingPlan_function) (PlannerInfo *root,
+														 RelOptInfo *inputrel,
+																 List *tlist,
+														   double dNumGroups);
+
 typedef void (*BeginForeignScan_function) (ForeignScanState *node,
 													   int eflags);
 
@@ -144,11 +157,17 @@ typedef struct FdwRoutine
 
 	/* Support functions for ANALYZE */
 	AnalyzeForeignTable_function AnalyzeForeignTable;
+
+	/* Functions for performing joins and aggregation remotely */
+	GetForeignJoinPaths_function GetForeignJoinPaths;
+	GetForeignGroupingPlan_function GetForeignGroupingPlan;
 } FdwRoutine;
 
 
 /* Functions in foreign/foreign.c */
 extern FdwRoutine *GetFdwRoutine(Oid fdwhandler);
+extern Oid	GetForeignServerIdByRelId(Oid relid);
+extern FdwRoutine *GetFdwRoutineByServerId(Oid serverid);
 extern FdwRoutine *GetFdwRoutineByRelId(Oid relid);
 extern FdwRoutine *GetFdwRoutineForRelation(Relation relation, bool makecopy);
 
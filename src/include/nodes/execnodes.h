@@ -45,9 +45,12 @@
  *		ReadyForInserts		is it valid for inserts?
  *		Concurrent			are we doing a concurrent index build?
  *		BrokenHotChain		did we detect any broken HOT chains?
+ *		ParallelLeaderXid	top-level XID of the parallel build leader
  *
  * ii_Concurrent and ii_BrokenHotChain are used only during index build;
- * they're conventionally set to false otherwise.
+ * they're conventionally set to false otherwise.  ii_ParallelLeaderXid is
+ * set only in the workers of a parallel index build, and is otherwise
+ * InvalidTransactionId.
  * ----------------
  */
 typedef struct IndexInfo
@@ -66,6 +69,7 @@ typedef struct IndexInfo
 	bool		ii_ReadyForInserts;
 	bool		ii_Concurrent;
 	bool		ii_BrokenHotChain;
+	TransactionId ii_ParallelLeaderXid;
 } IndexInfo;
 
 /* ----------------
@@ -331,6 +335,44 @@ typedef struct ResultRelInfo
 	ProjectionInfo *ri_projectReturning;
 } ResultRelInfo;
 
+/* ----------------
+ *	  PartitionRoutingState information
+ *
+ *		When inserting into a partitioned table, each tuple is routed to
+ *		the partition that accepts its partition key value.
+ *
+ *		rootResultRelInfo		the partitioned table's ResultRelInfo
+ *		partKey					copy of the table's partition key
+ *		partDesc				copy of the table's partition bounds
+ *		partitions				ResultRelInfo of each partition, set up the
+ *								first time a tuple is routed to it
+ *		partTupMaps				parent-to-partition tuple conversion maps,
+ *								NULL where the row types are the same
+ *		parentTupMaps			partition-to-parent maps, for RETURNING
+ *		curParentTupMap			parentTupMaps entry of the last partition
+ *								a tuple was routed to
+ *		partSlot				slot holding a tuple converted for a partition
+ *		parentSlot				slot holding a tuple converted back
+ *
+ *		The key and bounds are copied from the relcache so that they stay
+ *		valid for the whole statement; the set of partitions can't change
+ *		meanwhile, since the lock we hold on the partitioned table blocks
+ *		adding and dropping partitions.
+ * ----------------
+ */
+typedef struct PartitionRoutingState
+{
+	ResultRelInfo *rootResultRelInfo;
+	struct PartitionKeyData *partKey;
+	struct PartitionDescData *partDesc;
+	ResultRelInfo **partitions;
+	struct TupleConversionMap **partTupMaps;
+	struct TupleConversionMap **parentTupMaps;
+	struct TupleConversionMap *curParentTupMap;
+	TupleTableSlot *partSlot;
+	TupleTableSlot *parentSlot;
+} PartitionRoutingState;
+
 /* ----------------
  *	  EState information
  *
@@ -1088,6 +1130,8 @@ typedef struct ModifyTableState
 	List	  **mt_arowmarks;	/* per-subplan ExecAuxRowMark lists */
 	EPQState	mt_epqstate;	/* for evaluating EvalPlanQual rechecks */
 	bool		fireBSTriggers; /* do we need to fire stmt triggers? */
+	PartitionRoutingState *mt_partrouting;	/* for INSERT into a
+											 * partitioned table */
 } ModifyTableState;
 
 /* ----------------
@@ -1203,11 +1247,24 @@ typedef struct ScanState
 	TupleTableSlot *ss_ScanTupleSlot;
 } ScanState;
 
-/*
- * SeqScan uses a bare ScanState as its state node, since it needs
- * no additional fields.
+/* ----------------
+ *	 SeqScanState information
+ *
+ *		batchqualorig	   execution state for the quals evaluated in batches
+ *		batch			   batch evaluation state, or NULL if not batching
+ *
+ *		When some of the quals are simple enough to be evaluated over a
+ *		whole page of tuples at once (see execBatch.c), they are removed
+ *		from ps.qual and evaluated as part of fetching tuples instead;
+ *		batchqualorig keeps them around for EvalPlanQual rechecks.
+ * ----------------
  */
-typedef ScanState SeqScanState;
+typedef struct SeqScanState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	List	   *batchqualorig;
+	struct ScanBatch *batch;
+} SeqScanState;
 
 /*
  * These structs store information about index quals that don't have simple
@@ -1672,6 +1729,31 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *		group_pivot holds the first tuple of the current group, against
+ *		which the presorted columns of later tuples are compared.  When a
+ *		tuple starting a new group is read, it replaces the pivot and
+ *		pivot_pending is set until the tuple is added to the next group.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		ntuples;		/* # of tuples returned so far */
+	bool		sort_Done;		/* current group sorted yet? */
+	bool		finished;		/* has the outer plan been exhausted? */
+	bool		pivot_pending;	/* group_pivot not yet added to a group? */
+	long		ngroups;		/* # of groups sorted so far */
+	FmgrInfo   *eqfunctions;	/* equality fns for the presorted columns */
+	MemoryContext tempContext;	/* short-term context for comparisons */
+	TupleTableSlot *group_pivot;	/* first tuple of the current group */
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * -------------------------
@@ -1698,6 +1780,7 @@ typedef struct GroupState
 /* these structs are private in nodeAgg.c: */
 typedef struct AggStatePerAggData *AggStatePerAgg;
 typedef struct AggStatePerGroupData *AggStatePerGroup;
+typedef struct AggHashSpillData *AggHashSpill;
 
 typedef struct AggState
 {
@@ -1720,6 +1803,7 @@ typedef struct AggState
 	List	   *hash_needed;	/* list of columns needed in hash table */
 	bool		table_filled;	/* hash table filled yet? */
 	TupleHashIterator hashiter; /* for iterating through hash table */
+	AggHashSpill hash_spill;	/* state for spilling groups to disk */
 } AggState;
 
 /* ----------------
@@ -1896,4 +1980,25 @@ typedef struct LimitState
 	TupleTableSlot *subSlot;	/* tuple last obtained from subplan */
 } LimitState;
 
+/* ----------------
+ *	 GatherState information
+ *
+ *		The workers are launched on the first call to ExecGather after
+ *		initialization or a rescan; pstate is their shared state, or NULL
+ *		if they haven't been launched.  Tuples read from their queues are
+ *		stored in tuple, which points into the queue's memory, and remain
+ *		valid until the next read from the same queue.
+ * ----------------
+ */
+typedef struct GatherState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	bool		initialized;	/* have we tried to launch workers yet? */
+	bool		child_done;		/* has our own copy of the subplan ended? */
+	int			nworkers_launched;	/* # of workers started by last launch */
+	int			nextreader;		/* next worker queue to read from */
+	struct ParallelGatherState *pstate; /* state of the launched workers */
+	HeapTupleData tuple;		/* tuple last received from a worker */
+} GatherState;
+
 #endif   /* EXECNODES_H */
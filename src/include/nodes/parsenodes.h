@@ -566,6 +566,67 @@ typedef struct IndexElem
 	SortByNulls nulls_ordering; /* FIRST/LAST/default */
 } IndexElem;
 
+/*
+ * PartitionElem - the partitioning column of a partitioned table
+ * (used in CREATE TABLE ... PARTITION BY)
+ */
+typedef struct PartitionElem
+{
+	NodeTag		type;
+	char	   *name;			/* name of column to partition on */
+	List	   *collation;		/* name of collation; NIL = default */
+	List	   *opclass;		/* name of desired opclass; NIL = default */
+	int			location;		/* token location, or -1 if unknown */
+} PartitionElem;
+
+/*
+ * PartitionSpec - the PARTITION BY clause of CREATE TABLE
+ *
+ * Only a single partitioning column is supported at present.
+ */
+typedef struct PartitionSpec
+{
+	NodeTag		type;
+	char	   *strategy;		/* partitioning strategy, "list" or "range" */
+	PartitionElem *partParam;	/* the partitioning column */
+	int			location;		/* token location, or -1 if unknown */
+} PartitionSpec;
+
+/* Partitioning strategies, as stored in pg_partitioned_table.partstrat */
+#define PARTITION_STRATEGY_LIST		'l'
+#define PARTITION_STRATEGY_RANGE	'r'
+
+/*
+ * PartitionBoundSpec - the FOR VALUES clause of CREATE TABLE ... PARTITION OF
+ *
+ * In the raw grammar output the bound values are A_Const nodes; after
+ * transformPartitionBound they are Const nodes of the partitioning column's
+ * type.  This form is stored in pg_inherits.inhpartbound.  A range bound
+ * given as UNBOUNDED is represented by a NULL pointer.
+ */
+typedef struct PartitionBoundSpec
+{
+	NodeTag		type;
+	char		strategy;		/* see PARTITION_STRATEGY codes above */
+	List	   *listdatums;		/* values accepted by a list partition */
+	Node	   *lowerdatum;		/* inclusive lower bound of a range partition */
+	Node	   *upperdatum;		/* exclusive upper bound of a range partition */
+	int			location;		/* token location, or -1 if unknown */
+} PartitionBoundSpec;
+
+/*
+ * PartitionCmd - ALTER TABLE ... INHERIT parent FOR VALUES ...
+ *
+ * Only accepted in binary-upgrade mode, where pg_dump uses it to attach a
+ * partition created with the same physical column layout as the original.
+ */
+typedef struct PartitionCmd
+{
+	NodeTag		type;
+	RangeVar   *parent;			/* the partitioned table */
+	PartitionBoundSpec *bound;	/* FOR VALUES clause */
+} PartitionCmd;
+
 /*
  * DefElem - a generic "name = value" option definition
  *
@@ -1547,6 +1608,8 @@ typedef struct CreateStmt
 	List	   *tableElts;		/* column definitions (list of ColumnDef) */
 	List	   *inhRelations;	/* relations to inherit from (list of
 								 * inhRelation) */
+	PartitionBoundSpec *partbound;	/* FOR VALUES clause, if a partition */
+	PartitionSpec *partspec;	/* PARTITION BY clause, if partitioned */
 	TypeName   *ofTypename;		/* OF typename */
 	List	   *constraints;	/* constraints (list of Constraint nodes) */
 	List	   *options;		/* options from WITH clause */
@@ -2539,6 +2602,7 @@ typedef struct VacuumStmt
 												 * or -1 to use default */
 	int			multixact_freeze_table_age;		/* multixact age at which to
 												 * scan whole table */
+	int			parallel_workers;	/* # of workers for index vacuuming */
 	RangeVar   *relation;		/* single table to process, or NULL */
 	List	   *va_cols;		/* list of column names, or NIL for all */
 } VacuumStmt;
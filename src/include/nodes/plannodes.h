@@ -182,12 +182,22 @@ typedef struct ModifyTable
 /* ----------------
  *	 Append node -
  *		Generate the concatenation of the results of sub-plans.
+ *
+ * When the sub-plans scan the partitions of a partitioned table and some
+ * of the table's restriction clauses compare the partition key with
+ * parameters, those clauses are kept in part_prune_quals so that the
+ * executor can skip the partitions they rule out once the parameter
+ * values are known.  part_prune_oids then has the OID of the relation
+ * each sub-plan scans.
  * ----------------
  */
 typedef struct Append
 {
 	Plan		plan;
 	List	   *appendplans;
+	Index		part_prune_rti;		/* RT index of partitioned table, or 0 */
+	List	   *part_prune_quals;	/* clauses to prune partitions with */
+	List	   *part_prune_oids;	/* OID of each sub-plan's relation */
 } Append;
 
 /* ----------------
@@ -469,13 +479,23 @@ typedef struct WorkTableScan
  * One way to store an arbitrary blob of bytes is to represent it as a bytea
  * Const.  Usually, though, you'll be better off choosing a representation
  * that can be dumped usefully by nodeToString().
+ *
+ * A ForeignScan may also stand for a join or an aggregation that the FDW
+ * performs remotely.  In that case scan.scanrelid is zero, and the FDW
+ * supplies fdw_scan_tlist, a targetlist describing the tuples it returns;
+ * the node's targetlist and quals then reference those columns as
+ * INDEX_VAR Vars after setrefs.c.  fs_relids is the set of rangetable
+ * indexes the node scans, and fs_server the foreign server it talks to.
  * ----------------
  */
 typedef struct ForeignScan
 {
 	Scan		scan;
+	Oid			fs_server;		/* OID of foreign server */
 	List	   *fdw_exprs;		/* expressions that FDW may evaluate */
 	List	   *fdw_private;	/* private data for FDW */
+	List	   *fdw_scan_tlist; /* optional tlist describing scan tuple */
+	Bitmapset  *fs_relids;		/* RTIs generated by this scan */
 	bool		fsSystemCol;	/* true if any "system column" is needed */
 } ForeignScan;
 
@@ -588,6 +608,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is known to be sorted on the first presortedCols of the sort
+ * keys already, so only groups of tuples equal on those need sorting.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			presortedCols;	/* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -746,6 +779,21 @@ typedef struct Limit
 	Node	   *limitCount;		/* COUNT parameter, or NULL if none */
 } Limit;
 
+/* ----------------
+ *		gather node
+ *
+ * The subplan, a sequential scan, is run by num_workers background
+ * workers as well as by the backend itself, each of them scanning a
+ * different part of the relation; the node returns the union of their
+ * output, in no particular order.
+ * ----------------
+ */
+typedef struct Gather
+{
+	Plan		plan;
+	int			num_workers;	/* number of workers to launch */
+} Gather;
+
 
 /*
  * RowMarkType -
@@ -358,6 +358,7 @@ typedef struct PlannerInfo
  *		subplan - plan for subquery (NULL if it's not a subquery)
  *		subroot - PlannerInfo for subquery (NULL if it's not a subquery)
  *		subplan_params - list of PlannerParamItems to be passed to subquery
+ *		serverid - OID of foreign server, if foreign table (else InvalidOid)
  *		fdwroutine - function hooks for FDW, if foreign table (else NULL)
  *		fdw_private - private state for FDW, if foreign table (else NULL)
  *
@@ -366,6 +367,11 @@ typedef struct PlannerInfo
  *		set_subquery_pathlist processes the object.  Likewise, fdwroutine
  *		and fdw_private are filled during initial path creation.
  *
+ *		A join relation whose members are all foreign tables on the same
+ *		server also gets serverid and fdwroutine set, so that the FDW can
+ *		offer to perform the join remotely; it may keep its own state for
+ *		the join in fdw_private.
+ *
  *		For otherrels that are appendrel members, these fields are filled
  *		in just as for a baserel.
  *
@@ -452,9 +458,11 @@ typedef struct RelOptInfo
 	struct Plan *subplan;		/* if subquery */
 	PlannerInfo *subroot;		/* if subquery */
 	List	   *subplan_params; /* if subquery */
+	/* information about foreign tables and foreign joins */
+	Oid			serverid;		/* identifies server for the table or join */
 	/* use "struct FdwRoutine" to avoid including fdwapi.h here */
-	struct FdwRoutine *fdwroutine;		/* if foreign table */
-	void	   *fdw_private;	/* if foreign table */
+	struct FdwRoutine *fdwroutine;		/* if foreign table or join */
+	void	   *fdw_private;	/* if foreign table or join */
 
 	/* used by various scans and joins: */
 	List	   *baserestrictinfo;		/* RestrictInfo structures (if base
@@ -965,6 +973,17 @@ typedef struct UniquePath
 	List	   *uniq_exprs;		/* expressions to be made unique */
 } UniquePath;
 
+/*
+ * GatherPath represents a Gather plan node, which runs its subpath, a
+ * sequential scan, in background workers as well as in the backend itself.
+ */
+typedef struct GatherPath
+{
+	Path		path;
+	Path	   *subpath;		/* path for each participant */
+	int			num_workers;	/* number of workers to launch */
+} GatherPath;
+
 /*
  * All join-type paths share these fields.
  */
@@ -144,6 +144,19 @@
 #define USE_PREFETCH
 #endif
 
+/*
+ * Default and maximum values of checkpoint_flush_after, in blocks.  Asking
+ * the kernel to write back checkpoint writes early only helps where we have
+ * sync_file_range(); elsewhere the only way to do it, posix_fadvise(), also
+ * throws the data out of the OS cache, so it's disabled by default.
+ */
+#ifdef HAVE_SYNC_FILE_RANGE
+#define DEFAULT_CHECKPOINT_FLUSH_AFTER 32
+#else
+#define DEFAULT_CHECKPOINT_FLUSH_AFTER 0
+#endif
+#define WRITEBACK_MAX_PENDING_FLUSHES 256
+
 /*
  * This is the default directory in which AF_UNIX socket files are
  * placed.	Caution: changing this risks breaking your existing client
@@ -1,7 +1,7 @@
 /* ----------
  *	pgstat.h
  *
- *	Definitions for the PostgreSQL statistics collector daemon.
+ *	Definitions for the PostgreSQL activity statistics.
  *
  *	Copyright (c) 2001-2014, PostgreSQL Global Development Group
  *
@@ -32,13 +32,11 @@ typedef enum TrackFunctionsLevel
 }	TrackFunctionsLevel;
 
 /* ----------
- * The types of backend -> collector messages
+ * The types of messages that report statistics
  * ----------
  */
 typedef enum StatMsgType
 {
-	PGSTAT_MTYPE_DUMMY,
-	PGSTAT_MTYPE_INQUIRY,
 	PGSTAT_MTYPE_TABSTAT,
 	PGSTAT_MTYPE_TABPURGE,
 	PGSTAT_MTYPE_DROPDB,
@@ -182,41 +180,15 @@ typedef struct PgStat_MsgHdr
 } PgStat_MsgHdr;
 
 /* ----------
- * Space available in a message.  This will keep the UDP packets below 1K,
- * which should fit unfragmented into the MTU of the loopback interface.
- * (Larger values of PGSTAT_MAX_MSG_SIZE would work for that on most
- * platforms, but we're being conservative here.)
+ * Space available in a message.  Messages are built on the stack of the
+ * reporting process and applied to the shared statistics one at a time, so
+ * this just bounds the batches a backend accumulates before reporting them.
  * ----------
  */
 #define PGSTAT_MAX_MSG_SIZE 1000
 #define PGSTAT_MSG_PAYLOAD	(PGSTAT_MAX_MSG_SIZE - sizeof(PgStat_MsgHdr))
 
 
-/* ----------
- * PgStat_MsgDummy				A dummy message, ignored by the collector
- * ----------
- */
-typedef struct PgStat_MsgDummy
-{
-	PgStat_MsgHdr m_hdr;
-} PgStat_MsgDummy;
-
-
-/* ----------
- * PgStat_MsgInquiry			Sent by a backend to ask the collector
- *								to write the stats file.
- * ----------
- */
-
-typedef struct PgStat_MsgInquiry
-{
-	PgStat_MsgHdr m_hdr;
-	TimestampTz clock_time;		/* observed local clock time */
-	TimestampTz cutoff_time;	/* minimum acceptable file timestamp */
-	Oid			databaseid;		/* requested DB (InvalidOid => all DBs) */
-} PgStat_MsgInquiry;
-
-
 /* ----------
  * PgStat_TableEntry			Per-table info in a MsgTabstat
  * ----------
@@ -250,8 +222,8 @@ typedef struct PgStat_MsgTabstat
 
 
 /* ----------
- * PgStat_MsgTabpurge			Sent by the backend to tell the collector
- *								about dead tables.
+ * PgStat_MsgTabpurge			Sent by the backend to report
+ *								dead tables.
  * ----------
  */
 #define PGSTAT_NUM_TABPURGE  \
@@ -268,8 +240,8 @@ typedef struct PgStat_MsgTabpurge
 
 
 /* ----------
- * PgStat_MsgDropdb				Sent by the backend to tell the collector
- *								about a dropped database
+ * PgStat_MsgDropdb				Sent by the backend to report
+ *								a dropped database
  * ----------
  */
 typedef struct PgStat_MsgDropdb
@@ -280,8 +252,8 @@ typedef struct PgStat_MsgDropdb
 
 
 /* ----------
- * PgStat_MsgResetcounter		Sent by the backend to tell the collector
- *								to reset counters
+ * PgStat_MsgResetcounter		Sent by the backend to reset
+ *								counters
  * ----------
  */
 typedef struct PgStat_MsgResetcounter
@@ -291,8 +263,8 @@ typedef struct PgStat_MsgResetcounter
 } PgStat_MsgResetcounter;
 
 /* ----------
- * PgStat_MsgResetsharedcounter Sent by the backend to tell the collector
- *								to reset a shared counter
+ * PgStat_MsgResetsharedcounter Sent by the backend to reset
+ *								a shared counter
  * ----------
  */
 typedef struct PgStat_MsgResetsharedcounter
@@ -302,8 +274,8 @@ typedef struct PgStat_MsgResetsharedcounter
 } PgStat_MsgResetsharedcounter;
 
 /* ----------
- * PgStat_MsgResetsinglecounter Sent by the backend to tell the collector
- *								to reset a single counter
+ * PgStat_MsgResetsinglecounter Sent by the backend to reset
+ *								a single counter
  * ----------
  */
 typedef struct PgStat_MsgResetsinglecounter
@@ -424,7 +396,7 @@ typedef struct PgStat_MsgTempFile
  * it against zeroes to detect whether there are any counts to transmit.
  *
  * Note that the time counters are in instr_time format here.  We convert to
- * microseconds in PgStat_Counter format when transmitting to the collector.
+ * microseconds in PgStat_Counter format when transmitting them.
  * ----------
  */
 typedef struct PgStat_FunctionCounts
@@ -474,8 +446,8 @@ typedef struct PgStat_MsgFuncstat
 } PgStat_MsgFuncstat;
 
 /* ----------
- * PgStat_MsgFuncpurge			Sent by the backend to tell the collector
- *								about dead functions.
+ * PgStat_MsgFuncpurge			Sent by the backend to report
+ *								dead functions.
  * ----------
  */
 #define PGSTAT_NUM_FUNCPURGE  \
@@ -491,8 +463,8 @@ typedef struct PgStat_MsgFuncpurge
 } PgStat_MsgFuncpurge;
 
 /* ----------
- * PgStat_MsgDeadlock			Sent by the backend to tell the collector
- *								about a deadlock that occurred.
+ * PgStat_MsgDeadlock			Sent by the backend to report
+ *								a deadlock that occurred.
  * ----------
  */
 typedef struct PgStat_MsgDeadlock
@@ -502,45 +474,18 @@ typedef struct PgStat_MsgDeadlock
 } PgStat_MsgDeadlock;
 
 
-/* ----------
- * PgStat_Msg					Union over all possible messages.
- * ----------
- */
-typedef union PgStat_Msg
-{
-	PgStat_MsgHdr msg_hdr;
-	PgStat_MsgDummy msg_dummy;
-	PgStat_MsgInquiry msg_inquiry;
-	PgStat_MsgTabstat msg_tabstat;
-	PgStat_MsgTabpurge msg_tabpurge;
-	PgStat_MsgDropdb msg_dropdb;
-	PgStat_MsgResetcounter msg_resetcounter;
-	PgStat_MsgResetsharedcounter msg_resetsharedcounter;
-	PgStat_MsgResetsinglecounter msg_resetsinglecounter;
-	PgStat_MsgAutovacStart msg_autovacuum;
-	PgStat_MsgVacuum msg_vacuum;
-	PgStat_MsgAnalyze msg_analyze;
-	PgStat_MsgArchiver msg_archiver;
-	PgStat_MsgBgWriter msg_bgwriter;
-	PgStat_MsgFuncstat msg_funcstat;
-	PgStat_MsgFuncpurge msg_funcpurge;
-	PgStat_MsgRecoveryConflict msg_recoveryconflict;
-	PgStat_MsgDeadlock msg_deadlock;
-} PgStat_Msg;
-
-
 /* ------------------------------------------------------------
- * Statistic collector data structures follow
+ * Shared statistics data structures follow
  *
  * PGSTAT_FILE_FORMAT_ID should be changed whenever any of these
  * data structures change.
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9C
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9D
 
 /* ----------
- * PgStat_StatDBEntry			The collector's data per database
+ * PgStat_StatDBEntry			The statistics per database
  * ----------
  */
 typedef struct PgStat_StatDBEntry
@@ -580,7 +525,7 @@ typedef struct PgStat_StatDBEntry
 
 
 /* ----------
- * PgStat_StatTabEntry			The collector's data per table (or index)
+ * PgStat_StatTabEntry			The statistics per table (or index)
  * ----------
  */
 typedef struct PgStat_StatTabEntry
@@ -616,7 +561,7 @@ typedef struct PgStat_StatTabEntry
 
 
 /* ----------
- * PgStat_StatFuncEntry			The collector's data per function
+ * PgStat_StatFuncEntry			The statistics per function
  * ----------
  */
 typedef struct PgStat_StatFuncEntry
@@ -631,7 +576,7 @@ typedef struct PgStat_StatFuncEntry
 
 
 /*
- * Archiver statistics kept in the stats collector
+ * Archiver statistics kept in shared memory
  */
 typedef struct PgStat_ArchiverStats
 {
@@ -645,7 +590,7 @@ typedef struct PgStat_ArchiverStats
 } PgStat_ArchiverStats;
 
 /*
- * Global statistics kept in the stats collector
+ * Global statistics kept in shared memory
  */
 typedef struct PgStat_GlobalStats
 {
@@ -690,8 +635,8 @@ typedef enum BackendState
  *
  * Each live backend maintains a PgBackendStatus struct in shared memory
  * showing its current activity.  (The structs are allocated according to
- * BackendId, but that is not critical.)  Note that the collector process
- * has no involvement in, or even access to, these structs.
+ * BackendId, but that is not critical.)  These structs are separate from
+ * the shared hash tables that accumulate the activity statistics.
  * ----------
  */
 typedef struct PgBackendStatus
@@ -791,6 +736,8 @@ extern PGDLLIMPORT int pgstat_track_activity_query_size;
 extern char *pgstat_stat_directory;
 extern char *pgstat_stat_tmpname;
 extern char *pgstat_stat_filename;
+extern int	pgstat_max_tables;
+extern int	pgstat_max_functions;
 
 /*
  * BgWriter statistics counters are updated directly by bgwriter and bufmgr
@@ -803,6 +750,14 @@ extern PgStat_MsgBgWriter BgWriterStats;
 extern PgStat_Counter pgStatBlockReadTime;
 extern PgStat_Counter pgStatBlockWriteTime;
 
+/*
+ * Shared-memory statistics; the struct is private to pgstat.c, the pointer
+ * is exported only so that postmaster.c can pass it to EXEC_BACKEND children
+ */
+typedef struct PgStat_SharedGlobal PgStat_SharedGlobal;
+
+extern PgStat_SharedGlobal *pgStatShared;
+
 /* ----------
  * Functions called from postmaster
  * ----------
@@ -810,22 +765,18 @@ extern PgStat_Counter pgStatBlockWriteTime;
 extern Size BackendStatusShmemSize(void);
 extern void CreateSharedBackendStatus(void);
 
-extern void pgstat_init(void);
-extern int	pgstat_start(void);
-extern void pgstat_reset_all(void);
-extern void allow_immediate_pgstat_restart(void);
+extern Size StatsShmemSize(void);
+extern void StatsShmemInit(void);
 
-#ifdef EXEC_BACKEND
-extern void PgstatCollectorMain(int argc, char *argv[]) __attribute__((noreturn));
-#endif
+extern void pgstat_reset_all(void);
+extern void pgstat_restore_stats(void);
+extern void pgstat_write_statsfile(void);
 
 
 /* ----------
  * Functions called from backends
  * ----------
  */
-extern void pgstat_ping(void);
-
 extern void pgstat_report_stat(bool force);
 extern void pgstat_vacuum_stat(void);
 extern void pgstat_drop_database(Oid databaseid);
@@ -873,6 +824,11 @@ extern void pgstat_initstats(Relation rel);
 		if ((rel)->pgstat_info != NULL)								\
 			(rel)->pgstat_info->t_counts.t_tuples_returned++;		\
 	} while (0)
+#define pgstat_count_heap_getnext_n(rel, n)							\
+	do {															\
+		if ((rel)->pgstat_info != NULL)								\
+			(rel)->pgstat_info->t_counts.t_tuples_returned += (n);	\
+	} while (0)
 #define pgstat_count_heap_fetch(rel)								\
 	do {															\
 		if ((rel)->pgstat_info != NULL)								\
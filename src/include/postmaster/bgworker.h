@@ -41,6 +41,8 @@
 #ifndef BGWORKER_H
 #define BGWORKER_H
 
+#include "storage/spin.h"
+
 /*---------------------------------------------------------------------
  * External module API.
  *---------------------------------------------------------------------
@@ -133,4 +135,30 @@ extern void BackgroundWorkerInitializeConnection(char *dbname, char *username);
 extern void BackgroundWorkerBlockSignals(void);
 extern void BackgroundWorkerUnblockSignals(void);
 
+/*
+ * Space in shared memory, typically in a dynamic shared memory segment,
+ * where a dynamically registered worker can leave the ERROR it is exiting
+ * with, so that the backend that launched it can report it in turn.  The
+ * worker calls BackgroundWorkerSaveError in a PG_CATCH block before
+ * re-throwing; the launching backend calls BackgroundWorkerRethrowError
+ * once the worker is gone.
+ */
+#define BGW_ERROR_MSGLEN				1024
+
+typedef struct BackgroundWorkerError
+{
+	slock_t		mutex;
+	bool		haserror;		/* has an error been saved? */
+	int			sqlerrcode;
+	char		message[BGW_ERROR_MSGLEN];
+	char		detail[BGW_ERROR_MSGLEN];
+	char		hint[BGW_ERROR_MSGLEN];
+	char		context[BGW_ERROR_MSGLEN];
+} BackgroundWorkerError;
+
+extern void BackgroundWorkerInitError(BackgroundWorkerError *error);
+extern void BackgroundWorkerSaveError(BackgroundWorkerError *error);
+extern void BackgroundWorkerRethrowError(BackgroundWorkerError *error,
+							 const char *workername);
+
 #endif   /* BGWORKER_H */
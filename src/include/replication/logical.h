@@ -79,6 +79,7 @@ extern void CheckLogicalDecodingRequirements(void);
 
 extern LogicalDecodingContext *CreateInitDecodingContext(char *plugin,
 							List *output_plugin_options,
+							bool need_full_snapshot,
 							XLogPageReadCB read_page,
 						 LogicalOutputPluginWriterPrepareWrite prepare_write,
 							LogicalOutputPluginWriterWrite do_write);
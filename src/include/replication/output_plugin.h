@@ -26,6 +26,7 @@ typedef enum OutputPluginOutputType
 typedef struct OutputPluginOptions
 {
 	OutputPluginOutputType output_type;
+	bool		streaming;		/* stream large in-progress transactions? */
 } OutputPluginOptions;
 
 /*
@@ -73,6 +74,50 @@ typedef void (*LogicalDecodeCommitCB) (
 												   ReorderBufferTXN *txn,
 												   XLogRecPtr commit_lsn);
 
+/*
+ * Called before a block of changes of an in-progress transaction is
+ * streamed. Only used if the plugin set options->streaming.
+ */
+typedef void (*LogicalDecodeStreamStartCB) (
+											 struct LogicalDecodingContext *,
+													ReorderBufferTXN *txn);
+
+/*
+ * Called after a block of changes of an in-progress transaction has been
+ * streamed.
+ */
+typedef void (*LogicalDecodeStreamStopCB) (
+											 struct LogicalDecodingContext *,
+													   ReorderBufferTXN *txn);
+
+/*
+ * Callback for every individual change of a streamed transaction.
+ */
+typedef void (*LogicalDecodeStreamChangeCB) (
+											 struct LogicalDecodingContext *,
+													ReorderBufferTXN *txn,
+														 Relation relation,
+												ReorderBufferChange *change
+);
+
+/*
+ * Called when a transaction, or a subtransaction, whose changes have
+ * (partially) been streamed aborts. Catalog access is not possible here.
+ */
+typedef void (*LogicalDecodeStreamAbortCB) (
+											 struct LogicalDecodingContext *,
+													ReorderBufferTXN *txn,
+													   XLogRecPtr abort_lsn);
+
+/*
+ * Called when a streamed transaction commits, after its last block of
+ * changes has been streamed.
+ */
+typedef void (*LogicalDecodeStreamCommitCB) (
+											 struct LogicalDecodingContext *,
+													ReorderBufferTXN *txn,
+													   XLogRecPtr commit_lsn);
+
 /*
  * Called to shutdown an output plugin.
  */
@@ -90,6 +135,12 @@ typedef struct OutputPluginCallbacks
 	LogicalDecodeChangeCB change_cb;
 	LogicalDecodeCommitCB commit_cb;
 	LogicalDecodeShutdownCB shutdown_cb;
+	/* streaming of large in-progress transactions, optional */
+	LogicalDecodeStreamStartCB stream_start_cb;
+	LogicalDecodeStreamStopCB stream_stop_cb;
+	LogicalDecodeStreamChangeCB stream_change_cb;
+	LogicalDecodeStreamAbortCB stream_abort_cb;
+	LogicalDecodeStreamCommitCB stream_commit_cb;
 } OutputPluginCallbacks;
 
 void OutputPluginPrepareWrite(struct LogicalDecodingContext *ctx, bool last_write);
@@ -126,6 +126,23 @@ typedef struct ReorderBufferTXN
 	 */
 	bool		is_known_as_subxact;
 
+	/*
+	 * Toplevel transaction of a subxact, once we know it. NULL otherwise.
+	 */
+	struct ReorderBufferTXN *toptxn;
+
+	/*
+	 * Have changes of this transaction already been streamed to the output
+	 * plugin before its commit or abort was decoded?
+	 */
+	bool		streamed;
+
+	/*
+	 * Have changes of this transaction been spilled to disk since its
+	 * changes were last discarded?
+	 */
+	bool		serialized;
+
 	/*
 	 * LSN of the first data carrying, WAL record with knowledge about this
 	 * xid. This is allowed to *not* be first record adorned with this xid, if
@@ -169,6 +186,14 @@ typedef struct ReorderBufferTXN
 	Snapshot	base_snapshot;
 	XLogRecPtr	base_snapshot_lsn;
 
+	/*
+	 * Snapshot and CommandId in effect at the end of the last streamed block
+	 * of changes, so the next block continues with them. Only set in
+	 * toplevel transactions that have been streamed.
+	 */
+	Snapshot	snapshot_now;
+	CommandId	command_id;
+
 	/*
 	 * How many ReorderBufferChange's do we have in this txn.
 	 *
@@ -253,6 +278,35 @@ typedef void (*ReorderBufferCommitCB) (
 												   ReorderBufferTXN *txn,
 												   XLogRecPtr commit_lsn);
 
+/* start streaming a block of changes callback signature */
+typedef void (*ReorderBufferStreamStartCB) (
+													   ReorderBuffer *rb,
+													   ReorderBufferTXN *txn);
+
+/* stop streaming a block of changes callback signature */
+typedef void (*ReorderBufferStreamStopCB) (
+													  ReorderBuffer *rb,
+													  ReorderBufferTXN *txn);
+
+/* streamed change callback signature */
+typedef void (*ReorderBufferStreamChangeCB) (
+														ReorderBuffer *rb,
+														ReorderBufferTXN *txn,
+														Relation relation,
+												ReorderBufferChange *change);
+
+/* streamed transaction abort callback signature */
+typedef void (*ReorderBufferStreamAbortCB) (
+													   ReorderBuffer *rb,
+													   ReorderBufferTXN *txn,
+													   XLogRecPtr abort_lsn);
+
+/* streamed transaction commit callback signature */
+typedef void (*ReorderBufferStreamCommitCB) (
+														ReorderBuffer *rb,
+														ReorderBufferTXN *txn,
+														XLogRecPtr commit_lsn);
+
 struct ReorderBuffer
 {
 	/*
@@ -280,6 +334,18 @@ struct ReorderBuffer
 	ReorderBufferApplyChangeCB apply_change;
 	ReorderBufferCommitCB commit;
 
+	/*
+	 * Callbacks to be called while the changes of a large transaction are
+	 * streamed before it finished. All NULL if the output plugin doesn't
+	 * support streaming, in which case large transactions are spilled to
+	 * disk instead.
+	 */
+	ReorderBufferStreamStartCB stream_start;
+	ReorderBufferStreamStopCB stream_stop;
+	ReorderBufferStreamChangeCB stream_change;
+	ReorderBufferStreamAbortCB stream_abort;
+	ReorderBufferStreamCommitCB stream_commit;
+
 	/*
 	 * Pointer that will be passed untouched to the callbacks.
 	 */
@@ -317,6 +383,9 @@ struct ReorderBuffer
 	/* buffer for disk<->memory conversions */
 	char	   *outbuf;
 	Size		outbufsize;
+
+	/* changes serialized into outbuf, not yet written to the spill file */
+	Size		outbuf_used;
 };
 
 
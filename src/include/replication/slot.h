@@ -12,6 +12,7 @@
 #include "fmgr.h"
 #include "access/xlog.h"
 #include "access/xlogreader.h"
+#include "replication/snapbuild.h"
 #include "storage/lwlock.h"
 #include "storage/shmem.h"
 #include "storage/spin.h"
@@ -123,6 +124,17 @@ typedef struct ReplicationSlot
 	XLogRecPtr	candidate_xmin_lsn;
 	XLogRecPtr	candidate_restart_valid;
 	XLogRecPtr	candidate_restart_lsn;
+
+	/* ----
+	 * Progress of the snapshot builder of the backend decoding from this
+	 * slot, for monitoring only. Only meaningful while snapbuild_valid is
+	 * set. snapbuild_pending is the number of transactions the builder still
+	 * has to see finishing before it can become consistent.
+	 * ----
+	 */
+	bool		snapbuild_valid;
+	SnapBuildState snapbuild_state;
+	uint32		snapbuild_pending;
 } ReplicationSlot;
 
 /*
@@ -79,5 +79,7 @@ extern void SnapBuildProcessNewCid(SnapBuild *builder, TransactionId xid,
 extern void SnapBuildProcessRunningXacts(SnapBuild *builder, XLogRecPtr lsn,
 										 struct xl_running_xacts *running);
 extern void SnapBuildSerializationPoint(SnapBuild *builder, XLogRecPtr lsn);
+extern bool SnapBuildRestoreFromSlot(SnapBuild *builder, XLogRecPtr lsn,
+									 XLogRecPtr confirmed_flush);
 
 #endif   /* SNAPBUILD_H */
@@ -123,6 +123,23 @@ struct PGPROC
 	int			syncRepState;	/* wait state for sync rep */
 	SHM_QUEUE	syncRepLinks;	/* list link if process is in syncrep queue */
 
+	/*
+	 * Info about waiting in XLogFlush for a group flush leader.  flushRqst is
+	 * set only by the owning process; flushWaitLink is protected by the
+	 * flush queue spinlock while queued.  See XLogFlush.
+	 */
+	XLogRecPtr	flushRqst;		/* flush WAL up to this LSN */
+	int			flushState;		/* XLOG_FLUSH_* state */
+	struct PGPROC *flushWaitLink;	/* next waiter in flush queue */
+
+	/*
+	 * Uses of the shared snapshot cache by GetSnapshotData, counted by the
+	 * owning process.  These are zeroed at startup and never reset, so that
+	 * summing them over all PGPROCs gives totals since then.
+	 */
+	uint64		snapshotCacheHits;	/* snapshots copied from the cache */
+	uint64		snapshotCacheMisses;	/* snapshots computed afresh */
+
 	/*
 	 * All PROCLOCK objects for locks held or awaited by this backend are
 	 * linked into one of these lists, according to the partition number of
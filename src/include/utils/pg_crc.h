@@ -7,8 +7,15 @@
  * A PAINLESS GUIDE TO CRC ERROR DETECTION ALGORITHMS, available from
  * http://www.ross.net/crc/ or several other net sites.
  *
- * We use a normal (not "reflected", in Williams' terms) CRC, using initial
- * all-ones register contents and a final bit inversion.
+ * The CRC-32 implementation here is what PostgreSQL used for WAL, the
+ * control file and other critical on-disk structures before the switch to
+ * CRC-32C (see port/pg_crc32c.h).  It uses the table of a "reflected" CRC,
+ * but shifts in the "normal" direction, so the results don't match any
+ * standard CRC-32.  It is retained only because tsvector/tsquery and
+ * pg_trgm values computed with it are stored on disk; use CRC-32C for
+ * anything new.
+ *
+ * Initial all-ones register contents and a final bit inversion are used.
  *
  * The 64-bit variant is not used as of PostgreSQL 8.1, but we retain the
  * code for possible future use.
@@ -32,13 +39,13 @@
 typedef uint32 pg_crc32;
 
 /* Initialize a CRC accumulator */
-#define INIT_CRC32(crc) ((crc) = 0xFFFFFFFF)
+#define INIT_LEGACY_CRC32(crc) ((crc) = 0xFFFFFFFF)
 
 /* Finish a CRC calculation */
-#define FIN_CRC32(crc)	((crc) ^= 0xFFFFFFFF)
+#define FIN_LEGACY_CRC32(crc)	((crc) ^= 0xFFFFFFFF)
 
 /* Accumulate some (more) bytes into a CRC */
-#define COMP_CRC32(crc, data, len)	\
+#define COMP_LEGACY_CRC32(crc, data, len)	\
 do { \
 	const unsigned char *__data = (const unsigned char *) (data); \
 	uint32		__len = (len); \
@@ -51,7 +58,7 @@ do { \
 } while (0)
 
 /* Check for equality of two CRCs */
-#define EQ_CRC32(c1,c2)  ((c1) == (c2))
+#define EQ_LEGACY_CRC32(c1,c2)  ((c1) == (c2))
 
 /* Constant table for CRC calculation */
 extern CRCDLLIMPORT const uint32 pg_crc32_table[];
@@ -172,6 +172,19 @@ typedef struct RelationData
 	/* use "struct" here to avoid needing to include fdwapi.h: */
 	struct FdwRoutine *rd_fdwroutine;	/* cached function pointers, or NULL */
 
+	/*
+	 * partitioning support
+	 *
+	 * These are loaded on first use by RelationGetPartitionKey and
+	 * RelationGetPartitionDesc, and are freed and reset on a relcache reset.
+	 * rd_partkey stays NULL if the relation is not partitioned.
+	 */
+	MemoryContext rd_partcxt;	/* private memory cxt for partition info */
+	bool		rd_partkeyvalid;	/* rd_partkey has been looked up */
+	/* use "struct" here to avoid needing to include partition.h: */
+	struct PartitionKeyData *rd_partkey;	/* partition key, or NULL */
+	struct PartitionDescData *rd_partdesc;	/* partitions, or NULL */
+
 	/*
 	 * Hack for CLUSTER, rewriting ALTER TABLE, etc: when writing a new
 	 * version of a table, we need to make any toast pointers inserted into it
@@ -57,6 +57,10 @@ extern bool ThereAreNoPriorRegisteredSnapshots(void);
 
 extern char *ExportSnapshot(Snapshot snapshot);
 
+extern Size EstimateSnapshotSpace(Snapshot snapshot);
+extern void SerializeSnapshot(Snapshot snapshot, char *start);
+extern Snapshot RestoreSnapshot(char *start);
+
 /* Support for catalog timetravel for logical decoding */
 struct HTAB;
 extern struct HTAB *HistoricSnapshotGetTupleCids(void);
@@ -36,6 +36,16 @@
  * comparison.	This could sensibly be used to provide a fast comparator
  * function for such cases, but probably not any other acceleration method.
  *
+ * Sorts can additionally be accelerated with "abbreviated keys": a
+ * pass-by-value Datum, derived from the original value, that can be
+ * compared much more cheaply and whose order agrees with the original
+ * values' order whenever the abbreviated keys are not equal.  Callers that
+ * can make use of abbreviation (at present, tuplesort.c's heap and btree
+ * index sorts, and only for the leading sort key) set the abbreviate field before calling
+ * BTSORTSUPPORT; the opclass then installs an abbreviated comparator in
+ * place of the regular one, and supplies a conversion routine plus the
+ * authoritative comparator to fall back on when abbreviated keys are equal.
+ *
  *
  * Portions Copyright (c) 1996-2014, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -68,6 +78,12 @@ typedef struct SortSupportData
 	bool		ssup_reverse;	/* descending-order sort? */
 	bool		ssup_nulls_first;		/* sort nulls first? */
 
+	/*
+	 * Set by the caller before calling BTSORTSUPPORT if it can cope with an
+	 * abbreviated comparator; see below.
+	 */
+	bool		abbreviate;
+
 	/*
 	 * These fields are workspace for callers, and should not be touched by
 	 * opclass-specific functions.
@@ -95,6 +111,28 @@ typedef struct SortSupportData
 	 */
 	int			(*comparator) (Datum x, Datum y, SortSupport ssup);
 
+	/*
+	 * Abbreviated key support.  If abbreviate was set and the opclass can
+	 * abbreviate, BTSORTSUPPORT sets comparator to a function that compares
+	 * abbreviated keys, and fills in the following fields.  Otherwise they
+	 * are left NULL, and comparator works on the original values as usual.
+	 *
+	 * abbrev_converter turns an original, non-null value into its
+	 * abbreviated key, which must be pass-by-value.  If two abbreviated keys
+	 * compare unequal, the original values must compare the same way; if
+	 * they compare equal, the caller must use abbrev_full_comparator on the
+	 * original values to decide.
+	 *
+	 * abbrev_abort, if not NULL, is called now and then with the number of
+	 * values converted so far.  Returning true tells the caller that the
+	 * abbreviated keys are not distinguishing values well enough to pay for
+	 * themselves, whereupon the caller switches comparator over to
+	 * abbrev_full_comparator and stops abbreviating.
+	 */
+	Datum		(*abbrev_converter) (Datum original, SortSupport ssup);
+	bool		(*abbrev_abort) (int memtupcount, SortSupport ssup);
+	int			(*abbrev_full_comparator) (Datum x, Datum y, SortSupport ssup);
+
 	/*
 	 * Additional sort-acceleration functions might be added here later.
 	 */
@@ -109,6 +147,9 @@ typedef struct SortSupportData
 extern int ApplySortComparator(Datum datum1, bool isNull1,
 					Datum datum2, bool isNull2,
 					SortSupport ssup);
+extern int ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup);
 #endif   /* !PG_USE_INLINE */
 #if defined(PG_USE_INLINE) || defined(SORTSUPPORT_INCLUDE_DEFINITIONS)
 /*
@@ -147,10 +188,50 @@ ApplySortComparator(Datum datum1, bool isNull1,
 
 	return compare;
 }
+
+/*
+ * Apply the authoritative comparator of a SortSupport that is using
+ * abbreviated keys, to break a tie between equal abbreviated keys.  The
+ * datums passed here must be the original values, not abbreviated keys.
+ */
+STATIC_IF_INLINE int
+ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup)
+{
+	int			compare;
+
+	if (isNull1)
+	{
+		if (isNull2)
+			compare = 0;		/* NULL "=" NULL */
+		else if (ssup->ssup_nulls_first)
+			compare = -1;		/* NULL "<" NOT_NULL */
+		else
+			compare = 1;		/* NULL ">" NOT_NULL */
+	}
+	else if (isNull2)
+	{
+		if (ssup->ssup_nulls_first)
+			compare = 1;		/* NOT_NULL ">" NULL */
+		else
+			compare = -1;		/* NOT_NULL "<" NULL */
+	}
+	else
+	{
+		compare = (*ssup->abbrev_full_comparator) (datum1, datum2, ssup);
+		if (ssup->ssup_reverse)
+			compare = -compare;
+	}
+
+	return compare;
+}
 #endif   /*-- PG_USE_INLINE || SORTSUPPORT_INCLUDE_DEFINITIONS */
 
 /* Other functions in utils/sort/sortsupport.c */
 extern void PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup);
 extern void PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup);
+extern void PrepareSortSupportFromIndexKey(Oid opfamily, Oid opcintype,
+							   SortSupport ssup);
 
 #endif   /* SORTSUPPORT_H */
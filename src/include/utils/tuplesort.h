@@ -21,6 +21,7 @@
 #define TUPLESORT_H
 
 #include "access/itup.h"
+#include "access/skey.h"
 #include "executor/tuptable.h"
 #include "fmgr.h"
 #include "utils/relcache.h"
@@ -52,7 +53,9 @@ typedef struct Tuplesortstate Tuplesortstate;
  * go with this API, not the "begin_heap" one!
  *
  * The "index_btree" API stores/sorts IndexTuples (preserving all their
- * header fields).	The sort keys are specified by a btree index definition.
+ * header fields).	The sort keys are specified by a btree index definition,
+ * or directly by a tuple descriptor and btree scankeys when there is no
+ * relcache entry for the index at hand.
  *
  * The "index_hash" API is similar to index_btree, but the tuples are
  * actually sorted by their hash codes not the raw data.
@@ -70,6 +73,10 @@ extern Tuplesortstate *tuplesort_begin_index_btree(Relation heapRel,
 							Relation indexRel,
 							bool enforceUnique,
 							int workMem, bool randomAccess);
+extern Tuplesortstate *tuplesort_begin_index_btree_scankeys(TupleDesc tupDesc,
+									 int nkeys, ScanKey indexScanKey,
+									 Oid leadopfamily, Oid leadopcintype,
+									 int workMem, bool randomAccess);
 extern Tuplesortstate *tuplesort_begin_index_hash(Relation heapRel,
 						   Relation indexRel,
 						   uint32 hash_mask,
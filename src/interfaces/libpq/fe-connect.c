@@ -336,6 +336,7 @@ static PGconn *makeEmptyPGconn(void);
 static void fillPGconn(PGconn *conn, PQconninfoOption *connOptions);
 static void freePGconn(PGconn *conn);
 static void closePGconn(PGconn *conn);
+static void freeCmdQueue(PGcmdQueueEntry *entry);
 static PQconninfoOption *conninfo_init(PQExpBuffer errorMessage);
 static PQconninfoOption *parse_connection_string(const char *conninfo,
 						PQExpBuffer errorMessage, bool use_defaults);
@@ -2695,6 +2696,7 @@ makeEmptyPGconn(void)
 	conn->status = CONNECTION_BAD;
 	conn->asyncStatus = PGASYNC_IDLE;
 	conn->xactStatus = PQTRANS_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	conn->options_valid = false;
 	conn->nonblocking = false;
 	conn->setenv_state = SETENV_STATE_IDLE;
@@ -2838,6 +2840,7 @@ freePGconn(PGconn *conn)
 		free(conn->outBuffer);
 	if (conn->rowBuf)
 		free(conn->rowBuf);
+	freeCmdQueue(conn->cmd_queue_recycle);
 	termPQExpBuffer(&conn->errorMessage);
 	termPQExpBuffer(&conn->workBuffer);
 
@@ -2848,6 +2851,24 @@ freePGconn(PGconn *conn)
 #endif
 }
 
+/*
+ * freeCmdQueue
+ *	 - free a list of pipeline command queue entries
+ */
+static void
+freeCmdQueue(PGcmdQueueEntry *entry)
+{
+	while (entry != NULL)
+	{
+		PGcmdQueueEntry *prev = entry;
+
+		entry = entry->next;
+		if (prev->query)
+			free(prev->query);
+		free(prev);
+	}
+}
+
 /*
  * closePGconn
  *	 - properly close a connection to the backend
@@ -2893,6 +2914,9 @@ closePGconn(PGconn *conn)
 										 * absent */
 	conn->asyncStatus = PGASYNC_IDLE;
 	pqClearAsyncResult(conn);	/* deallocate result */
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
+	freeCmdQueue(conn->cmd_queue_head);
+	conn->cmd_queue_head = conn->cmd_queue_tail = NULL;
 	pg_freeaddrinfo_all(conn->addrlist_family, conn->addrlist);
 	conn->addrlist = NULL;
 	conn->addr_cur = NULL;
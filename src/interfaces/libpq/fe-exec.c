@@ -39,7 +39,9 @@ char	   *const pgresStatus[] = {
 	"PGRES_NONFATAL_ERROR",
 	"PGRES_FATAL_ERROR",
 	"PGRES_COPY_BOTH",
-	"PGRES_SINGLE_TUPLE"
+	"PGRES_SINGLE_TUPLE",
+	"PGRES_PIPELINE_SYNC",
+	"PGRES_PIPELINE_ABORTED"
 };
 
 /*
@@ -53,6 +55,12 @@ static bool static_std_strings = false;
 static PGEvent *dupEvents(PGEvent *events, int count);
 static bool pqAddTuple(PGresult *res, PGresAttValue *tup);
 static bool PQsendQueryStart(PGconn *conn);
+static bool pqReserveCmdQueueEntry(PGconn *conn);
+static void pqRememberCommand(PGconn *conn, PGQueryClass queryclass,
+				  const char *query);
+static void pqCommandQueueAdvance(PGconn *conn);
+static void pqPipelineProcessQueue(PGconn *conn);
+static int	pqPipelineFlush(PGconn *conn);
 static int PQsendQueryGuts(PGconn *conn,
 				const char *command,
 				const char *stmtName,
@@ -180,6 +188,8 @@ PQmakeEmptyPGresult(PGconn *conn, ExecStatusType status)
 			case PGRES_COPY_IN:
 			case PGRES_COPY_BOTH:
 			case PGRES_SINGLE_TUPLE:
+			case PGRES_PIPELINE_SYNC:
+			case PGRES_PIPELINE_ABORTED:
 				/* non-error cases */
 				break;
 			default:
@@ -1114,6 +1124,17 @@ PQsendQuery(PGconn *conn, const char *query)
 	if (!PQsendQueryStart(conn))
 		return 0;
 
+	/*
+	 * A simple Query message may contain several commands, whose results we
+	 * would be unable to tell apart from those of the following commands.
+	 */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+				 libpq_gettext("PQsendQuery not allowed in pipeline mode\n"));
+		return 0;
+	}
+
 	/* check the argument */
 	if (!query)
 	{
@@ -1266,29 +1287,21 @@ PQsendPrepare(PGconn *conn,
 	if (pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless the pipeline will provide one */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are doing just a Parse */
-	conn->queryclass = PGQUERY_PREPARE;
-
-	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	conn->last_query = strdup(query);
-
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
 	 */
-	if (pqFlush(conn) < 0)
+	if (pqPipelineFlush(conn) < 0)
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	/* OK, it's launched!  Remember we are doing just a Parse */
+	pqRememberCommand(conn, PGQUERY_PREPARE, query);
 	return 1;
 
 sendFailed:
@@ -1357,23 +1370,215 @@ PQsendQueryStart(PGconn *conn)
 						  libpq_gettext("no connection to the server\n"));
 		return false;
 	}
-	/* Can't send while already busy, either. */
-	if (conn->asyncStatus != PGASYNC_IDLE)
+	/* Can't send while already busy, either, unless enqueuing for later */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
 	{
-		printfPQExpBuffer(&conn->errorMessage,
+		if (conn->asyncStatus != PGASYNC_IDLE)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
 				  libpq_gettext("another command is already in progress\n"));
+			return false;
+		}
+
+		/* initialize async result-accumulation state */
+		conn->result = NULL;
+		conn->next_result = NULL;
+
+		/* reset single-row processing mode */
+		conn->singleRowMode = false;
+	}
+	else
+	{
+		/*
+		 * In pipeline mode, the new command is queued behind any others, so
+		 * the result-accumulation state belongs to somebody else; it is set
+		 * up by pqPipelineProcessQueue once it's our turn.  But we can't mix
+		 * in a command while a COPY is in progress.
+		 */
+		if (conn->asyncStatus == PGASYNC_COPY_IN ||
+			conn->asyncStatus == PGASYNC_COPY_OUT ||
+			conn->asyncStatus == PGASYNC_COPY_BOTH)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+				  libpq_gettext("another command is already in progress\n"));
+			return false;
+		}
+
+		/*
+		 * Make sure we'll be able to remember the command once it's sent; a
+		 * failure after that point would leave the queue out of step with
+		 * the server.
+		 */
+		if (!pqReserveCmdQueueEntry(conn))
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			return false;
+		}
+	}
+
+	/* ready to send command message */
+	return true;
+}
+
+/*
+ * Make sure there is a free command queue entry for pqRememberCommand
+ * to use.  Returns false if out of memory.
+ */
+static bool
+pqReserveCmdQueueEntry(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (conn->cmd_queue_recycle != NULL)
+		return true;
+
+	entry = (PGcmdQueueEntry *) malloc(sizeof(PGcmdQueueEntry));
+	if (entry == NULL)
 		return false;
+	entry->query = NULL;
+	entry->next = NULL;
+	conn->cmd_queue_recycle = entry;
+	return true;
+}
+
+/*
+ * pqRememberCommand
+ *		Record the class and text of a command we have just sent.
+ *
+ * Outside pipeline mode, the command becomes the current one right away.
+ * In pipeline mode it is added to the command queue, and becomes current
+ * once the application has consumed the results of the commands ahead of
+ * it.  In either case, query may be NULL if the text is not known; if we
+ * run out of memory copying it, we just forget the text.
+ */
+static void
+pqRememberCommand(PGconn *conn, PGQueryClass queryclass, const char *query)
+{
+	PGcmdQueueEntry *entry;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		conn->queryclass = queryclass;
+		if (conn->last_query)
+			free(conn->last_query);
+		conn->last_query = query ? strdup(query) : NULL;
+		conn->asyncStatus = PGASYNC_BUSY;
+		return;
 	}
 
-	/* initialize async result-accumulation state */
-	conn->result = NULL;
-	conn->next_result = NULL;
+	/* PQsendQueryStart made sure we have an entry to use */
+	entry = conn->cmd_queue_recycle;
+	Assert(entry != NULL);
+	conn->cmd_queue_recycle = entry->next;
 
-	/* reset single-row processing mode */
+	entry->queryclass = queryclass;
+	entry->query = query ? strdup(query) : NULL;
+	entry->next = NULL;
+	if (conn->cmd_queue_tail)
+		conn->cmd_queue_tail->next = entry;
+	else
+		conn->cmd_queue_head = entry;
+	conn->cmd_queue_tail = entry;
+
+	/* If nothing was in progress, start processing this command */
+	if (conn->asyncStatus == PGASYNC_IDLE)
+		pqPipelineProcessQueue(conn);
+}
+
+/*
+ * pqCommandQueueAdvance
+ *		Remove the head of the command queue, once all of its results have
+ *		been returned to the application.
+ */
+static void
+pqCommandQueueAdvance(PGconn *conn)
+{
+	PGcmdQueueEntry *entry = conn->cmd_queue_head;
+
+	if (entry == NULL)
+		return;
+
+	conn->cmd_queue_head = entry->next;
+	if (conn->cmd_queue_head == NULL)
+		conn->cmd_queue_tail = NULL;
+
+	/* put the entry on the recycle list */
+	if (entry->query)
+	{
+		free(entry->query);
+		entry->query = NULL;
+	}
+	entry->next = conn->cmd_queue_recycle;
+	conn->cmd_queue_recycle = entry;
+}
+
+/*
+ * pqPipelineProcessQueue
+ *		In pipeline mode, make the command at the head of the queue the one
+ *		whose results PQgetResult will return next.
+ *
+ * This is a no-op unless the results of the previous command have all been
+ * consumed.  If the queue is empty, we go back to plain idle state.
+ */
+static void
+pqPipelineProcessQueue(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (conn->asyncStatus != PGASYNC_IDLE &&
+		conn->asyncStatus != PGASYNC_PIPELINE_IDLE)
+		return;
+
+	entry = conn->cmd_queue_head;
+	if (entry == NULL)
+	{
+		conn->asyncStatus = PGASYNC_IDLE;
+		return;
+	}
+
+	/* set up to collect the results of this command */
+	conn->queryclass = entry->queryclass;
+	if (conn->last_query)
+		free(conn->last_query);
+	conn->last_query = entry->query;
+	entry->query = NULL;
+	pqClearAsyncResult(conn);
 	conn->singleRowMode = false;
 
-	/* ready to send command message */
-	return true;
+	/*
+	 * After an error, the server skips everything up to the next Sync, so
+	 * don't wait for a response to this command; just report it as skipped.
+	 */
+	if (conn->pipelineStatus == PQ_PIPELINE_ABORTED &&
+		entry->queryclass != PGQUERY_SYNC)
+	{
+		conn->result = PQmakeEmptyPGresult(conn, PGRES_PIPELINE_ABORTED);
+		if (!conn->result)
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+		conn->asyncStatus = PGASYNC_READY;
+		return;
+	}
+
+	/* allow parsing to continue */
+	conn->asyncStatus = PGASYNC_BUSY;
+}
+
+/*
+ * pqPipelineFlush
+ *		Push out the data of a command just queued.
+ *
+ * In pipeline mode we don't, so that many commands can share a network
+ * packet; pqPutMsgEnd sends the data out anyway once the buffer has filled
+ * up, and PQpipelineSync, PQsendFlushRequest and PQgetResult flush it all.
+ */
+static int
+pqPipelineFlush(PGconn *conn)
+{
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+		return 0;
+	return pqFlush(conn);
 }
 
 /*
@@ -1516,32 +1721,21 @@ PQsendQueryGuts(PGconn *conn,
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless the pipeline will provide one */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are using extended query protocol */
-	conn->queryclass = PGQUERY_EXTENDED;
-
-	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	if (command)
-		conn->last_query = strdup(command);
-	else
-		conn->last_query = NULL;
-
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
 	 */
-	if (pqFlush(conn) < 0)
+	if (pqPipelineFlush(conn) < 0)
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	/* OK, it's launched!  Remember we are using extended query protocol */
+	pqRememberCommand(conn, PGQUERY_EXTENDED, command);
 	return 1;
 
 sendFailed:
@@ -1729,10 +1923,44 @@ PQgetResult(PGconn *conn)
 		case PGASYNC_IDLE:
 			res = NULL;			/* query is complete */
 			break;
+		case PGASYNC_PIPELINE_IDLE:
+
+			/*
+			 * The NULL we return now ends the results of the previous
+			 * command in the pipeline; get ready to return those of the next
+			 * one, if any.
+			 */
+			res = NULL;
+			pqPipelineProcessQueue(conn);
+			break;
 		case PGASYNC_READY:
 			res = pqPrepareAsyncResult(conn);
-			/* Set the state back to BUSY, allowing parsing to proceed. */
-			conn->asyncStatus = PGASYNC_BUSY;
+			if (conn->pipelineStatus != PQ_PIPELINE_OFF &&
+				(res == NULL || res->resultStatus != PGRES_SINGLE_TUPLE))
+			{
+				/*
+				 * This is the last result of the current command, since in
+				 * pipeline mode there's no ReadyForQuery to wait for.  An
+				 * error reported at a sync point is followed by the sync
+				 * result itself, though, so keep the Sync queued until then.
+				 *
+				 * If we ran out of memory building the result, the NULL we
+				 * return serves as the end of this command's results.
+				 */
+				if (conn->queryclass != PGQUERY_SYNC ||
+					(res && res->resultStatus == PGRES_PIPELINE_SYNC))
+					pqCommandQueueAdvance(conn);
+				conn->asyncStatus = PGASYNC_PIPELINE_IDLE;
+
+				/* A sync result is not followed by a NULL */
+				if (res == NULL || res->resultStatus == PGRES_PIPELINE_SYNC)
+					pqPipelineProcessQueue(conn);
+			}
+			else
+			{
+				/* Set the state back to BUSY, allowing parsing to proceed. */
+				conn->asyncStatus = PGASYNC_BUSY;
+			}
 			break;
 		case PGASYNC_COPY_IN:
 			res = getCopyResult(conn, PGRES_COPY_IN);
@@ -1809,6 +2037,199 @@ getCopyResult(PGconn *conn, ExecStatusType copytype)
 }
 
 
+/*
+ * PQpipelineStatus
+ *	  Return the pipeline mode status of the connection.
+ */
+PGpipelineStatus
+PQpipelineStatus(const PGconn *conn)
+{
+	if (!conn)
+		return PQ_PIPELINE_OFF;
+
+	return conn->pipelineStatus;
+}
+
+/*
+ * PQenterPipelineMode
+ *	  Put the connection in pipeline mode.
+ *
+ * In pipeline mode, the PQsend* functions queue their commands without
+ * waiting for the results of earlier ones, and without a Sync of their own.
+ * The application marks the end of a batch with PQpipelineSync, and reads
+ * the results back with PQgetResult, in the order the commands were sent:
+ * each command's results are followed by a NULL, and each sync point is
+ * reported as a PGRES_PIPELINE_SYNC result.  If a command fails, the
+ * server skips the rest of the commands up to the next sync point, and
+ * those are reported as PGRES_PIPELINE_ABORTED.
+ *
+ * Returns 1 on success (including if already in pipeline mode), and 0 if
+ * the connection is not idle; conn->errorMessage is set in that case.
+ */
+int
+PQenterPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* succeed with no action if already in pipeline mode */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+		return 1;
+
+	/* This isn't gonna work on a 2.0 server */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+		 libpq_gettext("function requires at least protocol version 3.0\n"));
+		return 0;
+	}
+
+	if (conn->asyncStatus != PGASYNC_IDLE)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+			libpq_gettext("cannot enter pipeline mode, connection not idle\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_ON;
+
+	return 1;
+}
+
+/*
+ * PQexitPipelineMode
+ *	  Take the connection out of pipeline mode.
+ *
+ * This is only possible once the results of all the commands sent have been
+ * consumed.  Returns 1 on success (including if not in pipeline mode), and
+ * 0 otherwise; conn->errorMessage is set in that case.
+ */
+int
+PQexitPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+		return 1;
+
+	if ((conn->asyncStatus != PGASYNC_IDLE &&
+		 conn->asyncStatus != PGASYNC_PIPELINE_IDLE) ||
+		conn->cmd_queue_head != NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot exit pipeline mode with uncollected results\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
+	conn->asyncStatus = PGASYNC_IDLE;
+
+	/* Flush any pending data in the output buffer */
+	if (pqFlush(conn) < 0)
+		return 0;
+
+	return 1;
+}
+
+/*
+ * PQpipelineSync
+ *	  Send a Sync message, marking the end of a batch of pipelined commands.
+ *
+ * The server processes the commands queued so far and sends back all of
+ * their results; this also resumes normal processing after an error has
+ * caused the pipeline to be aborted.  Unless part of a transaction block,
+ * the commands since the previous sync point are committed together.
+ *
+ * Returns 1 if successfully submitted, 0 if not (conn->errorMessage is set)
+ */
+int
+PQpipelineSync(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+			libpq_gettext("cannot send pipeline when not in pipeline mode\n"));
+		return 0;
+	}
+
+	if (!PQsendQueryStart(conn))
+		return 0;
+
+	/* construct the Sync message */
+	if (pqPutMsgStart('S', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0)
+		goto sendFailed;
+
+	/*
+	 * Give the data a push.  In nonblock mode, don't complain if we're unable
+	 * to send it all; PQgetResult() will do any additional flushing needed.
+	 */
+	if (pqFlush(conn) < 0)
+		goto sendFailed;
+
+	/* OK, it's launched! */
+	pqRememberCommand(conn, PGQUERY_SYNC, NULL);
+	return 1;
+
+sendFailed:
+	pqHandleSendFailure(conn);
+	return 0;
+}
+
+/*
+ * PQsendFlushRequest
+ *	  Send a Flush message, asking the server to send back the results of
+ *	  the commands it has processed so far without waiting for a Sync.
+ *
+ * Returns 1 if successfully submitted, 0 if not (conn->errorMessage is set)
+ */
+int
+PQsendFlushRequest(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* clear the error string */
+	resetPQExpBuffer(&conn->errorMessage);
+
+	/* Don't try to send if we know there's no live connection. */
+	if (conn->status != CONNECTION_OK)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("no connection to the server\n"));
+		return 0;
+	}
+
+	/* Can't send while already busy, either, unless enqueuing for later */
+	if (conn->asyncStatus != PGASYNC_IDLE &&
+		conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+				  libpq_gettext("another command is already in progress\n"));
+		return 0;
+	}
+
+	/* This isn't gonna work on a 2.0 server */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+		 libpq_gettext("function requires at least protocol version 3.0\n"));
+		return 0;
+	}
+
+	if (pqPutMsgStart('H', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0 ||
+		pqFlush(conn) < 0)
+		return 0;
+
+	return 1;
+}
+
+
 /*
  * PQexec
  *	  send a query to the backend and package up the result in a PGresult
@@ -1910,6 +2331,13 @@ PQexecStart(PGconn *conn)
 	if (!conn)
 		return false;
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("synchronous command execution functions are not allowed in pipeline mode\n"));
+		return false;
+	}
+
 	/*
 	 * Silently discard any prior query result that application didn't eat.
 	 * This is probably poor design, but it's here for backward compatibility.
@@ -2126,30 +2554,21 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless the pipeline will provide one */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are doing a Describe */
-	conn->queryclass = PGQUERY_DESCRIBE;
-
-	/* reset last-query string (not relevant now) */
-	if (conn->last_query)
-	{
-		free(conn->last_query);
-		conn->last_query = NULL;
-	}
-
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
 	 */
-	if (pqFlush(conn) < 0)
+	if (pqPipelineFlush(conn) < 0)
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	/* OK, it's launched!  Remember we are doing a Describe */
+	pqRememberCommand(conn, PGQUERY_DESCRIBE, NULL);
 	return 1;
 
 sendFailed:
@@ -2557,6 +2976,13 @@ PQfn(PGconn *conn,
 		return NULL;
 	}
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+				  libpq_gettext("PQfn not allowed in pipeline mode\n"));
+		return NULL;
+	}
+
 	if (PG_PROTOCOL_MAJOR(conn->pversion) >= 3)
 		return pqFunctionCall3(conn, fnid,
 							   result_buf, actual_result_len,
@@ -214,11 +214,37 @@ pqParseInput3(PGconn *conn)
 					if (pqGetErrorNotice3(conn, true))
 						return;
 					conn->asyncStatus = PGASYNC_READY;
+
+					/*
+					 * In pipeline mode, the server will now skip everything
+					 * up to the next Sync.
+					 */
+					if (conn->pipelineStatus != PQ_PIPELINE_OFF &&
+						conn->queryclass != PGQUERY_SYNC)
+						conn->pipelineStatus = PQ_PIPELINE_ABORTED;
 					break;
 				case 'Z':		/* backend is ready for new query */
 					if (getReadyForQuery(conn))
 						return;
-					conn->asyncStatus = PGASYNC_IDLE;
+					if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+					{
+						/*
+						 * In pipeline mode, this marks a sync point, which is
+						 * reported to the application with a result of its
+						 * own.  It also ends any aborted state.
+						 */
+						if (conn->result == NULL)
+						{
+							conn->result = PQmakeEmptyPGresult(conn,
+													   PGRES_PIPELINE_SYNC);
+							if (!conn->result)
+								return;
+						}
+						conn->pipelineStatus = PQ_PIPELINE_ON;
+						conn->asyncStatus = PGASYNC_READY;
+					}
+					else
+						conn->asyncStatus = PGASYNC_IDLE;
 					break;
 				case 'I':		/* empty query */
 					if (conn->result == NULL)
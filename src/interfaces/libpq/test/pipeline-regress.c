@@ -0,0 +1,157 @@
+/*
+ * pipeline-regress.c
+ *		A test program for libpq pipeline mode
+ *
+ * This connects to a running server, using the conninfo string given as
+ * the only parameter (or the environment defaults), sends a few commands in
+ * pipeline mode with an error in the middle, and checks that PQgetResult
+ * reports their results in the documented order: each command's results
+ * followed by a NULL, PGRES_PIPELINE_ABORTED for the commands skipped after
+ * the error, and a PGRES_PIPELINE_SYNC result with no NULL after it for the
+ * sync point.  It prints nothing and exits with status 0 if all went well.
+ *
+ * Portions Copyright (c) 2014, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/interfaces/libpq/test/pipeline-regress.c
+ */
+
+#include "postgres_fe.h"
+
+#include "libpq-fe.h"
+
+static void
+fail(PGconn *conn, const char *msg, int step)
+{
+	fprintf(stderr, "pipeline-regress: step %d: %s", step, msg);
+	if (conn && PQerrorMessage(conn)[0] != '\0')
+		fprintf(stderr, ": %s", PQerrorMessage(conn));
+	else
+		fprintf(stderr, "\n");
+	PQfinish(conn);
+	exit(1);
+}
+
+/*
+ * Fetch the next result and check that it has the expected status, or that
+ * there is none if expected is -1.
+ */
+static void
+expect_result(PGconn *conn, int expected, int step)
+{
+	PGresult   *res = PQgetResult(conn);
+
+	if (expected < 0)
+	{
+		if (res != NULL)
+		{
+			fprintf(stderr,
+					"pipeline-regress: step %d: expected NULL, got %s\n",
+					step, PQresStatus(PQresultStatus(res)));
+			PQclear(res);
+			PQfinish(conn);
+			exit(1);
+		}
+		return;
+	}
+
+	if (res == NULL)
+		fail(conn, "unexpected NULL result", step);
+	if (PQresultStatus(res) != (ExecStatusType) expected)
+	{
+		fprintf(stderr, "pipeline-regress: step %d: expected %s, got %s: %s",
+				step, PQresStatus((ExecStatusType) expected),
+				PQresStatus(PQresultStatus(res)),
+				PQresultErrorMessage(res));
+		PQclear(res);
+		PQfinish(conn);
+		exit(1);
+	}
+	if (expected == PGRES_TUPLES_OK &&
+		(PQntuples(res) != 1 || strcmp(PQgetvalue(res, 0, 0), "1") != 0))
+	{
+		fprintf(stderr, "pipeline-regress: step %d: wrong query result\n",
+				step);
+		PQclear(res);
+		PQfinish(conn);
+		exit(1);
+	}
+	PQclear(res);
+}
+
+int
+main(int argc, char *argv[])
+{
+	PGconn	   *conn;
+	int			i;
+
+	if (argc > 2)
+	{
+		fprintf(stderr, "usage: pipeline-regress [conninfo]\n");
+		return 1;
+	}
+
+	conn = PQconnectdb(argc == 2 ? argv[1] : "");
+	if (PQstatus(conn) != CONNECTION_OK)
+		fail(conn, "connection failed", 0);
+
+	if (PQenterPipelineMode(conn) != 1)
+		fail(conn, "could not enter pipeline mode", 0);
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_ON)
+		fail(conn, "pipeline mode not reported as on", 0);
+
+	/* Two good commands, a failing one, and one that must be skipped */
+	if (PQsendQueryParams(conn, "SELECT 1", 0, NULL, NULL, NULL, NULL, 0) != 1)
+		fail(conn, "could not send first query", 1);
+	if (PQsendQueryParams(conn, "SELECT 1", 0, NULL, NULL, NULL, NULL, 0) != 1)
+		fail(conn, "could not send second query", 2);
+	if (PQsendQueryParams(conn, "SELECT 1/0", 0, NULL, NULL, NULL, NULL, 0) != 1)
+		fail(conn, "could not send failing query", 3);
+	if (PQsendQueryParams(conn, "SELECT 1", 0, NULL, NULL, NULL, NULL, 0) != 1)
+		fail(conn, "could not send skipped query", 4);
+	if (PQpipelineSync(conn) != 1)
+		fail(conn, "could not send sync", 5);
+
+	/* A second batch, to check that the sync ended the aborted state */
+	if (PQsendQueryParams(conn, "SELECT 1", 0, NULL, NULL, NULL, NULL, 0) != 1)
+		fail(conn, "could not send query after sync", 6);
+	if (PQpipelineSync(conn) != 1)
+		fail(conn, "could not send second sync", 7);
+
+	/* PQexec and friends are not allowed in pipeline mode */
+	if (PQsendQuery(conn, "SELECT 1") != 0)
+		fail(conn, "PQsendQuery was accepted in pipeline mode", 7);
+
+	for (i = 1; i <= 2; i++)
+	{
+		expect_result(conn, PGRES_TUPLES_OK, i);
+		expect_result(conn, -1, i);
+	}
+
+	expect_result(conn, PGRES_FATAL_ERROR, 3);
+	expect_result(conn, -1, 3);
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_ABORTED)
+		fail(conn, "pipeline not reported as aborted after error", 3);
+
+	expect_result(conn, PGRES_PIPELINE_ABORTED, 4);
+	expect_result(conn, -1, 4);
+
+	expect_result(conn, PGRES_PIPELINE_SYNC, 5);
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_ON)
+		fail(conn, "pipeline still aborted after sync", 5);
+
+	expect_result(conn, PGRES_TUPLES_OK, 6);
+	expect_result(conn, -1, 6);
+	expect_result(conn, PGRES_PIPELINE_SYNC, 7);
+
+	/* Everything consumed: the next call reports no more results */
+	expect_result(conn, -1, 8);
+
+	if (PQexitPipelineMode(conn) != 1)
+		fail(conn, "could not exit pipeline mode", 8);
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+		fail(conn, "pipeline mode not reported as off", 8);
+
+	PQfinish(conn);
+	return 0;
+}
@@ -0,0 +1,45 @@
+# Hash index bucket splits and scans
+#
+# A scan holds a lock on its bucket, so inserts must go on and split the
+# other buckets around it, while VACUUM waits for it.  Once the scan is
+# done, the bucket it held is split too, and every key must still be found.
+
+setup
+{
+  CREATE TABLE hash_split_heap (id int4);
+  CREATE INDEX hash_split_index ON hash_split_heap USING hash (id);
+  INSERT INTO hash_split_heap SELECT g % 100 FROM generate_series(1, 1000) g;
+  INSERT INTO hash_split_heap SELECT 1000 FROM generate_series(1, 100) g;
+}
+
+teardown
+{
+  DROP TABLE hash_split_heap;
+}
+
+session "s1"
+setup
+{
+  BEGIN;
+  SET LOCAL enable_seqscan = off;
+  SET LOCAL enable_bitmapscan = off;
+}
+step "s1decl" { DECLARE c CURSOR FOR SELECT id FROM hash_split_heap WHERE id = 7; }
+step "s1fetch" { FETCH 3 FROM c; }
+step "s1fetchall" { FETCH ALL FROM c; }
+step "s1count" { SELECT count(*) FROM hash_split_heap WHERE id = 7; }
+step "s1c" { COMMIT; }
+
+session "s2"
+setup
+{
+  SET enable_seqscan = off;
+  SET enable_bitmapscan = off;
+}
+step "s2ins" { INSERT INTO hash_split_heap SELECT g % 100 FROM generate_series(1, 20000) g; }
+step "s2del" { DELETE FROM hash_split_heap WHERE id = 1000; }
+step "s2vac" { VACUUM hash_split_heap; }
+step "s2ins2" { INSERT INTO hash_split_heap SELECT g % 100 FROM generate_series(1, 1000) g; }
+step "s2check" { SELECT count(*) FROM generate_series(0, 99) g WHERE (SELECT count(*) FROM hash_split_heap WHERE id = g) = 220; }
+
+permutation "s1decl" "s1fetch" "s2ins" "s2del" "s2vac" "s1fetchall" "s1count" "s1c" "s2ins2" "s2check"
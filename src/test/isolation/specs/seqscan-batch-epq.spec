@@ -0,0 +1,39 @@
+# Tests for EvalPlanQual rechecks of batched seqscan quals
+#
+# Simple "column OP constant" clauses of a seqscan are evaluated in batches,
+# outside the scan's regular qual.  When a concurrent update changes a row
+# that such a scan had selected, the recheck must still apply them to the
+# new row version.
+
+setup
+{
+ CREATE TABLE batchepq (id int4, val int4, note text);
+ INSERT INTO batchepq SELECT g, g, 'orig' FROM generate_series(1, 10) g;
+}
+
+teardown
+{
+ DROP TABLE batchepq;
+}
+
+session "s1"
+setup		{ BEGIN ISOLATION LEVEL READ COMMITTED; }
+# moves rows 2 and 3 out of the range the other session looks for
+step "s1u"	{ UPDATE batchepq SET val = val + 100 WHERE id IN (2, 3); }
+# keeps row 4 in that range, but changes a column checked by a non-batched clause
+step "s1n"	{ UPDATE batchepq SET note = 'skip' WHERE id = 4; }
+step "s1c"	{ COMMIT; }
+
+session "s2"
+setup		{ BEGIN ISOLATION LEVEL READ COMMITTED; }
+step "s2u"	{ UPDATE batchepq SET note = 'updated' WHERE val < 5 AND note <> 'skip'; }
+step "s2l"	{ SELECT id, val, note FROM batchepq WHERE 5 > val FOR UPDATE; }
+step "s2c"	{ COMMIT; }
+
+session "s3"
+setup		{ BEGIN ISOLATION LEVEL READ COMMITTED; }
+step "read"	{ SELECT id, val, note FROM batchepq WHERE id <= 5 ORDER BY id; }
+teardown	{ COMMIT; }
+
+permutation "s1u" "s1n" "s2u" "s1c" "s2c" "read"
+permutation "s1u" "s2l" "s1c" "s2c" "read"
@@ -0,0 +1,53 @@
+use strict;
+use warnings;
+use TestLib;
+use Test::More tests => 3;
+
+# Build a hash index, split its buckets and vacuum it, then crash the server
+# before a checkpoint, so that recovery has to replay all of it.  The index
+# must then find every key, and keep working as it is split further.
+my $tempdir = TestLib::tempdir;
+start_test_server $tempdir;
+
+psql 'postgres', q{
+CHECKPOINT;
+CREATE TABLE hash_crash (id int4);
+INSERT INTO hash_crash SELECT g % 1000 FROM generate_series(1, 10000) g;
+CREATE INDEX hash_crash_index ON hash_crash USING hash (id);
+INSERT INTO hash_crash SELECT g % 1000 FROM generate_series(1, 40000) g;
+DELETE FROM hash_crash WHERE id >= 900;
+VACUUM hash_crash;
+};
+
+system_or_bail 'pg_ctl', '-s', '-D', "$tempdir/pgdata", '-m', 'immediate',
+  '-w', 'stop';
+system_or_bail 'pg_ctl', '-s', '-D', "$tempdir/pgdata", '-l',
+  "$tempdir/logfile", '-o', "--fsync=off -k $tempdir --listen-addresses=''",
+  '-w', 'start';
+
+my $settings = 'SET enable_seqscan = off; SET enable_bitmapscan = off;';
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'postgres', '-c',
+		"$settings EXPLAIN (COSTS OFF) SELECT * FROM hash_crash WHERE id = 1" ],
+	qr/Index Scan using hash_crash_index/,
+	'hash index is used after recovery');
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'postgres', '-c',
+		"$settings SELECT count(*) FROM generate_series(0, 999) g "
+		  . 'WHERE (SELECT count(*) FROM hash_crash WHERE id = g) = '
+		  . 'CASE WHEN g < 900 THEN 50 ELSE 0 END' ],
+	qr/^1000$/,
+	'all keys are found after recovery');
+
+psql 'postgres',
+  'INSERT INTO hash_crash SELECT g % 1000 FROM generate_series(1, 50000) g';
+
+command_like(
+	[   'psql', '-X', '-A', '-t', '-d', 'postgres', '-c',
+		"$settings SELECT count(*) FROM generate_series(0, 999) g "
+		  . 'WHERE (SELECT count(*) FROM hash_crash WHERE id = g) = '
+		  . 'CASE WHEN g < 900 THEN 100 ELSE 50 END' ],
+	qr/^1000$/,
+	'recovered index can be split further');
@@ -8,6 +8,7 @@
 #include <math.h>
 
 #include "access/htup_details.h"
+#include "access/tidstore.h"
 #include "access/transam.h"
 #include "access/tuptoaster.h"
 #include "access/xact.h"
@@ -812,3 +813,124 @@ make_tuple_indirect(PG_FUNCTION_ARGS)
 
 	PG_RETURN_HEAPTUPLEHEADER(newtup->t_data);
 }
+
+/*
+ * test_tidstore(space, nblocks, blockstep, ndead, offstep)
+ *
+ * Fill a TidStore of the given size for a relation of nblocks blocks, with
+ * dead tuples on every blockstep'th block: ndead offsets per block, starting
+ * at 1 and offstep apart.  Blocks are added until the store reports that it
+ * is full.  Then check that exactly the added TIDs are members, and that
+ * iterating returns them in order.  Returns whether the store filled up
+ * before all the blocks could be added.
+ */
+PG_FUNCTION_INFO_V1(test_tidstore);
+Datum
+test_tidstore(PG_FUNCTION_ARGS)
+{
+	int32		space = PG_GETARG_INT32(0);
+	BlockNumber nblocks = (BlockNumber) PG_GETARG_INT32(1);
+	int32		blockstep = PG_GETARG_INT32(2);
+	int32		ndead = PG_GETARG_INT32(3);
+	int32		offstep = PG_GETARG_INT32(4);
+	TidStore   *ts;
+	TidStoreIter iter;
+	OffsetNumber offsets[MaxHeapTuplesPerPage];
+	OffsetNumber iteroffsets[MaxHeapTuplesPerPage];
+	BlockNumber blkno;
+	BlockNumber iterblkno;
+	BlockNumber nadded = 0;
+	bool		full = false;
+	int			n;
+	int			i;
+
+	if (blockstep < 1 || ndead < 1 || offstep < 1 ||
+		1 + (ndead - 1) * offstep > MaxHeapTuplesPerPage)
+		elog(ERROR, "invalid test_tidstore arguments");
+
+	for (i = 0; i < ndead; i++)
+		offsets[i] = (OffsetNumber) (1 + i * offstep);
+
+	ts = TidStoreCreate(palloc(space), space, nblocks);
+
+	for (blkno = 0; blkno < nblocks; blkno += blockstep)
+	{
+		if (TidStoreIsFull(ts))
+		{
+			full = true;
+			break;
+		}
+		TidStoreAddBlock(ts, blkno, offsets, ndead);
+		nadded++;
+	}
+
+	if (TidStoreNumTids(ts) != (int64) nadded * ndead)
+		elog(ERROR, "store has " INT64_FORMAT " TIDs, expected " INT64_FORMAT,
+			 TidStoreNumTids(ts), (int64) nadded * ndead);
+
+	/*
+	 * Check membership of every offset of the added blocks, and of the dead
+	 * offsets on the blocks after each of them, which must not be members
+	 */
+	for (blkno = 0; blkno <= nadded * blockstep && blkno < nblocks; blkno++)
+	{
+		bool		added = (blkno % blockstep == 0 &&
+							 blkno / blockstep < nadded);
+		OffsetNumber off;
+		ItemPointerData tid;
+
+		if (!added)
+		{
+			for (i = 0; i < ndead; i++)
+			{
+				ItemPointerSet(&tid, blkno, offsets[i]);
+				if (TidStoreIsMember(ts, &tid))
+					elog(ERROR, "TID (%u,%u) is a member", blkno, offsets[i]);
+			}
+			/* skip ahead to the next block with dead tuples */
+			blkno += blockstep - blkno % blockstep - 1;
+			continue;
+		}
+
+		i = 0;
+		for (off = FirstOffsetNumber; off <= MaxHeapTuplesPerPage; off++)
+		{
+			bool		expected = false;
+
+			if (i < ndead && offsets[i] == off)
+			{
+				expected = true;
+				i++;
+			}
+			ItemPointerSet(&tid, blkno, off);
+			if (TidStoreIsMember(ts, &tid) != expected)
+				elog(ERROR, "TID (%u,%u) is %sa member",
+					 blkno, off, expected ? "not " : "");
+		}
+	}
+
+	/* Check that iterating returns the blocks in order */
+	TidStoreBeginIterate(&iter);
+	for (blkno = 0; blkno < nadded * blockstep; blkno += blockstep)
+	{
+		n = TidStoreIterateNext(ts, &iter, &iterblkno, iteroffsets);
+		if (n != ndead || iterblkno != blkno ||
+			memcmp(iteroffsets, offsets, n * sizeof(OffsetNumber)) != 0)
+			elog(ERROR, "iteration returned block %u with %d offsets, expected block %u with %d",
+				 iterblkno, n, blkno, ndead);
+	}
+	if (TidStoreIterateNext(ts, &iter, &iterblkno, iteroffsets) != 0)
+		elog(ERROR, "iteration returned too many blocks");
+
+	/* After a reset, the store is empty */
+	TidStoreReset(ts);
+	if (TidStoreNumTids(ts) != 0 || TidStoreIsFull(ts))
+		elog(ERROR, "store not empty after reset");
+	TidStoreBeginIterate(&iter);
+	if (TidStoreIterateNext(ts, &iter, &iterblkno, iteroffsets) != 0)
+		elog(ERROR, "iteration over empty store returned a block");
+
+	pfree(ts);
+
+	PG_RETURN_BOOL(full);
+}
@@ -590,3 +590,20 @@ drop view aggordview1;
 -- variadic aggregates
 select least_agg(q1,q2) from int8_tbl;
 select least_agg(variadic array[q1,q2]) from int8_tbl;
+
+-- hash aggregation that overflows work_mem and has to spill to disk
+create temp table hashagg_spill as
+  select g % 10000 as a, g as b from generate_series(1, 20000) g;
+set work_mem = 64;
+explain (costs off)
+  select a, count(*), sum(b) from hashagg_spill group by a;
+select count(*), sum(cnt), sum(s)
+  from (select a, count(*) as cnt, sum(b) as s
+          from hashagg_spill group by a) ss;
+-- knowing that the groups don't fit in work_mem, the planner still prefers
+-- spilling them over sorting the input
+analyze hashagg_spill;
+explain (costs off)
+  select a, count(*), sum(b) from hashagg_spill group by a;
+reset work_mem;
+drop table hashagg_spill;
@@ -0,0 +1,52 @@
+CREATE TABLE brintest (int4col int4,
+	int8col int8,
+	float8col float8,
+	numericcol numeric,
+	textcol text,
+	datecol date,
+	timestampcol timestamp) WITH (fillfactor = 10);
+INSERT INTO brintest SELECT
+	i,
+	i * 2,
+	i / 2.0,
+	i,
+	lpad(i::text, 5, '0'),
+	date '2000-01-01' + i,
+	timestamp '2000-01-01' + i * interval '1 hour'
+FROM generate_series(1, 1000) i;
+CREATE INDEX brinidx ON brintest USING brin (
+	int4col,
+	int8col,
+	float8col,
+	numericcol,
+	textcol,
+	datecol,
+	timestampcol
+) WITH (pages_per_range = 2);
+SET enable_seqscan = off;
+SET enable_bitmapscan = on;
+-- these queries are answered by the BRIN index
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM brintest WHERE int4col = 42;
+SELECT count(*) FROM brintest WHERE int4col < 100;
+SELECT count(*) FROM brintest WHERE int4col = 42;
+SELECT count(*) FROM brintest WHERE int8col >= 1900;
+SELECT count(*) FROM brintest WHERE float8col = 250.5;
+SELECT count(*) FROM brintest WHERE numericcol BETWEEN 10 AND 19;
+SELECT count(*) FROM brintest WHERE textcol > '00990';
+SELECT count(*) FROM brintest WHERE datecol <= '2000-01-31';
+SELECT count(*) FROM brintest WHERE timestampcol > '2000-01-02 00:00';
+SELECT count(*) FROM brintest WHERE int4col > 2000;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+-- rows added after the index was built land in unsummarized ranges
+INSERT INTO brintest SELECT i, i, i, i, i::text, date '2000-01-01', timestamp '2000-01-01'
+FROM generate_series(1001, 1010) i;
+SET enable_seqscan = off;
+SELECT count(*) FROM brintest WHERE int4col > 1000;
+RESET enable_seqscan;
+SELECT brin_summarize_new_values('brintest'); -- error, not an index
+SELECT brin_summarize_new_values('tenk1_unique1'); -- error, not a BRIN index
+VACUUM brintest;  -- summarizes the new ranges
+SELECT brin_summarize_new_values('brinidx'); -- ok, no change expected
+DROP TABLE brintest;
@@ -64,3 +64,71 @@ select proname from pg_proc where proname like E'RI\\_FKey%del' order by 1;
 set enable_indexscan to false;
 set enable_bitmapscan to true;
 select proname from pg_proc where proname like E'RI\\_FKey%del' order by 1;
+
+--
+-- Parallel index build: the table has to be big enough for the heap to be
+-- split among workers
+--
+reset enable_seqscan;
+reset enable_indexscan;
+reset enable_bitmapscan;
+set max_parallel_maintenance_workers to 2;
+create table bt_parallel_heap (a int4, b text) with (fillfactor = 10);
+insert into bt_parallel_heap
+  select i % 1000, 'row ' || i from generate_series(1, 60000) i;
+select pg_relation_size('bt_parallel_heap') / current_setting('block_size')::int4 > 3072
+  as big_enough;
+create index bt_parallel_a on bt_parallel_heap (a);
+create unique index bt_parallel_b on bt_parallel_heap (b);
+-- every heap tuple must have been indexed exactly once
+select relname, reltuples from pg_class
+  where relname in ('bt_parallel_a', 'bt_parallel_b') order by relname;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+explain (costs off)
+select count(b) from bt_parallel_heap where a >= 0;
+select count(b) from bt_parallel_heap where a >= 0;
+select count(*), count(distinct a), sum(a)
+  from bt_parallel_heap where a between 10 and 19;
+select count(*) from bt_parallel_heap where b >= '';
+-- duplicates are found even when different participants sorted them
+create unique index bt_parallel_a_unique on bt_parallel_heap (a);
+-- but old versions of updated rows are not duplicates
+update bt_parallel_heap set a = -1 where b = 'row 1';
+drop index bt_parallel_b;
+create unique index bt_parallel_b on bt_parallel_heap (b);
+select a from bt_parallel_heap where b = 'row 1';
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset max_parallel_maintenance_workers;
+drop table bt_parallel_heap;
+-- heap prefetching in plain index scans, which the default
+-- effective_io_concurrency enables; the heap is not in index order, so
+-- neighbouring index items point into different heap blocks
+create table bt_prefetch_heap (a int4, b text);
+insert into bt_prefetch_heap
+  select (i * 37) % 1000, repeat('x', 100) from generate_series(0, 999) i;
+create index bt_prefetch_a on bt_prefetch_heap (a);
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+set enable_indexonlyscan to false;
+explain (costs off)
+select a from bt_prefetch_heap where a > 100 order by a;
+select count(*), sum(a) from bt_prefetch_heap where a >= 100 and a < 900;
+select a from bt_prefetch_heap where a < 5 order by a desc;
+-- the look-ahead must follow the scan when a cursor changes direction
+begin;
+declare c scroll cursor for
+  select a from bt_prefetch_heap where a > 100 order by a;
+fetch 5 from c;
+fetch backward 3 from c;
+fetch 4 from c;
+fetch last from c;
+fetch backward 3 from c;
+fetch absolute 300 from c;
+fetch backward 2 from c;
+commit;
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_indexonlyscan;
+drop table bt_prefetch_heap;
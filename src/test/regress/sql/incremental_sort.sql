@@ -0,0 +1,44 @@
+--
+-- INCREMENTAL SORT
+--
+-- ORDER BY a, b over input that is already sorted by a
+--
+create table incsort (a int, b int);
+-- 10 groups of 2000 rows, each holding b = 0 .. 1999 in scrambled order
+insert into incsort select i / 2000, (i * 37) % 2000 from generate_series(0, 19999) i;
+create index incsort_a on incsort (a);
+analyze incsort;
+explain (costs off)
+select * from incsort order by a, b limit 10;
+select * from incsort order by a, b limit 10;
+select * from incsort order by a, b desc limit 3;
+-- the LIMIT bound must carry over from one group to the next
+select * from incsort order by a, b offset 1998 limit 4;
+select count(*), max(a), sum(b) from (select * from incsort order by a, b limit 2005) s;
+-- groups that do not fit in work_mem
+set work_mem = 64;
+set enable_seqscan = off;
+explain (costs off)
+select * from incsort order by a, b;
+select count(*) as total,
+       count(*) filter (where rn <> a * 2000 + b + 1) as misplaced
+from (select a, b, row_number() over () as rn
+      from (select * from incsort order by a, b) s) s;
+select * from incsort order by a, b offset 1998 limit 4;
+reset enable_seqscan;
+reset work_mem;
+-- rescanned for each outer row of a nested loop
+explain (costs off)
+select v.x, s.* from (values (3), (7)) v(x),
+  lateral (select * from incsort where incsort.a >= v.x
+           order by a, b limit 3) s;
+select v.x, s.* from (values (3), (7)) v(x),
+  lateral (select * from incsort where incsort.a >= v.x
+           order by a, b limit 3) s;
+-- without incremental sort, the same answer from a full sort
+set enable_incrementalsort = off;
+explain (costs off)
+select * from incsort order by a, b limit 10;
+select * from incsort order by a, b offset 1998 limit 4;
+reset enable_incrementalsort;
+drop table incsort;
@@ -0,0 +1,110 @@
+--
+-- Tests for declarative partitioning
+--
+
+-- range partitioning
+CREATE TABLE range_parted (a int, b text) PARTITION BY RANGE (a);
+CREATE TABLE rp1 PARTITION OF range_parted FOR VALUES FROM (UNBOUNDED) TO (10);
+CREATE TABLE rp2 PARTITION OF range_parted FOR VALUES FROM (10) TO (20);
+CREATE TABLE rp3 PARTITION OF range_parted FOR VALUES FROM ('20') TO (30);
+
+-- bad bounds
+CREATE TABLE fail_part PARTITION OF range_parted FOR VALUES FROM (15) TO (25);
+CREATE TABLE fail_part PARTITION OF range_parted FOR VALUES FROM (5) TO (5);
+CREATE TABLE fail_part PARTITION OF range_parted FOR VALUES FROM (NULL) TO (40);
+CREATE TABLE fail_part PARTITION OF range_parted FOR VALUES IN (40);
+CREATE TABLE fail_part PARTITION OF range_parted FOR VALUES FROM ('x') TO (40);
+
+-- the partition key is fixed, and so is the set of parents
+CREATE TABLE fail_part PARTITION OF rp1 FOR VALUES FROM (1) TO (2);
+CREATE TABLE fail_part (c int) INHERITS (range_parted);
+CREATE TABLE fail_part (c int) INHERITS (rp1);
+CREATE TABLE fail_part (a int) PARTITION BY RANGE (c);
+ALTER TABLE range_parted DROP COLUMN a;
+ALTER TABLE range_parted ALTER COLUMN a TYPE bigint;
+ALTER TABLE rp1 NO INHERIT range_parted;
+ALTER TABLE rp1 ADD COLUMN c int;
+ALTER TABLE ONLY range_parted ADD COLUMN c int;
+ALTER TABLE ONLY range_parted DROP COLUMN b;
+ALTER TABLE rp1 DROP CONSTRAINT rp1_partition_check;
+CREATE TABLE fail_part (a int, b text);
+ALTER TABLE fail_part INHERIT range_parted FOR VALUES FROM (30) TO (40);
+DROP TABLE fail_part;
+
+-- the definitions can be reconstructed, for psql and pg_dump
+\d range_parted
+\d rp1
+SELECT pg_get_partkeydef('range_parted'::regclass);
+SELECT inhrelid::regclass AS partition, pg_get_expr(inhpartbound, inhrelid) AS bound
+  FROM pg_inherits WHERE inhparent = 'range_parted'::regclass ORDER BY 1;
+
+-- rows are routed to the partition accepting them
+INSERT INTO range_parted VALUES (1, 'one'), (15, 'fifteen'), (-5, 'minus five');
+INSERT INTO range_parted VALUES (25, 'twenty-five') RETURNING *;
+COPY range_parted FROM stdin;
+10	ten
+29	twenty-nine
+\.
+INSERT INTO range_parted VALUES (30, 'thirty');
+INSERT INTO range_parted VALUES (NULL, 'none');
+INSERT INTO rp1 VALUES (15, 'wrong partition');
+UPDATE range_parted SET a = 25 WHERE a = 15;
+SELECT tableoid::regclass::text AS relname, * FROM range_parted ORDER BY a;
+
+-- partitions that can't hold matching rows are not scanned
+EXPLAIN (COSTS OFF) SELECT * FROM range_parted WHERE a = 15;
+EXPLAIN (COSTS OFF) SELECT * FROM range_parted WHERE a < 10;
+EXPLAIN (COSTS OFF) SELECT * FROM range_parted WHERE a >= 20 OR a = 5;
+EXPLAIN (COSTS OFF) SELECT * FROM range_parted WHERE a IS NULL;
+PREPARE range_q(int) AS SELECT * FROM range_parted WHERE a = $1 ORDER BY a;
+EXECUTE range_q(10);
+EXECUTE range_q(29);
+EXECUTE range_q(35);
+DEALLOCATE range_q;
+
+-- COPY buffers rows for one partition at a time, but not those for a
+-- partition with BEFORE ROW triggers
+CREATE INDEX rp2_b_idx ON rp2 (b);
+CREATE FUNCTION rp3_upper() RETURNS trigger LANGUAGE plpgsql AS
+  $$ BEGIN NEW.b := upper(NEW.b); RETURN NEW; END $$;
+CREATE TRIGGER rp3_upper BEFORE INSERT ON rp3
+  FOR EACH ROW EXECUTE PROCEDURE rp3_upper();
+COPY range_parted FROM stdin;
+11	eleven
+12	twelve
+21	twenty-one
+13	thirteen
+2	two
+22	twenty-two
+\.
+SELECT tableoid::regclass::text AS relname, * FROM range_parted
+  WHERE a IN (2, 11, 12, 13, 21, 22) ORDER BY a;
+SET enable_seqscan = off;
+SELECT a FROM rp2 WHERE b = 'thirteen';
+RESET enable_seqscan;
+DROP TRIGGER rp3_upper ON rp3;
+DROP FUNCTION rp3_upper();
+
+-- list partitioning, with a dropped column in the parent
+CREATE TABLE list_parted (a text, dropped int, b int) PARTITION BY LIST (a);
+ALTER TABLE list_parted DROP COLUMN dropped;
+CREATE TABLE lp_ab PARTITION OF list_parted FOR VALUES IN ('a', 'b');
+CREATE TABLE lp_cnull PARTITION OF list_parted FOR VALUES IN ('c', NULL);
+CREATE TABLE fail_part PARTITION OF list_parted FOR VALUES IN ('d', 'b');
+CREATE TABLE fail_part PARTITION OF list_parted FOR VALUES IN (NULL);
+CREATE TABLE fail_part PARTITION OF list_parted FOR VALUES FROM ('d') TO ('e');
+
+INSERT INTO list_parted VALUES ('a', 1), ('c', 2), (NULL, 3) RETURNING *;
+INSERT INTO list_parted VALUES ('d', 4);
+SELECT tableoid::regclass::text AS relname, * FROM list_parted ORDER BY b;
+EXPLAIN (COSTS OFF) SELECT * FROM list_parted WHERE a = 'c' OR a IS NULL;
+EXPLAIN (COSTS OFF) SELECT * FROM list_parted WHERE a IN ('a', 'b');
+\d+ list_parted
+
+-- dropping a partition doesn't need CASCADE, nor does dropping the parent
+DROP TABLE rp3;
+INSERT INTO range_parted VALUES (25, 'twenty-five');
+DROP TABLE range_parted;
+
+-- list_parted is left behind, so that pg_upgrade's test dumps and restores
+-- a partitioned table
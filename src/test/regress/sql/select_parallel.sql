@@ -0,0 +1,80 @@
+--
+-- PARALLEL
+--
+
+-- Make sure the planner considers a Gather even for these small tables.
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_relation_size = 0;
+set max_parallel_workers_per_gather = 4;
+
+explain (costs off)
+  select count(*) from tenk1 where stringu1 = 'GRAAAA';
+select count(*) from tenk1 where stringu1 = 'GRAAAA';
+
+-- every tuple must be returned exactly once, whoever scanned it
+select count(*), count(distinct unique1), sum(unique1) from tenk1;
+
+explain (costs off)
+  select string4, count(*) from tenk1 group by string4 order by string4;
+select string4, count(*) from tenk1 group by string4 order by string4;
+
+-- volatile quals are not evaluated in workers
+explain (costs off)
+  select count(*) from tenk1 where random() < 2;
+
+-- a Gather on the inside of a nestloop is rescanned
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set enable_material = off;
+set enable_indexscan = off;
+set enable_bitmapscan = off;
+explain (costs off)
+  select count(*) from int4_tbl o join tenk1 i on o.f1 = i.unique1;
+select count(*) from int4_tbl o join tenk1 i on o.f1 = i.unique1;
+reset enable_hashjoin;
+reset enable_mergejoin;
+reset enable_material;
+reset enable_indexscan;
+reset enable_bitmapscan;
+
+-- errors raised in a worker are reported by the leader
+\set VERBOSITY terse
+select count(*) from tenk1 where 1 / (unique1 - 5000) > 0;
+\set VERBOSITY default
+
+-- no parallel plans under serializable isolation
+begin isolation level serializable;
+explain (costs off)
+  select count(*) from tenk1;
+commit;
+
+-- a transaction that has an xid plans a Gather but launches no workers,
+-- and temporary tables are never scanned in parallel
+create function explain_parallel_workers(query text) returns setof text
+language plpgsql as
+$$
+declare
+  ln text;
+begin
+  for ln in execute 'explain (analyze, costs off, timing off) ' || query loop
+    if ln like '%Workers%' then
+      return next ltrim(ln);
+    end if;
+  end loop;
+end;
+$$;
+
+begin;
+create temp table parallel_temp (a int);
+select explain_parallel_workers('select count(*) from tenk1');
+explain (costs off)
+  select count(*) from parallel_temp;
+rollback;
+
+drop function explain_parallel_workers(text);
+
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_relation_size;
+reset max_parallel_workers_per_gather;
@@ -0,0 +1,100 @@
+--
+-- Batched evaluation of simple seqscan quals
+--
+-- Clauses of the form "column OP constant" on int4, int8, float8 and date
+-- columns are evaluated over a page of tuples at a time.  Check that they
+-- give the same answers as regular qual evaluation would.
+--
+create table batchq (i4 int4, i8 int8, f8 float8, d date, t text);
+insert into batchq
+  select case when g % 10 = 0 then null else g end,
+         case when g % 11 = 0 then null else g * 10000000000 end,
+         case when g % 12 = 0 then null else g / 4.0 end,
+         case when g % 13 = 0 then null else date '2000-01-01' + g end,
+         'row ' || g
+  from generate_series(1, 1000) g;
+-- int4
+select count(*) from batchq where i4 < 100;
+select count(*) from batchq where i4 <= 5;
+select count(*) from batchq where i4 = 501;
+select count(*) from batchq where i4 = 500;
+select count(*) from batchq where i4 <> 501;
+select count(*) from batchq where i4 > 990;
+select count(*) from batchq where i4 >= 995;
+-- the tuples that pass come out in physical order
+select i4, f8 from batchq where i4 > 990;
+-- int8
+select count(*) from batchq where i8 >= 9950000000000;
+select count(*) from batchq where i8 < 100000000000;
+select count(*) from batchq where i8 = 5000000000000;
+select count(*) from batchq where i8 <> 5000000000000;
+select count(*) from batchq where i8 > 4000000000000 and i8 <= 4500000000000;
+-- float8
+select count(*) from batchq where f8 < 10.5::float8;
+select count(*) from batchq where f8 = 2.5::float8;
+select count(*) from batchq where f8 >= 249.5::float8;
+select count(*) from batchq where f8 <> 2.5::float8;
+-- date
+select count(*) from batchq where d < '2000-02-01';
+select count(*) from batchq where d = '2001-01-01';
+select count(*) from batchq where d >= '2002-09-01';
+select count(*) from batchq where d <> '2000-01-02';
+-- NULLs never pass a comparison
+select count(*), count(i4) from batchq where i4 <> -1;
+select count(*) from batchq where i4 is null;
+select count(*) from batchq where i4 is null and i8 > 0::int8;
+select count(*) from batchq where i4 < null::int4;
+-- several batchable clauses on different columns
+select count(*) from batchq where i4 > 100 and i4 < 200 and f8 < 45::float8 and d <> '2000-03-01';
+select count(*) from batchq where i4 >= 300 and i8 < 3500000000000 and f8 > 80::float8;
+-- constant on the left
+select count(*) from batchq where 100 > i4;
+select count(*) from batchq where 995 <= i4;
+select count(*) from batchq where 501 <> i4;
+select count(*) from batchq where 9950000000000 <= i8;
+select count(*) from batchq where 10.5::float8 > f8;
+select count(*) from batchq where '2000-02-01' > d;
+-- a mix of batchable and non-batchable clauses
+select count(*) from batchq where i4 < 100 and t like '%5';
+select count(*) from batchq where i4 < 3 or i4 > 998;
+select count(*) from batchq where i4 < 200 and i4 + 0 > 190;
+select count(*) from batchq where i8 < 100000000000 and i4 < i8;
+select count(*) from batchq where i8 < 100 and f8 < 10::float8;
+-- NaN sorts above all other float8 values, and is equal to itself
+create table batchnan (f float8);
+insert into batchnan values ('NaN'), ('Infinity'), ('-Infinity'), ('0'), (null), ('NaN'), ('1.5');
+select f from batchnan where f > 'Infinity';
+select f from batchnan where f = 'NaN';
+select f from batchnan where f < 'NaN';
+select f from batchnan where f <> 'NaN';
+select f from batchnan where f >= 1.5::float8;
+select f from batchnan where f <= '-Infinity';
+select f from batchnan where 'NaN' > f;
+select f from batchnan where 'NaN' <= f;
+drop table batchnan;
+-- a scrollable cursor can't use batches, but must give the same rows
+begin;
+declare c scroll cursor for select i4 from batchq where i4 > 995;
+fetch all from c;
+fetch backward 2 from c;
+commit;
+-- rows removed by the batched clauses are counted by EXPLAIN ANALYZE
+create function explain_filter(text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in execute $1
+    loop
+        -- skip the lines with timing information
+        continue when ln like 'Planning time:%' or ln like 'Execution time:%';
+        return next ln;
+    end loop;
+end;
+$$;
+select explain_filter('explain (analyze, costs off, timing off) select * from batchq where i4 < 100');
+select explain_filter('explain (analyze, costs off, timing off) select * from batchq where 100 > i4');
+select explain_filter('explain (analyze, costs off, timing off) select * from batchq where i4 < 100 and t like ''%5''');
+drop function explain_filter(text);
+drop table batchq;
@@ -0,0 +1,104 @@
+--
+-- TUPLESORT
+--
+-- Abbreviated sort keys, in ORDER BY sorts and in btree index builds
+--
+-- text: values that share their abbreviated key, and NULLs
+create temp table abbrev_text (id int, t text collate "C");
+insert into abbrev_text values (1, 'abcdefghij'), (2, 'b'), (3, null),
+  (4, 'abcdefgh'), (5, ''), (6, 'abcdefgh1'), (7, 'abcdefgi'),
+  (8, 'abcdefgh0'), (9, 'a'), (10, null), (11, 'abcdefgh1');
+select quote_nullable(t) from abbrev_text order by t;
+select quote_nullable(t) from abbrev_text order by t desc nulls last;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+create index abbrev_text_t on abbrev_text (t);
+explain (costs off)
+select * from abbrev_text order by t;
+select quote_nullable(t) from abbrev_text order by t;
+drop index abbrev_text_t;
+create index abbrev_text_t_desc on abbrev_text (t desc nulls last);
+explain (costs off)
+select * from abbrev_text order by t desc nulls last;
+select quote_nullable(t) from abbrev_text order by t desc nulls last;
+-- duplicates are still found when their abbreviated keys are equal
+create unique index abbrev_text_t_uniq on abbrev_text (t);
+reset enable_seqscan;
+reset enable_bitmapscan;
+-- numeric: NaN, and values too large or too small to abbreviate exactly
+create temp table abbrev_numeric (id int, label text, n numeric);
+insert into abbrev_numeric
+  select id, n, n::numeric from (values
+  (13, 'NaN'), (7, '1e-200'), (2, '-1e300'), (12, '1e401'),
+  (5, '-1e-200'), (9, '1.000000000002'), (14, null), (1, '-1e400'),
+  (10, '1e300'), (4, '-1.000000000001'), (6, '0'), (11, '1e400'),
+  (3, '-1.000000000002'), (8, '1.000000000001')) v(id, n);
+select id, label from abbrev_numeric order by n;
+select id, label from abbrev_numeric order by n desc;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+create index abbrev_numeric_n on abbrev_numeric (n);
+explain (costs off)
+select id, label from abbrev_numeric order by n;
+select id, label from abbrev_numeric order by n;
+reset enable_seqscan;
+reset enable_bitmapscan;
+-- text values whose abbreviated keys are all the same, so that the sort
+-- gives up on abbreviation part way through its input
+create temp table abbrev_abort (id int, t text collate "C");
+insert into abbrev_abort
+  select i, 'abcdefgh' || to_char(i, 'FM0000') from generate_series(1, 1000) i
+  order by (i * 37) % 1000;
+select count(*) as total, count(*) filter (where rn <> id) as misplaced
+from (select id, row_number() over () as rn
+      from (select id from abbrev_abort order by t) s) s;
+select count(*) as total, count(*) filter (where rn <> 1001 - id) as misplaced
+from (select id, row_number() over () as rn
+      from (select id from abbrev_abort order by t desc) s) s;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+create index abbrev_abort_t on abbrev_abort (t);
+explain (costs off)
+select id from abbrev_abort order by t;
+select count(*) as total, count(*) filter (where rn <> id) as misplaced
+from (select id, row_number() over () as rn
+      from (select id from abbrev_abort order by t) s) s;
+select id from abbrev_abort where t = 'abcdefgh0500';
+reset enable_seqscan;
+reset enable_bitmapscan;
+-- sorts too big for memory, which stop abbreviating when they merge their
+-- runs; the duplicates and the numeric values' shared leading digits give
+-- plenty of equal abbreviated keys
+create temp table abbrev_ext (id int, t text collate "C", n numeric);
+insert into abbrev_ext
+  select i, md5((i % 30000)::text), 1 + ((i * 37) % 30000) * 0.000000000001
+  from generate_series(1, 40000) i;
+set work_mem = 64;
+select count(*) as total, count(*) filter (where t < prev) as misordered
+from (select t, lag(t) over () as prev
+      from (select t from abbrev_ext order by t) s) s;
+select count(*) as total, count(*) filter (where n < prev) as misordered
+from (select n, lag(n) over () as prev
+      from (select n from abbrev_ext order by n) s) s;
+reset work_mem;
+set maintenance_work_mem = '1MB';
+create index abbrev_ext_t on abbrev_ext (t);
+create index abbrev_ext_n on abbrev_ext (n);
+reset maintenance_work_mem;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+explain (costs off)
+select * from abbrev_ext order by t;
+select count(*) as total, count(*) filter (where t < prev) as misordered
+from (select t, lag(t) over () as prev
+      from (select t from abbrev_ext order by t) s) s;
+explain (costs off)
+select * from abbrev_ext order by n;
+select count(*) as total, count(*) filter (where n < prev) as misordered
+from (select n, lag(n) over () as prev
+      from (select n from abbrev_ext order by n) s) s;
+select id from abbrev_ext where t = md5('1') order by id;
+select id from abbrev_ext where n = 1.000000000037 order by id;
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table abbrev_text, abbrev_numeric, abbrev_abort, abbrev_ext;
@@ -42,6 +42,26 @@ SELECT * FROM vactst;
 VACUUM (FULL, FREEZE) vactst;
 VACUUM (ANALYZE, FULL) vactst;
 
+CREATE INDEX vactst_i1 ON vactst (i);
+CREATE INDEX vactst_i2 ON vactst (abs(i));
+INSERT INTO vactst SELECT generate_series(1, 1000);
+DELETE FROM vactst WHERE i % 3 = 0;
+VACUUM (PARALLEL 2) vactst;
+-- the rows inserted afterwards reuse the freed line pointers, so entries left
+-- pointing to them in either index would show up in the index scans
+INSERT INTO vactst SELECT -(i + 1000) FROM generate_series(1, 1000) i WHERE i % 3 = 0;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(i) FROM vactst WHERE i > 0;
+SELECT count(*), sum(i) FROM vactst WHERE abs(i) <= 1000;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+SELECT count(*) FROM vactst WHERE i < 0;
+VACUUM (PARALLEL 1, FULL) vactst;
+DELETE FROM vactst;
+DROP INDEX vactst_i1;
+DROP INDEX vactst_i2;
+
 CREATE TABLE vaccluster (i INT PRIMARY KEY);
 ALTER TABLE vaccluster CLUSTER ON vaccluster_pkey;
 INSERT INTO vaccluster SELECT * FROM vactst;
@@ -55,3 +75,42 @@ VACUUM FULL vactst;
 
 DROP TABLE vaccluster;
 DROP TABLE vactst;
+
+-- dead tuple store: one or two dead tuples per block are kept inline, a few
+-- more in a list, and many in a bitmap.  maxoff is MaxHeapTuplesPerPage.
+SELECT (current_setting('block_size')::int4 - 24) / 28 AS maxoff \gset
+SELECT test_tidstore(1048576, 1000, 1, 1, 1);
+SELECT test_tidstore(1048576, 1000, 1, 2, :maxoff - 1);
+SELECT test_tidstore(1048576, 1000, 1, 3, (:maxoff - 1) / 2);
+SELECT test_tidstore(1048576, 1000, 1, :maxoff * 2 / 3, 1);
+SELECT test_tidstore(1048576, 1000, 1, :maxoff, 1);
+-- blocks with no dead tuples take no space
+SELECT test_tidstore(65536, 1000000, 1000, 1, 1);
+SELECT test_tidstore(65536, 1000000, 1000, 5, :maxoff / 5);
+-- the store must report that it's full before running out of space
+SELECT test_tidstore(65536, 100000, 1, :maxoff / 3, 2);
+SELECT test_tidstore(65536, 100000, 7, 3, :maxoff / 4);
+SELECT test_tidstore(8192, 100000, 1, 1, 1);
+SELECT test_tidstore(64, 10, 1, 1, 1);
+
+-- VACUUM with dense and sparse patterns of dead tuples, in little memory.
+-- The rows inserted afterwards reuse the freed line pointers, so index
+-- entries left pointing to them would show up in the index scans.
+CREATE TABLE vactst_tids (i int4) WITH (autovacuum_enabled = off);
+INSERT INTO vactst_tids SELECT generate_series(1, 100000);
+CREATE INDEX vactst_tids_i ON vactst_tids (i);
+DELETE FROM vactst_tids
+  WHERE i % 1000 = 0 OR i % 97 = 0 OR (i > 20000 AND i <= 40000) OR (i > 60000 AND i % 3 = 0);
+SET maintenance_work_mem = '1MB';
+VACUUM vactst_tids;
+RESET maintenance_work_mem;
+INSERT INTO vactst_tids SELECT -i FROM generate_series(1, 100000) i
+  WHERE i % 1000 = 0 OR i % 97 = 0 OR (i > 20000 AND i <= 40000) OR (i > 60000 AND i % 3 = 0);
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(i) FROM vactst_tids WHERE i > 0;
+SELECT count(*), sum(i) FROM vactst_tids WHERE i > 15000 AND i <= 65000;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+SELECT count(*) FROM vactst_tids WHERE i < 0;
+DROP TABLE vactst_tids;